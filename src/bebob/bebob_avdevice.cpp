@@ -807,121 +807,27 @@ Device::deserialize( std::string basePath,
     return result;
 }
 
-std::string
-Device::getCachePath()
+bool
+Device::serializeCache( Util::IOSerialize& ser ) const
 {
-    std::string cachePath;
-    char* pCachePath;
-
-    string path = CACHEDIR;
-    if ( path.size() && path[0] == '~' ) {
-        path.erase( 0, 1 ); // remove ~
-        path.insert( 0, getenv( "HOME" ) ); // prepend the home path
-    }
-
-    if ( asprintf( &pCachePath, "%s/cache/",  path.c_str() ) < 0 ) {
-        debugError( "Could not create path string for cache pool (trying '/var/cache/libffado' instead)\n" );
-        cachePath = "/var/cache/libffado/";
-    } else {
-        cachePath = pCachePath;
-        free( pCachePath );
-    }
-    return cachePath;
+    return serialize( "", ser );
 }
 
 bool
-Device::loadFromCache()
+Device::deserializeCache( Util::IODeserialize& deser )
 {
-    std::string sDevicePath = getCachePath() + getConfigRom().getGuidString();
-
-    char* configId;
-    asprintf(&configId, "%016"PRIx64"", getConfigurationId() );
-    if ( !configId ) {
-        debugError( "could not create id string\n" );
-        return false;
-    }
-
-    std::string sFileName = sDevicePath + "/" + configId + ".xml";
-    free( configId );
-    debugOutput( DEBUG_LEVEL_NORMAL, "filename %s\n", sFileName.c_str() );
-
-    struct stat buf;
-    if ( stat( sFileName.c_str(), &buf ) != 0 ) {
-        debugOutput( DEBUG_LEVEL_NORMAL,  "\"%s\" does not exist\n",  sFileName.c_str() );
-        return false;
-    } else {
-        if ( !S_ISREG( buf.st_mode ) ) {
-            debugOutput( DEBUG_LEVEL_NORMAL,  "\"%s\" is not a regular file\n",  sFileName.c_str() );
-            return false;
-        }
-    }
-
-    Util::XMLDeserialize deser( sFileName, getDebugLevel() );
-
-    if (!deser.isValid()) {
-        debugOutput( DEBUG_LEVEL_NORMAL, "cache not valid: %s\n",
-                     sFileName.c_str() );
-        return false;
-    }
-
     bool result = deserialize( "", deser );
     if ( result ) {
-        debugOutput( DEBUG_LEVEL_NORMAL, "could create valid bebob driver from %s\n",
-                     sFileName.c_str() );
-    }
-
-    if(result) {
+        debugOutput( DEBUG_LEVEL_NORMAL, "could create valid bebob driver from cache\n" );
         buildMixer();
     }
-
     return result;
 }
 
-bool
-Device::saveCache()
+uint64_t
+Device::getCacheConfigurationId()
 {
-    // the path looks like this:
-    // PATH_TO_CACHE + GUID + CONFIGURATION_ID
-    string tmp_path = getCachePath() + getConfigRom().getGuidString();
-
-    // the following piece should do something like
-    // 'mkdir -p some/path/with/some/dirs/which/do/not/exist'
-    vector<string> tokens;
-    tokenize( tmp_path, tokens, "/" );
-    string path;
-    for ( vector<string>::const_iterator it = tokens.begin();
-          it != tokens.end();
-          ++it )
-    {
-        path +=  "/" + *it;
-
-        struct stat buf;
-        if ( stat( path.c_str(), &buf ) == 0 ) {
-            if ( !S_ISDIR( buf.st_mode ) ) {
-                debugError( "\"%s\" is not a directory\n",  path.c_str() );
-                return false;
-            }
-        } else {
-            if (  mkdir( path.c_str(), S_IRWXU | S_IRWXG ) != 0 ) {
-                debugError( "Could not create \"%s\" directory\n", path.c_str() );
-                return false;
-            }
-        }
-    }
-
-    // come up with an unique file name for the current settings
-    char* configId;
-    asprintf(&configId, "%016"PRIx64"", BeBoB::Device::getConfigurationId() );
-    if ( !configId ) {
-        debugError( "Could not create id string\n" );
-        return false;
-    }
-    string filename = path + "/" + configId + ".xml";
-    free( configId );
-    debugOutput( DEBUG_LEVEL_NORMAL, "filename %s\n", filename.c_str() );
-
-    Util::XMLSerialize ser( filename );
-    return serialize( "", ser );
+    return getConfigurationId();
 }
 
 } // end of namespace
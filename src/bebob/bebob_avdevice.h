@@ -64,8 +64,6 @@ public:
     virtual ~Device();
 
     static bool probe( Util::Configuration&, ConfigRom& configRom, bool generic = false );
-    virtual bool loadFromCache();
-    virtual bool saveCache();
     virtual bool discover();
 
     static FFADODevice * createDevice( DeviceManager& d, std::auto_ptr<ConfigRom>( configRom ));
@@ -119,7 +117,10 @@ public:
     virtual uint64_t getConfigurationId();
     virtual bool needsRediscovery();
 
-    std::string getCachePath();
+protected:
+    virtual bool serializeCache( Util::IOSerialize& ser ) const;
+    virtual bool deserializeCache( Util::IODeserialize& deser );
+    virtual uint64_t getCacheConfigurationId();
 
 protected:
     virtual uint8_t getConfigurationIdSampleRate();
@@ -64,14 +64,7 @@ FocusriteDevice::setSpecificValue(uint32_t id, uint32_t v)
         debugWarning("Could not retrieve useAvcForParameters parameter, defaulting to false\n");
     }
 
-    // rate control
-    ffado_microsecs_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
-    if(m_cmd_time_interval && (m_earliest_next_cmd_time > now)) {
-        ffado_microsecs_t wait = m_earliest_next_cmd_time - now;
-        debugOutput( DEBUG_LEVEL_VERBOSE, "Rate control... %"PRIu64"\n", wait );
-        Util::SystemTimeSource::SleepUsecRelative(wait);
-    }
-    m_earliest_next_cmd_time = now + m_cmd_time_interval;
+    waitForCommandSlot();
 
     if (use_avc) {
         return setSpecificValueAvc(id, v);
@@ -80,6 +73,48 @@ FocusriteDevice::setSpecificValue(uint32_t id, uint32_t v)
     }
 }
 
+bool
+FocusriteDevice::setSpecificValues(const std::vector<uint32_t> &ids,
+                                   const std::vector<uint32_t> &values)
+{
+    if (ids.size() != values.size()) {
+        debugError("%u ids for %u values\n", (unsigned int)ids.size(), (unsigned int)values.size());
+        return false;
+    }
+    bool use_avc = false;
+    if(!getOption("useAvcForParameters", use_avc)) {
+        debugWarning("Could not retrieve useAvcForParameters parameter, defaulting to false\n");
+    }
+
+    bool retval = true;
+    if (use_avc) {
+        // one AV/C command per parameter
+        for (unsigned int i = 0; i < ids.size(); i++) {
+            waitForCommandSlot();
+            retval &= setSpecificValueAvc(ids.at(i), values.at(i));
+        }
+        return retval;
+    }
+
+    // write runs of consecutive ids as one block
+    unsigned int max_quads = getConfigRom().getAsyMaxPayload() / 4;
+    if (max_quads == 0) {
+        max_quads = 1;
+    }
+    unsigned int i = 0;
+    while (i < ids.size()) {
+        unsigned int n = 1;
+        while (i + n < ids.size() && n < max_quads
+               && ids.at(i + n) == ids.at(i) + n) {
+            n++;
+        }
+        waitForCommandSlot();
+        retval &= setSpecificValuesARM(ids.at(i), n, &values.at(i));
+        i += n;
+    }
+    return retval;
+}
+
 bool
 FocusriteDevice::getSpecificValue(uint32_t id, uint32_t *v)
 {
@@ -89,14 +124,7 @@ FocusriteDevice::getSpecificValue(uint32_t id, uint32_t *v)
         debugWarning("Could not retrieve useAvcForParameters parameter, defaulting to false\n");
     }
 
-    // rate control
-    ffado_microsecs_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
-    if(m_cmd_time_interval && (m_earliest_next_cmd_time > now)) {
-        ffado_microsecs_t wait = m_earliest_next_cmd_time - now;
-        debugOutput( DEBUG_LEVEL_VERBOSE, "Rate control... %"PRIu64"\n", wait );
-        Util::SystemTimeSource::SleepUsecRelative(wait);
-    }
-    m_earliest_next_cmd_time = now + m_cmd_time_interval;
+    waitForCommandSlot();
 
     // execute
     if (use_avc) {
@@ -108,6 +136,19 @@ FocusriteDevice::getSpecificValue(uint32_t id, uint32_t *v)
     return retval;
 }
 
+void
+FocusriteDevice::waitForCommandSlot()
+{
+    // rate control
+    ffado_microsecs_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    if(m_cmd_time_interval && (m_earliest_next_cmd_time > now)) {
+        ffado_microsecs_t wait = m_earliest_next_cmd_time - now;
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Rate control... %"PRIu64"\n", wait );
+        Util::SystemTimeSource::SleepUsecRelative(wait);
+    }
+    m_earliest_next_cmd_time = now + m_cmd_time_interval;
+}
+
 // The AV/C methods to set parameters
 bool
 FocusriteDevice::setSpecificValueAvc(uint32_t id, uint32_t v)
@@ -174,6 +215,29 @@ FocusriteDevice::setSpecificValueARM(uint32_t id, uint32_t v)
     return true;
 }
 
+bool
+FocusriteDevice::setSpecificValuesARM(uint32_t id, unsigned int n, const uint32_t *v)
+{
+    if (n == 1) {
+        return setSpecificValueARM(id, v[0]);
+    }
+    debugOutput(DEBUG_LEVEL_VERY_VERBOSE,"Writing %u parameters from address space id 0x%08X\n",
+        n, id);
+
+    fb_nodeaddr_t addr = FR_PARAM_SPACE_START + (id * 4);
+    fb_nodeid_t nodeId = getNodeId() | 0xFFC0;
+
+    std::vector<fb_quadlet_t> data(n);
+    for (unsigned int i = 0; i < n; i++) {
+        data[i] = CondSwapToBus32(v[i]);
+    }
+    if(!get1394Service().write( nodeId, addr, n, &data[0] ) ) {
+        debugError("Could not write %u quadlets to node 0x%04X addr 0x%012"PRIX64"\n", n, nodeId, addr);
+        return false;
+    }
+    return true;
+}
+
 bool
 FocusriteDevice::getSpecificValueARM(uint32_t id, uint32_t *v)
 {
@@ -587,6 +651,48 @@ double FocusriteMatrixMixer::setValue( const int row, const int col, const doubl
     } else return true;
 }
 
+bool FocusriteMatrixMixer::setValues( const int row, const int col,
+                                      const int nb_rows, const int nb_cols,
+                                      const std::vector<double> &values )
+{
+    if (nb_rows < 0 || nb_cols < 0 || values.size() != (size_t)(nb_rows * nb_cols)) {
+        debugError("%u values for a %dx%d block\n", (unsigned int)values.size(), nb_rows, nb_cols);
+        return false;
+    }
+    std::vector<int> rows, cols;
+    for (int r = 0; r < nb_rows; r++) {
+        for (int c = 0; c < nb_cols; c++) {
+            rows.push_back(row + r);
+            cols.push_back(col + c);
+        }
+    }
+    return setValues(rows, cols, values);
+}
+
+bool FocusriteMatrixMixer::setValues( const std::vector<int> &rows, const std::vector<int> &cols,
+                                      const std::vector<double> &values )
+{
+    if (rows.size() != values.size() || cols.size() != values.size()) {
+        debugError("%u rows and %u cols for %u values\n", (unsigned int)rows.size(),
+                   (unsigned int)cols.size(), (unsigned int)values.size());
+        return false;
+    }
+    std::vector<uint32_t> ids(values.size());
+    std::vector<uint32_t> vals(values.size());
+    for (unsigned int i = 0; i < values.size(); i++) {
+        int32_t v = (int32_t)values.at(i);
+        if (v>0x07FFF) v=0x07FFF;
+        else if (v<0) v=0;
+        ids[i] = m_CellInfo.at(rows.at(i)).at(cols.at(i)).address;
+        vals[i] = v;
+    }
+    if ( !m_Parent.setSpecificValues(ids, vals) ) {
+        debugError( "setSpecificValues failed\n" );
+        return false;
+    }
+    return true;
+}
+
 double FocusriteMatrixMixer::getValue( const int row, const int col )
 {
     struct sCellInfo c=m_CellInfo.at(row).at(col);
@@ -186,6 +186,12 @@ public:
     virtual double setValue( const int, const int, const double );
     virtual double getValue( const int, const int );
 
+    virtual bool setValues( const int, const int, const int, const int,
+                            const std::vector<double> & );
+    virtual bool setValues( const std::vector<int> &, const std::vector<int> &,
+                            const std::vector<double> & );
+    using Control::MatrixMixer::getValues;
+
     // full map updates are unsupported
     virtual bool getCoefficientMap(int &) {return false;};
     virtual bool storeCoefficientMap(int &) {return false;};
@@ -235,6 +241,14 @@ public:
 public:
     bool setSpecificValue(uint32_t id, uint32_t v);
     bool getSpecificValue(uint32_t id, uint32_t *v);
+    /**
+     * @brief set a number of parameters
+     *
+     * Parameters with consecutive ids are written in one transaction
+     * when the parameter space is accessed directly.
+     */
+    bool setSpecificValues(const std::vector<uint32_t> &ids,
+                           const std::vector<uint32_t> &values);
 
 protected:
     int convertDefToSr( uint32_t def );
@@ -246,6 +260,9 @@ private:
 
     bool setSpecificValueARM(uint32_t id, uint32_t v);
     bool getSpecificValueARM(uint32_t id, uint32_t *v);
+    bool setSpecificValuesARM(uint32_t id, unsigned int n, const uint32_t *v);
+
+    void waitForCommandSlot();
 
 protected:
     ffado_microsecs_t m_cmd_time_interval;
@@ -54,7 +54,18 @@ Device::Device( DeviceManager& d, std::auto_ptr< ConfigRom >( configRom ) )
 
 Device::~Device()
 {
-
+    for ( StreamProcessorVectorIterator it = m_receiveProcessors.begin();
+          it != m_receiveProcessors.end();
+          ++it )
+    {
+        delete *it;
+    }
+    for ( StreamProcessorVectorIterator it = m_transmitProcessors.begin();
+          it != m_transmitProcessors.end();
+          ++it )
+    {
+        delete *it;
+    }
 }
 
 bool
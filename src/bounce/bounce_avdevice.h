@@ -98,6 +98,7 @@ protected:
 
     // streaming stuff
     typedef std::vector< Streaming::StreamProcessor * > StreamProcessorVector;
+    typedef std::vector< Streaming::StreamProcessor * >::iterator StreamProcessorVectorIterator;
     StreamProcessorVector m_receiveProcessors;
     StreamProcessorVector m_transmitProcessors;
 
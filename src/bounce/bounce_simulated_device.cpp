@@ -0,0 +1,251 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "bounce/bounce_simulated_device.h"
+#include "bounce/bounce_slave_avdevice.h"
+
+#include "libstreaming/amdtp/AmdtpStreamProcessor-common.h"
+#include "libieee1394/cycletimer.h"
+#include "libutil/ByteSwap.h"
+
+#include <algorithm>
+
+// the rate until the host sends data, the default of Bounce::Device
+#define BOUNCE_SIMULATED_DEVICE_DEFAULT_FDF         IEC61883_FDF_SFC_44K1HZ
+// the data blocks that are queued before they are sent, such that the
+// jitter of the host packets doesn't empty the queue
+#define BOUNCE_SIMULATED_DEVICE_PRIME_PACKETS       2
+// the queue is trimmed to this size when the host sends faster
+#define BOUNCE_SIMULATED_DEVICE_MAX_QUEUED_PACKETS  16
+#define BOUNCE_SIMULATED_DEVICE_SILENCE             0x40000000
+
+namespace Bounce {
+
+IMPL_DEBUG_MODULE( SimulatedDevice, SimulatedDevice, DEBUG_LEVEL_NORMAL );
+
+SimulatedDevice::SimulatedDevice( unsigned int serial )
+    : m_bus( NULL )
+    , m_nodeId( 0 )
+    // the node vendor id is the upper part of the GUID
+    , m_guid( ((fb_octlet_t)FFADO_BOUNCE_SERVER_VENDORID << 40) | serial )
+    , m_echo_channel( -1 )
+    , m_restart( true )
+    , m_dbs( 0 )
+    , m_fdf( BOUNCE_SIMULATED_DEVICE_DEFAULT_FDF )
+    , m_dbc( 0 )
+    , m_syt_interval( 8 )
+    , m_ticks_per_block( 0.0 )
+    , m_next_syt_ticks( -1.0 )
+    , m_primed( false )
+{
+}
+
+bool
+SimulatedDevice::attach( SimulatedBus& bus, fb_nodeid_t nodeId )
+{
+    m_bus = &bus;
+    m_nodeId = nodeId;
+    if (!bus.setConfigRom( nodeId, m_guid,
+                           FFADO_BOUNCE_SERVER_VENDORID, FFADO_BOUNCE_SERVER_MODELID,
+                           FFADO_BOUNCE_SERVER_SPECID, 0x00010001,
+                           FFADO_BOUNCE_SERVER_VENDORNAME, FFADO_BOUNCE_SERVER_MODELNAME )) {
+        return false;
+    }
+    bus.mapRegisters( nodeId, BOUNCE_REGISTER_BASE, BOUNCE_REGISTER_LENGTH / 4, 0 );
+    bus.setRegister( nodeId, BOUNCE_REGISTER_BASE + BOUNCE_REGISTER_TX_ISOCHANNEL, 0xFFFFFFFF );
+    bus.setRegister( nodeId, BOUNCE_REGISTER_BASE + BOUNCE_REGISTER_RX_ISOCHANNEL, 0xFFFFFFFF );
+    debugOutput( DEBUG_LEVEL_VERBOSE, "Simulated bounce device 0x%016"PRIX64" is node %d\n",
+                 m_guid, nodeId );
+    return true;
+}
+
+void
+SimulatedDevice::handleWrite( fb_nodeaddr_t addr, unsigned int length )
+{
+    fb_quadlet_t tx_channel, rx_channel;
+    if (!m_bus->getRegister( m_nodeId, BOUNCE_REGISTER_BASE + BOUNCE_REGISTER_TX_ISOCHANNEL, tx_channel )
+        || !m_bus->getRegister( m_nodeId, BOUNCE_REGISTER_BASE + BOUNCE_REGISTER_RX_ISOCHANNEL, rx_channel )) {
+        return;
+    }
+    // the bounce driver writes the registers without swapping them to
+    // the bus byte order
+    tx_channel = CondSwapToBus32( tx_channel );
+    rx_channel = CondSwapToBus32( rx_channel );
+
+    int echo_channel = -1;
+    if (tx_channel < 64 && rx_channel < 64) {
+        echo_channel = rx_channel;
+    }
+    if (m_echo_channel >= 0 && m_echo_channel != echo_channel) {
+        m_bus->setRoute( m_echo_channel, -1 );
+    }
+    if (echo_channel >= 0) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Echoing channel %d on channel %d\n",
+                     echo_channel, tx_channel );
+        m_restart = true;
+        m_bus->setRoute( echo_channel, tx_channel, this );
+    }
+    m_echo_channel = echo_channel;
+}
+
+void
+SimulatedDevice::setFormat( unsigned int dbs, unsigned char fdf )
+{
+    unsigned int rate;
+    switch (fdf) {
+        case IEC61883_FDF_SFC_32KHZ: rate = 32000; break;
+        case IEC61883_FDF_SFC_44K1HZ: rate = 44100; break;
+        case IEC61883_FDF_SFC_48KHZ: rate = 48000; break;
+        case IEC61883_FDF_SFC_88K2HZ: rate = 88200; break;
+        case IEC61883_FDF_SFC_96KHZ: rate = 96000; break;
+        case IEC61883_FDF_SFC_176K4HZ: rate = 176400; break;
+        case IEC61883_FDF_SFC_192KHZ: rate = 192000; break;
+        default:
+            debugWarning( "Unsupported SFC 0x%02X, using 44.1kHz\n", fdf );
+            rate = 44100;
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "Sending %u quadlets per block at %u Hz\n", dbs, rate );
+    m_dbs = dbs;
+    m_fdf = fdf;
+    m_syt_interval = (rate > 96000 ? 32 : (rate > 48000 ? 16 : 8));
+    m_ticks_per_block = (double)TICKS_PER_SECOND / rate;
+    // the stream starts over, as a device does when the rate changes
+    m_next_syt_ticks = -1.0;
+    m_blocks.clear();
+    m_primed = false;
+    m_silence.assign( dbs, CondSwapToBus32( BOUNCE_SIMULATED_DEVICE_SILENCE ) );
+}
+
+void
+SimulatedDevice::queueBlocks( const unsigned char* data, unsigned int nb_blocks )
+{
+    const fb_quadlet_t *quadlets = (const fb_quadlet_t *)data;
+    if (!m_primed && m_blocks.empty()) {
+        // the silence has the labels of the host stream, but no samples
+        // and no MIDI bytes
+        for (unsigned int i = 0; i < m_dbs; i++) {
+            fb_quadlet_t q = CondSwapFromBus32( quadlets[i] );
+            unsigned int label = IEC61883_AM824_GET_LABEL( q );
+            if (label >= IEC61883_AM824_LABEL_MIDI_NO_DATA
+                && label <= IEC61883_AM824_LABEL_MIDI_3X) {
+                label = IEC61883_AM824_LABEL_MIDI_NO_DATA;
+            }
+            m_silence[i] = CondSwapToBus32( IEC61883_AM824_SET_LABEL( 0, label ) );
+        }
+    }
+    m_blocks.insert( m_blocks.end(), quadlets, quadlets + nb_blocks * m_dbs );
+    unsigned int max_quadlets = BOUNCE_SIMULATED_DEVICE_MAX_QUEUED_PACKETS * m_syt_interval * m_dbs;
+    if (m_blocks.size() > max_quadlets) {
+        m_blocks.erase( m_blocks.begin(), m_blocks.begin() + (m_blocks.size() - max_quadlets) );
+    }
+    if (m_blocks.size() >= BOUNCE_SIMULATED_DEVICE_PRIME_PACKETS * m_syt_interval * m_dbs) {
+        m_primed = true;
+    }
+}
+
+unsigned int
+SimulatedDevice::forwardPacket( uint64_t cycle,
+                                const unsigned char* data, unsigned int length,
+                                unsigned char* buffer, unsigned int max_length )
+{
+    if (m_restart) {
+        m_restart = false;
+        m_dbs = 0;
+        m_fdf = BOUNCE_SIMULATED_DEVICE_DEFAULT_FDF;
+        m_dbc = 0;
+    }
+
+    // the host packet, the empty ones still have the block size
+    const struct iec61883_packet *in = (const struct iec61883_packet *)data;
+    if (length >= 2 * sizeof(fb_quadlet_t) && in->fmt == IEC61883_FMT_AMDTP && in->dbs > 0) {
+        bool has_data = (in->fdf != IEC61883_FDF_NODATA && in->syt != 0xFFFF);
+        unsigned char fdf = (has_data ? in->fdf : m_fdf);
+        if (in->dbs != m_dbs || fdf != m_fdf) {
+            setFormat( in->dbs, fdf );
+        }
+        if (has_data) {
+            unsigned int nb_blocks = (length - 2 * sizeof(fb_quadlet_t))
+                                     / (m_dbs * sizeof(fb_quadlet_t));
+            queueBlocks( in->data, nb_blocks );
+        }
+    }
+    if (m_dbs == 0) {
+        // the block size is not known yet
+        return 0;
+    }
+
+    unsigned int data_length = m_syt_interval * m_dbs * sizeof(fb_quadlet_t);
+    if (2 * sizeof(fb_quadlet_t) + data_length > max_length) {
+        debugError( "Packet of %u bytes doesn't fit\n", data_length );
+        return 0;
+    }
+
+    // the presentation time is the transfer delay after the transmit
+    // time, it restarts when the bus didn't clock the device for a while
+    double cycle_ticks = (double)cycle * TICKS_PER_CYCLE;
+    if (m_next_syt_ticks < 0 || m_next_syt_ticks - AMDTP_TRANSMIT_TRANSFER_DELAY < cycle_ticks) {
+        m_next_syt_ticks = cycle_ticks + AMDTP_TRANSMIT_TRANSFER_DELAY;
+    }
+
+    struct iec61883_packet *out = (struct iec61883_packet *)buffer;
+    memset( buffer, 0, 2 * sizeof(fb_quadlet_t) );
+    out->sid = m_nodeId & 0x3F;
+    out->eoh0 = 0;
+    out->dbs = m_dbs;
+    out->dbc = m_dbc;
+    out->eoh1 = 2;
+    out->fmt = IEC61883_FMT_AMDTP;
+
+    if (m_next_syt_ticks - AMDTP_TRANSMIT_TRANSFER_DELAY >= cycle_ticks + TICKS_PER_CYCLE) {
+        // nothing to send in this cycle
+        out->fdf = IEC61883_FDF_NODATA;
+        out->syt = 0xFFFF;
+        return 2 * sizeof(fb_quadlet_t);
+    }
+
+    uint64_t syt_ticks = (uint64_t)m_next_syt_ticks;
+    uint32_t syt = (((syt_ticks / TICKS_PER_CYCLE) & 0xF) << 12) | (syt_ticks % TICKS_PER_CYCLE);
+    out->fdf = m_fdf;
+    out->syt = CondSwapToBus16( syt );
+
+    fb_quadlet_t *quadlets = (fb_quadlet_t *)out->data;
+    for (unsigned int i = 0; i < m_syt_interval; i++) {
+        if (m_primed && m_blocks.size() >= m_dbs) {
+            std::copy( m_blocks.begin(), m_blocks.begin() + m_dbs, quadlets );
+            m_blocks.erase( m_blocks.begin(), m_blocks.begin() + m_dbs );
+        } else {
+            // the host doesn't send data, or not fast enough
+            m_primed = false;
+            std::copy( m_silence.begin(), m_silence.end(), quadlets );
+        }
+        quadlets += m_dbs;
+    }
+
+    m_dbc += m_syt_interval;
+    m_next_syt_ticks += m_syt_interval * m_ticks_per_block;
+    return 2 * sizeof(fb_quadlet_t) + data_length;
+}
+
+} // end of namespace Bounce
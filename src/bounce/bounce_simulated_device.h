@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_BOUNCESIMULATEDDEVICE__
+#define __FFADO_BOUNCESIMULATEDDEVICE__
+
+#include "debugmodule/debugmodule.h"
+#include "libieee1394/SimulatedBus.h"
+
+#include <deque>
+#include <vector>
+
+namespace Bounce {
+
+/**
+ * @brief a bounce server on the simulated bus
+ *
+ * Has the config ROM and the registers of the ffado-server slave device.
+ * Like the server, it echoes the stream it receives on the channel it
+ * transmits on, such that a Bounce::Device can stream against it.
+ *
+ * The device is clocked by the bus: it sends AMDTP data packets at the
+ * nominal rate also when the host only sends empty packets, as the host
+ * does until its receive stream runs. The data blocks of the host are
+ * queued and sent in place of silence. The rate follows the SFC of the
+ * host packets, it is 44.1kHz until the first one is received.
+ */
+class SimulatedDevice : public SimulatedBus::Node
+{
+public:
+    ///> the serial number goes into the GUID, it has to be unique
+    SimulatedDevice( unsigned int serial );
+    virtual ~SimulatedDevice() {};
+
+    virtual bool attach( SimulatedBus& bus, fb_nodeid_t nodeId );
+    virtual void handleWrite( fb_nodeaddr_t addr, unsigned int length );
+    virtual unsigned int forwardPacket( uint64_t cycle,
+                                        const unsigned char* data, unsigned int length,
+                                        unsigned char* buffer, unsigned int max_length );
+
+    void setVerboseLevel( int l ) {setDebugLevel( l );};
+
+private:
+    void setFormat( unsigned int dbs, unsigned char fdf );
+    void queueBlocks( const unsigned char* data, unsigned int nb_blocks );
+
+    SimulatedBus*   m_bus;
+    fb_nodeid_t     m_nodeId;
+    fb_octlet_t     m_guid;
+    // the channel that is currently echoed, -1 if none
+    int             m_echo_channel;
+    // set when the channels change, the stream restarts on the next cycle
+    volatile bool   m_restart;
+
+    // the stream that is sent, only used from forwardPacket()
+    unsigned int    m_dbs;
+    unsigned char   m_fdf;
+    unsigned char   m_dbc;
+    unsigned int    m_syt_interval;
+    double          m_ticks_per_block;
+    // the presentation time of the next data packet, < 0 if not started
+    double          m_next_syt_ticks;
+    // the data blocks of the host (in bus byte order)
+    std::deque< fb_quadlet_t > m_blocks;
+    bool            m_primed;
+    // sent when there is no data, the labels of the host stream
+    std::vector< fb_quadlet_t > m_silence;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+} // end of namespace Bounce
+
+#endif /* __FFADO_BOUNCESIMULATEDDEVICE__ */
@@ -27,11 +27,13 @@
 #include <stdarg.h>
 #include "libutil/ByteSwap.h"
 #include "libutil/Time.h"
+#include "libutil/SeqLock.h"
 
 #include <iostream>
 
 #include <time.h>
 #include <string.h>
+#include <stdlib.h>
 #include <errno.h>
 
 #if DEBUG_BACKTRACE_SUPPORT
@@ -65,6 +67,42 @@ ColorEntry colorTable[] = {
     { "Debug",           ""        },
 };
 
+// the trace file is written in host byte order: the magic, followed by
+// trace point definitions and records, each starting with four uint32's
+//   point:  tag, id, line, flags|nb_args, arg types, file, function, format
+//   record: tag, point id, level, 0, uint64 timestamp, uint64 args
+// strings are written as an uint32 length followed by the characters
+#define DEBUG_TRACE_FILE_MAGIC          "FFADOTR1"
+#define DEBUG_TRACE_FILE_MAGIC_LENGTH   8
+#define DEBUG_TRACE_TAG_POINT           0x50545254 // "TRTP"
+#define DEBUG_TRACE_TAG_RECORD          0x52545254 // "TRTR"
+
+#if DEBUG_TRACE_SUPPORT
+static bool
+trace_write_string(FILE *f, const char *str)
+{
+    uint32_t len = strlen(str);
+    return fwrite(&len, sizeof(len), 1, f) == 1
+           && fwrite(str, 1, len, f) == len;
+}
+#endif
+
+static bool
+trace_read_string(FILE *f, std::string &str)
+{
+    uint32_t len;
+    if (fread(&len, sizeof(len), 1, f) != 1 || len > DEBUG_MAX_MESSAGE_LENGTH) {
+        return false;
+    }
+    char buf[len + 1];
+    if (fread(buf, 1, len, f) != len) {
+        return false;
+    }
+    buf[len] = 0;
+    str = buf;
+    return true;
+}
+
 
 DebugModule::DebugModule( std::string name,  debug_level_t level )
     : m_name( name )
@@ -111,18 +149,26 @@ DebugModule::printShort( debug_level_t level,
     }
 #endif
 
+    va_list arg;
+    va_start( arg, format );
+    vprintShort( level, format, arg );
+    va_end( arg );
+}
+
+void
+DebugModule::vprintShort( debug_level_t level,
+                          const char* format,
+                          va_list arg ) const
+{
     const char *warning = "WARNING: message truncated!\n";
     const int warning_size = 32;
-    va_list arg;
     char msg[MB_BUFFERSIZE];
 
     // format the message such that it remains together
     int chars_written=0;
     int retval=0;
 
-    va_start( arg, format );
     retval = vsnprintf(msg+chars_written, MB_BUFFERSIZE, format, arg);
-    va_end( arg );
     if (retval >= 0) {  // ignore errors
         chars_written += retval;
     }
@@ -165,10 +211,23 @@ DebugModule::print( debug_level_t level,
     }
 #endif
 
+    va_list arg;
+    va_start( arg, format );
+    vprint( level, file, function, line, format, arg );
+    va_end( arg );
+}
+
+void
+DebugModule::vprint( debug_level_t level,
+                     const char*   file,
+                     const char*   function,
+                     unsigned int  line,
+                     const char*   format,
+                     va_list       arg ) const
+{
     const char *warning = "WARNING: message truncated!\n";
     const int warning_size = 32;
 
-    va_list arg;
     char msg[MB_BUFFERSIZE];
 
     // remove the path info from the filename
@@ -192,11 +251,9 @@ DebugModule::print( debug_level_t level,
                       fname,  line,  function );
     if (retval >= 0) chars_written += retval; // ignore errors
 
-    va_start( arg, format );
     retval = vsnprintf( msg + chars_written,
                         MB_BUFFERSIZE - chars_written,
                         format, arg);
-    va_end( arg );
     if (retval >= 0) chars_written += retval; // ignore errors
 
     retval = snprintf( msg + chars_written,
@@ -224,8 +281,107 @@ DebugModule::print( debug_level_t level,
     }
 }
 
+void
+DebugModule::trace( debug_level_t level,
+                    DebugTracePoint *point,
+                    ... ) const
+{
+    // bypass for performance
+#if DEBUG_BACKLOG_SUPPORT
+    if (level > BACKLOG_MIN_LEVEL 
+        && level > m_level) {
+        return;
+    }
+#else
+    if ( level >m_level ) {
+        return;
+    }
+#endif
+
+    va_list arg;
+
+#if DEBUG_TRACE_SUPPORT
+    if ( point->state == DebugTracePoint::eS_Unparsed ) {
+        debugTraceParseFormat( *point );
+    }
+    SEQLOCK_READ_BARRIER();
+
+    DebugModuleManager::TraceBuffer *b = NULL;
+    // the backlog only takes formatted messages
+    if ( point->state == DebugTracePoint::eS_Binary && level <= m_level ) {
+        b = DebugModuleManager::instance()->getTraceBuffer();
+    }
+    if ( b ) {
+        unsigned int head = b->head;
+        if ( head - b->tail >= DEBUG_TRACE_BUFFER_RECORDS ) {
+            // the buffer is full, drop the trace
+            b->overruns++;
+            return;
+        }
+
+        DebugModuleManager::TraceRecord *r =
+            &b->records[head & (DEBUG_TRACE_BUFFER_RECORDS - 1)];
+        r->timestamp = DebugModuleManager::trace_timestamp();
+        r->point = point;
+        r->level = level;
+
+        va_start( arg, point );
+        for ( unsigned int i = 0; i < point->nb_args; i++ ) {
+            switch ( point->arg_types[i] ) {
+                case DebugTracePoint::eAT_Int:
+                    r->args[i] = (int64_t)va_arg( arg, int );
+                    break;
+                case DebugTracePoint::eAT_Long:
+                    r->args[i] = (int64_t)va_arg( arg, long );
+                    break;
+                case DebugTracePoint::eAT_LongLong:
+                    r->args[i] = (uint64_t)va_arg( arg, long long );
+                    break;
+                case DebugTracePoint::eAT_Size:
+                    r->args[i] = (uint64_t)va_arg( arg, size_t );
+                    break;
+                case DebugTracePoint::eAT_Double: {
+                    double d = va_arg( arg, double );
+                    memcpy( &r->args[i], &d, sizeof(d) );
+                    break;
+                }
+                case DebugTracePoint::eAT_Pointer:
+                    r->args[i] = (uintptr_t)va_arg( arg, void * );
+                    break;
+            }
+        }
+        va_end( arg );
+
+        // publish the record
+        SEQLOCK_WRITE_BARRIER();
+        b->head = head + 1;
+
+        // don't wait for the flush interval when the buffer fills up, and
+        // wake up the message buffer thread when it doesn't poll. the full
+        // barrier orders the head store before the load of the idle flag.
+        DebugModuleManager *m = DebugModuleManager::instance();
+        __sync_synchronize();
+        if ( head - b->tail == DEBUG_TRACE_BUFFER_RECORDS / 2
+             || ( m->m_trace_idle
+                  && __sync_bool_compare_and_swap( &m->m_trace_idle, 1, 0 ) ) ) {
+            m->trace_kick();
+        }
+        return;
+    }
+#endif
+
+    va_start( arg, point );
+    if ( point->short_format ) {
+        vprintShort( level, point->format, arg );
+    } else {
+        vprint( level, point->file, point->function, point->line,
+                point->format, arg );
+    }
+    va_end( arg );
+}
+
 const char*
-DebugModule::getPreSequence( debug_level_t level ) const
+DebugModule::getPreSequence( debug_level_t level )
 {
     if ( ( level <= eDL_Normal ) && ( level >= eDL_Message ) ) {
         return colorTable[level].preSequence;
@@ -234,7 +390,7 @@ DebugModule::getPreSequence( debug_level_t level ) const
 }
 
 const char*
-DebugModule::getPostSequence( debug_level_t level ) const
+DebugModule::getPostSequence( debug_level_t level )
 {
     if ( ( level <= eDL_Normal ) && ( level >= eDL_Message ) ) {
         return colorTable[level].postSequence;
@@ -259,6 +415,13 @@ DebugModuleManager::DebugModuleManager()
 #if DEBUG_BACKLOG_SUPPORT
     , bl_mb_inbuffer(0)
 #endif
+#if DEBUG_TRACE_SUPPORT
+    , m_trace_buffers(NULL)
+    , m_trace_file(NULL)
+    , m_trace_nb_points(0)
+    , m_trace_overruns(0)
+    , m_trace_idle(0)
+#endif
 {
 
 }
@@ -285,6 +448,25 @@ DebugModuleManager::~DebugModuleManager()
     mb_flush();
 #endif
 
+#if DEBUG_TRACE_SUPPORT
+    pthread_mutex_lock(&m_trace_lock);
+    while (m_trace_buffers) {
+        TraceBuffer *b = m_trace_buffers;
+        m_trace_overruns += b->overruns;
+        m_trace_buffers = b->next;
+        free(b);
+    }
+    pthread_mutex_unlock(&m_trace_lock);
+    if (m_trace_file) {
+        fclose(m_trace_file);
+    }
+    if (m_trace_overruns) {
+        fprintf(stderr, "WARNING: %u traces dropped!\n", m_trace_overruns);
+    }
+    pthread_key_delete(m_trace_key);
+    pthread_mutex_destroy(&m_trace_lock);
+#endif
+
 #if DEBUG_BACKTRACE_SUPPORT
     pthread_mutex_lock(&m_backtrace_lock);
     // print a list of the symbols seen in a backtrace
@@ -357,6 +539,15 @@ DebugModuleManager::init()
     pthread_mutex_init(&bl_mb_write_lock, NULL);
 #endif
 
+#if DEBUG_TRACE_SUPPORT
+    pthread_mutex_init(&m_trace_lock, NULL);
+    pthread_key_create(&m_trace_key, trace_buffer_release);
+    const char *trace_file = getenv("FFADO_TRACE_FILE");
+    if (trace_file) {
+        trace_open_file(trace_file);
+    }
+#endif
+
 #if DEBUG_USE_MESSAGE_BUFFER
     pthread_mutex_init(&mb_flush_lock, NULL);
     pthread_mutex_init(&mb_write_lock, NULL);
@@ -537,10 +728,49 @@ DebugModuleManager::mb_flush()
      */
     DebugModuleManager *m=DebugModuleManager::instance();
     pthread_mutex_lock(&m->mb_flush_lock);
+#if DEBUG_TRACE_SUPPORT
+    // print the messages and the traces in the order they were made.
+    // new buffers are only added at the front, hence the list can be
+    // walked without the lock.
+    TraceBuffer *buffers = m_trace_buffers;
+    SEQLOCK_READ_BARRIER();
+    TraceBuffer *b;
+    unsigned int inbuffer = mb_inbuffer;
+    for (b = buffers; b; b = b->next) {
+        b->flush_head = b->head;
+    }
+    SEQLOCK_READ_BARRIER();
+    while (true) {
+        TraceBuffer *first = NULL;
+        uint64_t first_timestamp = 0;
+        for (b = buffers; b; b = b->next) {
+            if (b->tail == b->flush_head) continue;
+            uint64_t t = b->records[b->tail & (DEBUG_TRACE_BUFFER_RECORDS - 1)].timestamp;
+            if (first == NULL || t < first_timestamp) {
+                first = b;
+                first_timestamp = t;
+            }
+        }
+        if (mb_outbuffer != inbuffer
+            && (first == NULL || mb_timestamps[mb_outbuffer] <= first_timestamp)) {
+            fputs(mb_buffers[mb_outbuffer], stderr);
+            mb_outbuffer = MB_NEXT(mb_outbuffer);
+        } else if (first) {
+            trace_output(&first->records[first->tail & (DEBUG_TRACE_BUFFER_RECORDS - 1)]);
+            // release the record to the owner
+            SEQLOCK_WRITE_BARRIER();
+            first->tail++;
+        } else {
+            break;
+        }
+    }
+    trace_cleanup();
+#else
     while (mb_outbuffer != mb_inbuffer) {
         fputs(mb_buffers[mb_outbuffer], stderr);
         mb_outbuffer = MB_NEXT(mb_outbuffer);
     }
+#endif
     fflush(stderr);
     pthread_mutex_unlock(&m->mb_flush_lock);
 }
@@ -552,7 +782,37 @@ DebugModuleManager::mb_thread_func(void *arg)
     DebugModuleManager *m=static_cast<DebugModuleManager *>(arg);
 
     while (m->mb_initialized) {
+#if DEBUG_TRACE_SUPPORT
+        // the traces don't post the semaphore, poll them while there are
+        // any. otherwise sleep until a message or a trace wakes us up.
+        pthread_mutex_lock(&m->mb_flush_lock);
+        bool poll = m->trace_pending();
+        if (!poll) {
+            m->m_trace_idle = 1;
+            __sync_synchronize();
+            // a trace made before the flag was set doesn't wake us up
+            if (m->trace_pending()
+                && __sync_bool_compare_and_swap(&m->m_trace_idle, 1, 0)) {
+                poll = true;
+            }
+        }
+        pthread_mutex_unlock(&m->mb_flush_lock);
+        if (poll) {
+            struct timespec ts;
+            clock_gettime(CLOCK_REALTIME, &ts);
+            ts.tv_nsec += DEBUG_TRACE_FLUSH_INTERVAL_MSEC * 1000000LL;
+            while (ts.tv_nsec >= 1000000000LL) {
+                ts.tv_nsec -= 1000000000LL;
+                ts.tv_sec++;
+            }
+            sem_timedwait(&m->mb_writes, &ts);
+        } else {
+            sem_wait(&m->mb_writes);
+            m->m_trace_idle = 0;
+        }
+#else
         sem_wait(&m->mb_writes);
+#endif
         m->mb_flush();
     }
 
@@ -560,6 +820,172 @@ DebugModuleManager::mb_thread_func(void *arg)
 }
 #endif
 
+#if DEBUG_TRACE_SUPPORT
+DebugModuleManager::TraceBuffer *
+DebugModuleManager::getTraceBuffer()
+{
+    if (!mb_initialized) {
+        return NULL;
+    }
+    // allocated by registerThread()
+    return static_cast<TraceBuffer *>(pthread_getspecific(m_trace_key));
+}
+
+uint64_t
+DebugModuleManager::trace_timestamp()
+{
+    struct timespec ts;
+    Util::SystemTimeSource::clockGettime(&ts);
+    return (uint64_t)(ts.tv_sec * 1000000LL + ts.tv_nsec / 1000LL);
+}
+
+void
+DebugModuleManager::trace_kick()
+{
+    sem_post(&mb_writes);
+}
+
+void
+DebugModuleManager::trace_buffer_release(void *arg)
+{
+    // the owner thread exits, the buffer is freed once it is drained
+    TraceBuffer *b = static_cast<TraceBuffer *>(arg);
+    b->orphaned = true;
+}
+
+bool
+DebugModuleManager::trace_open_file(const char *name)
+{
+    m_trace_file = fopen(name, "w");
+    if (m_trace_file == NULL) {
+        fprintf(stderr, "Could not open trace file %s: %s\n", name, strerror(errno));
+        return false;
+    }
+    if (fwrite(DEBUG_TRACE_FILE_MAGIC, DEBUG_TRACE_FILE_MAGIC_LENGTH, 1, m_trace_file) != 1) {
+        fprintf(stderr, "Could not write trace file %s\n", name);
+        fclose(m_trace_file);
+        m_trace_file = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool
+DebugModuleManager::trace_write_point(DebugTracePoint &point)
+{
+    uint32_t hdr[4];
+    hdr[0] = DEBUG_TRACE_TAG_POINT;
+    hdr[1] = ++m_trace_nb_points;
+    hdr[2] = point.line;
+    hdr[3] = (point.short_format ? 0x100 : 0) | point.nb_args;
+    if (fwrite(hdr, sizeof(hdr), 1, m_trace_file) != 1
+        || fwrite(point.arg_types, 1, point.nb_args, m_trace_file) != point.nb_args
+        || !trace_write_string(m_trace_file, point.file)
+        || !trace_write_string(m_trace_file, point.function)
+        || !trace_write_string(m_trace_file, point.format)) {
+        return false;
+    }
+    point.id = m_trace_nb_points;
+    return true;
+}
+
+bool
+DebugModuleManager::trace_pending()
+{
+    TraceBuffer *b = m_trace_buffers;
+    SEQLOCK_READ_BARRIER();
+    for (; b; b = b->next) {
+        if (b->head != b->tail) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void
+DebugModuleManager::trace_output(TraceRecord *r)
+{
+    if (m_trace_file) {
+        if (r->point->id == 0 && !trace_write_point(*r->point)) {
+            return;
+        }
+        uint32_t hdr[4];
+        hdr[0] = DEBUG_TRACE_TAG_RECORD;
+        hdr[1] = r->point->id;
+        hdr[2] = r->level;
+        hdr[3] = 0;
+        fwrite(hdr, sizeof(hdr), 1, m_trace_file);
+        fwrite(&r->timestamp, sizeof(r->timestamp), 1, m_trace_file);
+        fwrite(r->args, sizeof(r->args[0]), r->point->nb_args, m_trace_file);
+    } else {
+        char msg[MB_BUFFERSIZE];
+        debugTraceFormat(msg, MB_BUFFERSIZE, *r->point, r->level,
+                         r->timestamp, r->args);
+        fputs(msg, stderr);
+    }
+}
+
+void
+DebugModuleManager::trace_cleanup()
+{
+    if (m_trace_file) {
+        fflush(m_trace_file);
+    }
+
+    // free the drained buffers of the threads that exited
+    bool have_orphans = false;
+    TraceBuffer *b = m_trace_buffers;
+    SEQLOCK_READ_BARRIER();
+    for (; b; b = b->next) {
+        if (b->orphaned) {
+            have_orphans = true;
+        }
+    }
+    if (!have_orphans) {
+        return;
+    }
+    pthread_mutex_lock(&m_trace_lock);
+    TraceBuffer **prev = (TraceBuffer **)&m_trace_buffers;
+    while (*prev) {
+        b = *prev;
+        if (b->orphaned && b->head == b->tail) {
+            m_trace_overruns += b->overruns;
+            *prev = b->next;
+            free(b);
+        } else {
+            prev = &b->next;
+        }
+    }
+    pthread_mutex_unlock(&m_trace_lock);
+}
+#endif
+
+bool
+DebugModuleManager::registerThread()
+{
+#if DEBUG_TRACE_SUPPORT
+    if (!mb_initialized) {
+        return false;
+    }
+    if (pthread_getspecific(m_trace_key)) {
+        return true;
+    }
+    TraceBuffer *b = static_cast<TraceBuffer *>(malloc(sizeof(TraceBuffer)));
+    if (b == NULL) {
+        return false;
+    }
+    // touch the pages now rather than on the first traces
+    memset(b, 0, sizeof(TraceBuffer));
+    pthread_mutex_lock(&m_trace_lock);
+    b->next = m_trace_buffers;
+    SEQLOCK_WRITE_BARRIER();
+    m_trace_buffers = b;
+    pthread_mutex_unlock(&m_trace_lock);
+    pthread_setspecific(m_trace_key, b);
+#endif
+    return true;
+}
+
 #if DEBUG_BACKLOG_SUPPORT
 void
 DebugModuleManager::showBackLog()
@@ -654,6 +1080,9 @@ DebugModuleManager::print(const char *msg)
     while (ntries) { // try a few times
         if (pthread_mutex_trylock(&mb_write_lock) == 0) {
             strncpy(mb_buffers[mb_inbuffer], msg, MB_BUFFERSIZE);
+#if DEBUG_TRACE_SUPPORT
+            mb_timestamps[mb_inbuffer] = trace_timestamp();
+#endif
             mb_inbuffer = MB_NEXT(mb_inbuffer);
             sem_post(&mb_writes);
             pthread_mutex_unlock(&mb_write_lock);
@@ -788,6 +1217,273 @@ DebugModuleManager::getFunctionName(void *ptr, char *buff, int len)
 
 //----------------------------------------
 
+bool
+debugTraceParseFormat( DebugTracePoint &point )
+{
+    unsigned int nb_args = 0;
+    bool binary = true;
+    const char *p = point.format;
+
+    while ( binary && (p = strchr( p, '%' )) ) {
+        p++;
+        if ( *p == '%' ) {
+            p++;
+            continue;
+        }
+        // flags, width and precision
+        while ( *p && strchr( "-+ #0'", *p ) ) p++;
+        while ( *p >= '0' && *p <= '9' ) p++;
+        if ( *p == '.' ) {
+            p++;
+            while ( *p >= '0' && *p <= '9' ) p++;
+        }
+        if ( *p == '*' ) {
+            binary = false;
+            break;
+        }
+        // length modifier
+        int length = 0; // 1 = long, 2 = long long, 3 = size, 4 = long double
+        if ( *p == 'h' ) {
+            p++;
+            if ( *p == 'h' ) p++;
+        } else if ( *p == 'l' ) {
+            p++;
+            length = 1;
+            if ( *p == 'l' ) {
+                p++;
+                length = 2;
+            }
+        } else if ( *p == 'q' || *p == 'j' ) {
+            p++;
+            length = 2;
+        } else if ( *p == 'z' || *p == 'Z' || *p == 't' ) {
+            p++;
+            length = 3;
+        } else if ( *p == 'L' ) {
+            p++;
+            length = 4;
+        }
+
+        unsigned char type;
+        switch ( *p ) {
+            case 'd': case 'i': case 'o': case 'u':
+            case 'x': case 'X': case 'c':
+                if ( length == 4 ) {
+                    binary = false;
+                }
+                type = ( length == 1 ? DebugTracePoint::eAT_Long :
+                         length == 2 ? DebugTracePoint::eAT_LongLong :
+                         length == 3 ? DebugTracePoint::eAT_Size :
+                                       DebugTracePoint::eAT_Int );
+                break;
+            case 'e': case 'E': case 'f': case 'F':
+            case 'g': case 'G': case 'a': case 'A':
+                if ( length == 4 ) {
+                    binary = false;
+                }
+                type = DebugTracePoint::eAT_Double;
+                break;
+            case 'p':
+                type = DebugTracePoint::eAT_Pointer;
+                break;
+            default:
+                // strings have to be copied, the rest is rare
+                binary = false;
+                type = 0;
+                break;
+        }
+        if ( !binary || nb_args == DEBUG_TRACE_MAX_ARGS ) {
+            binary = false;
+            break;
+        }
+        point.arg_types[nb_args++] = type;
+        p++;
+    }
+
+    point.nb_args = nb_args;
+    // concurrent parsers write the same values, make sure
+    // the state is the last thing that is visible
+    __sync_synchronize();
+    point.state = ( binary ? DebugTracePoint::eS_Binary : DebugTracePoint::eS_Text );
+    return binary;
+}
+
+int
+debugTraceFormat( char *msg, size_t size,
+                  const DebugTracePoint &point,
+                  debug_level_t level,
+                  uint64_t timestamp,
+                  const uint64_t *args )
+{
+    size_t chars_written = 0;
+    int retval;
+
+    if ( !point.short_format ) {
+        // remove the path info from the filename
+        const char *fname = strrchr( point.file, '/' );
+        fname = ( fname ? fname + 1 : point.file );
+        retval = snprintf( msg, size, "%011"PRIu64": %s (%s)[%4u] %s: ",
+                           timestamp, DebugModule::getPreSequence( level ),
+                           fname, point.line, point.function );
+        if ( retval > 0 ) chars_written += retval;
+    }
+
+    // format the conversions one by one
+    const char *p = point.format;
+    unsigned int arg = 0;
+    while ( *p && chars_written < size ) {
+        const char *conv = strchr( p, '%' );
+        size_t len = ( conv ? (size_t)(conv - p) : strlen( p ) );
+        if ( len ) {
+            retval = snprintf( msg + chars_written, size - chars_written,
+                               "%.*s", (int)len, p );
+            if ( retval > 0 ) chars_written += retval;
+            p += len;
+            continue;
+        }
+        // p points to a conversion, find its end
+        const char *end = p + 1;
+        if ( *end == '%' ) {
+            retval = snprintf( msg + chars_written, size - chars_written, "%%" );
+            if ( retval > 0 ) chars_written += retval;
+            p = end + 1;
+            continue;
+        }
+        while ( *end && !strchr( "diouxXceEfFgGaAp", *end ) ) end++;
+        if ( *end == 0 || arg >= point.nb_args ) {
+            break;
+        }
+        char spec[32];
+        len = end - p + 1;
+        if ( len >= sizeof(spec) ) {
+            break;
+        }
+        memcpy( spec, p, len );
+        spec[len] = 0;
+
+        size_t left = size - chars_written;
+        char *out = msg + chars_written;
+        uint64_t a = args[arg];
+        switch ( point.arg_types[arg] ) {
+            case DebugTracePoint::eAT_Int:
+                retval = snprintf( out, left, spec, (int)a );
+                break;
+            case DebugTracePoint::eAT_Long:
+                retval = snprintf( out, left, spec, (long)a );
+                break;
+            case DebugTracePoint::eAT_LongLong:
+                retval = snprintf( out, left, spec, (long long)a );
+                break;
+            case DebugTracePoint::eAT_Size:
+                retval = snprintf( out, left, spec, (size_t)a );
+                break;
+            case DebugTracePoint::eAT_Double: {
+                double d;
+                memcpy( &d, &a, sizeof(d) );
+                retval = snprintf( out, left, spec, d );
+                break;
+            }
+            case DebugTracePoint::eAT_Pointer:
+                retval = snprintf( out, left, spec, (void *)(uintptr_t)a );
+                break;
+            default:
+                retval = 0;
+                break;
+        }
+        if ( retval > 0 ) chars_written += retval;
+        arg++;
+        p = end + 1;
+    }
+
+    if ( !point.short_format && chars_written < size ) {
+        retval = snprintf( msg + chars_written, size - chars_written,
+                           "%s", DebugModule::getPostSequence( level ) );
+        if ( retval > 0 ) chars_written += retval;
+    }
+    if ( chars_written >= size ) {
+        chars_written = size - 1;
+    }
+    msg[chars_written] = 0;
+    return chars_written;
+}
+
+// a trace point read from a trace file
+struct DebugTraceFilePoint {
+    DebugTracePoint point;
+    std::string file;
+    std::string function;
+    std::string format;
+};
+
+bool
+debugTraceDecode( FILE *in, FILE *out )
+{
+    typedef DebugTraceFilePoint Point;
+    std::vector<Point *> points;
+    bool retval = true;
+
+    char magic[DEBUG_TRACE_FILE_MAGIC_LENGTH];
+    if ( fread( magic, DEBUG_TRACE_FILE_MAGIC_LENGTH, 1, in ) != 1
+         || memcmp( magic, DEBUG_TRACE_FILE_MAGIC, DEBUG_TRACE_FILE_MAGIC_LENGTH ) != 0 ) {
+        fprintf( stderr, "Not an FFADO trace file\n" );
+        return false;
+    }
+
+    uint32_t hdr[4];
+    while ( fread( hdr, sizeof(hdr), 1, in ) == 1 ) {
+        if ( hdr[0] == DEBUG_TRACE_TAG_POINT ) {
+            Point *p = new Point;
+            memset( &p->point, 0, sizeof(p->point) );
+            p->point.line = hdr[2];
+            p->point.short_format = ( hdr[3] & 0x100 ) != 0;
+            p->point.nb_args = hdr[3] & 0xFF;
+            p->point.state = DebugTracePoint::eS_Binary;
+            p->point.id = hdr[1];
+            if ( hdr[1] != points.size() + 1
+                 || p->point.nb_args > DEBUG_TRACE_MAX_ARGS
+                 || fread( p->point.arg_types, 1, p->point.nb_args, in ) != p->point.nb_args
+                 || !trace_read_string( in, p->file )
+                 || !trace_read_string( in, p->function )
+                 || !trace_read_string( in, p->format ) ) {
+                delete p;
+                retval = false;
+                break;
+            }
+            p->point.file = p->file.c_str();
+            p->point.function = p->function.c_str();
+            p->point.format = p->format.c_str();
+            points.push_back( p );
+        } else if ( hdr[0] == DEBUG_TRACE_TAG_RECORD ) {
+            if ( hdr[1] == 0 || hdr[1] > points.size() ) {
+                retval = false;
+                break;
+            }
+            DebugTracePoint &point = points.at( hdr[1] - 1 )->point;
+            uint64_t timestamp;
+            uint64_t args[DEBUG_TRACE_MAX_ARGS];
+            if ( fread( &timestamp, sizeof(timestamp), 1, in ) != 1
+                 || fread( args, sizeof(args[0]), point.nb_args, in ) != point.nb_args ) {
+                retval = false;
+                break;
+            }
+            char msg[MB_BUFFERSIZE];
+            debugTraceFormat( msg, MB_BUFFERSIZE, point, hdr[2], timestamp, args );
+            fputs( msg, out );
+        } else {
+            retval = false;
+            break;
+        }
+    }
+    if ( !retval ) {
+        fprintf( stderr, "Corrupt trace file\n" );
+    }
+
+    for ( unsigned int i = 0; i < points.size(); i++ ) {
+        delete points.at( i );
+    }
+    return retval;
+}
+
 unsigned char
 toAscii( unsigned char c )
 {
@@ -34,7 +34,9 @@
 #include <vector>
 #include <iostream>
 #include <stdint.h>
+#include <stdarg.h>
 #include <semaphore.h>
+#include <pthread.h>
 
 #define FFADO_ASSERT(x) { \
     if(!(x)) { \
@@ -76,6 +78,12 @@ typedef short debug_level_t;
     #define DEBUG_BACKLOG_SUPPORT 0
 #endif
 
+// the trace buffers are drained by the message buffer thread
+#if !DEBUG_USE_MESSAGE_BUFFER
+    #undef DEBUG_TRACE_SUPPORT
+    #define DEBUG_TRACE_SUPPORT 0
+#endif
+
 // the backlog is a similar buffer as the message buffer
 #define DEBUG_BACKLOG_MB_NEXT(index)  (((index)+1) & (DEBUG_BACKLOG_MB_BUFFERS-1))
 #define DEBUG_BACKLOG_MIN_LEVEL       DEBUG_LEVEL_VERY_VERBOSE
@@ -159,6 +167,51 @@ typedef short debug_level_t;
                                      Level ); \
                 }*/
 
+/*
+ * Binary traces
+ *
+ * debugTrace() is a debugOutput() that is cheap enough for the RT paths:
+ * when the format only has numeric conversions, the arguments are stored
+ * in a lock-free per-thread buffer and formatted later, by the message
+ * buffer thread or by ffado-trace-decode. Other formats are printed
+ * right away, like debugOutput() does.
+ *
+ * The buffer of a thread is allocated by DebugModuleManager::registerThread(),
+ * the Util::PosixThread's do so when they start, the client threads through
+ * ffado_streaming_register_thread(). The traces of a thread that didn't
+ * register are printed right away too.
+ *
+ * The format has to be a string literal.
+ */
+#if DEBUG_TRACE_SUPPORT
+    // the dead printShort() call lets the compiler check the format
+    #define debugTraceInternal( short_format, level, format, args... )  \
+        do {                                                            \
+            static DebugTracePoint __trace_point =                      \
+                { __FILE__, __FUNCTION__, __LINE__, format,             \
+                  short_format, DebugTracePoint::eS_Unparsed, 0, {0}, 0 }; \
+            if ( 0 ) m_debugModule.printShort( level, format, ##args ); \
+            m_debugModule.trace( level, &__trace_point, ##args );       \
+        } while ( 0 )
+
+    #define debugTrace( level, format, args... )                        \
+                debugTraceInternal( false, level, format, ##args )
+    #define debugTraceShort( level, format, args... )                   \
+                debugTraceInternal( true, level, format, ##args )
+#else
+    #define debugTrace( level, format, args... )                        \
+                m_debugModule.print( level,                             \
+                                     __FILE__,                          \
+                                     __FUNCTION__,                      \
+                                     __LINE__,                          \
+                                     format,                            \
+                                     ##args )
+    #define debugTraceShort( level, format, args... )                   \
+                m_debugModule.printShort( level,                        \
+                                     format,                            \
+                                     ##args )
+#endif
+
 #define getDebugLevel(  )                                     \
                 m_debugModule.getLevel( )
 
@@ -207,7 +260,13 @@ typedef short debug_level_t;
                                      ##args )
     #define DEBUG_NORMAL( x ) x;
 
-    #if DEBUG_EXTREME_ENABLE
+    #if DEBUG_EXTREME_ENABLE && DEBUG_TRACE_SUPPORT
+        #define debugOutputExtreme( level, format, args... )           \
+                    debugTrace( level, format, ##args )
+        #define debugOutputShortExtreme( level, format, args... )      \
+                    debugTraceShort( level, format, ##args )
+        #define DEBUG_EXTREME( x ) x;
+    #elif DEBUG_EXTREME_ENABLE
         #define debugOutputExtreme( level, format, args... )           \
                     m_debugModule.print( level,                        \
                                         __FILE__,                     \
@@ -284,6 +343,58 @@ void hexDumpQuadlets( quadlet_t *data_start, unsigned int length );
 
 class DebugModuleManager;
 
+/**
+ * @brief The static description of a debugTrace() call
+ */
+struct DebugTracePoint
+{
+    enum EState {
+        eS_Unparsed = 0,
+        eS_Binary,      ///< the arguments can be stored in the trace buffer
+        eS_Text,        ///< the message has to be formatted right away
+    };
+    enum EArgType {
+        eAT_Int = 0,
+        eAT_Long,
+        eAT_LongLong,
+        eAT_Size,
+        eAT_Double,
+        eAT_Pointer,
+    };
+
+    const char*     file;
+    const char*     function;
+    unsigned int    line;
+    const char*     format;
+    bool            short_format;
+    volatile int    state;
+    unsigned int    nb_args;
+    unsigned char   arg_types[DEBUG_TRACE_MAX_ARGS];
+    ///> the id in the trace file, 0 if not written yet
+    unsigned int    id;
+};
+
+/**
+ * @brief parse the format of a trace point
+ * @return true if the arguments can be stored in a trace buffer
+ */
+bool debugTraceParseFormat( DebugTracePoint &point );
+
+/**
+ * @brief format a trace the way DebugModule::print() would
+ * @return the number of characters written
+ */
+int debugTraceFormat( char *msg, size_t size,
+                      const DebugTracePoint &point,
+                      debug_level_t level,
+                      uint64_t timestamp,
+                      const uint64_t *args );
+
+/**
+ * @brief decode a trace file written by the DebugModuleManager
+ */
+bool debugTraceDecode( FILE *in, FILE *out );
+
 class DebugModule {
 public:
     friend class DebugModuleManager;
@@ -322,6 +433,10 @@ public:
 #endif
             ;
 
+    void trace( debug_level_t level,
+                DebugTracePoint *point,
+                ... ) const;
+
     bool setLevel( debug_level_t level )
         { m_level = level; return true; }
     debug_level_t getLevel()
@@ -329,9 +444,19 @@ public:
     std::string getName()
         { return m_name; }
 
+    static const char* getPreSequence( debug_level_t level );
+    static const char* getPostSequence( debug_level_t level );
+
 protected:
-    const char* getPreSequence( debug_level_t level ) const;
-    const char* getPostSequence( debug_level_t level ) const;
+    void vprintShort( debug_level_t level,
+                      const char* format,
+                      va_list arg ) const;
+    void vprint( debug_level_t level,
+                 const char*   file,
+                 const char*   function,
+                 unsigned int  line,
+                 const char*   format,
+                 va_list       arg ) const;
 
 private:
     std::string   m_name;
@@ -351,6 +476,15 @@ public:
 
     void flush();
 
+    /**
+     * @brief allocate the trace buffer of the calling thread
+     *
+     * To be called before the thread enters its RT loop, the traces of
+     * a thread without buffer are formatted right away.
+     * @return false if the buffer could not be allocated
+     */
+    bool registerThread();
+
 #if DEBUG_BACKLOG_SUPPORT
     // the backlog is a ringbuffer of all the messages
     // that have been recorded using the debugPrint
@@ -380,6 +514,31 @@ protected:
     void backlog_print(const char *msg);
 #endif
 
+#if DEBUG_TRACE_SUPPORT
+    struct TraceRecord {
+        DebugTracePoint*    point;
+        uint64_t            timestamp;
+        debug_level_t       level;
+        uint64_t            args[DEBUG_TRACE_MAX_ARGS];
+    };
+    // single producer (the owner thread), single consumer (the
+    // message buffer thread). head and tail are free-running.
+    struct TraceBuffer {
+        TraceRecord             records[DEBUG_TRACE_BUFFER_RECORDS];
+        volatile unsigned int   head;
+        volatile unsigned int   tail;
+        volatile unsigned int   overruns;
+        volatile bool           orphaned;
+        ///> the head up to which mb_flush() drains the buffer
+        unsigned int            flush_head;
+        TraceBuffer*            next;
+    };
+
+    ///> the trace buffer of the calling thread, NULL if not available
+    TraceBuffer* getTraceBuffer();
+    void trace_kick();
+#endif
+
 private:
     DebugModuleManager();
 
@@ -397,6 +556,10 @@ private:
     pthread_mutex_t mb_write_lock;
     pthread_mutex_t mb_flush_lock;
     sem_t        mb_writes;
+#if DEBUG_TRACE_SUPPORT
+    // the time of the messages, to print them in order with the traces
+    uint64_t mb_timestamps[DEBUG_MB_BUFFERS];
+#endif
 #endif
 
 #if DEBUG_BACKTRACE_SUPPORT
@@ -410,6 +573,27 @@ private:
     static void *mb_thread_func(void *arg);
     void mb_flush();
 
+#if DEBUG_TRACE_SUPPORT
+    static void trace_buffer_release(void *arg);
+    static uint64_t trace_timestamp();
+    // called with the mb_flush_lock held
+    bool trace_pending();
+    void trace_output(TraceRecord *r);
+    void trace_cleanup();
+    // the traces go to this file instead of stderr if FFADO_TRACE_FILE is set
+    bool trace_open_file(const char *name);
+    bool trace_write_point(DebugTracePoint &point);
+
+    pthread_key_t           m_trace_key;
+    pthread_mutex_t         m_trace_lock;
+    TraceBuffer* volatile   m_trace_buffers;
+    FILE*                   m_trace_file;
+    unsigned int            m_trace_nb_points;
+    unsigned int            m_trace_overruns;
+    // set while the message buffer thread waits without timeout
+    volatile int            m_trace_idle;
+#endif
+
 #if DEBUG_BACKLOG_SUPPORT
     // the backlog
     char bl_mb_buffers[DEBUG_BACKLOG_MB_BUFFERS][MB_BUFFERSIZE];
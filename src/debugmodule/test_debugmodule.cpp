@@ -25,6 +25,7 @@
 #include "debugmodule.h"
 
 #include <iostream>
+#include <string.h>
 
 using namespace std;
 
@@ -69,7 +70,49 @@ public:
         }
         cout << endl << endl;
 
-        return true;
+        cout << "###################" << endl;
+        cout << "### Test traces ###" << endl;
+        cout << "###################" << endl;
+        DebugModuleManager::instance()->setMgrDebugLevel( "Test", DEBUG_LEVEL_VERBOSE );
+        DebugModuleManager::instance()->registerThread();
+        debugTrace( DEBUG_LEVEL_NORMAL, "trace %d 0x%08X %"PRIu64" %zd %5.2f %p %%\n",
+                    -1, 0xdeadbeef, (uint64_t)1 << 40, (ssize_t)-4, 3.14159, (void *)this );
+        debugTraceShort( DEBUG_LEVEL_NORMAL, "short trace %d\n", 5 );
+        debugTrace( DEBUG_LEVEL_NORMAL, "string trace %s\n", "is printed right away" );
+        debugTrace( DEBUG_LEVEL_VERY_VERBOSE, "this trace is not shown\n" );
+        flushDebugOutput();
+
+        // the deferred formatting has to match printf
+        bool ok = true;
+        DebugTracePoint point = { "", "", 0, "%5d|%-4x|%lld|%zu|%.3e|%%|%c",
+                                  true, DebugTracePoint::eS_Unparsed, 0, {0}, 0 };
+        if ( !debugTraceParseFormat( point ) || point.nb_args != 6 ) {
+            ok = false;
+        } else {
+            double d = -1.5e-3;
+            uint64_t args[DEBUG_TRACE_MAX_ARGS];
+            args[0] = (int64_t)-7;
+            args[1] = 0xab;
+            args[2] = (int64_t)-123456789012LL;
+            args[3] = 99;
+            memcpy( &args[4], &d, sizeof(d) );
+            args[5] = 'z';
+            char trace_msg[256], printf_msg[256];
+            debugTraceFormat( trace_msg, sizeof(trace_msg), point, DEBUG_LEVEL_NORMAL, 0, args );
+            snprintf( printf_msg, sizeof(printf_msg), point.format,
+                      -7, 0xabU, -123456789012LL, (size_t)99, d, 'z' );
+            ok = ( strcmp( trace_msg, printf_msg ) == 0 );
+            cout << trace_msg << endl;
+        }
+        DebugTracePoint string_point = { "", "", 0, "%d %s", true,
+                                         DebugTracePoint::eS_Unparsed, 0, {0}, 0 };
+        if ( debugTraceParseFormat( string_point ) ) {
+            ok = false;
+        }
+        cout << "trace formatting " << ( ok ? "OK" : "FAILED" ) << endl;
+        cout << endl << endl;
+
+        return ok;
     }
 
     DECLARE_DEBUG_MODULE;
@@ -89,7 +132,9 @@ int main( int argc, char** argv )
     cout << endl << endl;
 
     Test test;
-    test.run();
+    if ( !test.run() ) {
+        return 1;
+    }
 
     return 0;
 }
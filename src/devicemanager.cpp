@@ -28,10 +28,12 @@
 #include "devicemanager.h"
 #include "ffadodevice.h"
 #include "DeviceStringParser.h"
+#include "meterservice.h"
 
 #include "libieee1394/configrom.h"
 #include "libieee1394/ieee1394service.h"
 #include "libieee1394/IsoHandlerManager.h"
+#include "libieee1394/SimulatedBus.h"
 
 #include "libstreaming/generic/StreamProcessor.h"
 #include "libstreaming/StreamProcessorManager.h"
@@ -56,11 +58,18 @@
     #include "oxford/oxford_device.h"
 #endif
 
-#ifdef ENABLE_BOUNCE
+#if defined(ENABLE_BOUNCE) || defined(ENABLE_SIMULATED_BUS)
 #include "bounce/bounce_avdevice.h"
+#endif
+
+#ifdef ENABLE_BOUNCE
 #include "bounce/bounce_slave_avdevice.h"
 #endif
 
+#ifdef ENABLE_SIMULATED_BUS
+#include "bounce/bounce_simulated_device.h"
+#endif
+
 #ifdef ENABLE_MOTU
 #include "motu/motu_avdevice.h"
 #endif
@@ -81,6 +90,7 @@
 #include <sstream>
 
 #include <algorithm>
+#include <set>
 
 using namespace std;
 
@@ -93,6 +103,8 @@ DeviceManager::DeviceManager()
     , m_processorManager( new Streaming::StreamProcessorManager( *this ) )
     , m_deviceStringParser( new DeviceStringParser() )
     , m_configuration ( new Util::Configuration() )
+    , m_meterService( NULL )
+    , m_meter_rate( 0 )
     , m_used_cache_last_time( false )
     , m_thread_realtime( false )
     , m_thread_priority( 0 )
@@ -108,6 +120,12 @@ DeviceManager::~DeviceManager()
         debugWarning("could not save configuration\n");
     }
 
+    // stop polling the devices before they go away
+    if (m_meterService) {
+        delete m_meterService;
+        m_meterService = NULL;
+    }
+
     m_BusResetLock->Lock(); // make sure we are not handling a busreset.
     m_DeviceListLock->Lock(); // make sure nobody is using this
     for ( FFADODeviceVectorIterator it = m_avDevices.begin();
@@ -178,7 +196,22 @@ DeviceManager::initialize()
     m_configuration->openFile( USER_CONFIG_FILE, Util::Configuration::eFM_ReadWrite );
     m_configuration->openFile( SYSTEM_CONFIG_FILE, Util::Configuration::eFM_ReadOnly );
 
-    int nb_detected_ports = Ieee1394Service::detectNbPorts();
+    int simulated_ports = IEEE1394SERVICE_SIMULATED_BUS;
+    m_configuration->getValueForSetting("ieee1394.simulated_bus", simulated_ports);
+#ifndef ENABLE_SIMULATED_BUS
+    if (simulated_ports > 0) {
+        debugWarning( "This build has no simulated bus support, using the real hardware\n" );
+        simulated_ports = 0;
+    }
+#endif
+
+    int nb_detected_ports;
+    if (simulated_ports > 0) {
+        debugOutput( DEBUG_LEVEL_NORMAL, "Using %d simulated firewire adapters (ports)\n", simulated_ports);
+        nb_detected_ports = simulated_ports;
+    } else {
+        nb_detected_ports = Ieee1394Service::detectNbPorts();
+    }
     if (nb_detected_ports < 0) {
         debugFatal("Failed to detect the number of 1394 adapters. Is the IEEE1394 stack loaded (raw1394)?\n");
         return false;
@@ -206,6 +239,9 @@ DeviceManager::initialize()
             debugFatal( "Could not initialize Ieee1349Service object for port %d\n", port );
             return false;
         }
+        if ( tmp1394Service->getSimulatedBus() ) {
+            addSimulatedDevices( *tmp1394Service->getSimulatedBus() );
+        }
         // add the bus reset handler
         Util::Functor* tmp_busreset_functor = new Util::MemberFunctor1< DeviceManager*,
                     void (DeviceManager::*)(Ieee1394Service &), Ieee1394Service & >
@@ -222,6 +258,34 @@ DeviceManager::initialize()
     return true;
 }
 
+/**
+ * Puts the simulated devices on a simulated bus. The bus lives as long
+ * as the process, so the devices are only added once.
+ */
+void
+DeviceManager::addSimulatedDevices(SimulatedBus &bus)
+{
+    if (bus.getNodeCount() > 1) {
+        return;
+    }
+    int nb_bounce_devices = IEEE1394SERVICE_SIMULATED_BUS_BOUNCE_DEVICES;
+    m_configuration->getValueForSetting("ieee1394.simulated_bus_bounce_devices", nb_bounce_devices);
+#ifdef ENABLE_SIMULATED_BUS
+    for (int i = 0; i < nb_bounce_devices; i++) {
+        Bounce::SimulatedDevice *device = new Bounce::SimulatedDevice( (bus.getPort() << 16) | i );
+        device->setVerboseLevel( getDebugLevel() );
+        if ( bus.addNode( device ) < 0 ) {
+            debugWarning( "Could not add simulated bounce device %d to port %d\n", i, bus.getPort() );
+            delete device;
+        }
+    }
+#else
+    if (nb_bounce_devices > 0) {
+        debugWarning( "This build has no simulated bus support, the simulated bus has no devices\n" );
+    }
+#endif
+}
+
 bool
 DeviceManager::addSpecString(char *s) {
     std::string spec = s;
@@ -263,6 +327,8 @@ DeviceManager::busresetHandler(Ieee1394Service &service)
                         "issue busreset on device GUID %s\n",
                         (*it)->getConfigRom().getGuidString().c_str());
             (*it)->handleBusReset();
+            // the device might have lost its settings
+            (*it)->invalidateValues();
         } else {
             debugOutput(DEBUG_LEVEL_NORMAL,
                         "skipping device GUID %s since not on service %p\n",
@@ -405,6 +471,11 @@ DeviceManager::discover( bool useCache, bool rediscover )
 
     // notify that we are going to manipulate the list
     signalNotifiers(m_preUpdateNotifiers);
+    // the meter service polls the devices, restart it with the new list
+    bool restart_metering = m_meterService && m_meterService->isRunning();
+    if (restart_metering) {
+        m_meterService->stop();
+    }
     m_DeviceListLock->Lock(); // make sure nobody starts using the list
     if(rediscover) {
 
@@ -543,7 +614,18 @@ DeviceManager::discover( bool useCache, bool rediscover )
         }
         m_avDevices = to_keep;
 
-        // pick up new devices
+        // pick up new devices. Every node is probed and discovered by
+        // a DiscoveryJob, these run in parallel if so configured.
+        // A device that is reachable through more than one port gets
+        // only one job, as do the devices we already have.
+        DiscoveryJobVector jobs;
+        std::set<fb_octlet_t> guids;
+        for ( FFADODeviceVectorIterator it_dev = m_avDevices.begin();
+            it_dev != m_avDevices.end();
+            ++it_dev )
+        {
+            guids.insert( (*it_dev)->getConfigRom().getGuid() );
+        }
         for ( Ieee1394ServiceVectorIterator it = m_1394Services.begin();
             it != m_1394Services.end();
             ++it )
@@ -553,109 +635,76 @@ DeviceManager::discover( bool useCache, bool rediscover )
                 nodeId < portService->getNodeCount();
                 ++nodeId )
             {
-                debugOutput( DEBUG_LEVEL_VERBOSE, "Probing node %d...\n", nodeId );
-    
                 if (nodeId == portService->getLocalNodeId()) {
                     debugOutput( DEBUG_LEVEL_VERBOSE, "Skipping local node (%d)...\n", nodeId );
                     continue;
                 }
-    
-                ConfigRom *configRom = new ConfigRom( *portService, nodeId );
-                if ( !configRom->initialize() ) {
-                    // \todo If a PHY on the bus is in power safe mode then
-                    // the config rom is missing. So this might be just
-                    // such this case and we can safely skip it. But it might
-                    // be there is a real software problem on our side.
-                    // This should be handlede more carefuly.
-                    debugOutput( DEBUG_LEVEL_NORMAL,
-                                "Could not read config rom from device (node id %d). "
-                                "Skip device discovering for this node\n",
-                                nodeId );
+                // the job reads the config rom itself when the GUID is unknown
+                fb_octlet_t guid;
+                if ( portService->getGuidForNodeId( nodeId, guid )
+                     && !guids.insert( guid ).second ) {
+                    debugOutput( DEBUG_LEVEL_VERBOSE,
+                                 "Skipping node %d on port %d, GUID 0x%016"PRIX64" is already known...\n",
+                                 nodeId, portService->getPort(), guid );
                     continue;
                 }
+                jobs.push_back( new DiscoveryJob( *this, *portService, nodeId,
+                                                  useCache, snoopMode ) );
+            }
+        }
 
-                bool already_in_vector = false;
-                for ( FFADODeviceVectorIterator it_dev = m_avDevices.begin();
-                    it_dev != m_avDevices.end();
-                    ++it_dev )
-                {
-                    if ((*it_dev)->getConfigRom().getGuid() == configRom->getGuid()) {
-                        already_in_vector = true;
-                        break;
-                    }
-                }
-                if(already_in_vector) {
-                    if(!rediscover) {
-                        debugWarning("Device with GUID %s already discovered on other port, skipping device...\n",
-                                    configRom->getGuidString().c_str());
-                    }
-                    continue;
-                }
+        ffado_microsecs_t discovery_start = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+        unsigned int nb_threads = runDiscoveryJobs(jobs);
+        ffado_microsecs_t discovery_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs() - discovery_start;
 
-                if(getDebugLevel() >= DEBUG_LEVEL_VERBOSE) {
-                    configRom->printConfigRomDebug();
-                }
+        // add the devices in port/node order, such that the result
+        // doesn't depend on the order in which the jobs finished
+        for ( DiscoveryJobVector::iterator it = jobs.begin();
+            it != jobs.end();
+            ++it )
+        {
+            DiscoveryJob *job = *it;
+            FFADODevice* avDevice = job->m_device;
+            if ( avDevice == NULL ) {
+                continue;
+            }
+            job->m_device = NULL;
 
-                // if spec strings are given, only add those devices
-                // that match the spec string(s).
-                // if no (valid) spec strings are present, grab all
-                // supported devices.
-                if(m_deviceStringParser->countDeviceStrings() &&
-                  !m_deviceStringParser->match(*configRom)) {
-                    debugOutput(DEBUG_LEVEL_VERBOSE, "Device doesn't match any of the spec strings. skipping...\n");
-                    continue;
+            // the same device can be reachable through more than one port
+            bool already_in_vector = false;
+            for ( FFADODeviceVectorIterator it_dev = m_avDevices.begin();
+                it_dev != m_avDevices.end();
+                ++it_dev )
+            {
+                if ((*it_dev)->getConfigRom().getGuid() == job->m_guid) {
+                    already_in_vector = true;
+                    break;
                 }
+            }
+            if(already_in_vector) {
+                debugWarning("Device with GUID %s already discovered on other port, skipping device...\n",
+                            avDevice->getConfigRom().getGuidString().c_str());
+                job->m_result = DiscoveryJob::eDR_Known;
+                delete avDevice;
+                continue;
+            }
 
-                // find a driver
-                FFADODevice* avDevice = getDriverForDevice( configRom,
-                                                            nodeId );
-
-                if ( avDevice ) {
-                    debugOutput( DEBUG_LEVEL_NORMAL,
-                                "driver found for device %d\n",
-                                nodeId );
-
-                    avDevice->setVerboseLevel( getDebugLevel() );
-                    bool isFromCache = false;
-                    if ( useCache && avDevice->loadFromCache() ) {
-                        debugOutput( DEBUG_LEVEL_VERBOSE, "could load from cache\n" );
-                        isFromCache = true;
-                        // restore the debug level for everything that was loaded
-                        avDevice->setVerboseLevel( getDebugLevel() );
-                    } else if ( avDevice->discover() ) {
-                        debugOutput( DEBUG_LEVEL_VERBOSE, "discovery successful\n" );
-                    } else {
-                        debugError( "could not discover device\n" );
-                        delete avDevice;
-                        continue;
-                    }
-
-                    if (snoopMode) {
-                        debugOutput( DEBUG_LEVEL_VERBOSE,
-                                    "Enabling snoop mode on node %d...\n", nodeId );
-
-                        if(!avDevice->setOption("snoopMode", snoopMode)) {
-                            debugWarning("Could not set snoop mode for device on node %d\n", nodeId);
-                            delete avDevice;
-                            continue;
-                        }
-                    }
+            m_avDevices.push_back( avDevice );
 
-                    if ( !isFromCache && !avDevice->saveCache() ) {
-                        debugOutput( DEBUG_LEVEL_VERBOSE, "No cached version of AVC model created\n" );
-                    }
-                    m_avDevices.push_back( avDevice );
+            if (!addElement(avDevice)) {
+                debugWarning("failed to add Device to Control::Container\n");
+            }
 
-                    if (!addElement(avDevice)) {
-                        debugWarning("failed to add Device to Control::Container\n");
-                    }
+            debugOutput( DEBUG_LEVEL_NORMAL, "discovery of node %d on port %d done...\n",
+                         job->m_nodeId, job->m_service.getPort() );
+        }
 
-                    debugOutput( DEBUG_LEVEL_NORMAL, "discovery of node %d on port %d done...\n", nodeId, portService->getPort() );
-                } else {
-                    // we didn't get a device, hence we have to delete the configrom ptr manually
-                    delete configRom;
-                }
-            }
+        showDiscoveryReport(jobs, nb_threads, discovery_usecs);
+        for ( DiscoveryJobVector::iterator it = jobs.begin();
+            it != jobs.end();
+            ++it )
+        {
+            delete *it;
         }
 
         debugOutput( DEBUG_LEVEL_NORMAL, "Discovery finished...\n" );
@@ -763,12 +812,46 @@ DeviceManager::discover( bool useCache, bool rediscover )
         debugOutput( DEBUG_LEVEL_NORMAL, "discovery finished...\n" );
     }
 
+    if (restart_metering && !m_meterService->start(m_avDevices, m_meter_rate)) {
+        debugWarning("Could not restart the meter service\n");
+    }
     m_DeviceListLock->Unlock();
     // notify any clients
     signalNotifiers(m_postUpdateNotifiers);
     return true;
 }
 
+bool
+DeviceManager::startMetering(unsigned int rate_hz)
+{
+    if (rate_hz == 0) {
+        int rate = METERSERVICE_RATE_HZ;
+        getConfiguration().getValueForSetting("device_manager.meter_rate_hz", rate);
+        if (rate <= 0) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "Metering disabled by the configuration\n");
+            return true;
+        }
+        rate_hz = rate;
+    }
+    if (m_meterService == NULL) {
+        m_meterService = new MeterService();
+        m_meterService->setVerboseLevel(getDebugLevel());
+    }
+    m_meterService->stop();
+    m_meter_rate = rate_hz;
+
+    Util::MutexLockHelper lock(*m_DeviceListLock);
+    return m_meterService->start(m_avDevices, m_meter_rate);
+}
+
+void
+DeviceManager::stopMetering()
+{
+    if (m_meterService) {
+        m_meterService->stop();
+    }
+}
+
 bool
 DeviceManager::initStreaming()
 {
@@ -1024,6 +1107,213 @@ DeviceManager::setStreamingParams(unsigned int period, unsigned int rate, unsign
     return true;
 }
 
+DeviceManager::DiscoveryJob::DiscoveryJob(DeviceManager &parent, Ieee1394Service &service,
+                                          fb_nodeid_t nodeId, bool useCache, bool snoopMode)
+    : m_service( service )
+    , m_nodeId( nodeId )
+    , m_result( eDR_NoConfigRom )
+    , m_device( NULL )
+    , m_guid( 0 )
+    , m_configrom_usecs( 0 )
+    , m_probe_usecs( 0 )
+    , m_discover_usecs( 0 )
+    , m_parent( parent )
+    , m_useCache( useCache )
+    , m_snoopMode( snoopMode )
+{
+}
+
+DeviceManager::DiscoveryJob::~DiscoveryJob()
+{
+    delete m_device;
+}
+
+void
+DeviceManager::DiscoveryJob::run()
+{
+    debugOutput( DEBUG_LEVEL_VERBOSE, "Probing node %d on port %d...\n",
+                 m_nodeId, m_service.getPort() );
+
+    ffado_microsecs_t start = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    ConfigRom *configRom = new ConfigRom( m_service, m_nodeId );
+    bool configRomValid = configRom->initialize();
+    m_configrom_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs() - start;
+    if ( !configRomValid ) {
+        // \todo If a PHY on the bus is in power safe mode then
+        // the config rom is missing. So this might be just
+        // such this case and we can safely skip it. But it might
+        // be there is a real software problem on our side.
+        // This should be handlede more carefuly.
+        debugOutput( DEBUG_LEVEL_NORMAL,
+                    "Could not read config rom from device (node id %d). "
+                    "Skip device discovering for this node\n",
+                    m_nodeId );
+        delete configRom;
+        m_result = eDR_NoConfigRom;
+        return;
+    }
+    m_guid = configRom->getGuid();
+
+    // the device list isn't modified while the jobs run
+    for ( FFADODeviceVectorIterator it_dev = m_parent.m_avDevices.begin();
+        it_dev != m_parent.m_avDevices.end();
+        ++it_dev )
+    {
+        if ((*it_dev)->getConfigRom().getGuid() == m_guid) {
+            delete configRom;
+            m_result = eDR_Known;
+            return;
+        }
+    }
+
+    if(m_parent.getDebugLevel() >= DEBUG_LEVEL_VERBOSE) {
+        configRom->printConfigRomDebug();
+    }
+
+    // if spec strings are given, only add those devices
+    // that match the spec string(s).
+    // if no (valid) spec strings are present, grab all
+    // supported devices.
+    if(m_parent.m_deviceStringParser->countDeviceStrings() &&
+      !m_parent.m_deviceStringParser->match(*configRom)) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Device doesn't match any of the spec strings. skipping...\n");
+        delete configRom;
+        m_result = eDR_NoMatch;
+        return;
+    }
+
+    // find a driver
+    start = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    FFADODevice* avDevice = m_parent.getDriverForDevice( configRom, m_nodeId );
+    m_probe_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs() - start;
+    if ( avDevice == NULL ) {
+        // we didn't get a device, hence we have to delete the configrom ptr manually
+        delete configRom;
+        m_result = eDR_Unsupported;
+        return;
+    }
+    debugOutput( DEBUG_LEVEL_NORMAL,
+                "driver found for device %d\n",
+                m_nodeId );
+
+    start = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    avDevice->setVerboseLevel( m_parent.getDebugLevel() );
+    bool isFromCache = false;
+    if ( m_useCache && avDevice->loadFromCache() ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "could load from cache\n" );
+        isFromCache = true;
+        // restore the debug level for everything that was loaded
+        avDevice->setVerboseLevel( m_parent.getDebugLevel() );
+    } else if ( avDevice->discover() ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "discovery successful\n" );
+    } else {
+        debugError( "could not discover device\n" );
+        m_discover_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs() - start;
+        delete avDevice;
+        m_result = eDR_Failed;
+        return;
+    }
+    m_discover_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs() - start;
+
+    if (m_snoopMode) {
+        debugOutput( DEBUG_LEVEL_VERBOSE,
+                    "Enabling snoop mode on node %d...\n", m_nodeId );
+
+        if(!avDevice->setOption("snoopMode", m_snoopMode)) {
+            debugWarning("Could not set snoop mode for device on node %d\n", m_nodeId);
+            delete avDevice;
+            m_result = eDR_Failed;
+            return;
+        }
+    }
+
+    if ( !isFromCache && !avDevice->saveCache() ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "No cached version of AVC model created\n" );
+    }
+    m_device = avDevice;
+    m_result = ( isFromCache ? eDR_Cached : eDR_Discovered );
+}
+
+const char *
+DeviceManager::DiscoveryJob::resultToString(enum eResult r)
+{
+    switch(r) {
+        case eDR_NoConfigRom: return "no config rom";
+        case eDR_Known:       return "known";
+        case eDR_NoMatch:     return "no spec match";
+        case eDR_Unsupported: return "unsupported";
+        case eDR_Failed:      return "failed";
+        case eDR_Discovered:  return "discovered";
+        case eDR_Cached:      return "cached";
+    }
+    return "invalid";
+}
+
+/**
+ * runs the discovery jobs, in parallel if discovery threads are configured
+ * @return the number of threads that ran the jobs
+ */
+unsigned int
+DeviceManager::runDiscoveryJobs(DiscoveryJobVector &jobs)
+{
+    if (jobs.size() == 0) {
+        return 0;
+    }
+
+    int discovery_threads = DEVICEMANAGER_DISCOVERY_THREADS;
+    getConfiguration().getValueForSetting("device_manager.discovery_threads", discovery_threads);
+
+    // the calling thread runs jobs as well
+    unsigned int nb_workers = 0;
+    if (discovery_threads > 0) {
+        nb_workers = std::min((unsigned int)discovery_threads, (unsigned int)jobs.size() - 1);
+    }
+
+    std::vector<Util::WorkerPool::Job *> pool_jobs(jobs.begin(), jobs.end());
+    if (nb_workers > 0) {
+        Util::WorkerPool pool("DISC", nb_workers, false, 0);
+        pool.setVerboseLevel(getDebugLevel());
+        if (pool.start()) {
+            debugOutput( DEBUG_LEVEL_VERBOSE, "Discovering %zd nodes with %u threads...\n",
+                         jobs.size(), nb_workers + 1 );
+            pool.execute(&pool_jobs[0], pool_jobs.size());
+            pool.stop();
+            return nb_workers + 1;
+        }
+        debugWarning("Could not start the discovery threads, discovering sequentially\n");
+    }
+
+    for ( std::vector<Util::WorkerPool::Job *>::iterator it = pool_jobs.begin();
+        it != pool_jobs.end();
+        ++it )
+    {
+        (*it)->run();
+    }
+    return 1;
+}
+
+void
+DeviceManager::showDiscoveryReport(DiscoveryJobVector &jobs, unsigned int nb_threads,
+                                   ffado_microsecs_t total_usecs)
+{
+    debugOutput( DEBUG_LEVEL_NORMAL, "Discovered %zd nodes in %"PRIu64" ms using %u thread(s)\n",
+                 jobs.size(), total_usecs / 1000, nb_threads );
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "  port node GUID               result         config rom    probe discover (ms)\n" );
+    #ifdef DEBUG_MESSAGES
+    for ( DiscoveryJobVector::iterator it = jobs.begin();
+        it != jobs.end();
+        ++it )
+    {
+        DiscoveryJob *job = *it;
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "  %4d %4d 0x%016"PRIX64" %-14s %10"PRIu64" %8"PRIu64" %8"PRIu64"\n",
+                          job->m_service.getPort(), job->m_nodeId, job->m_guid,
+                          DiscoveryJob::resultToString(job->m_result),
+                          job->m_configrom_usecs / 1000, job->m_probe_usecs / 1000,
+                          job->m_discover_usecs / 1000 );
+    }
+    #endif
+}
+
 FFADODevice*
 DeviceManager::getDriverForDeviceDo( ConfigRom *configRom,
                                    int id, bool generic )
@@ -1085,7 +1375,7 @@ DeviceManager::getDriverForDeviceDo( ConfigRom *configRom,
     }
 #endif
 
-#ifdef ENABLE_BOUNCE
+#if defined(ENABLE_BOUNCE) || defined(ENABLE_SIMULATED_BUS)
     debugOutput( DEBUG_LEVEL_VERBOSE, "Trying Bounce...\n" );
     if ( Bounce::Device::probe( getConfiguration(), *configRom, generic ) ) {
         return Bounce::Device::createDevice( *this, std::auto_ptr<ConfigRom>( configRom ) );
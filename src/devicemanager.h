@@ -38,13 +38,17 @@
 #include "libutil/Functors.h"
 #include "libutil/Mutex.h"
 #include "libutil/Configuration.h"
+#include "libutil/WorkerPool.h"
+#include "libutil/SystemTimeSource.h"
 
 #include <vector>
 #include <string>
 
 class Ieee1394Service;
+class SimulatedBus;
 class FFADODevice;
 class DeviceStringParser;
+class MeterService;
 
 namespace Streaming {
     class StreamProcessor;
@@ -108,6 +112,17 @@ public:
 
     Streaming::StreamProcessor *getSyncSource();
 
+    /**
+     * @brief publish the meters of the devices in shared memory
+     *
+     * Starts a MeterService that polls the meters of all devices, it
+     * follows the device list on rediscovery.
+     * @param rate_hz the number of updates per second, 0 uses the
+     *                configured rate (metering is off if that is 0)
+     */
+    bool startMetering(unsigned int rate_hz = 0);
+    void stopMetering();
+
     /**
      * prevents the busreset handler from running. use with care!
      */
@@ -151,6 +166,55 @@ protected:
     FFADODevice* getSlaveDriver( std::auto_ptr<ConfigRom>( configRom ) );
 
     void busresetHandler(Ieee1394Service &);
+    void addSimulatedDevices(SimulatedBus &);
+
+    /**
+     * Probes and discovers one node. The jobs of all nodes can run in
+     * parallel, the device list is only updated from the thread that
+     * called discover(), after all jobs are finished.
+     */
+    class DiscoveryJob : public Util::WorkerPool::Job
+    {
+    public:
+        enum eResult {
+            eDR_NoConfigRom,
+            eDR_Known,
+            eDR_NoMatch,
+            eDR_Unsupported,
+            eDR_Failed,
+            eDR_Discovered,
+            eDR_Cached,
+        };
+
+        DiscoveryJob(DeviceManager &parent, Ieee1394Service &service,
+                     fb_nodeid_t nodeId, bool useCache, bool snoopMode);
+        virtual ~DiscoveryJob();
+
+        void run();
+        static const char *resultToString(enum eResult r);
+
+        Ieee1394Service&    m_service;
+        fb_nodeid_t         m_nodeId;
+
+        // the results
+        enum eResult        m_result;
+        // owned by the job until it is added to the device list
+        FFADODevice*        m_device;
+        fb_octlet_t         m_guid;
+        ffado_microsecs_t   m_configrom_usecs;
+        ffado_microsecs_t   m_probe_usecs;
+        ffado_microsecs_t   m_discover_usecs;
+
+    private:
+        DeviceManager&      m_parent;
+        bool                m_useCache;
+        bool                m_snoopMode;
+    };
+    typedef std::vector< DiscoveryJob* > DiscoveryJobVector;
+
+    unsigned int runDiscoveryJobs(DiscoveryJobVector &jobs);
+    void showDiscoveryReport(DiscoveryJobVector &jobs, unsigned int nb_threads,
+                             ffado_microsecs_t total_usecs);
 
 protected:
     // we have one service for each port
@@ -171,6 +235,8 @@ private:
     Streaming::StreamProcessorManager*  m_processorManager;
     DeviceStringParser*                 m_deviceStringParser;
     Util::Configuration*                m_configuration;
+    MeterService*                       m_meterService;
+    unsigned int                        m_meter_rate;
     bool                                m_used_cache_last_time;
 
     typedef std::vector< Util::Functor* > notif_vec_t;
@@ -25,6 +25,7 @@
 
 #include "dice/dice_avdevice.h"
 #include "dice/dice_defines.h"
+#include "dice/dice_eap.h"
 
 #include "libieee1394/configrom.h"
 #include "libieee1394/ieee1394service.h"
@@ -32,6 +33,7 @@
 #include "debugmodule/debugmodule.h"
 
 #include "libutil/ByteSwap.h"
+#include "libutil/serialize.h"
 #include <libraw1394/csr.h>
 
 #include <stdint.h>
@@ -75,6 +77,7 @@ Device::Device( DeviceManager& d, std::auto_ptr<ConfigRom>( configRom ))
     , m_tx_size (0xFFFFFFFFLU)
     , m_nb_rx (0xFFFFFFFFLU)
     , m_rx_size (0xFFFFFFFFLU)
+    , m_parameter_space_cached( false )
     , m_notifier (NULL)
 {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Created Dice::Device (NodeID %d)\n",
@@ -212,6 +215,81 @@ Device::createEAP() {
     return new EAP(*this);
 }
 
+bool
+Device::serializeCache( Util::IOSerialize& ser ) const
+{
+    // only the parameter space layout is cached, the EAP and the stream
+    // configuration are read from the device since they follow the
+    // current rate and router setup
+    bool result = true;
+    result &= ser.write( "ParameterSpace/global_reg_offset", m_global_reg_offset );
+    result &= ser.write( "ParameterSpace/global_reg_size", m_global_reg_size );
+    result &= ser.write( "ParameterSpace/tx_reg_offset", m_tx_reg_offset );
+    result &= ser.write( "ParameterSpace/tx_reg_size", m_tx_reg_size );
+    result &= ser.write( "ParameterSpace/rx_reg_offset", m_rx_reg_offset );
+    result &= ser.write( "ParameterSpace/rx_reg_size", m_rx_reg_size );
+    result &= ser.write( "ParameterSpace/unused1_reg_offset", m_unused1_reg_offset );
+    result &= ser.write( "ParameterSpace/unused1_reg_size", m_unused1_reg_size );
+    result &= ser.write( "ParameterSpace/unused2_reg_offset", m_unused2_reg_offset );
+    result &= ser.write( "ParameterSpace/unused2_reg_size", m_unused2_reg_size );
+    result &= ser.write( "ParameterSpace/nb_tx", m_nb_tx );
+    result &= ser.write( "ParameterSpace/tx_size", m_tx_size );
+    result &= ser.write( "ParameterSpace/nb_rx", m_nb_rx );
+    result &= ser.write( "ParameterSpace/rx_size", m_rx_size );
+    return result;
+}
+
+bool
+Device::deserializeCache( Util::IODeserialize& deser )
+{
+    bool result = true;
+    result &= deser.read( "ParameterSpace/global_reg_offset", m_global_reg_offset );
+    result &= deser.read( "ParameterSpace/global_reg_size", m_global_reg_size );
+    result &= deser.read( "ParameterSpace/tx_reg_offset", m_tx_reg_offset );
+    result &= deser.read( "ParameterSpace/tx_reg_size", m_tx_reg_size );
+    result &= deser.read( "ParameterSpace/rx_reg_offset", m_rx_reg_offset );
+    result &= deser.read( "ParameterSpace/rx_reg_size", m_rx_reg_size );
+    result &= deser.read( "ParameterSpace/unused1_reg_offset", m_unused1_reg_offset );
+    result &= deser.read( "ParameterSpace/unused1_reg_size", m_unused1_reg_size );
+    result &= deser.read( "ParameterSpace/unused2_reg_offset", m_unused2_reg_offset );
+    result &= deser.read( "ParameterSpace/unused2_reg_size", m_unused2_reg_size );
+    result &= deser.read( "ParameterSpace/nb_tx", m_nb_tx );
+    result &= deser.read( "ParameterSpace/tx_size", m_tx_size );
+    result &= deser.read( "ParameterSpace/nb_rx", m_nb_rx );
+    result &= deser.read( "ParameterSpace/rx_size", m_rx_size );
+    if ( !result ) {
+        return false;
+    }
+
+    // the rest of the discovery (including the one of the derived
+    // devices) still has to run, it skips the parameter space reads
+    m_parameter_space_cached = true;
+    if ( !discover() ) {
+        m_parameter_space_cached = false;
+        return false;
+    }
+    return true;
+}
+
+uint64_t
+Device::getCacheConfigurationId()
+{
+    // the clock select register holds both the rate and the clock source.
+    // This is called before the parameter space is known, hence it
+    // locates the global space itself.
+    fb_quadlet_t global_offset;
+    fb_quadlet_t clockreg;
+    if ( !readReg( DICE_REGISTER_GLOBAL_PAR_SPACE_OFF, &global_offset ) ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Could not read the global parameter space offset\n" );
+        return 0;
+    }
+    if ( !readReg( global_offset * 4 + DICE_REGISTER_GLOBAL_CLOCK_SELECT, &clockreg ) ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Could not read CLOCK_SELECT register\n" );
+        return 0;
+    }
+    return clockreg;
+}
+
 enum Device::eDiceConfig
 Device::getCurrentConfig()
 {
@@ -697,6 +775,44 @@ Device::getNickname()
     return std::string(namestring);
 }
 
+unsigned int
+Device::getMeterCount()
+{
+    if (m_eap == NULL || m_eap->getRouter() == NULL
+        || !m_eap->getRouter()->hasPeakMetering()) {
+        return 0;
+    }
+    return m_eap->getRouter()->getDestinationNames().size();
+}
+
+std::string
+Device::getMeterName(unsigned int i)
+{
+    if (i >= getMeterCount()) {
+        return "";
+    }
+    return m_eap->getRouter()->getDestinationNames().at(i);
+}
+
+bool
+Device::readMeters(float *values)
+{
+    if (getMeterCount() == 0) {
+        return false;
+    }
+    // one block read of the peak space for all destinations
+    EAP::Router *router = m_eap->getRouter();
+    std::map<std::string, double> peaks = router->getPeakValues();
+    stringlist names = router->getDestinationNames();
+    for (unsigned int i = 0; i < names.size(); i++) {
+        std::map<std::string, double>::iterator it = peaks.find(names.at(i));
+        // the peaks are 12 bit values, the destinations that aren't
+        // routed have no peak
+        values[i] = (it == peaks.end() ? 0.0 : it->second / 4095.0);
+    }
+    return true;
+}
+
 void
 Device::showDevice()
 {
@@ -1586,7 +1702,7 @@ Device::splitNameString(std::string in) {
 
 // I/O routines
 bool
-Device::initIoFunctions() {
+Device::readParameterSpace() {
 
     // offsets and sizes are returned in quadlets, but we use byte values
     if(!readReg(DICE_REGISTER_GLOBAL_PAR_SPACE_OFF, &m_global_reg_offset)) {
@@ -1683,6 +1799,17 @@ Device::initIoFunctions() {
         }
     }
 
+    return true;
+}
+
+bool
+Device::initIoFunctions() {
+
+    // the parameter space layout only changes with the firmware
+    if (!m_parameter_space_cached && !readParameterSpace()) {
+        return false;
+    }
+
 #if USE_OLD_DEFENSIVE_STREAMING_PROTECTION
     // FIXME: after a crash, the device might still be streaming. We
     // simply force a stop now (unless in snoopMode) to return to a
@@ -1767,7 +1894,7 @@ Device::readRegBlock(fb_nodeaddr_t offset, fb_quadlet_t *data, size_t length) {
     debugOutput(DEBUG_LEVEL_VERBOSE,
                 "Reading base register offset 0x%08"PRIX64", length %zd, to %p\n",
                 offset, length, data);
-    const int blocksize_quads = 512/4;
+    const int blocksize_quads = getMaxBlockQuads();
 
     if(offset >= DICE_INVALID_OFFSET) {
         debugError("invalid offset: 0x%012"PRIX64"\n", offset);
@@ -1810,7 +1937,7 @@ bool
 Device::writeRegBlock(fb_nodeaddr_t offset, fb_quadlet_t *data, size_t length) {
     debugOutput(DEBUG_LEVEL_VERY_VERBOSE,"Writing base register offset 0x%08"PRIX64", length: %zd\n",
         offset, length);
-    const int blocksize_quads = 512/4;
+    const int blocksize_quads = getMaxBlockQuads();
 
     if(offset >= DICE_INVALID_OFFSET) {
         debugError("invalid offset: 0x%012"PRIX64"\n", offset);
@@ -1839,7 +1966,7 @@ Device::writeRegBlock(fb_nodeaddr_t offset, fb_quadlet_t *data, size_t length) {
         }
         #endif
 
-        if(!get1394Service().write( nodeId, addr, quads_todo, curr_data ) ) {
+        if(!get1394Service().write( nodeId, curr_addr, quads_todo, curr_data ) ) {
             debugError("Could not write %d quadlets to node 0x%04X addr 0x%012"PRIX64"\n", quads_todo, nodeId, curr_addr);
             return false;
         }
@@ -1849,6 +1976,19 @@ Device::writeRegBlock(fb_nodeaddr_t offset, fb_quadlet_t *data, size_t length) {
     return true;
 }
 
+unsigned int
+Device::getMaxBlockQuads() {
+    // the node tells us what it can handle in its bus info block
+    unsigned int max_bytes = getConfigRom().getAsyMaxPayload();
+    if (max_bytes > DICE_MAX_BLOCK_SIZE_BYTES) {
+        max_bytes = DICE_MAX_BLOCK_SIZE_BYTES;
+    }
+    if (max_bytes < 4) {
+        max_bytes = 4;
+    }
+    return max_bytes/4;
+}
+
 bool
 Device::readGlobalReg(fb_nodeaddr_t offset, fb_quadlet_t *result) {
     debugOutput(DEBUG_LEVEL_VERY_VERBOSE,"Reading global register offset 0x%04"PRIX64"\n", offset);
@@ -2053,4 +2193,14 @@ Device::Notifier::~Notifier()
 
 }
 
+bool
+Device::Notifier::handleWrite(struct raw1394_arm_request *req)
+{
+    Ieee1394Service::ARMHandler::handleWrite(req);
+    // the device notifies us when its state changed, e.g. when a
+    // setting was changed on the front panel
+    m_device.invalidateValues();
+    return true;
+}
+
 }
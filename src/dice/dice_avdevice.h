@@ -117,6 +117,11 @@ public:
     virtual std::string getNickname();
     virtual bool setNickname(std::string name);
 
+    // the meters are the peaks of the router destinations
+    virtual unsigned int getMeterCount();
+    virtual std::string getMeterName(unsigned int i);
+    virtual bool readMeters(float *values);
+
 protected:
     // streaming stuff
     typedef std::vector< Streaming::StreamProcessor * > StreamProcessorVector;
@@ -181,8 +186,14 @@ protected:
 public:
     EAP* getEAP() {return m_eap;};
 
+protected:
+    virtual bool serializeCache( Util::IOSerialize& ser ) const;
+    virtual bool deserializeCache( Util::IODeserialize& deser );
+    virtual uint64_t getCacheConfigurationId();
+
 private: // register I/O routines
     bool initIoFunctions();
+    bool readParameterSpace();
     // functions used for RX/TX abstraction
     bool startstopStreamByIndex(int i, const bool start);
     bool prepareSP (unsigned int, const Streaming::Port::E_Direction direction_requested);
@@ -193,6 +204,8 @@ private: // register I/O routines
     bool writeReg(fb_nodeaddr_t, fb_quadlet_t);
     bool readRegBlock(fb_nodeaddr_t, fb_quadlet_t *, size_t);
     bool writeRegBlock(fb_nodeaddr_t, fb_quadlet_t *, size_t);
+    /// the number of quadlets a block transaction can carry for this node
+    unsigned int getMaxBlockQuads();
 
     bool readGlobalReg(fb_nodeaddr_t, fb_quadlet_t *);
     bool writeGlobalReg(fb_nodeaddr_t, fb_quadlet_t);
@@ -227,6 +240,8 @@ private: // register I/O routines
     fb_quadlet_t m_tx_size;
     fb_quadlet_t m_nb_rx;
     fb_quadlet_t m_rx_size;
+    // the parameter space was restored from the cache
+    bool m_parameter_space_cached;
 
     fb_quadlet_t audio_base_register;
     fb_quadlet_t midi_base_register;
@@ -251,6 +266,8 @@ public:
         Notifier(Device &, nodeaddr_t start);
         virtual ~Notifier();
 
+        virtual bool handleWrite(struct raw1394_arm_request *);
+
     private:
         Device &m_device;
     };
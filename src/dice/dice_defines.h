@@ -29,6 +29,9 @@
 
 #define DICE_INVALID_OFFSET                  0xFFFFF00000000000ULL
 
+// upper limit for the size of one block transaction (S400 async payload)
+#define DICE_MAX_BLOCK_SIZE_BYTES            2048
+
 /*
  * This header is based upon the DICE II driver specification
  * version 1.0.7.0 and:
@@ -27,6 +27,7 @@
 #include "dice_defines.h"
 
 #include "libutil/SystemTimeSource.h"
+#include "libutil/PosixMutex.h"
 #include "libutil/ByteSwap.h"
 
 #include <cstdio>
@@ -1159,6 +1160,7 @@ EAP::Mixer::Mixer(EAP &p)
 : Control::MatrixMixer(&p.m_device, "MatrixMixer")
 , m_eap(p)
 , m_coeff(NULL)
+, m_update_depth(0)
 , m_debugModule(p.m_debugModule)
 {
 }
@@ -1190,6 +1192,8 @@ EAP::Mixer::init()
     int nb_outputs = m_eap.m_mixer_nb_rx;
 
     m_coeff = (fb_quadlet_t *)calloc(nb_outputs * nb_inputs, sizeof(fb_quadlet_t));
+    m_dirty.assign(nb_outputs * nb_inputs, false);
+    m_device_coeff.assign(nb_outputs * nb_inputs, 0);
 
     // load initial values
     if(!loadCoefficients()) {
@@ -1213,6 +1217,9 @@ EAP::Mixer::loadCoefficients()
         debugError("Failed to read coefficients\n");
         return false;
     }
+    // the cache now reflects the device
+    m_dirty.assign(m_dirty.size(), false);
+    m_device_coeff.assign(m_coeff, m_coeff + m_device_coeff.size());
     return true;
 }
 
@@ -1231,8 +1238,87 @@ EAP::Mixer::storeCoefficients()
     int nb_outputs = m_eap.m_mixer_nb_rx;
     if(!m_eap.writeRegBlock(eRT_Mixer, 4, m_coeff, nb_inputs * nb_outputs * 4)) {
         debugError("Failed to read coefficients\n");
+        revertCoefficients();
         return false;
     }
+    m_dirty.assign(m_dirty.size(), false);
+    m_device_coeff.assign(m_coeff, m_coeff + m_device_coeff.size());
+    return true;
+}
+
+void
+EAP::Mixer::revertCoefficients()
+{
+    for(unsigned int i = 0; i < m_dirty.size(); i++) {
+        if(m_dirty[i]) {
+            m_coeff[i] = m_device_coeff[i];
+            m_dirty[i] = false;
+        }
+    }
+}
+
+void
+EAP::Mixer::beginUpdate()
+{
+    m_update_depth++;
+}
+
+bool
+EAP::Mixer::endUpdate()
+{
+    if(m_update_depth == 0) {
+        debugWarning("endUpdate() without beginUpdate()\n");
+        return flushCoefficients();
+    }
+    if(--m_update_depth > 0) {
+        return true;
+    }
+    return flushCoefficients();
+}
+
+bool
+EAP::Mixer::flushCoefficients()
+{
+    if(m_coeff == NULL) {
+        debugError("Coefficient cache not initialized\n");
+        return false;
+    }
+    if(m_eap.m_mixer_readonly) {
+        debugWarning("Mixer is read-only\n");
+        return false;
+    }
+    int nb_coeff = m_dirty.size();
+    int nb_writes = 0;
+    int i = 0;
+    while(i < nb_coeff) {
+        if(!m_dirty[i]) {
+            i++;
+            continue;
+        }
+        // extend the block as long as the next dirty coefficient
+        // is close enough. Writing the few clean ones in between
+        // is cheaper than an extra transaction.
+        int first = i;
+        int last = i;
+        for(int j = i + 1; j < nb_coeff && j - last <= DICE_EAP_MIXER_FLUSH_MAX_GAP_QUADS + 1; j++) {
+            if(m_dirty[j]) {
+                last = j;
+            }
+        }
+        if(!m_eap.writeRegBlock(eRT_Mixer, 4 + first * 4, m_coeff + first, (last - first + 1) * 4)) {
+            debugError("Failed to write coefficients %d to %d\n", first, last);
+            // the cache shouldn't show values the device doesn't have
+            revertCoefficients();
+            return false;
+        }
+        for(int j = first; j <= last; j++) {
+            m_dirty[j] = false;
+            m_device_coeff[j] = m_coeff[j];
+        }
+        nb_writes++;
+        i = last + 1;
+    }
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Flushed mixer coefficients in %d block write(s)\n", nb_writes);
     return true;
 }
 
@@ -1381,27 +1467,53 @@ EAP::Mixer::setValue( const int row, const int col, const double val)
         debugWarning("Mixer is read-only\n");
         return false;
     }
+    if(m_coeff == NULL || !canWrite(row, col)) {
+        debugError("Invalid coefficient (%d, %d)\n", row, col);
+        return 0;
+    }
     int nb_outputs = m_eap.m_mixer_nb_tx;
-    int addr = ((nb_outputs * col) + row) * 4;
+    int idx = (nb_outputs * col) + row;
     quadlet_t tmp = (quadlet_t) val;
-    if(!m_eap.writeRegBlock(eRT_Mixer, 4+addr, &tmp, 4)) {
+    m_coeff[idx] = tmp;
+    m_dirty[idx] = true;
+    if(m_update_depth == 0 && !flushCoefficients()) {
         debugError("Failed to write coefficient\n");
         return 0;
     }
     return (double)(tmp);
 }
 
+bool
+EAP::Mixer::setValues( const int row, const int col,
+                       const int nb_rows, const int nb_cols,
+                       const std::vector<double> &values)
+{
+    beginUpdate();
+    bool retval = Control::MatrixMixer::setValues(row, col, nb_rows, nb_cols, values);
+    return endUpdate() && retval;
+}
+
+bool
+EAP::Mixer::setValues( const std::vector<int> &rows, const std::vector<int> &cols,
+                       const std::vector<double> &values)
+{
+    beginUpdate();
+    bool retval = Control::MatrixMixer::setValues(rows, cols, values);
+    return endUpdate() && retval;
+}
+
 double
 EAP::Mixer::getValue( const int row, const int col)
 {
-    int nb_outputs = m_eap.m_mixer_nb_tx;
-    int addr = ((nb_outputs * col) + row) * 4;
-    quadlet_t tmp;
-    if(!m_eap.readRegBlock(eRT_Mixer, 4+addr, &tmp, 4)) {
-        debugError("Failed to read coefficient\n");
+    // the cache is loaded on init and follows setValue(), no need
+    // to go to the device (loadCoefficients() refreshes it)
+    if(m_coeff == NULL || row < 0 || row >= m_eap.m_mixer_nb_tx
+       || col < 0 || col >= m_eap.m_mixer_nb_rx) {
+        debugError("Invalid coefficient (%d, %d)\n", row, col);
         return 0;
     }
-    return (double)(tmp);
+    int nb_outputs = m_eap.m_mixer_nb_tx;
+    return (double)(m_coeff[(nb_outputs * col) + row]);
 }
 
 int
@@ -1498,6 +1610,7 @@ EAP::Router::Router(EAP &p)
 : Control::CrossbarRouter(&p.m_device, "Router")
 , m_eap(p)
 , m_peak( *(new PeakSpace(p)) )
+, m_peak_lock( new Util::PosixMutex("EAPPEAK") )
 , m_debugModule(p.m_debugModule)
 {
 }
@@ -1505,6 +1618,7 @@ EAP::Router::Router(EAP &p)
 EAP::Router::~Router()
 {
     delete &m_peak;
+    delete m_peak_lock;
 }
 
 void
@@ -1728,6 +1842,7 @@ EAP::Router::hasPeakMetering()
 double
 EAP::Router::getPeakValue(const std::string& dest)
 {
+    Util::MutexLockHelper lock(*m_peak_lock);
     m_peak.read();
     unsigned char dst = m_destinations[dest];
     return m_peak.getPeak(dst);
@@ -1736,6 +1851,7 @@ EAP::Router::getPeakValue(const std::string& dest)
 std::map<std::string, double>
 EAP::Router::getPeakValues()
 {
+    Util::MutexLockHelper lock(*m_peak_lock);
     m_peak.read();
     std::map<std::string, double> ret;
     std::map<unsigned char, int> peaks = m_peak.getPeaks();
@@ -1776,6 +1892,7 @@ EAP::Router::show()
     printMessage("Active router config:\n");
     m_eap.getActiveRouterConfig()->show();
     printMessage("Active peak config:\n");
+    Util::MutexLockHelper lock(*m_peak_lock);
     m_peak.read();
     m_peak.show();
 }
@@ -1802,24 +1919,24 @@ EAP::RouterConfig::read(enum eRegBase base, unsigned offset)
     // first clear the current route vector
     clearRoutes();
 
-    uint32_t nb_routes;
-    if(!m_eap.readRegBlock(base, offset, &nb_routes, 4)) {
-        debugError("Failed to read number of entries\n");
+    // read the number of entries and all possible entries at once
+    unsigned int nb_routes_max = m_eap.getMaxNbRouterEntries();
+    uint32_t tmp_entries[nb_routes_max+1];
+    if(!m_eap.readRegBlock(base, offset, tmp_entries, (nb_routes_max+1)*4)) {
+        debugError("Failed to read router config block\n");
         return false;
     }
+    uint32_t nb_routes = tmp_entries[0];
     if(nb_routes == 0) {
         debugWarning("No routes found. Base 0x%x, offset 0x%x\n", base, offset);
     }
-
-    // read the route info
-    uint32_t tmp_entries[nb_routes];
-    if(!m_eap.readRegBlock(base, offset+4, tmp_entries, nb_routes*4)) {
-        debugError("Failed to read router config block information\n");
-        return false;
+    if(nb_routes > nb_routes_max) {
+        debugWarning("Invalid number of routes: %u, max is %u\n", nb_routes, nb_routes_max);
+        nb_routes = nb_routes_max;
     }
 
     // decode into the routing map
-    for(unsigned int i=0; i < nb_routes; i++) {
+    for(unsigned int i=1; i <= nb_routes; i++) {
         m_routes2.push_back(std::make_pair(tmp_entries[i]&0xff, (tmp_entries[i]>>8)&0xff));
     }
     return true;
@@ -1836,26 +1953,23 @@ EAP::RouterConfig::write(enum eRegBase base, unsigned offset)
         debugError("More then 128 are not possible, only the first 128 routes will get saved!\n");
         nb_routes = 128;
     }
-    uint32_t tmp_entries[nb_routes];
+
+    // the block starts with a zero number of entries, followed by the
+    // entries, the unused ones cleared. The real number is written last.
+    unsigned int nb_routes_max = m_eap.getMaxNbRouterEntries();
+    unsigned int nb_quads = (nb_routes > nb_routes_max ? nb_routes : nb_routes_max) + 1;
+    uint32_t tmp_entries[nb_quads];
+    memset(tmp_entries, 0, sizeof(tmp_entries));
 
     // encode from the routing vector
-    int i=0;
-    for (RouteVectorV2::iterator it=m_routes2.begin(); it!=m_routes2.end(); ++it) {
+    unsigned int i=1;
+    for (RouteVectorV2::iterator it=m_routes2.begin(); it!=m_routes2.end() && i <= nb_routes; ++it) {
         tmp_entries[i] = ((it->second<<8) + it->first)&0xffff;
         ++i;
     }
 
-    unsigned int nb_routes_max = m_eap.getMaxNbRouterEntries();
-    uint32_t zeros[nb_routes_max+1];
-
-    for (unsigned int i=0; i<nb_routes_max+1; ++i) zeros[i] = 0;
-    if(!m_eap.writeRegBlock(base, offset, zeros, (nb_routes_max+1)*4)) {
-        debugError("Failed to write zeros to router config block\n");
-        return false;
-    }
-
     // write the result to the device
-    if(!m_eap.writeRegBlock(base, offset+4, tmp_entries, nb_routes*4)) {
+    if(!m_eap.writeRegBlock(base, offset, tmp_entries, nb_quads*4)) {
         debugError("Failed to write router config block information\n");
         return false;
     }
@@ -2048,14 +2162,13 @@ EAP::StreamConfig::~StreamConfig()
 bool
 EAP::StreamConfig::read(enum eRegBase base, unsigned offset)
 {
-    if(!m_eap.readRegBlock(base, offset, &m_nb_tx, 4)) {
-        debugError("Failed to read number of tx entries\n");
-        return false;
-    }
-    if(!m_eap.readRegBlock(base, offset+4, &m_nb_rx, 4)) {
-        debugError("Failed to read number of rx entries\n");
+    uint32_t nb_entries[2];
+    if(!m_eap.readRegBlock(base, offset, nb_entries, 8)) {
+        debugError("Failed to read number of entries\n");
         return false;
     }
+    m_nb_tx = nb_entries[0];
+    m_nb_rx = nb_entries[1];
     debugOutput(DEBUG_LEVEL_VERBOSE, " Entries: TX: %u, RX: %u\n", m_nb_tx, m_nb_rx);
 
     if(m_tx_configs) {
@@ -2067,28 +2180,24 @@ EAP::StreamConfig::read(enum eRegBase base, unsigned offset)
         m_rx_configs = NULL;
     }
     
+    // the config blocks are contiguous, on the device as in our arrays
     offset += 8;
     if(m_nb_tx > 0) {
         m_tx_configs = new struct ConfigBlock[m_nb_tx];
-        for(unsigned int i=0; i<m_nb_tx; i++) {
-            fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(&(m_tx_configs[i]));
-            if(!m_eap.readRegBlock(base, offset, ptr, sizeof(struct ConfigBlock))) {
-                debugError("Failed to read tx entry %d\n", i);
-                return false;
-            }
-            offset += sizeof(struct ConfigBlock);
+        fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(m_tx_configs);
+        if(!m_eap.readRegBlock(base, offset, ptr, m_nb_tx * sizeof(struct ConfigBlock))) {
+            debugError("Failed to read tx entries\n");
+            return false;
         }
+        offset += m_nb_tx * sizeof(struct ConfigBlock);
     }
 
     if(m_nb_rx > 0) {
         m_rx_configs = new struct ConfigBlock[m_nb_rx];
-        for(unsigned int i=0; i<m_nb_rx; i++) {
-            fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(&(m_rx_configs[i]));
-            if(!m_eap.readRegBlock(base, offset, ptr, sizeof(struct ConfigBlock))) {
-                debugError("Failed to read rx entry %d\n", i);
-                return false;
-            }
-            offset += sizeof(struct ConfigBlock);
+        fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(m_rx_configs);
+        if(!m_eap.readRegBlock(base, offset, ptr, m_nb_rx * sizeof(struct ConfigBlock))) {
+            debugError("Failed to read rx entries\n");
+            return false;
         }
     }
     return true;
@@ -2097,32 +2206,28 @@ EAP::StreamConfig::read(enum eRegBase base, unsigned offset)
 bool
 EAP::StreamConfig::write(enum eRegBase base, unsigned offset)
 {
-    if(!m_eap.writeRegBlock(base, offset, &m_nb_tx, 4)) {
-        debugError("Failed to write number of tx entries\n");
-        return false;
-    }
-    if(!m_eap.writeRegBlock(base, offset+4, &m_nb_rx, 4)) {
-        debugError("Failed to write number of rx entries\n");
+    uint32_t nb_entries[2] = {m_nb_tx, m_nb_rx};
+    if(!m_eap.writeRegBlock(base, offset, nb_entries, 8)) {
+        debugError("Failed to write number of entries\n");
         return false;
     }
 
     offset += 8;
-    for(unsigned int i=0; i<m_nb_tx; i++) {
-        fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(&(m_tx_configs[i]));
-        if(!m_eap.writeRegBlock(base, offset, ptr, sizeof(struct ConfigBlock))) {
-            debugError("Failed to write tx entry %d\n", i);
+    if(m_nb_tx > 0) {
+        fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(m_tx_configs);
+        if(!m_eap.writeRegBlock(base, offset, ptr, m_nb_tx * sizeof(struct ConfigBlock))) {
+            debugError("Failed to write tx entries\n");
             return false;
         }
-        offset += sizeof(struct ConfigBlock);
+        offset += m_nb_tx * sizeof(struct ConfigBlock);
     }
 
-    for(unsigned int i=0; i<m_nb_rx; i++) {
-        fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(&(m_rx_configs[i]));
-        if(!m_eap.writeRegBlock(base, offset, ptr, sizeof(struct ConfigBlock))) {
-            debugError("Failed to write rx entry %d\n", i);
+    if(m_nb_rx > 0) {
+        fb_quadlet_t *ptr = reinterpret_cast<fb_quadlet_t *>(m_rx_configs);
+        if(!m_eap.writeRegBlock(base, offset, ptr, m_nb_rx * sizeof(struct ConfigBlock))) {
+            debugError("Failed to write rx entries\n");
             return false;
         }
-        offset += sizeof(struct ConfigBlock);
     }
     return true;
 }
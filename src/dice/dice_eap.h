@@ -25,6 +25,8 @@
 
 #include "dice_avdevice.h"
 
+#include "libutil/Mutex.h"
+
 #define DICE_EAP_BASE                  0x0000000000200000ULL
 #define DICE_EAP_MAX_SIZE              0x0000000000F00000ULL
 
@@ -101,6 +103,10 @@
 // MIXER registers
 // TODO
 
+// when flushing the mixer cache, dirty coefficient runs separated by up to
+// this many clean coefficients are written as one block
+#define DICE_EAP_MIXER_FLUSH_MAX_GAP_QUADS  8
+
 // PEAK registers
 // TODO
 
@@ -416,6 +422,29 @@ public:
          */
         bool storeCoefficients();
 
+        /**
+         * @brief defer the coefficient writes
+         *
+         * Until the matching endUpdate(), setValue() only updates the
+         * cache. Calls can be nested.
+         */
+        void beginUpdate();
+        /**
+         * @brief ends a deferred update
+         *
+         * The outermost call writes the changed coefficients to the device.
+         * @return false if the coefficients couldn't be written
+         */
+        bool endUpdate();
+        /**
+         * Writes the changed coefficients from the cache to the device, as
+         * contiguous blocks.
+         * @return false if the cache isn't initialized, the mixer is
+         *         read-only or a block write failed. The coefficients that
+         *         weren't written revert to their value on the device.
+         */
+        bool flushCoefficients();
+
         virtual int getRowCount( );
         virtual int getColCount( );
 
@@ -423,6 +452,13 @@ public:
         virtual double setValue( const int, const int, const double );
         virtual double getValue( const int, const int );
 
+        // multi-coefficient writes are flushed to the device in one go
+        virtual bool setValues( const int, const int, const int, const int,
+                                const std::vector<double> & );
+        virtual bool setValues( const std::vector<int> &, const std::vector<int> &,
+                                const std::vector<double> & );
+        using Control::MatrixMixer::getValues;
+
         //
         bool hasNames() const { return false; }
         std::string getRowName( const int );
@@ -438,6 +474,13 @@ public:
     private:
         EAP &         m_eap;
         fb_quadlet_t *m_coeff;
+        /// coefficients changed in the cache but not written yet
+        std::vector<bool> m_dirty;
+        /// the coefficients as last read from or written to the device
+        std::vector<fb_quadlet_t> m_device_coeff;
+        /// drops the changes that weren't written
+        void revertCoefficients();
+        int           m_update_depth;
 
         //std::map<int, RouterConfig::Route> m_input_route_map;
         //std::map<int, RouterConfig::RouteVector> m_output_route_map;
@@ -500,6 +543,8 @@ public:
         // @}
 
         PeakSpace &m_peak;
+        // the peaks are read by the control interface and the meter service
+        Util::Mutex* m_peak_lock;
 
         DECLARE_DEBUG_MODULE_REFERENCE;
     };
@@ -196,6 +196,8 @@ int ffado_streaming_set_period_size(ffado_device_t *dev, unsigned int period) {
 
 int ffado_streaming_prepare(ffado_device_t *dev) {
     debugOutput(DEBUG_LEVEL_VERBOSE, "Preparing...\n");
+    // often the thread that will run the period loop
+    ffado_streaming_register_thread(dev);
     // prepare here or there are no ports for jack
     if(!dev->m_deviceManager->prepareStreaming()) {
         debugFatal("Could not prepare the streaming system\n");
@@ -216,6 +218,7 @@ void ffado_streaming_finish(ffado_device_t *dev) {
 
 int ffado_streaming_start(ffado_device_t *dev) {
     debugOutput(DEBUG_LEVEL_VERBOSE,"------------- Start -------------\n");
+    ffado_streaming_register_thread(dev);
     if(!dev->m_deviceManager->startStreaming()) {
         debugFatal("Could not start the streaming system\n");
         return -1;
@@ -223,6 +226,14 @@ int ffado_streaming_start(ffado_device_t *dev) {
     return 0;
 }
 
+int ffado_streaming_register_thread(ffado_device_t *dev) {
+    if(!DebugModuleManager::instance()->registerThread()) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Could not register the client thread\n");
+        return -1;
+    }
+    return 0;
+}
+
 int ffado_streaming_stop(ffado_device_t *dev) {
     debugOutput(DEBUG_LEVEL_VERBOSE,"------------- Stop -------------\n");
     if(!dev->m_deviceManager->stopStreaming()) {
@@ -22,6 +22,8 @@
  *
  */
 
+#include "config.h"
+
 #include "ffadodevice.h"
 #include "devicemanager.h"
 
@@ -32,9 +34,16 @@
 #include "libcontrol/ClockSelect.h"
 #include "libcontrol/Nickname.h"
 
+#include "libutil/serialize_binary.h"
+#include "libutil/SystemTimeSource.h"
+
 #include <iostream>
 #include <sstream>
 #include <unistd.h>
+#include <cstdlib>
+#include <cstdio>
+#include <sys/stat.h>
+#include <errno.h>
 
 #include <assert.h>
 
@@ -136,16 +145,112 @@ FFADODevice::get1394Service()
     return getConfigRom().get1394Service();
 }
 
+std::string
+FFADODevice::getCachePath()
+{
+    std::string cachePath;
+    char* pCachePath;
+
+    std::string path = CACHEDIR;
+    if ( path.size() && path[0] == '~' ) {
+        path.erase( 0, 1 ); // remove ~
+        path.insert( 0, getenv( "HOME" ) ); // prepend the home path
+    }
+
+    if ( asprintf( &pCachePath, "%s/cache/",  path.c_str() ) < 0 ) {
+        debugError( "Could not create path string for cache pool (trying '/var/cache/libffado' instead)\n" );
+        cachePath = "/var/cache/libffado/";
+    } else {
+        cachePath = pCachePath;
+        free( pCachePath );
+    }
+    return cachePath;
+}
+
+std::string
+FFADODevice::getCacheFileName()
+{
+    // the path looks like this:
+    // PATH_TO_CACHE + GUID + CONFIGURATION_ID-ROM_CRC
+    char* name;
+    if ( asprintf( &name, "%s%s/%016"PRIx64"-%04x.bin",
+                   getCachePath().c_str(),
+                   getConfigRom().getGuidString().c_str(),
+                   getCacheConfigurationId(),
+                   getConfigRom().getRomCrc() ) < 0 ) {
+        debugError( "Could not create cache file name\n" );
+        return "";
+    }
+    std::string fileName = name;
+    free( name );
+    return fileName;
+}
+
 bool
 FFADODevice::loadFromCache()
 {
-    return false;
+    std::string fileName = getCacheFileName();
+    if ( fileName.size() == 0 ) {
+        return false;
+    }
+
+    #ifdef DEBUG_MESSAGES
+    ffado_microsecs_t start = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    #endif
+    Util::BinaryDeserialize deser( fileName, getConfigRom().getGuid(), getDebugLevel() );
+    if ( !deser.isValid() ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "no valid cache: %s\n", fileName.c_str() );
+        return false;
+    }
+
+    bool result = deserializeCache( deser );
+    debugOutput( DEBUG_LEVEL_VERBOSE, "%s device from %s in %"PRIu64" usecs\n",
+                 ( result ? "loaded" : "could not load" ), fileName.c_str(),
+                 (uint64_t)( Util::SystemTimeSource::getCurrentTimeAsUsecs() - start ) );
+    return result;
 }
 
 bool
 FFADODevice::saveCache()
 {
-    return false;
+    std::string fileName = getCacheFileName();
+    if ( fileName.size() == 0 ) {
+        return false;
+    }
+
+    Util::BinarySerialize ser( fileName, getConfigRom().getGuid() );
+    ser.setVerboseLevel( getDebugLevel() );
+    if ( !serializeCache( ser ) ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "device doesn't support caching\n" );
+        return false;
+    }
+
+    // the following piece should do something like
+    // 'mkdir -p some/path/with/some/dirs/which/do/not/exist'
+    std::vector<std::string> tokens;
+    tokenize( fileName.substr( 0, fileName.rfind( '/' ) ), tokens, "/" );
+    std::string path;
+    for ( std::vector<std::string>::const_iterator it = tokens.begin();
+          it != tokens.end();
+          ++it )
+    {
+        path +=  "/" + *it;
+
+        struct stat buf;
+        if ( stat( path.c_str(), &buf ) == 0 ) {
+            if ( !S_ISDIR( buf.st_mode ) ) {
+                debugError( "\"%s\" is not a directory\n",  path.c_str() );
+                return false;
+            }
+        } else {
+            if (  mkdir( path.c_str(), S_IRWXU | S_IRWXG ) != 0 && errno != EEXIST ) {
+                debugError( "Could not create \"%s\" directory\n", path.c_str() );
+                return false;
+            }
+        }
+    }
+
+    return ser.commit();
 }
 
 bool
@@ -184,6 +289,26 @@ FFADODevice::canChangeNickname()
     return false;
 }
 
+unsigned int
+FFADODevice::getMeterCount()
+{
+    return 0;
+}
+
+std::string
+FFADODevice::getMeterName(unsigned int i)
+{
+    char tmp[16];
+    snprintf(tmp, sizeof(tmp), "Meter %u", i);
+    return tmp;
+}
+
+bool
+FFADODevice::readMeters(float *values)
+{
+    return false;
+}
+
 void
 FFADODevice::handleBusReset()
 {
@@ -47,6 +47,11 @@ namespace Control {
     class Container;
 }
 
+namespace Util {
+    class IOSerialize;
+    class IODeserialize;
+}
+
 /*!
 @brief Base class for device support
 
@@ -88,7 +93,8 @@ public:
      * @brief Called by DeviceManager to load device model from cache.
      *
      * This function is called before discover in order to speed up
-     * system initializing.
+     * system initializing. The default implementation loads the binary
+     * cache file written by saveCache() through deserializeCache().
      *
      * @returns true if device was cached and successfully loaded from cache
      */
@@ -103,6 +109,11 @@ public:
      */
     virtual bool saveCache();
 
+    /**
+     * @brief the directory the device caches are stored in
+     */
+    static std::string getCachePath();
+
     /**
      * @brief Called by DeviceManager to check whether a device requires rediscovery
      *
@@ -461,6 +472,27 @@ public:
      */
     virtual bool canChangeNickname();
 
+    /**
+     * @brief return the number of level meters the device can report
+     *
+     * The meter service polls the meters from its own thread, hence
+     * readMeters() has to be safe against the control interface.
+     *
+     * @return the number of meters, 0 if metering isn't supported
+     */
+    virtual unsigned int getMeterCount();
+    /**
+     * @brief return the name of a meter
+     */
+    virtual std::string getMeterName(unsigned int i);
+    /**
+     * @brief read the current meter values from the device
+     * @param values receives getMeterCount() values, as a fraction of
+     *               full scale (0.0 to 1.0)
+     * @return true if successful
+     */
+    virtual bool readMeters(float *values);
+
     /**
      * @brief handle a bus reset
      *
@@ -478,7 +510,35 @@ public:
 
     DeviceManager& getDeviceManager()
         {return m_pDeviceManager;};
+
+protected:
+    /**
+     * @brief store the result of discover() in the cache
+     *
+     * The cache file is keyed by the GUID, the config ROM CRC and
+     * getCacheConfigurationId(). Drivers that support caching implement
+     * this and deserializeCache(), the default doesn't cache anything.
+     *
+     * @returns false if nothing should be cached
+     */
+    virtual bool serializeCache( Util::IOSerialize& ser ) const
+        { return false; };
+    /**
+     * @brief restore the state serializeCache() stored, such that the
+     * device can be used without calling discover()
+     */
+    virtual bool deserializeCache( Util::IODeserialize& deser )
+        { return false; };
+    /**
+     * @brief identifies the device configuration the discovered model
+     * depends on (e.g. the sample rate or the sync mode)
+     */
+    virtual uint64_t getCacheConfigurationId()
+        { return 0; };
+
 private:
+    std::string getCacheFileName();
+
     std::auto_ptr<ConfigRom>( m_pConfigRom );
     DeviceManager& m_pDeviceManager;
     Control::Container* m_genericContainer;
@@ -24,7 +24,10 @@
 #include "efc_cmds_hardware.h"
 
 #include "libutil/ByteSwap.h"
+#include "libutil/serialize.h"
 #include <iostream>
+#include <sstream>
+#include <cstring>
 
 using namespace std;
 
@@ -167,6 +170,96 @@ EfcHardwareInfoCmd::showEfcCmd()
     }
 }
 
+bool
+EfcHardwareInfoCmd::serialize( std::string basePath, Util::IOSerialize& ser ) const
+{
+    bool result = true;
+    result &= ser.write( basePath + "m_flags", m_flags );
+    result &= ser.write( basePath + "m_guid", m_guid );
+    result &= ser.write( basePath + "m_type", m_type );
+    result &= ser.write( basePath + "m_version", m_version );
+    result &= ser.write( basePath + "m_vendor_name",
+                         std::string( m_vendor_name, strnlen( m_vendor_name, HWINFO_NAME_SIZE_BYTES ) ) );
+    result &= ser.write( basePath + "m_model_name",
+                         std::string( m_model_name, strnlen( m_model_name, HWINFO_NAME_SIZE_BYTES ) ) );
+    result &= ser.write( basePath + "m_supported_clocks", m_supported_clocks );
+    result &= ser.write( basePath + "m_nb_1394_playback_channels", m_nb_1394_playback_channels );
+    result &= ser.write( basePath + "m_nb_1394_record_channels", m_nb_1394_record_channels );
+    result &= ser.write( basePath + "m_nb_phys_audio_out", m_nb_phys_audio_out );
+    result &= ser.write( basePath + "m_nb_phys_audio_in", m_nb_phys_audio_in );
+    result &= ser.write( basePath + "m_nb_out_groups", m_nb_out_groups );
+    result &= ser.write( basePath + "m_nb_in_groups", m_nb_in_groups );
+    for ( int i = 0; i < HWINFO_MAX_CAPS_GROUPS; i++ ) {
+        std::ostringstream strstrm;
+        strstrm << basePath << "group" << i << "/";
+        result &= ser.write( strstrm.str() + "out_type", out_groups[i].type );
+        result &= ser.write( strstrm.str() + "out_count", out_groups[i].count );
+        result &= ser.write( strstrm.str() + "in_type", in_groups[i].type );
+        result &= ser.write( strstrm.str() + "in_count", in_groups[i].count );
+    }
+    result &= ser.write( basePath + "m_nb_midi_out", m_nb_midi_out );
+    result &= ser.write( basePath + "m_nb_midi_in", m_nb_midi_in );
+    result &= ser.write( basePath + "m_max_sample_rate", m_max_sample_rate );
+    result &= ser.write( basePath + "m_min_sample_rate", m_min_sample_rate );
+    result &= ser.write( basePath + "m_dsp_version", m_dsp_version );
+    result &= ser.write( basePath + "m_arm_version", m_arm_version );
+    result &= ser.write( basePath + "num_mix_play_chan", num_mix_play_chan );
+    result &= ser.write( basePath + "num_mix_rec_chan", num_mix_rec_chan );
+    result &= ser.write( basePath + "m_fpga_version", m_fpga_version );
+    result &= ser.write( basePath + "m_nb_1394_play_chan_2x", m_nb_1394_play_chan_2x );
+    result &= ser.write( basePath + "m_nb_1394_rec_chan_2x", m_nb_1394_rec_chan_2x );
+    result &= ser.write( basePath + "m_nb_1394_play_chan_4x", m_nb_1394_play_chan_4x );
+    result &= ser.write( basePath + "m_nb_1394_rec_chan_4x", m_nb_1394_rec_chan_4x );
+    return result;
+}
+
+bool
+EfcHardwareInfoCmd::deserialize( std::string basePath, Util::IODeserialize& deser )
+{
+    bool result = true;
+    std::string vendor_name, model_name;
+    result &= deser.read( basePath + "m_flags", m_flags );
+    result &= deser.read( basePath + "m_guid", m_guid );
+    result &= deser.read( basePath + "m_type", m_type );
+    result &= deser.read( basePath + "m_version", m_version );
+    result &= deser.read( basePath + "m_vendor_name", vendor_name );
+    result &= deser.read( basePath + "m_model_name", model_name );
+    result &= deser.read( basePath + "m_supported_clocks", m_supported_clocks );
+    result &= deser.read( basePath + "m_nb_1394_playback_channels", m_nb_1394_playback_channels );
+    result &= deser.read( basePath + "m_nb_1394_record_channels", m_nb_1394_record_channels );
+    result &= deser.read( basePath + "m_nb_phys_audio_out", m_nb_phys_audio_out );
+    result &= deser.read( basePath + "m_nb_phys_audio_in", m_nb_phys_audio_in );
+    result &= deser.read( basePath + "m_nb_out_groups", m_nb_out_groups );
+    result &= deser.read( basePath + "m_nb_in_groups", m_nb_in_groups );
+    for ( int i = 0; i < HWINFO_MAX_CAPS_GROUPS; i++ ) {
+        std::ostringstream strstrm;
+        strstrm << basePath << "group" << i << "/";
+        result &= deser.read( strstrm.str() + "out_type", out_groups[i].type );
+        result &= deser.read( strstrm.str() + "out_count", out_groups[i].count );
+        result &= deser.read( strstrm.str() + "in_type", in_groups[i].type );
+        result &= deser.read( strstrm.str() + "in_count", in_groups[i].count );
+    }
+    result &= deser.read( basePath + "m_nb_midi_out", m_nb_midi_out );
+    result &= deser.read( basePath + "m_nb_midi_in", m_nb_midi_in );
+    result &= deser.read( basePath + "m_max_sample_rate", m_max_sample_rate );
+    result &= deser.read( basePath + "m_min_sample_rate", m_min_sample_rate );
+    result &= deser.read( basePath + "m_dsp_version", m_dsp_version );
+    result &= deser.read( basePath + "m_arm_version", m_arm_version );
+    result &= deser.read( basePath + "num_mix_play_chan", num_mix_play_chan );
+    result &= deser.read( basePath + "num_mix_rec_chan", num_mix_rec_chan );
+    result &= deser.read( basePath + "m_fpga_version", m_fpga_version );
+    result &= deser.read( basePath + "m_nb_1394_play_chan_2x", m_nb_1394_play_chan_2x );
+    result &= deser.read( basePath + "m_nb_1394_rec_chan_2x", m_nb_1394_rec_chan_2x );
+    result &= deser.read( basePath + "m_nb_1394_play_chan_4x", m_nb_1394_play_chan_4x );
+    result &= deser.read( basePath + "m_nb_1394_rec_chan_4x", m_nb_1394_rec_chan_4x );
+
+    memset( m_vendor_name, 0, HWINFO_NAME_SIZE_BYTES );
+    strncpy( m_vendor_name, vendor_name.c_str(), HWINFO_NAME_SIZE_BYTES - 1 );
+    memset( m_model_name, 0, HWINFO_NAME_SIZE_BYTES );
+    strncpy( m_model_name, model_name.c_str(), HWINFO_NAME_SIZE_BYTES - 1 );
+    return result;
+}
+
 // --- polled info command
 EfcPolledValuesCmd::EfcPolledValuesCmd()
 : EfcCmd(EFC_CAT_HARDWARE_INFO, EFC_CMD_HW_GET_POLLED)
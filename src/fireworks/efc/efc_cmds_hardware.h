@@ -26,6 +26,11 @@
 
 #include "efc_cmd.h"
 
+namespace Util {
+    class IOSerialize;
+    class IODeserialize;
+}
+
 namespace FireWorks {
 
 #define HWINFO_NAME_SIZE_BYTES      32
@@ -51,6 +56,10 @@ public:
     { return "EfcHardwareInfoCmd"; }
     
     virtual void showEfcCmd();
+
+    // store/restore the response for the discovery cache
+    bool serialize( std::string basePath, Util::IOSerialize& ser ) const;
+    bool deserialize( std::string basePath, Util::IODeserialize& deser );
     
     bool hasPlaybackRouting() const
         {return EFC_CMD_HW_CHECK_FLAG(m_flags, EFC_CMD_HW_HAS_PLAYBACK_ROUTING);};
@@ -51,6 +51,8 @@ namespace FireWorks {
 Device::Device(DeviceManager& d, std::auto_ptr<ConfigRom>( configRom ))
     : GenericAVC::Device( d, configRom)
     , m_poll_lock( new Util::PosixMutex("DEVPOLL") )
+    , m_nb_output_meters ( 0 )
+    , m_nb_input_meters ( 0 )
     , m_efc_discovery_done ( false )
     , m_MixerContainer ( NULL )
     , m_HwInfoContainer ( NULL )
@@ -180,6 +182,40 @@ Device::discoverUsingEFC()
     return true;
 }
 
+bool
+Device::serializeCache( Util::IOSerialize& ser ) const
+{
+    if ( !m_efc_discovery_done ) {
+        return false;
+    }
+    bool result;
+    result  = GenericAVC::Device::serializeCache( ser );
+    result &= m_HwInfo.serialize( "HwInfo/", ser );
+    return result;
+}
+
+bool
+Device::deserializeCache( Util::IODeserialize& deser )
+{
+    // the cache holds the EFC hardware info next to the AV/C model
+    if ( !m_HwInfo.deserialize( "HwInfo/", deser ) ) {
+        return false;
+    }
+    if ( m_HwInfo.m_arm_version < FIREWORKS_MIN_FIRMWARE_VERSION ) {
+        return false;
+    }
+    if ( !GenericAVC::Device::deserializeCache( deser ) ) {
+        return false;
+    }
+    m_current_clock = -1;
+    m_efc_discovery_done = true;
+
+    if(!buildMixer()) {
+        debugWarning("Could not build mixer\n");
+    }
+    return true;
+}
+
 FFADODevice *
 Device::createDevice(DeviceManager& d, std::auto_ptr<ConfigRom>( configRom ))
 {
@@ -443,6 +479,50 @@ Device::updatePolledValues() {
     return doEfcOverAVC(m_Polled);
 }
 
+unsigned int
+Device::getMeterCount() {
+    if (!updatePolledValues()) {
+        debugError("Could not update polled values\n");
+        return 0;
+    }
+    Util::MutexLockHelper lock(*m_poll_lock);
+    m_nb_output_meters = m_Polled.m_nb_output_meters;
+    m_nb_input_meters = m_Polled.m_nb_input_meters;
+    return m_nb_output_meters + m_nb_input_meters;
+}
+
+std::string
+Device::getMeterName(unsigned int i) {
+    char tmp[16];
+    if (i < m_nb_output_meters) {
+        snprintf(tmp, sizeof(tmp), "Out %u", i + 1);
+    } else {
+        snprintf(tmp, sizeof(tmp), "In %u", i - m_nb_output_meters + 1);
+    }
+    return tmp;
+}
+
+bool
+Device::readMeters(float *values) {
+    // use a command of our own, such that the poll lock isn't held
+    // during the transaction
+    EfcPolledValuesCmd polled;
+    if (!doEfcOverAVC(polled)) {
+        return false;
+    }
+    if (polled.m_nb_output_meters != m_nb_output_meters
+        || polled.m_nb_input_meters != m_nb_input_meters) {
+        debugWarning("Number of meters changed\n");
+        return false;
+    }
+    // the meters are signed fractions of full scale
+    for (unsigned int i = 0; i < m_nb_output_meters + m_nb_input_meters; i++) {
+        float v = (float)polled.m_meters[i] / (float)INT32_MAX;
+        values[i] = (v < 0.0 ? 0.0 : (v > 1.0 ? 1.0 : v));
+    }
+    return true;
+}
+
 #define ECHO_CHECK_AND_ADD_SR(v, x) \
     { if(x >= m_HwInfo.m_min_sample_rate && x <= m_HwInfo.m_max_sample_rate) \
       v.push_back(x); }
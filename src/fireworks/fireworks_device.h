@@ -72,6 +72,11 @@ public:
     const EfcHardwareInfoCmd getHwInfo()
         {return m_HwInfo;};
 
+    // the meters of the polled values, outputs first
+    virtual unsigned int getMeterCount();
+    virtual std::string getMeterName(unsigned int i);
+    virtual bool readMeters(float *values);
+
 // protected: //?
     bool doEfcOverAVC(EfcCmd& c);
     
@@ -131,6 +136,10 @@ public:
      */
     bool saveSession();
 
+protected:
+    virtual bool serializeCache( Util::IOSerialize& ser ) const;
+    virtual bool deserializeCache( Util::IODeserialize& deser );
+
 // Echo specific stuff
 private:
     
@@ -156,6 +165,8 @@ private:
     bool updatePolledValues();
     Util::Mutex*        m_poll_lock;
     EfcPolledValuesCmd  m_Polled;
+    unsigned int        m_nb_output_meters;
+    unsigned int        m_nb_input_meters;
 
     bool                m_efc_discovery_done;
 
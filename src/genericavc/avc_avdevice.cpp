@@ -32,6 +32,7 @@
 #include "libavc/general/avc_plug_info.h"
 #include "libavc/general/avc_extended_plug_info.h"
 #include "libavc/general/avc_subunit_info.h"
+#include "libavc/streamformat/avc_extended_stream_format.h"
 
 #include "debugmodule/debugmodule.h"
 
@@ -938,4 +939,53 @@ Device::deserialize( std::string basePath, Util::IODeserialize& deser )
     return result;
 }
 
+bool
+Device::serializeCache( Util::IOSerialize& ser ) const
+{
+    return serialize( "", ser );
+}
+
+bool
+Device::deserializeCache( Util::IODeserialize& deser )
+{
+    if ( !deserialize( "", deser ) ) {
+        return false;
+    }
+    // the cache is only written after a successful discovery, but
+    // the subunits are what the rest of the driver relies on
+    if ( getAudioSubunit( 0 ) == NULL ) {
+        debugError( "Cached unit doesn't have an Audio subunit.\n" );
+        return false;
+    }
+    return true;
+}
+
+uint64_t
+Device::getCacheConfigurationId()
+{
+    // the plug formats depend on the sample rate. This is called before
+    // the model is known, hence the unit plug is queried directly.
+    AVC::ExtendedStreamFormatCmd extStreamFormatCmd( get1394Service() );
+    AVC::UnitPlugAddress unitPlugAddress( AVC::UnitPlugAddress::ePT_PCR, 0 );
+    extStreamFormatCmd.setPlugAddress( AVC::PlugAddress( AVC::PlugAddress::ePD_Input,
+                                                         AVC::PlugAddress::ePAM_Unit,
+                                                         unitPlugAddress ) );
+    extStreamFormatCmd.setNodeId( getNodeId() );
+    extStreamFormatCmd.setCommandType( AVC::AVCCommand::eCT_Status );
+    extStreamFormatCmd.setVerbose( getDebugLevel() );
+
+    if ( !extStreamFormatCmd.fire() ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Stream format command failed\n" );
+        return 0;
+    }
+
+    AVC::FormatInformationStreamsCompound* compoundStream
+        = dynamic_cast< AVC::FormatInformationStreamsCompound* > (
+            extStreamFormatCmd.getFormatInformation()->m_streams );
+    if ( compoundStream ) {
+        return compoundStream->m_samplingFrequency;
+    }
+    return 0;
+}
+
 }
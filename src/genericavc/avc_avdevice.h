@@ -88,6 +88,10 @@ public:
         { return FFADODevice::getConfigRom(); };
 
 protected:
+    virtual bool serializeCache( Util::IOSerialize& ser ) const;
+    virtual bool deserializeCache( Util::IODeserialize& deser );
+    virtual uint64_t getCacheConfigurationId();
+
     bool discoverGeneric();
     virtual bool addPlugToProcessor( AVC::Plug& plug, Streaming::StreamProcessor *processor,
                              Streaming::AmdtpAudioPort::E_Direction direction);
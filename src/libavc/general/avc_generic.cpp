@@ -50,10 +50,33 @@ AVCCommand::AVCCommand( Ieee1394Service& ieee1394service,
     , m_subunit( 0xff )
     , m_opcode( opcode )
     , m_eResponse( eR_Unknown )
+    , m_pTransaction( NULL )
 {
 
 }
 
+AVCCommand::AVCCommand( const AVCCommand& rhs )
+    : m_p1394Service( rhs.m_p1394Service )
+    , m_nodeId( rhs.m_nodeId )
+    , m_ctype( rhs.m_ctype )
+    , m_subunit( rhs.m_subunit )
+    , m_opcode( rhs.m_opcode )
+    , m_eResponse( rhs.m_eResponse )
+    , m_commandType( rhs.m_commandType )
+    , m_pTransaction( NULL )
+{
+    memcpy( m_fcpFrame, rhs.m_fcpFrame, sizeof( m_fcpFrame ) );
+}
+
+AVCCommand::~AVCCommand()
+{
+    if ( m_pTransaction ) {
+        // the engine still references the transaction
+        m_pTransaction->wait();
+        delete m_pTransaction;
+    }
+}
+
 bool
 AVCCommand::serialize( Util::Cmd::IOSSerialize& se )
 {
@@ -181,6 +204,24 @@ AVCCommand::showFcpFrame( const unsigned char* buf,
 bool
 AVCCommand::fire()
 {
+    if ( !fireAsync() ) {
+        return false;
+    }
+    return waitForResponse();
+}
+
+bool
+AVCCommand::fireAsync( Util::Functor* callback )
+{
+    if ( m_pTransaction ) {
+        debugError( "fireAsync: previous command still pending\n" );
+        return false;
+    }
+    if ( m_nodeId == INVALID_NODE_ID ) {
+        debugWarning( "operation on invalid node\n" );
+        return false;
+    }
+
     memset( &m_fcpFrame,  0x0,  sizeof( m_fcpFrame ) );
 
     Util::Cmd::BufferSerialize se( m_fcpFrame, sizeof( m_fcpFrame ) );
@@ -210,15 +251,29 @@ AVCCommand::fire()
         }
     }
 
+    m_pTransaction = new FcpTransaction();
+    m_pTransaction->setRequest( m_nodeId, (quadlet_t*)m_fcpFrame, ( fcpFrameSize+3 ) / 4 );
+    m_pTransaction->setCallback( callback );
+    if ( !m_p1394Service->getFcpEngine().submit( *m_pTransaction ) ) {
+        delete m_pTransaction;
+        m_pTransaction = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool
+AVCCommand::waitForResponse()
+{
+    if ( !m_pTransaction ) {
+        debugError( "waitForResponse: no command pending\n" );
+        return false;
+    }
+
     bool result = false;
-    unsigned int resp_len;
-    quadlet_t* resp = m_p1394Service->transactionBlock( m_nodeId,
-                                                        (quadlet_t*)m_fcpFrame,
-                                                        ( fcpFrameSize+3 ) / 4,
-                                                        &resp_len );
-    if ( resp ) {
-        resp_len *= 4;
-        unsigned char* buf = ( unsigned char* ) resp;
+    if ( m_pTransaction->wait() ) {
+        unsigned int resp_len = m_pTransaction->getResponseLength() * 4;
+        unsigned char* buf = ( unsigned char* ) m_pTransaction->getResponse();
 
         m_eResponse = ( EResponse )( *buf );
         switch ( m_eResponse )
@@ -260,13 +315,13 @@ AVCCommand::fire()
 
         }
         debugOutputShort( DEBUG_LEVEL_VERY_VERBOSE, "\n" );
-        m_p1394Service->transactionBlockClose();
     } else {
         debugOutput( DEBUG_LEVEL_VERBOSE, "no response\n" );
         result = false;
-        m_p1394Service->transactionBlockClose();
     }
 
+    delete m_pTransaction;
+    m_pTransaction = NULL;
     return result;
 }
 
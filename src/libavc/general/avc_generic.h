@@ -30,8 +30,10 @@
 #include "fbtypes.h"
 
 class Ieee1394Service;
+class FcpTransaction;
 
 namespace Util {
+        class Functor;
         namespace Cmd {
                 class IOSSerialize;
                 class IISDeserialize;
@@ -92,6 +94,20 @@ public:
     virtual bool setCommandType( ECommandType commandType );
     virtual bool fire();
 
+    /**
+     * @brief send the command without waiting for the response
+     *
+     * Commands to different nodes can be in flight at the same time.
+     * waitForResponse() has to be called before the command is used
+     * again.
+     *
+     * @param callback called from the FCP engine thread when the
+     *                 transaction is complete, can be NULL
+     */
+    virtual bool fireAsync( Util::Functor* callback = NULL );
+    ///> wait for the response of fireAsync() and deserialize it
+    virtual bool waitForResponse();
+
     EResponse getResponse();
 
     bool setNodeId( fb_nodeid_t nodeId );
@@ -115,7 +131,8 @@ protected:
 
 protected:
     AVCCommand( Ieee1394Service& ieee1394service, opcode_t opcode );
-    virtual ~AVCCommand() {}
+    AVCCommand( const AVCCommand& rhs );
+    virtual ~AVCCommand();
 
     ECommandType getCommandType();
 
@@ -131,6 +148,12 @@ private:
     EResponse    m_eResponse;
     ECommandType m_commandType;
 
+    // the transaction of fireAsync()
+    FcpTransaction* m_pTransaction;
+
+    // the pending transaction can't be shared, see the copy constructor
+    AVCCommand& operator=( const AVCCommand& rhs );
+
 protected:
     DECLARE_DEBUG_MODULE;
 };
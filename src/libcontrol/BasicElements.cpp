@@ -21,8 +21,112 @@
  *
  */
 
+#include "config.h"
+
 #include "BasicElements.h"
 
 namespace Control {
-// no implementations
+
+// --- Continuous
+
+bool
+Continuous::setValues(int first, const std::vector<double> &values)
+{
+    bool retval = true;
+    for (unsigned int i = 0; i < values.size(); i++) {
+        retval &= setValue(first + i, values.at(i));
+    }
+    return retval;
+}
+
+bool
+Continuous::getValues(int first, int count, std::vector<double> &values)
+{
+    if (count < 0 || count > CONTROL_MAX_VALUES_PER_CALL) {
+        debugError("Invalid value count: %d\n", count);
+        values.clear();
+        return false;
+    }
+    values.resize(count);
+    for (int i = 0; i < count; i++) {
+        values[i] = getValue(first + i);
+    }
+    return true;
 }
+
+bool
+Continuous::setValues(const std::vector<int> &idx, const std::vector<double> &values)
+{
+    if (idx.size() != values.size()) {
+        debugError("%u indexes for %u values\n", (unsigned int)idx.size(), (unsigned int)values.size());
+        return false;
+    }
+    bool retval = true;
+    for (unsigned int i = 0; i < values.size(); i++) {
+        retval &= setValue(idx.at(i), values.at(i));
+    }
+    return retval;
+}
+
+bool
+Continuous::getValues(const std::vector<int> &idx, std::vector<double> &values)
+{
+    values.resize(idx.size());
+    for (unsigned int i = 0; i < idx.size(); i++) {
+        values[i] = getValue(idx.at(i));
+    }
+    return true;
+}
+
+// --- Discrete
+
+bool
+Discrete::setValues(int first, const std::vector<int> &values)
+{
+    bool retval = true;
+    for (unsigned int i = 0; i < values.size(); i++) {
+        retval &= setValue(first + i, values.at(i));
+    }
+    return retval;
+}
+
+bool
+Discrete::getValues(int first, int count, std::vector<int> &values)
+{
+    if (count < 0 || count > CONTROL_MAX_VALUES_PER_CALL) {
+        debugError("Invalid value count: %d\n", count);
+        values.clear();
+        return false;
+    }
+    values.resize(count);
+    for (int i = 0; i < count; i++) {
+        values[i] = getValue(first + i);
+    }
+    return true;
+}
+
+bool
+Discrete::setValues(const std::vector<int> &idx, const std::vector<int> &values)
+{
+    if (idx.size() != values.size()) {
+        debugError("%u indexes for %u values\n", (unsigned int)idx.size(), (unsigned int)values.size());
+        return false;
+    }
+    bool retval = true;
+    for (unsigned int i = 0; i < values.size(); i++) {
+        retval &= setValue(idx.at(i), values.at(i));
+    }
+    return retval;
+}
+
+bool
+Discrete::getValues(const std::vector<int> &idx, std::vector<int> &values)
+{
+    values.resize(idx.size());
+    for (unsigned int i = 0; i < idx.size(); i++) {
+        values[i] = getValue(idx.at(i));
+    }
+    return true;
+}
+
+} // namespace Control
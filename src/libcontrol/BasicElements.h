@@ -49,6 +49,21 @@ public:
     virtual bool setValue(int idx, double v) = 0;
     virtual double getValue(int idx) = 0;
 
+    /*!
+      @{
+      @brief multi-value access
+
+      The range variants access the values with index first to
+      first + count - 1, the list variants the values with the given
+      indexes. The default implementations access the values one by one,
+      elements that can do better should override them.
+      */
+    virtual bool setValues(int first, const std::vector<double> &values);
+    virtual bool getValues(int first, int count, std::vector<double> &values);
+    virtual bool setValues(const std::vector<int> &idx, const std::vector<double> &values);
+    virtual bool getValues(const std::vector<int> &idx, std::vector<double> &values);
+    // @}
+
     virtual double getMinimum() = 0;
     virtual double getMaximum() = 0;
 };
@@ -69,6 +84,16 @@ public:
     virtual bool setValue(int idx, int v) = 0;
     virtual int getValue(int idx) = 0;
 
+    /*!
+      @{
+      @brief multi-value access, see Continuous
+      */
+    virtual bool setValues(int first, const std::vector<int> &values);
+    virtual bool getValues(int first, int count, std::vector<int> &values);
+    virtual bool setValues(const std::vector<int> &idx, const std::vector<int> &values);
+    virtual bool getValues(const std::vector<int> &idx, std::vector<int> &values);
+    // @}
+
     virtual int getMinimum() = 0;
     virtual int getMaximum() = 0;
 
@@ -36,6 +36,8 @@ IMPL_DEBUG_MODULE( Element, Element, DEBUG_LEVEL_NORMAL );
 // if we would create 1000 Elements per second
 // we'd still need >500000 years to wrap.
 // I guess we're safe.
+// the discovery threads create elements in parallel, hence the
+// counter is incremented atomically
 static uint64_t GlobalElementCounter=0;
 
 Element::Element(Element *parent)
@@ -44,7 +46,8 @@ Element::Element(Element *parent)
 , m_Name ( "NoName" )
 , m_Label ( "No Label" )
 , m_Description ( "No Description" )
-, m_id(GlobalElementCounter++)
+, m_id(__sync_fetch_and_add(&GlobalElementCounter, 1))
+, m_value_generation( 0 )
 {
     // no parent, we are the root of an independent control tree
     // this means we have to create a lock
@@ -59,7 +62,8 @@ Element::Element(Element *parent, std::string n)
 , m_Name( n )
 , m_Label ( "No Label" )
 , m_Description ( "No Description" )
-, m_id(GlobalElementCounter++)
+, m_id(__sync_fetch_and_add(&GlobalElementCounter, 1))
+, m_value_generation( 0 )
 {
     // no parent, we are the root of an independent control tree
     // this means we have to create a lock
@@ -114,6 +118,12 @@ Element::canChangeValue()
     return true;
 }
 
+void
+Element::invalidateValues()
+{
+    __sync_fetch_and_add(&m_value_generation, 1);
+}
+
 void
 Element::show()
 {
@@ -322,6 +332,33 @@ Container::clearElements(bool delete_pointers)
     return true;
 }
 
+void
+Container::invalidateValues()
+{
+    Util::MutexLockHelper lock(getLock());
+    invalidateChildrenNoLock();
+    Element::invalidateValues();
+}
+
+void
+Container::invalidateChildrenNoLock()
+{
+    // the tree lock is shared by all elements, hence the children
+    // have to be handled without locking
+    for ( ElementVectorIterator it = m_Children.begin();
+      it != m_Children.end();
+      ++it )
+    {
+        Container *c = dynamic_cast<Container *>(*it);
+        if (c) {
+            c->invalidateChildrenNoLock();
+            c->Element::invalidateValues();
+        } else {
+            (*it)->invalidateValues();
+        }
+    }
+}
+
 void
 Container::show()
 {
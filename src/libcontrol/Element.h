@@ -86,6 +86,17 @@ public:
     // can the value of this element change?
     virtual bool canChangeValue();
 
+    /**
+     * @brief mark the cached copies of the values of this element invalid
+     *
+     * To be called when the device changed the values by itself, or when
+     * the values are unknown (e.g. after a bus reset). Users that cache
+     * the values compare the value generation to detect this.
+     */
+    virtual void invalidateValues();
+    uint32_t getValueGeneration()
+        {return m_value_generation;};
+
     // these allow to prevent external access to the control elements
     // e.g. when the config tree is rebuilt
     virtual void lockControl();
@@ -120,6 +131,7 @@ private:
 
     uint64_t m_id;
     std::vector< SignalFunctor* > m_signalHandlers;
+    volatile uint32_t m_value_generation;
 
 protected:
     DECLARE_DEBUG_MODULE;
@@ -164,6 +176,8 @@ public:
 
     Element * getElementByName(std::string name);
 
+    ///> also invalidates the values of all children
+    virtual void invalidateValues();
 
     virtual void show();
     virtual void setVerboseLevel(int l);
@@ -174,6 +188,7 @@ public:
 
 private:
     bool deleteElementNoLock(Element *e);
+    void invalidateChildrenNoLock();
 
 protected:
     ElementVector m_Children;
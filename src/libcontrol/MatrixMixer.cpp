@@ -25,6 +25,58 @@
 
 namespace Control {
 
+    bool MatrixMixer::setValues(const int row, const int col,
+                                const int nb_rows, const int nb_cols,
+                                const std::vector<double> &values) {
+        if (nb_rows < 0 || nb_cols < 0 || values.size() != (size_t)(nb_rows * nb_cols)) {
+            debugError("%u values for a %dx%d block\n", (unsigned int)values.size(), nb_rows, nb_cols);
+            return false;
+        }
+        for (int r = 0; r < nb_rows; r++) {
+            for (int c = 0; c < nb_cols; c++) {
+                setValue(row + r, col + c, values.at(r * nb_cols + c));
+            }
+        }
+        return true;
+    }
+    bool MatrixMixer::getValues(const int row, const int col,
+                                const int nb_rows, const int nb_cols,
+                                std::vector<double> &values) {
+        if (nb_rows < 0 || nb_cols < 0) {
+            return false;
+        }
+        values.resize(nb_rows * nb_cols);
+        for (int r = 0; r < nb_rows; r++) {
+            for (int c = 0; c < nb_cols; c++) {
+                values[r * nb_cols + c] = getValue(row + r, col + c);
+            }
+        }
+        return true;
+    }
+    bool MatrixMixer::setValues(const std::vector<int> &rows, const std::vector<int> &cols,
+                                const std::vector<double> &values) {
+        if (rows.size() != values.size() || cols.size() != values.size()) {
+            debugError("%u rows and %u cols for %u values\n", (unsigned int)rows.size(),
+                       (unsigned int)cols.size(), (unsigned int)values.size());
+            return false;
+        }
+        for (unsigned int i = 0; i < values.size(); i++) {
+            setValue(rows.at(i), cols.at(i), values.at(i));
+        }
+        return true;
+    }
+    bool MatrixMixer::getValues(const std::vector<int> &rows, const std::vector<int> &cols,
+                                std::vector<double> &values) {
+        if (rows.size() != cols.size()) {
+            return false;
+        }
+        values.resize(rows.size());
+        for (unsigned int i = 0; i < rows.size(); i++) {
+            values[i] = getValue(rows.at(i), cols.at(i));
+        }
+        return true;
+    }
+
     std::string MatrixMixer::getRowName(const int) {
         return "";
     }
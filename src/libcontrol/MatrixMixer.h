@@ -63,6 +63,29 @@ public:
     virtual double getValue(const int, const int) = 0;
     // @}
 
+    /*!
+      @{
+      @brief multi-coefficient access
+
+      The block variants access the nb_rows x nb_cols coefficients starting
+      at (row, col), the values are stored row by row. The list variants
+      access the coefficients at (rows[i], cols[i]).
+
+      The default implementations access the coefficients one by one,
+      mixers that can do better should override them.
+      */
+    virtual bool setValues(const int row, const int col,
+                           const int nb_rows, const int nb_cols,
+                           const std::vector<double> &values);
+    virtual bool getValues(const int row, const int col,
+                           const int nb_rows, const int nb_cols,
+                           std::vector<double> &values);
+    virtual bool setValues(const std::vector<int> &rows, const std::vector<int> &cols,
+                           const std::vector<double> &values);
+    virtual bool getValues(const std::vector<int> &rows, const std::vector<int> &cols,
+                           std::vector<double> &values);
+    // @}
+
     /*!
       @{
       @brief functions to access the entire coefficient map at once
@@ -0,0 +1,407 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "ValueCache.h"
+#include "Element.h"
+
+#include "libutil/PosixMutex.h"
+#include "libutil/PosixThread.h"
+
+#include <errno.h>
+
+namespace Control {
+
+IMPL_DEBUG_MODULE( ValueCache, ValueCache, DEBUG_LEVEL_NORMAL );
+IMPL_DEBUG_MODULE( ValueCacheFlusher, ValueCacheFlusher, DEBUG_LEVEL_NORMAL );
+
+// --- ValueCache
+
+ValueCache::ValueCache(ValueCacheFlusher &f, Element &e)
+: m_flusher( f )
+, m_element( e )
+, m_lock( new Util::PosixMutex("CTLCACHE") )
+{
+    m_flusher.addCache(this);
+}
+
+ValueCache::~ValueCache()
+{
+    m_flusher.removeCache(this);
+    delete m_lock;
+}
+
+bool
+ValueCache::get(uint64_t key, double &value)
+{
+    {
+        Util::MutexLockHelper lock(*m_lock);
+        EntryMapIterator it = m_entries.find(key);
+        if (it != m_entries.end()) {
+            struct sEntry &e = it->second;
+            ffado_microsecs_t max_age = m_flusher.getMaxAge();
+            // a value that still has to be written is always valid
+            if (e.dirty
+                || (e.generation == m_element.getValueGeneration()
+                    && (max_age == 0
+                        || Util::SystemTimeSource::getCurrentTimeAsUsecs() - e.time < max_age))) {
+                value = e.value;
+                return true;
+            }
+        }
+    }
+
+    // go to the element
+    Util::MutexLockHelper access(m_flusher.getAccessLock());
+    if (m_flusher.isSuspended()) {
+        // the element might be going away, serve what we have
+        Util::MutexLockHelper lock(*m_lock);
+        EntryMapIterator it = m_entries.find(key);
+        if (it == m_entries.end()) {
+            return false;
+        }
+        value = it->second.value;
+        return true;
+    }
+    // read the generation first, such that an invalidation during the
+    // read causes the value to be read again
+    uint32_t generation = m_element.getValueGeneration();
+    double v;
+    bool ok;
+    try {
+        ok = readValue(key, v);
+    } catch (...) {
+        debugError("Exception while reading value %"PRIu64"\n", key);
+        ok = false;
+    }
+    if (!ok) {
+        debugError("Could not read value %"PRIu64"\n", key);
+        return false;
+    }
+
+    Util::MutexLockHelper lock(*m_lock);
+    if (!hasRoom(key)) {
+        // full of values that still have to be written, don't cache it
+        value = v;
+        return true;
+    }
+    struct sEntry &e = m_entries[key];
+    if (!e.dirty) {
+        e.value = v;
+        e.generation = generation;
+        e.time = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    }
+    value = e.value;
+    return true;
+}
+
+bool
+ValueCache::set(uint64_t key, double value)
+{
+    if (!store(key, value)) {
+        // all values still have to be written, make room
+        flush();
+        if (!store(key, value)) {
+            debugWarning("Cache full, could not set value %"PRIu64"\n", key);
+            return false;
+        }
+    }
+    m_flusher.requestFlush();
+    return true;
+}
+
+bool
+ValueCache::store(uint64_t key, double value)
+{
+    Util::MutexLockHelper lock(*m_lock);
+    if (!hasRoom(key)) {
+        return false;
+    }
+    struct sEntry &e = m_entries[key];
+    e.value = value;
+    e.dirty = true;
+    e.sequence++;
+    return true;
+}
+
+bool
+ValueCache::flush()
+{
+    Util::MutexLockHelper access(m_flusher.getAccessLock());
+    if (m_flusher.isSuspended()) {
+        return true;
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<double> values;
+    std::vector<uint32_t> sequences;
+    uint32_t generation;
+    {
+        Util::MutexLockHelper lock(*m_lock);
+        generation = m_element.getValueGeneration();
+        for ( EntryMapIterator it = m_entries.begin();
+              it != m_entries.end();
+              ++it )
+        {
+            struct sEntry &e = it->second;
+            if (!e.dirty) continue;
+            keys.push_back(it->first);
+            values.push_back(e.value);
+            sequences.push_back(e.sequence);
+        }
+    }
+    if (keys.empty()) {
+        return true;
+    }
+
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Flushing %zd values\n", keys.size());
+    bool ok;
+    try {
+        ok = writeValues(keys, values);
+    } catch (...) {
+        debugError("Exception while writing %zd values\n", keys.size());
+        ok = false;
+    }
+    if (!ok) {
+        debugError("Could not write %zd values\n", keys.size());
+    }
+
+    // values that were set again during the write stay dirty
+    Util::MutexLockHelper lock(*m_lock);
+    ffado_microsecs_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    for (unsigned int i = 0; i < keys.size(); i++) {
+        EntryMapIterator it = m_entries.find(keys.at(i));
+        if (it == m_entries.end() || it->second.sequence != sequences.at(i)) {
+            continue;
+        }
+        if (ok) {
+            // the written value is the cached value from now on
+            it->second.dirty = false;
+            it->second.generation = generation;
+            it->second.time = now;
+        } else {
+            // we don't know what the element has now
+            m_entries.erase(it);
+        }
+    }
+    return ok;
+}
+
+void
+ValueCache::invalidate()
+{
+    Util::MutexLockHelper lock(*m_lock);
+    dropCleanEntries();
+}
+
+bool
+ValueCache::hasRoom(uint64_t key)
+{
+    unsigned int max_entries = m_flusher.getMaxEntries();
+    if (max_entries == 0 || m_entries.size() < max_entries
+        || m_entries.find(key) != m_entries.end()) {
+        return true;
+    }
+    // the clean values can be read again
+    dropCleanEntries();
+    return m_entries.size() < max_entries;
+}
+
+void
+ValueCache::dropCleanEntries()
+{
+    EntryMapIterator it = m_entries.begin();
+    while (it != m_entries.end()) {
+        if (it->second.dirty) {
+            ++it;
+        } else {
+            m_entries.erase(it++);
+        }
+    }
+}
+
+// --- ValueCacheFlusher
+
+ValueCacheFlusher::ValueCacheFlusher(ffado_microsecs_t max_age_usecs, ffado_microsecs_t delay_usecs,
+                                     unsigned int max_entries)
+: m_max_age( max_age_usecs )
+, m_delay( delay_usecs )
+, m_max_entries( max_entries )
+, m_thread( NULL )
+, m_running( false )
+, m_caches_lock( new Util::PosixMutex("CTLCACHES") )
+, m_access_lock( new Util::PosixMutex("CTLACCESS") )
+, m_suspended( false )
+{
+    sem_init(&m_activity, 0, 0);
+}
+
+ValueCacheFlusher::~ValueCacheFlusher()
+{
+    stop();
+    if (!m_caches.empty()) {
+        debugWarning("%zd caches still registered\n", m_caches.size());
+    }
+    sem_destroy(&m_activity);
+    delete m_caches_lock;
+    delete m_access_lock;
+}
+
+bool
+ValueCacheFlusher::start()
+{
+    if (m_thread) {
+        debugError("Flusher already running\n");
+        return false;
+    }
+    m_running = true;
+    m_thread = new Util::PosixThread(this, "CTLCACHE", false, 0, PTHREAD_CANCEL_DEFERRED);
+    if (m_thread->Start() != 0) {
+        debugError("Could not start the flusher thread\n");
+        delete m_thread;
+        m_thread = NULL;
+        m_running = false;
+        return false;
+    }
+    return true;
+}
+
+void
+ValueCacheFlusher::stop()
+{
+    if (m_thread == NULL) {
+        return;
+    }
+    m_running = false;
+    sem_post(&m_activity);
+    m_thread->Stop();
+    delete m_thread;
+    m_thread = NULL;
+
+    // write what is left
+    if (!flushAll()) {
+        debugWarning("Not all values could be written\n");
+    }
+}
+
+void
+ValueCacheFlusher::addCache(ValueCache *c)
+{
+    Util::MutexLockHelper lock(*m_caches_lock);
+    m_caches.push_back(c);
+}
+
+void
+ValueCacheFlusher::removeCache(ValueCache *c)
+{
+    Util::MutexLockHelper lock(*m_caches_lock);
+    for ( std::vector<ValueCache *>::iterator it = m_caches.begin();
+          it != m_caches.end();
+          ++it )
+    {
+        if (*it == c) {
+            m_caches.erase(it);
+            return;
+        }
+    }
+}
+
+void
+ValueCacheFlusher::requestFlush()
+{
+    sem_post(&m_activity);
+}
+
+bool
+ValueCacheFlusher::flushAll()
+{
+    bool retval = true;
+    Util::MutexLockHelper lock(*m_caches_lock);
+    for ( std::vector<ValueCache *>::iterator it = m_caches.begin();
+          it != m_caches.end();
+          ++it )
+    {
+        retval &= (*it)->flush();
+    }
+    return retval;
+}
+
+void
+ValueCacheFlusher::invalidateAll()
+{
+    Util::MutexLockHelper lock(*m_caches_lock);
+    for ( std::vector<ValueCache *>::iterator it = m_caches.begin();
+          it != m_caches.end();
+          ++it )
+    {
+        (*it)->invalidate();
+    }
+}
+
+void
+ValueCacheFlusher::suspend()
+{
+    if (!flushAll()) {
+        debugWarning("Not all values could be written\n");
+    }
+    Util::MutexLockHelper access(*m_access_lock);
+    m_suspended = true;
+}
+
+void
+ValueCacheFlusher::resume()
+{
+    {
+        Util::MutexLockHelper access(*m_access_lock);
+        m_suspended = false;
+    }
+    invalidateAll();
+    // writes made while suspended are still pending
+    requestFlush();
+}
+
+bool
+ValueCacheFlusher::Execute()
+{
+    if (sem_wait(&m_activity) < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        debugError("sem_wait failed\n");
+        return false;
+    }
+    if (!m_running) {
+        return false;
+    }
+    // let the writes close to this one end up in the same flush
+    if (m_delay) {
+        Util::SystemTimeSource::SleepUsecRelative(m_delay);
+    }
+    while (sem_trywait(&m_activity) == 0) {};
+
+    if (!flushAll()) {
+        debugWarning("Not all values could be written\n");
+    }
+    return m_running;
+}
+
+} // namespace Control
@@ -0,0 +1,208 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef CONTROL_VALUECACHE_H
+#define CONTROL_VALUECACHE_H
+
+#include "debugmodule/debugmodule.h"
+
+#include "libutil/Thread.h"
+#include "libutil/SystemTimeSource.h"
+
+#include <vector>
+#include <map>
+#include <stdint.h>
+#include <semaphore.h>
+
+namespace Util {
+    class Mutex;
+};
+
+namespace Control {
+
+class Element;
+class ValueCacheFlusher;
+
+/*!
+@brief A write-back cache for the values of a control element
+
+ The values are identified by a key, e.g. the index or the row/column of
+ the value. Reads are served from the cache as long as the value isn't
+ older than the maximum age of the flusher and the element didn't
+ invalidate its values since it was read. Writes only update the cache
+ and mark the value dirty, the flusher writes the dirty values to the
+ element in the background. A value that is written several times before
+ the flush is written to the element once.
+
+ A cache holds at most the maximum number of entries of the flusher. When
+ it is full the clean values are dropped, if all of them still have to be
+ written the cache is flushed first.
+
+ Subclasses implement the element access. Exceptions thrown by the element
+ are caught and reported as a failed read or write.
+*/
+class ValueCache
+{
+public:
+    ValueCache(ValueCacheFlusher &, Element &);
+    virtual ~ValueCache();
+
+    /**
+     * @brief get a value, reads it from the element if the cached one isn't valid
+     * @return false if the value is unknown
+     */
+    bool get(uint64_t key, double &value);
+    /**
+     * @brief set a value, it is written to the element by the flusher
+     * @return false if the cache is full and could not be flushed
+     */
+    bool set(uint64_t key, double value);
+
+    /**
+     * @brief write the dirty values to the element
+     * @return false if a write failed. The values that could not be written
+     *         are dropped, such that they are read from the element again.
+     */
+    bool flush();
+    ///> drop the clean values, they will be read from the element again
+    void invalidate();
+
+protected:
+    virtual bool readValue(uint64_t key, double &value) = 0;
+    virtual bool writeValues(const std::vector<uint64_t> &keys,
+                             const std::vector<double> &values) = 0;
+
+    ValueCacheFlusher&  m_flusher;
+    Element&            m_element;
+
+private:
+    struct sEntry {
+        double value;
+        uint32_t generation;
+        ffado_microsecs_t time;
+        bool dirty;
+        ///> incremented by every set, tells a flush whether the value changed
+        uint32_t sequence;
+    };
+    typedef std::map<uint64_t, struct sEntry> EntryMap;
+    typedef std::map<uint64_t, struct sEntry>::iterator EntryMapIterator;
+
+    ///> store a value to be written, false if the cache is full
+    bool store(uint64_t key, double value);
+    // call with m_lock held
+    bool hasRoom(uint64_t key);
+    void dropCleanEntries();
+
+    EntryMap            m_entries;
+    Util::Mutex*        m_lock;
+
+protected:
+    DECLARE_DEBUG_MODULE;
+};
+
+/*!
+@brief Writes the dirty values of a set of value caches
+
+ Also serializes the element accesses of the caches, such that an
+ element is never read by a client and written by the flusher at the
+ same time.
+*/
+class ValueCacheFlusher : public Util::RunnableInterface
+{
+public:
+    /**
+     * @param max_age_usecs the time a value read from an element stays
+     *                      valid, 0 means until the element invalidates it
+     * @param delay_usecs the time the flusher waits after a write, such
+     *                    that writes close to each other end up in one flush
+     * @param max_entries the maximum number of values per cache, 0 means
+     *                    no limit
+     */
+    ValueCacheFlusher(ffado_microsecs_t max_age_usecs, ffado_microsecs_t delay_usecs,
+                      unsigned int max_entries);
+    virtual ~ValueCacheFlusher();
+
+    bool start();
+    ///> stops the thread and writes the remaining dirty values
+    void stop();
+
+    void addCache(ValueCache *);
+    void removeCache(ValueCache *);
+
+    ///> wake up the flusher thread
+    void requestFlush();
+    bool flushAll();
+    void invalidateAll();
+
+    /**
+     * @brief suspend the element accesses, e.g. while the control tree changes
+     *
+     * Writes the dirty values first. While suspended, the caches only serve
+     * the values they have.
+     */
+    void suspend();
+    ///> resume the element accesses, all cached values are invalidated
+    void resume();
+
+    ffado_microsecs_t getMaxAge() {return m_max_age;};
+    unsigned int getMaxEntries() {return m_max_entries;};
+
+    /**
+     * @brief the lock that serializes the element accesses
+     *
+     * Accesses to the elements that don't go through a cache have to hold
+     * it, such that they don't run concurrently with a flush.
+     */
+    Util::Mutex& getAccessLock() {return *m_access_lock;};
+
+    // the thread
+    bool Execute();
+
+    void setVerboseLevel(int l) {setDebugLevel(l);};
+
+protected:
+    friend class ValueCache;
+    ///> call with the access lock held
+    bool isSuspended() {return m_suspended;};
+
+private:
+    ffado_microsecs_t       m_max_age;
+    ffado_microsecs_t       m_delay;
+    unsigned int            m_max_entries;
+
+    Util::Thread*           m_thread;
+    volatile bool           m_running;
+    sem_t                   m_activity;
+
+    std::vector<ValueCache *> m_caches;
+    Util::Mutex*            m_caches_lock;
+    Util::Mutex*            m_access_lock;
+    bool                    m_suspended;
+
+protected:
+    DECLARE_DEBUG_MODULE;
+};
+
+}; // namespace Control
+
+#endif // CONTROL_VALUECACHE_H
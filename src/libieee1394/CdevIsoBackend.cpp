@@ -0,0 +1,507 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#if HAVE_FIREWIRE_CDEV
+
+#include "CdevIsoBackend.h"
+#include "cycletimer.h"
+
+#include <linux/firewire-cdev.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <assert.h>
+#include <cstring>
+#include <cstdio>
+#include <vector>
+#include <algorithm>
+
+// every received packet comes with its iso header and timestamp quadlet
+#define CDEV_RX_HEADER_SIZE         8
+#define CDEV_MAX_DEVICES            64
+// we understand the ABI of linux 2.6.36
+#define CDEV_ABI_VERSION            4
+
+CdevIsoBackend::CdevIsoBackend(Client &client, int port)
+    : IsoBackend(client, port)
+    , m_fd( -1 )
+    , m_ctx_handle( 0 )
+    , m_ctx_created( false )
+    , m_receive( false )
+    , m_running( false )
+    , m_start_cycle( -1 )
+    , m_buffer( NULL )
+    , m_buffer_size( 0 )
+    , m_buf_packets( 0 )
+    , m_slot_size( 0 )
+    , m_channel( -1 )
+    , m_irq_interval( 1 )
+    , m_control( NULL )
+    , m_queued( 0 )
+    , m_completed( 0 )
+    , m_event_buffer( NULL )
+    , m_event_buffer_size( 0 )
+    , m_rx_headers( NULL )
+    , m_rx_nb_headers( 0 )
+    , m_rx_header_idx( 0 )
+    , m_tx_sizes( NULL )
+    , m_tx_used( 0 )
+    , m_tx_write_offset( 0 )
+    , m_tx_irq_index( -1 )
+    , m_tx_irq_cycle( 0 )
+{
+}
+
+CdevIsoBackend::~CdevIsoBackend()
+{
+    close();
+}
+
+bool
+CdevIsoBackend::findLocalDevice(std::string &path)
+{
+    std::vector< std::pair<uint32_t, std::string> > local_devices;
+    char name[32];
+
+    for (int i = 0; i < CDEV_MAX_DEVICES; i++) {
+        snprintf(name, sizeof(name), "/dev/fw%d", i);
+        int fd = ::open(name, O_RDWR);
+        if (fd < 0) continue;
+
+        struct fw_cdev_get_info info;
+        struct fw_cdev_event_bus_reset reset;
+        memset(&info, 0, sizeof(info));
+        memset(&reset, 0, sizeof(reset));
+        info.version = CDEV_ABI_VERSION;
+        info.bus_reset = (uint64_t)(unsigned long)&reset;
+        // the device of the local node represents the card
+        if (ioctl(fd, FW_CDEV_IOC_GET_INFO, &info) == 0
+            && reset.node_id == reset.local_node_id) {
+            local_devices.push_back(std::make_pair(info.card, std::string(name)));
+        }
+        ::close(fd);
+    }
+
+    // the ports are numbered in the order of the cards, like libraw1394 does
+    std::sort(local_devices.begin(), local_devices.end());
+    if (m_port < 0 || m_port >= (int)local_devices.size()) {
+        debugError("No local firewire device for port %d (found %d)\n",
+                   m_port, (int)local_devices.size());
+        return false;
+    }
+    path = local_devices.at(m_port).second;
+    return true;
+}
+
+bool
+CdevIsoBackend::open()
+{
+    assert(m_fd < 0);
+    std::string path;
+    if (!findLocalDevice(path)) {
+        return false;
+    }
+    m_fd = ::open(path.c_str(), O_RDWR | O_NONBLOCK);
+    if (m_fd < 0) {
+        debugError("Could not open %s: %s\n", path.c_str(), strerror(errno));
+        return false;
+    }
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Using %s for port %d\n", path.c_str(), m_port);
+    return true;
+}
+
+void
+CdevIsoBackend::close()
+{
+    stop();
+    if (m_buffer) {
+        munmap(m_buffer, m_buffer_size);
+        m_buffer = NULL;
+    }
+    // closing the fd also destroys the iso context
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_ctx_created = false;
+
+    delete[] m_control;
+    m_control = NULL;
+    delete[] m_event_buffer;
+    m_event_buffer = NULL;
+    delete[] m_tx_sizes;
+    m_tx_sizes = NULL;
+}
+
+bool
+CdevIsoBackend::init(unsigned int buf_packets, unsigned int max_packet_size,
+                     int channel, int speed, int irq_interval)
+{
+    assert(m_fd >= 0);
+    if (m_ctx_created) {
+        debugError("Iso context already created\n");
+        return false;
+    }
+    m_buf_packets = buf_packets;
+    // the payloads have to be quadlet aligned
+    m_slot_size = (max_packet_size + 3) & ~3;
+    m_channel = channel;
+    // same default as libraw1394
+    m_irq_interval = (irq_interval > 0 ? irq_interval : (int)buf_packets / 4);
+    if (m_irq_interval <= 0) m_irq_interval = 1;
+
+    struct fw_cdev_create_iso_context create;
+    memset(&create, 0, sizeof(create));
+    create.type = (m_receive ? FW_CDEV_ISO_CONTEXT_RECEIVE : FW_CDEV_ISO_CONTEXT_TRANSMIT);
+    create.header_size = (m_receive ? CDEV_RX_HEADER_SIZE : 0);
+    create.channel = channel;
+    create.speed = speed;
+    create.closure = (uint64_t)(unsigned long)this;
+    if (ioctl(m_fd, FW_CDEV_IOC_CREATE_ISO_CONTEXT, &create) < 0) {
+        debugFatal("Could not create iso context: %s\n", strerror(errno));
+        return false;
+    }
+    m_ctx_handle = create.handle;
+    m_ctx_created = true;
+
+    // the transmit packets vary in size, leave some slack for the
+    // space lost when wrapping around the end of the buffer
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    size_t size = (size_t)(m_receive ? m_buf_packets : m_buf_packets + 1) * m_slot_size;
+    m_buffer_size = (size + page_size - 1) & ~(page_size - 1);
+    void *buffer = mmap(NULL, m_buffer_size,
+                        (m_receive ? PROT_READ : PROT_READ | PROT_WRITE),
+                        MAP_SHARED, m_fd, 0);
+    if (buffer == MAP_FAILED) {
+        debugFatal("Could not map iso buffer (%u bytes): %s\n",
+                   (unsigned int)m_buffer_size, strerror(errno));
+        return false;
+    }
+    m_buffer = (unsigned char *)buffer;
+
+    m_control = new uint32_t[m_buf_packets];
+    m_event_buffer_size = sizeof(struct fw_cdev_event_iso_interrupt)
+                          + m_buf_packets * CDEV_RX_HEADER_SIZE;
+    if (m_event_buffer_size < page_size) m_event_buffer_size = page_size;
+    m_event_buffer = new unsigned char[m_event_buffer_size];
+    if (!m_receive) {
+        m_tx_sizes = new size_t[m_buf_packets];
+    }
+    return true;
+}
+
+bool
+CdevIsoBackend::initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                            int channel, enum raw1394_iso_dma_recv_mode mode,
+                            int irq_interval)
+{
+    if (mode == RAW1394_DMA_BUFFERFILL) {
+        debugWarning("Buffer-fill receive mode not supported, using packet-per-buffer\n");
+    }
+    m_receive = true;
+    return init(buf_packets, max_packet_size, channel, 0, irq_interval);
+}
+
+bool
+CdevIsoBackend::initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                             int channel, enum raw1394_iso_speed speed,
+                             int irq_interval)
+{
+    m_receive = false;
+    // the libraw1394 speed codes are the kernel's
+    return init(buf_packets, max_packet_size, channel, (int)speed, irq_interval);
+}
+
+bool
+CdevIsoBackend::queue(uint32_t *control, unsigned int nb_packets, unsigned char *data)
+{
+    if (nb_packets == 0) return true;
+
+    struct fw_cdev_queue_iso request;
+    request.packets = (uint64_t)(unsigned long)control;
+    request.data = (uint64_t)(unsigned long)data;
+    request.size = nb_packets * sizeof(uint32_t);
+    request.handle = m_ctx_handle;
+    if (ioctl(m_fd, FW_CDEV_IOC_QUEUE_ISO, &request) < 0) {
+        debugError("Could not queue %u packets: %s\n", nb_packets, strerror(errno));
+        return false;
+    }
+    m_queued += nb_packets;
+    return true;
+}
+
+bool
+CdevIsoBackend::queueReceiveSlots()
+{
+    // all slots except those of the packets the client didn't see yet
+    uint64_t end = m_completed + m_buf_packets;
+    while (m_queued < end) {
+        unsigned int slot = m_queued % m_buf_packets;
+        // a request can't wrap around the end of the buffer
+        unsigned int nb_packets = std::min((uint64_t)(m_buf_packets - slot), end - m_queued);
+        for (unsigned int i = 0; i < nb_packets; i++) {
+            m_control[i] = FW_CDEV_ISO_PAYLOAD_LENGTH(m_slot_size)
+                           | FW_CDEV_ISO_HEADER_LENGTH(CDEV_RX_HEADER_SIZE);
+            if ((m_queued + i + 1) % m_irq_interval == 0) {
+                m_control[i] |= FW_CDEV_ISO_INTERRUPT;
+            }
+        }
+        if (!queue(m_control, nb_packets, m_buffer + slot * m_slot_size)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+CdevIsoBackend::processReceivePackets()
+{
+    while (m_rx_header_idx < m_rx_nb_headers) {
+        uint32_t *header = m_rx_headers + m_rx_header_idx * (CDEV_RX_HEADER_SIZE / 4);
+        // both quadlets are big endian
+        uint32_t iso_header = ntohl(header[0]);
+        uint32_t timestamp = ntohl(header[1]);
+
+        unsigned int length = iso_header >> 16;
+        unsigned char tag = (iso_header >> 14) & 0x3;
+        unsigned char channel = (iso_header >> 8) & 0x3F;
+        unsigned char sy = iso_header & 0xF;
+        unsigned int cycle = timestamp & 0x1FFF;
+        if (length > m_slot_size) {
+            debugWarning("Packet too large (%u > %u), truncated\n", length, m_slot_size);
+            length = m_slot_size;
+        }
+        unsigned char *data = m_buffer + (m_completed % m_buf_packets) * m_slot_size;
+
+        enum raw1394_iso_disposition retval =
+            m_client.putPacket(data, length, channel, tag, sy, cycle, 0);
+        if (retval == RAW1394_ISO_DEFER || retval == RAW1394_ISO_AGAIN) {
+            // offer it again on the next iterate
+            return true;
+        } else if (retval == RAW1394_ISO_ERROR) {
+            debugError("Client error on cycle %u\n", cycle);
+            return false;
+        }
+        m_rx_header_idx++;
+        m_completed++;
+        if (retval == RAW1394_ISO_STOP || retval == RAW1394_ISO_STOP_NOSYNC) {
+            stop();
+            return true;
+        }
+    }
+    return true;
+}
+
+void
+CdevIsoBackend::handleTransmitInterrupt(uint32_t cycle)
+{
+    // the interrupts are raised by the packets at fixed positions
+    // in the packet sequence
+    uint64_t irq_index = (m_completed / m_irq_interval + 1) * m_irq_interval - 1;
+    if (irq_index >= m_queued) {
+        debugWarning("Unexpected interrupt (packet %"PRIu64", queued %"PRIu64")\n",
+                     irq_index, m_queued);
+        return;
+    }
+    for (; m_completed <= irq_index; m_completed++) {
+        m_tx_used -= m_tx_sizes[m_completed % m_buf_packets];
+    }
+    m_tx_irq_index = irq_index;
+    m_tx_irq_cycle = cycle & 0x1FFF;
+}
+
+bool
+CdevIsoBackend::queueTransmitPackets()
+{
+    unsigned int batch = 0;
+    size_t batch_offset = m_tx_write_offset;
+
+    while (m_queued + batch - m_completed < m_buf_packets) {
+        uint64_t idx = m_queued + batch;
+
+        // the client needs room for a max size packet
+        size_t waste = 0;
+        if (m_tx_write_offset + m_slot_size > m_buffer_size) {
+            waste = m_buffer_size - m_tx_write_offset;
+        }
+        if (m_tx_used + waste + m_slot_size > m_buffer_size) {
+            // wait until packets are sent
+            break;
+        }
+        if (waste) {
+            // continue at the start of the buffer, this needs a new request
+            if (!queue(m_control, batch, m_buffer + batch_offset)) {
+                return false;
+            }
+            batch = 0;
+            m_tx_write_offset = 0;
+            batch_offset = 0;
+        }
+
+        int cycle = -1;
+        if (m_tx_irq_index >= 0) {
+            cycle = (m_tx_irq_cycle + (idx - m_tx_irq_index)) % CYCLES_PER_SECOND;
+        } else if (m_start_cycle >= 0) {
+            cycle = (m_start_cycle + idx) % CYCLES_PER_SECOND;
+        }
+
+        unsigned int length = 0;
+        unsigned char tag = 0;
+        unsigned char sy = 0;
+        enum raw1394_iso_disposition retval =
+            m_client.getPacket(m_buffer + m_tx_write_offset, &length, &tag, &sy, cycle, 0, 0);
+        if (retval == RAW1394_ISO_DEFER || retval == RAW1394_ISO_AGAIN) {
+            break;
+        } else if (retval == RAW1394_ISO_ERROR) {
+            debugError("Client error on cycle %d\n", cycle);
+            return false;
+        }
+        if (length > m_slot_size) {
+            debugError("Packet too large: %u > %u\n", length, m_slot_size);
+            return false;
+        }
+
+        uint32_t control = FW_CDEV_ISO_PAYLOAD_LENGTH(length)
+                           | FW_CDEV_ISO_TAG(tag) | FW_CDEV_ISO_SY(sy);
+        if ((idx + 1) % m_irq_interval == 0) {
+            control |= FW_CDEV_ISO_INTERRUPT;
+        }
+        m_control[batch++] = control;
+        // the wasted space is freed together with this packet
+        m_tx_sizes[idx % m_buf_packets] = waste + length;
+        m_tx_used += waste + length;
+        m_tx_write_offset += length;
+    }
+    return queue(m_control, batch, m_buffer + batch_offset);
+}
+
+bool
+CdevIsoBackend::start(int cycle)
+{
+    if (!m_ctx_created) {
+        debugError("No iso context\n");
+        return false;
+    }
+    m_start_cycle = cycle;
+    m_queued = 0;
+    m_completed = 0;
+    m_rx_nb_headers = 0;
+    m_rx_header_idx = 0;
+    m_tx_used = 0;
+    m_tx_write_offset = 0;
+    m_tx_irq_index = -1;
+
+    // prime the DMA program
+    if (m_receive) {
+        if (!queueReceiveSlots()) return false;
+    } else {
+        if (!queueTransmitPackets()) return false;
+    }
+
+    struct fw_cdev_start_iso start_iso;
+    start_iso.cycle = cycle;
+    start_iso.sync = 0;
+    start_iso.tags = FW_CDEV_ISO_CONTEXT_MATCH_ALL_TAGS;
+    start_iso.handle = m_ctx_handle;
+    if (ioctl(m_fd, FW_CDEV_IOC_START_ISO, &start_iso) < 0) {
+        debugFatal("Could not start iso context (%s)\n", strerror(errno));
+        return false;
+    }
+    m_running = true;
+    return true;
+}
+
+void
+CdevIsoBackend::stop()
+{
+    if (!m_running) return;
+    struct fw_cdev_stop_iso stop_iso;
+    stop_iso.handle = m_ctx_handle;
+    if (ioctl(m_fd, FW_CDEV_IOC_STOP_ISO, &stop_iso) < 0) {
+        debugWarning("Could not stop iso context: %s\n", strerror(errno));
+    }
+    m_running = false;
+}
+
+void
+CdevIsoBackend::flush()
+{
+#ifdef FW_CDEV_IOC_FLUSH_ISO
+    if (m_receive && m_running) {
+        struct fw_cdev_flush_iso flush_iso;
+        flush_iso.handle = m_ctx_handle;
+        ioctl(m_fd, FW_CDEV_IOC_FLUSH_ISO, &flush_iso);
+    }
+#endif
+}
+
+bool
+CdevIsoBackend::iterate()
+{
+    if (!m_running) return true;
+
+    if (m_receive) {
+        // the client is done with the packets of the previous iterate
+        if (!queueReceiveSlots()) return false;
+        // first the packets the client deferred
+        if (!processReceivePackets()) return false;
+    }
+
+    // only read new events when all received packets are handled
+    while (!m_receive || m_rx_header_idx >= m_rx_nb_headers) {
+        ssize_t len = read(m_fd, m_event_buffer, m_event_buffer_size);
+        if (len < 0) {
+            if (errno == EAGAIN || errno == EINTR) break;
+            debugError("Could not read event: %s\n", strerror(errno));
+            return false;
+        }
+        struct fw_cdev_event_common *common = (struct fw_cdev_event_common *)m_event_buffer;
+        if (common->type != FW_CDEV_EVENT_ISO_INTERRUPT) {
+            // bus resets are handled through the Ieee1394Service
+            continue;
+        }
+        struct fw_cdev_event_iso_interrupt *irq = (struct fw_cdev_event_iso_interrupt *)m_event_buffer;
+        if (m_receive) {
+            m_rx_headers = irq->header;
+            m_rx_nb_headers = irq->header_length / CDEV_RX_HEADER_SIZE;
+            m_rx_header_idx = 0;
+            if (!processReceivePackets()) return false;
+        } else {
+            handleTransmitInterrupt(irq->cycle);
+        }
+        if (!m_running) return true;
+    }
+
+    if (!m_receive) {
+        // refill the buffer space that was freed
+        if (!queueTransmitPackets()) return false;
+    }
+    return true;
+}
+
+#endif /* HAVE_FIREWIRE_CDEV */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_CDEVISOBACKEND__
+#define __FFADO_CDEVISOBACKEND__
+
+#include "IsoBackend.h"
+
+#include <stdint.h>
+#include <string>
+
+/*!
+\brief ISO backend talking directly to the firewire-cdev interface
+
+ Bypasses the libraw1394 iso layer. The DMA buffer of the iso context is
+ mmap'ed and the packets are handed to the client in place:
+ - receive packets are read from fixed size slots. A slot is only given
+   back to the kernel on the next iterate(), so the packets of one
+   iterate stay valid while the client processes them.
+ - transmit packets are written by the client directly into the buffer,
+   back to back, such that a whole run of packets can be queued with one
+   ioctl.
+
+ Only the packet-per-buffer receive mode is supported.
+*/
+class CdevIsoBackend : public IsoBackend
+{
+public:
+    CdevIsoBackend(Client &client, int port);
+    virtual ~CdevIsoBackend();
+
+    const char *getName() {return "cdev";};
+
+    bool open();
+    void close();
+
+    bool initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                     int channel, enum raw1394_iso_dma_recv_mode mode,
+                     int irq_interval);
+    bool initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                      int channel, enum raw1394_iso_speed speed,
+                      int irq_interval);
+
+    bool start(int cycle);
+    void stop();
+
+    int getFileDescriptor() {return m_fd;};
+    bool iterate();
+    void flush();
+
+private:
+    bool findLocalDevice(std::string &path);
+    bool init(unsigned int buf_packets, unsigned int max_packet_size,
+              int channel, int speed, int irq_interval);
+    bool queue(uint32_t *control, unsigned int nb_packets, unsigned char *data);
+    bool queueReceiveSlots();
+    bool queueTransmitPackets();
+    bool processReceivePackets();
+    void handleTransmitInterrupt(uint32_t cycle);
+    bool readEvent();
+
+    int             m_fd;
+    uint32_t        m_ctx_handle;
+    bool            m_ctx_created;
+    bool            m_receive;
+    bool            m_running;
+    int             m_start_cycle;
+
+    unsigned char * m_buffer;
+    size_t          m_buffer_size;
+    unsigned int    m_buf_packets;
+    unsigned int    m_slot_size;
+    int             m_channel;
+    int             m_irq_interval;
+
+    // the control words of a QUEUE_ISO request
+    uint32_t *      m_control;
+
+    // running packet counters
+    uint64_t        m_queued;       ///< queued to the kernel
+    uint64_t        m_completed;    ///< handed to the client (rx) / sent (tx)
+
+    // receive: the headers of the last interrupt not yet processed
+    unsigned char * m_event_buffer;
+    size_t          m_event_buffer_size;
+    uint32_t *      m_rx_headers;
+    unsigned int    m_rx_nb_headers;
+    unsigned int    m_rx_header_idx;
+
+    // transmit: the packets are written back to back in the buffer,
+    // which is used as a ring
+    size_t *        m_tx_sizes;     ///< buffer space taken per packet
+    size_t          m_tx_used;
+    size_t          m_tx_write_offset;
+    int64_t         m_tx_irq_index; ///< the last packet that raised an interrupt
+    int             m_tx_irq_cycle; ///< and the cycle it was sent on
+};
+
+#endif /* __FFADO_CDEVISOBACKEND__ */
@@ -0,0 +1,252 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "FakeIsoBackend.h"
+#include "cycletimer.h"
+
+#include "libutil/SystemTimeSource.h"
+
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <errno.h>
+#include <cstring>
+
+FakeIsoBackend::FakeIsoBackend(Client &client, int port)
+    : IsoBackend(client, port)
+    , m_timer_fd( -1 )
+    , m_buffer( NULL )
+    , m_buf_packets( 0 )
+    , m_max_packet_size( 0 )
+    , m_channel( -1 )
+    , m_irq_interval( 1 )
+    , m_receive( false )
+    , m_running( false )
+    , m_free_running( true )
+    , m_pending_cycles( 0 )
+    , m_start_usecs( 0 )
+    , m_start_cycle( 0 )
+    , m_cycles_done( 0 )
+    , m_packets( 0 )
+    , m_bytes( 0 )
+    , m_dropped( 0 )
+    , m_defers( 0 )
+{
+}
+
+FakeIsoBackend::~FakeIsoBackend()
+{
+    close();
+}
+
+bool
+FakeIsoBackend::open()
+{
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    if (m_timer_fd < 0) {
+        debugError("Could not create timer: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void
+FakeIsoBackend::close()
+{
+    stop();
+    if (m_timer_fd >= 0) {
+        ::close(m_timer_fd);
+        m_timer_fd = -1;
+    }
+    delete[] m_buffer;
+    m_buffer = NULL;
+}
+
+bool
+FakeIsoBackend::init(unsigned int buf_packets, unsigned int max_packet_size,
+                     int channel, int irq_interval)
+{
+    if (buf_packets == 0 || max_packet_size == 0) {
+        debugError("Invalid buffer: %u packets of %u bytes\n", buf_packets, max_packet_size);
+        return false;
+    }
+    delete[] m_buffer;
+    m_buffer = new unsigned char[buf_packets * max_packet_size];
+    memset(m_buffer, 0, buf_packets * max_packet_size);
+    m_buf_packets = buf_packets;
+    m_max_packet_size = max_packet_size;
+    m_channel = channel;
+    // same default as libraw1394
+    m_irq_interval = (irq_interval > 0 ? irq_interval : (int)buf_packets / 4);
+    if (m_irq_interval <= 0) m_irq_interval = 1;
+    return true;
+}
+
+bool
+FakeIsoBackend::initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                            int channel, enum raw1394_iso_dma_recv_mode mode,
+                            int irq_interval)
+{
+    m_receive = true;
+    return init(buf_packets, max_packet_size, channel, irq_interval);
+}
+
+bool
+FakeIsoBackend::initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                             int channel, enum raw1394_iso_speed speed,
+                             int irq_interval)
+{
+    m_receive = false;
+    return init(buf_packets, max_packet_size, channel, irq_interval);
+}
+
+bool
+FakeIsoBackend::start(int cycle)
+{
+    if (m_buffer == NULL) {
+        debugError("Not initialized\n");
+        return false;
+    }
+    m_start_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    m_start_cycle = getStartCycle(cycle);
+    m_cycles_done = 0;
+
+    if (m_free_running && m_timer_fd >= 0) {
+        // fire once per irq interval
+        struct itimerspec its;
+        long long int nsecs = m_irq_interval * USECS_PER_CYCLE * 1000LL;
+        its.it_value.tv_sec = nsecs / 1000000000LL;
+        its.it_value.tv_nsec = nsecs % 1000000000LL;
+        its.it_interval = its.it_value;
+        if (timerfd_settime(m_timer_fd, 0, &its, NULL) < 0) {
+            debugError("Could not start timer: %s\n", strerror(errno));
+            return false;
+        }
+    }
+    m_running = true;
+    return true;
+}
+
+void
+FakeIsoBackend::stop()
+{
+    if (!m_running) return;
+    if (m_timer_fd >= 0) {
+        struct itimerspec its;
+        memset(&its, 0, sizeof(its));
+        timerfd_settime(m_timer_fd, 0, &its, NULL);
+    }
+    m_running = false;
+}
+
+uint64_t
+FakeIsoBackend::getCyclesElapsed()
+{
+    uint64_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    return (now - m_start_usecs) / USECS_PER_CYCLE;
+}
+
+bool
+FakeIsoBackend::iterate()
+{
+    if (!m_running) return true;
+
+    if (m_timer_fd >= 0) {
+        uint64_t expirations;
+        // clear the timer, it doesn't matter whether it expired
+        if (read(m_timer_fd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN) {
+            debugError("Could not read timer: %s\n", strerror(errno));
+            return false;
+        }
+    }
+
+    uint64_t due;
+    if (m_free_running) {
+        uint64_t elapsed = getCyclesElapsed();
+        due = (elapsed > m_cycles_done ? elapsed - m_cycles_done : 0);
+    } else {
+        due = m_pending_cycles;
+    }
+
+    // the 'DMA' buffer can't hold more packets, the others are lost
+    unsigned int dropped = 0;
+    if (due > m_buf_packets) {
+        dropped = due - m_buf_packets;
+        debugOutput(DEBUG_LEVEL_VERBOSE, "dropped %u packets\n", dropped);
+        m_dropped += dropped;
+        m_cycles_done += dropped;
+        if (!m_free_running) m_pending_cycles -= dropped;
+        due = m_buf_packets;
+    }
+
+    for (uint64_t i = 0; i < due; i++) {
+        unsigned int cycle = (m_start_cycle + m_cycles_done) % CYCLES_PER_SECOND;
+        unsigned char *data = m_buffer + (m_cycles_done % m_buf_packets) * m_max_packet_size;
+        unsigned int length = 0;
+        unsigned char tag = 0;
+        unsigned char sy = 0;
+        enum raw1394_iso_disposition retval;
+
+        if (m_receive) {
+            tag = 1;
+            length = generatePacket(data, m_max_packet_size, cycle, &tag, &sy);
+            if (length == NO_PACKET) {
+                m_cycles_done++;
+                if (!m_free_running) m_pending_cycles--;
+                continue;
+            }
+            retval = m_client.putPacket(data, length, m_channel, tag, sy, cycle, dropped);
+        } else {
+            retval = m_client.getPacket(data, &length, &tag, &sy, cycle, dropped, 0);
+            if (retval == RAW1394_ISO_OK && length > m_max_packet_size) {
+                debugError("Packet too large: %u > %u\n", length, m_max_packet_size);
+                return false;
+            }
+        }
+
+        if (retval == RAW1394_ISO_DEFER || retval == RAW1394_ISO_AGAIN) {
+            // retry this cycle on the next iterate
+            m_defers++;
+            break;
+        } else if (retval == RAW1394_ISO_ERROR) {
+            debugError("Client error on cycle %u\n", cycle);
+            return false;
+        }
+        if (!m_receive) {
+            consumePacket(data, length, tag, sy, cycle);
+        }
+
+        dropped = 0;
+        m_cycles_done++;
+        if (!m_free_running) m_pending_cycles--;
+        m_packets++;
+        m_bytes += length;
+
+        if (retval == RAW1394_ISO_STOP || retval == RAW1394_ISO_STOP_NOSYNC) {
+            stop();
+            break;
+        }
+    }
+    return true;
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_FAKEISOBACKEND__
+#define __FFADO_FAKEISOBACKEND__
+
+#include "IsoBackend.h"
+#include "cycletimer.h"
+
+#include <stdint.h>
+
+/*!
+\brief An in-process ISO backend without FireWire hardware
+
+ Simulates an iso context: every cycle one packet is received (produced
+ by generatePacket()) or transmitted (consumed by consumePacket()). The
+ packets live in a ring buffer of buf_packets slots, like the kernel's DMA
+ buffer.
+
+ When free running, the cycles follow the system clock and the fd becomes
+ readable every irq_interval cycles. Otherwise only the cycles added with
+ addCycles() are processed, which allows deterministic tests and
+ benchmarks that run as fast as possible.
+
+ @note the cycle numbers are not related to the cycle timer of any bus,
+       unless a subclass provides them (see getStartCycle() and
+       getCyclesElapsed())
+*/
+class FakeIsoBackend : public IsoBackend
+{
+public:
+    FakeIsoBackend(Client &client, int port);
+    virtual ~FakeIsoBackend();
+
+    const char *getName() {return "fake";};
+
+    bool open();
+    void close();
+
+    bool initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                     int channel, enum raw1394_iso_dma_recv_mode mode,
+                     int irq_interval);
+    bool initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                      int channel, enum raw1394_iso_speed speed,
+                      int irq_interval);
+
+    bool start(int cycle);
+    void stop();
+
+    int getFileDescriptor() {return m_timer_fd;};
+    bool iterate();
+
+    void setFreeRunning(bool b) {m_free_running = b;};
+    ///> process n more cycles on the next iterate() (when not free running)
+    void addCycles(unsigned int n) {m_pending_cycles += n;};
+
+    uint64_t getPacketCount() {return m_packets;};
+    uint64_t getByteCount() {return m_bytes;};
+    uint64_t getDroppedCount() {return m_dropped;};
+    unsigned int getDeferCount() {return m_defers;};
+
+    ///> generatePacket() return value for a cycle without packet
+    static const unsigned int NO_PACKET = 0xFFFFFFFF;
+
+protected:
+    /**
+     * produces the payload of a received packet
+     * @return the packet length, the default produces empty packets.
+     *         NO_PACKET skips the cycle, the client doesn't see it.
+     */
+    virtual unsigned int generatePacket(unsigned char *data, unsigned int max_length,
+                                        unsigned int cycle,
+                                        unsigned char *tag, unsigned char *sy)
+        {return 0;};
+    ///> called for every transmitted packet
+    virtual void consumePacket(unsigned char *data, unsigned int length,
+                               unsigned char tag, unsigned char sy,
+                               unsigned int cycle) {};
+
+    ///> the cycle number of the first packet, for start(cycle)
+    virtual unsigned int getStartCycle(int cycle)
+        {return (cycle < 0 ? 0 : cycle % CYCLES_PER_SECOND);};
+    ///> the number of cycles since start() that are due when free running
+    virtual uint64_t getCyclesElapsed();
+
+    int getChannel() {return m_channel;};
+    unsigned int getBufferPackets() {return m_buf_packets;};
+    bool isReceive() {return m_receive;};
+    ///> the number of cycles processed since start()
+    uint64_t getCyclesDone() {return m_cycles_done;};
+
+private:
+    bool init(unsigned int buf_packets, unsigned int max_packet_size,
+              int channel, int irq_interval);
+
+    int             m_timer_fd;
+    unsigned char * m_buffer;
+    unsigned int    m_buf_packets;
+    unsigned int    m_max_packet_size;
+    int             m_channel;
+    int             m_irq_interval;
+    bool            m_receive;
+    bool            m_running;
+
+    bool            m_free_running;
+    unsigned int    m_pending_cycles;
+    uint64_t        m_start_usecs;
+    unsigned int    m_start_cycle;
+    uint64_t        m_cycles_done;
+
+    uint64_t        m_packets;
+    uint64_t        m_bytes;
+    uint64_t        m_dropped;
+    unsigned int    m_defers;
+};
+
+#endif /* __FFADO_FAKEISOBACKEND__ */
@@ -0,0 +1,549 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "FcpEngine.h"
+
+#include "libutil/PosixMutex.h"
+#include "libutil/PosixThread.h"
+#include "libutil/ByteSwap.h"
+
+#include <libraw1394/raw1394.h>
+
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <vector>
+
+/* AV/C FCP response codes */
+#define FCP_RESPONSE_INTERIM 0x0F000000
+
+/* AV/C FCP mask macros */
+#define FCP_MASK_RESPONSE(x) ((x) & 0x0F000000)
+#define FCP_MASK_SUBUNIT_AND_OPCODE(x) ((x) & 0x00FFFF00)
+
+// responses arrive with the bus id, requests are queued on the node number
+#define FCP_NODE_KEY(x) ((x) & 0x3F)
+
+IMPL_DEBUG_MODULE( FcpEngine, FcpEngine, DEBUG_LEVEL_NORMAL );
+
+FcpTransaction::FcpTransaction()
+    : m_nodeId( 0 )
+    , m_request_length( 0 )
+    , m_response_length( 0 )
+    , m_status( eFS_Idle )
+    , m_tries( 0 )
+    , m_deadline( 0 )
+    , m_submit_time( 0 )
+    , m_complete_time( 0 )
+    , m_callback( NULL )
+{
+    sem_init(&m_done, 0, 0);
+}
+
+FcpTransaction::~FcpTransaction()
+{
+    sem_destroy(&m_done);
+}
+
+bool
+FcpTransaction::setRequest( fb_nodeid_t nodeId, const fb_quadlet_t* request,
+                            unsigned int length )
+{
+    if (length > MAX_FCP_BLOCK_SIZE_QUADS) {
+        return false;
+    }
+    m_nodeId = nodeId;
+    memcpy(m_request, request, length * sizeof(fb_quadlet_t));
+    m_request_length = length;
+    return true;
+}
+
+bool
+FcpTransaction::wait()
+{
+    while (sem_wait(&m_done) < 0) {
+        if (errno != EINTR) {
+            return false;
+        }
+    }
+    return m_status == eFS_Responded;
+}
+
+// --- the raw1394 transport
+
+class Raw1394FcpTransport : public FcpEngine::Transport
+{
+public:
+    Raw1394FcpTransport( int port )
+        : m_port( port )
+        , m_handle( NULL )
+        , m_engine( NULL )
+    {};
+    virtual ~Raw1394FcpTransport() {close();};
+
+    virtual bool open( FcpEngine& engine ) {
+        m_engine = &engine;
+        m_handle = raw1394_new_handle_on_port( m_port );
+        if (!m_handle) {
+            return false;
+        }
+        raw1394_set_userdata( m_handle, this );
+        raw1394_set_fcp_handler( m_handle, fcpHandler );
+        // the FCP response range is shared, every listener sees
+        // all responses
+        if (raw1394_start_fcp_listen( m_handle )) {
+            raw1394_destroy_handle( m_handle );
+            m_handle = NULL;
+            return false;
+        }
+        return true;
+    };
+    virtual void close() {
+        if (m_handle) {
+            raw1394_stop_fcp_listen( m_handle );
+            raw1394_destroy_handle( m_handle );
+            m_handle = NULL;
+        }
+    };
+
+    virtual bool sendRequest( fb_nodeid_t nodeId, fb_quadlet_t* data,
+                              unsigned int length ) {
+        return raw1394_write( m_handle, 0xffc0 | nodeId, FCP_COMMAND_ADDR,
+                              length * 4, data ) == 0;
+    };
+    virtual int getFileDescriptor() {return raw1394_get_fd( m_handle );};
+    virtual bool iterate() {return raw1394_loop_iterate( m_handle ) >= 0;};
+
+private:
+    static int fcpHandler( raw1394handle_t handle, nodeid_t nodeid,
+                           int response, size_t length,
+                           unsigned char *data ) {
+        Raw1394FcpTransport *t = static_cast<Raw1394FcpTransport *>(raw1394_get_userdata( handle ));
+        if (t && response) {
+            t->m_engine->handleResponse( nodeid, data, length );
+        }
+        return 0;
+    };
+
+    int             m_port;
+    raw1394handle_t m_handle;
+    FcpEngine*      m_engine;
+};
+
+FcpEngine::Transport*
+FcpEngine::createRaw1394Transport( int port )
+{
+    return new Raw1394FcpTransport( port );
+}
+
+// --- the engine
+
+FcpEngine::FcpEngine( Transport* transport )
+    : m_transport( transport )
+    , m_thread( NULL )
+    , m_lock( new Util::PosixMutex("FCPENG") )
+    , m_wake_fd( -1 )
+    , m_running( false )
+    , m_filter_duplicates( false )
+    , m_nb_transactions( 0 )
+    , m_nb_retries( 0 )
+    , m_nb_failures( 0 )
+{
+}
+
+FcpEngine::~FcpEngine()
+{
+    stop();
+    delete m_transport;
+    delete m_lock;
+}
+
+bool
+FcpEngine::start()
+{
+    m_wake_fd = eventfd(0, EFD_NONBLOCK);
+    if (m_wake_fd < 0) {
+        debugError("Could not create wakeup eventfd (%s)\n", strerror(errno));
+        return false;
+    }
+    if (!m_transport->open( *this )) {
+        debugError("Could not open the FCP transport\n");
+        close(m_wake_fd);
+        m_wake_fd = -1;
+        return false;
+    }
+    m_running = true;
+    m_thread = new Util::PosixThread(this, "FCPENG", false, 0, PTHREAD_CANCEL_DEFERRED);
+    if (m_thread->Start() != 0) {
+        debugError("Could not start the FCP engine thread\n");
+        delete m_thread;
+        m_thread = NULL;
+        m_running = false;
+        m_transport->close();
+        close(m_wake_fd);
+        m_wake_fd = -1;
+        return false;
+    }
+    return true;
+}
+
+void
+FcpEngine::stop()
+{
+    if (m_thread == NULL) {
+        return;
+    }
+    m_running = false;
+    wakeUp();
+    m_thread->Stop();
+    delete m_thread;
+    m_thread = NULL;
+
+    // fail whatever didn't complete
+    std::vector< FcpTransaction* > pending;
+    m_lock->Lock();
+    for ( NodeStateMap::iterator it = m_nodes.begin();
+          it != m_nodes.end();
+          ++it )
+    {
+        NodeState& node = it->second;
+        if (node.in_flight) {
+            pending.push_back(node.in_flight);
+            node.in_flight = NULL;
+        }
+        pending.insert(pending.end(), node.queue.begin(), node.queue.end());
+        node.queue.clear();
+    }
+    m_lock->Unlock();
+    for ( std::vector< FcpTransaction* >::iterator it = pending.begin();
+          it != pending.end();
+          ++it )
+    {
+        complete(*it, FcpTransaction::eFS_Error);
+    }
+
+    m_transport->close();
+    close(m_wake_fd);
+    m_wake_fd = -1;
+}
+
+bool
+FcpEngine::submit( FcpTransaction& t )
+{
+    if (!m_running) {
+        debugError("FCP engine not running\n");
+        return false;
+    }
+    if (t.m_request_length == 0) {
+        debugError("Empty FCP request\n");
+        return false;
+    }
+    // a transaction that is only used with callbacks is never waited for
+    while (sem_trywait(&t.m_done) == 0) {};
+
+    t.m_status = FcpTransaction::eFS_Queued;
+    t.m_tries = 0;
+    t.m_deadline = 0;
+    t.m_response_length = 0;
+    t.m_submit_time = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+
+    m_lock->Lock();
+    m_nodes[FCP_NODE_KEY(t.m_nodeId)].queue.push_back(&t);
+    m_nb_transactions++;
+    m_lock->Unlock();
+
+    wakeUp();
+    return true;
+}
+
+bool
+FcpEngine::transact( FcpTransaction& t )
+{
+    if (!submit( t )) {
+        return false;
+    }
+    return t.wait();
+}
+
+void
+FcpEngine::complete( FcpTransaction* t, enum FcpTransaction::eStatus status )
+{
+    if (status != FcpTransaction::eFS_Responded) {
+        m_nb_failures++;
+    }
+    t->m_complete_time = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    t->m_status = status;
+    if (t->m_callback) {
+        (*t->m_callback)();
+    }
+    // the transaction can be gone as soon as it is signaled
+    sem_post(&t->m_done);
+}
+
+bool
+FcpEngine::retryOrFail( NodeState& node, FcpTransaction* t, ffado_microsecs_t now )
+{
+    if (t->m_tries >= IEEE1394SERVICE_FCP_MAX_TRIES) {
+        debugError("FCP transaction to node %d didn't succeed in %d tries\n",
+                   t->m_nodeId, IEEE1394SERVICE_FCP_MAX_TRIES);
+        return false;
+    }
+    debugOutput(DEBUG_LEVEL_VERBOSE, "FCP transaction try %u to node %d failed\n",
+                t->m_tries, t->m_nodeId);
+    t->m_status = FcpTransaction::eFS_Queued;
+    t->m_deadline = now + IEEE1394SERVICE_FCP_SLEEP_BETWEEN_FAILURES_USECS;
+    node.queue.push_front(t);
+    m_nb_retries++;
+    return true;
+}
+
+void
+FcpEngine::wakeUp()
+{
+    uint64_t one = 1;
+    if (m_wake_fd >= 0 && write(m_wake_fd, &one, sizeof(one)) != sizeof(one)) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Could not wake up the FCP engine\n");
+    }
+}
+
+bool
+FcpEngine::Init()
+{
+    return true;
+}
+
+bool
+FcpEngine::Execute()
+{
+    if (!m_running) {
+        return false;
+    }
+
+    std::vector< FcpTransaction* > to_send;
+    std::vector< FcpTransaction* > failed;
+    ffado_microsecs_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    ffado_microsecs_t next_deadline = now + IEEE1394SERVICE_FCP_POLL_TIMEOUT_MSEC * 1000;
+
+    m_lock->Lock();
+    for ( NodeStateMap::iterator it = m_nodes.begin();
+          it != m_nodes.end();
+          ++it )
+    {
+        NodeState& node = it->second;
+        FcpTransaction* t = node.in_flight;
+        if (t && t->m_deadline <= now) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "FCP response from node %d timed out\n", t->m_nodeId);
+            node.in_flight = NULL;
+            if (!retryOrFail( node, t, now )) {
+                failed.push_back(t);
+            }
+        }
+        if (node.in_flight == NULL && !node.queue.empty()
+            && node.queue.front()->m_deadline <= now) {
+            t = node.queue.front();
+            node.queue.pop_front();
+            t->m_status = FcpTransaction::eFS_Waiting;
+            t->m_tries++;
+            t->m_deadline = now + IEEE1394SERVICE_FCP_RESPONSE_TIMEOUT_USEC;
+            node.in_flight = t;
+            to_send.push_back(t);
+        }
+        if (node.in_flight && node.in_flight->m_deadline < next_deadline) {
+            next_deadline = node.in_flight->m_deadline;
+        } else if (node.in_flight == NULL && !node.queue.empty()
+                   && node.queue.front()->m_deadline < next_deadline) {
+            next_deadline = node.queue.front()->m_deadline;
+        }
+    }
+    m_lock->Unlock();
+
+    for ( std::vector< FcpTransaction* >::iterator it = failed.begin();
+          it != failed.end();
+          ++it )
+    {
+        complete(*it, FcpTransaction::eFS_TimedOut);
+    }
+
+    // the response can arrive while the request is sent, the
+    // transaction is in flight before it is sent
+    for ( std::vector< FcpTransaction* >::iterator it = to_send.begin();
+          it != to_send.end();
+          ++it )
+    {
+        FcpTransaction* t = *it;
+        fb_nodeid_t nodeId = t->m_nodeId;
+        #ifdef DEBUG
+        debugOutput(DEBUG_LEVEL_VERY_VERBOSE, "fcp request: node 0x%hX, length = %d bytes\n",
+                    nodeId, t->m_request_length * 4);
+        #endif
+        if (m_transport->sendRequest( nodeId, t->m_request, t->m_request_length )) {
+            continue;
+        }
+        debugOutput(DEBUG_LEVEL_VERBOSE, "write of FCP request to node %d failed\n", nodeId);
+        bool fail = false;
+        m_lock->Lock();
+        NodeState& node = m_nodes[FCP_NODE_KEY(nodeId)];
+        if (node.in_flight == t) {
+            node.in_flight = NULL;
+            fail = !retryOrFail( node, t, now );
+        }
+        m_lock->Unlock();
+        if (fail) {
+            complete(t, FcpTransaction::eFS_Error);
+        }
+    }
+
+    // wait for responses, submissions or the next deadline
+    struct pollfd fds[2];
+    fds[0].fd = m_transport->getFileDescriptor();
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wake_fd;
+    fds[1].events = POLLIN;
+
+    now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    int timeout_msecs = 0;
+    if (next_deadline > now) {
+        timeout_msecs = (next_deadline - now + 999) / 1000;
+    }
+    if (!to_send.empty()) {
+        // new requests might be queued for the nodes that were busy
+        timeout_msecs = 0;
+    }
+
+    int err = poll(fds, 2, timeout_msecs);
+    if (err < 0) {
+        if (errno == EINTR) {
+            return true;
+        }
+        debugError("poll failed: %s\n", strerror(errno));
+        return false;
+    }
+    if (fds[0].revents & POLLIN) {
+        if (!m_transport->iterate()) {
+            debugError("Failed to iterate the FCP transport\n");
+            return false;
+        }
+    }
+    if (fds[1].revents & POLLIN) {
+        uint64_t count;
+        if (read(m_wake_fd, &count, sizeof(count)) < 0) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "wakeup read failed\n");
+        }
+    }
+    return true;
+}
+
+void
+FcpEngine::handleResponse( fb_nodeid_t nodeId, const unsigned char* data, size_t length )
+{
+    const fb_quadlet_t *data_quads = (const fb_quadlet_t *)data;
+    #ifdef DEBUG
+    debugOutput(DEBUG_LEVEL_VERY_VERBOSE, "fcp response: node 0x%hX, length = %zd bytes\n",
+                nodeId, length);
+    #endif
+
+    if (length < 4) {
+        return;
+    }
+    if (length > MAX_FCP_BLOCK_SIZE_BYTES) {
+        length = MAX_FCP_BLOCK_SIZE_BYTES;
+        debugWarning("Truncated FCP response\n");
+    }
+
+    // is it an actual response or is it INTERIM?
+    quadlet_t first_quadlet = CondSwapFromBus32(data_quads[0]);
+    if (FCP_MASK_RESPONSE(first_quadlet) == FCP_RESPONSE_INTERIM) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "INTERIM\n");
+        return;
+    }
+    if (first_quadlet == 0) {
+        debugWarning("Bogus FCP response\n");
+        return;
+    }
+#ifdef DEBUG
+    if (FCP_MASK_RESPONSE(first_quadlet) < 0x08000000) {
+        debugWarning("Bogus AV/C FCP response code\n");
+        return;
+    }
+#endif
+
+    m_lock->Lock();
+    NodeStateMap::iterator it = m_nodes.find(FCP_NODE_KEY(nodeId));
+    FcpTransaction* t = (it == m_nodes.end() ? NULL : it->second.in_flight);
+    if (t == NULL) {
+        // e.g. a response to another program on this host
+        debugOutput(DEBUG_LEVEL_VERBOSE, "FCP response from node 0x%hX without request\n", nodeId);
+        m_lock->Unlock();
+        return;
+    }
+    NodeState& node = it->second;
+    if (FCP_MASK_SUBUNIT_AND_OPCODE(first_quadlet)
+        != FCP_MASK_SUBUNIT_AND_OPCODE(CondSwapFromBus32(t->m_request[0]))) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "FCP response not for this request: %08X != %08X\n",
+                     FCP_MASK_SUBUNIT_AND_OPCODE(first_quadlet),
+                     FCP_MASK_SUBUNIT_AND_OPCODE(CondSwapFromBus32(t->m_request[0])));
+        m_lock->Unlock();
+        return;
+    }
+    unsigned int response_length = (length + sizeof(quadlet_t) - 1) / sizeof(quadlet_t);
+    if (m_filter_duplicates && response_length == node.last_response_length
+        && memcmp(node.last_response, data, length) == 0) {
+        // The Edirol FA-101 tends to send more than one response to one
+        // request, this seems to happen when discovering function blocks.
+        // The downside of this approach is that the same FCP can't be
+        // issued twice in a row.
+        debugWarning("Received duplicate FCP response. Ignore it\n");
+        m_lock->Unlock();
+        return;
+    }
+
+    memset(t->m_response, 0, response_length * sizeof(quadlet_t));
+    memcpy(t->m_response, data, length);
+    t->m_response_length = response_length;
+    if (m_filter_duplicates) {
+        memset(node.last_response, 0, response_length * sizeof(quadlet_t));
+        memcpy(node.last_response, data, length);
+        node.last_response_length = response_length;
+    }
+    node.in_flight = NULL;
+    m_lock->Unlock();
+
+    complete(t, FcpTransaction::eFS_Responded);
+}
+
+void
+FcpEngine::setVerboseLevel( int l )
+{
+    setDebugLevel(l);
+}
+
+void
+FcpEngine::show()
+{
+    debugOutput(DEBUG_LEVEL_NORMAL, " FCP transactions: %u, retries: %u, failures: %u\n",
+                m_nb_transactions, m_nb_retries, m_nb_failures);
+}
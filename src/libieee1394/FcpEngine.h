@@ -0,0 +1,229 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_FCPENGINE__
+#define __FFADO_FCPENGINE__
+
+#include "fbtypes.h"
+#include "debugmodule/debugmodule.h"
+
+#include "libutil/Functors.h"
+#include "libutil/Mutex.h"
+#include "libutil/Thread.h"
+#include "libutil/SystemTimeSource.h"
+
+#include <semaphore.h>
+#include <deque>
+#include <map>
+
+#define MAX_FCP_BLOCK_SIZE_BYTES (512)
+#define MAX_FCP_BLOCK_SIZE_QUADS (MAX_FCP_BLOCK_SIZE_BYTES / 4)
+
+#define FCP_COMMAND_ADDR   0xFFFFF0000B00ULL
+#define FCP_RESPONSE_ADDR  0xFFFFF0000D00ULL
+
+/**
+ * @brief One FCP request/response pair
+ *
+ * A transaction is submitted to an FcpEngine and completes when the
+ * response arrived, or when all tries timed out. The completion can be
+ * waited for with wait(), or signaled through a callback. The callback
+ * is called from the engine thread before wait() is released, so it
+ * should be short, and it must not free the transaction.
+ *
+ * The transaction is owned by the caller and shouldn't be touched
+ * between submit and completion. It can only be freed once wait()
+ * returned, isComplete() is already true while the callback runs.
+ */
+class FcpTransaction
+{
+public:
+    enum eStatus {
+        eFS_Idle,
+        eFS_Queued,
+        eFS_Waiting,
+        eFS_Responded,
+        eFS_TimedOut,
+        eFS_Error,
+    };
+
+    FcpTransaction();
+    ~FcpTransaction();
+
+    bool setRequest( fb_nodeid_t nodeId, const fb_quadlet_t* request,
+                     unsigned int length );
+    void setCallback( Util::Functor* callback ) {m_callback = callback;};
+
+    /**
+     * @brief wait until the transaction is complete
+     * @return true if a response arrived
+     */
+    bool wait();
+    bool isComplete() {return m_status >= eFS_Responded;};
+    enum eStatus getStatus() {return m_status;};
+
+    fb_nodeid_t getNodeId() {return m_nodeId;};
+    fb_quadlet_t* getResponse() {return m_response;};
+    ///> the response length in quadlets
+    unsigned int getResponseLength() {return m_response_length;};
+    ///> the time between the submit and the completion
+    ffado_microsecs_t getLatencyUsecs() {return m_complete_time - m_submit_time;};
+
+private:
+    friend class FcpEngine;
+
+    fb_nodeid_t         m_nodeId;
+    unsigned int        m_request_length;
+    fb_quadlet_t        m_request[MAX_FCP_BLOCK_SIZE_QUADS];
+    unsigned int        m_response_length;
+    fb_quadlet_t        m_response[MAX_FCP_BLOCK_SIZE_QUADS];
+
+    volatile enum eStatus m_status;
+    unsigned int        m_tries;
+    // the response timeout when waiting, the earliest retry when queued
+    ffado_microsecs_t   m_deadline;
+    ffado_microsecs_t   m_submit_time;
+    ffado_microsecs_t   m_complete_time;
+
+    Util::Functor*      m_callback;
+    sem_t               m_done;
+};
+
+/**
+ * @brief Executes FCP (AV/C) transactions asynchronously
+ *
+ * AV/C allows one outstanding command per target, and the response
+ * can only be matched to the request by node, subunit and opcode. The
+ * engine therefore queues the transactions per node and keeps one of
+ * them in flight for every node. Transactions to different nodes are
+ * in flight at the same time, which hides the response latency of the
+ * devices when several of them are accessed.
+ *
+ * One thread sends the requests, receives the responses through the
+ * Transport and handles timeouts and retries.
+ */
+class FcpEngine : public Util::RunnableInterface
+{
+public:
+    /**
+     * @brief the bus side of the engine
+     *
+     * sendRequest() and iterate() are only called from the engine
+     * thread. iterate() passes the received responses to
+     * FcpEngine::handleResponse().
+     */
+    class Transport
+    {
+    public:
+        virtual ~Transport() {};
+
+        virtual bool open( FcpEngine& engine ) = 0;
+        virtual void close() = 0;
+
+        virtual bool sendRequest( fb_nodeid_t nodeId, fb_quadlet_t* data,
+                                  unsigned int length ) = 0;
+        ///> the fd to poll for responses
+        virtual int getFileDescriptor() = 0;
+        ///> process the available responses, should not block
+        virtual bool iterate() = 0;
+    };
+
+    /**
+     * @param transport the transport to use, owned by the engine
+     */
+    FcpEngine( Transport* transport );
+    virtual ~FcpEngine();
+
+    ///> create the raw1394 transport for a port
+    static Transport* createRaw1394Transport( int port );
+
+    bool start();
+    /**
+     * @brief stop the engine thread
+     * the transactions that didn't complete yet fail
+     */
+    void stop();
+
+    /**
+     * @brief queue a transaction
+     * @return false if the transaction can't be queued
+     */
+    bool submit( FcpTransaction& t );
+    /**
+     * @brief submit a transaction and wait for its completion
+     * @return true if a response arrived
+     */
+    bool transact( FcpTransaction& t );
+
+    /**
+     * The workaround for the Edirol FA-101, that sends more than one
+     * response to a request: drop a response that is identical to the
+     * previous response of that node.
+     */
+    void setFilterDuplicateResponses( bool enable ) {m_filter_duplicates = enable;};
+
+    ///> called by the transport for every received FCP response
+    void handleResponse( fb_nodeid_t nodeId, const unsigned char* data, size_t length );
+
+    unsigned int getNbTransactions() {return m_nb_transactions;};
+    unsigned int getNbRetries() {return m_nb_retries;};
+    unsigned int getNbFailures() {return m_nb_failures;};
+
+    // the engine thread
+    virtual bool Init();
+    virtual bool Execute();
+
+    void setVerboseLevel( int l );
+    void show();
+
+private:
+    struct NodeState {
+        NodeState() : in_flight( NULL ), last_response_length( 0 ) {};
+        std::deque< FcpTransaction* > queue;
+        FcpTransaction* in_flight;
+        unsigned int last_response_length;
+        fb_quadlet_t last_response[MAX_FCP_BLOCK_SIZE_QUADS];
+    };
+    typedef std::map< fb_nodeid_t, NodeState > NodeStateMap;
+
+    void complete( FcpTransaction* t, enum FcpTransaction::eStatus status );
+    bool retryOrFail( NodeState& node, FcpTransaction* t, ffado_microsecs_t now );
+    void wakeUp();
+
+    Transport*      m_transport;
+    Util::Thread*   m_thread;
+    Util::Mutex*    m_lock;
+    NodeStateMap    m_nodes;
+    int             m_wake_fd;
+    volatile bool   m_running;
+    bool            m_filter_duplicates;
+
+    // statistics
+    unsigned int    m_nb_transactions;
+    unsigned int    m_nb_retries;
+    unsigned int    m_nb_failures;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+#endif /* __FFADO_FCPENGINE__ */
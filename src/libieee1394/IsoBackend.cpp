@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "IsoBackend.h"
+#include "Raw1394IsoBackend.h"
+#include "CdevIsoBackend.h"
+#include "FakeIsoBackend.h"
+#include "LoopbackIsoBackend.h"
+
+IMPL_DEBUG_MODULE( IsoBackend, IsoBackend, DEBUG_LEVEL_NORMAL );
+
+IsoBackend::IsoBackend(Client &client, int port)
+    : m_client( client )
+    , m_port( port )
+{
+}
+
+IsoBackend *
+IsoBackend::create(enum EBackendType type, Client &client, int port)
+{
+    switch (type) {
+        case eBT_Raw1394:
+            return new Raw1394IsoBackend(client, port);
+        case eBT_Cdev:
+#if HAVE_FIREWIRE_CDEV
+            return new CdevIsoBackend(client, port);
+#else
+            debugError("This build has no firewire-cdev support\n");
+            return NULL;
+#endif
+        case eBT_Fake:
+            return new FakeIsoBackend(client, port);
+        case eBT_Loopback:
+            return new LoopbackIsoBackend(client, port);
+    }
+    return NULL;
+}
+
+bool
+IsoBackend::stringToType(const std::string &name, enum EBackendType &type)
+{
+    if (name == "raw1394") {
+        type = eBT_Raw1394;
+    } else if (name == "cdev") {
+        type = eBT_Cdev;
+    } else if (name == "fake") {
+        type = eBT_Fake;
+    } else if (name == "loopback") {
+        type = eBT_Loopback;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *
+IsoBackend::typeToString(enum EBackendType type)
+{
+    switch (type) {
+        case eBT_Raw1394: return "raw1394";
+        case eBT_Cdev:    return "cdev";
+        case eBT_Fake:    return "fake";
+        case eBT_Loopback: return "loopback";
+    }
+    return "unknown";
+}
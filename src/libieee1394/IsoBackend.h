@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_ISOBACKEND__
+#define __FFADO_ISOBACKEND__
+
+#include "debugmodule/debugmodule.h"
+
+#include <libraw1394/raw1394.h>
+#include <string>
+
+/*!
+\brief The interface between an ISO handler and the kernel
+
+ An IsoBackend moves ISO packets between the kernel (or a simulation of
+ it) and one client. The packet callbacks and their return values are the
+ ones of libraw1394, since that is what the stream processors are written
+ against. The packet data pointers handed to the client point into the
+ backend's buffers, the client reads or writes the packet in place.
+
+ The owner polls the file descriptor and calls iterate() when it is
+ readable. iterate() never blocks.
+*/
+class IsoBackend
+{
+public:
+    enum EBackendType {
+        eBT_Raw1394,
+        eBT_Cdev,
+        eBT_Fake,
+        eBT_Loopback
+    };
+
+    /**
+     * The packet consumer/producer of a backend
+     */
+    class Client
+    {
+    public:
+        virtual ~Client() {};
+
+        /**
+         * called for every received packet
+         * @param cycle the cycle the packet was received on
+         * @param dropped the number of packets dropped before this one,
+         *                if known by the backend
+         */
+        virtual enum raw1394_iso_disposition
+                putPacket(unsigned char *data, unsigned int length,
+                          unsigned char channel, unsigned char tag, unsigned char sy,
+                          unsigned int cycle, unsigned int dropped) = 0;
+        /**
+         * called for every packet to be transmitted
+         * @param data the buffer to write the packet to, has room for
+         *             the max_packet_size passed to initTransmit()
+         * @param cycle the cycle the packet will be sent on, -1 if unknown
+         */
+        virtual enum raw1394_iso_disposition
+                getPacket(unsigned char *data, unsigned int *length,
+                          unsigned char *tag, unsigned char *sy,
+                          int cycle, unsigned int dropped, unsigned int skipped) = 0;
+    };
+
+    IsoBackend(Client &client, int port);
+    virtual ~IsoBackend() {};
+
+    /**
+     * @brief create a backend
+     * @return the backend, or NULL if the type isn't supported by this build
+     */
+    static IsoBackend *create(enum EBackendType type, Client &client, int port);
+    static bool stringToType(const std::string &name, enum EBackendType &type);
+    static const char *typeToString(enum EBackendType type);
+
+    virtual const char *getName() = 0;
+
+    ///> acquire the resources for the port
+    virtual bool open() = 0;
+    ///> release all resources, implies stop()
+    virtual void close() = 0;
+
+    virtual bool initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                             int channel, enum raw1394_iso_dma_recv_mode mode,
+                             int irq_interval) = 0;
+    virtual bool initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                              int channel, enum raw1394_iso_speed speed,
+                              int irq_interval) = 0;
+
+    ///> start the iso context on the given cycle (-1 = as soon as possible)
+    virtual bool start(int cycle) = 0;
+    virtual void stop() = 0;
+
+    ///> the fd to poll for events
+    virtual int getFileDescriptor() = 0;
+    ///> process the available events, calls the client's packet callbacks
+    virtual bool iterate() = 0;
+    ///> make sure that all received packets are seen by the next iterate()
+    virtual void flush() {};
+    ///> wake up any thread blocked in the backend
+    virtual void wakeUp() {};
+    ///> update the backend state after a bus reset
+    virtual bool handleBusReset() {return true;};
+
+    virtual void setVerboseLevel(int l) {setDebugLevel(l);};
+
+protected:
+    Client& m_client;
+    int     m_port;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+#endif /* __FFADO_ISOBACKEND__ */
@@ -35,8 +35,12 @@
 #include "libutil/Configuration.h"
 
 #include <cstring>
+#include <algorithm>
 #include <unistd.h>
 #include <assert.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
 
 IMPL_DEBUG_MODULE( IsoHandlerManager, IsoHandlerManager, DEBUG_LEVEL_NORMAL );
 IMPL_DEBUG_MODULE( IsoHandlerManager::IsoTask, IsoTask, DEBUG_LEVEL_NORMAL );
@@ -50,9 +54,14 @@ IsoHandlerManager::IsoTask::IsoTask(IsoHandlerManager& manager, enum IsoHandler:
     : m_manager( manager )
     , m_SyncIsoHandler ( NULL )
     , m_handlerType( t )
+    , m_all_handler_types( false )
     , m_running( false )
     , m_in_busreset( false )
     , m_activity_wait_timeout_nsec (ISOHANDLERMANAGER_ISO_TASK_WAIT_TIMEOUT_USECS * 1000LL)
+    , m_wakeups( 0 )
+    , m_wakeups_iso( 0 )
+    , m_wakeups_activity( 0 )
+    , m_wakeups_timeout( 0 )
 {
 }
 
@@ -112,7 +121,7 @@ IsoHandlerManager::IsoTask::handleBusReset()
         assert(h);
 
         // skip the handlers not intended for us
-        if(h->getType() != m_handlerType) continue;
+        if(!isTaskHandlerType(h->getType())) continue;
 
         if (!h->handleBusReset()) {
             debugWarning("Failed to handle busreset on %p\n", h);
@@ -159,7 +168,7 @@ IsoHandlerManager::IsoTask::updateShadowMapHelper()
         assert(h);
 
         // skip the handlers not intended for us
-        if(h->getType() != m_handlerType) continue;
+        if(!isTaskHandlerType(h->getType())) continue;
 
         // update the state of the handler
         // FIXME: maybe this is not the best place to do this
@@ -293,7 +302,7 @@ IsoHandlerManager::IsoTask::Execute()
                     no_one_to_poll = false; // exit the loop to be able to detect failing handlers
                     break;
                 case IsoHandlerManager::IsoTask::eAR_Activity:
-                    // do nothing
+                    m_wakeups_activity++;
                     debugOutputExtreme(DEBUG_LEVEL_VERBOSE,
                                        "(%p, %s) something happened\n",
                                        this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"));
@@ -306,6 +315,12 @@ IsoHandlerManager::IsoTask::Execute()
     // the fd map everytime we run poll().
     err = poll (m_poll_fds_shadow, m_poll_nfds_shadow, m_poll_timeout);
     uint32_t ctr_at_poll_return = m_manager.get1394Service().getCycleTimer();
+    m_wakeups++;
+    if (err > 0) {
+        m_wakeups_iso++;
+    } else if (err == 0) {
+        m_wakeups_timeout++;
+    }
 
     if (err < 0) {
         if (errno == EINTR) {
@@ -317,41 +332,7 @@ IsoHandlerManager::IsoTask::Execute()
         return false;
     }
 
-    // find handlers that have died
-    uint64_t ctr_at_poll_return_ticks = CYCLE_TIMER_TO_TICKS(ctr_at_poll_return);
-    bool handler_died = false;
-    for (i = 0; i < m_poll_nfds_shadow; i++) {
-        // figure out if a handler has died
-
-        // this is the time of the last packet we saw in the iterate() handler
-        uint32_t last_packet_seen = m_IsoHandler_map_shadow[i]->getLastPacketTime();
-        if (last_packet_seen == 0xFFFFFFFF) {
-            // this was not iterated yet, so can't be dead
-            debugOutput(DEBUG_LEVEL_VERY_VERBOSE,
-                        "(%p, %s) handler %d didn't see any packets yet\n",
-                        this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"), i);
-            continue;
-        }
-
-        uint64_t last_packet_seen_ticks = CYCLE_TIMER_TO_TICKS(last_packet_seen);
-        // we use a relatively large value to distinguish between "death" and xrun
-        int64_t max_diff_ticks = TICKS_PER_SECOND * 2;
-        int64_t measured_diff_ticks = diffTicks(ctr_at_poll_return_ticks, last_packet_seen_ticks);
-
-        debugOutputExtreme(DEBUG_LEVEL_VERBOSE,
-                           "(%p, %s) check handler %d: diff = %"PRId64", max = %"PRId64", now: %08X, last: %08X\n",
-                           this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"), 
-                           i, measured_diff_ticks, max_diff_ticks, ctr_at_poll_return, last_packet_seen);
-        if(measured_diff_ticks > max_diff_ticks) {
-            debugFatal("(%p, %s) Handler died: now: %08X, last: %08X, diff: %"PRId64" (max: %"PRId64")\n",
-                       this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"),
-                       ctr_at_poll_return, last_packet_seen, measured_diff_ticks, max_diff_ticks);
-            m_IsoHandler_map_shadow[i]->notifyOfDeath();
-            handler_died = true;
-        }
-    }
-
-    if(handler_died) {
+    if(checkForDeadHandlers(ctr_at_poll_return)) {
         m_running = false;
         return false; // one or more handlers have died
     }
@@ -388,6 +369,45 @@ IsoHandlerManager::IsoTask::Execute()
     return true;
 }
 
+bool
+IsoHandlerManager::IsoTask::checkForDeadHandlers(uint32_t ctr_at_poll_return)
+{
+    unsigned int i;
+    uint64_t ctr_at_poll_return_ticks = CYCLE_TIMER_TO_TICKS(ctr_at_poll_return);
+    bool handler_died = false;
+    for (i = 0; i < m_poll_nfds_shadow; i++) {
+        // figure out if a handler has died
+
+        // this is the time of the last packet we saw in the iterate() handler
+        uint32_t last_packet_seen = m_IsoHandler_map_shadow[i]->getLastPacketTime();
+        if (last_packet_seen == 0xFFFFFFFF) {
+            // this was not iterated yet, so can't be dead
+            debugOutput(DEBUG_LEVEL_VERY_VERBOSE,
+                        "(%p, %s) handler %d didn't see any packets yet\n",
+                        this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"), i);
+            continue;
+        }
+
+        uint64_t last_packet_seen_ticks = CYCLE_TIMER_TO_TICKS(last_packet_seen);
+        // we use a relatively large value to distinguish between "death" and xrun
+        int64_t max_diff_ticks = TICKS_PER_SECOND * 2;
+        int64_t measured_diff_ticks = diffTicks(ctr_at_poll_return_ticks, last_packet_seen_ticks);
+
+        debugOutputExtreme(DEBUG_LEVEL_VERBOSE,
+                           "(%p, %s) check handler %d: diff = %"PRId64", max = %"PRId64", now: %08X, last: %08X\n",
+                           this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"), 
+                           i, measured_diff_ticks, max_diff_ticks, ctr_at_poll_return, last_packet_seen);
+        if(measured_diff_ticks > max_diff_ticks) {
+            debugFatal("(%p, %s) Handler died: now: %08X, last: %08X, diff: %"PRId64" (max: %"PRId64")\n",
+                       this, (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive"),
+                       ctr_at_poll_return, last_packet_seen, measured_diff_ticks, max_diff_ticks);
+            m_IsoHandler_map_shadow[i]->notifyOfDeath();
+            handler_died = true;
+        }
+    }
+    return handler_died;
+}
+
 enum IsoHandlerManager::IsoTask::eActivityResult
 IsoHandlerManager::IsoTask::waitForActivity()
 {
@@ -464,6 +484,313 @@ void IsoHandlerManager::IsoTask::setVerboseLevel(int i) {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Setting verbose level to %d...\n", i );
 }
 
+void IsoHandlerManager::IsoTask::dumpInfo() {
+    debugOutputShort( DEBUG_LEVEL_NORMAL, " IsoTask %p (%s):\n", this,
+                      (m_all_handler_types ? "All" :
+                      (m_handlerType == IsoHandler::eHT_Transmit? "Transmit": "Receive")));
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "  Wakeups: %u (iso: %u, activity: %u, timeout: %u)\n",
+                      m_wakeups, m_wakeups_iso, m_wakeups_activity, m_wakeups_timeout);
+}
+
+// --- ISO Event Thread --- //
+
+// the epoll user data for the non-handler fd's
+#define ISOEVENTTASK_ACTIVITY_FD_ID     (ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT)
+#define ISOEVENTTASK_TIMER_FD_ID        (ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT + 1)
+
+IsoHandlerManager::IsoEventTask::IsoEventTask(IsoHandlerManager& manager)
+    : IsoTask( manager, IsoHandler::eHT_Transmit )
+    , m_epoll_fd( -1 )
+    , m_activity_fd( -1 )
+    , m_timer_fd( -1 )
+    , m_epoll_nfds( 0 )
+    , m_idle_wakeups( 0 )
+    , m_last_ctr( 0 )
+    , m_timer_margin_cycles( ISOHANDLERMANAGER_ISO_TASK_TIMER_MARGIN_CYCLES )
+{
+    m_all_handler_types = true;
+    // the activity fd has to exist before the thread runs, since the
+    // clients can signal activity at any time
+    m_activity_fd = eventfd(0, EFD_NONBLOCK);
+    m_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
+    m_epoll_fd = epoll_create(ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT + 2);
+}
+
+IsoHandlerManager::IsoEventTask::~IsoEventTask()
+{
+    if (m_epoll_fd >= 0) close(m_epoll_fd);
+    if (m_timer_fd >= 0) close(m_timer_fd);
+    if (m_activity_fd >= 0) close(m_activity_fd);
+}
+
+bool
+IsoHandlerManager::IsoEventTask::Init()
+{
+    if (m_epoll_fd < 0 || m_activity_fd < 0 || m_timer_fd < 0) {
+        debugFatal("Could not create event fd's (epoll: %d, activity: %d, timer: %d)\n",
+                   m_epoll_fd, m_activity_fd, m_timer_fd);
+        return false;
+    }
+
+    struct epoll_event ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.u32 = ISOEVENTTASK_ACTIVITY_FD_ID;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_activity_fd, &ev) < 0) {
+        debugFatal("Could not add activity fd to epoll set: %s\n", strerror(errno));
+        return false;
+    }
+    ev.data.u32 = ISOEVENTTASK_TIMER_FD_ID;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_timer_fd, &ev) < 0) {
+        debugFatal("Could not add timer fd to epoll set: %s\n", strerror(errno));
+        return false;
+    }
+    m_epoll_nfds = 0;
+    return IsoTask::Init();
+}
+
+void
+IsoHandlerManager::IsoEventTask::signalActivity()
+{
+    uint64_t one = 1;
+    // the eventfd counter only overflows after 2^64-2 signals,
+    // hence the write cannot fail with EAGAIN in practice
+    if (write(m_activity_fd, &one, sizeof(one)) != sizeof(one)) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "(%p) could not signal activity\n", this);
+    }
+    debugOutput(DEBUG_LEVEL_ULTRA_VERBOSE, "(%p, All) activity\n", this);
+}
+
+bool
+IsoHandlerManager::IsoEventTask::updateEpollSet()
+{
+    unsigned int i;
+    // remove the previous handler fd's, they might be closed or reused
+    for (i = 0; i < m_epoll_nfds; i++) {
+        epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, m_epoll_fds[i], NULL);
+    }
+    m_epoll_nfds = 0;
+
+    for (i = 0; i < m_poll_nfds_shadow; i++) {
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        // start disarmed, updateEpollEvents() arms the handlers
+        // whose client can be iterated
+        ev.events = 0;
+        ev.data.u32 = i;
+        m_poll_fds_shadow[i].events = 0;
+        m_epoll_dead[i] = false;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_poll_fds_shadow[i].fd, &ev) < 0) {
+            debugError("(%p) could not add fd %d to epoll set: %s\n",
+                       this, m_poll_fds_shadow[i].fd, strerror(errno));
+            return false;
+        }
+        m_epoll_fds[m_epoll_nfds++] = m_poll_fds_shadow[i].fd;
+    }
+    return true;
+}
+
+unsigned int
+IsoHandlerManager::IsoEventTask::updateEpollEvents()
+{
+    unsigned int i, armed = 0;
+    for (i = 0; i < m_poll_nfds_shadow; i++) {
+        short events = 0;
+        if (m_epoll_dead[i]) {
+            m_poll_fds_shadow[i].revents = 0;
+            continue;
+        }
+        // same reasoning as for the poll() based task: only wait on
+        // handlers whose client can provide or accept packets
+        if (m_IsoHandler_map_shadow[i]->canIterateClient()) {
+            events = POLLIN | POLLPRI;
+            armed++;
+        }
+        m_poll_fds_shadow[i].revents = 0;
+        // only modify the epoll set on a change, this is once per
+        // period at most
+        if (events != m_poll_fds_shadow[i].events) {
+            struct epoll_event ev;
+            memset(&ev, 0, sizeof(ev));
+            ev.events = (events ? EPOLLIN | EPOLLPRI : 0);
+            ev.data.u32 = i;
+            if (epoll_ctl(m_epoll_fd, EPOLL_CTL_MOD, m_poll_fds_shadow[i].fd, &ev) < 0) {
+                debugError("(%p) could not modify fd %d in epoll set: %s\n",
+                           this, m_poll_fds_shadow[i].fd, strerror(errno));
+                continue;
+            }
+            m_poll_fds_shadow[i].events = events;
+        }
+    }
+    return armed;
+}
+
+bool
+IsoHandlerManager::IsoEventTask::armTimer(int64_t nsecs)
+{
+    struct itimerspec its;
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = nsecs / 1000000000LL;
+    its.it_value.tv_nsec = nsecs % 1000000000LL;
+    if (timerfd_settime(m_timer_fd, 0, &its, NULL) < 0) {
+        debugError("(%p) could not program timer: %s\n", this, strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+int64_t
+IsoHandlerManager::IsoEventTask::getNextDeadline(uint32_t ctr_now)
+{
+    unsigned int i;
+    uint64_t now_ticks = CYCLE_TIMER_TO_TICKS(ctr_now);
+    int64_t min_diff_ticks = -1;
+
+    for (i = 0; i < m_poll_nfds_shadow; i++) {
+        if (!m_poll_fds_shadow[i].events) continue;
+        IsoHandler *h = m_IsoHandler_map_shadow[i];
+
+        // the handler should see an interrupt every irq_interval packets,
+        // so it is overdue irq_interval (+ margin) cycles after the
+        // last one
+        int64_t interval_ticks = (h->getIrqInterval() + m_timer_margin_cycles) * TICKS_PER_CYCLE;
+        int64_t diff_ticks;
+        uint32_t last_packet_seen = h->getLastPacketTime();
+        if (last_packet_seen == 0xFFFFFFFF) {
+            diff_ticks = interval_ticks;
+        } else {
+            uint64_t deadline = addTicks(CYCLE_TIMER_TO_TICKS(last_packet_seen), interval_ticks);
+            diff_ticks = diffTicks(deadline, now_ticks);
+            // already overdue, don't spin but check again one interval later
+            if (diff_ticks < (int64_t)TICKS_PER_CYCLE) {
+                diff_ticks = interval_ticks;
+            }
+        }
+        if (min_diff_ticks < 0 || diff_ticks < min_diff_ticks) {
+            min_diff_ticks = diff_ticks;
+        }
+    }
+    if (min_diff_ticks < 0) {
+        // nothing armed, only wake up for the handler death check
+        return m_activity_wait_timeout_nsec;
+    }
+    return (min_diff_ticks * 1000000000LL) / TICKS_PER_SECOND;
+}
+
+bool
+IsoHandlerManager::IsoEventTask::Execute()
+{
+    debugOutput(DEBUG_LEVEL_ULTRA_VERBOSE, "(%p, All) Execute\n", this);
+    struct epoll_event events[ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT + 2];
+    unsigned int i;
+    int n;
+
+    // if some other thread requested a shadow map update, do it
+    if(request_update) {
+        updateShadowMapHelper();
+        if (!updateEpollSet()) {
+            m_running = false;
+            return false;
+        }
+        DEC_ATOMIC(&request_update); // ack the update
+        assert(request_update >= 0);
+    }
+
+    // (dis)arm the handlers and program the timer for the instant at which
+    // the next interrupt is overdue. Note that the CTR of the previous
+    // wakeup is used as 'now', the processing time since then only makes
+    // the timer somewhat later.
+    updateEpollEvents();
+    if (!armTimer(getNextDeadline(m_last_ctr))) {
+        m_running = false;
+        return false;
+    }
+
+    n = epoll_wait(m_epoll_fd, events, ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT + 2, -1);
+    uint32_t ctr_at_poll_return = m_manager.get1394Service().getCycleTimer();
+    m_last_ctr = ctr_at_poll_return;
+
+    if (n < 0) {
+        if (errno == EINTR) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "Ignoring epoll return due to signal\n");
+            return true;
+        }
+        debugFatal("epoll error: %s\n", strerror (errno));
+        m_running = false;
+        return false;
+    }
+    m_wakeups++;
+
+    bool iso_event = false;
+    bool did_work = false;
+    uint64_t dummy;
+    for (int j = 0; j < n; j++) {
+        uint32_t id = events[j].data.u32;
+        if (id == ISOEVENTTASK_ACTIVITY_FD_ID) {
+            // clear the eventfd counter
+            if (read(m_activity_fd, &dummy, sizeof(dummy)) < 0) {
+                debugOutput(DEBUG_LEVEL_VERBOSE, "(%p) activity read failed\n", this);
+            } else {
+                did_work = true;
+            }
+            m_wakeups_activity++;
+        } else if (id == ISOEVENTTASK_TIMER_FD_ID) {
+            if (read(m_timer_fd, &dummy, sizeof(dummy)) < 0) {
+                debugOutput(DEBUG_LEVEL_VERBOSE, "(%p) timer read failed\n", this);
+            } else {
+                did_work = true;
+            }
+            m_wakeups_timeout++;
+        } else if (id < m_poll_nfds_shadow && !m_epoll_dead[id]) {
+            if (events[j].events & (EPOLLERR | EPOLLHUP)) {
+                // the fd stays ready forever, take the handler out of the
+                // epoll set and let its client know it won't see packets
+                debugError("(%p) %s on fd %d of handler %u, disabling it\n",
+                           this, ((events[j].events & EPOLLHUP) ? "hangup" : "error"),
+                           m_poll_fds_shadow[id].fd, id);
+                epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, m_poll_fds_shadow[id].fd, NULL);
+                m_epoll_dead[id] = true;
+                m_poll_fds_shadow[id].events = 0;
+                m_poll_fds_shadow[id].revents = 0;
+                m_IsoHandler_map_shadow[id]->notifyOfDeath();
+                did_work = true;
+                continue;
+            }
+            if (events[j].events & EPOLLIN) {
+                m_poll_fds_shadow[id].revents = POLLIN;
+                iso_event = true;
+                did_work = true;
+            }
+        }
+    }
+    if (iso_event) {
+        m_wakeups_iso++;
+    }
+
+    if(checkForDeadHandlers(ctr_at_poll_return)) {
+        m_running = false;
+        return false; // one or more handlers have died
+    }
+
+    // iterate the handlers
+    for (i = 0; i < m_poll_nfds_shadow; i++) {
+        if(m_poll_fds_shadow[i].revents & (POLLIN)) {
+            m_IsoHandler_map_shadow[i]->iterate(ctr_at_poll_return);
+        }
+    }
+
+    // an fd that is reported ready without anything to do would make this
+    // a busy loop, back off if that goes on
+    if (did_work) {
+        m_idle_wakeups = 0;
+    } else if (++m_idle_wakeups >= ISOHANDLERMANAGER_ISO_TASK_MAX_IDLE_WAKEUPS) {
+        debugWarning("(%p) %u wakeups without work, backing off\n", this, m_idle_wakeups);
+        m_idle_wakeups = 0;
+        Util::SystemTimeSource::SleepUsecRelative(1000);
+    }
+    return true;
+}
+
 // -- the ISO handler manager -- //
 IsoHandlerManager::IsoHandlerManager(Ieee1394Service& service)
    : m_State(E_Created)
@@ -473,6 +800,8 @@ IsoHandlerManager::IsoHandlerManager(Ieee1394Service& service)
    , m_IsoTaskTransmit ( NULL )
    , m_IsoThreadReceive ( NULL )
    , m_IsoTaskReceive ( NULL )
+   , m_single_iso_thread ( false )
+   , m_iso_backend_type ( IsoBackend::eBT_Raw1394 )
 {
 }
 
@@ -484,6 +813,8 @@ IsoHandlerManager::IsoHandlerManager(Ieee1394Service& service, bool run_rt, int
    , m_IsoTaskTransmit ( NULL )
    , m_IsoThreadReceive ( NULL )
    , m_IsoTaskReceive ( NULL )
+   , m_single_iso_thread ( false )
+   , m_iso_backend_type ( IsoBackend::eBT_Raw1394 )
    , m_MissedCyclesOK ( false )
 {
 }
@@ -506,7 +837,7 @@ IsoHandlerManager::~IsoHandlerManager()
     if (m_IsoTaskTransmit) {
         delete m_IsoTaskTransmit;
     }
-    if (m_IsoTaskReceive) {
+    if (m_IsoTaskReceive && !m_single_iso_thread) {
         delete m_IsoTaskReceive;
     }
 }
@@ -530,6 +861,10 @@ IsoHandlerManager::handleBusReset()
     if (!m_IsoTaskTransmit->handleBusReset()) {
         debugWarning("could no handle busreset on xmit\n");
     }
+    if (m_single_iso_thread) {
+        // the transmit task handled both directions
+        return true;
+    }
     if (!m_IsoTaskReceive->handleBusReset()) {
         debugWarning("could no handle busreset on recv\n");
     }
@@ -540,7 +875,16 @@ void
 IsoHandlerManager::requestShadowMapUpdate()
 {
     if(m_IsoTaskTransmit) m_IsoTaskTransmit->requestShadowMapUpdate();
-    if(m_IsoTaskReceive) m_IsoTaskReceive->requestShadowMapUpdate();
+    if(m_IsoTaskReceive && !m_single_iso_thread) m_IsoTaskReceive->requestShadowMapUpdate();
+}
+
+unsigned int
+IsoHandlerManager::getWakeupCount()
+{
+    unsigned int wakeups = 0;
+    if(m_IsoTaskTransmit) wakeups += m_IsoTaskTransmit->getWakeupCount();
+    if(m_IsoTaskReceive && !m_single_iso_thread) wakeups += m_IsoTaskReceive->getWakeupCount();
+    return wakeups;
 }
 
 bool
@@ -599,11 +943,73 @@ bool IsoHandlerManager::init()
     int ihm_iso_prio_increase_xmit = ISOHANDLERMANAGER_ISO_PRIO_INCREASE_XMIT;
     int ihm_iso_prio_increase_recv = ISOHANDLERMANAGER_ISO_PRIO_INCREASE_RECV;
     int64_t isotask_activity_timeout_usecs = ISOHANDLERMANAGER_ISO_TASK_WAIT_TIMEOUT_USECS;
+    int single_iso_thread = ISOHANDLERMANAGER_SINGLE_ISO_THREAD;
+    int isotask_timer_margin_cycles = ISOHANDLERMANAGER_ISO_TASK_TIMER_MARGIN_CYCLES;
+    std::string iso_backend = ISOHANDLERMANAGER_ISO_BACKEND;
     if(config) {
         config->getValueForSetting("ieee1394.isomanager.prio_increase", ihm_iso_prio_increase);
         config->getValueForSetting("ieee1394.isomanager.prio_increase_xmit", ihm_iso_prio_increase_xmit);
         config->getValueForSetting("ieee1394.isomanager.prio_increase_recv", ihm_iso_prio_increase_recv);
         config->getValueForSetting("ieee1394.isomanager.isotask_activity_timeout_usecs", isotask_activity_timeout_usecs);
+        config->getValueForSetting("ieee1394.isomanager.single_iso_thread", single_iso_thread);
+        config->getValueForSetting("ieee1394.isomanager.isotask_timer_margin_cycles", isotask_timer_margin_cycles);
+        config->getValueForSetting("ieee1394.isomanager.iso_backend", iso_backend);
+    }
+    if (m_service.getSimulatedBus()) {
+        // the other backends need hardware
+        iso_backend = "loopback";
+    }
+
+    if (!IsoBackend::stringToType(iso_backend, m_iso_backend_type)) {
+        debugWarning("Unknown ISO backend '%s', using %s\n",
+                     iso_backend.c_str(), IsoBackend::typeToString(IsoBackend::eBT_Raw1394));
+        m_iso_backend_type = IsoBackend::eBT_Raw1394;
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "Using the %s ISO backend\n",
+                 IsoBackend::typeToString(m_iso_backend_type));
+
+    if (single_iso_thread) {
+        // one event driven thread for both directions. It runs at the
+        // transmit priority since it also has to flush the transmit data.
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Create single iso thread for %p...\n", this);
+        IsoEventTask *task = new IsoEventTask( *this );
+        if(!task) {
+            debugFatal("No task\n");
+            return false;
+        }
+        task->setVerboseLevel(getDebugLevel());
+        task->m_activity_wait_timeout_nsec = isotask_activity_timeout_usecs * 1000LL;
+        if (isotask_timer_margin_cycles >= 0) {
+            task->m_timer_margin_cycles = isotask_timer_margin_cycles;
+        }
+        m_single_iso_thread = true;
+        m_IsoTaskTransmit = task;
+        m_IsoTaskReceive = task;
+        m_IsoThreadTransmit = new Util::PosixThread(m_IsoTaskTransmit, "ISOALL", m_realtime,
+                                                    m_priority + ihm_iso_prio_increase
+                                                    + ihm_iso_prio_increase_xmit,
+                                                    PTHREAD_CANCEL_DEFERRED);
+        if(!m_IsoThreadTransmit) {
+            debugFatal("No thread\n");
+            return false;
+        }
+        m_IsoThreadTransmit->setVerboseLevel(getDebugLevel());
+
+        Util::Watchdog *watchdog = m_service.getWatchdog();
+        if(watchdog) {
+            if(!watchdog->registerThread(m_IsoThreadTransmit)) {
+                debugWarning("could not register iso thread with watchdog\n");
+            }
+        } else {
+            debugWarning("could not find valid watchdog\n");
+        }
+
+        if (m_IsoThreadTransmit->Start() != 0) {
+            debugFatal("Could not start ISO thread\n");
+            return false;
+        }
+        m_State=E_Running;
+        return true;
     }
 
     // create threads to iterate our ISO handlers
@@ -892,6 +1298,18 @@ bool IsoHandlerManager::registerStream(StreamProcessor *stream)
         return false;
     }
 
+    Util::Configuration *config = m_service.getConfiguration();
+    int adaptive_tuning = ISOHANDLER_ADAPTIVE_TUNING;
+    int max_buffer_factor = ISOHANDLER_ADAPTIVE_TUNING_MAX_BUFFER_FACTOR;
+    if(config) {
+        config->getValueForSetting("ieee1394.isomanager.adaptive_tuning", adaptive_tuning);
+        config->getValueForSetting("ieee1394.isomanager.adaptive_tuning_max_buffer_factor", max_buffer_factor);
+    }
+    if(adaptive_tuning) {
+        if(max_buffer_factor < 1) max_buffer_factor = 1;
+        h->setAdaptiveTuning(true, 1, h->getNbBuffers() * max_buffer_factor);
+    }
+
     h->setVerboseLevel(getDebugLevel());
 
     // register the stream with the handler
@@ -1021,12 +1439,8 @@ IsoHandlerManager::dumpInfoForStream(Streaming::StreamProcessor *stream)
 {
     IsoHandler *h = getHandlerForStream(stream);
     if (h) {
-        #ifdef DEBUG
-        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Packets, Dropped, Skipped : %d, %d, %d\n",
-                            h->m_packets, h->m_dropped, h->m_skipped);
-        #else
-        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Packets : %d\n", h->m_packets);
-        #endif
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Packets, Dropped, Skipped : %d, %"PRIu64", %"PRIu64"\n",
+                            h->m_packets, h->m_stat_dropped.getCount(), h->m_stat_skipped.getCount());
     } else {
         debugError("No handler for stream %p??\n", stream);
     }
@@ -1194,6 +1608,8 @@ void IsoHandlerManager::dumpInfo() {
         debugOutputShort( DEBUG_LEVEL_NORMAL, " IsoHandler %d (%p)\n",i++,*it);
         (*it)->dumpInfo();
     }
+    if (m_IsoTaskTransmit) m_IsoTaskTransmit->dumpInfo();
+    if (m_IsoTaskReceive && !m_single_iso_thread) m_IsoTaskReceive->dumpInfo();
     #endif
 }
 
@@ -1211,36 +1627,10 @@ IsoHandlerManager::eHSToString(enum eHandlerStates s) {
 
 // ISOHANDLER
 
-/* the C callbacks */
-enum raw1394_iso_disposition
-IsoHandlerManager::IsoHandler::iso_transmit_handler(raw1394handle_t handle,
-        unsigned char *data, unsigned int *length,
-        unsigned char *tag, unsigned char *sy,
-        int cycle, unsigned int dropped1) {
-
-    IsoHandler *xmitHandler = static_cast<IsoHandler *>(raw1394_get_userdata(handle));
-    assert(xmitHandler);
-    unsigned int skipped = (dropped1 & 0xFFFF0000) >> 16;
-    unsigned int dropped = dropped1 & 0xFFFF;
-    return xmitHandler->getPacket(data, length, tag, sy, cycle, dropped, skipped);
-}
-
-enum raw1394_iso_disposition
-IsoHandlerManager::IsoHandler::iso_receive_handler(raw1394handle_t handle, unsigned char *data,
-                        unsigned int length, unsigned char channel,
-                        unsigned char tag, unsigned char sy, unsigned int cycle,
-                        unsigned int dropped) {
-
-    IsoHandler *recvHandler = static_cast<IsoHandler *>(raw1394_get_userdata(handle));
-    assert(recvHandler);
-
-    return recvHandler->putPacket(data, length, channel, tag, sy, cycle, dropped);
-}
-
 IsoHandlerManager::IsoHandler::IsoHandler(IsoHandlerManager& manager, enum EHandlerType t)
    : m_manager( manager )
    , m_type ( t )
-   , m_handle( NULL )
+   , m_backend( NULL )
    , m_buf_packets( 400 )
    , m_max_packet_size( 1024 )
    , m_irq_interval( -1 )
@@ -1253,12 +1643,8 @@ IsoHandlerManager::IsoHandler::IsoHandler(IsoHandlerManager& manager, enum EHand
    , m_State( eHS_Stopped )
    , m_NextState( eHS_Stopped )
    , m_switch_on_cycle(0)
-#ifdef DEBUG
    , m_packets ( 0 )
-   , m_dropped( 0 )
-   , m_skipped( 0 )
-   , m_min_ahead( 7999 )
-#endif
+   , m_deferred_cycles( 0 )
 {
     pthread_mutex_init(&m_disable_lock, NULL);
 }
@@ -1267,7 +1653,7 @@ IsoHandlerManager::IsoHandler::IsoHandler(IsoHandlerManager& manager, enum EHand
                        unsigned int buf_packets, unsigned int max_packet_size, int irq)
    : m_manager( manager )
    , m_type ( t )
-   , m_handle( NULL )
+   , m_backend( NULL )
    , m_buf_packets( buf_packets )
    , m_max_packet_size( max_packet_size )
    , m_irq_interval( irq )
@@ -1280,12 +1666,8 @@ IsoHandlerManager::IsoHandler::IsoHandler(IsoHandlerManager& manager, enum EHand
    , m_State( eHS_Stopped )
    , m_NextState( eHS_Stopped )
    , m_switch_on_cycle(0)
-#ifdef DEBUG
    , m_packets ( 0 )
-   , m_dropped( 0 )
-   , m_skipped( 0 )
-   , m_min_ahead( 7999 )
-#endif
+   , m_deferred_cycles( 0 )
 {
     pthread_mutex_init(&m_disable_lock, NULL);
 }
@@ -1295,7 +1677,7 @@ IsoHandlerManager::IsoHandler::IsoHandler(IsoHandlerManager& manager, enum EHand
                        enum raw1394_iso_speed speed)
    : m_manager( manager )
    , m_type ( t )
-   , m_handle( NULL )
+   , m_backend( NULL )
    , m_buf_packets( buf_packets )
    , m_max_packet_size( max_packet_size )
    , m_irq_interval( irq )
@@ -1308,24 +1690,13 @@ IsoHandlerManager::IsoHandler::IsoHandler(IsoHandlerManager& manager, enum EHand
    , m_State( eHS_Stopped )
    , m_NextState( eHS_Stopped )
    , m_switch_on_cycle(0)
-#ifdef DEBUG
    , m_packets( 0 )
-   , m_dropped( 0 )
-   , m_skipped( 0 )
-   , m_min_ahead( 7999 )
-#endif
    , m_deferred_cycles( 0 )
 {
     pthread_mutex_init(&m_disable_lock, NULL);
 }
 
 IsoHandlerManager::IsoHandler::~IsoHandler() {
-// Don't call until libraw1394's raw1394_new_handle() function has been
-// fixed to correctly initialise the iso_packet_infos field.  Bug is
-// confirmed present in libraw1394 1.2.1.  In any case,
-// raw1394_destroy_handle() will do any iso system shutdown required.
-//     raw1394_iso_shutdown(m_handle);
-
 // Typically, by the time this function is called the IsoTask thread would
 // have called disable() on the handler (in the FW_ISORCV/FW_ISOXMT
 // threads).  However, the raw1394_destroy_handle() call therein takes
@@ -1338,13 +1709,14 @@ IsoHandlerManager::IsoHandler::~IsoHandler() {
         pthread_mutex_lock(&m_disable_lock);
     }
     pthread_mutex_unlock(&m_disable_lock);
-    if(m_handle) {
+    if(m_backend) {
         if (m_State == eHS_Running) {
             debugError("BUG: Handler still running!\n");
             disable();
         }
     }
     pthread_mutex_destroy(&m_disable_lock);
+    unregisterStats();
 }
 
 bool
@@ -1378,7 +1750,7 @@ IsoHandlerManager::IsoHandler::iterate(uint32_t cycle_timer_now) {
                        this, getTypeString(), cycle_timer_now);
     m_last_now = cycle_timer_now;
     if(m_State == eHS_Running) {
-        assert(m_handle);
+        assert(m_backend);
 
         #if ISOHANDLER_FLUSH_BEFORE_ITERATE
         // this flushes all packets received since the poll() returned
@@ -1386,15 +1758,19 @@ IsoHandlerManager::IsoHandler::iterate(uint32_t cycle_timer_now) {
         // iterate. Doing so might result in lower latency capability
         // and/or better reliability
         if(m_type == eHT_Receive) {
-            raw1394_iso_recv_flush(m_handle);
+            m_backend->flush();
         }
         #endif
 
-        if(raw1394_loop_iterate(m_handle)) {
+        if(!m_backend->iterate()) {
             debugError( "IsoHandler (%p): Failed to iterate handler: %s\n",
                         this, strerror(errno));
             return false;
         }
+
+        if(m_Client) {
+            m_Client->updatePeriodReadiness();
+        }
         debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE, "(%p, %s) done interating ISO handler...\n",
                            this, getTypeString());
         return true;
@@ -1417,13 +1793,7 @@ IsoHandlerManager::IsoHandler::handleBusReset()
     debugOutput( DEBUG_LEVEL_NORMAL, "bus reset...\n");
     m_last_packet_handled_at = 0xFFFFFFFF;
 
-    #define CSR_CYCLE_TIME            0x200
-    #define CSR_REGISTER_BASE  0xfffff0000000ULL
-    // do a simple read on ourself in order to update the internal structures
-    // this avoids read failures after a bus reset
-    quadlet_t buf=0;
-    raw1394_read(m_handle, raw1394_get_local_id(m_handle),
-                 CSR_REGISTER_BASE | CSR_CYCLE_TIME, 4, &buf);
+    if(m_backend) m_backend->handleBusReset();
 
     return m_Client->handleBusReset();
 }
@@ -1442,7 +1812,7 @@ IsoHandlerManager::IsoHandler::notifyOfDeath()
     m_Client->handlerDied();
 
     // wake ourselves up
-    if(m_handle) raw1394_wake_up(m_handle);
+    if(m_backend) m_backend->wakeUp();
 }
 
 void IsoHandlerManager::IsoHandler::dumpInfo()
@@ -1450,8 +1820,8 @@ void IsoHandlerManager::IsoHandler::dumpInfo()
     int channel=-1;
     if (m_Client) channel=m_Client->getChannel();
 
-    debugOutputShort( DEBUG_LEVEL_NORMAL, "  Handler type................: %s\n",
-            getTypeString());
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "  Handler type, backend.......: %s, %s\n",
+            getTypeString(), IsoBackend::typeToString(m_manager.m_iso_backend_type));
     debugOutputShort( DEBUG_LEVEL_NORMAL, "  Port, Channel...............: %2d, %2d\n",
             m_manager.get1394Service().getPort(), channel);
     debugOutputShort( DEBUG_LEVEL_NORMAL, "  Buffer, MaxPacketSize, IRQ..: %4d, %4d, %4d\n",
@@ -1459,15 +1829,101 @@ void IsoHandlerManager::IsoHandler::dumpInfo()
     if (this->getType() == eHT_Transmit) {
         debugOutputShort( DEBUG_LEVEL_NORMAL, "  Speed ..................: %2d\n",
                                             m_speed);
-        #ifdef DEBUG
-        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Min ISOXMT bufferfill : %04d\n", m_min_ahead);
-        #endif
     }
-    #ifdef DEBUG
-    debugOutputShort( DEBUG_LEVEL_NORMAL, "  Last cycle, dropped.........: %4d, %4u, %4u\n",
-            m_last_cycle, m_dropped, m_skipped);
-    #endif
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "  Last cycle, dropped.........: %4d, %4"PRIu64", %4"PRIu64"\n",
+            m_last_cycle, m_stat_dropped.getCount(), m_stat_skipped.getCount());
+    if (m_tuning.enabled) {
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Tuning IRQ, Buffer range....: %4d-%d, %4u-%u\n",
+                m_tuning.min_irq_interval, m_tuning.max_irq_interval,
+                m_tuning.min_buf_packets, m_tuning.max_buf_packets);
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Tuning runs, changes........: %4u, %4u\n",
+                m_tuning.runs, m_tuning.changes);
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "  Last tuning decision........: %s\n",
+                (m_tuning.reason[0] ? m_tuning.reason : "none yet"));
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "  This run late, %s, dropped, deferred: %u/%"PRIu64", %d, %u, %u\n",
+                (m_type == eHT_Receive ? "max age" : "min ahead"),
+                m_tuning.late_packets, m_tuning.packets,
+                (m_type == eHT_Receive ? m_tuning.max_age : m_tuning.min_ahead),
+                m_tuning.dropped, m_tuning.deferred);
+    }
+}
 
+void
+IsoHandlerManager::IsoHandler::setAdaptiveTuning(bool enable, int min_irq_interval,
+                                                 unsigned int max_buf_packets)
+{
+    m_tuning.enabled = enable;
+    m_tuning.min_irq_interval = (min_irq_interval > 0 ? min_irq_interval : 1);
+    m_tuning.max_irq_interval = (m_irq_interval > m_tuning.min_irq_interval
+                                 ? m_irq_interval : m_tuning.min_irq_interval);
+    m_tuning.min_buf_packets = m_buf_packets;
+    m_tuning.max_buf_packets = (max_buf_packets > m_buf_packets ? max_buf_packets : m_buf_packets);
+}
+
+/**
+ * Decides the IRQ interval and buffer depth for the next run, based on
+ * the statistics of the run that ends:
+ *  - xruns and late wakeups: halve the IRQ interval, such that the packets
+ *    reach the client sooner after they were on the wire
+ *  - dropped or deferred cycles: double the buffer depth, such that the
+ *    kernel has more slack
+ *  - a long run without any of these: go back one step towards the
+ *    starting values, i.e. fewer interrupts and less memory
+ */
+void
+IsoHandlerManager::IsoHandler::retune()
+{
+    if (!m_tuning.enabled) return;
+    m_tuning.runs++;
+
+    bool xrun = (m_Client && m_Client->xrunOccurred());
+    // an occasional late packet is not worth more interrupts
+    bool late = m_tuning.late_packets > m_tuning.packets / 100;
+    bool starved = m_tuning.dropped > 0 || m_tuning.deferred > m_tuning.packets / 100;
+
+    int irq_interval = m_irq_interval;
+    unsigned int buf_packets = m_buf_packets;
+    const char *why;
+    if (xrun || late || starved) {
+        if (xrun || late) {
+            irq_interval /= 2;
+        }
+        if (starved) {
+            buf_packets *= 2;
+        }
+        why = (xrun ? "xrun" : (late ? "late wakeups" : "starved"));
+    } else if (m_tuning.packets >= ISOHANDLER_ADAPTIVE_TUNING_RELAX_PACKETS) {
+        irq_interval *= 2;
+        buf_packets /= 2;
+        why = "clean run";
+    } else {
+        why = "short run";
+    }
+
+    if (irq_interval < m_tuning.min_irq_interval) irq_interval = m_tuning.min_irq_interval;
+    if (irq_interval > m_tuning.max_irq_interval) irq_interval = m_tuning.max_irq_interval;
+    if (buf_packets < m_tuning.min_buf_packets) buf_packets = m_tuning.min_buf_packets;
+    if (buf_packets > m_tuning.max_buf_packets) buf_packets = m_tuning.max_buf_packets;
+    // ensure at least 2 hardware interrupts per ISO buffer wraparound
+    if (irq_interval > (int)buf_packets / 2) irq_interval = buf_packets / 2;
+    if (irq_interval <= 0) irq_interval = 1;
+
+    snprintf(m_tuning.reason, sizeof(m_tuning.reason),
+             "run %u, %s (%u/%"PRIu64" late, %u dropped, %u deferred): IRQ %d -> %d, Buffer %u -> %u",
+             m_tuning.runs, why, m_tuning.late_packets, m_tuning.packets,
+             m_tuning.dropped, m_tuning.deferred,
+             m_irq_interval, irq_interval, m_buf_packets, buf_packets);
+
+    if (irq_interval != m_irq_interval || buf_packets != m_buf_packets) {
+        m_tuning.changes++;
+        debugOutput( DEBUG_LEVEL_NORMAL, "(%p, %s) retuned: %s\n",
+                     this, getTypeString(), m_tuning.reason);
+        m_irq_interval = irq_interval;
+        m_buf_packets = buf_packets;
+    } else {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "(%p, %s) not retuned: %s\n",
+                     this, getTypeString(), m_tuning.reason);
+    }
 }
 
 void IsoHandlerManager::IsoHandler::setVerboseLevel(int l)
@@ -1486,6 +1942,7 @@ bool IsoHandlerManager::IsoHandler::registerStream(StreamProcessor *stream)
             return false;
     }
     m_Client=stream;
+
     return true;
 }
 
@@ -1499,9 +1956,42 @@ bool IsoHandlerManager::IsoHandler::unregisterStream(StreamProcessor *stream)
             return false;
     }
     m_Client=0;
+    unregisterStats();
     return true;
 }
 
+void
+IsoHandlerManager::IsoHandler::registerStats()
+{
+    // the handlers of a port and direction are told apart by their
+    // channel, which is only known once the stream is started
+    unregisterStats();
+    char prefix[32];
+    snprintf(prefix, sizeof(prefix), "iso/port%d/%s/ch%d/",
+             m_manager.get1394Service().getPort(), getTypeString(),
+             (m_Client ? m_Client->getChannel() : -1));
+    std::string p(prefix);
+    Util::StatsRegistry *r = Util::StatsRegistry::instance();
+    m_stat_packets = r->registerStat(p + "packets", Util::StatsRegistry::eT_Counter);
+    m_stat_dropped = r->registerStat(p + "dropped", Util::StatsRegistry::eT_Counter, "cycles");
+    m_stat_skipped = r->registerStat(p + "skipped", Util::StatsRegistry::eT_Counter, "cycles");
+    m_stat_deferred = r->registerStat(p + "deferred", Util::StatsRegistry::eT_Counter, "cycles");
+    // receive: cycles from the wire to the handler, transmit: cycles ahead of the wire
+    m_stat_latency = r->registerStat(p + (m_type == eHT_Receive ? "age" : "ahead"),
+                                     Util::StatsRegistry::eT_Histogram, "cycles");
+}
+
+void
+IsoHandlerManager::IsoHandler::unregisterStats()
+{
+    Util::StatsRegistry *r = Util::StatsRegistry::instance();
+    r->unregisterStat(m_stat_packets);
+    r->unregisterStat(m_stat_dropped);
+    r->unregisterStat(m_stat_skipped);
+    r->unregisterStat(m_stat_deferred);
+    r->unregisterStat(m_stat_latency);
+}
+
 // ISO packet interface
 enum raw1394_iso_disposition IsoHandlerManager::IsoHandler::putPacket(
                     unsigned char *data, unsigned int length,
@@ -1520,9 +2010,11 @@ enum raw1394_iso_disposition IsoHandlerManager::IsoHandler::putPacket(
             debugOutput(DEBUG_LEVEL_VERBOSE,
                         "(%p) dropped %d packets on cycle %u, 'dropped'=%u, cycle=%d, m_last_cycle=%d\n",
                         this, dropped_cycles, cycle, dropped, cycle, m_last_cycle);
-            m_dropped += dropped_cycles;
         }
         #endif
+        if (dropped_cycles > 0) {
+            m_stat_dropped.add(dropped_cycles);
+        }
     }
     m_last_cycle = cycle;
 
@@ -1546,6 +2038,16 @@ enum raw1394_iso_disposition IsoHandlerManager::IsoHandler::putPacket(
     tmp += diff_cycles * (int64_t)TICKS_PER_CYCLE;
     uint64_t pkt_ctr_ticks = wrapAtMinMaxTicks(tmp);
     uint32_t pkt_ctr = TICKS_TO_CYCLE_TIMER(pkt_ctr_ticks);
+
+    m_stat_latency.record(-diff_cycles);
+    if (m_tuning.enabled) {
+        // the packet should have been handled on the interrupt following it
+        int age = -diff_cycles;
+        if (age > m_tuning.max_age) m_tuning.max_age = age;
+        if (age > 2 * m_irq_interval) m_tuning.late_packets++;
+        if (dropped_cycles > 0) m_tuning.dropped += dropped_cycles;
+        m_tuning.packets++;
+    }
     #ifdef DEBUG
     if( (now_cycles < cycle)
         && diffCycles(now_cycles, cycle) < 0
@@ -1594,6 +2096,7 @@ enum raw1394_iso_disposition IsoHandlerManager::IsoHandler::putPacket(
                 "received packet: length=%d, channel=%d, cycle=%d, at %08X\n",
                 length, channel, cycle, pkt_ctr);
     m_packets++;
+    m_stat_packets.add();
     #ifdef DEBUG
     if (length > m_max_packet_size) {
         debugWarning("(%p, %s) packet too large: len=%u max=%u\n",
@@ -1605,8 +2108,9 @@ enum raw1394_iso_disposition IsoHandlerManager::IsoHandler::putPacket(
     #endif
 
     // iterate the client if required
-    if(m_Client)
+    if(m_Client) {
         return m_Client->putPacket(data, length, channel, tag, sy, pkt_ctr, dropped_cycles);
+    }
 
     return RAW1394_ISO_OK;
 }
@@ -1642,6 +2146,18 @@ IsoHandlerManager::IsoHandler::getPacket(unsigned char *data, unsigned int *leng
         uint64_t pkt_ctr_ticks = wrapAtMinMaxTicks(tmp);
         pkt_ctr = TICKS_TO_CYCLE_TIMER(pkt_ctr_ticks);
 
+        if (m_packets >= m_buf_packets) {
+            m_stat_latency.record(diff_cycles);
+        }
+        if (m_tuning.enabled && m_packets >= m_buf_packets) {
+            // less than an interrupt interval of data queued means
+            // that the buffer was about to run empty
+            int ahead = diff_cycles;
+            if (ahead < m_tuning.min_ahead) m_tuning.min_ahead = ahead;
+            if (ahead < m_irq_interval) m_tuning.late_packets++;
+            m_tuning.packets++;
+        }
+
 //debugOutput(DEBUG_LEVEL_VERBOSE, "cy=%d, now_cy=%d, diff_cy=%lld, tmp=%lld, pkt_ctr_ticks=%lld, pkt_ctr=%d\n",
 //  cycle, now_cycles, diff_cycles, tmp, pkt_ctr_ticks, pkt_ctr);
         #if ISOHANDLER_CHECK_CTR_RECONSTRUCTION
@@ -1682,6 +2198,7 @@ IsoHandlerManager::IsoHandler::getPacket(unsigned char *data, unsigned int *leng
                 *length, cycle, pkt_ctr);
 
     m_packets++;
+    m_stat_packets.add();
 
     #ifdef DEBUG
     if(m_last_cycle == -1) {
@@ -1711,7 +2228,6 @@ IsoHandlerManager::IsoHandler::getPacket(unsigned char *data, unsigned int *leng
             debugOutput(DEBUG_LEVEL_VERY_VERBOSE,
                         "(%p) skipped %d cycles, cycle: %d, last_cycle: %d, dropped: %d\n", 
                         this, skipped, cycle, m_last_cycle, dropped);
-            m_skipped += skipped;
         }
         if (dropped_cycles < 0) { 
             debugWarning("(%p) dropped < 1 (%d), cycle: %d, last_cycle: %d, dropped: %d, skipped: %d\n", 
@@ -1721,9 +2237,14 @@ IsoHandlerManager::IsoHandler::getPacket(unsigned char *data, unsigned int *leng
             debugOutput(DEBUG_LEVEL_VERBOSE,
                         "(%p) dropped %d packets on cycle %u (last_cycle=%u, dropped=%d, skipped: %d)\n",
                         this, dropped_cycles, cycle, m_last_cycle, dropped, skipped);
-            m_dropped += dropped_cycles - skipped;
         }
         #endif
+        if (skipped) {
+            m_stat_skipped.add(skipped);
+        }
+        if (dropped_cycles > 0) {
+            m_stat_dropped.add(dropped_cycles);
+        }
     }
 
     #ifdef DEBUG
@@ -1751,8 +2272,11 @@ IsoHandlerManager::IsoHandler::getPacket(unsigned char *data, unsigned int *leng
         if (cycle >= 0) {
             if (retval!=RAW1394_ISO_DEFER && retval!=RAW1394_ISO_AGAIN) {
                 m_last_cycle = cycle;
-            } else
+            } else {
                 m_deferred_cycles++;
+                m_tuning.deferred++;
+                m_stat_deferred.add();
+            }
         }
         return retval;
     }
@@ -1777,29 +2301,28 @@ IsoHandlerManager::IsoHandler::enable(int cycle)
         return false;
     }
 
-    assert(m_handle == NULL);
+    assert(m_backend == NULL);
 
-    // create a handle for the ISO traffic
-    m_handle = raw1394_new_handle_on_port( m_manager.get1394Service().getPort() );
-    if ( !m_handle ) {
-        if ( !errno ) {
-            debugError("libraw1394 not compatible\n");
-        } else {
-            debugError("Could not get 1394 handle: %s\n", strerror(errno) );
-            debugError("Are ieee1394 and raw1394 drivers loaded?\n");
-        }
+    // create a backend for the ISO traffic
+    m_backend = IsoBackend::create(m_manager.m_iso_backend_type, *this,
+                                   m_manager.get1394Service().getPort());
+    if ( !m_backend ) {
+        return false;
+    }
+    m_backend->setVerboseLevel(getDebugLevel());
+    if ( !m_backend->open() ) {
+        debugError("Could not open %s ISO backend\n", m_backend->getName());
+        delete m_backend;
+        m_backend = NULL;
         return false;
     }
-    raw1394_set_userdata(m_handle, static_cast<void *>(this));
 
     // Reset housekeeping data before preparing and starting the handler. 
     // If only done afterwards, the transmit handler could be called before
     // these have been reset, leading to problems in getPacket().
-#ifdef DEBUG
-    m_min_ahead = 7999;
-#endif
     m_packets = 0;
     m_last_cycle = -1;
+    m_tuning.resetStats();
 
     // indicate that the first iterate() still has to occur.
     m_last_now = 0xFFFFFFFF;
@@ -1809,40 +2332,38 @@ IsoHandlerManager::IsoHandler::enable(int cycle)
     debugOutput( DEBUG_LEVEL_VERBOSE, "Preparing iso handler (%p, client=%p)\n", this, m_Client);
     dumpInfo();
     if (getType() == eHT_Receive) {
-        if(raw1394_iso_recv_init(m_handle,
-                                iso_receive_handler,
-                                m_buf_packets,
-                                m_max_packet_size,
-                                m_Client->getChannel(),
-                                m_receive_mode,
-                                m_irq_interval)) {
-            debugFatal("Could not do receive initialization (PACKET_PER_BUFFER)!\n" );
-            debugFatal("  %s\n",strerror(errno));
-            return false;
-        }
-
-        if(raw1394_iso_recv_start(m_handle, cycle, -1, 0)) {
-            debugFatal("Could not start receive handler (%s)\n",strerror(errno));
-            dumpInfo();
+        if(!m_backend->initReceive(m_buf_packets,
+                                   m_max_packet_size,
+                                   m_Client->getChannel(),
+                                   m_receive_mode,
+                                   m_irq_interval)) {
+            debugFatal("Could not do receive initialization!\n" );
+            m_backend->close();
+            delete m_backend;
+            m_backend = NULL;
             return false;
         }
     } else {
-        if(raw1394_iso_xmit_init(m_handle,
-                                iso_transmit_handler,
-                                m_buf_packets,
-                                m_max_packet_size,
-                                m_Client->getChannel(),
-                                m_speed,
-                                m_irq_interval)) {
+        if(!m_backend->initTransmit(m_buf_packets,
+                                    m_max_packet_size,
+                                    m_Client->getChannel(),
+                                    m_speed,
+                                    m_irq_interval)) {
             debugFatal("Could not do xmit initialisation!\n" );
+            m_backend->close();
+            delete m_backend;
+            m_backend = NULL;
             return false;
         }
+    }
 
-        if(raw1394_iso_xmit_start(m_handle, cycle, 0)) {
-            debugFatal("Could not start xmit handler (%s)\n", strerror(errno));
-            dumpInfo();
-            return false;
-        }
+    if(!m_backend->start(cycle)) {
+        debugFatal("Could not start %s handler\n", getTypeString());
+        dumpInfo();
+        m_backend->close();
+        delete m_backend;
+        m_backend = NULL;
+        return false;
     }
 
     m_State = eHS_Running;
@@ -1887,13 +2408,16 @@ IsoHandlerManager::IsoHandler::disable()
         return false;
     }
 
-    assert(m_handle != NULL);
+    assert(m_backend != NULL);
+
+    // the new values take effect when the handler is enabled again
+    retune();
 
     debugOutput( DEBUG_LEVEL_VERBOSE, "(%p, %s) wake up handle...\n", 
                  this, (m_type==eHT_Receive?"Receive":"Transmit"));
 
     // wake up any waiting reads/polls
-    raw1394_wake_up(m_handle);
+    m_backend->wakeUp();
 
     // this is put here to try and avoid the
     // Runaway context problem
@@ -1905,20 +2429,16 @@ IsoHandlerManager::IsoHandler::disable()
                  this, (m_type==eHT_Receive?"Receive":"Transmit"));
 
     // stop iso traffic
-    raw1394_iso_stop(m_handle);
-    // deallocate resources
-
-    // Don't call until libraw1394's raw1394_new_handle() function has been
-    // fixed to correctly initialise the iso_packet_infos field.  Bug is
-    // confirmed present in libraw1394 1.2.1.
-    raw1394_iso_shutdown(m_handle);
+    m_backend->stop();
 
+    // deallocate resources
     // When running on the new kernel firewire stack, this call can take of
     // the order of 20 milliseconds to return, in which time other threads
     // may wish to test the state of the handler and call this function
     // themselves.  The m_disable_lock mutex is used to work around this.
-    raw1394_destroy_handle(m_handle);
-    m_handle = NULL;
+    m_backend->close();
+    delete m_backend;
+    m_backend = NULL;
 
     m_State = eHS_Stopped;
     m_NextState = eHS_Stopped;
@@ -1940,6 +2460,8 @@ IsoHandlerManager::IsoHandler::requestEnable(int cycle)
         debugError("Enable requested on stream '%s' with state: %d\n", getTypeString(), m_State);
         return false;
     }
+    // not in enable(), that runs in the iso thread
+    registerStats();
     m_NextState = eHS_Running;
     return true;
 }
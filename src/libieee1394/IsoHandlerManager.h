@@ -29,6 +29,9 @@
 #include "debugmodule/debugmodule.h"
 
 #include "libutil/Thread.h"
+#include "libutil/StatsRegistry.h"
+
+#include "IsoBackend.h"
 
 #include <sys/poll.h>
 #include <errno.h>
@@ -60,18 +63,19 @@ namespace Streaming {
 class IsoHandlerManager
 {
     friend class IsoTask;
+    friend class IsoEventTask;
 
 ////
 /*!
     \brief The Base Class for ISO Handlers
 
-    These classes perform the actual ISO communication through libraw1394.
+    These classes perform the actual ISO communication through an IsoBackend.
     They are different from Streaming::StreamProcessors because one handler can provide multiple
     streams with packets in case of ISO multichannel receive.
 
  */
 
-    class IsoHandler
+    class IsoHandler : public IsoBackend::Client
     {
         public:
             enum EHandlerType {
@@ -86,21 +90,10 @@ class IsoHandlerManager
             ~IsoHandler();
 
             private: // the ISO callback interface
-                static enum raw1394_iso_disposition
-                        iso_receive_handler(raw1394handle_t handle, unsigned char *data,
-                                            unsigned int length, unsigned char channel,
-                                            unsigned char tag, unsigned char sy, unsigned int cycle,
-                                            unsigned int dropped);
-
                 enum raw1394_iso_disposition
                         putPacket(unsigned char *data, unsigned int length,
                                   unsigned char channel, unsigned char tag, unsigned char sy,
                                   unsigned int cycle, unsigned int dropped);
-
-                static enum raw1394_iso_disposition iso_transmit_handler(raw1394handle_t handle,
-                        unsigned char *data, unsigned int *length,
-                        unsigned char *tag, unsigned char *sy,
-                        int cycle, unsigned int dropped);
                 enum raw1394_iso_disposition
                         getPacket(unsigned char *data, unsigned int *length,
                                   unsigned char *tag, unsigned char *sy,
@@ -121,7 +114,7 @@ class IsoHandlerManager
      */
             bool iterate(uint32_t ctr_now);
 
-            int getFileDescriptor() { return raw1394_get_fd(m_handle);};
+            int getFileDescriptor() { return m_backend->getFileDescriptor();};
 
             bool init();
             void setVerboseLevel(int l);
@@ -159,6 +152,19 @@ class IsoHandlerManager
             unsigned int getNbBuffers() { return m_buf_packets;};
             int getIrqInterval() { return m_irq_interval;};
 
+    /**
+             * @brief let the handler retune its IRQ interval and buffer depth
+             *
+             * The values the handler was created with are the starting point,
+             * and the upper bound for the IRQ interval. At the end of every
+             * run the statistics of that run decide the values for the next.
+             * Has to be called before the stream is registered.
+             * @param min_irq_interval lower bound for the IRQ interval
+             * @param max_buf_packets upper bound for the buffer depth
+     */
+            void setAdaptiveTuning(bool enable, int min_irq_interval,
+                                   unsigned int max_buf_packets);
+
             void dumpInfo();
 
             bool inUse() {return (m_Client != 0) ;};
@@ -199,9 +205,12 @@ class IsoHandlerManager
             bool handleBusReset();
 
         private:
+            // decides the IRQ interval and buffer depth for the next run
+            void retune();
+
             IsoHandlerManager& m_manager;
             enum EHandlerType m_type;
-            raw1394handle_t m_handle;
+            IsoBackend *    m_backend;
             unsigned int    m_buf_packets;
             unsigned int    m_max_packet_size;
             int             m_irq_interval;
@@ -214,6 +223,36 @@ class IsoHandlerManager
 
             enum raw1394_iso_speed m_speed;
 
+            // adaptive tuning state, the statistics are those of the current run
+            struct AdaptiveTuning {
+                AdaptiveTuning()
+                    : enabled( false )
+                    , min_irq_interval( 1 ), max_irq_interval( 1 )
+                    , min_buf_packets( 0 ), max_buf_packets( 0 )
+                    , runs( 0 ), changes( 0 )
+                    {reason[0] = '\0'; resetStats();};
+                void resetStats()
+                    {packets = 0; late_packets = 0; max_age = 0; min_ahead = 7999;
+                     dropped = 0; deferred = 0;};
+
+                bool            enabled;
+                int             min_irq_interval;
+                int             max_irq_interval;
+                unsigned int    min_buf_packets;
+                unsigned int    max_buf_packets;
+
+                uint64_t        packets;
+                unsigned int    late_packets;
+                int             max_age;    // receive: cycles between the wire and the handler
+                int             min_ahead;  // transmit: cycles between the handler and the wire
+                unsigned int    dropped;
+                unsigned int    deferred;
+
+                unsigned int    runs;
+                unsigned int    changes;
+                char            reason[160];
+            } m_tuning;
+
     // the state machine
             enum EHandlerStates {
                 eHS_Stopped,
@@ -226,13 +265,18 @@ class IsoHandlerManager
 
             pthread_mutex_t m_disable_lock;
 
+            // published statistics, registered when the handler is
+            // started (the name has the channel) until the client detaches
+            void registerStats();
+            void unregisterStats();
+
         public:
             unsigned int    m_packets;
-#ifdef DEBUG
-            unsigned int    m_dropped;
-            unsigned int    m_skipped;
-            int             m_min_ahead;
-#endif
+            Util::Stat      m_stat_packets;
+            Util::Stat      m_stat_dropped;
+            Util::Stat      m_stat_skipped;
+            Util::Stat      m_stat_deferred;
+            Util::Stat      m_stat_latency;
             unsigned int m_deferred_cycles;
 
         protected:
@@ -254,9 +298,9 @@ class IsoHandlerManager
             IsoTask(IsoHandlerManager& manager, enum IsoHandler::EHandlerType);
             virtual ~IsoTask();
 
-        private:
-            bool Init();
-            bool Execute();
+        protected:
+            virtual bool Init();
+            virtual bool Execute();
 
         /**
              * @brief requests the thread to sync it's stream map with the manager
@@ -272,7 +316,7 @@ class IsoHandlerManager
         /**
              * @brief signals that something happened in one of the clients of this task
          */
-            void signalActivity();
+            virtual void signalActivity();
         /**
              * @brief wait until something happened in one of the clients of this task
          */
@@ -285,6 +329,12 @@ class IsoHandlerManager
 
             void setVerboseLevel(int i);
 
+        /**
+             * @brief number of times the task woke up to service its handlers
+         */
+            unsigned int getWakeupCount() {return m_wakeups;};
+            void dumpInfo();
+
         protected:
             IsoHandlerManager& m_manager;
 
@@ -301,6 +351,12 @@ class IsoHandlerManager
 
         // updates the streams map
             void updateShadowMapHelper();
+        // returns true if the handler type is serviced by this task
+            bool isTaskHandlerType(enum IsoHandler::EHandlerType t)
+                {return m_all_handler_types || t == m_handlerType;};
+        // notifies the handlers that haven't seen packets for too long
+        // returns true if one or more handlers have died
+            bool checkForDeadHandlers(uint32_t ctr_now);
 
 #ifdef DEBUG
             uint64_t m_last_loop_entry;
@@ -308,6 +364,7 @@ class IsoHandlerManager
 #endif
 
             enum IsoHandler::EHandlerType m_handlerType;
+            bool m_all_handler_types;
             bool m_running;
             bool m_in_busreset;
 
@@ -315,9 +372,61 @@ class IsoHandlerManager
             sem_t m_activity_semaphore;
             long long int m_activity_wait_timeout_nsec;
 
+        // wakeup statistics (not updated atomically, only for reporting)
+            unsigned int m_wakeups;
+            unsigned int m_wakeups_iso;
+            unsigned int m_wakeups_activity;
+            unsigned int m_wakeups_timeout;
+
         // debug stuff
             DECLARE_DEBUG_MODULE;
     };
+
+// a task that services the handlers of both directions from one thread.
+// it waits on an epoll set containing the handler fd's (only armed when
+// the client can be iterated), an eventfd for client activity and a
+// timerfd that is programmed for the cycle timer instant at which the
+// next ISO interrupt is overdue. This replaces the fixed poll timeout
+// and the semaphore wait of the per-direction tasks.
+    class IsoEventTask : public IsoTask
+    {
+        friend class IsoHandlerManager;
+        public:
+            IsoEventTask(IsoHandlerManager& manager);
+            virtual ~IsoEventTask();
+
+        protected:
+            bool Init();
+            bool Execute();
+            void signalActivity();
+
+        private:
+        // syncs the epoll set with the shadow map
+            bool updateEpollSet();
+        // (dis)arms the handler fd's, returns the number of armed handlers
+            unsigned int updateEpollEvents();
+        // programs the timer, 0 disarms it
+            bool armTimer(int64_t nsecs);
+        // returns the time (in ns) until the next iso interrupt of the
+        // armed handlers is overdue
+            int64_t getNextDeadline(uint32_t ctr_now);
+
+            int m_epoll_fd;
+            int m_activity_fd;
+            int m_timer_fd;
+
+        // the fd's currently in the epoll set
+            int m_epoll_fds[ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT];
+            unsigned int m_epoll_nfds;
+        // the handlers whose fd reported a hangup or an error, they
+        // are no longer in the epoll set
+            bool m_epoll_dead[ISOHANDLERMANAGER_MAX_ISO_HANDLERS_PER_PORT];
+        // successive wakeups that did no work
+            unsigned int m_idle_wakeups;
+
+            uint32_t m_last_ctr;
+            unsigned int m_timer_margin_cycles;
+    };
     
 //// the IsoHandlerManager itself
     public:
@@ -328,6 +437,11 @@ class IsoHandlerManager
 
         bool setThreadParameters(bool rt, int priority);
 
+        /**
+         * @brief returns the number of wakeups of the iso thread(s)
+         */
+        unsigned int getWakeupCount();
+
         void setVerboseLevel(int l); ///< set the verbose level
 
         void dumpInfo(); ///< print some information about the manager to stdout/stderr
@@ -426,6 +540,13 @@ class IsoHandlerManager
         IsoTask *       m_IsoTaskTransmit;
         Util::Thread *  m_IsoThreadReceive;
         IsoTask *       m_IsoTaskReceive;
+        // when one thread services both directions, the transmit and
+        // receive task pointers refer to the same IsoEventTask and
+        // there is no receive thread
+        bool            m_single_iso_thread;
+
+        // the kernel interface used by the handlers
+        enum IsoBackend::EBackendType m_iso_backend_type;
 
         bool            m_MissedCyclesOK;
 
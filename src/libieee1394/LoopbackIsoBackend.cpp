@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "LoopbackIsoBackend.h"
+#include "SimulatedBus.h"
+#include "cycletimer.h"
+
+LoopbackIsoBackend::LoopbackIsoBackend(Client &client, int port)
+    : FakeIsoBackend(client, port)
+    , m_bus( SimulatedBus::get(port) )
+    , m_open_channel( -1 )
+    , m_start_cycle_count( 0 )
+{
+}
+
+LoopbackIsoBackend::~LoopbackIsoBackend()
+{
+    close();
+}
+
+void
+LoopbackIsoBackend::close()
+{
+    FakeIsoBackend::close();
+    if (m_open_channel >= 0) {
+        m_bus.closeChannel(m_open_channel);
+        m_open_channel = -1;
+    }
+}
+
+bool
+LoopbackIsoBackend::openChannel(int channel, unsigned int max_packet_size)
+{
+    if (m_open_channel >= 0) {
+        m_bus.closeChannel(m_open_channel);
+        m_open_channel = -1;
+    }
+    if (!m_bus.openChannel(channel, max_packet_size)) {
+        return false;
+    }
+    m_open_channel = channel;
+    return true;
+}
+
+bool
+LoopbackIsoBackend::initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                                int channel, enum raw1394_iso_dma_recv_mode mode,
+                                int irq_interval)
+{
+    if (!FakeIsoBackend::initReceive(buf_packets, max_packet_size, channel, mode, irq_interval)) {
+        return false;
+    }
+    return openChannel(channel, max_packet_size);
+}
+
+bool
+LoopbackIsoBackend::initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                                 int channel, enum raw1394_iso_speed speed,
+                                 int irq_interval)
+{
+    if (buf_packets >= IEEE1394SERVICE_SIMULATED_BUS_ISO_RING_PACKETS / 2) {
+        debugError("Transmit buffer of %u packets is too large for the simulated bus\n", buf_packets);
+        return false;
+    }
+    if (!FakeIsoBackend::initTransmit(buf_packets, max_packet_size, channel, speed, irq_interval)) {
+        return false;
+    }
+    return openChannel(channel, max_packet_size);
+}
+
+unsigned int
+LoopbackIsoBackend::getStartCycle(int cycle)
+{
+    uint64_t now = m_bus.getCurrentCycleCount();
+    if (cycle >= 0) {
+        // the next occurrence of the requested cycle
+        unsigned int now_cycle = now % CYCLES_PER_SECOND;
+        cycle %= CYCLES_PER_SECOND;
+        now += (cycle + CYCLES_PER_SECOND - now_cycle) % CYCLES_PER_SECOND;
+    }
+    m_start_cycle_count = now;
+    debugOutput(DEBUG_LEVEL_VERBOSE, "channel %d: start at cycle %u\n",
+                getChannel(), (unsigned int)(now % CYCLES_PER_SECOND));
+    return now % CYCLES_PER_SECOND;
+}
+
+uint64_t
+LoopbackIsoBackend::getCyclesElapsed()
+{
+    uint64_t limit = m_bus.getCurrentCycleCount();
+    if (isReceive()) {
+        // a packet is complete once its cycle has passed
+        uint64_t delay = 1 + m_bus.getReceiveDelayCycles();
+        limit = (limit > delay ? limit - delay : 0);
+    } else {
+        // the transmit DMA runs ahead by the buffer size
+        limit += getBufferPackets();
+    }
+    return (limit > m_start_cycle_count ? limit - m_start_cycle_count : 0);
+}
+
+unsigned int
+LoopbackIsoBackend::generatePacket(unsigned char *data, unsigned int max_length,
+                                   unsigned int cycle,
+                                   unsigned char *tag, unsigned char *sy)
+{
+    unsigned int length;
+    if (!m_bus.receive(getChannel(), m_start_cycle_count + getCyclesDone(),
+                       data, max_length, &length, tag, sy)) {
+        return NO_PACKET;
+    }
+    return length;
+}
+
+void
+LoopbackIsoBackend::consumePacket(unsigned char *data, unsigned int length,
+                                  unsigned char tag, unsigned char sy,
+                                  unsigned int cycle)
+{
+    m_bus.transmit(getChannel(), m_start_cycle_count + getCyclesDone(),
+                   data, length, tag, sy);
+}
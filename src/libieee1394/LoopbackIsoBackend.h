@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_LOOPBACKISOBACKEND__
+#define __FFADO_LOOPBACKISOBACKEND__
+
+#include "FakeIsoBackend.h"
+
+class SimulatedBus;
+
+/*!
+\brief The ISO backend of the simulated bus
+
+ Transmits the packets to and receives them from the SimulatedBus of the
+ port. The cycles follow the cycle timer of that bus. Like a DMA context,
+ a transmit context runs ahead of the bus by its buffer size. A receive
+ context sees a packet once its cycle has passed, plus a random delay
+ within the jitter of the bus. The cycles in which no packet was sent
+ are skipped.
+*/
+class LoopbackIsoBackend : public FakeIsoBackend
+{
+public:
+    LoopbackIsoBackend(Client &client, int port);
+    virtual ~LoopbackIsoBackend();
+
+    const char *getName() {return "loopback";};
+
+    void close();
+
+    bool initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                     int channel, enum raw1394_iso_dma_recv_mode mode,
+                     int irq_interval);
+    bool initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                      int channel, enum raw1394_iso_speed speed,
+                      int irq_interval);
+
+protected:
+    unsigned int generatePacket(unsigned char *data, unsigned int max_length,
+                                unsigned int cycle,
+                                unsigned char *tag, unsigned char *sy);
+    void consumePacket(unsigned char *data, unsigned int length,
+                       unsigned char tag, unsigned char sy,
+                       unsigned int cycle);
+
+    unsigned int getStartCycle(int cycle);
+    uint64_t getCyclesElapsed();
+
+private:
+    bool openChannel(int channel, unsigned int max_packet_size);
+
+    SimulatedBus&   m_bus;
+    int             m_open_channel;
+    // the bus cycle count of the first packet
+    uint64_t        m_start_cycle_count;
+};
+
+#endif /* __FFADO_LOOPBACKISOBACKEND__ */
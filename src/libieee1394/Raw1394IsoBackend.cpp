@@ -0,0 +1,218 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "Raw1394IsoBackend.h"
+
+#include <errno.h>
+#include <cstring>
+#include <assert.h>
+
+Raw1394IsoBackend::Raw1394IsoBackend(Client &client, int port)
+    : IsoBackend(client, port)
+    , m_handle( NULL )
+    , m_receive( false )
+    , m_initialized( false )
+{
+}
+
+Raw1394IsoBackend::~Raw1394IsoBackend()
+{
+    close();
+}
+
+/* the C callbacks */
+enum raw1394_iso_disposition
+Raw1394IsoBackend::iso_transmit_handler(raw1394handle_t handle,
+        unsigned char *data, unsigned int *length,
+        unsigned char *tag, unsigned char *sy,
+        int cycle, unsigned int dropped1) {
+
+    Raw1394IsoBackend *backend = static_cast<Raw1394IsoBackend *>(raw1394_get_userdata(handle));
+    assert(backend);
+    unsigned int skipped = (dropped1 & 0xFFFF0000) >> 16;
+    unsigned int dropped = dropped1 & 0xFFFF;
+    return backend->m_client.getPacket(data, length, tag, sy, cycle, dropped, skipped);
+}
+
+enum raw1394_iso_disposition
+Raw1394IsoBackend::iso_receive_handler(raw1394handle_t handle, unsigned char *data,
+                        unsigned int length, unsigned char channel,
+                        unsigned char tag, unsigned char sy, unsigned int cycle,
+                        unsigned int dropped) {
+
+    Raw1394IsoBackend *backend = static_cast<Raw1394IsoBackend *>(raw1394_get_userdata(handle));
+    assert(backend);
+    return backend->m_client.putPacket(data, length, channel, tag, sy, cycle, dropped);
+}
+
+bool
+Raw1394IsoBackend::open()
+{
+    assert(m_handle == NULL);
+
+    // create a handle for the ISO traffic
+    m_handle = raw1394_new_handle_on_port( m_port );
+    if ( !m_handle ) {
+        if ( !errno ) {
+            debugError("libraw1394 not compatible\n");
+        } else {
+            debugError("Could not get 1394 handle: %s\n", strerror(errno) );
+            debugError("Are ieee1394 and raw1394 drivers loaded?\n");
+        }
+        return false;
+    }
+    raw1394_set_userdata(m_handle, static_cast<void *>(this));
+    return true;
+}
+
+void
+Raw1394IsoBackend::close()
+{
+    if (m_handle == NULL) return;
+    stop();
+
+    // When running on the new kernel firewire stack, this call can take of
+    // the order of 20 milliseconds to return.
+    raw1394_destroy_handle(m_handle);
+    m_handle = NULL;
+}
+
+bool
+Raw1394IsoBackend::initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                               int channel, enum raw1394_iso_dma_recv_mode mode,
+                               int irq_interval)
+{
+    assert(m_handle);
+    if(raw1394_iso_recv_init(m_handle,
+                            iso_receive_handler,
+                            buf_packets,
+                            max_packet_size,
+                            channel,
+                            mode,
+                            irq_interval)) {
+        debugFatal("Could not do receive initialization (PACKET_PER_BUFFER)!\n" );
+        debugFatal("  %s\n",strerror(errno));
+        return false;
+    }
+    m_receive = true;
+    m_initialized = true;
+    return true;
+}
+
+bool
+Raw1394IsoBackend::initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                                int channel, enum raw1394_iso_speed speed,
+                                int irq_interval)
+{
+    assert(m_handle);
+    if(raw1394_iso_xmit_init(m_handle,
+                            iso_transmit_handler,
+                            buf_packets,
+                            max_packet_size,
+                            channel,
+                            speed,
+                            irq_interval)) {
+        debugFatal("Could not do xmit initialisation!\n" );
+        return false;
+    }
+    m_receive = false;
+    m_initialized = true;
+    return true;
+}
+
+bool
+Raw1394IsoBackend::start(int cycle)
+{
+    assert(m_handle);
+    if (m_receive) {
+        if(raw1394_iso_recv_start(m_handle, cycle, -1, 0)) {
+            debugFatal("Could not start receive handler (%s)\n",strerror(errno));
+            return false;
+        }
+    } else {
+        if(raw1394_iso_xmit_start(m_handle, cycle, 0)) {
+            debugFatal("Could not start xmit handler (%s)\n", strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+Raw1394IsoBackend::stop()
+{
+    if (m_handle == NULL || !m_initialized) return;
+
+    // stop iso traffic
+    raw1394_iso_stop(m_handle);
+
+    // deallocate resources
+    // Don't call until libraw1394's raw1394_new_handle() function has been
+    // fixed to correctly initialise the iso_packet_infos field.  Bug is
+    // confirmed present in libraw1394 1.2.1.
+    raw1394_iso_shutdown(m_handle);
+    m_initialized = false;
+}
+
+bool
+Raw1394IsoBackend::iterate()
+{
+    assert(m_handle);
+    if(raw1394_loop_iterate(m_handle)) {
+        debugError( "Failed to iterate handle: %s\n", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+void
+Raw1394IsoBackend::flush()
+{
+    if (m_receive) {
+        raw1394_iso_recv_flush(m_handle);
+    }
+}
+
+void
+Raw1394IsoBackend::wakeUp()
+{
+    // wake up any waiting reads/polls
+    if (m_handle) raw1394_wake_up(m_handle);
+}
+
+bool
+Raw1394IsoBackend::handleBusReset()
+{
+    if (m_handle == NULL) return true;
+
+    #define CSR_CYCLE_TIME            0x200
+    #define CSR_REGISTER_BASE  0xfffff0000000ULL
+    // do a simple read on ourself in order to update the internal structures
+    // this avoids read failures after a bus reset
+    quadlet_t buf=0;
+    raw1394_read(m_handle, raw1394_get_local_id(m_handle),
+                 CSR_REGISTER_BASE | CSR_CYCLE_TIME, 4, &buf);
+    return true;
+}
@@ -0,0 +1,79 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_RAW1394ISOBACKEND__
+#define __FFADO_RAW1394ISOBACKEND__
+
+#include "IsoBackend.h"
+
+/*!
+\brief ISO backend using the libraw1394 iso API
+
+ Works on both the old ieee1394 and the new firewire kernel stacks.
+*/
+class Raw1394IsoBackend : public IsoBackend
+{
+public:
+    Raw1394IsoBackend(Client &client, int port);
+    virtual ~Raw1394IsoBackend();
+
+    const char *getName() {return "raw1394";};
+
+    bool open();
+    void close();
+
+    bool initReceive(unsigned int buf_packets, unsigned int max_packet_size,
+                     int channel, enum raw1394_iso_dma_recv_mode mode,
+                     int irq_interval);
+    bool initTransmit(unsigned int buf_packets, unsigned int max_packet_size,
+                      int channel, enum raw1394_iso_speed speed,
+                      int irq_interval);
+
+    bool start(int cycle);
+    void stop();
+
+    int getFileDescriptor() {return raw1394_get_fd(m_handle);};
+    bool iterate();
+    void flush();
+    void wakeUp();
+    bool handleBusReset();
+
+private: // the libraw1394 callbacks
+    static enum raw1394_iso_disposition
+            iso_receive_handler(raw1394handle_t handle, unsigned char *data,
+                                unsigned int length, unsigned char channel,
+                                unsigned char tag, unsigned char sy, unsigned int cycle,
+                                unsigned int dropped);
+    static enum raw1394_iso_disposition
+            iso_transmit_handler(raw1394handle_t handle,
+                                 unsigned char *data, unsigned int *length,
+                                 unsigned char *tag, unsigned char *sy,
+                                 int cycle, unsigned int dropped);
+
+private:
+    raw1394handle_t m_handle;
+    bool            m_receive;
+    bool            m_initialized;
+};
+
+#endif /* __FFADO_RAW1394ISOBACKEND__ */
@@ -0,0 +1,827 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "SimulatedBus.h"
+#include "cycletimer.h"
+
+#include "libutil/SystemTimeSource.h"
+#include "libutil/PosixMutex.h"
+#include "libutil/ByteSwap.h"
+
+#include <libraw1394/csr.h>
+
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <deque>
+
+IMPL_DEBUG_MODULE( SimulatedBus, SimulatedBus, DEBUG_LEVEL_NORMAL );
+
+// the cycle timer starts this many seconds before it wraps
+#define SIMULATEDBUS_START_SECONDS_BEFORE_WRAP  4
+// the key of the local node in the register map, the id of the
+// local node changes when nodes are added
+#define SIMULATEDBUS_LOCAL_NODE_KEY             0x3F
+#define SIMULATEDBUS_MAX_NODES                  63
+// the bandwidth of an idle bus, in allocation units
+#define SIMULATEDBUS_BANDWIDTH_AVAILABLE        4915
+#define SIMULATEDBUS_INVALID_CYCLE              0xFFFFFFFFFFFFFFFFULL
+// the largest packet a node can forward (the S400 limit)
+#define SIMULATEDBUS_MAX_FORWARD_PACKET_SIZE    2048
+
+// the config ROM of the local node
+#define SIMULATEDBUS_LOCAL_GUID                 0x0000000000000001ULL
+
+typedef std::map< int, SimulatedBus* > simulated_bus_map_t;
+static simulated_bus_map_t g_simulated_buses;
+static pthread_mutex_t g_simulated_buses_lock = PTHREAD_MUTEX_INITIALIZER;
+
+// --- the FCP transport
+
+struct SimulatedFcpResponse {
+    fb_nodeid_t nodeId;
+    unsigned int length;
+    unsigned char data[MAX_FCP_BLOCK_SIZE_BYTES];
+};
+
+/**
+ * The commands are handled by the node as soon as they are sent, the
+ * responses are queued until the engine iterates the transport. Both
+ * happen on the engine thread, so the queue needs no lock.
+ */
+class SimulatedFcpTransport : public FcpEngine::Transport
+{
+public:
+    SimulatedFcpTransport( SimulatedBus& bus )
+        : m_bus( bus )
+        , m_engine( NULL )
+        , m_fd( -1 )
+    {};
+    virtual ~SimulatedFcpTransport() {close();};
+
+    virtual bool open( FcpEngine& engine ) {
+        m_engine = &engine;
+        m_fd = eventfd( 0, EFD_NONBLOCK );
+        return m_fd >= 0;
+    };
+    virtual void close() {
+        if (m_fd >= 0) {
+            ::close( m_fd );
+            m_fd = -1;
+        }
+        m_responses.clear();
+    };
+
+    virtual bool sendRequest( fb_nodeid_t nodeId, fb_quadlet_t* data,
+                              unsigned int length ) {
+        struct SimulatedFcpResponse r;
+        r.nodeId = 0xffc0 | nodeId;
+        if (!m_bus.sendFcpCommand( nodeId, (const unsigned char*)data, length * 4,
+                                   r.data, &r.length )) {
+            return false;
+        }
+        if (r.length) {
+            m_responses.push_back( r );
+            uint64_t one = 1;
+            if (::write( m_fd, &one, sizeof(one) ) < 0) {
+                return false;
+            }
+        }
+        return true;
+    };
+    virtual int getFileDescriptor() {return m_fd;};
+    virtual bool iterate() {
+        uint64_t count;
+        if (::read( m_fd, &count, sizeof(count) ) < 0 && errno != EAGAIN) {
+            return false;
+        }
+        while (!m_responses.empty()) {
+            struct SimulatedFcpResponse r = m_responses.front();
+            m_responses.pop_front();
+            m_engine->handleResponse( r.nodeId, r.data, r.length );
+        }
+        return true;
+    };
+
+private:
+    SimulatedBus&   m_bus;
+    FcpEngine*      m_engine;
+    int             m_fd;
+    std::deque< struct SimulatedFcpResponse > m_responses;
+};
+
+// --- the bus
+
+SimulatedBus&
+SimulatedBus::get( int port )
+{
+    pthread_mutex_lock( &g_simulated_buses_lock );
+    SimulatedBus* bus;
+    simulated_bus_map_t::iterator it = g_simulated_buses.find( port );
+    if (it == g_simulated_buses.end()) {
+        bus = new SimulatedBus( port );
+        g_simulated_buses[port] = bus;
+    } else {
+        bus = it->second;
+    }
+    pthread_mutex_unlock( &g_simulated_buses_lock );
+    return *bus;
+}
+
+SimulatedBus::SimulatedBus( int port )
+    : m_port( port )
+    , m_drift_ppm( 0.0 )
+    , m_jitter_usecs( 0 )
+    , m_loss_ppm( 0 )
+    , m_base_usecs( Util::SystemTimeSource::getCurrentTimeAsUsecs() )
+    , m_tick_base( (128ULL - SIMULATEDBUS_START_SECONDS_BEFORE_WRAP) * TICKS_PER_SECOND )
+    , m_ticks_per_usec( TICKS_PER_USEC )
+    , m_iso_lock( new Util::PosixMutex("SIMISO") )
+    , m_channels_allocated( 0 )
+    , m_bandwidth_available( SIMULATEDBUS_BANDWIDTH_AVAILABLE )
+    , m_random_seed( port + 1 )
+    , m_nb_transmitted( 0 )
+    , m_nb_lost( 0 )
+    , m_async_lock( new Util::PosixMutex("SIMASYNC") )
+    , m_generation( 1 )
+{
+    for (unsigned int i = 0; i < 64; i++) {
+        m_iso_channels[i].users = 0;
+        m_iso_channels[i].max_packet_size = 0;
+        m_iso_channels[i].slots = NULL;
+        m_iso_channels[i].data = NULL;
+        m_iso_channels[i].route = -1;
+        m_iso_channels[i].route_node = NULL;
+        m_iso_channels[i].route_cycle = SIMULATEDBUS_INVALID_CYCLE;
+    }
+
+    // the local node has a config ROM too, the bus scan reads its GUID
+    fb_nodeid_t local = getLocalNodeId();
+    setConfigRom( local, SIMULATEDBUS_LOCAL_GUID, 0, 0, 0, 0, "FFADO", "Simulated bus" );
+    // SPLIT_TIMEOUT defaults to 100ms
+    mapRegisters( local, CSR_REGISTER_BASE + CSR_SPLIT_TIMEOUT_HI, 1, 0 );
+    mapRegisters( local, CSR_REGISTER_BASE + CSR_SPLIT_TIMEOUT_LO, 1, 800 << 19 );
+}
+
+SimulatedBus::~SimulatedBus()
+{
+    for ( node_vec_t::iterator it = m_nodes.begin();
+          it != m_nodes.end();
+          ++it )
+    {
+        delete *it;
+    }
+    for (unsigned int i = 0; i < 64; i++) {
+        delete[] m_iso_channels[i].slots;
+        delete[] m_iso_channels[i].data;
+    }
+    delete m_iso_lock;
+    delete m_async_lock;
+}
+
+// --- parameters
+
+void
+SimulatedBus::setDriftPpm( float ppm )
+{
+    // rebase, such that the cycle timer continues from its current value
+    uint64_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    m_tick_base = getTicks( now );
+    m_base_usecs = now;
+    m_ticks_per_usec = TICKS_PER_USEC * (1.0 + ppm * 1e-6);
+    m_drift_ppm = ppm;
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: cycle timer drift %f ppm\n", m_port, ppm );
+}
+
+void
+SimulatedBus::setJitterUsecs( unsigned int usecs )
+{
+    m_jitter_usecs = usecs;
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: receive jitter %u usecs\n", m_port, usecs );
+}
+
+void
+SimulatedBus::setLossPpm( unsigned int ppm )
+{
+    m_loss_ppm = ppm;
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: packet loss %u ppm\n", m_port, ppm );
+}
+
+// --- topology
+
+int
+SimulatedBus::getNodeCount()
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    return m_nodes.size() + 1;
+}
+
+fb_nodeid_t
+SimulatedBus::getLocalNodeId()
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    return m_nodes.size();
+}
+
+unsigned int
+SimulatedBus::getGeneration()
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    return m_generation;
+}
+
+int
+SimulatedBus::addNode( Node* node )
+{
+    int nodeId;
+    {
+        Util::MutexLockHelper lock(*m_async_lock);
+        if (m_nodes.size() + 1 >= SIMULATEDBUS_MAX_NODES) {
+            debugError( "Too many nodes on simulated bus %d\n", m_port );
+            return -1;
+        }
+        nodeId = m_nodes.size();
+        m_nodes.push_back( node );
+        // a node joining the bus causes a bus reset
+        m_generation++;
+    }
+    // outside of the lock, attach() sets up the registers
+    if (!node->attach( *this, nodeId )) {
+        debugError( "Could not attach node %d to simulated bus %d\n", nodeId, m_port );
+        Util::MutexLockHelper lock(*m_async_lock);
+        m_nodes.pop_back();
+        return -1;
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: added node %d\n", m_port, nodeId );
+    return nodeId;
+}
+
+void
+SimulatedBus::busReset()
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    m_generation++;
+}
+
+bool
+SimulatedBus::isValidNode( fb_nodeid_t nodeId )
+{
+    return (nodeId & 0x3F) <= m_nodes.size();
+}
+
+SimulatedBus::Node*
+SimulatedBus::getNode( fb_nodeid_t nodeId )
+{
+    unsigned int phy = nodeId & 0x3F;
+    return (phy < m_nodes.size() ? m_nodes.at( phy ) : NULL);
+}
+
+// --- cycle timer
+
+uint64_t
+SimulatedBus::getTicks( uint64_t usecs )
+{
+    int64_t dt = (int64_t)(usecs - m_base_usecs);
+    int64_t ticks = (int64_t)m_tick_base + (int64_t)(dt * m_ticks_per_usec);
+    return (ticks < 0 ? 0 : ticks);
+}
+
+uint64_t
+SimulatedBus::getCycleCount( uint64_t usecs )
+{
+    return getTicks( usecs ) / TICKS_PER_CYCLE;
+}
+
+uint64_t
+SimulatedBus::getCurrentCycleCount()
+{
+    return getCycleCount( Util::SystemTimeSource::getCurrentTimeAsUsecs() );
+}
+
+uint32_t
+SimulatedBus::getCycleTimer( uint64_t usecs )
+{
+    uint64_t ticks = getTicks( usecs ) % (128ULL * TICKS_PER_SECOND);
+    return TICKS_TO_CYCLE_TIMER( ticks );
+}
+
+void
+SimulatedBus::readCycleTimer( uint32_t* cycle_timer, uint64_t* local_time )
+{
+    *local_time = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    *cycle_timer = getCycleTimer( *local_time );
+}
+
+// --- iso
+
+bool
+SimulatedBus::modifyChannel( int channel, bool allocate )
+{
+    if (channel < 0 || channel > 63) {
+        return false;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    uint64_t mask = 1ULL << channel;
+    if (allocate) {
+        if (m_channels_allocated & mask) {
+            return false;
+        }
+        m_channels_allocated |= mask;
+    } else {
+        if (!(m_channels_allocated & mask)) {
+            return false;
+        }
+        m_channels_allocated &= ~mask;
+    }
+    return true;
+}
+
+bool
+SimulatedBus::modifyBandwidth( unsigned int bandwidth, bool allocate )
+{
+    Util::MutexLockHelper lock(*m_iso_lock);
+    if (allocate) {
+        if (bandwidth > m_bandwidth_available) {
+            return false;
+        }
+        m_bandwidth_available -= bandwidth;
+    } else {
+        if (m_bandwidth_available + bandwidth > SIMULATEDBUS_BANDWIDTH_AVAILABLE) {
+            return false;
+        }
+        m_bandwidth_available += bandwidth;
+    }
+    return true;
+}
+
+unsigned int
+SimulatedBus::getAvailableBandwidth()
+{
+    Util::MutexLockHelper lock(*m_iso_lock);
+    return m_bandwidth_available;
+}
+
+bool
+SimulatedBus::openChannel( int channel, unsigned int max_packet_size )
+{
+    if (channel < 0 || channel > 63) {
+        debugError( "Invalid channel %d\n", channel );
+        return false;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    struct IsoChannel *ch = &m_iso_channels[channel];
+    ch->users++;
+    if (max_packet_size > ch->max_packet_size) {
+        // the packets in the ring are lost, this only happens
+        // while the streams start
+        unsigned int nb_slots = IEEE1394SERVICE_SIMULATED_BUS_ISO_RING_PACKETS;
+        delete[] ch->data;
+        ch->data = new unsigned char[nb_slots * max_packet_size];
+        if (ch->slots == NULL) {
+            ch->slots = new struct IsoSlot[nb_slots];
+        }
+        for (unsigned int i = 0; i < nb_slots; i++) {
+            ch->slots[i].cycle = SIMULATEDBUS_INVALID_CYCLE;
+        }
+        ch->max_packet_size = max_packet_size;
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: opened channel %d, %u users, max packet size %u\n",
+                 m_port, channel, ch->users, ch->max_packet_size );
+    return true;
+}
+
+void
+SimulatedBus::closeChannel( int channel )
+{
+    if (channel < 0 || channel > 63) {
+        return;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    struct IsoChannel *ch = &m_iso_channels[channel];
+    if (ch->users == 0 || --ch->users > 0) {
+        return;
+    }
+    delete[] ch->slots;
+    delete[] ch->data;
+    ch->slots = NULL;
+    ch->data = NULL;
+    ch->max_packet_size = 0;
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: closed channel %d\n", m_port, channel );
+}
+
+void
+SimulatedBus::setRoute( int from, int to, Node* node )
+{
+    if (from < 0 || from > 63 || to > 63) {
+        debugError( "Invalid route %d => %d\n", from, to );
+        return;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    m_iso_channels[from].route = to;
+    m_iso_channels[from].route_node = (to >= 0 ? node : NULL);
+    m_iso_channels[from].route_cycle = SIMULATEDBUS_INVALID_CYCLE;
+    debugOutput( DEBUG_LEVEL_VERBOSE, "port %d: route %d => %d\n", m_port, from, to );
+}
+
+void
+SimulatedBus::storePacket( int channel, uint64_t cycle,
+                           const unsigned char* data, unsigned int length,
+                           unsigned char tag, unsigned char sy )
+{
+    struct IsoChannel *ch = &m_iso_channels[channel];
+    if (ch->slots == NULL) {
+        // nobody listens
+        return;
+    }
+    if (length > ch->max_packet_size) {
+        debugWarning( "channel %d: packet of %u bytes truncated to %u\n",
+                      channel, length, ch->max_packet_size );
+        length = ch->max_packet_size;
+    }
+    unsigned int idx = cycle % IEEE1394SERVICE_SIMULATED_BUS_ISO_RING_PACKETS;
+    struct IsoSlot *slot = &ch->slots[idx];
+    memcpy( ch->data + idx * ch->max_packet_size, data, length );
+    slot->cycle = cycle;
+    slot->length = length;
+    slot->tag = tag;
+    slot->sy = sy;
+}
+
+bool
+SimulatedBus::transmit( int channel, uint64_t cycle,
+                        const unsigned char* data, unsigned int length,
+                        unsigned char tag, unsigned char sy )
+{
+    if (channel < 0 || channel > 63) {
+        return false;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    m_nb_transmitted++;
+    bool lost = false;
+    if (m_loss_ppm && (unsigned int)(rand_r( &m_random_seed ) % 1000000) < m_loss_ppm) {
+        m_nb_lost++;
+        lost = true;
+    } else {
+        storePacket( channel, cycle, data, length, tag, sy );
+    }
+    struct IsoChannel *ch = &m_iso_channels[channel];
+    int route = ch->route;
+    if (route < 0 || route == channel) {
+        return true;
+    }
+    if (ch->route_node) {
+        // the node has its own clock, it sends in the cycles in which the
+        // transmitter was too late to send, as long as they are buffered
+        uint64_t first_cycle = cycle;
+        if (ch->route_cycle != SIMULATEDBUS_INVALID_CYCLE && cycle > ch->route_cycle
+            && cycle - ch->route_cycle < IEEE1394SERVICE_SIMULATED_BUS_ISO_RING_PACKETS) {
+            first_cycle = ch->route_cycle + 1;
+        }
+        unsigned char buffer[SIMULATEDBUS_MAX_FORWARD_PACKET_SIZE];
+        for (uint64_t c = first_cycle; c <= cycle; c++) {
+            bool received = (c == cycle && !lost);
+            unsigned int forward_length = ch->route_node->forwardPacket( c, data, (received ? length : 0),
+                                                                         buffer, sizeof(buffer) );
+            if (forward_length) {
+                storePacket( route, c, buffer, forward_length, tag, sy );
+            }
+        }
+        ch->route_cycle = cycle;
+    } else if (!lost) {
+        storePacket( route, cycle, data, length, tag, sy );
+    }
+    return true;
+}
+
+bool
+SimulatedBus::receive( int channel, uint64_t cycle,
+                       unsigned char* data, unsigned int max_length,
+                       unsigned int* length, unsigned char* tag, unsigned char* sy )
+{
+    if (channel < 0 || channel > 63) {
+        return false;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    struct IsoChannel *ch = &m_iso_channels[channel];
+    if (ch->slots == NULL) {
+        return false;
+    }
+    unsigned int idx = cycle % IEEE1394SERVICE_SIMULATED_BUS_ISO_RING_PACKETS;
+    struct IsoSlot *slot = &ch->slots[idx];
+    if (slot->cycle != cycle) {
+        return false;
+    }
+    *length = (slot->length > max_length ? max_length : slot->length);
+    *tag = slot->tag;
+    *sy = slot->sy;
+    memcpy( data, ch->data + idx * ch->max_packet_size, *length );
+    return true;
+}
+
+unsigned int
+SimulatedBus::getReceiveDelayCycles()
+{
+    unsigned int max_cycles = (m_jitter_usecs + USECS_PER_CYCLE - 1) / USECS_PER_CYCLE;
+    if (max_cycles == 0) {
+        return 0;
+    }
+    Util::MutexLockHelper lock(*m_iso_lock);
+    return rand_r( &m_random_seed ) % (max_cycles + 1);
+}
+
+// --- async
+
+uint64_t
+SimulatedBus::registerKey( fb_nodeid_t nodeId, fb_nodeaddr_t addr )
+{
+    uint64_t phy = nodeId & 0x3F;
+    if (phy == m_nodes.size()) {
+        phy = SIMULATEDBUS_LOCAL_NODE_KEY;
+    }
+    return (phy << 48) | (addr & 0xFFFFFFFFFFFFULL);
+}
+
+bool
+SimulatedBus::read( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                    size_t length, fb_quadlet_t* buffer )
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    if (!isValidNode( nodeId )) {
+        return false;
+    }
+    bool local = ((nodeId & 0x3F) == m_nodes.size());
+    for (size_t i = 0; i < length; i++) {
+        fb_nodeaddr_t a = addr + 4 * i;
+        fb_quadlet_t value;
+        if (local && a == CSR_REGISTER_BASE + CSR_CYCLE_TIME) {
+            value = getCycleTimer( Util::SystemTimeSource::getCurrentTimeAsUsecs() );
+        } else if (local && a == CSR_REGISTER_BASE + CSR_BANDWIDTH_AVAILABLE) {
+            value = getAvailableBandwidth();
+        } else {
+            register_map_t::iterator it = m_registers.find( registerKey( nodeId, a ) );
+            if (it == m_registers.end()) {
+                debugOutput( DEBUG_LEVEL_VERBOSE, "read: no register at node 0x%hX, addr 0x%012"PRIX64"\n",
+                             nodeId, a );
+                return false;
+            }
+            value = it->second;
+        }
+        buffer[i] = CondSwapToBus32( value );
+    }
+    return true;
+}
+
+bool
+SimulatedBus::write( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                     size_t length, const fb_quadlet_t* data )
+{
+    Node* node;
+    {
+        Util::MutexLockHelper lock(*m_async_lock);
+        if (!isValidNode( nodeId )) {
+            return false;
+        }
+        // the write either completes or fails as a whole
+        for (size_t i = 0; i < length; i++) {
+            if (m_registers.find( registerKey( nodeId, addr + 4 * i ) ) == m_registers.end()) {
+                debugOutput( DEBUG_LEVEL_VERBOSE, "write: no register at node 0x%hX, addr 0x%012"PRIX64"\n",
+                             nodeId, addr + 4 * i );
+                return false;
+            }
+        }
+        for (size_t i = 0; i < length; i++) {
+            m_registers[registerKey( nodeId, addr + 4 * i )] = CondSwapFromBus32( data[i] );
+        }
+        node = getNode( nodeId );
+    }
+    // the node might access the bus
+    if (node) {
+        node->handleWrite( addr, length );
+    }
+    return true;
+}
+
+bool
+SimulatedBus::lockCompareSwap64( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                                 fb_octlet_t compare_value, fb_octlet_t swap_value,
+                                 fb_octlet_t* result )
+{
+    Node* node;
+    {
+        Util::MutexLockHelper lock(*m_async_lock);
+        if (!isValidNode( nodeId )) {
+            return false;
+        }
+        register_map_t::iterator hi = m_registers.find( registerKey( nodeId, addr ) );
+        register_map_t::iterator lo = m_registers.find( registerKey( nodeId, addr + 4 ) );
+        if (hi == m_registers.end() || lo == m_registers.end()) {
+            return false;
+        }
+        fb_octlet_t old = ((fb_octlet_t)hi->second << 32) | lo->second;
+        *result = CondSwapToBus64( old );
+        if (old != CondSwapFromBus64( compare_value )) {
+            return true;
+        }
+        fb_octlet_t value = CondSwapFromBus64( swap_value );
+        hi->second = value >> 32;
+        lo->second = value & 0xFFFFFFFFULL;
+        node = getNode( nodeId );
+    }
+    if (node) {
+        node->handleWrite( addr, 2 );
+    }
+    return true;
+}
+
+bool
+SimulatedBus::sendFcpCommand( fb_nodeid_t nodeId,
+                              const unsigned char* command, unsigned int length,
+                              unsigned char* response, unsigned int* response_length )
+{
+    Node* node;
+    {
+        Util::MutexLockHelper lock(*m_async_lock);
+        if (!isValidNode( nodeId )) {
+            return false;
+        }
+        node = getNode( nodeId );
+    }
+    *response_length = 0;
+    if (node) {
+        *response_length = node->handleFcpCommand( command, length, response );
+    }
+    return true;
+}
+
+FcpEngine::Transport*
+SimulatedBus::createFcpTransport()
+{
+    return new SimulatedFcpTransport( *this );
+}
+
+// --- register space setup
+
+void
+SimulatedBus::mapRegisters( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                            unsigned int length, fb_quadlet_t value )
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    for (unsigned int i = 0; i < length; i++) {
+        m_registers[registerKey( nodeId, addr + 4 * i )] = value;
+    }
+}
+
+bool
+SimulatedBus::setRegister( fb_nodeid_t nodeId, fb_nodeaddr_t addr, fb_quadlet_t value )
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    register_map_t::iterator it = m_registers.find( registerKey( nodeId, addr ) );
+    if (it == m_registers.end()) {
+        return false;
+    }
+    it->second = value;
+    return true;
+}
+
+bool
+SimulatedBus::getRegister( fb_nodeid_t nodeId, fb_nodeaddr_t addr, fb_quadlet_t& value )
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    register_map_t::iterator it = m_registers.find( registerKey( nodeId, addr ) );
+    if (it == m_registers.end()) {
+        return false;
+    }
+    value = it->second;
+    return true;
+}
+
+// the CRC of IEEE 1212, over quadlets in host byte order
+static uint16_t
+configRomCrc16( const fb_quadlet_t* data, unsigned int length )
+{
+    uint32_t crc = 0;
+    for (unsigned int i = 0; i < length; i++) {
+        for (int shift = 28; shift >= 0; shift -= 4) {
+            uint32_t sum = ((crc >> 12) ^ (data[i] >> shift)) & 0xf;
+            crc = (crc << 4) ^ (sum << 12) ^ (sum << 5) ^ sum;
+        }
+        crc &= 0xffff;
+    }
+    return crc;
+}
+
+// a textual descriptor leaf, returns its length (incl. the header)
+static unsigned int
+configRomTextLeaf( fb_quadlet_t* leaf, const std::string& text )
+{
+    unsigned int nb_quads = (text.size() + 3) / 4;
+    leaf[1] = 0; // descriptor type and specifier id
+    leaf[2] = 0; // width, character set and language
+    for (unsigned int i = 0; i < nb_quads; i++) {
+        fb_quadlet_t q = 0;
+        for (unsigned int j = 0; j < 4; j++) {
+            unsigned int pos = 4 * i + j;
+            q = (q << 8) | (pos < text.size() ? (unsigned char)text[pos] : 0);
+        }
+        leaf[3 + i] = q;
+    }
+    unsigned int length = 2 + nb_quads;
+    leaf[0] = (length << 16) | configRomCrc16( leaf + 1, length );
+    return length + 1;
+}
+
+bool
+SimulatedBus::setConfigRom( fb_nodeid_t nodeId, fb_octlet_t guid,
+                            unsigned int vendor_id, unsigned int model_id,
+                            unsigned int unit_spec_id, unsigned int unit_sw_version,
+                            std::string vendor_name, std::string model_name )
+{
+    // a config ROM has at most 256 quadlets
+    fb_quadlet_t rom[256];
+    memset( rom, 0, sizeof(rom) );
+    vendor_name = vendor_name.substr( 0, 64 );
+    model_name = model_name.substr( 0, 64 );
+
+    // the bus info block: irmc, cmc, isc, max_rec = 512 bytes, S400
+    rom[1] = 0x31333934; // "1394"
+    rom[2] = 0xE0FF8002;
+    rom[3] = guid >> 32;
+    rom[4] = guid & 0xFFFFFFFFULL;
+
+    // the root directory, its entries point to the unit directory
+    // and the leaves that follow it
+    const unsigned int root = 5;
+    const unsigned int root_length = 6;
+    const unsigned int unit = root + 1 + root_length;
+    const unsigned int unit_length = 3;
+    const unsigned int vendor_leaf = unit + 1 + unit_length;
+
+    unsigned int model_leaf = vendor_leaf + configRomTextLeaf( rom + vendor_leaf, vendor_name );
+    unsigned int end = model_leaf + configRomTextLeaf( rom + model_leaf, model_name );
+
+    rom[root + 1] = (0x03 << 24) | (vendor_id & 0xFFFFFF);
+    rom[root + 2] = (0x81 << 24) | (vendor_leaf - (root + 2));
+    rom[root + 3] = 0x0C0083C0; // node capabilities
+    rom[root + 4] = (0x17 << 24) | (model_id & 0xFFFFFF);
+    rom[root + 5] = (0x81 << 24) | (model_leaf - (root + 5));
+    rom[root + 6] = (0xD1 << 24) | (unit - (root + 6));
+    rom[root] = (root_length << 16) | configRomCrc16( rom + root + 1, root_length );
+
+    rom[unit + 1] = (0x12 << 24) | (unit_spec_id & 0xFFFFFF);
+    rom[unit + 2] = (0x13 << 24) | (unit_sw_version & 0xFFFFFF);
+    rom[unit + 3] = (0x17 << 24) | (model_id & 0xFFFFFF);
+    rom[unit] = (unit_length << 16) | configRomCrc16( rom + unit + 1, unit_length );
+
+    // the CRC of the bus info block covers the complete ROM
+    rom[0] = (4 << 24) | ((end - 1) << 16) | configRomCrc16( rom + 1, end - 1 );
+
+    Util::MutexLockHelper lock(*m_async_lock);
+    for (unsigned int i = 0; i < 256; i++) {
+        m_registers[registerKey( nodeId, CSR_REGISTER_BASE + CSR_CONFIG_ROM + 4 * i )] = rom[i];
+    }
+    return true;
+}
+
+void
+SimulatedBus::show()
+{
+    Util::MutexLockHelper lock(*m_async_lock);
+    debugOutput( DEBUG_LEVEL_NORMAL, "Simulated bus on port %d\n", m_port );
+    debugOutput( DEBUG_LEVEL_NORMAL, " Nodes: %zd, local node: %zd, generation: %u\n",
+                 m_nodes.size() + 1, m_nodes.size(), m_generation );
+    debugOutput( DEBUG_LEVEL_NORMAL, " Drift: %f ppm, jitter: %u usecs, loss: %u ppm\n",
+                 m_drift_ppm, m_jitter_usecs, m_loss_ppm );
+    debugOutput( DEBUG_LEVEL_NORMAL, " Packets: %"PRIu64" transmitted, %"PRIu64" lost\n",
+                 m_nb_transmitted, m_nb_lost );
+    for (unsigned int i = 0; i < 64; i++) {
+        if (m_iso_channels[i].users) {
+            debugOutput( DEBUG_LEVEL_NORMAL, " Channel %2u: %u users, route %d\n",
+                         i, m_iso_channels[i].users, m_iso_channels[i].route );
+        }
+    }
+}
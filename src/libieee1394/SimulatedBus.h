@@ -0,0 +1,316 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_SIMULATEDBUS__
+#define __FFADO_SIMULATEDBUS__
+
+#include "fbtypes.h"
+#include "FcpEngine.h"
+
+#include "debugmodule/debugmodule.h"
+
+#include <map>
+#include <vector>
+#include <string>
+#include <string.h>
+#include <stdint.h>
+
+namespace Util {
+    class Mutex;
+}
+
+/*!
+\brief An in-process IEEE1394 bus, to run the stack without FireWire hardware
+
+ Simulates the parts of a bus that the streaming stack depends on:
+ - a cycle timer that follows the system clock with a configurable drift.
+   It starts a few seconds before it wraps, such that every run passes
+   the wrap.
+ - iso loopback: a packet transmitted on a channel is received on that
+   channel on the same cycle, unless it is lost. A node can forward a
+   channel to another one, like a device that echoes a stream.
+ - the register space of the nodes (config ROM, CSR's and device
+   registers) and FCP.
+
+ There is one bus per port, shared by the Ieee1394Service and the loopback
+ iso backends of that port. It lives as long as the process. The local
+ node is the root, i.e. it has the highest node id.
+
+ The async data is in bus byte order, like for libraw1394. The functions
+ that set up the register space use the host byte order.
+*/
+class SimulatedBus
+{
+public:
+    /**
+     * @brief a remote node on the bus
+     *
+     * The bus stores the registers of the node, the node is told about
+     * the writes to them.
+     */
+    class Node
+    {
+    public:
+        virtual ~Node() {};
+
+        ///> called when the node is added, should set up the registers
+        virtual bool attach( SimulatedBus& bus, fb_nodeid_t nodeId ) = 0;
+        /**
+         * called after a write to the registers of the node
+         * @param addr the address of the first quadlet written
+         * @param length the number of quadlets written
+         */
+        virtual void handleWrite( fb_nodeaddr_t addr, unsigned int length ) {};
+        /**
+         * handle an FCP command
+         * @param response room for MAX_FCP_BLOCK_SIZE_BYTES
+         * @return the length of the response (in bytes), 0 if none is sent
+         */
+        virtual unsigned int handleFcpCommand( const unsigned char* command,
+                                               unsigned int length,
+                                               unsigned char* response )
+            {return 0;};
+        /**
+         * called for each cycle of a channel that is routed through the
+         * node (see setRoute()), in place of forwarding the packet unchanged
+         * @param length 0 if the node didn't receive a packet in this cycle
+         * @param buffer room for the packet that is sent on the route
+         * @return the length of that packet, 0 if none is sent
+         */
+        virtual unsigned int forwardPacket( uint64_t cycle,
+                                            const unsigned char* data, unsigned int length,
+                                            unsigned char* buffer, unsigned int max_length )
+            {
+                if (length > max_length) {
+                    length = max_length;
+                }
+                memcpy( buffer, data, length );
+                return length;
+            };
+    };
+
+    ///> get the bus of a port, it is created on first use
+    static SimulatedBus& get( int port );
+
+    int getPort() {return m_port;};
+
+    /**
+     * @name Bus parameters
+     * Can be changed at any time, but the streams will see the step
+     * of the cycle timer when the drift is changed while they run.
+     */
+    //@{
+    void setDriftPpm( float ppm );
+    float getDriftPpm() {return m_drift_ppm;};
+    ///> received packets are delayed by up to this amount
+    void setJitterUsecs( unsigned int usecs );
+    unsigned int getJitterUsecs() {return m_jitter_usecs;};
+    ///> the probability that a transmitted packet is lost (in ppm)
+    void setLossPpm( unsigned int ppm );
+    unsigned int getLossPpm() {return m_loss_ppm;};
+    //@}
+
+    /**
+     * @name Topology
+     */
+    //@{
+    int getNodeCount();
+    fb_nodeid_t getLocalNodeId();
+    unsigned int getGeneration();
+    /**
+     * @brief add a remote node, the bus takes ownership
+     * @return the node id, -1 if the node could not be added
+     */
+    int addNode( Node* node );
+    ///> start a new generation
+    void busReset();
+    //@}
+
+    /**
+     * @name Cycle timer
+     */
+    //@{
+    ///> the number of cycles since the start of the bus at a time instant
+    uint64_t getCycleCount( uint64_t usecs );
+    uint64_t getCurrentCycleCount();
+    ///> the value of the cycle timer register at a time instant
+    uint32_t getCycleTimer( uint64_t usecs );
+    ///> like raw1394_read_cycle_timer()
+    void readCycleTimer( uint32_t* cycle_timer, uint64_t* local_time );
+    //@}
+
+    /**
+     * @name Iso resources and traffic
+     */
+    //@{
+    ///> like raw1394_channel_modify()
+    bool modifyChannel( int channel, bool allocate );
+    ///> like raw1394_bandwidth_modify()
+    bool modifyBandwidth( unsigned int bandwidth, bool allocate );
+    unsigned int getAvailableBandwidth();
+
+    ///> a backend starts to use a channel
+    bool openChannel( int channel, unsigned int max_packet_size );
+    void closeChannel( int channel );
+    /**
+     * @brief forward the packets of a channel to another one
+     * @param to the destination, -1 stops the forwarding
+     * @param node if set, the node builds the packets that are sent on
+     *             the destination (see Node::forwardPacket())
+     */
+    void setRoute( int from, int to, Node* node = NULL );
+
+    /**
+     * @brief send a packet
+     * @param cycle the cycle count (see getCycleCount())
+     * @return false if the packet can't be sent
+     */
+    bool transmit( int channel, uint64_t cycle,
+                   const unsigned char* data, unsigned int length,
+                   unsigned char tag, unsigned char sy );
+    /**
+     * @brief fetch the packet of a cycle
+     * @return false if no packet was sent on the channel in this cycle
+     */
+    bool receive( int channel, uint64_t cycle,
+                  unsigned char* data, unsigned int max_length,
+                  unsigned int* length, unsigned char* tag, unsigned char* sy );
+    ///> a random receive delay, within the jitter
+    unsigned int getReceiveDelayCycles();
+
+    uint64_t getTransmittedCount() {return m_nb_transmitted;};
+    uint64_t getLostCount() {return m_nb_lost;};
+    //@}
+
+    /**
+     * @name Async transactions
+     * the length is in quadlets, the data in bus byte order
+     */
+    //@{
+    bool read( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+               size_t length, fb_quadlet_t* buffer );
+    bool write( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                size_t length, const fb_quadlet_t* data );
+    bool lockCompareSwap64( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                            fb_octlet_t compare_value, fb_octlet_t swap_value,
+                            fb_octlet_t* result );
+    /**
+     * @brief send an FCP command to a node
+     * @param response room for MAX_FCP_BLOCK_SIZE_BYTES
+     * @param response_length set to the response length in bytes,
+     *                        0 if the node doesn't respond
+     * @return false if the node doesn't exist
+     */
+    bool sendFcpCommand( fb_nodeid_t nodeId,
+                         const unsigned char* command, unsigned int length,
+                         unsigned char* response, unsigned int* response_length );
+
+    ///> create a transport for an FcpEngine that talks to this bus
+    FcpEngine::Transport* createFcpTransport();
+    //@}
+
+    /**
+     * @name Register space setup
+     * the values are in host byte order
+     */
+    //@{
+    ///> make a register range accessible, with an initial value
+    void mapRegisters( fb_nodeid_t nodeId, fb_nodeaddr_t addr,
+                       unsigned int length, fb_quadlet_t value );
+    bool setRegister( fb_nodeid_t nodeId, fb_nodeaddr_t addr, fb_quadlet_t value );
+    bool getRegister( fb_nodeid_t nodeId, fb_nodeaddr_t addr, fb_quadlet_t& value );
+
+    /**
+     * @brief set up a config ROM
+     *
+     * The bus info block and a root directory with the vendor and the model
+     * (and their names), plus one unit directory.
+     */
+    bool setConfigRom( fb_nodeid_t nodeId, fb_octlet_t guid,
+                       unsigned int vendor_id, unsigned int model_id,
+                       unsigned int unit_spec_id, unsigned int unit_sw_version,
+                       std::string vendor_name, std::string model_name );
+    //@}
+
+    void setVerboseLevel( int l ) {setDebugLevel( l );};
+    void show();
+
+private:
+    SimulatedBus( int port );
+    ~SimulatedBus();
+
+    struct IsoSlot {
+        uint64_t        cycle;
+        unsigned int    length;
+        unsigned char   tag;
+        unsigned char   sy;
+    };
+    struct IsoChannel {
+        unsigned int    users;
+        unsigned int    max_packet_size;
+        struct IsoSlot* slots;
+        unsigned char*  data;
+        int             route;
+        Node*           route_node;
+        // the last cycle the route node has sent
+        uint64_t        route_cycle;
+    };
+
+    void storePacket( int channel, uint64_t cycle,
+                      const unsigned char* data, unsigned int length,
+                      unsigned char tag, unsigned char sy );
+    uint64_t getTicks( uint64_t usecs );
+    uint64_t registerKey( fb_nodeid_t nodeId, fb_nodeaddr_t addr );
+    bool isValidNode( fb_nodeid_t nodeId );
+    Node* getNode( fb_nodeid_t nodeId );
+
+    int             m_port;
+
+    float           m_drift_ppm;
+    unsigned int    m_jitter_usecs;
+    unsigned int    m_loss_ppm;
+
+    // the cycle timer: m_tick_base at m_base_usecs, m_ticks_per_usec after
+    uint64_t        m_base_usecs;
+    uint64_t        m_tick_base;
+    double          m_ticks_per_usec;
+
+    Util::Mutex*    m_iso_lock;
+    struct IsoChannel m_iso_channels[64];
+    uint64_t        m_channels_allocated;
+    unsigned int    m_bandwidth_available;
+    unsigned int    m_random_seed;
+    uint64_t        m_nb_transmitted;
+    uint64_t        m_nb_lost;
+
+    Util::Mutex*    m_async_lock;
+    typedef std::map< uint64_t, fb_quadlet_t > register_map_t;
+    register_map_t  m_registers;
+    typedef std::vector< Node* > node_vec_t;
+    node_vec_t      m_nodes;
+    unsigned int    m_generation;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+#endif /* __FFADO_SIMULATEDBUS__ */
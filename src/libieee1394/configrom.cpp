@@ -86,6 +86,7 @@ ConfigRom::ConfigRom( Ieee1394Service& ieee1394service, fb_nodeid_t nodeId )
     , m_nodeVendorId( 0 )
     , m_chipIdHi( 0 )
     , m_chipIdLow( 0 )
+    , m_romCrc( 0 )
     , m_vendorNameKv( 0 )
     , m_modelNameKv( 0 )
     , m_csr( 0 )
@@ -113,6 +114,7 @@ ConfigRom::ConfigRom()
     , m_nodeVendorId( 0 )
     , m_chipIdHi( 0 )
     , m_chipIdLow( 0 )
+    , m_romCrc( 0 )
     , m_vendorNameKv( 0 )
     , m_modelNameKv( 0 )
     , m_csr( 0 )
@@ -165,6 +167,7 @@ ConfigRom::initialize()
     m_nodeVendorId = ( CSR1212_BE32_TO_CPU( m_csr->bus_info_data[3] ) >> 8 );
     m_chipIdHi = ( CSR1212_BE32_TO_CPU( m_csr->bus_info_data[3] ) ) & 0xff;
     m_chipIdLow = CSR1212_BE32_TO_CPU( m_csr->bus_info_data[4] );
+    m_romCrc = CSR1212_BE32_TO_CPU( m_csr->bus_info_data[0] ) & 0xffff;
 
     // Process Root Directory
     processRootDirectory(m_csr);
@@ -530,63 +533,24 @@ ConfigRom::updatedNodeId()
                  "Checking for updated node id for device with GUID 0x%016"PRIX64"...\n",
                  getGuid());
 
-    struct csr1212_csr* csr = NULL;
-    for ( fb_nodeid_t nodeId = 0;
-          nodeId < m_1394Service.getNodeCount();
-          ++nodeId )
-    {
-        struct config_csr_info csr_info;
-        csr_info.service = &m_1394Service;
-        csr_info.nodeId = 0xffc0 | nodeId;
-        debugOutput( DEBUG_LEVEL_VERBOSE, "Looking at node %d...\n", nodeId);
-
-        csr = csr1212_create_csr( &configrom_csr1212_ops,
-                                  5 * sizeof(fb_quadlet_t),   // XXX Why 5 ?!?
-                                  &csr_info );
-
-        if (!csr || csr1212_parse_csr( csr ) != CSR1212_SUCCESS) {
-            debugWarning( "Failed to get/parse CSR\n");
-            if (csr) {
-                csr1212_destroy_csr(csr);
-                csr = NULL;
-            }
-            continue;
+    // the service scans the bus once per generation for all devices
+    fb_nodeid_t nodeId;
+    if ( m_1394Service.getNodeIdForGuid( getGuid(), nodeId ) ) {
+        if ( nodeId != getNodeId() ) {
+            debugOutput( DEBUG_LEVEL_VERBOSE,
+                         "Device with GUID 0x%016"PRIX64" changed node id "
+                         "from %d to %d\n",
+                         getGuid(),
+                         getNodeId(),
+                         nodeId );
+            m_nodeId = nodeId;
+        } else {
+            debugOutput( DEBUG_LEVEL_VERBOSE,
+                         "Device with GUID 0x%016"PRIX64" kept node id %d\n",
+                         getGuid(),
+                         getNodeId());
         }
-
-        octlet_t guid =
-            ((u_int64_t)CSR1212_BE32_TO_CPU(csr->bus_info_data[3]) << 32)
-            | CSR1212_BE32_TO_CPU(csr->bus_info_data[4]);
-
-        debugOutput( DEBUG_LEVEL_VERBOSE,
-                        " Node has GUID 0x%016"PRIX64"\n",
-                        guid);
-
-        if ( guid == getGuid() ) {
-            debugOutput( DEBUG_LEVEL_VERBOSE, "GUID matches ours\n");
-            if ( nodeId != getNodeId() ) {
-                debugOutput( DEBUG_LEVEL_VERBOSE,
-                             "Device with GUID 0x%016"PRIX64" changed node id "
-                             "from %d to %d\n",
-                             getGuid(),
-                             getNodeId(),
-                             nodeId );
-                m_nodeId = nodeId;
-            } else {
-                debugOutput( DEBUG_LEVEL_VERBOSE,
-                             "Device with GUID 0x%016"PRIX64" kept node id %d\n",
-                             getGuid(),
-                             getNodeId());
-            }
-            if (csr) {
-                csr1212_destroy_csr(csr);
-                csr = NULL;
-            }
-            return true;
-        }
-    }
-
-    if (csr) {
-        csr1212_destroy_csr(csr);
+        return true;
     }
 
     debugOutput( DEBUG_LEVEL_VERBOSE,
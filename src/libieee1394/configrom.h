@@ -80,6 +80,14 @@ class ConfigRom
     fb_quadlet_t getNodeVendorId() const
     { return m_nodeVendorId; }
 
+    /**
+     * @brief the CRC of the config ROM as found in the bus info block
+     * changes when the device reports a different ROM, e.g. after
+     * a firmware update
+     */
+    unsigned int getRomCrc() const
+    { return m_romCrc; }
+
     bool updatedNodeId();
     bool setNodeId( fb_nodeid_t nodeId );
     
@@ -140,6 +148,7 @@ class ConfigRom
     fb_quadlet_t     m_nodeVendorId;
     fb_byte_t        m_chipIdHi;
     fb_quadlet_t     m_chipIdLow;
+    unsigned int     m_romCrc;
 
     /* only used during parsing */
     struct csr1212_keyval* m_vendorNameKv;
@@ -29,6 +29,8 @@
 #include "cycletimer.h"
 #include "IsoHandlerManager.h"
 #include "CycleTimerHelper.h"
+#include "FcpEngine.h"
+#include "SimulatedBus.h"
 
 #include <unistd.h>
 #include <libraw1394/csr.h>
@@ -74,13 +76,20 @@ Ieee1394Service::Ieee1394Service()
     , m_handle_lock( new Util::PosixMutex("SRVCHND") )
     , m_util_handle( 0 )
     , m_port( -1 )
+    , m_simulated_bus( NULL )
     , m_realtime ( false )
     , m_base_priority ( 0 )
     , m_pIsoManager( new IsoHandlerManager( *this ) )
     , m_pCTRHelper ( new CycleTimerHelper( *this, IEEE1394SERVICE_CYCLETIMER_DLL_UPDATE_INTERVAL_USEC ) )
     , m_have_new_ctr_read ( false )
     , m_filterFCPResponse ( false )
+    , m_pFcpEngine ( NULL )
+    , m_fcp_block_lock( new Util::PosixMutex("SRVCFCP") )
     , m_pWatchdog ( new Util::Watchdog() )
+    , m_topology_generation ( 0 )
+    , m_topology_valid ( false )
+    , m_topology_complete ( false )
+    , m_topology_lock( new Util::PosixMutex("SRVCTOP") )
 {
     for (unsigned int i=0; i<64; i++) {
         m_channels[i].channel=-1;
@@ -102,6 +111,7 @@ Ieee1394Service::Ieee1394Service(bool rt, int prio)
     , m_handle_lock( new Util::PosixMutex("SRVCHND") )
     , m_util_handle( 0 )
     , m_port( -1 )
+    , m_simulated_bus( NULL )
     , m_realtime ( rt )
     , m_base_priority ( prio )
     , m_pIsoManager( new IsoHandlerManager( *this, rt, prio ) )
@@ -110,7 +120,13 @@ Ieee1394Service::Ieee1394Service(bool rt, int prio)
                                            IEEE1394SERVICE_CYCLETIMER_HELPER_PRIO ) )
     , m_have_new_ctr_read ( false )
     , m_filterFCPResponse ( false )
+    , m_pFcpEngine ( NULL )
+    , m_fcp_block_lock( new Util::PosixMutex("SRVCFCP") )
     , m_pWatchdog ( new Util::Watchdog() )
+    , m_topology_generation ( 0 )
+    , m_topology_valid ( false )
+    , m_topology_complete ( false )
+    , m_topology_lock( new Util::PosixMutex("SRVCTOP") )
 {
     for (unsigned int i=0; i<64; i++) {
         m_channels[i].channel=-1;
@@ -127,10 +143,12 @@ Ieee1394Service::~Ieee1394Service()
 {
     delete m_pIsoManager;
     delete m_pCTRHelper;
+    delete m_pFcpEngine;
 
-    m_resetHelper->Stop();
-    m_armHelperNormal->Stop();
-    m_armHelperRealtime->Stop();
+    // there are no helper threads on a simulated bus
+    if(m_resetHelper) m_resetHelper->Stop();
+    if(m_armHelperNormal) m_armHelperNormal->Stop();
+    if(m_armHelperRealtime) m_armHelperRealtime->Stop();
 
     for ( arm_handler_vec_t::iterator it = m_armHandlers.begin();
           it != m_armHandlers.end();
@@ -153,6 +171,8 @@ Ieee1394Service::~Ieee1394Service()
         raw1394_destroy_handle( m_handle );
     }
     delete m_handle_lock;
+    delete m_topology_lock;
+    delete m_fcp_block_lock;
 
     if(m_resetHelper) delete m_resetHelper;
     if(m_armHelperNormal) delete m_armHelperNormal;
@@ -213,6 +233,11 @@ Ieee1394Service::detectNbPorts()
 void
 Ieee1394Service::doBusReset() {
     debugOutput(DEBUG_LEVEL_VERBOSE, "Issue bus reset on service %p (port %d).\n", this, getPort());
+    if (m_simulated_bus) {
+        m_simulated_bus->busReset();
+        resetHandler( m_simulated_bus->getGeneration() );
+        return;
+    }
     raw1394_reset_bus(m_handle);
 }
 
@@ -247,6 +272,16 @@ Ieee1394Service::initialize( int port )
 {
     using namespace std;
 
+#ifdef ENABLE_SIMULATED_BUS
+    int simulated_ports = IEEE1394SERVICE_SIMULATED_BUS;
+    if(m_configuration) {
+        m_configuration->getValueForSetting("ieee1394.simulated_bus", simulated_ports);
+    }
+    if (simulated_ports > 0) {
+        return initializeSimulated( port );
+    }
+#endif
+
     int nb_ports = detectNbPorts();
     if (port + 1 > nb_ports) {
         debugFatal("Requested port (%d) out of range (# ports: %d)\n", port, nb_ports);
@@ -306,6 +341,15 @@ Ieee1394Service::initialize( int port )
         return false;
     }
 
+    // the FCP transactions have their own handle and thread
+    m_pFcpEngine = new FcpEngine( FcpEngine::createRaw1394Transport( port ) );
+    m_pFcpEngine->setVerboseLevel( getDebugLevel() );
+    m_pFcpEngine->setFilterDuplicateResponses( m_filterFCPResponse );
+    if ( !m_pFcpEngine->start() ) {
+        debugFatal("Could not start the FCP engine\n");
+        return false;
+    }
+
     // attach the reset and ARM handlers
     // NOTE: the handlers have to be started first, or there is no 1394handle
     raw1394_set_bus_reset_handler( m_resetHelper->get1394Handle(),
@@ -447,6 +491,83 @@ Ieee1394Service::initialize( int port )
     return true;
 }
 
+/**
+ * Sets up the service for the simulated bus of the port. There is no
+ * raw1394 handle, the async transactions, the cycle timer and the iso
+ * resources are those of the SimulatedBus, the iso manager uses the
+ * loopback backend.
+ */
+bool
+Ieee1394Service::initializeSimulated( int port )
+{
+    m_port = port;
+    m_portName = "Simulated";
+    m_simulated_bus = &SimulatedBus::get( port );
+    m_simulated_bus->setVerboseLevel( getDebugLevel() );
+
+    float drift_ppm = IEEE1394SERVICE_SIMULATED_BUS_DRIFT_PPM;
+    int jitter_usecs = IEEE1394SERVICE_SIMULATED_BUS_JITTER_USECS;
+    int loss_ppm = IEEE1394SERVICE_SIMULATED_BUS_LOSS_PPM;
+    if(m_configuration) {
+        m_configuration->getValueForSetting("ieee1394.simulated_bus_drift_ppm", drift_ppm);
+        m_configuration->getValueForSetting("ieee1394.simulated_bus_jitter_usecs", jitter_usecs);
+        m_configuration->getValueForSetting("ieee1394.simulated_bus_loss_ppm", loss_ppm);
+    }
+    if (drift_ppm != m_simulated_bus->getDriftPpm()) {
+        m_simulated_bus->setDriftPpm( drift_ppm );
+    }
+    m_simulated_bus->setJitterUsecs( jitter_usecs < 0 ? 0 : jitter_usecs );
+    m_simulated_bus->setLossPpm( loss_ppm < 0 ? 0 : loss_ppm );
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Using simulated bus on port %d (drift %f ppm, jitter %d usecs, loss %d ppm)\n",
+                port, drift_ppm, jitter_usecs, loss_ppm);
+
+    if(!m_pWatchdog) {
+        debugError("No valid RT watchdog found.\n");
+        return false;
+    }
+    if(!m_pWatchdog->start()) {
+        debugError("Could not start RT watchdog.\n");
+        return false;
+    }
+
+    m_pFcpEngine = new FcpEngine( m_simulated_bus->createFcpTransport() );
+    m_pFcpEngine->setVerboseLevel( getDebugLevel() );
+    m_pFcpEngine->setFilterDuplicateResponses( m_filterFCPResponse );
+    if ( !m_pFcpEngine->start() ) {
+        debugFatal("Could not start the FCP engine\n");
+        return false;
+    }
+
+    m_have_new_ctr_read = true;
+    m_have_read_ctr_and_clock = false;
+
+    if(!m_pCTRHelper) {
+        debugFatal("No CycleTimerHelper available, bad!\n");
+        return false;
+    }
+    m_pCTRHelper->setVerboseLevel(getDebugLevel());
+    if(!m_pCTRHelper->Start()) {
+        debugFatal("Could not start CycleTimerHelper\n");
+        return false;
+    }
+
+    if(!m_pIsoManager) {
+        debugFatal("No IsoHandlerManager available, bad!\n");
+        return false;
+    }
+    m_pIsoManager->setVerboseLevel(getDebugLevel());
+    if(!m_pIsoManager->init()) {
+        debugFatal("Could not initialize IsoHandlerManager\n");
+        return false;
+    }
+
+    if(!setThreadParameters(m_realtime, m_base_priority)) {
+        debugFatal("Could not set thread parameters\n");
+        return false;
+    }
+    return true;
+}
+
 bool
 Ieee1394Service::setThreadParameters(bool rt, int priority) {
     bool result = true;
@@ -475,15 +596,41 @@ Ieee1394Service::setThreadParameters(bool rt, int priority) {
 int
 Ieee1394Service::getNodeCount()
 {
+    if (m_simulated_bus) {
+        return m_simulated_bus->getNodeCount();
+    }
     Util::MutexLockHelper lock(*m_handle_lock);
     return raw1394_get_nodecount( m_handle );
 }
 
 nodeid_t Ieee1394Service::getLocalNodeId() {
+    if (m_simulated_bus) {
+        return m_simulated_bus->getLocalNodeId();
+    }
     Util::MutexLockHelper lock(*m_handle_lock);
     return raw1394_get_local_id(m_handle) & 0x3F;
 }
 
+unsigned int
+Ieee1394Service::getGeneration()
+{
+    if (m_simulated_bus) {
+        return m_simulated_bus->getGeneration();
+    }
+    Util::MutexLockHelper lock(*m_handle_lock);
+    return raw1394_get_generation( m_handle );
+}
+
+void
+Ieee1394Service::updateGeneration()
+{
+    if (m_simulated_bus) {
+        return;
+    }
+    Util::MutexLockHelper lock(*m_handle_lock);
+    raw1394_update_generation( m_handle, getGeneration());
+}
+
 /**
  * Returns the current value of the cycle timer (in ticks)
  *
@@ -539,6 +686,10 @@ Ieee1394Service::getSystemTimeForCycleTimer(uint32_t ctr) {
 bool
 Ieee1394Service::readCycleTimerReg(uint32_t *cycle_timer, uint64_t *local_time)
 {
+    if (m_simulated_bus) {
+        m_simulated_bus->readCycleTimer(cycle_timer, local_time);
+        return true;
+    } else
     if (m_have_read_ctr_and_clock) {
         int err;
         err = raw1394_read_cycle_timer_and_clock(m_util_handle, cycle_timer, local_time, 
@@ -599,7 +750,13 @@ Ieee1394Service::readNoLock( fb_nodeid_t nodeId,
         debugWarning("operation on invalid node\n");
         return false;
     }
-    if ( raw1394_read( m_handle, nodeId, addr, length*4, buffer ) == 0 ) {
+    bool ok;
+    if (m_simulated_bus) {
+        ok = m_simulated_bus->read( nodeId, addr, length, buffer );
+    } else {
+        ok = ( raw1394_read( m_handle, nodeId, addr, length*4, buffer ) == 0 );
+    }
+    if ( ok ) {
 
         #ifdef DEBUG
         debugOutput(DEBUG_LEVEL_VERY_VERBOSE,
@@ -663,6 +820,9 @@ Ieee1394Service::writeNoLock( fb_nodeid_t nodeId,
     printBuffer( DEBUG_LEVEL_VERY_VERBOSE, length, data );
     #endif
 
+    if (m_simulated_bus) {
+        return m_simulated_bus->write( nodeId, addr, length, data );
+    }
     return raw1394_write( m_handle, nodeId, addr, length*4, data ) == 0;
 }
 
@@ -714,9 +874,15 @@ Ieee1394Service::lockCompareSwap64( fb_nodeid_t nodeId,
     // do separate locking here (no MutexLockHelper) since 
     // we use read_octlet in the DEBUG code in this function
     m_handle_lock->Lock();
-    int retval=raw1394_lock64(m_handle, nodeId, addr,
+    int retval;
+    if (m_simulated_bus) {
+        retval = ( m_simulated_bus->lockCompareSwap64(nodeId, addr, compare_value,
+                                                      swap_value, result) ? 0 : -1 );
+    } else {
+        retval=raw1394_lock64(m_handle, nodeId, addr,
                               RAW1394_EXTCODE_COMPARE_SWAP,
                               swap_value, compare_value, result);
+    }
     m_handle_lock->Unlock();
 
     if(retval) {
@@ -742,238 +908,37 @@ Ieee1394Service::transactionBlock( fb_nodeid_t nodeId,
                                    int len,
                                    unsigned int* resp_len )
 {
-    // FIXME: simplify semantics
     if (nodeId == INVALID_NODE_ID) {
         debugWarning("operation on invalid node\n");
         return NULL;
     }
     // NOTE: this expects a call to transactionBlockClose to unlock
-    m_handle_lock->Lock();
+    m_fcp_block_lock->Lock();
 
-    // clear the request & response memory
-    memset(&m_fcp_block, 0, sizeof(m_fcp_block));
-
-    // make a local copy of the request
-    if(len < MAX_FCP_BLOCK_SIZE_QUADS) {
-        memcpy(m_fcp_block.request, buf, len*sizeof(quadlet_t));
-        m_fcp_block.request_length = len;
-    } else {
+    if (len > MAX_FCP_BLOCK_SIZE_QUADS) {
         debugWarning("Truncating FCP request\n");
-        memcpy(m_fcp_block.request, buf, MAX_FCP_BLOCK_SIZE_BYTES);
-        m_fcp_block.request_length = MAX_FCP_BLOCK_SIZE_QUADS;
+        len = MAX_FCP_BLOCK_SIZE_QUADS;
     }
-    m_fcp_block.target_nodeid = 0xffc0 | nodeId;
-
-    bool success = doFcpTransaction();
-    if(success) {
-        *resp_len = m_fcp_block.response_length;
-        return m_fcp_block.response;
-    } else {
+    m_fcp_block.setRequest( nodeId, buf, len );
+    if ( !m_pFcpEngine->transact( m_fcp_block ) ) {
         debugWarning("FCP transaction failed\n");
         *resp_len = 0;
         return NULL;
     }
-}
-
-bool
-Ieee1394Service::transactionBlockClose()
-{
-    m_handle_lock->Unlock();
-    return true;
-}
-
-// FCP code
-bool
-Ieee1394Service::doFcpTransaction()
-{
-    for(int i=0; i < IEEE1394SERVICE_FCP_MAX_TRIES; i++) {
-        if(doFcpTransactionTry()) {
-            return true;
-        } else {
-            debugOutput(DEBUG_LEVEL_VERBOSE, "FCP transaction try %d failed\n", i);
-            Util::SystemTimeSource::SleepUsecRelative( IEEE1394SERVICE_FCP_SLEEP_BETWEEN_FAILURES_USECS);
-        }
-    }
-    debugError("FCP transaction didn't succeed in %d tries\n", IEEE1394SERVICE_FCP_MAX_TRIES);
-    return false;
-}
-
-#define FCP_COMMAND_ADDR   0xFFFFF0000B00ULL
-#define FCP_RESPONSE_ADDR  0xFFFFF0000D00ULL
-
-/* AV/C FCP response codes */
-#define FCP_RESPONSE_NOT_IMPLEMENTED 0x08000000
-#define FCP_RESPONSE_ACCEPTED 0x09000000
-#define FCP_RESPONSE_REJECTED 0x0A000000
-#define FCP_RESPONSE_IN_TRANSITION 0x0B000000
-#define FCP_RESPONSE_IMPLEMENTED 0x0C000000
-#define FCP_RESPONSE_STABLE 0x0C000000
-#define FCP_RESPONSE_CHANGED 0x0D000000
-#define FCP_RESPONSE_INTERIM 0x0F000000
-
-/* AV/C FCP mask macros */
-#define FCP_MASK_START(x) ((x) & 0xF0000000)
-#define FCP_MASK_CTYPE(x) ((x) & 0x0F000000)
-#define FCP_MASK_RESPONSE(x) ((x) & 0x0F000000)
-#define FCP_MASK_SUBUNIT(x) ((x) & 0x00FF0000)
-#define FCP_MASK_SUBUNIT_TYPE(x) ((x) & 0x00F80000)
-#define FCP_MASK_SUBUNIT_ID(x) ((x) & 0x00070000)
-#define FCP_MASK_OPCODE(x) ((x) & 0x0000FF00)
-#define FCP_MASK_SUBUNIT_AND_OPCODE(x) ((x) & 0x00FFFF00)
-#define FCP_MASK_OPERAND0(x) ((x) & 0x000000FF)
-#define FCP_MASK_OPERAND(x, n) ((x) & (0xFF000000 >> ((((n)-1)%4)*8)))
-#define FCP_MASK_RESPONSE_OPERAND(x, n) ((x) & (0xFF000000 >> (((n)%4)*8)))
-
-bool
-Ieee1394Service::doFcpTransactionTry()
-{
-    // NOTE that access to this is protected by the m_handle lock
-    int err;
-    bool retval = true;
-    uint64_t timeout;
-
-    // prepare an fcp response handler
-    raw1394_set_fcp_handler(m_handle, _avc_fcp_handler);
-
-    // start listening for FCP requests
-    // this fails if some other program is listening for a FCP response
-    err = raw1394_start_fcp_listen(m_handle);
-    if(err) {
-        debugOutput(DEBUG_LEVEL_VERBOSE, "could not start FCP listen (err=%d, errno=%d)\n", err, errno);
-        retval = false;
-        goto out;
-    }
-
-    m_fcp_block.status = eFS_Waiting;
 
     #ifdef DEBUG
-    debugOutput(DEBUG_LEVEL_VERY_VERBOSE,"fcp request: node 0x%hX, length = %d bytes\n",
-                m_fcp_block.target_nodeid, m_fcp_block.request_length*4);
-    printBuffer(DEBUG_LEVEL_VERY_VERBOSE, m_fcp_block.request_length, m_fcp_block.request );
+    printBuffer(DEBUG_LEVEL_VERY_VERBOSE, m_fcp_block.getResponseLength(), m_fcp_block.getResponse() );
     #endif
 
-    // write the FCP request
-    if(!writeNoLock( m_fcp_block.target_nodeid, FCP_COMMAND_ADDR,
-                     m_fcp_block.request_length, m_fcp_block.request)) {
-        debugOutput(DEBUG_LEVEL_VERBOSE, "write of FCP request failed\n");
-        retval = false;
-        goto out;
-    }
-
-    // wait for the response to arrive
-    struct pollfd raw1394_poll;
-    raw1394_poll.fd = raw1394_get_fd(m_handle);
-    raw1394_poll.events = POLLIN;
-
-    timeout = Util::SystemTimeSource::getCurrentTimeAsUsecs() +
-              IEEE1394SERVICE_FCP_RESPONSE_TIMEOUT_USEC;
-
-    while(m_fcp_block.status == eFS_Waiting 
-          && Util::SystemTimeSource::getCurrentTimeAsUsecs() < timeout) {
-        if(poll( &raw1394_poll, 1, IEEE1394SERVICE_FCP_POLL_TIMEOUT_MSEC) > 0) {
-            if (raw1394_poll.revents & POLLIN) {
-                raw1394_loop_iterate(m_handle);
-            }
-        }
-    }
-
-    // check the request and figure out what happened
-    if(m_fcp_block.status == eFS_Waiting) {
-        debugOutput(DEBUG_LEVEL_VERBOSE, "FCP response timed out\n");
-        retval = false;
-        goto out;
-    }
-    if(m_fcp_block.status == eFS_Error) {
-        debugError("FCP request/response error\n");
-        retval = false;
-        goto out;
-    }
-
-out:
-    // stop listening for FCP responses
-    err = raw1394_stop_fcp_listen(m_handle);
-    if(err) {
-        debugOutput(DEBUG_LEVEL_VERBOSE, "could not stop FCP listen (err=%d, errno=%d)\n", err, errno);
-        retval = false;
-    }
-
-    m_fcp_block.status = eFS_Empty;
-    return retval;
+    *resp_len = m_fcp_block.getResponseLength();
+    return m_fcp_block.getResponse();
 }
 
-int
-Ieee1394Service::_avc_fcp_handler(raw1394handle_t handle, nodeid_t nodeid, 
-                                  int response, size_t length,
-                                  unsigned char *data)
-{
-    Ieee1394Service *service = static_cast<Ieee1394Service *>(raw1394_get_userdata(handle));
-    if(service) {
-        return service->handleFcpResponse(nodeid, response, length, data);
-    } else return -1;
-}
-
-int
-Ieee1394Service::handleFcpResponse(nodeid_t nodeid,
-                                   int response, size_t length,
-                                   unsigned char *data)
+bool
+Ieee1394Service::transactionBlockClose()
 {
-    static struct sFcpBlock fcp_block_last;
-
-    fb_quadlet_t *data_quads = (fb_quadlet_t *)data;
-    #ifdef DEBUG
-    debugOutput(DEBUG_LEVEL_VERY_VERBOSE,"fcp response: node 0x%hX, response = %d, length = %zd bytes\n",
-                nodeid, response, length);
-    printBuffer(DEBUG_LEVEL_VERY_VERBOSE, (length+3)/4, data_quads );
-    #endif
-
-    if (response && length > 3) {
-        if(length > MAX_FCP_BLOCK_SIZE_BYTES) {
-            length = MAX_FCP_BLOCK_SIZE_BYTES;
-            debugWarning("Truncated FCP response\n");
-        }
-
-        // is it an actual response or is it INTERIM?
-        quadlet_t first_quadlet = CondSwapFromBus32(data_quads[0]);
-        if(FCP_MASK_RESPONSE(first_quadlet) == FCP_RESPONSE_INTERIM) {
-            debugOutput(DEBUG_LEVEL_VERBOSE, "INTERIM\n");
-        } else {
-            // it's an actual response, check if it matches our request
-            if(nodeid != m_fcp_block.target_nodeid) {
-                debugOutput(DEBUG_LEVEL_VERBOSE, "FCP response node id's don't match! (%x, %x)\n",
-                                                 m_fcp_block.target_nodeid, nodeid);
-            } else if (first_quadlet == 0) {
-                debugWarning("Bogus FCP response\n");
-                printBuffer(DEBUG_LEVEL_WARNING, (length+3)/4, data_quads );
-#ifdef DEBUG
-            } else if(FCP_MASK_RESPONSE(first_quadlet) < 0x08000000) {
-                debugWarning("Bogus AV/C FCP response code\n");
-                printBuffer(DEBUG_LEVEL_WARNING, (length+3)/4, data_quads );
-#endif
-            } else if(FCP_MASK_SUBUNIT_AND_OPCODE(first_quadlet) 
-                      != FCP_MASK_SUBUNIT_AND_OPCODE(CondSwapFromBus32(m_fcp_block.request[0]))) {
-                debugOutput(DEBUG_LEVEL_VERBOSE, "FCP response not for this request: %08X != %08X\n",
-                             FCP_MASK_SUBUNIT_AND_OPCODE(first_quadlet),
-                             FCP_MASK_SUBUNIT_AND_OPCODE(CondSwapFromBus32(m_fcp_block.request[0])));
-            } else if(m_filterFCPResponse && (memcmp(fcp_block_last.response, data, length) == 0)) {
-                // This is workaround for the Edirol FA-101. The device tends to send more than
-                // one responde to one request. This seems to happen when discovering 
-                // function blocks and looks very likely there is a race condition in the 
-                // device. The workaround here compares the just arrived FCP responde
-                // to the last one. If it is the same as the previously one then we
-                // just ignore it. The downside of this approach is, we cannot issue
-                // the same FCP twice.
-                debugWarning("Received duplicate FCP response. Ignore it\n");
-            } else {
-                m_fcp_block.response_length = (length + sizeof(quadlet_t) - 1) / sizeof(quadlet_t);
-                memcpy(m_fcp_block.response, data, length);
-                if (m_filterFCPResponse) {
-                    memcpy(fcp_block_last.response, data, length);
-                }
-                m_fcp_block.status = eFS_Responded;
-            }
-       }
-    }
-    return 0;
+    m_fcp_block_lock->Unlock();
+    return true;
 }
 
 bool
@@ -1036,6 +1001,9 @@ void
 Ieee1394Service::setFCPResponseFiltering(bool enable)
 {
     m_filterFCPResponse = enable;
+    if (m_pFcpEngine) {
+        m_pFcpEngine->setFilterDuplicateResponses(enable);
+    }
 }
 
 int
@@ -1098,9 +1066,11 @@ Ieee1394Service::resetHandler( unsigned int generation )
 {
     quadlet_t buf=0;
 
-    m_handle_lock->Lock();
-    raw1394_update_generation(m_handle, generation);
-    m_handle_lock->Unlock();
+    if (!m_simulated_bus) {
+        m_handle_lock->Lock();
+        raw1394_update_generation(m_handle, generation);
+        m_handle_lock->Unlock();
+    }
 
     // do a simple read on ourself in order to update the internal structures
     // this avoids failures after a bus reset
@@ -1119,11 +1089,199 @@ Ieee1394Service::resetHandler( unsigned int generation )
     return true;
 }
 
+// one quadlet read of the bus info block of a node
+struct topology_read {
+    struct raw1394_reqhandle rh;
+    fb_nodeid_t nodeId;
+    fb_nodeaddr_t addr;
+    fb_quadlet_t value;
+    bool ok;
+    unsigned int *completed;
+};
+
+static int
+topologyReadCallback( raw1394handle_t handle, void *data, raw1394_errcode_t err )
+{
+    struct topology_read *r = (struct topology_read *)data;
+    r->ok = ( raw1394_errcode_to_errno( err ) == 0 );
+    (*r->completed)++;
+    return 0;
+}
+
+bool
+Ieee1394Service::getNodeIdForGuid( fb_octlet_t guid, fb_nodeid_t& nodeId )
+{
+    Util::MutexLockHelper lock(*m_topology_lock);
+    unsigned int generation = getGeneration();
+
+    if ( !m_topology_valid || m_topology_generation != generation ) {
+        updateTopologyCache( generation );
+    }
+    guid_node_map_t::iterator it = m_guidToNode.find( guid );
+    if ( it == m_guidToNode.end() && !m_topology_complete ) {
+        // the node we are looking for might be one that could not be read
+        debugOutput( DEBUG_LEVEL_VERBOSE, "GUID 0x%016"PRIX64" not found, rescanning the bus...\n", guid );
+        updateTopologyCache( generation );
+        it = m_guidToNode.find( guid );
+    }
+    if ( it == m_guidToNode.end() ) {
+        return false;
+    }
+    nodeId = it->second;
+    return true;
+}
+
+bool
+Ieee1394Service::getGuidForNodeId( fb_nodeid_t nodeId, fb_octlet_t& guid )
+{
+    Util::MutexLockHelper lock(*m_topology_lock);
+    unsigned int generation = getGeneration();
+
+    if ( !m_topology_valid || m_topology_generation != generation ) {
+        updateTopologyCache( generation );
+    }
+    // a bus has at most 63 nodes, no need for a reverse map
+    for ( guid_node_map_t::iterator it = m_guidToNode.begin();
+          it != m_guidToNode.end();
+          ++it )
+    {
+        if ( it->second == nodeId ) {
+            guid = it->first;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * Reads the GUID of all nodes on the bus. The reads are pipelined, i.e.
+ * the requests for all nodes are sent before waiting for the responses.
+ * Nodes that don't respond in time are retried with blocking reads.
+ */
+bool
+Ieee1394Service::updateTopologyCache( unsigned int generation )
+{
+    #ifdef DEBUG_MESSAGES
+    uint64_t start = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    #endif
+    int nb_nodes = getNodeCount();
+    unsigned int nb_reads = 2 * nb_nodes;
+
+    m_guidToNode.clear();
+    m_topology_valid = false;
+    m_topology_complete = false;
+    m_topology_generation = generation;
+
+    if ( nb_nodes <= 0 ) {
+        return false;
+    }
+
+    // the reads and their completion counter are on the heap, such that
+    // they can be left to requests that are still pending after an error
+    unsigned int *completed = new unsigned int( 0 );
+    struct topology_read *reads = new struct topology_read[nb_reads];
+    for ( unsigned int i = 0; i < nb_reads; i++ ) {
+        struct topology_read *r = &reads[i];
+        r->rh.callback = topologyReadCallback;
+        r->rh.data = r;
+        r->nodeId = 0xffc0 | ( i / 2 );
+        // the GUID is in quadlets 3 and 4 of the bus info block
+        r->addr = CSR_REGISTER_BASE + CSR_CONFIG_ROM + ( 3 + ( i % 2 ) ) * 4;
+        r->value = 0;
+        r->ok = false;
+        r->completed = completed;
+    }
+
+    if ( m_simulated_bus ) {
+        // the reads complete immediately, no need to pipeline them
+        for ( unsigned int i = 0; i < nb_reads; i++ ) {
+            struct topology_read *r = &reads[i];
+            r->ok = read( r->nodeId, r->addr, 1, &r->value );
+        }
+        *completed = nb_reads;
+    }
+
+    m_handle_lock->Lock();
+    unsigned int started = 0;
+    while ( *completed < nb_reads ) {
+        while ( started < nb_reads
+                && started - *completed < IEEE1394SERVICE_TOPOLOGY_MAX_PENDING_READS ) {
+            struct topology_read *r = &reads[started];
+            if ( raw1394_start_read( m_handle, r->nodeId, r->addr, 4,
+                                     &r->value, (unsigned long)&r->rh ) == 0 ) {
+                started++;
+            } else if ( started > *completed ) {
+                // wait for a pending read to complete and retry
+                break;
+            } else {
+                // nothing pending, so this one won't succeed either
+                // leave it to the blocking retry below
+                started++;
+                ( *completed )++;
+            }
+        }
+        if ( started > *completed ) {
+            if ( raw1394_loop_iterate( m_handle ) < 0 ) {
+                m_handle_lock->Unlock();
+                debugError( "Failed to iterate handle while scanning the bus: %s\n", strerror(errno) );
+                // the pending requests still refer to the reads and the
+                // counter, leak them rather than have a late response
+                // write to freed memory
+                return false;
+            }
+        }
+    }
+    m_handle_lock->Unlock();
+
+    bool complete = true;
+    for ( unsigned int i = 0; i < nb_reads; i++ ) {
+        struct topology_read *r = &reads[i];
+        int nb_retries = 5;
+        while ( !r->ok && nb_retries-- ) {
+            Util::SystemTimeSource::SleepUsecRelative( IEEE1394SERVICE_CONFIGROM_READ_WAIT_USECS );
+            r->ok = read( r->nodeId, r->addr, 1, &r->value );
+        }
+        complete &= r->ok;
+    }
+
+    for ( int node = 0; node < nb_nodes; node++ ) {
+        if ( !reads[2 * node].ok || !reads[2 * node + 1].ok ) {
+            debugOutput( DEBUG_LEVEL_VERBOSE, "Could not read the GUID of node %d\n", node );
+            continue;
+        }
+        fb_octlet_t guid = ( (fb_octlet_t)CondSwapFromBus32( reads[2 * node].value ) << 32 )
+                           | CondSwapFromBus32( reads[2 * node + 1].value );
+        debugOutput( DEBUG_LEVEL_VERBOSE, " Node %d has GUID 0x%016"PRIX64"\n", node, guid );
+        m_guidToNode[guid] = node;
+    }
+    delete[] reads;
+    delete completed;
+
+    // a bus reset during the scan makes the result useless
+    if ( getGeneration() != generation ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Bus reset during the scan, discarding the result\n" );
+        m_guidToNode.clear();
+        return false;
+    }
+    m_topology_valid = true;
+    m_topology_complete = complete;
+    debugOutput( DEBUG_LEVEL_VERBOSE,
+                 "Scanned %d nodes for generation %u in %"PRIu64" usecs (%s)\n",
+                 nb_nodes, generation, Util::SystemTimeSource::getCurrentTimeAsUsecs() - start,
+                 ( complete ? "complete" : "incomplete" ) );
+    return true;
+}
+
 bool Ieee1394Service::registerARMHandler(ARMHandler *h) {
     debugOutput(DEBUG_LEVEL_VERBOSE,
                 "Registering ARM handler (%p) for 0x%016"PRIX64", length %zu\n",
                 h, h->getStart(), h->getLength());
 
+    if (m_simulated_bus) {
+        debugError("ARM handlers are not supported on a simulated bus\n");
+        return false;
+    }
+
     // FIXME: note that this will result in the ARM handlers not running in a realtime context
     int err = raw1394_arm_register(m_armHelperNormal->get1394Handle(), h->getStart(),
                                    h->getLength(), h->getBuffer(), (octlet_t)h,
@@ -1175,6 +1333,11 @@ nodeaddr_t Ieee1394Service::findFreeARMBlock( nodeaddr_t start, size_t length, s
                 "Finding free ARM block of %zd bytes, from 0x%016"PRIX64" in steps of %zd bytes\n",
                 length, start, step);
 
+    if (m_simulated_bus) {
+        debugError("ARM handlers are not supported on a simulated bus\n");
+        return 0xFFFFFFFFFFFFFFFFLLU;
+    }
+
     int cnt=0;
     const int maxcnt=10;
     int err=1;
@@ -1295,6 +1458,24 @@ Ieee1394Service::remBusResetHandler( Util::Functor* functor )
     return false;
 }
 
+int
+Ieee1394Service::channelModify(unsigned int channel, enum raw1394_modify_mode mode)
+{
+    if (m_simulated_bus) {
+        return m_simulated_bus->modifyChannel(channel, mode == RAW1394_MODIFY_ALLOC) ? 0 : -1;
+    }
+    return raw1394_channel_modify(m_handle, channel, mode);
+}
+
+int
+Ieee1394Service::bandwidthModify(unsigned int bandwidth, enum raw1394_modify_mode mode)
+{
+    if (m_simulated_bus) {
+        return m_simulated_bus->modifyBandwidth(bandwidth, mode == RAW1394_MODIFY_ALLOC) ? 0 : -1;
+    }
+    return raw1394_bandwidth_modify(m_handle, bandwidth, mode);
+}
+
 /**
  * Allocates an iso channel for use by the interface in a similar way to
  * libiec61883.  Returns -1 on error (due to there being no free channels)
@@ -1319,15 +1500,15 @@ signed int Ieee1394Service::allocateIsoChannelGeneric(unsigned int bandwidth) {
 
     int c = -1;
     for (c = 0; c < 63; c++) {
-        if (raw1394_channel_modify (m_handle, c, RAW1394_MODIFY_ALLOC) == 0)
+        if (channelModify(c, RAW1394_MODIFY_ALLOC) == 0)
             break;
     }
     if (c < 63) {
         debugOutput(DEBUG_LEVEL_VERBOSE, "found free iso channel %d\n", c);
-        if (raw1394_bandwidth_modify(m_handle, bandwidth, RAW1394_MODIFY_ALLOC) < 0) {
+        if (bandwidthModify(bandwidth, RAW1394_MODIFY_ALLOC) < 0) {
             debugFatal("Could not allocate bandwidth of %d\n", bandwidth);
 
-            raw1394_channel_modify (m_handle, c, RAW1394_MODIFY_FREE);
+            channelModify(c, RAW1394_MODIFY_FREE);
             return -1;
         } else {
             cinfo.channel=c;
@@ -1342,8 +1523,8 @@ signed int Ieee1394Service::allocateIsoChannelGeneric(unsigned int bandwidth) {
             if (registerIsoChannel(c, cinfo)) {
                 return c;
             } else {
-                raw1394_bandwidth_modify(m_handle, bandwidth, RAW1394_MODIFY_FREE);
-                raw1394_channel_modify (m_handle, c, RAW1394_MODIFY_FREE);
+                bandwidthModify(bandwidth, RAW1394_MODIFY_FREE);
+                channelModify(c, RAW1394_MODIFY_FREE);
                 return -1;
             }
         }
@@ -1376,11 +1557,11 @@ signed int Ieee1394Service::allocateFixedIsoChannelGeneric(
     Util::MutexLockHelper lock(*m_handle_lock);
     struct ChannelInfo cinfo;
 
-    if (raw1394_channel_modify (m_handle, chan, RAW1394_MODIFY_ALLOC) == 0) {
-        if (raw1394_bandwidth_modify(m_handle, bandwidth, RAW1394_MODIFY_ALLOC) < 0) {
+    if (channelModify(chan, RAW1394_MODIFY_ALLOC) == 0) {
+        if (bandwidthModify(bandwidth, RAW1394_MODIFY_ALLOC) < 0) {
             debugFatal("Could not allocate bandwidth of %d\n", bandwidth);
 
-            raw1394_channel_modify (m_handle, chan, RAW1394_MODIFY_FREE);
+            channelModify(chan, RAW1394_MODIFY_FREE);
             return -1;
         } else {
             cinfo.channel=chan;
@@ -1395,8 +1576,8 @@ signed int Ieee1394Service::allocateFixedIsoChannelGeneric(
             if (registerIsoChannel(chan, cinfo)) {
                 return chan;
             } else {
-                raw1394_bandwidth_modify(m_handle, bandwidth, RAW1394_MODIFY_FREE);
-                raw1394_channel_modify (m_handle, chan, RAW1394_MODIFY_FREE);
+                bandwidthModify(bandwidth, RAW1394_MODIFY_FREE);
+                channelModify(chan, RAW1394_MODIFY_FREE);
                 return -1;
             }
         }
@@ -1437,6 +1618,11 @@ signed int Ieee1394Service::allocateIsoChannelCMP(
         return -1;
     }
 
+    if (m_simulated_bus) {
+        debugError("CMP connections are not supported on a simulated bus\n");
+        return -1;
+    }
+
     debugOutput(DEBUG_LEVEL_VERBOSE, "Allocating ISO channel using IEC61883 CMP...\n" );
     Util::MutexLockHelper lock(*m_handle_lock);
 
@@ -1512,11 +1698,11 @@ bool Ieee1394Service::freeIsoChannel(signed int c) {
         case AllocGeneric:
             debugOutput(DEBUG_LEVEL_VERBOSE, " allocated using generic routine...\n" );
             debugOutput(DEBUG_LEVEL_VERBOSE, " freeing %d bandwidth units...\n", m_channels[c].bandwidth );
-            if (raw1394_bandwidth_modify(m_handle, m_channels[c].bandwidth, RAW1394_MODIFY_FREE) !=0) {
+            if (bandwidthModify(m_channels[c].bandwidth, RAW1394_MODIFY_FREE) !=0) {
                 debugWarning("Failed to deallocate bandwidth\n");
             }
             debugOutput(DEBUG_LEVEL_VERBOSE, " freeing channel %d...\n", m_channels[c].channel );
-            if (raw1394_channel_modify (m_handle, m_channels[c].channel, RAW1394_MODIFY_FREE) != 0) {
+            if (channelModify(m_channels[c].channel, RAW1394_MODIFY_FREE) != 0) {
                 debugWarning("Failed to free channel\n");
             }
             if (!unregisterIsoChannel(c))
@@ -1596,6 +1782,9 @@ bool Ieee1394Service::unregisterIsoChannel(unsigned int c) {
  * @return
  */
 signed int Ieee1394Service::getAvailableBandwidth() {
+    if (m_simulated_bus) {
+        return m_simulated_bus->getAvailableBandwidth();
+    }
     quadlet_t buffer;
     Util::MutexLockHelper lock(*m_handle_lock);
     signed int result = raw1394_read (m_handle, raw1394_get_irm_id (m_handle),
@@ -1613,6 +1802,7 @@ Ieee1394Service::setVerboseLevel(int l)
     if (m_pIsoManager) m_pIsoManager->setVerboseLevel(l);
     if (m_pCTRHelper) m_pCTRHelper->setVerboseLevel(l);
     if (m_pWatchdog) m_pWatchdog->setVerboseLevel(l);
+    if (m_pFcpEngine) m_pFcpEngine->setVerboseLevel(l);
     setDebugLevel(l);
     debugOutput( DEBUG_LEVEL_VERBOSE, "Setting verbose level to %d...\n", l );
 }
@@ -1640,6 +1830,7 @@ Ieee1394Service::show()
                 (unsigned int)TICKS_TO_OFFSET( ctr ) );
     debugOutputShort( DEBUG_LEVEL_NORMAL, "Iso handler info:\n");
     #endif
+    if (m_pFcpEngine) m_pFcpEngine->show();
     if (m_pIsoManager) m_pIsoManager->dumpInfo();
 }
 
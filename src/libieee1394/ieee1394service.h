@@ -33,20 +33,20 @@
 #include "debugmodule/debugmodule.h"
 
 #include "IEC61883.h"
+#include "FcpEngine.h"
 
 #include <libraw1394/raw1394.h>
 #include <pthread.h>
 
 #include <vector>
+#include <map>
 #include <string>
 #include <stdint.h>
 
 
-#define MAX_FCP_BLOCK_SIZE_BYTES (512)
-#define MAX_FCP_BLOCK_SIZE_QUADS (MAX_FCP_BLOCK_SIZE_BYTES / 4)
-
 class IsoHandlerManager;
 class CycleTimerHelper;
+class SimulatedBus;
 
 namespace Util {
     class Watchdog;
@@ -63,8 +63,12 @@ public:
     ~Ieee1394Service();
 
     bool initialize( int port );
+    ///> initialize on the simulated bus of a port, whatever the configuration (or ENABLE_SIMULATED_BUS) says
+    bool initializeSimulated( int port );
     bool setThreadParameters(bool rt, int priority);
     Util::Watchdog *getWatchdog() {return m_pWatchdog;};
+    ///> the simulated bus of the port, NULL when running on hardware
+    SimulatedBus *getSimulatedBus() {return m_simulated_bus;};
 
    /**
     * @brief get number of ports (firewire adapters) in this machine
@@ -243,11 +247,16 @@ public:
 
     /**
      * initiate AV/C transaction
-     * @param nodeId 
-     * @param buf 
-     * @param len 
-     * @param resp_len 
-     * @return 
+     *
+     * Runs through the FcpEngine, but one of these transactions at a
+     * time, since the response stays valid until transactionBlockClose().
+     * See getFcpEngine() for concurrent transactions.
+     *
+     * @param nodeId the target node
+     * @param buf the request
+     * @param len the request length in quadlets
+     * @param resp_len receives the response length in quadlets
+     * @return the response, or NULL if the transaction failed
      */
     fb_quadlet_t* transactionBlock( fb_nodeid_t nodeId,
                                     fb_quadlet_t* buf,
@@ -256,14 +265,14 @@ public:
 
     /**
      * close AV/C transaction.
-     * @param nodeId 
-     * @param buf 
-     * @param len 
-     * @param resp_len 
-     * @return 
+     * releases the response of transactionBlock(), has to be called
+     * unless transactionBlock() failed on an invalid node
+     * @return true
      */
     bool transactionBlockClose();
 
+    FcpEngine& getFcpEngine() {return *m_pFcpEngine;};
+
     int getVerboseLevel();
 
     bool addBusResetHandler( Util::Functor* functor );
@@ -295,20 +304,36 @@ public:
      *
      * @return the current generation
      **/
-    unsigned int getGeneration() {
-        Util::MutexLockHelper lock(*m_handle_lock);
-        return raw1394_get_generation( m_handle );
-    }
+    unsigned int getGeneration();
 
     /**
      * @brief update the current generation
      *
      * @return the current generation
      **/
-    void updateGeneration() {
-        Util::MutexLockHelper lock(*m_handle_lock);
-        raw1394_update_generation( m_handle, getGeneration());
-    }
+    void updateGeneration();
+
+    /**
+     * @brief find the node a device is on
+     *
+     * The GUID's of all nodes are read once per bus generation and
+     * cached, such that looking up all devices after a bus reset only
+     * costs one scan of the bus.
+     *
+     * @param guid the GUID of the device
+     * @param nodeId set to the node id (without the bus id) of the device
+     * @return false if no node with this GUID is on the bus
+     **/
+    bool getNodeIdForGuid( fb_octlet_t guid, fb_nodeid_t& nodeId );
+
+    /**
+     * @brief find the GUID of a node, through the same cache
+     *
+     * @param nodeId the node id (without the bus id)
+     * @param guid set to the GUID of the node
+     * @return false if the GUID of the node could not be read
+     **/
+    bool getGuidForNodeId( fb_nodeid_t nodeId, fb_octlet_t& guid );
 
     /**
      * @brief sets the SPLIT_TIMEOUT_HI and SPLIT_TIMEOUT_LO CSR registers
@@ -434,6 +459,10 @@ private:
 private: // unsorted
     bool configurationUpdated();
 
+    // the iso resource allocation of the bus (raw1394 or simulated)
+    int channelModify( unsigned int channel, enum raw1394_modify_mode mode );
+    int bandwidthModify( unsigned int bandwidth, enum raw1394_modify_mode mode );
+
     void printBuffer( unsigned int level, size_t length, fb_quadlet_t* buffer ) const;
     void printBufferBytes( unsigned int level, size_t length, byte_t* buffer ) const;
 
@@ -453,6 +482,7 @@ private: // unsorted
     raw1394handle_t m_util_handle;
     int             m_port;
     std::string     m_portName;
+    SimulatedBus*   m_simulated_bus;
 
     bool            m_realtime;
     int             m_base_priority;
@@ -463,6 +493,10 @@ private: // unsorted
     bool                    m_have_read_ctr_and_clock;
 
     bool            m_filterFCPResponse;
+    FcpEngine*      m_pFcpEngine;
+    // transactionBlock() holds the lock until transactionBlockClose()
+    Util::Mutex*    m_fcp_block_lock;
+    FcpTransaction  m_fcp_block;
 
     // the RT watchdog
     Util::Watchdog*     m_pWatchdog;
@@ -476,6 +510,16 @@ private: // unsorted
     typedef std::vector< ARMHandler * > arm_handler_vec_t;
     arm_handler_vec_t m_armHandlers;
 
+    // the GUID to node id map of the current bus generation
+    bool updateTopologyCache( unsigned int generation );
+    typedef std::map< fb_octlet_t, fb_nodeid_t > guid_node_map_t;
+    guid_node_map_t m_guidToNode;
+    unsigned int    m_topology_generation;
+    bool            m_topology_valid;
+    // false if not all nodes could be read
+    bool            m_topology_complete;
+    Util::Mutex*    m_topology_lock;
+
     // unprotected variants
     bool writeNoLock( fb_nodeid_t nodeId,
         fb_nodeaddr_t addr,
@@ -486,34 +530,6 @@ private: // unsorted
            size_t length,
            fb_quadlet_t* buffer );
 
-    // FCP transaction support
-    static int _avc_fcp_handler(raw1394handle_t handle, nodeid_t nodeid, 
-                                int response, size_t length,
-                                unsigned char *data);
-    int handleFcpResponse(nodeid_t nodeid,
-                          int response, size_t length,
-                          unsigned char *data);
-
-    enum eFcpStatus {
-        eFS_Empty,
-        eFS_Waiting,
-        eFS_Responded,
-        eFS_Error,
-    };
-
-    struct sFcpBlock {
-        enum eFcpStatus status;
-        nodeid_t target_nodeid;
-        unsigned int request_length;
-        quadlet_t request[MAX_FCP_BLOCK_SIZE_QUADS];
-        unsigned int response_length;
-        quadlet_t response[MAX_FCP_BLOCK_SIZE_QUADS];
-    };
-    struct sFcpBlock m_fcp_block;
-
-    bool doFcpTransaction();
-    bool doFcpTransactionTry();
-
 public:
     void setVerboseLevel(int l);
     void show();
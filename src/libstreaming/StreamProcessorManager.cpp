@@ -27,6 +27,7 @@
 #include "generic/StreamProcessor.h"
 #include "generic/Port.h"
 #include "libieee1394/cycletimer.h"
+#include "libieee1394/IsoHandlerManager.h"
 
 #include "devicemanager.h"
 
@@ -34,6 +35,11 @@
 
 #include <errno.h>
 #include <assert.h>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <time.h>
+#include <sys/eventfd.h>
 #include <math.h>
 
 namespace Streaming {
@@ -50,14 +56,29 @@ StreamProcessorManager::StreamProcessorManager(DeviceManager &p)
     , m_parent( p )
     , m_xrun_happened( false )
     , m_activity_wait_timeout_nsec( 0 ) // dynamically set
+    , m_period_event_fd( -1 )
+    , m_period_ready_time( 0 )
+    , m_period_signals( 0 )
+    , m_period_waits( 0 )
+    , m_period_wake_count( 0 )
+    , m_period_wake_latency_sum( 0 )
+    , m_period_wake_latency_max( 0 )
+    , m_transfer_pool( NULL )
+    , m_transfer_nsecs_last( 0 )
+    , m_transfer_nsecs_max( 0 )
+    , m_transfer_nsecs_sum( 0 )
+    , m_transfer_count( 0 )
     , m_nb_buffers( 0 )
     , m_period( 0 )
     , m_sync_delay( 0 )
     , m_audio_datatype( eADT_Float )
+    , m_simd_level( Util::CpuFeatures::getSupportedSimdLevel() )
     , m_nominal_framerate ( 0 )
     , m_xruns(0)
     , m_shutdown_needed(false)
     , m_nbperiods(0)
+    , m_flight_recorder( new Util::FlightRecorder() )
+    , m_flight_channel( NULL )
     , m_WaitLock( new Util::PosixMutex("SPMWAIT") )
     , m_max_diff_ticks( 50 ) 
 {
@@ -76,14 +97,29 @@ StreamProcessorManager::StreamProcessorManager(DeviceManager &p, unsigned int pe
     , m_parent( p )
     , m_xrun_happened( false )
     , m_activity_wait_timeout_nsec( 0 ) // dynamically set
+    , m_period_event_fd( -1 )
+    , m_period_ready_time( 0 )
+    , m_period_signals( 0 )
+    , m_period_waits( 0 )
+    , m_period_wake_count( 0 )
+    , m_period_wake_latency_sum( 0 )
+    , m_period_wake_latency_max( 0 )
+    , m_transfer_pool( NULL )
+    , m_transfer_nsecs_last( 0 )
+    , m_transfer_nsecs_max( 0 )
+    , m_transfer_nsecs_sum( 0 )
+    , m_transfer_count( 0 )
     , m_nb_buffers(nb_buffers)
     , m_period(period)
     , m_sync_delay( 0 )
     , m_audio_datatype( eADT_Float )
+    , m_simd_level( Util::CpuFeatures::getSupportedSimdLevel() )
     , m_nominal_framerate ( framerate )
     , m_xruns(0)
     , m_shutdown_needed(false)
     , m_nbperiods(0)
+    , m_flight_recorder( new Util::FlightRecorder() )
+    , m_flight_channel( NULL )
     , m_WaitLock( new Util::PosixMutex("SPMWAIT") )
     , m_max_diff_ticks( 50 )
 {
@@ -94,6 +130,31 @@ StreamProcessorManager::StreamProcessorManager(DeviceManager &p, unsigned int pe
 StreamProcessorManager::~StreamProcessorManager() {
     sem_post(&m_activity_semaphore);
     sem_destroy(&m_activity_semaphore);
+    if (m_period_event_fd >= 0) {
+        close(m_period_event_fd);
+    }
+    delete m_transfer_pool;
+    for ( unsigned int i = 0; i < m_transfer_jobs.size(); i++ ) {
+        delete m_transfer_jobs.at(i);
+    }
+    Util::StatsRegistry *r = Util::StatsRegistry::instance();
+    r->unregisterStat(m_stat_periods);
+    r->unregisterStat(m_stat_xruns);
+    r->unregisterStat(m_stat_wake_latency);
+    r->unregisterStat(m_stat_transfer_nsecs);
+
+    // the remaining SP's lose their flight recorder channels
+    for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
+          it != m_ReceiveProcessors.end();
+          ++it ) {
+        (*it)->setFlightRecorderChannel(NULL);
+    }
+    for ( StreamProcessorVectorIterator it = m_TransmitProcessors.begin();
+          it != m_TransmitProcessors.end();
+          ++it ) {
+        (*it)->setFlightRecorderChannel(NULL);
+    }
+    delete m_flight_recorder;
     delete m_WaitLock;
 }
 
@@ -216,6 +277,97 @@ StreamProcessorManager::waitForActivity()
     return eAR_Activity;
 }
 
+/**
+ * @brief check whether all streams are ready for a period
+ * @return true if all streams are ready, or if a stream is in xrun or
+ *         error, since that should end the wait too
+ */
+bool
+StreamProcessorManager::periodReady()
+{
+    for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
+        it != m_ReceiveProcessors.end();
+        ++it ) {
+        if (!(*it)->canConsumePeriod() && !(*it)->inError()) return false;
+    }
+    for ( StreamProcessorVectorIterator it = m_TransmitProcessors.begin();
+        it != m_TransmitProcessors.end();
+        ++it ) {
+        if (!(*it)->canProducePeriod() && !(*it)->inError()) return false;
+    }
+    return true;
+}
+
+/**
+ * Called from the ISO threads when a stream becomes ready for a
+ * period. Wakes up the client thread when it was the last one.
+ * @return true if the client was signaled
+ */
+bool
+StreamProcessorManager::signalPeriodReady()
+{
+    if (m_period_event_fd < 0) return false;
+    if (!periodReady()) return false;
+
+    m_period_ready_time = Util::SystemTimeSource::getCurrentTime();
+    uint64_t one = 1;
+    if (write(m_period_event_fd, &one, sizeof(one)) < 0) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Could not signal period: %s\n", strerror(errno));
+    }
+    m_period_signals++;
+    debugOutputExtreme(DEBUG_LEVEL_VERBOSE, "%p period ready\n", this);
+    return true;
+}
+
+/**
+ * Blocks the client thread until the ISO threads signal that the period
+ * is ready. Normally this wakes the client exactly once per period.
+ */
+void
+StreamProcessorManager::waitForPeriodSignal()
+{
+    uint64_t count;
+    // drop the signals of the previous period
+    while (read(m_period_event_fd, &count, sizeof(count)) > 0) {};
+
+    bool waited = false;
+    while (!periodReady() && !m_shutdown_needed) {
+        struct pollfd pfd;
+        pfd.fd = m_period_event_fd;
+        pfd.events = POLLIN;
+        pfd.revents = 0;
+        int result = poll(&pfd, 1, STREAMPROCESSORMANAGER_PERIOD_SIGNAL_TIMEOUT_MSEC);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            debugError("poll error: %s\n", strerror(errno));
+            return;
+        } else if (result == 0) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "No period signal within %d ms\n",
+                        STREAMPROCESSORMANAGER_PERIOD_SIGNAL_TIMEOUT_MSEC);
+            continue;
+        }
+        while (read(m_period_event_fd, &count, sizeof(count)) > 0) {};
+        m_period_waits++;
+        waited = true;
+    }
+
+    if (waited) {
+        int64_t latency = Util::SystemTimeSource::getCurrentTime() - m_period_ready_time;
+        if (latency >= 0) {
+            m_stat_wake_latency.record(latency);
+            if (m_flight_channel) {
+                m_flight_channel->record(Util::FlightRecorder::eET_PeriodWake, 0, -1, 0, 0,
+                                         latency, m_nbperiods);
+            }
+            m_period_wake_latency_sum += latency;
+            m_period_wake_count++;
+            if (latency > m_period_wake_latency_max) {
+                m_period_wake_latency_max = latency;
+            }
+        }
+    }
+}
+
 /**
  * Registers \ref processor with this manager.
  *
@@ -234,19 +386,23 @@ bool StreamProcessorManager::registerProcessor(StreamProcessor *processor)
     if (processor->getType() == StreamProcessor::ePT_Receive) {
         processor->setVerboseLevel(getDebugLevel()); // inherit debug level
         m_ReceiveProcessors.push_back(processor);
+        processor->registerStats(m_ReceiveProcessors.size() - 1);
         Util::Functor* f = new Util::MemberFunctor0< StreamProcessorManager*, void (StreamProcessorManager::*)() >
                     ( this, &StreamProcessorManager::updateShadowLists, false );
         processor->addPortManagerUpdateHandler(f);
         updateShadowLists();
+        updateTransferJobs();
         return true;
     }
     if (processor->getType() == StreamProcessor::ePT_Transmit) {
         processor->setVerboseLevel(getDebugLevel()); // inherit debug level
         m_TransmitProcessors.push_back(processor);
+        processor->registerStats(m_TransmitProcessors.size() - 1);
         Util::Functor* f = new Util::MemberFunctor0< StreamProcessorManager*, void (StreamProcessorManager::*)() >
                     ( this, &StreamProcessorManager::updateShadowLists, false );
         processor->addPortManagerUpdateHandler(f);
         updateShadowLists();
+        updateTransferJobs();
         return true;
     }
 
@@ -259,6 +415,12 @@ bool StreamProcessorManager::unregisterProcessor(StreamProcessor *processor)
     debugOutput( DEBUG_LEVEL_VERBOSE, "Unregistering processor (%p)\n",processor);
     assert(processor);
 
+    Util::FlightRecorder::Channel *c = processor->getFlightRecorderChannel();
+    if (c) {
+        processor->setFlightRecorderChannel(NULL);
+        m_flight_recorder->removeChannel(c);
+    }
+
     if (processor->getType()==StreamProcessor::ePT_Receive) {
 
         for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
@@ -278,6 +440,7 @@ bool StreamProcessorManager::unregisterProcessor(StreamProcessor *processor)
                     delete f;
                 }
                 updateShadowLists();
+                updateTransferJobs();
                 return true;
             }
         }
@@ -301,6 +464,7 @@ bool StreamProcessorManager::unregisterProcessor(StreamProcessor *processor)
                     delete f;
                 }
                 updateShadowLists();
+                updateTransferJobs();
                 return true;
             }
         }
@@ -414,6 +578,77 @@ bool StreamProcessorManager::prepare() {
 
     m_shutdown_needed=false;
 
+    if (!m_stat_periods.isRegistered()) {
+        Util::StatsRegistry *r = Util::StatsRegistry::instance();
+        m_stat_periods = r->registerStat("spm/periods", Util::StatsRegistry::eT_Counter);
+        m_stat_xruns = r->registerStat("spm/xruns", Util::StatsRegistry::eT_Counter);
+        // from the period becoming ready to the client thread running
+        m_stat_wake_latency = r->registerStat("spm/period_wake_latency",
+                                              Util::StatsRegistry::eT_Histogram, "usec");
+        m_stat_transfer_nsecs = r->registerStat("spm/transfer_time",
+                                                Util::StatsRegistry::eT_Histogram, "nsec");
+    }
+
+    // select the sample conversion kernels, before the SP's are prepared
+    std::string simd_level_str = "auto";
+    m_parent.getConfiguration().getValueForSetting("streaming.common.simd_level", simd_level_str);
+    enum Util::CpuFeatures::eSimdLevel simd_level;
+    if(!Util::CpuFeatures::parseSimdLevel(simd_level_str, simd_level)) {
+        debugWarning("Unknown SIMD level '%s', using auto detection\n", simd_level_str.c_str());
+        simd_level = Util::CpuFeatures::getSupportedSimdLevel();
+    }
+    m_simd_level = Util::CpuFeatures::selectSimdLevel(simd_level);
+    debugOutput( DEBUG_LEVEL_VERBOSE, "SIMD level: %s (requested: %s, supported: %s)\n",
+                 Util::CpuFeatures::simdLevelToString(m_simd_level),
+                 simd_level_str.c_str(),
+                 Util::CpuFeatures::simdLevelToString(Util::CpuFeatures::getSupportedSimdLevel()));
+
+    int event_driven_period_signal = STREAMPROCESSORMANAGER_EVENT_DRIVEN_PERIOD_SIGNAL;
+    m_parent.getConfiguration().getValueForSetting("streaming.spm.event_driven_period_signal",
+                                                   event_driven_period_signal);
+    if(event_driven_period_signal && m_period_event_fd < 0) {
+        m_period_event_fd = eventfd(0, EFD_NONBLOCK);
+        if(m_period_event_fd < 0) {
+            debugWarning("Could not create period eventfd (%s), using predictive period signaling\n",
+                         strerror(errno));
+        }
+    } else if(!event_driven_period_signal && m_period_event_fd >= 0) {
+        close(m_period_event_fd);
+        m_period_event_fd = -1;
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "Period signaling: %s\n",
+                 (m_period_event_fd >= 0 ? "event driven" : "predictive"));
+
+    // the SP's can be transferred in parallel by a pool of workers
+    int transfer_threads = STREAMPROCESSORMANAGER_TRANSFER_THREADS;
+    std::string transfer_cpus_str = STREAMPROCESSORMANAGER_TRANSFER_CPUS;
+    m_parent.getConfiguration().getValueForSetting("streaming.spm.transfer_threads", transfer_threads);
+    m_parent.getConfiguration().getValueForSetting("streaming.spm.transfer_cpus", transfer_cpus_str);
+    delete m_transfer_pool;
+    m_transfer_pool = NULL;
+    if (transfer_threads > 0) {
+        std::vector<int> transfer_cpus;
+        if (!Util::WorkerPool::parseCpuList(transfer_cpus_str, transfer_cpus)) {
+            debugWarning("Could not parse transfer CPU list '%s', not pinning the transfer threads\n",
+                         transfer_cpus_str.c_str());
+            transfer_cpus.clear();
+        }
+        m_transfer_pool = new Util::WorkerPool("XFER", transfer_threads,
+                                               m_thread_realtime, m_thread_priority);
+        m_transfer_pool->setVerboseLevel(getDebugLevel());
+        m_transfer_pool->setCpuAffinity(transfer_cpus);
+        if (!m_transfer_pool->start()) {
+            debugWarning("Could not start the transfer threads, transferring from the client thread\n");
+            delete m_transfer_pool;
+            m_transfer_pool = NULL;
+        }
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "Transfer threads: %u (CPU's: '%s')\n",
+                 (m_transfer_pool ? m_transfer_pool->getNbWorkers() : 0),
+                 transfer_cpus_str.c_str());
+
+    setupFlightRecorder();
+
     // if no sync source is set, select one here
     if(m_SyncSource == NULL) {
        debugWarning("Sync Source is not set. Defaulting to first StreamProcessor.\n");
@@ -1148,6 +1383,50 @@ bool StreamProcessorManager::stop() {
     return true;
 }
 
+/**
+ * @brief Start the xrun flight recorder if it is configured
+ *
+ * Gives every SP that doesn't have one yet a channel.
+ */
+void StreamProcessorManager::setupFlightRecorder() {
+    std::string dir = STREAMPROCESSORMANAGER_FLIGHT_RECORDER_DIR;
+    int nb_events = STREAMPROCESSORMANAGER_FLIGHT_RECORDER_EVENTS;
+    m_parent.getConfiguration().getValueForSetting("streaming.spm.flight_recorder_dir", dir);
+    m_parent.getConfiguration().getValueForSetting("streaming.spm.flight_recorder_events", nb_events);
+    if (dir.empty() || nb_events <= 0) {
+        return;
+    }
+    m_flight_recorder->setVerboseLevel(getDebugLevel());
+    if (!m_flight_recorder->start(dir, STREAMPROCESSORMANAGER_FLIGHT_RECORDER_MAX_DUMPS)) {
+        return;
+    }
+    if (m_flight_channel == NULL) {
+        m_flight_channel = m_flight_recorder->addChannel("manager", nb_events);
+    }
+
+    char name[FLIGHT_RECORDER_NAME_LEN];
+    unsigned int idx = 0;
+    for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
+          it != m_ReceiveProcessors.end();
+          ++it, idx++ ) {
+        if ((*it)->getFlightRecorderChannel() == NULL) {
+            snprintf(name, sizeof(name), "%016"PRIX64"/receive%u",
+                     (*it)->getParent().getConfigRom().getGuid(), idx);
+            (*it)->setFlightRecorderChannel(m_flight_recorder->addChannel(name, nb_events));
+        }
+    }
+    idx = 0;
+    for ( StreamProcessorVectorIterator it = m_TransmitProcessors.begin();
+          it != m_TransmitProcessors.end();
+          ++it, idx++ ) {
+        if ((*it)->getFlightRecorderChannel() == NULL) {
+            snprintf(name, sizeof(name), "%016"PRIX64"/transmit%u",
+                     (*it)->getParent().getConfigRom().getGuid(), idx);
+            (*it)->setFlightRecorderChannel(m_flight_recorder->addChannel(name, nb_events));
+        }
+    }
+}
+
 /**
  * Called upon Xrun events. This brings all StreamProcessors back
  * into their starting state, and then carries on streaming. This should
@@ -1159,6 +1438,11 @@ bool StreamProcessorManager::handleXrun() {
 
     debugOutput( DEBUG_LEVEL_VERBOSE, "Handling Xrun ...\n");
 
+    // keep the history that led to the xrun before the restart wipes it
+    char reason[FLIGHT_RECORDER_REASON_LEN];
+    snprintf(reason, sizeof(reason), "xrun in period %u", m_nbperiods);
+    m_flight_recorder->trigger(reason);
+
     dumpInfo();
 
     /*
@@ -1233,8 +1517,13 @@ bool StreamProcessorManager::waitForPeriod() {
     debugOutputExtreme(DEBUG_LEVEL_VERBOSE, "PREWAIT  pred: %"PRId64", now: %"PRId64", wait: %"PRId64"\n", pred_system_time_at_xfer, now, pred_system_time_at_xfer-now );
     #endif
 
-    // wait until it's time to transfer
-    Util::SystemTimeSource::SleepUsecAbsolute(pred_system_time_at_xfer);
+    if (m_period_event_fd >= 0) {
+        // the ISO threads tell us when all streams are ready
+        waitForPeriodSignal();
+    } else {
+        // wait until it's time to transfer
+        Util::SystemTimeSource::SleepUsecAbsolute(pred_system_time_at_xfer);
+    }
 
     #if DEBUG_EXTREME_ENABLE
     now = Util::SystemTimeSource::getCurrentTime();
@@ -1296,7 +1585,11 @@ bool StreamProcessorManager::waitForPeriod() {
 
         if (period_not_ready) {
             debugOutput(DEBUG_LEVEL_VERBOSE, " wait extended since period not ready...\n");
-            Util::SystemTimeSource::SleepUsecRelative(125); // one cycle
+            if (m_period_event_fd >= 0) {
+                waitForPeriodSignal();
+            } else {
+                Util::SystemTimeSource::SleepUsecRelative(125); // one cycle
+            }
         }
 
         // check for underruns/errors on the ISO side,
@@ -1346,6 +1639,12 @@ bool StreamProcessorManager::waitForPeriod() {
 
     if(xrun_occurred) {
         debugOutput( DEBUG_LEVEL_VERBOSE, "exit due to xrun...\n");
+        m_xruns++;
+        m_stat_xruns.add();
+        if (m_flight_channel) {
+            m_flight_channel->record(Util::FlightRecorder::eET_XrunDetected, 0, -1, 0, 0,
+                                     0, m_nbperiods);
+        }
     }
     if(in_error) {
         debugOutput( DEBUG_LEVEL_VERBOSE, "exit due to error...\n");
@@ -1427,6 +1726,7 @@ bool StreamProcessorManager::waitForPeriod() {
     }
     #endif
     m_nbperiods++;
+    m_stat_periods.add();
 
     // this is to notify the client of the delay that we introduced by waiting
     pred_system_time_at_xfer = m_SyncSource->getParent().get1394Service().getSystemTimeForCycleTimerTicks(m_time_of_transfer);
@@ -1449,10 +1749,8 @@ bool StreamProcessorManager::waitForPeriod() {
  */
 bool StreamProcessorManager::transfer() {
     debugOutputExtreme( DEBUG_LEVEL_VERY_VERBOSE, "Transferring period...\n");
-    bool retval=true;
-    retval &= transfer(StreamProcessor::ePT_Receive);
-    retval &= transfer(StreamProcessor::ePT_Transmit);
-    return retval;
+    if(m_SyncSource == NULL) return false;
+    return transferJobs(0, m_transfer_jobs.size());
 }
 
 /**
@@ -1472,41 +1770,104 @@ bool StreamProcessorManager::transfer(enum StreamProcessor::eProcessorType t) {
         (unsigned int)TICKS_TO_CYCLES(m_time_of_transfer),
         (unsigned int)TICKS_TO_OFFSET(m_time_of_transfer));
 
-    bool retval = true;
-    // a static cast could make sure that there is no performance
-    // penalty for the virtual functions (to be checked)
     if (t==StreamProcessor::ePT_Receive) {
-        for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
-                it != m_ReceiveProcessors.end();
-                ++it ) {
-            if(!(*it)->getFrames(m_period, m_time_of_transfer)) {
-                    debugWarning("could not getFrames(%u, %11"PRIu64") from stream processor (%p)\n",
-                            m_period, m_time_of_transfer,*it);
-                retval &= false; // buffer underrun
-            }
-        }
+        return transferJobs(0, m_ReceiveProcessors.size());
+    } else {
+        return transferJobs(m_ReceiveProcessors.size(), m_TransmitProcessors.size());
+    }
+}
+
+static inline uint64_t
+getTransferNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+void StreamProcessorManager::TransferJob::run() {
+    uint64_t start = getTransferNsecs();
+    if (m_sp.getType() == StreamProcessor::ePT_Receive) {
+        m_timestamp = m_parent.m_time_of_transfer;
+        m_result = m_sp.getFrames(m_parent.m_period, m_timestamp);
     } else {
         // FIXME: in the SPM it would be nice to have system time instead of
         //        1394 time
-        float rate = m_SyncSource->getTicksPerFrame();
+        float rate = m_parent.m_SyncSource->getTicksPerFrame();
+
+        // this is the delay in frames between the point where a frame is received and
+        // when it is transmitted again
+        unsigned int one_ringbuffer_in_frames = m_parent.m_nb_buffers * m_parent.m_period
+                                                + m_sp.getExtraBufferFrames();
+        int64_t one_ringbuffer_in_ticks = (int64_t)(((float)one_ringbuffer_in_frames) * rate);
+
+        // the data we are putting into the buffer is intended to be transmitted
+        // one ringbuffer size after it has been received
+        m_timestamp = addTicks(m_parent.m_time_of_transfer, one_ringbuffer_in_ticks);
+        m_result = m_sp.putFrames(m_parent.m_period, m_timestamp);
+    }
+    m_sp.clearPeriodReadiness();
+    m_sp.addTransferTime(getTransferNsecs() - start);
+    m_sp.updateStats();
+}
 
-        for ( StreamProcessorVectorIterator it = m_TransmitProcessors.begin();
-                it != m_TransmitProcessors.end();
-                ++it ) {
-            // this is the delay in frames between the point where a frame is received and
-            // when it is transmitted again
-            unsigned int one_ringbuffer_in_frames = m_nb_buffers * m_period + (*it)->getExtraBufferFrames();
-            int64_t one_ringbuffer_in_ticks = (int64_t)(((float)one_ringbuffer_in_frames) * rate);
-    
-            // the data we are putting into the buffer is intended to be transmitted
-            // one ringbuffer size after it has been received
-            int64_t transmit_timestamp = addTicks(m_time_of_transfer, one_ringbuffer_in_ticks);
+/**
+ * @brief Rebuild the transfer jobs after the SP lists changed
+ */
+void StreamProcessorManager::updateTransferJobs() {
+    for ( unsigned int i = 0; i < m_transfer_jobs.size(); i++ ) {
+        delete m_transfer_jobs.at(i);
+    }
+    m_transfer_jobs.clear();
+    for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
+            it != m_ReceiveProcessors.end();
+            ++it ) {
+        m_transfer_jobs.push_back(new TransferJob(*this, **it));
+    }
+    for ( StreamProcessorVectorIterator it = m_TransmitProcessors.begin();
+            it != m_TransmitProcessors.end();
+            ++it ) {
+        m_transfer_jobs.push_back(new TransferJob(*this, **it));
+    }
+}
 
-            if(!(*it)->putFrames(m_period, transmit_timestamp)) {
-                debugWarning("could not putFrames(%u,%"PRIu64") to stream processor (%p)\n",
-                        m_period, transmit_timestamp, *it);
-                retval &= false; // buffer underrun
-            }
+/**
+ * @brief Run a range of transfer jobs
+ *
+ * Runs the jobs on the transfer threads if there are any, or one by one
+ * on the calling thread otherwise. Returns when all of them are done.
+ *
+ * @return true if successful, false otherwise (indicates xrun).
+ */
+bool StreamProcessorManager::transferJobs(unsigned int first, unsigned int nb_jobs) {
+    if (nb_jobs == 0) return true;
+    uint64_t start = getTransferNsecs();
+
+    if (m_transfer_pool) {
+        m_transfer_pool->execute(&m_transfer_jobs.at(first), nb_jobs);
+    } else {
+        for ( unsigned int i = first; i < first + nb_jobs; i++ ) {
+            m_transfer_jobs.at(i)->run();
+        }
+    }
+
+    uint64_t elapsed = getTransferNsecs() - start;
+    m_transfer_nsecs_last = elapsed;
+    m_transfer_nsecs_sum += elapsed;
+    if (elapsed > m_transfer_nsecs_max) m_transfer_nsecs_max = elapsed;
+    m_transfer_count++;
+    m_stat_transfer_nsecs.record(elapsed);
+
+    bool retval = true;
+    for ( unsigned int i = first; i < first + nb_jobs; i++ ) {
+        TransferJob *job = static_cast<TransferJob *>(m_transfer_jobs.at(i));
+        if (!job->m_result) {
+            debugWarning("could not %s(%u, %11"PRId64") %s stream processor (%p)\n",
+                         (job->m_sp.getType() == StreamProcessor::ePT_Receive ? "getFrames" : "putFrames"),
+                         m_period, job->m_timestamp,
+                         (job->m_sp.getType() == StreamProcessor::ePT_Receive ? "from" : "to"),
+                         &job->m_sp);
+            retval &= false; // buffer underrun
         }
     }
     return retval;
@@ -1562,6 +1923,7 @@ bool StreamProcessorManager::transferSilence(enum StreamProcessor::eProcessorTyp
                             m_period, m_time_of_transfer,*it);
                 retval &= false; // buffer underrun
             }
+            (*it)->clearPeriodReadiness();
         }
     } else {
         // FIXME: in the SPM it would be nice to have system time instead of
@@ -1585,6 +1947,7 @@ bool StreamProcessorManager::transferSilence(enum StreamProcessor::eProcessorTyp
                         m_period, transmit_timestamp, *it);
                 retval &= false; // buffer underrun
             }
+            (*it)->clearPeriodReadiness();
         }
     }
     return retval;
@@ -1594,7 +1957,40 @@ void StreamProcessorManager::dumpInfo() {
     debugOutputShort( DEBUG_LEVEL_NORMAL, "----------------------------------------------------\n");
     debugOutputShort( DEBUG_LEVEL_NORMAL, "Dumping StreamProcessorManager information...\n");
     debugOutputShort( DEBUG_LEVEL_NORMAL, "Period count: %6d\n", m_nbperiods);
+    #ifdef DEBUG_MESSAGES
+    if (m_SyncSource) {
+        unsigned int wakeups = m_SyncSource->getParent().get1394Service().getIsoHandlerManager().getWakeupCount();
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "ISO thread wakeups: %u (%.2f per period)\n",
+                          wakeups, (m_nbperiods ? (float)wakeups / m_nbperiods : 0.0));
+    }
+    #endif
+    if (m_period_event_fd >= 0) {
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "Period signals: %u, client wakeups: %u (%.2f per period)\n",
+                          m_period_signals, m_period_waits,
+                          (m_nbperiods ? (float)m_period_waits / m_nbperiods : 0.0));
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "Signal to wakeup latency: avg %.1f us, max %"PRId64" us\n",
+                          getPeriodWakeLatencyAvgUsecs(), getPeriodWakeLatencyMaxUsecs());
+    }
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "Transfer threads: %u\n",
+                      (m_transfer_pool ? m_transfer_pool->getNbWorkers() : 0));
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "Transfer time: last %"PRIu64" ns, avg %.0f ns, max %"PRIu64" ns\n",
+                      m_transfer_nsecs_last, getTransferTimeAvgNsecs(), m_transfer_nsecs_max);
+    // the SP that takes longest bounds the transfer time, even with
+    // enough threads to transfer all of them in parallel
+    StreamProcessor *slowest = NULL;
+    for ( unsigned int i = 0; i < m_transfer_jobs.size(); i++ ) {
+        StreamProcessor &sp = static_cast<TransferJob *>(m_transfer_jobs.at(i))->m_sp;
+        if (slowest == NULL || sp.getTransferTimeAvgNsecs() > slowest->getTransferTimeAvgNsecs()) {
+            slowest = &sp;
+        }
+    }
+    if (slowest) {
+        debugOutputShort( DEBUG_LEVEL_NORMAL, "Critical path: %s SP %p, avg %.0f ns, max %"PRIu64" ns\n",
+                          slowest->getTypeString(), slowest,
+                          slowest->getTransferTimeAvgNsecs(), slowest->getTransferTimeMaxNsecs());
+    }
     debugOutputShort( DEBUG_LEVEL_NORMAL, "Data type: %s\n", (m_audio_datatype==eADT_Float?"float":"int24"));
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "SIMD level: %s\n", Util::CpuFeatures::simdLevelToString(m_simd_level));
 
     debugOutputShort( DEBUG_LEVEL_NORMAL, " Receive processors...\n");
     for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
@@ -1653,6 +2049,7 @@ void StreamProcessorManager::dumpInfo() {
 
 void StreamProcessorManager::setVerboseLevel(int l) {
     if(m_WaitLock) m_WaitLock->setVerboseLevel(l);
+    if(m_transfer_pool) m_transfer_pool->setVerboseLevel(l);
 
     for ( StreamProcessorVectorIterator it = m_ReceiveProcessors.begin();
         it != m_ReceiveProcessors.end();
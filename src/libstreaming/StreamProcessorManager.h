@@ -32,6 +32,9 @@
 #include "libutil/Thread.h"
 #include "libutil/Mutex.h"
 #include "libutil/OptionContainer.h"
+#include "libutil/CpuFeatures.h"
+#include "libutil/WorkerPool.h"
+#include "libutil/StatsRegistry.h"
 
 #include <vector>
 #include <semaphore.h>
@@ -80,6 +83,18 @@ public:
     void signalActivity();
     enum eActivityResult waitForActivity();
 
+    // event driven period signaling
+    bool isPeriodSignalEventDriven()
+        {return m_period_event_fd >= 0;};
+    ///> called by the ISO threads when a stream becomes ready for a period,
+    ///> returns true if all streams were ready and the client was woken up
+    bool signalPeriodReady();
+    ///> the average and max latency between the signal and the client wakeup
+    double getPeriodWakeLatencyAvgUsecs()
+        {return m_period_wake_count ? (double)m_period_wake_latency_sum / m_period_wake_count : 0.0;};
+    int64_t getPeriodWakeLatencyMaxUsecs()
+        {return m_period_wake_latency_max;};
+
     // this is the setup API
     bool registerProcessor(StreamProcessor *processor); ///< start managing a streamprocessor
     bool unregisterProcessor(StreamProcessor *processor); ///< stop managing a streamprocessor
@@ -94,6 +109,10 @@ public:
     enum eADT_AudioDataType getAudioDataType()
         {return m_audio_datatype;}
 
+    // the instruction set the sample conversion kernels may use
+    enum Util::CpuFeatures::eSimdLevel getSimdLevel()
+        {return m_simd_level;}
+
     void setNbBuffers(unsigned int nb_buffers)
             {m_nb_buffers = nb_buffers;};
     unsigned int getNbBuffers() 
@@ -123,15 +142,41 @@ public:
 
 private:
     bool transferSilence();
+    bool periodReady();
+    void waitForPeriodSignal();
     bool transferSilence(enum StreamProcessor::eProcessorType);
 
     bool alignReceivedStreams();
+
+    /**
+     * @brief transfers one period to or from one SP
+     * runs on the client thread or on a transfer worker
+     */
+    class TransferJob : public Util::WorkerPool::Job
+    {
+    public:
+        TransferJob(StreamProcessorManager &parent, StreamProcessor &sp)
+            : m_parent( parent ), m_sp( sp ), m_result( true ), m_timestamp( 0 ) {};
+        void run();
+
+        StreamProcessorManager& m_parent;
+        StreamProcessor& m_sp;
+        bool m_result;
+        int64_t m_timestamp;
+    };
+    void updateTransferJobs();
+    bool transferJobs(unsigned int first, unsigned int nb_jobs);
 public:
     int getDelayedUsecs() {return m_delayed_usecs;};
     bool xrunOccurred();
     bool shutdownNeeded() {return m_shutdown_needed;};
     int getXrunCount() {return m_xruns;};
 
+    uint64_t getTransferTimeLastNsecs() {return m_transfer_nsecs_last;};
+    uint64_t getTransferTimeMaxNsecs() {return m_transfer_nsecs_max;};
+    double getTransferTimeAvgNsecs()
+        {return (m_transfer_count ? (double)m_transfer_nsecs_sum / m_transfer_count : 0.0);};
+
     void setNominalRate(unsigned int r) {m_nominal_framerate = r;};
     unsigned int getNominalRate() {return m_nominal_framerate;};
     uint64_t getTimeOfLastTransfer() { return m_time_of_transfer;};
@@ -180,10 +225,29 @@ protected: // FIXME: private?
     // activity signaling
     sem_t m_activity_semaphore;
 
+    // period signaling, written to by the ISO threads when
+    // the period is ready. -1 if not event driven.
+    int m_period_event_fd;
+    volatile int64_t m_period_ready_time;
+    unsigned int m_period_signals;
+    unsigned int m_period_waits;
+    unsigned int m_period_wake_count;
+    int64_t m_period_wake_latency_sum;
+    int64_t m_period_wake_latency_max;
+
     // processor list
     StreamProcessorVector m_ReceiveProcessors;
     StreamProcessorVector m_TransmitProcessors;
 
+    // one transfer job per SP, the receive SP's first
+    std::vector<Util::WorkerPool::Job *> m_transfer_jobs;
+    // NULL if the SP's are transferred from the client thread only
+    Util::WorkerPool *m_transfer_pool;
+    uint64_t m_transfer_nsecs_last;
+    uint64_t m_transfer_nsecs_max;
+    uint64_t m_transfer_nsecs_sum;
+    unsigned int m_transfer_count;
+
     // port shadow lists
     PortVector m_CapturePorts_shadow;
     PortVector m_PlaybackPorts_shadow;
@@ -193,12 +257,24 @@ protected: // FIXME: private?
     unsigned int m_period;
     unsigned int m_sync_delay;
     enum eADT_AudioDataType m_audio_datatype;
+    enum Util::CpuFeatures::eSimdLevel m_simd_level;
     unsigned int m_nominal_framerate;
     unsigned int m_xruns;
     bool m_shutdown_needed;
 
     unsigned int m_nbperiods;
 
+    // published statistics
+    Util::Stat m_stat_periods;
+    Util::Stat m_stat_xruns;
+    Util::Stat m_stat_wake_latency;
+    Util::Stat m_stat_transfer_nsecs;
+
+    // the xrun flight recorder, the manager has a channel of its own
+    Util::FlightRecorder *m_flight_recorder;
+    Util::FlightRecorder::Channel *m_flight_channel;
+    void setupFlightRecorder();
+
     Util::Mutex *m_WaitLock;
 
     signed int m_max_diff_ticks;
@@ -36,7 +36,7 @@
 #include "libutil/SystemTimeSource.h"
 #include <cstring>
 
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
 namespace Streaming {
 
@@ -45,6 +45,8 @@ namespace Streaming {
 AmdtpReceiveStreamProcessor::AmdtpReceiveStreamProcessor(FFADODevice &parent, int dimension)
     : StreamProcessor(parent, ePT_Receive)
     , m_dimension( dimension )
+    , m_decode_audio_float( NULL )
+    , m_decode_audio_int24( NULL )
     , m_nb_audio_ports( 0 )
     , m_nb_midi_ports( 0 )
     , mb_head( 0 )
@@ -74,6 +76,13 @@ bool AmdtpReceiveStreamProcessor::prepareChild() {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Preparing (%p)...\n", this);
     m_syt_interval = getSytInterval();
 
+    // pick the widest conversion kernels this CPU can run
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_decode_audio_float = kernels.decodeAM824Float;
+    m_decode_audio_int24 = kernels.decodeAM824Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
     if (!initPortCache()) {
         debugError("Could not init port cache\n");
         return false;
@@ -267,86 +276,35 @@ bool AmdtpReceiveStreamProcessor::processReadBlock(char *data,
     return true;
 }
 
-//#ifdef __SSE2__
-#if 0 // SSE code is not ready yet
-#include <emmintrin.h>
-#warning SSE2 build
-
 /**
- * @brief demux events to all audio ports (int24)
- * @param data 
- * @param offset 
- * @param nevents 
- */
-void
-AmdtpReceiveStreamProcessor::decodeAudioPortsInt24(quadlet_t *data,
-                                                    unsigned int offset,
-                                                    unsigned int nevents)
-{
-    unsigned int j;
-    quadlet_t *target_event;
-    unsigned int i;
-
-    for (i = 0; i < m_nb_audio_ports; i++) {
-        struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
-#ifdef DEBUG
-        assert(nevents + offset <= p.buffer_size );
-#endif
-
-        if(p.buffer && p.enabled) {
-            quadlet_t *buffer = (quadlet_t *)(p.buffer);
-            buffer += offset;
-
-            for(j = 0; j < nevents; j += 1) {
-                *(buffer)=(CondSwapFromBus32((*target_event) ) & 0x00FFFFFF);
-                buffer++;
-                target_event+=m_dimension;
-            }
-        }
-    }
-}
-
-/**
- * @brief demux events to all audio ports (float)
- * @param data 
+ * @brief collects the buffer pointers for the audio ports
+ *
+ * Ports that are disabled or have no valid buffer are mapped onto
+ * the scratch buffer, such that the samples are discarded.
+ *
  * @param offset 
  * @param nevents 
+ * @param sample_size size of one sample in the port buffers
  */
 void
-AmdtpReceiveStreamProcessor::decodeAudioPortsFloat(quadlet_t *data,
-                                                    unsigned int offset,
-                                                    unsigned int nevents)
+AmdtpReceiveStreamProcessor::updateAudioBufferPointers(unsigned int offset,
+                                                       unsigned int nevents,
+                                                       unsigned int sample_size)
 {
-    unsigned int j;
-    quadlet_t *target_event;
-    unsigned int i;
-    const float multiplier = 1.0f / (float)(0x7FFFFF);
-
-    for (i = 0; i < m_nb_audio_ports; i++) {
+    for (unsigned int i = 0; i < m_nb_audio_ports; i++) {
         struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
 #ifdef DEBUG
         assert(nevents + offset <= p.buffer_size );
 #endif
-
-        if(p.buffer && p.enabled) {
-            float *buffer = (float *)(p.buffer);
-            buffer += offset;
-
-            for(j = 0; j < nevents; j += 1) {
-                unsigned int v = CondSwapFromBus32(*target_event) & 0x00FFFFFF;
-                // sign-extend highest bit of 24-bit int
-                int tmp = (int)(v << 8) / 256;
-                *buffer = tmp * multiplier;
-                buffer++;
-                target_event+=m_dimension;
-            }
+        if(likely(p.buffer && p.enabled)) {
+            m_audio_buffers[i] = (byte_t *)p.buffer + offset * sample_size;
+        } else {
+            assert(m_scratch_buffer_size_bytes >= nevents * sample_size);
+            m_audio_buffers[i] = m_scratch_buffer;
         }
     }
 }
 
-#else
 /**
  * @brief demux events to all audio ports (int24)
  * @param data 
@@ -358,28 +316,10 @@ AmdtpReceiveStreamProcessor::decodeAudioPortsInt24(quadlet_t *data,
                                                     unsigned int offset,
                                                     unsigned int nevents)
 {
-    unsigned int j;
-    quadlet_t *target_event;
-    unsigned int i;
-
-    for (i = 0; i < m_nb_audio_ports; i++) {
-        struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
-#ifdef DEBUG
-        assert(nevents + offset <= p.buffer_size );
-#endif
-
-        if(p.buffer && p.enabled) {
-            quadlet_t *buffer = (quadlet_t *)(p.buffer);
-            buffer += offset;
-
-            for(j = 0; j < nevents; j += 1) {
-                *(buffer)=(CondSwapFromBus32((*target_event) ) & 0x00FFFFFF);
-                buffer++;
-                target_event+=m_dimension;
-            }
-        }
-    }
+    if (m_nb_audio_ports == 0) return;
+    updateAudioBufferPointers(offset, nevents, sizeof(uint32_t));
+    m_decode_audio_int24(data, m_dimension, &m_audio_buffers[0],
+                         m_nb_audio_ports, nevents);
 }
 
 /**
@@ -393,36 +333,12 @@ AmdtpReceiveStreamProcessor::decodeAudioPortsFloat(quadlet_t *data,
                                                     unsigned int offset,
                                                     unsigned int nevents)
 {
-    unsigned int j;
-    quadlet_t *target_event;
-    unsigned int i;
-    const float multiplier = 1.0f / (float)(0x7FFFFF);
-
-    for (i = 0; i < m_nb_audio_ports; i++) {
-        struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
-#ifdef DEBUG
-        assert(nevents + offset <= p.buffer_size );
-#endif
-
-        if(p.buffer && p.enabled) {
-            float *buffer = (float *)(p.buffer);
-            buffer += offset;
-
-            for(j = 0; j < nevents; j += 1) {
-                unsigned int v = CondSwapFromBus32(*target_event) & 0x00FFFFFF;
-                // sign-extend highest bit of 24-bit int
-                int tmp = (int)(v << 8) / 256;
-                *buffer = tmp * multiplier;
-                buffer++;
-                target_event+=m_dimension;
-            }
-        }
-    }
+    if (m_nb_audio_ports == 0) return;
+    updateAudioBufferPointers(offset, nevents, sizeof(float));
+    m_decode_audio_float(data, m_dimension, &m_audio_buffers[0],
+                         m_nb_audio_ports, nevents);
 }
 
-#endif
-
 /**
  * @brief decode all midi ports in the cache from events
  * @param data 
@@ -558,6 +474,7 @@ AmdtpReceiveStreamProcessor::initPortCache() {
 next_index:
         continue;
     }
+    m_audio_buffers.assign(m_nb_audio_ports, (void *)NULL);
 
     for(PortVectorIterator it = m_Ports.begin();
         it != m_Ports.end();
@@ -29,6 +29,7 @@
  */
 
 #include "AmdtpStreamProcessor-common.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -78,6 +79,8 @@ protected:
     bool processReadBlock(char *data, unsigned int nevents, unsigned int offset);
 
 protected:
+    void updateAudioBufferPointers(unsigned int offset, unsigned int nevents,
+                                   unsigned int sample_size);
     void decodeAudioPortsFloat(quadlet_t *data, unsigned int offset, unsigned int nevents);
     void decodeAudioPortsInt24(quadlet_t *data, unsigned int offset, unsigned int nevents);
     void decodeMidiPorts(quadlet_t *data, unsigned int offset, unsigned int nevents);
@@ -87,6 +90,10 @@ protected:
     int m_dimension;
     unsigned int m_syt_interval;
 
+    // the sample conversion kernels, selected at prepare time
+    am824_decode_func_t m_decode_audio_float;
+    am824_decode_func_t m_decode_audio_int24;
+
 private: // local port caching for performance
     struct _MBLA_port_cache {
         AmdtpAudioPort*     port;
@@ -97,6 +104,7 @@ private: // local port caching for performance
 #endif
     };
     std::vector<struct _MBLA_port_cache> m_audio_ports;
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
     unsigned int m_nb_audio_ports;
 
     struct _MIDI_port_cache {
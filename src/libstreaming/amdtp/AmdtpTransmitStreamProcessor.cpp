@@ -36,13 +36,12 @@
 #include "libieee1394/cycletimer.h"
 
 #include "libutil/ByteSwap.h"
+#include "libutil/CpuFeatures.h"
 #include <assert.h>
 #include <cstring>
 
-#define likely(x)   __builtin_expect((x),1)
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
-#define AMDTP_FLOAT_MULTIPLIER (1.0f * ((1<<23) - 1))
 namespace Streaming
 {
 
@@ -57,6 +56,8 @@ AmdtpTransmitStreamProcessor::AmdtpTransmitStreamProcessor(FFADODevice &parent,
         , m_max_cycles_to_transmit_early ( AMDTP_MAX_CYCLES_TO_TRANSMIT_EARLY )
         , m_transmit_transfer_delay ( AMDTP_TRANSMIT_TRANSFER_DELAY )
         , m_min_cycles_before_presentation ( AMDTP_MIN_CYCLES_BEFORE_PRESENTATION )
+        , m_encode_audio_float( NULL )
+        , m_encode_audio_int24( NULL )
         , m_nb_audio_ports( 0 )
         , m_nb_midi_ports( 0 )
 {}
@@ -468,6 +469,13 @@ bool AmdtpTransmitStreamProcessor::prepareChild()
         m_dimension,
         m_syt_interval );
 
+    // pick the widest conversion kernels this CPU can run
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_encode_audio_float = kernels.encodeAM824Float;
+    m_encode_audio_int24 = kernels.encodeAM824Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
     if (!initPortCache()) {
         debugError("Could not init port cache\n");
         return false;
@@ -537,373 +545,40 @@ AmdtpTransmitStreamProcessor::encodeAudioPortsSilence(quadlet_t *data,
     }
 }
 
-#ifdef __SSE2__
-#include <emmintrin.h>
-
-// There's no obvious reason to warn about this anymore - jwoithe.
-// #warning SSE2 build
-
 /**
- * @brief mux all audio ports to events
- * @param data 
+ * @brief collects the buffer pointers for the audio ports
+ *
+ * Ports that are disabled or have no valid buffer are mapped onto
+ * the (zeroed) scratch buffer, such that they encode to silence.
+ *
  * @param offset 
  * @param nevents 
+ * @param sample_size size of one sample in the port buffers
  */
 void
-AmdtpTransmitStreamProcessor::encodeAudioPortsFloat(quadlet_t *data,
-                                                    unsigned int offset,
-                                                    unsigned int nevents)
+AmdtpTransmitStreamProcessor::updateAudioBufferPointers(unsigned int offset,
+                                                        unsigned int nevents,
+                                                        unsigned int sample_size)
 {
-    unsigned int j;
-    quadlet_t *target_event;
-    int i;
-
-    float * client_buffers[4];
-    float tmp_values[4] __attribute__ ((aligned (16)));
-    uint32_t tmp_values_int[4] __attribute__ ((aligned (16)));
-
-    // prepare the scratch buffer
-    assert(m_scratch_buffer_size_bytes > nevents * 4);
-    memset(m_scratch_buffer, 0, nevents * 4);
-
-    const __m128i label = _mm_set_epi32 (0x40000000, 0x40000000, 0x40000000, 0x40000000);
-    const __m128i mask = _mm_set_epi32 (0x00FFFFFF, 0x00FFFFFF, 0x00FFFFFF, 0x00FFFFFF);
-    const __m128 mult = _mm_set_ps(AMDTP_FLOAT_MULTIPLIER, AMDTP_FLOAT_MULTIPLIER, AMDTP_FLOAT_MULTIPLIER, AMDTP_FLOAT_MULTIPLIER);
-
-#if AMDTP_CLIP_FLOATS
-    const __m128 v_max = _mm_set_ps(1.0, 1.0, 1.0, 1.0);
-    const __m128 v_min = _mm_set_ps(-1.0, -1.0, -1.0, -1.0);
-#endif
-
-    // this assumes that audio ports are sorted by position,
-    // and that there are no gaps
-    for (i = 0; i < ((int)m_nb_audio_ports)-4; i += 4) {
-        struct _MBLA_port_cache *p;
-
-        // get the port buffers
-        for (j=0; j<4; j++) {
-            p = &(m_audio_ports.at(i+j));
-            if(likely(p->buffer && p->enabled)) {
-                client_buffers[j] = (float *) p->buffer;
-                client_buffers[j] += offset;
-            } else {
-                // if a port is disabled or has no valid
-                // buffer, use the scratch buffer (all zero's)
-                client_buffers[j] = (float *) m_scratch_buffer;
-            }
-        }
-
-        // the base event for this position
-        target_event = (quadlet_t *)(data + i);
-        // process the events
-        for (j=0;j < nevents; j += 1)
-        {
-            // read the values
-            tmp_values[0] = *(client_buffers[0]);
-            tmp_values[1] = *(client_buffers[1]);
-            tmp_values[2] = *(client_buffers[2]);
-            tmp_values[3] = *(client_buffers[3]);
-
-            // now do the SSE based conversion/labeling
-            __m128 v_float = *((__m128*)tmp_values);
-            __m128i *target = (__m128i*)target_event;
-            __m128i v_int;
-
-            // clip
-#if AMDTP_CLIP_FLOATS
-            // do SSE clipping
-            v_float = _mm_max_ps(v_float, v_min);
-            v_float = _mm_min_ps(v_float, v_max);
-#endif
-
-            // multiply
-            v_float = _mm_mul_ps(v_float, mult);
-            // convert to signed integer
-            v_int = _mm_cvttps_epi32( v_float );
-            // mask
-            v_int = _mm_and_si128( v_int, mask );
-            // label it
-            v_int = _mm_or_si128( v_int, label );
-
-            // do endian conversion (SSE is always little endian)
-            // do first swap
-            v_int = _mm_or_si128( _mm_slli_epi16( v_int, 8 ), _mm_srli_epi16( v_int, 8 ) );
-            // do second swap
-            v_int = _mm_or_si128( _mm_slli_epi32( v_int, 16 ), _mm_srli_epi32( v_int, 16 ) );
-            // store the packed int
-            // (target misalignment is assumed since we don't know the m_dimension)
-            _mm_storeu_si128 (target, v_int);
-
-            // increment the buffer pointers
-            client_buffers[0]++;
-            client_buffers[1]++;
-            client_buffers[2]++; 
-            client_buffers[3]++;
-
-            // go to next target event position
-            target_event += m_dimension;
-        }
-    }
-
-    // do remaining ports
-    // NOTE: these can be time-SSE'd
-    for (; i < (int)m_nb_audio_ports; i++) {
+    bool need_scratch = false;
+    for (int i = 0; i < m_nb_audio_ports; i++) {
         struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
 #ifdef DEBUG
         assert(nevents + offset <= p.buffer_size );
 #endif
-
         if(likely(p.buffer && p.enabled)) {
-            float *buffer = (float *)(p.buffer);
-            buffer += offset;
-    
-            for (j = 0;j < nevents; j += 4)
-            {
-                // read the values
-                tmp_values[0] = *buffer;
-                buffer++;
-                tmp_values[1] = *buffer;
-                buffer++;
-                tmp_values[2] = *buffer;
-                buffer++;
-                tmp_values[3] = *buffer;
-                buffer++;
-
-                // now do the SSE based conversion/labeling
-                __m128 v_float = *((__m128*)tmp_values);
-                __m128i v_int;
-
-#if AMDTP_CLIP_FLOATS
-                // do SSE clipping
-                v_float = _mm_max_ps(v_float, v_min);
-                v_float = _mm_min_ps(v_float, v_max);
-#endif
-                // multiply
-                v_float = _mm_mul_ps(v_float, mult);
-                // convert to signed integer
-                v_int = _mm_cvttps_epi32( v_float );
-                // mask
-                v_int = _mm_and_si128( v_int, mask );
-                // label it
-                v_int = _mm_or_si128( v_int, label );
-    
-                // do endian conversion (SSE is always little endian)
-                // do first swap
-                v_int = _mm_or_si128( _mm_slli_epi16( v_int, 8 ), _mm_srli_epi16( v_int, 8 ) );
-                // do second swap
-                v_int = _mm_or_si128( _mm_slli_epi32( v_int, 16 ), _mm_srli_epi32( v_int, 16 ) );
-
-                // store the packed int
-                _mm_store_si128 ((__m128i *)(&tmp_values_int), v_int);
-
-                // increment the buffer pointers
-                *target_event = tmp_values_int[0];
-                target_event += m_dimension;
-                *target_event = tmp_values_int[1];
-                target_event += m_dimension;
-                *target_event = tmp_values_int[2];
-                target_event += m_dimension;
-                *target_event = tmp_values_int[3];
-                target_event += m_dimension;
-            }
-
-            // do the remainder of the events
-            for(;j < nevents; j += 1) {
-                float *in = (float *)buffer;
-#if AMDTP_CLIP_FLOATS
-                // clip directly to the value of a maxed event
-                if(unlikely(*in > 1.0)) {
-                    *target_event = CONDSWAPTOBUS32_CONST(0x407FFFFF);
-                } else if(unlikely(*in < -1.0)) {
-                    *target_event = CONDSWAPTOBUS32_CONST(0x40800001);
-                } else {
-                    float v = (*in) * AMDTP_FLOAT_MULTIPLIER;
-                    unsigned int tmp = ((int) v);
-                    tmp = ( tmp & 0x00FFFFFF ) | 0x40000000;
-                    *target_event = CondSwapToBus32((quadlet_t)tmp);
-                }
-#else
-                float v = (*in) * AMDTP_FLOAT_MULTIPLIER;
-                unsigned int tmp = ((int) v);
-                tmp = ( tmp & 0x00FFFFFF ) | 0x40000000;
-                *target_event = CondSwapToBus32((quadlet_t)tmp);
-#endif
-                buffer++;
-                target_event += m_dimension;
-            }
-
+            m_audio_buffers[i] = (byte_t *)p.buffer + offset * sample_size;
         } else {
-            for (j = 0;j < nevents; j += 1)
-            {
-                // hardcoded byte swapped
-                *target_event = 0x00000040;
-                target_event += m_dimension;
-            }
-        }
-    }
-}
-
-
-/**
- * @brief mux all audio ports to events
- * @param data 
- * @param offset 
- * @param nevents 
- */
-void
-AmdtpTransmitStreamProcessor::encodeAudioPortsInt24(quadlet_t *data,
-                                                    unsigned int offset,
-                                                    unsigned int nevents)
-{
-    unsigned int j;
-    quadlet_t *target_event;
-    int i;
-
-    uint32_t *client_buffers[4];
-    uint32_t tmp_values[4] __attribute__ ((aligned (16)));
-
-    // prepare the scratch buffer
-    assert(m_scratch_buffer_size_bytes > nevents * 4);
-    memset(m_scratch_buffer, 0, nevents * 4);
-
-    const __m128i label = _mm_set_epi32 (0x40000000, 0x40000000, 0x40000000, 0x40000000);
-    const __m128i mask  = _mm_set_epi32 (0x00FFFFFF, 0x00FFFFFF, 0x00FFFFFF, 0x00FFFFFF);
-
-    // this assumes that audio ports are sorted by position,
-    // and that there are no gaps
-    for (i = 0; i < ((int)m_nb_audio_ports)-4; i += 4) {
-        struct _MBLA_port_cache *p;
-
-        // get the port buffers
-        for (j=0; j<4; j++) {
-            p = &(m_audio_ports.at(i+j));
-            if(likely(p->buffer && p->enabled)) {
-                client_buffers[j] = (uint32_t *) p->buffer;
-                client_buffers[j] += offset;
-            } else {
-                // if a port is disabled or has no valid
-                // buffer, use the scratch buffer (all zero's)
-                client_buffers[j] = (uint32_t *) m_scratch_buffer;
-            }
-        }
-
-        // the base event for this position
-        target_event = (quadlet_t *)(data + i);
-
-        // process the events
-        for (j=0;j < nevents; j += 1)
-        {
-            // read the values
-            tmp_values[0] = *(client_buffers[0]);
-            tmp_values[1] = *(client_buffers[1]);
-            tmp_values[2] = *(client_buffers[2]);
-            tmp_values[3] = *(client_buffers[3]);
-
-            // now do the SSE based conversion/labeling
-            __m128i *target = (__m128i*)target_event;
-            __m128i v_int = *((__m128i*)tmp_values);;
-
-            // mask
-            v_int = _mm_and_si128( v_int, mask );
-            // label it
-            v_int = _mm_or_si128( v_int, label );
-
-            // do endian conversion (SSE is always little endian)
-            // do first swap
-            v_int = _mm_or_si128( _mm_slli_epi16( v_int, 8 ), _mm_srli_epi16( v_int, 8 ) );
-            // do second swap
-            v_int = _mm_or_si128( _mm_slli_epi32( v_int, 16 ), _mm_srli_epi32( v_int, 16 ) );
-
-            // store the packed int
-            // (target misalignment is assumed since we don't know the m_dimension)
-            _mm_storeu_si128 (target, v_int);
-
-            // increment the buffer pointers
-            client_buffers[0]++;
-            client_buffers[1]++;
-            client_buffers[2]++; 
-            client_buffers[3]++;
-
-            // go to next target event position
-            target_event += m_dimension;
+            m_audio_buffers[i] = m_scratch_buffer;
+            need_scratch = true;
         }
     }
-
-    // do remaining ports
-    // NOTE: these can be time-SSE'd
-    for (; i < ((int)m_nb_audio_ports); i++) {
-        struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
-#ifdef DEBUG
-        assert(nevents + offset <= p.buffer_size );
-#endif
-
-        if(likely(p.buffer && p.enabled)) {
-            uint32_t *buffer = (uint32_t *)(p.buffer);
-            buffer += offset;
-    
-            for (j = 0;j < nevents; j += 4)
-            {
-                // read the values
-                tmp_values[0] = *buffer;
-                buffer++;
-                tmp_values[1] = *buffer;
-                buffer++;
-                tmp_values[2] = *buffer;
-                buffer++;
-                tmp_values[3] = *buffer;
-                buffer++;
-
-                // now do the SSE based conversion/labeling
-                __m128i v_int = *((__m128i*)tmp_values);;
-
-                // mask
-                v_int = _mm_and_si128( v_int, mask );
-                // label it
-                v_int = _mm_or_si128( v_int, label );
-
-                // do endian conversion (SSE is always little endian)
-                // do first swap
-                v_int = _mm_or_si128( _mm_slli_epi16( v_int, 8 ), _mm_srli_epi16( v_int, 8 ) );
-                // do second swap
-                v_int = _mm_or_si128( _mm_slli_epi32( v_int, 16 ), _mm_srli_epi32( v_int, 16 ) );
-
-                // store the packed int
-                _mm_store_si128 ((__m128i *)(&tmp_values), v_int);
-
-                // increment the buffer pointers
-                *target_event = tmp_values[0];
-                target_event += m_dimension;
-                *target_event = tmp_values[1];
-                target_event += m_dimension;
-                *target_event = tmp_values[2];
-                target_event += m_dimension;
-                *target_event = tmp_values[3];
-                target_event += m_dimension;
-            }
-
-            // do the remainder of the events
-            for(;j < nevents; j += 1) {
-                uint32_t in = (uint32_t)(*buffer);
-                *target_event = CondSwapToBus32((quadlet_t)((in & 0x00FFFFFF) | 0x40000000));
-                buffer++;
-                target_event += m_dimension;
-            }
-
-        } else {
-            for (j = 0;j < nevents; j += 1)
-            {
-                // hardcoded byte swapped
-                *target_event = 0x00000040;
-                target_event += m_dimension;
-            }
-        }
+    if (need_scratch) {
+        assert(m_scratch_buffer_size_bytes >= nevents * sample_size);
+        memset(m_scratch_buffer, 0, nevents * sample_size);
     }
 }
 
-#else
-
 /**
  * @brief mux all audio ports to events
  * @param data 
@@ -911,40 +586,14 @@ AmdtpTransmitStreamProcessor::encodeAudioPortsInt24(quadlet_t *data,
  * @param nevents 
  */
 void
-AmdtpTransmitStreamProcessor::encodeAudioPortsInt24(quadlet_t *data,
+AmdtpTransmitStreamProcessor::encodeAudioPortsFloat(quadlet_t *data,
                                                     unsigned int offset,
                                                     unsigned int nevents)
 {
-    unsigned int j;
-    quadlet_t *target_event;
-    int i;
-
-    for (i = 0; i < m_nb_audio_ports; i++) {
-        struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
-#ifdef DEBUG
-        assert(nevents + offset <= p.buffer_size );
-#endif
-
-        if(likely(p.buffer && p.enabled)) {
-            quadlet_t *buffer = (quadlet_t *)(p.buffer);
-            buffer += offset;
-    
-            for (j = 0;j < nevents; j += 1)
-            {
-                uint32_t in = (uint32_t)(*buffer);
-                *target_event = CondSwapToBus32((quadlet_t)((in & 0x00FFFFFF) | 0x40000000));
-                buffer++;
-                target_event += m_dimension;
-            }
-        } else {
-            for (j = 0;j < nevents; j += 1)
-            {
-                *target_event = CONDSWAPTOBUS32_CONST(0x40000000);
-                target_event += m_dimension;
-            }
-        }
-    }
+    if (m_nb_audio_ports == 0) return;
+    updateAudioBufferPointers(offset, nevents, sizeof(float));
+    m_encode_audio_float(data, m_dimension, &m_audio_buffers[0],
+                         m_nb_audio_ports, nevents);
 }
 
 /**
@@ -954,59 +603,15 @@ AmdtpTransmitStreamProcessor::encodeAudioPortsInt24(quadlet_t *data,
  * @param nevents 
  */
 void
-AmdtpTransmitStreamProcessor::encodeAudioPortsFloat(quadlet_t *data,
+AmdtpTransmitStreamProcessor::encodeAudioPortsInt24(quadlet_t *data,
                                                     unsigned int offset,
                                                     unsigned int nevents)
 {
-    unsigned int j;
-    quadlet_t *target_event;
-    int i;
-
-    for (i = 0; i < m_nb_audio_ports; i++) {
-        struct _MBLA_port_cache &p = m_audio_ports.at(i);
-        target_event = (quadlet_t *)(data + i);
-#ifdef DEBUG
-        assert(nevents + offset <= p.buffer_size );
-#endif
-
-        if(likely(p.buffer && p.enabled)) {
-            quadlet_t *buffer = (quadlet_t *)(p.buffer);
-            buffer += offset;
-    
-            for (j = 0;j < nevents; j += 1)
-            {
-                float *in = (float *)buffer;
-#if AMDTP_CLIP_FLOATS
-                // clip directly to the value of a maxed event
-                if(unlikely(*in > 1.0)) {
-                    *target_event = CONDSWAPTOBUS32_CONST(0x407FFFFF);
-                } else if(unlikely(*in < -1.0)) {
-                    *target_event = CONDSWAPTOBUS32_CONST(0x40800001);
-                } else {
-                    float v = (*in) * AMDTP_FLOAT_MULTIPLIER;
-                    unsigned int tmp = ((int) v);
-                    tmp = ( tmp & 0x00FFFFFF ) | 0x40000000;
-                    *target_event = CondSwapToBus32((quadlet_t)tmp);
-                }
-#else
-                float v = (*in) * AMDTP_FLOAT_MULTIPLIER;
-                unsigned int tmp = ((int) v);
-                tmp = ( tmp & 0x00FFFFFF ) | 0x40000000;
-                *target_event = CondSwapToBus32((quadlet_t)tmp);
-#endif
-                buffer++;
-                target_event += m_dimension;
-            }
-        } else {
-            for (j = 0;j < nevents; j += 1)
-            {
-                *target_event = CONDSWAPTOBUS32_CONST(0x40000000);
-                target_event += m_dimension;
-            }
-        }
-    }
+    if (m_nb_audio_ports == 0) return;
+    updateAudioBufferPointers(offset, nevents, sizeof(uint32_t));
+    m_encode_audio_int24(data, m_dimension, &m_audio_buffers[0],
+                         m_nb_audio_ports, nevents);
 }
-#endif
 
 /**
  * @brief encodes all midi ports in the cache to events (silence)
@@ -1156,6 +761,7 @@ AmdtpTransmitStreamProcessor::initPortCache() {
 next_index:
         continue;
     }
+    m_audio_buffers.assign(m_nb_audio_ports, (void *)NULL);
 
     for(PortVectorIterator it = m_Ports.begin();
         it != m_Ports.end();
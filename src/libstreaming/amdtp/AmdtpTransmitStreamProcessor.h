@@ -30,6 +30,7 @@
 #include "config.h"
 
 #include "AmdtpStreamProcessor-common.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -112,6 +113,8 @@ private:
     int transmitBlock(char *data, unsigned int nevents,
                         unsigned int offset);
 
+    void updateAudioBufferPointers(unsigned int offset, unsigned int nevents,
+                                   unsigned int sample_size);
     void encodeAudioPortsSilence(quadlet_t *data, unsigned int offset, unsigned int nevents);
     void encodeAudioPortsFloat(quadlet_t *data, unsigned int offset, unsigned int nevents);
     void encodeAudioPortsInt24(quadlet_t *data, unsigned int offset, unsigned int nevents);
@@ -135,6 +138,10 @@ private:
     unsigned int m_transmit_transfer_delay;
     int m_min_cycles_before_presentation;
 
+    // the sample conversion kernels, selected at prepare time
+    am824_encode_func_t m_encode_audio_float;
+    am824_encode_func_t m_encode_audio_int24;
+
 private: // local port caching for performance
     struct _MBLA_port_cache {
         AmdtpAudioPort*     port;
@@ -145,6 +152,7 @@ private: // local port caching for performance
 #endif
     };
     std::vector<struct _MBLA_port_cache> m_audio_ports;
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
     int m_nb_audio_ports;
 
     struct _MIDI_port_cache {
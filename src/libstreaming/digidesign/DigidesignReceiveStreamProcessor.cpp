@@ -40,12 +40,16 @@
 #include <math.h>
 #include <assert.h>
 
+#include "libutil/Likely.h"
+
 
 namespace Streaming {
 
 DigidesignReceiveStreamProcessor::DigidesignReceiveStreamProcessor(FFADODevice &parent, unsigned int event_size)
     : StreamProcessor(parent, ePT_Receive)
     , m_event_size( event_size )
+    , m_decode_audio_float( NULL )
+    , m_decode_audio_int24( NULL )
 {
     // Add whatever else needs to be initialised.
 }
@@ -84,6 +88,26 @@ DigidesignReceiveStreamProcessor::prepareChild() {
     // done.  Return true on success, or false if the setup failed for some
     // reason.  In most cases, this method will do nothing.
     
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_decode_audio_float = kernels.decodePacked24Float;
+    m_decode_audio_int24 = kernels.decodePacked24Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
+    // cache the audio ports and their sample positions for the kernels
+    m_audio_ports.clear();
+    m_audio_positions.clear();
+    for ( PortVectorIterator it = m_Ports.begin();
+          it != m_Ports.end();
+          ++it ) {
+        if((*it)->getPortType() == Port::E_Audio) {
+            DigidesignAudioPort *p = static_cast<DigidesignAudioPort *>(*it);
+            m_audio_ports.push_back(p);
+            m_audio_positions.push_back(p->getPosition());
+        }
+    }
+    m_audio_buffers.assign(m_audio_ports.size(), (void *)NULL);
+
     return true;
 }
 
@@ -191,6 +215,8 @@ bool DigidesignReceiveStreamProcessor::processReadBlock(char *data,
 
     bool no_problem=true;
 
+    decodeDigidesignAudioPorts(data, offset, nevents);
+
     for ( PortVectorIterator it = m_Ports.begin();
           it != m_Ports.end();
           ++it ) {
@@ -201,10 +227,7 @@ bool DigidesignReceiveStreamProcessor::processReadBlock(char *data,
         switch(port->getPortType()) {
 
         case Port::E_Audio:
-            if(decodeDigidesignEventsToPort(static_cast<DigidesignAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                debugWarning("Could not decode packet data to port %s\n",(*it)->getName().c_str());
-                no_problem=false;
-            }
+            // already done by decodeDigidesignAudioPorts()
             break;
         case Port::E_Midi:
              if(decodeDigidesignMidiEventsToPort(static_cast<DigidesignMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
@@ -220,107 +243,53 @@ bool DigidesignReceiveStreamProcessor::processReadBlock(char *data,
     return no_problem;
 }
 
-signed int DigidesignReceiveStreamProcessor::decodeDigidesignEventsToPort(DigidesignAudioPort *p,
-        quadlet_t *data, unsigned int offset, unsigned int nevents)
+/**
+ * @brief decodes the events to all audio ports in one pass
+ *
+ * Disabled ports are decoded into the scratch buffer, which is cheaper
+ * than breaking up the runs of adjacent samples the kernels rely on.
+ *
+ * @param data 
+ * @param offset 
+ * @param nevents 
+ */
+void
+DigidesignReceiveStreamProcessor::decodeDigidesignAudioPorts(char *data,
+        unsigned int offset, unsigned int nevents)
 {
-
-    // Decode "nevents" samples corresponding to the audio port "p" from the
-    // device datastream "data" into each port's ringbuffer at an offset of
-    // "offset" samples from the ringbuffer's origin.  Return value should
-    // be 0.
-    //
-    // In theory the type of data handled by the ringbuffers can be
-    // any one of the eADT_* settings.  This can be determined by calling
-    //   m_StreamProcessorManager.getAudioDataType().
-    // For use with JACK (the most common use case of FFADO) this will
-    // always be StreamProcessorManager::eADT_Float, but one should at
-    // least allow for the possibility of others, even if one chooses not
-    // to support them yet.
-    //
-    // The getPosition() port method returns the "position" field of the
-    // port.  This is used to describe where in the frame the channel's data
-    // is to be found.  Other fields can be added to DigidesignAudioPort to
-    // store other details which might be required to decode the data
-    // packets.  In general "position" is about the only one normally
-    // needed.  Whether "position" is in bytes, frames, or something else is
-    // really determined by the contents of this method.  Choose whatever
-    // is convenient.
-
-    unsigned int j=0;
-
-    // The following is an example implementation showing the general idea. 
-    // It will need to be changed to suit the protocol of the Digidesign
-    // devices.  It assumes that data is supplied by the device in packed
-    // 24-bit integers in big endian format, and that the port's "position"
-    // is in bytes.  Note that the m_event_size object member is assumed to
-    // have been set up previous to be the event size in bytes.  If for a
-    // given implementation it is more convenient to use a "signed int *"
-    // for src_data one could have m_event_size measured in quadlets (32-bit
-    // integers).  Again, it doesn't really matter so long as you're
-    // consistent.
-
-    // Use char here since a port's source address won't necessarily be
-    // aligned; use of an unaligned quadlet_t may cause issues on
-    // certain architectures.
-    unsigned char *src_data;
-    src_data = (unsigned char *)data + p->getPosition();
+    unsigned int nb_ports = m_audio_ports.size();
+    if (nb_ports == 0) return;
+
+    // This assumes that the Digidesign devices use packed 24-bit big
+    // endian samples, with the port's "position" in bytes, as is the case
+    // for the MOTU devices. If this is not the case a different kernel
+    // will be required. Each sample starts a quadlet of its own, the
+    // kernels vectorize such runs of ports as well.
+
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        DigidesignAudioPort *p = m_audio_ports[i];
+        if (likely(!p->isDisabled() && p->getBufferAddress())) {
+            assert(nevents + offset <= p->getBufferSize());
+            m_audio_buffers[i] = (quadlet_t *)p->getBufferAddress() + offset;
+        } else {
+            assert(m_scratch_buffer_size_bytes >= nevents * sizeof(quadlet_t));
+            m_audio_buffers[i] = m_scratch_buffer;
+        }
+    }
 
     switch(m_StreamProcessorManager.getAudioDataType()) {
-        case StreamProcessorManager::eADT_Float:
-            {
-                const float multiplier = 1.0f / (float)(0x7FFFFF);
-                float *buffer=(float *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                buffer+=offset;
-
-                for (j = 0; j < nevents; j += 1) { // decode max nsamples
-
-                    signed int v = (*src_data<<16)+(*(src_data+1)<<8)+*(src_data+2);
-                    /* Sign-extend highest bit of incoming 24-bit integer */
-                    if (*src_data & 0x80)
-                      v |= 0xff000000;
-                    *buffer = v * multiplier;
-                    buffer++;
-                    src_data += m_event_size;
-                }
-            }
-            break;
-
         case StreamProcessorManager::eADT_Int24:
-            {
-                quadlet_t *buffer=(quadlet_t *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                // Offset is in frames, but each port is only a single
-                // channel, so the number of frames is the same as the
-                // number of quadlets to offset (assuming the port buffer
-                // uses one quadlet per sample, which is the case currently).
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // Decode nsamples
-                    *buffer = (*src_data<<16)+(*(src_data+1)<<8)+*(src_data+2);
-                    // Sign-extend highest bit of 24-bit int.
-                    // This isn't strictly needed since E_Int24 is a 24-bit,
-                    // but doing so shouldn't break anything and makes the data
-                    // easier to deal with during debugging.
-                    if (*src_data & 0x80)
-                        *buffer |= 0xff000000;
-
-                    buffer++;
-                    src_data+=m_event_size;
-                }
-            }
+            m_decode_audio_int24((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
+            break;
+        case StreamProcessorManager::eADT_Float:
+            m_decode_audio_float((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
-
         default:
             // Unsupported type.
             break;
     }
-
-    return 0;
 }
 
 int
@@ -33,6 +33,7 @@
 
 #include "../generic/StreamProcessor.h"
 #include "../util/cip.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -79,7 +80,7 @@ protected:
 private:
     bool decodePacketPorts(quadlet_t *data, unsigned int nevents, unsigned int dbc);
 
-    int decodeDigidesignEventsToPort(DigidesignAudioPort *, quadlet_t *data, unsigned int offset, unsigned int nevents);
+    void decodeDigidesignAudioPorts(char *data, unsigned int offset, unsigned int nevents);
     int decodeDigidesignMidiEventsToPort(DigidesignMidiPort *, quadlet_t *data, unsigned int offset, unsigned int nevents);
 
     /*
@@ -88,6 +89,15 @@ private:
      */
     unsigned int m_event_size;
 
+    // the sample conversion kernels, selected at prepare time
+    packed24_decode_func_t m_decode_audio_float;
+    packed24_decode_func_t m_decode_audio_int24;
+
+    // audio port cache, set up by prepareChild()
+    std::vector<DigidesignAudioPort *> m_audio_ports;
+    std::vector<unsigned int> m_audio_positions; // byte position within an event
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
+
 };
 
 
@@ -41,8 +41,7 @@
 #include <assert.h>
 
 /* Provide more intuitive access to GCC's branch predition built-ins */
-#define likely(x)   __builtin_expect((x),1)
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
 namespace Streaming
 {
@@ -51,6 +50,8 @@ namespace Streaming
 DigidesignTransmitStreamProcessor::DigidesignTransmitStreamProcessor(FFADODevice &parent, unsigned int event_size )
         : StreamProcessor(parent, ePT_Transmit )
         , m_event_size( event_size )
+        , m_encode_audio_float( NULL )
+        , m_encode_audio_int24( NULL )
 {
     // Provide any other initialisation code needed.
 }
@@ -533,6 +534,26 @@ bool DigidesignTransmitStreamProcessor::prepareChild()
     // method doesn't do anything but it's provided in case it proves useful
     // for some device.
 
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_encode_audio_float = kernels.encodePacked24Float;
+    m_encode_audio_int24 = kernels.encodePacked24Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
+    // cache the audio ports and their sample positions for the kernels
+    m_audio_ports.clear();
+    m_audio_positions.clear();
+    for ( PortVectorIterator it = m_Ports.begin();
+          it != m_Ports.end();
+          ++it ) {
+        if((*it)->getPortType() == Port::E_Audio) {
+            DigidesignAudioPort *p = static_cast<DigidesignAudioPort *>(*it);
+            m_audio_ports.push_back(p);
+            m_audio_positions.push_back(p->getPosition());
+        }
+    }
+    m_audio_buffers.assign(m_audio_ports.size(), (void *)NULL);
+
     return true;
 }
 
@@ -551,12 +572,16 @@ bool DigidesignTransmitStreamProcessor::processWriteBlock(char *data,
     // of events (aka frames) to transfer and "offset" is the position
     // within the port ring buffers to take data from.
 
+    // Disabled audio ports are sent silence by the kernel
+    encodeDigidesignAudioPorts(data, offset, nevents);
+
     for ( PortVectorIterator it = m_Ports.begin();
       it != m_Ports.end();
       ++it ) {
         // If this port is disabled, unconditionally send it silence.
         if((*it)->isDisabled()) {
-          if (encodeSilencePortToDigidesignEvents(static_cast<DigidesignAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
+          if ((*it)->getPortType() != Port::E_Audio &&
+              encodeSilencePortToDigidesignEvents(static_cast<DigidesignAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
             debugWarning("Could not encode silence for disabled port %s to Digidesign events\n",(*it)->getName().c_str());
             // Don't treat this as a fatal error at this point
           }
@@ -568,10 +593,7 @@ bool DigidesignTransmitStreamProcessor::processWriteBlock(char *data,
         switch(port->getPortType()) {
 
         case Port::E_Audio:
-            if (encodePortToDigidesignEvents(static_cast<DigidesignAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                debugWarning("Could not encode port %s to Digidesign events\n",(*it)->getName().c_str());
-                no_problem=false;
-            }
+            // already done by encodeDigidesignAudioPorts()
             break;
         case Port::E_Midi:
              if (encodePortToDigidesignMidiEvents(static_cast<DigidesignMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
@@ -618,88 +640,57 @@ DigidesignTransmitStreamProcessor::transmitSilenceBlock(char *data,
     return no_problem;
 }
 
-int DigidesignTransmitStreamProcessor::encodePortToDigidesignEvents(DigidesignAudioPort *p, quadlet_t *data,
-                       unsigned int offset, unsigned int nevents) {
-// Encodes nevents worth of data from the given port into the given buffer.  The
-// format of the buffer is precisely that which will be sent to the Digidesign interface.
-// The basic idea:
-//   iterate over the ports
-//     * get port buffer address
-//     * loop over events
-//         - pick right sample in event based upon PortInfo
-//         - convert sample from Port format (E_Int24, E_Float, ..) to Digidesign
-//           native format
-//
-// We include the ability to start the transfer from the given offset within
-// the port (expressed in frames) so the 'efficient' transfer method can be
-// utilised.
-
-// This code assumes that the Digidesign expects its data to be packed
-// 24-bit integers.  If this is not the case changes will be required.
-
-    unsigned int j=0;
-
-    // Use char here since the target address won't necessarily be
-    // aligned; use of an unaligned quadlet_t may cause issues on certain
-    // architectures.  Besides, the target (data going directly to the MOTU)
-    // isn't structured in quadlets anyway; it mainly consists of packed
-    // 24-bit integers.
-    unsigned char *target;
-    target = (unsigned char *)data + p->getPosition();
+/**
+ * @brief encodes all audio ports to the events in one pass
+ *
+ * Encodes nevents worth of data from the port buffers, starting at the
+ * given offset (in frames) within the ports. Disabled ports are taken
+ * from the zeroed scratch buffer and hence encode to silence.
+ *
+ * @param data 
+ * @param offset 
+ * @param nevents 
+ */
+void
+DigidesignTransmitStreamProcessor::encodeDigidesignAudioPorts(char *data,
+        unsigned int offset, unsigned int nevents)
+{
+    unsigned int nb_ports = m_audio_ports.size();
+    if (nb_ports == 0) return;
+
+    // This assumes that the Digidesign devices use packed 24-bit big
+    // endian samples, with the port's "position" in bytes, as is the case
+    // for the MOTU devices. If this is not the case a different kernel
+    // will be required. Each sample starts a quadlet of its own, the
+    // kernels vectorize such runs of ports as well.
+
+    bool need_scratch = false;
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        DigidesignAudioPort *p = m_audio_ports[i];
+        if (likely(!p->isDisabled() && p->getBufferAddress())) {
+            assert(nevents + offset <= p->getBufferSize());
+            m_audio_buffers[i] = (quadlet_t *)p->getBufferAddress() + offset;
+        } else {
+            m_audio_buffers[i] = m_scratch_buffer;
+            need_scratch = true;
+        }
+    }
+    if (need_scratch) {
+        assert(m_scratch_buffer_size_bytes >= nevents * sizeof(quadlet_t));
+        memset(m_scratch_buffer, 0, nevents * sizeof(quadlet_t));
+    }
 
     switch(m_StreamProcessorManager.getAudioDataType()) {
         default:
         case StreamProcessorManager::eADT_Int24:
-            {
-                quadlet_t *buffer=(quadlet_t *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                // Offset is in frames, but each port is only a single
-                // channel, so the number of frames is the same as the
-                // number of quadlets to offset (assuming the port buffer
-                // uses one quadlet per sample, which is the case currently).
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // Decode nsamples
-                    *target = (*buffer >> 16) & 0xff;
-                    *(target+1) = (*buffer >> 8) & 0xff;
-                    *(target+2) = (*buffer) & 0xff;
-
-                    buffer++;
-                    target+=m_event_size;
-                }
-            }
+            m_encode_audio_int24((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
         case StreamProcessorManager::eADT_Float:
-            {
-                const float multiplier = (float)(0x7FFFFF);
-                float *buffer=(float *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // decode max nsamples
-                    float in = *buffer;
-
-#if DIGIDESIGN_CLIP_FLOATS
-                    if (unlikely(in > 1.0)) in = 1.0;
-                    if (unlikely(in < -1.0)) in = -1.0;
-#endif
-                    unsigned int v = lrintf(in * multiplier);
-                    *target = (v >> 16) & 0xff;
-                    *(target+1) = (v >> 8) & 0xff;
-                    *(target+2) = v & 0xff;
-
-                    buffer++;
-                    target+=m_event_size;
-                }
-            }
+            m_encode_audio_float((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
     }
-
-    return 0;
 }
 
 int DigidesignTransmitStreamProcessor::encodeSilencePortToDigidesignEvents(DigidesignAudioPort *p, quadlet_t *data,
@@ -33,6 +33,7 @@
 
 #include "../generic/StreamProcessor.h"
 #include "../util/cip.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -93,8 +94,7 @@ private:
     bool encodePacketPorts(quadlet_t *data, unsigned int nevents,
                            unsigned int dbc);
 
-    int encodePortToDigidesignEvents(DigidesignAudioPort *, quadlet_t *data,
-                                unsigned int offset, unsigned int nevents);
+    void encodeDigidesignAudioPorts(char *data, unsigned int offset, unsigned int nevents);
     int encodeSilencePortToDigidesignEvents(DigidesignAudioPort *, quadlet_t *data,
                                 unsigned int offset, unsigned int nevents);
 
@@ -111,6 +111,15 @@ private:
      */
     unsigned int m_event_size;
 
+    // the sample conversion kernels, selected at prepare time
+    packed24_encode_func_t m_encode_audio_float;
+    packed24_encode_func_t m_encode_audio_int24;
+
+    // audio port cache, set up by prepareChild()
+    std::vector<DigidesignAudioPort *> m_audio_ports;
+    std::vector<unsigned int> m_audio_positions; // byte position within an event
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
+
 };
 
 } // end of namespace Streaming
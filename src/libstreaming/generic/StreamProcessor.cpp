@@ -78,6 +78,13 @@ StreamProcessor::StreamProcessor(FFADODevice &parent, enum eProcessorType type)
     , m_max_fs_diff_norm ( 0.01 )
     , m_max_diff_ticks ( 50 )
     , m_in_xrun( false )
+    , m_period_generation( 1 )
+    , m_period_signaled_generation( 0 )
+    , m_transfer_nsecs_last( 0 )
+    , m_transfer_nsecs_max( 0 )
+    , m_transfer_nsecs_sum( 0 )
+    , m_transfer_count( 0 )
+    , m_flight_channel( NULL )
 {
     // create the timestamped buffer and register ourselves as its client
     m_data_buffer = new Util::TimestampedBuffer(this);
@@ -91,6 +98,49 @@ StreamProcessor::~StreamProcessor() {
 
     if (m_data_buffer) delete m_data_buffer;
     if (m_scratch_buffer) delete[] m_scratch_buffer;
+    unregisterStats();
+}
+
+void
+StreamProcessor::registerStats(unsigned int index)
+{
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "stream/%016"PRIX64"/%s%u/",
+             m_Parent.getConfigRom().getGuid(),
+             (getType() == ePT_Receive ? "receive" : "transmit"), index);
+    std::string p(prefix);
+    Util::StatsRegistry *r = Util::StatsRegistry::instance();
+    m_stat_xruns = r->registerStat(p + "xruns", Util::StatsRegistry::eT_Counter);
+    m_stat_buffer_fill = r->registerStat(p + "buffer_fill", Util::StatsRegistry::eT_Gauge, "frames");
+    m_stat_dll_rate_error = r->registerStat(p + "dll_rate_error", Util::StatsRegistry::eT_Gauge, "ppb");
+    m_stat_transfer_nsecs = r->registerStat(p + "transfer_time", Util::StatsRegistry::eT_Histogram, "nsec");
+}
+
+void
+StreamProcessor::unregisterStats()
+{
+    Util::StatsRegistry *r = Util::StatsRegistry::instance();
+    r->unregisterStat(m_stat_xruns);
+    r->unregisterStat(m_stat_buffer_fill);
+    r->unregisterStat(m_stat_dll_rate_error);
+    r->unregisterStat(m_stat_transfer_nsecs);
+}
+
+void
+StreamProcessor::updateStats()
+{
+    m_stat_buffer_fill.set(m_data_buffer->getBufferFill());
+    // the deviation of the rate the DLL tracks from the nominal rate
+    float ticks_per_frame = getTicksPerFrame();
+    unsigned int nominal_rate = m_StreamProcessorManager.getNominalRate();
+    int64_t rate_error = 0;
+    if (ticks_per_frame > 0 && nominal_rate > 0) {
+        double nominal_ticks_per_frame = (double)TICKS_PER_SECOND / nominal_rate;
+        rate_error = (int64_t)((nominal_ticks_per_frame / ticks_per_frame - 1.0) * 1e9);
+        m_stat_dll_rate_error.set(rate_error);
+    }
+    recordEvent(Util::FlightRecorder::eET_PeriodTransfer, 0, -1,
+                m_transfer_nsecs_last, (int32_t)rate_error);
 }
 
 bool
@@ -144,7 +194,7 @@ StreamProcessor::handleBusResetDo()
     debugOutput(DEBUG_LEVEL_VERBOSE, "(%p) handling busreset\n", this);
     m_state = ePS_Error;
     // this will result in the SPM dying
-    m_in_xrun = true;
+    flagXrun();
     SIGNAL_ACTIVITY_ALL;
     return true;
 }
@@ -172,7 +222,7 @@ void StreamProcessor::handlerDied()
 {
     debugWarning("Handler died for %p\n", this);
     m_state = ePS_Stopped;
-    m_in_xrun = true;
+    flagXrun();
     SIGNAL_ACTIVITY_ALL;
 }
 
@@ -441,6 +491,10 @@ StreamProcessor::putPacket(unsigned char *data, unsigned int length,
 
     // check the packet header
     enum eChildReturnValue result = processPacketHeader(data, length, tag, sy, pkt_ctr);
+    recordEvent(Util::FlightRecorder::eET_PacketReceived,
+                (dropped_cycles ? Util::FlightRecorder::eEF_Dropped : 0)
+                | (result == eCRV_Invalid ? Util::FlightRecorder::eEF_Invalid : 0),
+                CYCLE_TIMER_GET_CYCLES(pkt_ctr), length, dropped_cycles);
 
     // handle dropped cycles
     if(dropped_cycles) {
@@ -448,7 +502,7 @@ StreamProcessor::putPacket(unsigned char *data, unsigned int length,
         m_correct_last_timestamp = true;
         if (m_state == ePS_Running) {
             // this is an xrun situation
-            m_in_xrun = true;
+            flagXrun();
             debugOutput(DEBUG_LEVEL_NORMAL, "Should update state to WaitingForStreamDisable due to dropped packet xrun\n");
             m_cycle_to_switch_state = CYCLE_TIMER_GET_CYCLES(pkt_ctr) + 1; // switch in the next cycle
             m_next_state = ePS_WaitingForStreamDisable;
@@ -462,65 +516,7 @@ StreamProcessor::putPacket(unsigned char *data, unsigned int length,
 
     if (result == eCRV_OK) {
         #ifdef DEBUG
-        if (m_last_timestamp > 0 && m_last_timestamp2 > 0) {
-            int64_t tsp_diff = diffTicks(m_last_timestamp, m_last_timestamp2);
-            debugOutputExtreme(DEBUG_LEVEL_VERBOSE, "TSP diff: %"PRId64"\n", tsp_diff);
-            double tsp_diff_d = tsp_diff;
-            double fs_syt = 1.0/tsp_diff_d;
-            fs_syt *= (double)getNominalFramesPerPacket() * (double)TICKS_PER_USEC * 1e6;
-            double fs_nom = (double)m_StreamProcessorManager.getNominalRate();
-            double fs_diff = fs_nom - fs_syt;
-            double fs_diff_norm = fs_diff/fs_nom;
-            debugOutputExtreme(DEBUG_LEVEL_VERBOSE, "Nom fs: %12f, Instantanous fs: %12f, diff: %12f (%12f)\n",
-                        fs_nom, fs_syt, fs_diff, fs_diff_norm);
-            if (fs_diff_norm > m_max_fs_diff_norm || fs_diff_norm < -m_max_fs_diff_norm) {
-                debugWarning( "Instantanous samplerate more than %0.0f%% off nominal. [Nom fs: %12f, Instantanous fs: %12f, diff: %12f (%12f)]\n",
-                        m_max_fs_diff_norm*100,
-                        fs_nom, fs_syt, fs_diff, fs_diff_norm);
-            }
-
-            int ticks_per_packet = (int)(getTicksPerFrame() * getNominalFramesPerPacket());
-            int diff = diffTicks(m_last_timestamp, m_last_timestamp2);
-                // display message if the difference between two successive tick
-                // values is more than 50 ticks. 1 sample at 48k is 512 ticks
-                // so 50 ticks = 10%, which is a rather large jitter value.
-                if(diff-ticks_per_packet > m_max_diff_ticks || diff-ticks_per_packet < -m_max_diff_ticks) {
-                    debugOutput(DEBUG_LEVEL_VERBOSE,
-                                "cy %04d rather large TSP difference TS=%011"PRIu64" => TS=%011"PRIu64" (%d, nom %d)\n",
-                                (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr), m_last_timestamp2,
-                                m_last_timestamp, diff, ticks_per_packet);
-                    // !!!HACK!!! FIXME: this is the result of a failure in wrapping/unwrapping somewhere
-                    // it's definitely a bug.
-                    // try to fix up the timestamp
-                    int64_t last_timestamp_fixed;
-                    // first try to add one second
-                    last_timestamp_fixed = addTicks(m_last_timestamp, TICKS_PER_SECOND);
-                    diff = diffTicks(last_timestamp_fixed, m_last_timestamp2);
-                    if(diff-ticks_per_packet < 50 && diff-ticks_per_packet > -50) {
-                        debugWarning("cy %04d rather large TSP difference TS=%011"PRIu64" => TS=%011"PRIu64" (%d, nom %d)\n",
-                                    (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr), m_last_timestamp2,
-                                    m_last_timestamp, diff, ticks_per_packet);
-                        debugWarning("HACK: fixed by adding one second of ticks. This is a bug being run-time fixed.\n");
-                        m_last_timestamp = last_timestamp_fixed;
-                    } else {
-                        // if that didn't work, try to subtract one second
-                        last_timestamp_fixed = substractTicks(m_last_timestamp, TICKS_PER_SECOND);
-                        diff = diffTicks(last_timestamp_fixed, m_last_timestamp2);
-                        if(diff-ticks_per_packet < 50 && diff-ticks_per_packet > -50) {
-                            debugWarning("cy %04d rather large TSP difference TS=%011"PRIu64" => TS=%011"PRIu64" (%d, nom %d)\n",
-                                        (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr), m_last_timestamp2,
-                                        m_last_timestamp, diff, ticks_per_packet);
-                            debugWarning("HACK: fixed by subtracing one second of ticks. This is a bug being run-time fixed.\n");
-                            m_last_timestamp = last_timestamp_fixed;
-                        }
-                    }
-                }
-                debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
-                                "%04u %011"PRIu64" %011"PRIu64" %d %d\n",
-                                (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr),
-                                m_last_timestamp2, m_last_timestamp, 
-                                diff, ticks_per_packet);
-        }
+        checkPacketTimestamp(pkt_ctr);
         #endif
 
         debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
@@ -585,7 +581,7 @@ StreamProcessor::putPacket(unsigned char *data, unsigned int length,
         // allow for the xrun to be picked up
         if (result2 == eCRV_XRun) {
             debugOutput(DEBUG_LEVEL_NORMAL, "processPacketData xrun\n");
-            m_in_xrun = true;
+            flagXrun();
             debugOutput(DEBUG_LEVEL_VERBOSE, "Should update state to WaitingForStreamDisable due to data xrun\n");
             m_cycle_to_switch_state = CYCLE_TIMER_GET_CYCLES(pkt_ctr)+1; // switch in the next cycle
             m_next_state = ePS_WaitingForStreamDisable;
@@ -612,11 +608,95 @@ StreamProcessor::putPacket(unsigned char *data, unsigned int length,
     return RAW1394_ISO_ERROR;
 }
 
+#ifdef DEBUG
+void
+StreamProcessor::checkPacketTimestamp(uint32_t pkt_ctr)
+{
+    if (m_last_timestamp > 0 && m_last_timestamp2 > 0) {
+        int64_t tsp_diff = diffTicks(m_last_timestamp, m_last_timestamp2);
+        debugOutputExtreme(DEBUG_LEVEL_VERBOSE, "TSP diff: %"PRId64"\n", tsp_diff);
+        double tsp_diff_d = tsp_diff;
+        double fs_syt = 1.0/tsp_diff_d;
+        fs_syt *= (double)getNominalFramesPerPacket() * (double)TICKS_PER_USEC * 1e6;
+        double fs_nom = (double)m_StreamProcessorManager.getNominalRate();
+        double fs_diff = fs_nom - fs_syt;
+        double fs_diff_norm = fs_diff/fs_nom;
+        debugOutputExtreme(DEBUG_LEVEL_VERBOSE, "Nom fs: %12f, Instantanous fs: %12f, diff: %12f (%12f)\n",
+                    fs_nom, fs_syt, fs_diff, fs_diff_norm);
+        if (fs_diff_norm > m_max_fs_diff_norm || fs_diff_norm < -m_max_fs_diff_norm) {
+            debugWarning( "Instantanous samplerate more than %0.0f%% off nominal. [Nom fs: %12f, Instantanous fs: %12f, diff: %12f (%12f)]\n",
+                    m_max_fs_diff_norm*100,
+                    fs_nom, fs_syt, fs_diff, fs_diff_norm);
+        }
+
+        int ticks_per_packet = (int)(getTicksPerFrame() * getNominalFramesPerPacket());
+        int diff = diffTicks(m_last_timestamp, m_last_timestamp2);
+            // display message if the difference between two successive tick
+            // values is more than 50 ticks. 1 sample at 48k is 512 ticks
+            // so 50 ticks = 10%, which is a rather large jitter value.
+            if(diff-ticks_per_packet > m_max_diff_ticks || diff-ticks_per_packet < -m_max_diff_ticks) {
+                debugOutput(DEBUG_LEVEL_VERBOSE,
+                            "cy %04d rather large TSP difference TS=%011"PRIu64" => TS=%011"PRIu64" (%d, nom %d)\n",
+                            (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr), m_last_timestamp2,
+                            m_last_timestamp, diff, ticks_per_packet);
+                // !!!HACK!!! FIXME: this is the result of a failure in wrapping/unwrapping somewhere
+                // it's definitely a bug.
+                // try to fix up the timestamp
+                int64_t last_timestamp_fixed;
+                // first try to add one second
+                last_timestamp_fixed = addTicks(m_last_timestamp, TICKS_PER_SECOND);
+                diff = diffTicks(last_timestamp_fixed, m_last_timestamp2);
+                if(diff-ticks_per_packet < 50 && diff-ticks_per_packet > -50) {
+                    debugWarning("cy %04d rather large TSP difference TS=%011"PRIu64" => TS=%011"PRIu64" (%d, nom %d)\n",
+                                (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr), m_last_timestamp2,
+                                m_last_timestamp, diff, ticks_per_packet);
+                    debugWarning("HACK: fixed by adding one second of ticks. This is a bug being run-time fixed.\n");
+                    m_last_timestamp = last_timestamp_fixed;
+                } else {
+                    // if that didn't work, try to subtract one second
+                    last_timestamp_fixed = substractTicks(m_last_timestamp, TICKS_PER_SECOND);
+                    diff = diffTicks(last_timestamp_fixed, m_last_timestamp2);
+                    if(diff-ticks_per_packet < 50 && diff-ticks_per_packet > -50) {
+                        debugWarning("cy %04d rather large TSP difference TS=%011"PRIu64" => TS=%011"PRIu64" (%d, nom %d)\n",
+                                    (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr), m_last_timestamp2,
+                                    m_last_timestamp, diff, ticks_per_packet);
+                        debugWarning("HACK: fixed by subtracing one second of ticks. This is a bug being run-time fixed.\n");
+                        m_last_timestamp = last_timestamp_fixed;
+                    }
+                }
+            }
+            debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
+                            "%04u %011"PRIu64" %011"PRIu64" %d %d\n",
+                            (int)CYCLE_TIMER_GET_CYCLES(pkt_ctr),
+                            m_last_timestamp2, m_last_timestamp, 
+                            diff, ticks_per_packet);
+    }
+}
+#endif
+
 enum raw1394_iso_disposition
 StreamProcessor::getPacket(unsigned char *data, unsigned int *length,
                            unsigned char *tag, unsigned char *sy,
                            uint32_t pkt_ctr, unsigned int dropped_cycles,
                            unsigned int skipped, unsigned int max_length) {
+    enum raw1394_iso_disposition retval;
+    retval = getPacketDo(data, length, tag, sy, pkt_ctr, dropped_cycles, skipped, max_length);
+    if (m_flight_channel && pkt_ctr != 0xFFFFFFFF) {
+        recordEvent(Util::FlightRecorder::eET_PacketTransmitted,
+                    (dropped_cycles ? Util::FlightRecorder::eEF_Dropped : 0)
+                    | (skipped ? Util::FlightRecorder::eEF_Skipped : 0)
+                    | (retval == RAW1394_ISO_DEFER || retval == RAW1394_ISO_AGAIN
+                       ? Util::FlightRecorder::eEF_Deferred : 0),
+                    CYCLE_TIMER_GET_CYCLES(pkt_ctr), *length, skipped);
+    }
+    return retval;
+}
+
+enum raw1394_iso_disposition
+StreamProcessor::getPacketDo(unsigned char *data, unsigned int *length,
+                             unsigned char *tag, unsigned char *sy,
+                             uint32_t pkt_ctr, unsigned int dropped_cycles,
+                             unsigned int skipped, unsigned int max_length) {
     if (pkt_ctr == 0xFFFFFFFF) {
         *tag = 0;
         *sy = 0;
@@ -635,7 +715,7 @@ StreamProcessor::getPacket(unsigned char *data, unsigned int *length,
     if (dropped_cycles > 0) {
         // HACK: this should not be necessary, since the header generation functions should trigger the xrun.
         //       but apparently there are some issues with the 1394 stack
-        m_in_xrun = true;
+        flagXrun();
         if(m_state == ePS_Running) {
             debugShowBackLogLines(200);
             debugOutput(DEBUG_LEVEL_NORMAL, "dropped packets xrun (%u)\n", dropped_cycles);
@@ -767,7 +847,7 @@ StreamProcessor::getPacket(unsigned char *data, unsigned int *length,
             // allow for the xrun to be picked up
             if (result2 == eCRV_XRun) {
                 debugOutput(DEBUG_LEVEL_NORMAL, "generatePacketData xrun\n");
-                m_in_xrun = true;
+                flagXrun();
                 debugOutput(DEBUG_LEVEL_VERBOSE, "Should update state to WaitingForStreamDisable due to data xrun\n");
                 m_cycle_to_switch_state = CYCLE_TIMER_GET_CYCLES(pkt_ctr) + 1; // switch in the next cycle
                 m_next_state = ePS_WaitingForStreamDisable;
@@ -824,7 +904,7 @@ StreamProcessor::getPacket(unsigned char *data, unsigned int *length,
             }
         } else if (result == eCRV_XRun) { // pick up the possible xruns
             debugOutput(DEBUG_LEVEL_NORMAL, "generatePacketHeader xrun\n");
-            m_in_xrun = true;
+            flagXrun();
             debugOutput(DEBUG_LEVEL_VERBOSE, "Should update state to WaitingForStreamDisable due to header xrun\n");
             m_cycle_to_switch_state = CYCLE_TIMER_GET_CYCLES(pkt_ctr) + 1; // switch in the next cycle
             m_next_state = ePS_WaitingForStreamDisable;
@@ -1867,6 +1947,22 @@ bool StreamProcessor::canConsume(unsigned int nframes)
     }
 }
 
+void StreamProcessor::updatePeriodReadiness()
+{
+    if (!m_StreamProcessorManager.isPeriodSignalEventDriven()) return;
+    // signal once per period. the generation is read before the buffer
+    // state, such that a period the client finished meanwhile is
+    // signaled again on the next call.
+    unsigned int generation = m_period_generation;
+    if (generation == m_period_signaled_generation) return;
+    bool ready = (getType() == ePT_Receive ? canConsumePeriod() : canProducePeriod());
+    // when the other streams aren't ready yet, try again next time,
+    // the client is only woken up once all of them are
+    if (ready && m_StreamProcessorManager.signalPeriodReady()) {
+        m_period_signaled_generation = generation;
+    }
+}
+
 /***********************************************
  * Helper routines                             *
  ***********************************************/
@@ -1967,6 +2063,8 @@ StreamProcessor::dumpInfo()
                                           24576000.0/m_StreamProcessorManager.getSyncSource().m_data_buffer->getRate(),
                                           24576000.0/m_data_buffer->getRate());
     #endif
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "  Transfer time         : last %"PRIu64" ns, avg %.0f ns, max %"PRIu64" ns\n",
+                                          m_transfer_nsecs_last, getTransferTimeAvgNsecs(), m_transfer_nsecs_max);
     m_data_buffer->dumpInfo();
 }
 
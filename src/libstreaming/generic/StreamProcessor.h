@@ -28,7 +28,9 @@
 
 #include "PortManager.h"
 
+#include "libutil/FlightRecorder.h"
 #include "libutil/StreamStatistics.h"
+#include "libutil/StatsRegistry.h"
 #include "libutil/TimestampedBuffer.h"
 #include "libutil/OptionContainer.h"
 
@@ -42,6 +44,7 @@ class IsoHandlerManager;
 namespace Streaming {
 
     class StreamProcessorManager;
+
 /*!
 \brief Class providing a generic interface for Stream Processors
 
@@ -170,6 +173,13 @@ public: // the public receive/transmit functions
               unsigned char *tag, unsigned char *sy,
               uint32_t pkt_ctr, unsigned int dropped,
               unsigned int skipped, unsigned int max_length);
+private:
+    enum raw1394_iso_disposition
+    getPacketDo(unsigned char *data, unsigned int *length,
+                unsigned char *tag, unsigned char *sy,
+                uint32_t pkt_ctr, unsigned int dropped,
+                unsigned int skipped, unsigned int max_length);
+public:
 
     bool getFrames(unsigned int nbframes, int64_t ts); ///< transfer the buffer contents to the client
     bool putFrames(unsigned int nbframes, int64_t ts); ///< transfer the client contents to the buffer
@@ -182,6 +192,35 @@ public: // the public receive/transmit functions
     bool canConsumePeriod();
     bool canConsume(unsigned int nframes);
 
+    /**
+     * @brief signal the manager when this stream becomes ready for a period
+     * called by the ISO handler after it handled a batch of packets,
+     * only does something when the period signaling is event driven.
+     */
+    void updatePeriodReadiness();
+    /**
+     * @brief start a new period for the readiness signaling
+     * called by the client once it transferred a period, such that
+     * the next period is signaled again.
+     */
+    void clearPeriodReadiness() {__sync_fetch_and_add(&m_period_generation, 1);};
+
+    /**
+     * @brief account the time a getFrames()/putFrames() call took
+     * called by the manager, which may transfer several SP's in
+     * parallel. The slowest SP determines the transfer time of a period.
+     */
+    void addTransferTime(uint64_t nsecs)
+        {m_transfer_nsecs_last = nsecs;
+         m_transfer_nsecs_sum += nsecs;
+         if (nsecs > m_transfer_nsecs_max) m_transfer_nsecs_max = nsecs;
+         m_transfer_count++;
+         m_stat_transfer_nsecs.record(nsecs);};
+    uint64_t getTransferTimeLastNsecs() {return m_transfer_nsecs_last;};
+    uint64_t getTransferTimeMaxNsecs() {return m_transfer_nsecs_max;};
+    double getTransferTimeAvgNsecs()
+        {return (m_transfer_count ? (double)m_transfer_nsecs_sum / m_transfer_count : 0.0);};
+
 public:
     /**
      * @brief drop nframes from the internal buffer as if they were transferred to the client side
@@ -274,6 +313,10 @@ private:
 
     bool transferSilence(unsigned int size);
 
+#ifdef DEBUG
+    void checkPacketTimestamp(uint32_t pkt_ctr);
+#endif
+
 public:
     // move to private?
     bool xrunOccurred() { return m_in_xrun; };
@@ -433,6 +476,53 @@ protected:
         signed int m_max_diff_ticks;
     private:
         bool m_in_xrun;
+        // bumped by the client for each period, the ISO thread remembers
+        // the period it signaled. each side only writes its own variable.
+        volatile unsigned int m_period_generation;
+        unsigned int m_period_signaled_generation;
+        // transfer timing
+        uint64_t m_transfer_nsecs_last;
+        uint64_t m_transfer_nsecs_max;
+        uint64_t m_transfer_nsecs_sum;
+        unsigned int m_transfer_count;
+        // published statistics
+        Util::Stat m_stat_xruns;
+        Util::Stat m_stat_buffer_fill;
+        Util::Stat m_stat_dll_rate_error;
+        Util::Stat m_stat_transfer_nsecs;
+        void unregisterStats();
+
+        Util::FlightRecorder::Channel *m_flight_channel;
+        void recordEvent(enum Util::FlightRecorder::EEventType type, unsigned int flags,
+                         int32_t cycle, int64_t arg, int32_t arg2 = 0)
+            {if (m_flight_channel) {
+                m_flight_channel->record(type, flags, cycle, m_data_buffer->getBufferFill(),
+                                         m_last_timestamp, arg, arg2);
+             }};
+        ///> mark the stream as being in xrun, the manager picks that up
+        void flagXrun()
+            {m_in_xrun = true;
+             m_stat_xruns.add();
+             recordEvent(Util::FlightRecorder::eET_Xrun, 0, -1, 0);};
+
+public:
+    /**
+     * @brief publish the statistics of this stream in the StatsRegistry
+     * @param index the index of the stream within its manager
+     */
+    void registerStats(unsigned int index);
+    /**
+     * @brief update the buffer fill and DLL statistics
+     * called by the manager once per period, after the transfer.
+     * Also records the transfer in the flight recorder.
+     */
+    void updateStats();
+    /**
+     * @brief record the events of this stream in the xrun flight recorder
+     * @param c the channel to record to, NULL to stop recording
+     */
+    void setFlightRecorderChannel(Util::FlightRecorder::Channel *c) {m_flight_channel = c;};
+    Util::FlightRecorder::Channel *getFlightRecorderChannel() {return m_flight_channel;};
 
 public:
     // debug stuff
@@ -43,8 +43,7 @@
 #include <assert.h>
 
 /* Provide more intuitive access to GCC's branch predition built-ins */
-#define likely(x)   __builtin_expect((x),1)
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
 
 namespace Streaming {
@@ -84,6 +83,8 @@ uint32_t ts_sec = CYCLE_TIMER_GET_SECS(ct_now);
 MotuReceiveStreamProcessor::MotuReceiveStreamProcessor(FFADODevice &parent, unsigned int event_size)
     : StreamProcessor(parent, ePT_Receive)
     , m_event_size( event_size )
+    , m_decode_audio_float( NULL )
+    , m_decode_audio_int24( NULL )
     , mb_head ( 0 )
     , mb_tail ( 0 )
 {
@@ -117,6 +118,26 @@ MotuReceiveStreamProcessor::getNominalFramesPerPacket() {
 bool
 MotuReceiveStreamProcessor::prepareChild() {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Preparing (%p)...\n", this);
+
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_decode_audio_float = kernels.decodePacked24Float;
+    m_decode_audio_int24 = kernels.decodePacked24Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
+    // cache the audio ports and their sample positions for the kernels
+    m_audio_ports.clear();
+    m_audio_positions.clear();
+    for ( PortVectorIterator it = m_Ports.begin();
+          it != m_Ports.end();
+          ++it ) {
+        if((*it)->getPortType() == Port::E_Audio) {
+            MotuAudioPort *p = static_cast<MotuAudioPort *>(*it);
+            m_audio_ports.push_back(p);
+            m_audio_positions.push_back(p->getPosition());
+        }
+    }
+    m_audio_buffers.assign(m_audio_ports.size(), (void *)NULL);
     return true;
 }
 
@@ -266,6 +287,8 @@ bool MotuReceiveStreamProcessor::processReadBlock(char *data,
     if (m_motu_model != Motu::MOTU_MODEL_828MkI)
         decodeMotuCtrlEvents(data, nevents);
 
+    decodeMotuAudioPorts(data, offset, nevents);
+
     for ( PortVectorIterator it = m_Ports.begin();
           it != m_Ports.end();
           ++it ) {
@@ -276,10 +299,7 @@ bool MotuReceiveStreamProcessor::processReadBlock(char *data,
         switch(port->getPortType()) {
 
         case Port::E_Audio:
-            if(decodeMotuEventsToPort(static_cast<MotuAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                debugWarning("Could not decode packet data to port %s\n",(*it)->getName().c_str());
-                no_problem=false;
-            }
+            // already done by decodeMotuAudioPorts()
             break;
         case Port::E_Midi:
              if(decodeMotuMidiEventsToPort(static_cast<MotuMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
@@ -295,72 +315,48 @@ bool MotuReceiveStreamProcessor::processReadBlock(char *data,
     return no_problem;
 }
 
-signed int MotuReceiveStreamProcessor::decodeMotuEventsToPort(MotuAudioPort *p,
-        quadlet_t *data, unsigned int offset, unsigned int nevents)
+/**
+ * @brief decodes the events to all audio ports in one pass
+ *
+ * Disabled ports are decoded into the scratch buffer, which is cheaper
+ * than breaking up the runs of adjacent samples the kernels rely on.
+ *
+ * @param data 
+ * @param offset 
+ * @param nevents 
+ */
+void
+MotuReceiveStreamProcessor::decodeMotuAudioPorts(char *data,
+        unsigned int offset, unsigned int nevents)
 {
-    unsigned int j=0;
-
-    // Use char here since a port's source address won't necessarily be
-    // aligned; use of an unaligned quadlet_t may cause issues on
-    // certain architectures.  Besides, the source (data coming directly
-    // from the MOTU) isn't structured in quadlets anyway; it mainly
-    // consists of packed 24-bit integers.
-
-    unsigned char *src_data;
-    src_data = (unsigned char *)data + p->getPosition();
+    unsigned int nb_ports = m_audio_ports.size();
+    if (nb_ports == 0) return;
+
+    // Offset is in frames, but each port is only a single channel, and
+    // both the int24 and the float port buffers use one quadlet per
+    // sample.
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        MotuAudioPort *p = m_audio_ports[i];
+        if (likely(!p->isDisabled() && p->getBufferAddress())) {
+            assert(nevents + offset <= p->getBufferSize());
+            m_audio_buffers[i] = (quadlet_t *)p->getBufferAddress() + offset;
+        } else {
+            assert(m_scratch_buffer_size_bytes >= nevents * sizeof(quadlet_t));
+            m_audio_buffers[i] = m_scratch_buffer;
+        }
+    }
 
     switch(m_StreamProcessorManager.getAudioDataType()) {
         default:
         case StreamProcessorManager::eADT_Int24:
-            {
-                quadlet_t *buffer=(quadlet_t *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                // Offset is in frames, but each port is only a single
-                // channel, so the number of frames is the same as the
-                // number of quadlets to offset (assuming the port buffer
-                // uses one quadlet per sample, which is the case currently).
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // Decode nsamples
-                    *buffer = (*src_data<<16)+(*(src_data+1)<<8)+*(src_data+2);
-                    // Sign-extend highest bit of 24-bit int.
-                    // This isn't strictly needed since E_Int24 is a 24-bit,
-                    // but doing so shouldn't break anything and makes the data
-                    // easier to deal with during debugging.
-                    if (*src_data & 0x80)
-                        *buffer |= 0xff000000;
-
-                    buffer++;
-                    src_data+=m_event_size;
-                }
-            }
+            m_decode_audio_int24((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
         case StreamProcessorManager::eADT_Float:
-            {
-                const float multiplier = 1.0f / (float)(0x7FFFFF);
-                float *buffer=(float *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // decode max nsamples
-
-                    signed int v = (*src_data<<16)+(*(src_data+1)<<8)+*(src_data+2);
-                    /* Sign-extend highest bit of incoming 24-bit integer */
-                    if (*src_data & 0x80)
-                      v |= 0xff000000;
-                    *buffer = v * multiplier;
-                    buffer++;
-                    src_data+=m_event_size;
-                }
-            }
+            m_decode_audio_float((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
     }
-
-    return 0;
 }
 
 int
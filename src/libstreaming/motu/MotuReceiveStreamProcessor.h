@@ -33,6 +33,7 @@
 
 #include "../generic/StreamProcessor.h"
 #include "../util/cip.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -161,7 +162,7 @@ protected:
 private:
     bool decodePacketPorts(quadlet_t *data, unsigned int nevents, unsigned int dbc);
 
-    int decodeMotuEventsToPort(MotuAudioPort *, quadlet_t *data, unsigned int offset, unsigned int nevents);
+    void decodeMotuAudioPorts(char *data, unsigned int offset, unsigned int nevents);
     int decodeMotuMidiEventsToPort(MotuMidiPort *, quadlet_t *data, unsigned int offset, unsigned int nevents);
     int decodeMotuCtrlEvents(char *data, unsigned int nevents);
 
@@ -171,6 +172,15 @@ private:
      */
     unsigned int m_event_size;
 
+    // the sample conversion kernels, selected at prepare time
+    packed24_decode_func_t m_decode_audio_float;
+    packed24_decode_func_t m_decode_audio_int24;
+
+    // audio port cache, set up by prepareChild()
+    std::vector<MotuAudioPort *> m_audio_ports;
+    std::vector<unsigned int> m_audio_positions; // byte position within an event
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
+
     signed int m_motu_model;
     struct MotuDevControls m_devctrls;
 
@@ -52,8 +52,7 @@
 #endif
 
 /* Provide more intuitive access to GCC's branch predition built-ins */
-#define likely(x)   __builtin_expect((x),1)
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
 namespace Streaming
 {
@@ -70,6 +69,8 @@ static inline uint32_t fullTicksToSph(int64_t timestamp) {
 MotuTransmitStreamProcessor::MotuTransmitStreamProcessor(FFADODevice &parent, unsigned int event_size )
         : StreamProcessor(parent, ePT_Transmit )
         , m_event_size( event_size )
+        , m_encode_audio_float( NULL )
+        , m_encode_audio_int24( NULL )
         , m_motu_model( 0 )
         , m_tx_dbc( 0 )
         , mb_head( 0 )
@@ -564,6 +565,26 @@ unsigned int MotuTransmitStreamProcessor::fillNoDataPacketHeader (
 bool MotuTransmitStreamProcessor::prepareChild()
 {
     debugOutput ( DEBUG_LEVEL_VERBOSE, "Preparing (%p)...\n", this );
+
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_encode_audio_float = kernels.encodePacked24Float;
+    m_encode_audio_int24 = kernels.encodePacked24Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
+    // cache the audio ports and their sample positions for the kernels
+    m_audio_ports.clear();
+    m_audio_positions.clear();
+    for ( PortVectorIterator it = m_Ports.begin();
+          it != m_Ports.end();
+          ++it ) {
+        if((*it)->getPortType() == Port::E_Audio) {
+            MotuAudioPort *p = static_cast<MotuAudioPort *>(*it);
+            m_audio_ports.push_back(p);
+            m_audio_positions.push_back(p->getPosition());
+        }
+    }
+    m_audio_buffers.assign(m_audio_ports.size(), (void *)NULL);
     return true;
 }
 
@@ -587,33 +608,32 @@ bool MotuTransmitStreamProcessor::processWriteBlock(char *data,
         memset(data+4+i*m_event_size, 0x00, 6);
     }
 
+    // Disabled audio ports are sent silence by the kernel
+    encodeMotuAudioPorts(data, offset, nevents);
+
     for ( PortVectorIterator it = m_Ports.begin();
       it != m_Ports.end();
       ++it ) {
-        // If this port is disabled, unconditionally send it silence.
-        if((*it)->isDisabled()) {
-          if (encodeSilencePortToMotuEvents(static_cast<MotuAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-            debugWarning("Could not encode silence for disabled port %s to Motu events\n",(*it)->getName().c_str());
-            // Don't treat this as a fatal error at this point
-          }
-          continue;
-        }
-
         Port *port=(*it);
 
         switch(port->getPortType()) {
 
         case Port::E_Audio:
-            if (encodePortToMotuEvents(static_cast<MotuAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                debugWarning("Could not encode port %s to Motu events\n",(*it)->getName().c_str());
-                no_problem=false;
-            }
+            // already done by encodeMotuAudioPorts()
             break;
         case Port::E_Midi:
-             if (encodePortToMotuMidiEvents(static_cast<MotuMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                 debugWarning("Could not encode port %s to Midi events\n",(*it)->getName().c_str());
-                 no_problem=false;
-             }
+            // If this port is disabled, unconditionally send it silence.
+            if(port->isDisabled()) {
+                if (encodeSilencePortToMotuMidiEvents(static_cast<MotuMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
+                    debugWarning("Could not encode silence for disabled port %s to Midi events\n",(*it)->getName().c_str());
+                    // Don't treat this as a fatal error at this point
+                }
+                break;
+            }
+            if (encodePortToMotuMidiEvents(static_cast<MotuMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
+                debugWarning("Could not encode port %s to Midi events\n",(*it)->getName().c_str());
+                no_problem=false;
+            }
             break;
         default: // ignore
             break;
@@ -654,84 +674,54 @@ MotuTransmitStreamProcessor::transmitSilenceBlock(char *data,
     return no_problem;
 }
 
-int MotuTransmitStreamProcessor::encodePortToMotuEvents(MotuAudioPort *p, quadlet_t *data,
-                       unsigned int offset, unsigned int nevents) {
-// Encodes nevents worth of data from the given port into the given buffer.  The
-// format of the buffer is precisely that which will be sent to the MOTU.
-// The basic idea:
-//   iterate over the ports
-//     * get port buffer address
-//     * loop over events
-//         - pick right sample in event based upon PortInfo
-//         - convert sample from Port format (E_Int24, E_Float, ..) to MOTU
-//           native format
-//
-// We include the ability to start the transfer from the given offset within
-// the port (expressed in frames) so the 'efficient' transfer method can be
-// utilised.
-
-    unsigned int j=0;
-
-    // Use char here since the target address won't necessarily be
-    // aligned; use of an unaligned quadlet_t may cause issues on certain
-    // architectures.  Besides, the target (data going directly to the MOTU)
-    // isn't structured in quadlets anyway; it mainly consists of packed
-    // 24-bit integers.
-    unsigned char *target;
-    target = (unsigned char *)data + p->getPosition();
+/**
+ * @brief encodes all audio ports to the events in one pass
+ *
+ * Encodes nevents worth of data from the port buffers, starting at the
+ * given offset (in frames) within the ports. The format of the buffer
+ * is precisely that which will be sent to the MOTU. Disabled ports are
+ * taken from the zeroed scratch buffer and hence encode to silence.
+ *
+ * @param data 
+ * @param offset 
+ * @param nevents 
+ */
+void
+MotuTransmitStreamProcessor::encodeMotuAudioPorts(char *data,
+        unsigned int offset, unsigned int nevents)
+{
+    unsigned int nb_ports = m_audio_ports.size();
+    if (nb_ports == 0) return;
+
+    // Both the int24 and the float port buffers use one quadlet per
+    // sample.
+    bool need_scratch = false;
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        MotuAudioPort *p = m_audio_ports[i];
+        if (likely(!p->isDisabled() && p->getBufferAddress())) {
+            assert(nevents + offset <= p->getBufferSize());
+            m_audio_buffers[i] = (quadlet_t *)p->getBufferAddress() + offset;
+        } else {
+            m_audio_buffers[i] = m_scratch_buffer;
+            need_scratch = true;
+        }
+    }
+    if (need_scratch) {
+        assert(m_scratch_buffer_size_bytes >= nevents * sizeof(quadlet_t));
+        memset(m_scratch_buffer, 0, nevents * sizeof(quadlet_t));
+    }
 
     switch(m_StreamProcessorManager.getAudioDataType()) {
         default:
         case StreamProcessorManager::eADT_Int24:
-            {
-                quadlet_t *buffer=(quadlet_t *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                // Offset is in frames, but each port is only a single
-                // channel, so the number of frames is the same as the
-                // number of quadlets to offset (assuming the port buffer
-                // uses one quadlet per sample, which is the case currently).
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // Decode nsamples
-                    *target = (*buffer >> 16) & 0xff;
-                    *(target+1) = (*buffer >> 8) & 0xff;
-                    *(target+2) = (*buffer) & 0xff;
-
-                    buffer++;
-                    target+=m_event_size;
-                }
-            }
+            m_encode_audio_int24((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
         case StreamProcessorManager::eADT_Float:
-            {
-                const float multiplier = (float)(0x7FFFFF);
-                float *buffer=(float *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // decode max nsamples
-                    float in = *buffer;
-#if MOTU_CLIP_FLOATS
-                    if (unlikely(in > 1.0)) in = 1.0;
-                    if (unlikely(in < -1.0)) in = -1.0;
-#endif
-                    unsigned int v = lrintf(in * multiplier);
-                    *target = (v >> 16) & 0xff;
-                    *(target+1) = (v >> 8) & 0xff;
-                    *(target+2) = v & 0xff;
-
-                    buffer++;
-                    target+=m_event_size;
-                }
-            }
+            m_encode_audio_float((byte_t *)data, m_event_size, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
     }
-
-    return 0;
 }
 
 int MotuTransmitStreamProcessor::encodeSilencePortToMotuEvents(MotuAudioPort *p, quadlet_t *data,
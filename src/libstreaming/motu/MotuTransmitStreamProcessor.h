@@ -33,6 +33,7 @@
 
 #include "../generic/StreamProcessor.h"
 #include "../util/cip.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -93,8 +94,7 @@ private:
     bool encodePacketPorts(quadlet_t *data, unsigned int nevents,
                            unsigned int dbc);
 
-    int encodePortToMotuEvents(MotuAudioPort *, quadlet_t *data,
-                                unsigned int offset, unsigned int nevents);
+    void encodeMotuAudioPorts(char *data, unsigned int offset, unsigned int nevents);
     int encodeSilencePortToMotuEvents(MotuAudioPort *, quadlet_t *data,
                                 unsigned int offset, unsigned int nevents);
 
@@ -115,6 +115,15 @@ private:
     // explicitly.
     unsigned int m_event_pad_bytes;
 
+    // the sample conversion kernels, selected at prepare time
+    packed24_encode_func_t m_encode_audio_float;
+    packed24_encode_func_t m_encode_audio_int24;
+
+    // audio port cache, set up by prepareChild()
+    std::vector<MotuAudioPort *> m_audio_ports;
+    std::vector<unsigned int> m_audio_positions; // byte position within an event
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
+
     signed int m_motu_model;
 
     // Keep track of transmission data block count
@@ -50,8 +50,7 @@
 #include <assert.h>
 
 /* Provide more intuitive access to GCC's branch predition built-ins */
-#define likely(x)   __builtin_expect((x),1)
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
 
 namespace Streaming {
@@ -65,6 +64,8 @@ RmeReceiveStreamProcessor::RmeReceiveStreamProcessor(FFADODevice &parent,
     , n_hw_tx_buffer_samples ( -1 )
     , m_rme_model( model )
     , m_event_size( event_size )
+    , m_decode_audio_float( NULL )
+    , m_decode_audio_int24( NULL )
     , mb_head ( 0 )
     , mb_tail ( 0 )
 {
@@ -123,6 +124,26 @@ RmeReceiveStreamProcessor::prepareChild() {
     m_data_buffer->setMaxAbsDiff(10000);
     m_Parent.getDeviceManager().getStreamProcessorManager().setMaxDiffTicks(30720);
 
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_decode_audio_float = kernels.decodeQuadlet24Float;
+    m_decode_audio_int24 = kernels.decodeQuadlet24Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
+    // cache the audio ports and their sample positions for the kernels
+    m_audio_ports.clear();
+    m_audio_positions.clear();
+    for ( PortVectorIterator it = m_Ports.begin();
+          it != m_Ports.end();
+          ++it ) {
+        if((*it)->getPortType() == Port::E_Audio) {
+            RmeAudioPort *p = static_cast<RmeAudioPort *>(*it);
+            m_audio_ports.push_back(p);
+            m_audio_positions.push_back(p->getPosition()/4);
+        }
+    }
+    m_audio_buffers.assign(m_audio_ports.size(), (void *)NULL);
+
     return true;
 }
 
@@ -260,6 +281,8 @@ bool RmeReceiveStreamProcessor::processReadBlock(char *data,
 {
     bool no_problem=true;
 
+    decodeRmeAudioPorts(data, offset, nevents);
+
     for ( PortVectorIterator it = m_Ports.begin();
           it != m_Ports.end();
           ++it ) {
@@ -270,10 +293,7 @@ bool RmeReceiveStreamProcessor::processReadBlock(char *data,
         switch(port->getPortType()) {
 
         case Port::E_Audio:
-            if(decodeRmeEventsToPort(static_cast<RmeAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                debugWarning("Could not decode packet data to port %s\n",(*it)->getName().c_str());
-                no_problem=false;
-            }
+            // already done by decodeRmeAudioPorts()
             break;
         case Port::E_Midi:
              if(decodeRmeMidiEventsToPort(static_cast<RmeMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
@@ -289,69 +309,45 @@ bool RmeReceiveStreamProcessor::processReadBlock(char *data,
     return no_problem;
 }
 
-signed int RmeReceiveStreamProcessor::decodeRmeEventsToPort(RmeAudioPort *p,
-        quadlet_t *data, unsigned int offset, unsigned int nevents)
+/**
+ * @brief decodes the events to all audio ports in one pass
+ *
+ * Disabled ports are decoded into the scratch buffer, which is cheaper
+ * than breaking up the runs of adjacent samples the kernels rely on.
+ *
+ * @param data 
+ * @param offset 
+ * @param nevents 
+ */
+void
+RmeReceiveStreamProcessor::decodeRmeAudioPorts(char *data,
+        unsigned int offset, unsigned int nevents)
 {
-    unsigned int j=0;
-
-    // For RME interfaces the audio data is contained in the most significant
-    // 24 bits of a 32-bit field.  Thus it makes sense to treat the source
-    // data as 32 bit and simply mask/shift as necessary to isolate the
-    // audio data.
-    quadlet_t *src_data;
-    src_data = data + p->getPosition()/4;
+    unsigned int nb_ports = m_audio_ports.size();
+    if (nb_ports == 0) return;
+
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        RmeAudioPort *p = m_audio_ports[i];
+        if (likely(!p->isDisabled() && p->getBufferAddress())) {
+            assert(nevents + offset <= p->getBufferSize());
+            m_audio_buffers[i] = (quadlet_t *)p->getBufferAddress() + offset;
+        } else {
+            assert(m_scratch_buffer_size_bytes >= nevents * sizeof(quadlet_t));
+            m_audio_buffers[i] = m_scratch_buffer;
+        }
+    }
 
     switch(m_StreamProcessorManager.getAudioDataType()) {
         default:
         case StreamProcessorManager::eADT_Int24:
-            {
-                quadlet_t *buffer=(quadlet_t *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                // Offset is in frames, but each port is only a single
-                // channel, so the number of frames is the same as the
-                // number of quadlets to offset (assuming the port buffer
-                // uses one quadlet per sample, which is the case currently).
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // Decode nsamples
-                    *buffer = (*src_data >> 8) & 0x00ffffff;
-                    // Sign-extend highest bit of 24-bit int.  This isn't
-                    // strictly needed since E_Int24 is a 24-bit, but doing
-                    // so shouldn't break anything and makes the data easier
-                    // to deal with during debugging.
-                    if (*src_data & 0x80000000)
-                        *buffer |= 0xff000000;
-
-                    buffer++;
-                    src_data+=m_event_size/4;
-                }
-            }
+            m_decode_audio_int24((quadlet_t *)data, m_event_size/4, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
         case StreamProcessorManager::eADT_Float:
-            {
-                const float multiplier = 1.0f / (float)(0x7FFFFF);
-                float *buffer=(float *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // decode max nsamples
-                    signed int v = (*src_data >> 8) & 0x00ffffff;
-                    /* Sign-extend highest bit of incoming 24-bit integer */
-                    if (*src_data & 0x80000000)
-                      v |= 0xff000000;
-                    *buffer = v * multiplier;
-                    buffer++;
-                    src_data+=m_event_size/4;
-                }
-            }
+            m_decode_audio_float((quadlet_t *)data, m_event_size/4, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
     }
-
-    return 0;
 }
 
 int
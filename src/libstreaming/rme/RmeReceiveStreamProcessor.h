@@ -33,6 +33,7 @@
 
 #include "../generic/StreamProcessor.h"
 #include "../util/cip.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -83,7 +84,7 @@ protected:
 private:
     bool decodePacketPorts(quadlet_t *data, unsigned int nevents, unsigned int dbc);
 
-    int decodeRmeEventsToPort(RmeAudioPort *, quadlet_t *data, unsigned int offset, unsigned int nevents);
+    void decodeRmeAudioPorts(char *data, unsigned int offset, unsigned int nevents);
     int decodeRmeMidiEventsToPort(RmeMidiPort *, quadlet_t *data, unsigned int offset, unsigned int nevents);
 
     unsigned int m_rme_model;
@@ -93,6 +94,15 @@ private:
      */
     unsigned int m_event_size;
 
+    // the sample conversion kernels, selected at prepare time
+    quadlet24_decode_func_t m_decode_audio_float;
+    quadlet24_decode_func_t m_decode_audio_int24;
+
+    // audio port cache, set up by prepareChild()
+    std::vector<RmeAudioPort *> m_audio_ports;
+    std::vector<unsigned int> m_audio_positions; // quadlet position within an event
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
+
     /* A small MIDI buffer to cover for the case where we need to span a
      * period - that is, if more than one MIDI byte is sent per packet. 
      * Since the long-term average data rate must be close to the MIDI spec
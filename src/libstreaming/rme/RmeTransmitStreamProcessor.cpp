@@ -58,8 +58,7 @@
 #endif
 
 /* Provide more intuitive access to GCC's branch predition built-ins */
-#define likely(x)   __builtin_expect((x),1)
-#define unlikely(x) __builtin_expect((x),0)
+#include "libutil/Likely.h"
 
 namespace Streaming
 {
@@ -73,6 +72,8 @@ RmeTransmitStreamProcessor::RmeTransmitStreamProcessor(FFADODevice &parent,
         : StreamProcessor(parent, ePT_Transmit )
         , m_rme_model( model)
         , m_event_size( event_size )
+        , m_encode_audio_float( NULL )
+        , m_encode_audio_int24( NULL )
         , m_tx_dbc( 0 )
         , mb_head( 0 )
         , mb_tail( 0 )
@@ -549,6 +550,26 @@ bool RmeTransmitStreamProcessor::prepareChild()
 
 // Unsure whether this helps yet.  Testing continues.
 m_dll_bandwidth_hz = 1.0; // 0.1;
+    const struct AudioKernels &kernels =
+        getAudioKernels(m_StreamProcessorManager.getSimdLevel());
+    m_encode_audio_float = kernels.encodeQuadlet24Float;
+    m_encode_audio_int24 = kernels.encodeQuadlet24Int24;
+    debugOutput ( DEBUG_LEVEL_VERBOSE, " Sample conversion kernels      : %s\n", kernels.name );
+
+    // cache the audio ports and their sample positions for the kernels
+    m_audio_ports.clear();
+    m_audio_positions.clear();
+    for ( PortVectorIterator it = m_Ports.begin();
+          it != m_Ports.end();
+          ++it ) {
+        if((*it)->getPortType() == Port::E_Audio) {
+            RmeAudioPort *p = static_cast<RmeAudioPort *>(*it);
+            m_audio_ports.push_back(p);
+            m_audio_positions.push_back(p->getPosition()/4);
+        }
+    }
+    m_audio_buffers.assign(m_audio_ports.size(), (void *)NULL);
+
     return true;
 }
 
@@ -559,12 +580,16 @@ bool RmeTransmitStreamProcessor::processWriteBlock(char *data,
                        unsigned int nevents, unsigned int offset) {
     bool no_problem=true;
 
+    // Disabled audio ports are sent silence by the kernel
+    encodeRmeAudioPorts(data, offset, nevents);
+
     for ( PortVectorIterator it = m_Ports.begin();
       it != m_Ports.end();
       ++it ) {
         // If this port is disabled, unconditionally send it silence.
         if((*it)->isDisabled()) {
-          if (encodeSilencePortToRmeEvents(static_cast<RmeAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
+          if ((*it)->getPortType() != Port::E_Audio &&
+              encodeSilencePortToRmeEvents(static_cast<RmeAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
             debugWarning("Could not encode silence for disabled port %s to Rme events\n",(*it)->getName().c_str());
             // Don't treat this as a fatal error at this point
           }
@@ -576,10 +601,7 @@ bool RmeTransmitStreamProcessor::processWriteBlock(char *data,
         switch(port->getPortType()) {
 
         case Port::E_Audio:
-            if (encodePortToRmeEvents(static_cast<RmeAudioPort *>(*it), (quadlet_t *)data, offset, nevents)) {
-                debugWarning("Could not encode port %s to Rme events\n",(*it)->getName().c_str());
-                no_problem=false;
-            }
+            // already done by encodeRmeAudioPorts()
             break;
         case Port::E_Midi:
              if (encodePortToRmeMidiEvents(static_cast<RmeMidiPort *>(*it), (quadlet_t *)data, offset, nevents)) {
@@ -626,73 +648,51 @@ RmeTransmitStreamProcessor::transmitSilenceBlock(char *data,
     return no_problem;
 }
 
-int RmeTransmitStreamProcessor::encodePortToRmeEvents(RmeAudioPort *p, quadlet_t *data,
-                       unsigned int offset, unsigned int nevents) {
-// Encodes nevents worth of data from the given port into the given buffer.  The
-// format of the buffer is precisely that which will be sent to the RME.
-// The basic idea:
-//   iterate over the ports
-//     * get port buffer address
-//     * loop over events
-//         - pick right sample in event based upon PortInfo
-//         - convert sample from Port format (E_Int24, E_Float, ..) to RME
-//           native format
-//
-// We include the ability to start the transfer from the given offset within
-// the port (expressed in frames) so the 'efficient' transfer method can be
-// utilised.
-
-    unsigned int j=0;
-
-    quadlet_t *target;
-    target = data + p->getPosition()/4;
+/**
+ * @brief encodes all audio ports to the events in one pass
+ *
+ * Encodes nevents worth of data from the port buffers, starting at the
+ * given offset (in frames) within the ports. Disabled ports are taken
+ * from the zeroed scratch buffer and hence encode to silence.
+ *
+ * @param data 
+ * @param offset 
+ * @param nevents 
+ */
+void
+RmeTransmitStreamProcessor::encodeRmeAudioPorts(char *data,
+        unsigned int offset, unsigned int nevents)
+{
+    unsigned int nb_ports = m_audio_ports.size();
+    if (nb_ports == 0) return;
+
+    bool need_scratch = false;
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        RmeAudioPort *p = m_audio_ports[i];
+        if (likely(!p->isDisabled() && p->getBufferAddress())) {
+            assert(nevents + offset <= p->getBufferSize());
+            m_audio_buffers[i] = (quadlet_t *)p->getBufferAddress() + offset;
+        } else {
+            m_audio_buffers[i] = m_scratch_buffer;
+            need_scratch = true;
+        }
+    }
+    if (need_scratch) {
+        assert(m_scratch_buffer_size_bytes >= nevents * sizeof(quadlet_t));
+        memset(m_scratch_buffer, 0, nevents * sizeof(quadlet_t));
+    }
 
     switch(m_StreamProcessorManager.getAudioDataType()) {
         default:
         case StreamProcessorManager::eADT_Int24:
-            {
-                quadlet_t *buffer=(quadlet_t *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                // Offset is in frames, but each port is only a single
-                // channel, so the number of frames is the same as the
-                // number of quadlets to offset (assuming the port buffer
-                // uses one quadlet per sample, which is the case currently).
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // Decode nsamples
-                    *target = (*buffer & 0x00ffffff) << 8;
-                    buffer++;
-                    target+=m_event_size/4;
-                }
-            }
+            m_encode_audio_int24((quadlet_t *)data, m_event_size/4, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
         case StreamProcessorManager::eADT_Float:
-            {
-                const float multiplier = (float)(0x7FFFFF);
-                float *buffer=(float *)(p->getBufferAddress());
-
-                assert(nevents + offset <= p->getBufferSize());
-
-                buffer+=offset;
-
-                for(j = 0; j < nevents; j += 1) { // decode max nsamples
-                    float in = *buffer;
-#if RME_CLIP_FLOATS
-                    if (unlikely(in > 1.0)) in = 1.0;
-                    if (unlikely(in < -1.0)) in = -1.0;
-#endif
-                    unsigned int v = lrintf(in * multiplier);
-                    *target = (v << 8);
-                    buffer++;
-                    target+=m_event_size/4;
-                }
-            }
+            m_encode_audio_float((quadlet_t *)data, m_event_size/4, &m_audio_positions[0],
+                                 &m_audio_buffers[0], nb_ports, nevents);
             break;
     }
-
-    return 0;
 }
 
 int RmeTransmitStreamProcessor::encodeSilencePortToRmeEvents(RmeAudioPort *p, quadlet_t *data,
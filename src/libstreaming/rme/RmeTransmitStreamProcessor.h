@@ -33,6 +33,7 @@
 
 #include "../generic/StreamProcessor.h"
 #include "../util/cip.h"
+#include "../util/AudioKernels.h"
 
 namespace Streaming {
 
@@ -96,8 +97,7 @@ private:
     bool encodePacketPorts(quadlet_t *data, unsigned int nevents,
                            unsigned int dbc);
 
-    int encodePortToRmeEvents(RmeAudioPort *, quadlet_t *data,
-                                unsigned int offset, unsigned int nevents);
+    void encodeRmeAudioPorts(char *data, unsigned int offset, unsigned int nevents);
     int encodeSilencePortToRmeEvents(RmeAudioPort *, quadlet_t *data,
                                 unsigned int offset, unsigned int nevents);
 
@@ -116,6 +116,15 @@ private:
      */
     unsigned int m_event_size;
 
+    // the sample conversion kernels, selected at prepare time
+    quadlet24_encode_func_t m_encode_audio_float;
+    quadlet24_encode_func_t m_encode_audio_int24;
+
+    // audio port cache, set up by prepareChild()
+    std::vector<RmeAudioPort *> m_audio_ports;
+    std::vector<unsigned int> m_audio_positions; // quadlet position within an event
+    std::vector<void *> m_audio_buffers; // kernel arguments, one per audio port
+
     // Keep track of transmission data block count
     unsigned int m_tx_dbc;
 
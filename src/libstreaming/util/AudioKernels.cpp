@@ -0,0 +1,2123 @@
+/*
+ * Copyright (C) 2014 by FFADO developers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "AudioKernels.h"
+
+#include "libutil/ByteSwap.h"
+#include "libutil/float_cast.h"
+
+#if FFADO_HAVE_X86_SIMD_DISPATCH
+#include <immintrin.h>
+#endif
+
+#include "libutil/Likely.h"
+
+#define AM824_FLOAT_MULTIPLIER (1.0f * ((1<<23) - 1))
+#define AM824_FLOAT_RECIPROCAL (1.0f / (float)(0x7FFFFF))
+#define AM824_MBLA_LABEL       0x40000000
+#define AM824_MBLA_MASK        0x00FFFFFF
+
+#define PACKED24_FLOAT_MULTIPLIER ((float)(0x7FFFFF))
+#define PACKED24_FLOAT_RECIPROCAL (1.0f / (float)(0x7FFFFF))
+// the packed 24-bit kernels serve both the MOTU and the Digidesign devices
+#define PACKED24_CLIP_FLOATS      (MOTU_CLIP_FLOATS || DIGIDESIGN_CLIP_FLOATS)
+
+#define QUADLET24_FLOAT_MULTIPLIER ((float)(0x7FFFFF))
+#define QUADLET24_FLOAT_RECIPROCAL (1.0f / (float)(0x7FFFFF))
+
+namespace Streaming {
+
+/*
+ * The kernels below all produce bit-identical output. The SIMD versions
+ * work on square blocks of W ports by W events: each port buffer provides
+ * one vector of W consecutive samples, the W vectors are converted
+ * in-register, transposed and stored as W partial events. Events that
+ * don't fill a complete block are gathered one event at a time, ports
+ * that don't fill a complete group are handed down to the next narrower
+ * kernel. The decoders do the same in the opposite direction.
+ */
+
+// -- scalar -- //
+
+static inline quadlet_t
+encodeAM824FloatSample(float v)
+{
+#if AMDTP_CLIP_FLOATS
+    // clip directly to the value of a maxed event
+    if(unlikely(v > 1.0)) {
+        return CONDSWAPTOBUS32_CONST(0x407FFFFF);
+    } else if(unlikely(v < -1.0)) {
+        return CONDSWAPTOBUS32_CONST(0x40800001);
+    }
+#endif
+    v *= AM824_FLOAT_MULTIPLIER;
+    unsigned int tmp = ((int) v);
+    tmp = ( tmp & AM824_MBLA_MASK ) | AM824_MBLA_LABEL;
+    return CondSwapToBus32((quadlet_t)tmp);
+}
+
+static inline quadlet_t
+encodeAM824Int24Sample(uint32_t v)
+{
+    return CondSwapToBus32((quadlet_t)((v & AM824_MBLA_MASK) | AM824_MBLA_LABEL));
+}
+
+template <bool is_float>
+static void
+encodeAM824Scalar(quadlet_t *data, unsigned int dimension,
+                  void * const *buffers, unsigned int nb_ports,
+                  unsigned int nevents)
+{
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        quadlet_t *target_event = data + i;
+        if (is_float) {
+            const float *buffer = (const float *)buffers[i];
+            for (unsigned int j = 0; j < nevents; j++) {
+                *target_event = encodeAM824FloatSample(*buffer);
+                buffer++;
+                target_event += dimension;
+            }
+        } else {
+            const uint32_t *buffer = (const uint32_t *)buffers[i];
+            for (unsigned int j = 0; j < nevents; j++) {
+                *target_event = encodeAM824Int24Sample(*buffer);
+                buffer++;
+                target_event += dimension;
+            }
+        }
+    }
+}
+
+static inline uint32_t
+decodeAM824Int24Sample(quadlet_t v)
+{
+    return CondSwapFromBus32(v) & AM824_MBLA_MASK;
+}
+
+static inline float
+decodeAM824FloatSample(quadlet_t v)
+{
+    unsigned int tmp = CondSwapFromBus32(v) & AM824_MBLA_MASK;
+    // sign-extend highest bit of 24-bit int
+    int sample = (int)(tmp << 8) / 256;
+    return sample * AM824_FLOAT_RECIPROCAL;
+}
+
+template <bool is_float>
+static void
+decodeAM824Scalar(const quadlet_t *data, unsigned int dimension,
+                  void * const *buffers, unsigned int nb_ports,
+                  unsigned int nevents)
+{
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        const quadlet_t *source_event = data + i;
+        if (is_float) {
+            float *buffer = (float *)buffers[i];
+            for (unsigned int j = 0; j < nevents; j++) {
+                *buffer = decodeAM824FloatSample(*source_event);
+                buffer++;
+                source_event += dimension;
+            }
+        } else {
+            uint32_t *buffer = (uint32_t *)buffers[i];
+            for (unsigned int j = 0; j < nevents; j++) {
+                *buffer = decodeAM824Int24Sample(*source_event);
+                buffer++;
+                source_event += dimension;
+            }
+        }
+    }
+}
+
+// -- packed 24-bit, scalar -- //
+
+static inline int32_t
+decodePacked24Sample(const byte_t *src)
+{
+    // sign-extend highest bit of 24-bit int
+    return (int32_t)(((uint32_t)src[0] << 24) | (src[1] << 16) | (src[2] << 8)) >> 8;
+}
+
+static inline void
+encodePacked24Sample(byte_t *target, uint32_t v)
+{
+    target[0] = (v >> 16) & 0xff;
+    target[1] = (v >> 8) & 0xff;
+    target[2] = v & 0xff;
+}
+
+static inline uint32_t
+packed24FromFloat(float v)
+{
+#if PACKED24_CLIP_FLOATS
+    if (unlikely(v > 1.0)) v = 1.0;
+    if (unlikely(v < -1.0)) v = -1.0;
+#endif
+    return lrintf(v * PACKED24_FLOAT_MULTIPLIER);
+}
+
+// decodes the events [first, nevents) of one port
+template <bool is_float>
+static inline void
+decodePacked24Port(const byte_t *src, unsigned int event_size, void *buffer,
+                   unsigned int first, unsigned int nevents)
+{
+    src += first * event_size;
+    for (unsigned int j = first; j < nevents; j++) {
+        int32_t v = decodePacked24Sample(src);
+        if (is_float) {
+            ((float *)buffer)[j] = v * PACKED24_FLOAT_RECIPROCAL;
+        } else {
+            ((int32_t *)buffer)[j] = v;
+        }
+        src += event_size;
+    }
+}
+
+// encodes the events [first, nevents) of one port
+template <bool is_float>
+static inline void
+encodePacked24Port(byte_t *target, unsigned int event_size, void * const buffer,
+                   unsigned int first, unsigned int nevents)
+{
+    target += first * event_size;
+    for (unsigned int j = first; j < nevents; j++) {
+        if (is_float) {
+            encodePacked24Sample(target, packed24FromFloat(((const float *)buffer)[j]));
+        } else {
+            encodePacked24Sample(target, ((const uint32_t *)buffer)[j]);
+        }
+        target += event_size;
+    }
+}
+
+template <bool is_float>
+static void
+decodePacked24Scalar(const byte_t *data, unsigned int event_size,
+                     const unsigned int *positions, void * const *buffers,
+                     unsigned int nb_ports, unsigned int nevents)
+{
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        decodePacked24Port<is_float>(data + positions[i], event_size, buffers[i], 0, nevents);
+    }
+}
+
+template <bool is_float>
+static void
+encodePacked24Scalar(byte_t *data, unsigned int event_size,
+                     const unsigned int *positions, void * const *buffers,
+                     unsigned int nb_ports, unsigned int nevents)
+{
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        encodePacked24Port<is_float>(data + positions[i], event_size, buffers[i], 0, nevents);
+    }
+}
+
+// -- quadlet 24-bit, scalar -- //
+
+// decodes the events [first, nevents) of one port
+template <bool is_float>
+static inline void
+decodeQuadlet24Port(const quadlet_t *src, unsigned int dimension, void *buffer,
+                    unsigned int first, unsigned int nevents)
+{
+    src += first * dimension;
+    for (unsigned int j = first; j < nevents; j++) {
+        // the sample is in the most significant 24 bits
+        int32_t v = (int32_t)*src >> 8;
+        if (is_float) {
+            ((float *)buffer)[j] = v * QUADLET24_FLOAT_RECIPROCAL;
+        } else {
+            ((int32_t *)buffer)[j] = v;
+        }
+        src += dimension;
+    }
+}
+
+// encodes the events [first, nevents) of one port
+template <bool is_float>
+static inline void
+encodeQuadlet24Port(quadlet_t *target, unsigned int dimension, void * const buffer,
+                    unsigned int first, unsigned int nevents)
+{
+    target += first * dimension;
+    for (unsigned int j = first; j < nevents; j++) {
+        uint32_t v;
+        if (is_float) {
+            float in = ((const float *)buffer)[j];
+#if RME_CLIP_FLOATS
+            if (unlikely(in > 1.0)) in = 1.0;
+            if (unlikely(in < -1.0)) in = -1.0;
+#endif
+            v = lrintf(in * QUADLET24_FLOAT_MULTIPLIER);
+        } else {
+            v = ((const uint32_t *)buffer)[j];
+        }
+        *target = v << 8;
+        target += dimension;
+    }
+}
+
+template <bool is_float>
+static void
+decodeQuadlet24Scalar(const quadlet_t *data, unsigned int dimension,
+                      const unsigned int *positions, void * const *buffers,
+                      unsigned int nb_ports, unsigned int nevents)
+{
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        decodeQuadlet24Port<is_float>(data + positions[i], dimension, buffers[i], 0, nevents);
+    }
+}
+
+template <bool is_float>
+static void
+encodeQuadlet24Scalar(quadlet_t *data, unsigned int dimension,
+                      const unsigned int *positions, void * const *buffers,
+                      unsigned int nb_ports, unsigned int nevents)
+{
+    for (unsigned int i = 0; i < nb_ports; i++) {
+        encodeQuadlet24Port<is_float>(data + positions[i], dimension, buffers[i], 0, nevents);
+    }
+}
+
+#if FFADO_HAVE_X86_SIMD_DISPATCH
+
+#define FFADO_TARGET_SSE2   __attribute__((target("sse2")))
+#define FFADO_TARGET_AVX2   __attribute__((target("avx2")))
+#define FFADO_TARGET_AVX512 __attribute__((target("avx512f,avx512bw")))
+
+/*
+ * The kernels for the formats with per-port sample positions only use
+ * vectors for runs of ports that are adjacent in the event; other ports
+ * are converted one by one.
+ */
+
+// true if the first 'width' ports are adjacent samples of 'step' units
+static inline bool
+isPortRun(const unsigned int *positions, unsigned int nb_ports,
+          unsigned int width, unsigned int step)
+{
+    if (nb_ports < width) return false;
+    for (unsigned int k = 1; k < width; k++) {
+        if (positions[k] != positions[0] + step * k) return false;
+    }
+    return true;
+}
+
+// the number of leading events for which a vector load of 'width' units
+// at 'pos' stays within the data of the nevents events
+static inline unsigned int
+vectorLoadEvents(unsigned int pos, unsigned int width,
+                 unsigned int event_size, unsigned int nevents)
+{
+    if (pos + width <= event_size) return nevents;
+    if (nevents == 0 || pos + width > 2 * event_size) return 0;
+    return nevents - 1;
+}
+
+// -- SSE2: 4 ports x 4 events -- //
+
+// transposes 4 rows of 4 quadlets in place
+#define TRANSPOSE4X4_SSE2(r0, r1, r2, r3) \
+    { \
+        __m128i t0 = _mm_unpacklo_epi32(r0, r1); \
+        __m128i t1 = _mm_unpackhi_epi32(r0, r1); \
+        __m128i t2 = _mm_unpacklo_epi32(r2, r3); \
+        __m128i t3 = _mm_unpackhi_epi32(r2, r3); \
+        r0 = _mm_unpacklo_epi64(t0, t2); \
+        r1 = _mm_unpackhi_epi64(t0, t2); \
+        r2 = _mm_unpacklo_epi64(t1, t3); \
+        r3 = _mm_unpackhi_epi64(t1, t3); \
+    }
+
+static inline FFADO_TARGET_SSE2 __m128i
+byteSwapSSE2(__m128i v)
+{
+    // first the bytes within the 16-bit words, then the words
+    v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+    return _mm_or_si128(_mm_slli_epi32(v, 16), _mm_srli_epi32(v, 16));
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_SSE2 __m128i
+encodeAM824SSE2Vector(__m128i v)
+{
+    if (is_float) {
+        __m128 v_float = _mm_castsi128_ps(v);
+#if AMDTP_CLIP_FLOATS
+        v_float = _mm_max_ps(v_float, _mm_set1_ps(-1.0f));
+        v_float = _mm_min_ps(v_float, _mm_set1_ps(1.0f));
+#endif
+        v_float = _mm_mul_ps(v_float, _mm_set1_ps(AM824_FLOAT_MULTIPLIER));
+        v = _mm_cvttps_epi32(v_float);
+    }
+    v = _mm_and_si128(v, _mm_set1_epi32(AM824_MBLA_MASK));
+    v = _mm_or_si128(v, _mm_set1_epi32(AM824_MBLA_LABEL));
+    return byteSwapSSE2(v);
+}
+
+template <bool is_float>
+static FFADO_TARGET_SSE2 void
+encodeAM824SSE2(quadlet_t *data, unsigned int dimension,
+                void * const *buffers, unsigned int nb_ports,
+                unsigned int nevents)
+{
+    unsigned int i = 0;
+    for (; i + 4 <= nb_ports; i += 4) {
+        const uint32_t *src0 = (const uint32_t *)buffers[i];
+        const uint32_t *src1 = (const uint32_t *)buffers[i+1];
+        const uint32_t *src2 = (const uint32_t *)buffers[i+2];
+        const uint32_t *src3 = (const uint32_t *)buffers[i+3];
+        quadlet_t *target = data + i;
+
+        unsigned int j = 0;
+        for (; j + 4 <= nevents; j += 4) {
+            __m128i r0 = encodeAM824SSE2Vector<is_float>(_mm_loadu_si128((const __m128i *)(src0 + j)));
+            __m128i r1 = encodeAM824SSE2Vector<is_float>(_mm_loadu_si128((const __m128i *)(src1 + j)));
+            __m128i r2 = encodeAM824SSE2Vector<is_float>(_mm_loadu_si128((const __m128i *)(src2 + j)));
+            __m128i r3 = encodeAM824SSE2Vector<is_float>(_mm_loadu_si128((const __m128i *)(src3 + j)));
+
+            // transpose from port-major to event-major
+            TRANSPOSE4X4_SSE2(r0, r1, r2, r3);
+
+            quadlet_t *t = target + j * dimension;
+            _mm_storeu_si128((__m128i *)t, r0); t += dimension;
+            _mm_storeu_si128((__m128i *)t, r1); t += dimension;
+            _mm_storeu_si128((__m128i *)t, r2); t += dimension;
+            _mm_storeu_si128((__m128i *)t, r3);
+        }
+        for (; j < nevents; j++) {
+            __m128i v = _mm_set_epi32(src3[j], src2[j], src1[j], src0[j]);
+            _mm_storeu_si128((__m128i *)(target + j * dimension),
+                             encodeAM824SSE2Vector<is_float>(v));
+        }
+    }
+    if (i < nb_ports) {
+        encodeAM824Scalar<is_float>(data + i, dimension, buffers + i, nb_ports - i, nevents);
+    }
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_SSE2 __m128i
+decodeAM824SSE2Vector(__m128i v)
+{
+    v = byteSwapSSE2(v);
+    if (is_float) {
+        // sign-extend the 24-bit sample, this drops the label
+        v = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+        __m128 v_float = _mm_mul_ps(_mm_cvtepi32_ps(v),
+                                    _mm_set1_ps(AM824_FLOAT_RECIPROCAL));
+        return _mm_castps_si128(v_float);
+    } else {
+        return _mm_and_si128(v, _mm_set1_epi32(AM824_MBLA_MASK));
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_SSE2 void
+decodeAM824SSE2(const quadlet_t *data, unsigned int dimension,
+                void * const *buffers, unsigned int nb_ports,
+                unsigned int nevents)
+{
+    unsigned int i = 0;
+    for (; i + 4 <= nb_ports; i += 4) {
+        uint32_t *dst0 = (uint32_t *)buffers[i];
+        uint32_t *dst1 = (uint32_t *)buffers[i+1];
+        uint32_t *dst2 = (uint32_t *)buffers[i+2];
+        uint32_t *dst3 = (uint32_t *)buffers[i+3];
+        const quadlet_t *source = data + i;
+
+        unsigned int j = 0;
+        for (; j + 4 <= nevents; j += 4) {
+            const quadlet_t *s = source + j * dimension;
+            __m128i r0 = _mm_loadu_si128((const __m128i *)s); s += dimension;
+            __m128i r1 = _mm_loadu_si128((const __m128i *)s); s += dimension;
+            __m128i r2 = _mm_loadu_si128((const __m128i *)s); s += dimension;
+            __m128i r3 = _mm_loadu_si128((const __m128i *)s);
+
+            // transpose from event-major to port-major
+            TRANSPOSE4X4_SSE2(r0, r1, r2, r3);
+
+            _mm_storeu_si128((__m128i *)(dst0 + j), decodeAM824SSE2Vector<is_float>(r0));
+            _mm_storeu_si128((__m128i *)(dst1 + j), decodeAM824SSE2Vector<is_float>(r1));
+            _mm_storeu_si128((__m128i *)(dst2 + j), decodeAM824SSE2Vector<is_float>(r2));
+            _mm_storeu_si128((__m128i *)(dst3 + j), decodeAM824SSE2Vector<is_float>(r3));
+        }
+        for (; j < nevents; j++) {
+            uint32_t tmp[4];
+            __m128i v = _mm_loadu_si128((const __m128i *)(source + j * dimension));
+            _mm_storeu_si128((__m128i *)tmp, decodeAM824SSE2Vector<is_float>(v));
+            dst0[j] = tmp[0];
+            dst1[j] = tmp[1];
+            dst2[j] = tmp[2];
+            dst3[j] = tmp[3];
+        }
+    }
+    if (i < nb_ports) {
+        decodeAM824Scalar<is_float>(data + i, dimension, buffers + i, nb_ports - i, nevents);
+    }
+}
+
+// -- AVX2: 8 ports x 8 events -- //
+
+static inline FFADO_TARGET_AVX2 __m256i
+byteSwapAVX2(__m256i v)
+{
+    const __m256i swap = _mm256_set_epi8(12, 13, 14, 15,  8,  9, 10, 11,
+                                          4,  5,  6,  7,  0,  1,  2,  3,
+                                         12, 13, 14, 15,  8,  9, 10, 11,
+                                          4,  5,  6,  7,  0,  1,  2,  3);
+    return _mm256_shuffle_epi8(v, swap);
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX2 __m256i
+encodeAM824AVX2Vector(__m256i v)
+{
+    if (is_float) {
+        __m256 v_float = _mm256_castsi256_ps(v);
+#if AMDTP_CLIP_FLOATS
+        v_float = _mm256_max_ps(v_float, _mm256_set1_ps(-1.0f));
+        v_float = _mm256_min_ps(v_float, _mm256_set1_ps(1.0f));
+#endif
+        v_float = _mm256_mul_ps(v_float, _mm256_set1_ps(AM824_FLOAT_MULTIPLIER));
+        v = _mm256_cvttps_epi32(v_float);
+    }
+    v = _mm256_and_si256(v, _mm256_set1_epi32(AM824_MBLA_MASK));
+    v = _mm256_or_si256(v, _mm256_set1_epi32(AM824_MBLA_LABEL));
+    return byteSwapAVX2(v);
+}
+
+// transposes 8 rows of 8 quadlets in place. This is written out
+// rather than using arrays and loops, since GCC tends to keep such arrays
+// on the stack.
+#define TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7) \
+    { \
+        __m256i t0 = _mm256_unpacklo_epi32(r0, r1); \
+        __m256i t1 = _mm256_unpackhi_epi32(r0, r1); \
+        __m256i t2 = _mm256_unpacklo_epi32(r2, r3); \
+        __m256i t3 = _mm256_unpackhi_epi32(r2, r3); \
+        __m256i t4 = _mm256_unpacklo_epi32(r4, r5); \
+        __m256i t5 = _mm256_unpackhi_epi32(r4, r5); \
+        __m256i t6 = _mm256_unpacklo_epi32(r6, r7); \
+        __m256i t7 = _mm256_unpackhi_epi32(r6, r7); \
+        __m256i u0 = _mm256_unpacklo_epi64(t0, t2); \
+        __m256i u1 = _mm256_unpackhi_epi64(t0, t2); \
+        __m256i u2 = _mm256_unpacklo_epi64(t1, t3); \
+        __m256i u3 = _mm256_unpackhi_epi64(t1, t3); \
+        __m256i u4 = _mm256_unpacklo_epi64(t4, t6); \
+        __m256i u5 = _mm256_unpackhi_epi64(t4, t6); \
+        __m256i u6 = _mm256_unpacklo_epi64(t5, t7); \
+        __m256i u7 = _mm256_unpackhi_epi64(t5, t7); \
+        r0 = _mm256_permute2x128_si256(u0, u4, 0x20); \
+        r1 = _mm256_permute2x128_si256(u1, u5, 0x20); \
+        r2 = _mm256_permute2x128_si256(u2, u6, 0x20); \
+        r3 = _mm256_permute2x128_si256(u3, u7, 0x20); \
+        r4 = _mm256_permute2x128_si256(u0, u4, 0x31); \
+        r5 = _mm256_permute2x128_si256(u1, u5, 0x31); \
+        r6 = _mm256_permute2x128_si256(u2, u6, 0x31); \
+        r7 = _mm256_permute2x128_si256(u3, u7, 0x31); \
+    }
+
+#define ENCODE_AM824_AVX2_LOAD(k) \
+    encodeAM824AVX2Vector<is_float>(_mm256_loadu_si256((const __m256i *)(src##k + j)))
+
+template <bool is_float>
+static FFADO_TARGET_AVX2 void
+encodeAM824AVX2(quadlet_t *data, unsigned int dimension,
+                void * const *buffers, unsigned int nb_ports,
+                unsigned int nevents)
+{
+    unsigned int i = 0;
+    for (; i + 8 <= nb_ports; i += 8) {
+        const uint32_t *src0 = (const uint32_t *)buffers[i];
+        const uint32_t *src1 = (const uint32_t *)buffers[i+1];
+        const uint32_t *src2 = (const uint32_t *)buffers[i+2];
+        const uint32_t *src3 = (const uint32_t *)buffers[i+3];
+        const uint32_t *src4 = (const uint32_t *)buffers[i+4];
+        const uint32_t *src5 = (const uint32_t *)buffers[i+5];
+        const uint32_t *src6 = (const uint32_t *)buffers[i+6];
+        const uint32_t *src7 = (const uint32_t *)buffers[i+7];
+        quadlet_t *target = data + i;
+
+        unsigned int j = 0;
+        for (; j + 8 <= nevents; j += 8) {
+            __m256i r0 = ENCODE_AM824_AVX2_LOAD(0);
+            __m256i r1 = ENCODE_AM824_AVX2_LOAD(1);
+            __m256i r2 = ENCODE_AM824_AVX2_LOAD(2);
+            __m256i r3 = ENCODE_AM824_AVX2_LOAD(3);
+            __m256i r4 = ENCODE_AM824_AVX2_LOAD(4);
+            __m256i r5 = ENCODE_AM824_AVX2_LOAD(5);
+            __m256i r6 = ENCODE_AM824_AVX2_LOAD(6);
+            __m256i r7 = ENCODE_AM824_AVX2_LOAD(7);
+            TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7);
+
+            quadlet_t *t = target + j * dimension;
+            _mm256_storeu_si256((__m256i *)t, r0); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r1); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r2); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r3); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r4); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r5); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r6); t += dimension;
+            _mm256_storeu_si256((__m256i *)t, r7);
+        }
+        for (; j < nevents; j++) {
+            __m256i v = _mm256_set_epi32(src7[j], src6[j], src5[j], src4[j],
+                                         src3[j], src2[j], src1[j], src0[j]);
+            _mm256_storeu_si256((__m256i *)(target + j * dimension),
+                                encodeAM824AVX2Vector<is_float>(v));
+        }
+    }
+    if (i < nb_ports) {
+        // the SSE2 kernel uses legacy encoded instructions, avoid the
+        // state transition penalty (GCC does not always do this for us)
+        _mm256_zeroupper();
+        encodeAM824SSE2<is_float>(data + i, dimension, buffers + i, nb_ports - i, nevents);
+    }
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX2 __m256i
+decodeAM824AVX2Vector(__m256i v)
+{
+    v = byteSwapAVX2(v);
+    if (is_float) {
+        v = _mm256_srai_epi32(_mm256_slli_epi32(v, 8), 8);
+        __m256 v_float = _mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                                       _mm256_set1_ps(AM824_FLOAT_RECIPROCAL));
+        return _mm256_castps_si256(v_float);
+    } else {
+        return _mm256_and_si256(v, _mm256_set1_epi32(AM824_MBLA_MASK));
+    }
+}
+
+#define DECODE_AM824_AVX2_STORE(k) \
+    _mm256_storeu_si256((__m256i *)(dst##k + j), decodeAM824AVX2Vector<is_float>(r##k))
+
+template <bool is_float>
+static FFADO_TARGET_AVX2 void
+decodeAM824AVX2(const quadlet_t *data, unsigned int dimension,
+                void * const *buffers, unsigned int nb_ports,
+                unsigned int nevents)
+{
+    unsigned int i = 0;
+    for (; i + 8 <= nb_ports; i += 8) {
+        uint32_t *dst0 = (uint32_t *)buffers[i];
+        uint32_t *dst1 = (uint32_t *)buffers[i+1];
+        uint32_t *dst2 = (uint32_t *)buffers[i+2];
+        uint32_t *dst3 = (uint32_t *)buffers[i+3];
+        uint32_t *dst4 = (uint32_t *)buffers[i+4];
+        uint32_t *dst5 = (uint32_t *)buffers[i+5];
+        uint32_t *dst6 = (uint32_t *)buffers[i+6];
+        uint32_t *dst7 = (uint32_t *)buffers[i+7];
+        const quadlet_t *source = data + i;
+
+        unsigned int j = 0;
+        for (; j + 8 <= nevents; j += 8) {
+            const quadlet_t *s = source + j * dimension;
+            __m256i r0 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r1 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r2 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r3 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r4 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r5 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r6 = _mm256_loadu_si256((const __m256i *)s); s += dimension;
+            __m256i r7 = _mm256_loadu_si256((const __m256i *)s);
+            TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7);
+
+            DECODE_AM824_AVX2_STORE(0);
+            DECODE_AM824_AVX2_STORE(1);
+            DECODE_AM824_AVX2_STORE(2);
+            DECODE_AM824_AVX2_STORE(3);
+            DECODE_AM824_AVX2_STORE(4);
+            DECODE_AM824_AVX2_STORE(5);
+            DECODE_AM824_AVX2_STORE(6);
+            DECODE_AM824_AVX2_STORE(7);
+        }
+        for (; j < nevents; j++) {
+            uint32_t tmp[8];
+            __m256i v = _mm256_loadu_si256((const __m256i *)(source + j * dimension));
+            _mm256_storeu_si256((__m256i *)tmp, decodeAM824AVX2Vector<is_float>(v));
+            dst0[j] = tmp[0];
+            dst1[j] = tmp[1];
+            dst2[j] = tmp[2];
+            dst3[j] = tmp[3];
+            dst4[j] = tmp[4];
+            dst5[j] = tmp[5];
+            dst6[j] = tmp[6];
+            dst7[j] = tmp[7];
+        }
+    }
+    if (i < nb_ports) {
+        _mm256_zeroupper();
+        decodeAM824SSE2<is_float>(data + i, dimension, buffers + i, nb_ports - i, nevents);
+    }
+}
+
+// -- AVX-512: 16 ports x 16 events -- //
+
+// some GCC versions warn about the undefined pass-through operands
+// used internally by the AVX-512 intrinsics
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+static inline FFADO_TARGET_AVX512 __m512i
+byteSwapAVX512(__m512i v)
+{
+    const __m512i swap = _mm512_set4_epi32(0x0C0D0E0F, 0x08090A0B,
+                                           0x04050607, 0x00010203);
+    return _mm512_shuffle_epi8(v, swap);
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 __m512i
+encodeAM824AVX512Vector(__m512i v)
+{
+    if (is_float) {
+        __m512 v_float = _mm512_castsi512_ps(v);
+#if AMDTP_CLIP_FLOATS
+        v_float = _mm512_max_ps(v_float, _mm512_set1_ps(-1.0f));
+        v_float = _mm512_min_ps(v_float, _mm512_set1_ps(1.0f));
+#endif
+        v_float = _mm512_mul_ps(v_float, _mm512_set1_ps(AM824_FLOAT_MULTIPLIER));
+        v = _mm512_cvttps_epi32(v_float);
+    }
+    v = _mm512_and_si512(v, _mm512_set1_epi32(AM824_MBLA_MASK));
+    v = _mm512_or_si512(v, _mm512_set1_epi32(AM824_MBLA_LABEL));
+    return byteSwapAVX512(v);
+}
+
+// transposes 16 rows of 16 quadlets in place, see TRANSPOSE8X8_AVX2
+#define UNPACK_EPI32_AVX512(a, b) \
+    { \
+        __m512i lo = _mm512_unpacklo_epi32(a, b); \
+        b = _mm512_unpackhi_epi32(a, b); \
+        a = lo; \
+    }
+#define UNPACK_EPI64_AVX512(a, b, c, d) \
+    { \
+        __m512i ac_lo = _mm512_unpacklo_epi64(a, c); \
+        __m512i ac_hi = _mm512_unpackhi_epi64(a, c); \
+        __m512i bd_lo = _mm512_unpacklo_epi64(b, d); \
+        __m512i bd_hi = _mm512_unpackhi_epi64(b, d); \
+        a = ac_lo; b = ac_hi; c = bd_lo; d = bd_hi; \
+    }
+// transposes the 4x4 matrix of 128-bit lanes
+#define SHUFFLE_LANES_AVX512(a, b, c, d) \
+    { \
+        __m512i ab_lo = _mm512_shuffle_i32x4(a, b, 0x44); \
+        __m512i ab_hi = _mm512_shuffle_i32x4(a, b, 0xEE); \
+        __m512i cd_lo = _mm512_shuffle_i32x4(c, d, 0x44); \
+        __m512i cd_hi = _mm512_shuffle_i32x4(c, d, 0xEE); \
+        a = _mm512_shuffle_i32x4(ab_lo, cd_lo, 0x88); \
+        b = _mm512_shuffle_i32x4(ab_lo, cd_lo, 0xDD); \
+        c = _mm512_shuffle_i32x4(ab_hi, cd_hi, 0x88); \
+        d = _mm512_shuffle_i32x4(ab_hi, cd_hi, 0xDD); \
+    }
+// operates on the variables r0 .. r15
+#define TRANSPOSE16X16_AVX512() \
+    { \
+        UNPACK_EPI32_AVX512(r0, r1); \
+        UNPACK_EPI32_AVX512(r2, r3); \
+        UNPACK_EPI32_AVX512(r4, r5); \
+        UNPACK_EPI32_AVX512(r6, r7); \
+        UNPACK_EPI32_AVX512(r8, r9); \
+        UNPACK_EPI32_AVX512(r10, r11); \
+        UNPACK_EPI32_AVX512(r12, r13); \
+        UNPACK_EPI32_AVX512(r14, r15); \
+        /* afterwards each 128-bit lane L of the 4*g + c'th register */ \
+        /* holds column 4*L + c of the rows 4*g .. 4*g+3 */ \
+        UNPACK_EPI64_AVX512(r0, r1, r2, r3); \
+        UNPACK_EPI64_AVX512(r4, r5, r6, r7); \
+        UNPACK_EPI64_AVX512(r8, r9, r10, r11); \
+        UNPACK_EPI64_AVX512(r12, r13, r14, r15); \
+        SHUFFLE_LANES_AVX512(r0, r4, r8, r12); \
+        SHUFFLE_LANES_AVX512(r1, r5, r9, r13); \
+        SHUFFLE_LANES_AVX512(r2, r6, r10, r14); \
+        SHUFFLE_LANES_AVX512(r3, r7, r11, r15); \
+    }
+
+#define ENCODE_AM824_AVX512_LOAD(k) \
+    encodeAM824AVX512Vector<is_float>(_mm512_loadu_si512((const void *)((const uint32_t *)buffers[i+k] + j)))
+
+template <bool is_float>
+static FFADO_TARGET_AVX512 void
+encodeAM824AVX512(quadlet_t *data, unsigned int dimension,
+                  void * const *buffers, unsigned int nb_ports,
+                  unsigned int nevents)
+{
+    if (nevents < 16) {
+        // packets at 48kHz and below don't fill a block
+        encodeAM824AVX2<is_float>(data, dimension, buffers, nb_ports, nevents);
+        return;
+    }
+    unsigned int i = 0;
+    for (; i + 16 <= nb_ports; i += 16) {
+        quadlet_t *target = data + i;
+
+        unsigned int j = 0;
+        for (; j + 16 <= nevents; j += 16) {
+            __m512i r0  = ENCODE_AM824_AVX512_LOAD(0);
+            __m512i r1  = ENCODE_AM824_AVX512_LOAD(1);
+            __m512i r2  = ENCODE_AM824_AVX512_LOAD(2);
+            __m512i r3  = ENCODE_AM824_AVX512_LOAD(3);
+            __m512i r4  = ENCODE_AM824_AVX512_LOAD(4);
+            __m512i r5  = ENCODE_AM824_AVX512_LOAD(5);
+            __m512i r6  = ENCODE_AM824_AVX512_LOAD(6);
+            __m512i r7  = ENCODE_AM824_AVX512_LOAD(7);
+            __m512i r8  = ENCODE_AM824_AVX512_LOAD(8);
+            __m512i r9  = ENCODE_AM824_AVX512_LOAD(9);
+            __m512i r10 = ENCODE_AM824_AVX512_LOAD(10);
+            __m512i r11 = ENCODE_AM824_AVX512_LOAD(11);
+            __m512i r12 = ENCODE_AM824_AVX512_LOAD(12);
+            __m512i r13 = ENCODE_AM824_AVX512_LOAD(13);
+            __m512i r14 = ENCODE_AM824_AVX512_LOAD(14);
+            __m512i r15 = ENCODE_AM824_AVX512_LOAD(15);
+
+            TRANSPOSE16X16_AVX512();
+
+            quadlet_t *t = target + j * dimension;
+            _mm512_storeu_si512((void *)t, r0);  t += dimension;
+            _mm512_storeu_si512((void *)t, r1);  t += dimension;
+            _mm512_storeu_si512((void *)t, r2);  t += dimension;
+            _mm512_storeu_si512((void *)t, r3);  t += dimension;
+            _mm512_storeu_si512((void *)t, r4);  t += dimension;
+            _mm512_storeu_si512((void *)t, r5);  t += dimension;
+            _mm512_storeu_si512((void *)t, r6);  t += dimension;
+            _mm512_storeu_si512((void *)t, r7);  t += dimension;
+            _mm512_storeu_si512((void *)t, r8);  t += dimension;
+            _mm512_storeu_si512((void *)t, r9);  t += dimension;
+            _mm512_storeu_si512((void *)t, r10); t += dimension;
+            _mm512_storeu_si512((void *)t, r11); t += dimension;
+            _mm512_storeu_si512((void *)t, r12); t += dimension;
+            _mm512_storeu_si512((void *)t, r13); t += dimension;
+            _mm512_storeu_si512((void *)t, r14); t += dimension;
+            _mm512_storeu_si512((void *)t, r15);
+        }
+        if (j < nevents) {
+            // the 8x8 blocks are a better fit for the tail
+            void *tail[16];
+            for (int k = 0; k < 16; k++) {
+                tail[k] = (void *)((const uint32_t *)buffers[i+k] + j);
+            }
+            encodeAM824AVX2<is_float>(target + j * dimension, dimension,
+                                      tail, 16, nevents - j);
+        }
+    }
+    if (i < nb_ports) {
+        encodeAM824AVX2<is_float>(data + i, dimension, buffers + i, nb_ports - i, nevents);
+    }
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 __m512i
+decodeAM824AVX512Vector(__m512i v)
+{
+    v = byteSwapAVX512(v);
+    if (is_float) {
+        v = _mm512_srai_epi32(_mm512_slli_epi32(v, 8), 8);
+        __m512 v_float = _mm512_mul_ps(_mm512_cvtepi32_ps(v),
+                                       _mm512_set1_ps(AM824_FLOAT_RECIPROCAL));
+        return _mm512_castps_si512(v_float);
+    } else {
+        return _mm512_and_si512(v, _mm512_set1_epi32(AM824_MBLA_MASK));
+    }
+}
+
+#define DECODE_AM824_AVX512_LOAD(k) \
+    _mm512_loadu_si512((const void *)(source + (j + k) * dimension))
+#define DECODE_AM824_AVX512_STORE(k) \
+    _mm512_storeu_si512((void *)((uint32_t *)buffers[i+k] + j), decodeAM824AVX512Vector<is_float>(r##k))
+
+template <bool is_float>
+static FFADO_TARGET_AVX512 void
+decodeAM824AVX512(const quadlet_t *data, unsigned int dimension,
+                  void * const *buffers, unsigned int nb_ports,
+                  unsigned int nevents)
+{
+    if (nevents < 16) {
+        // packets at 48kHz and below don't fill a block
+        decodeAM824AVX2<is_float>(data, dimension, buffers, nb_ports, nevents);
+        return;
+    }
+    unsigned int i = 0;
+    for (; i + 16 <= nb_ports; i += 16) {
+        const quadlet_t *source = data + i;
+
+        unsigned int j = 0;
+        for (; j + 16 <= nevents; j += 16) {
+            __m512i r0  = DECODE_AM824_AVX512_LOAD(0);
+            __m512i r1  = DECODE_AM824_AVX512_LOAD(1);
+            __m512i r2  = DECODE_AM824_AVX512_LOAD(2);
+            __m512i r3  = DECODE_AM824_AVX512_LOAD(3);
+            __m512i r4  = DECODE_AM824_AVX512_LOAD(4);
+            __m512i r5  = DECODE_AM824_AVX512_LOAD(5);
+            __m512i r6  = DECODE_AM824_AVX512_LOAD(6);
+            __m512i r7  = DECODE_AM824_AVX512_LOAD(7);
+            __m512i r8  = DECODE_AM824_AVX512_LOAD(8);
+            __m512i r9  = DECODE_AM824_AVX512_LOAD(9);
+            __m512i r10 = DECODE_AM824_AVX512_LOAD(10);
+            __m512i r11 = DECODE_AM824_AVX512_LOAD(11);
+            __m512i r12 = DECODE_AM824_AVX512_LOAD(12);
+            __m512i r13 = DECODE_AM824_AVX512_LOAD(13);
+            __m512i r14 = DECODE_AM824_AVX512_LOAD(14);
+            __m512i r15 = DECODE_AM824_AVX512_LOAD(15);
+
+            TRANSPOSE16X16_AVX512();
+
+            DECODE_AM824_AVX512_STORE(0);
+            DECODE_AM824_AVX512_STORE(1);
+            DECODE_AM824_AVX512_STORE(2);
+            DECODE_AM824_AVX512_STORE(3);
+            DECODE_AM824_AVX512_STORE(4);
+            DECODE_AM824_AVX512_STORE(5);
+            DECODE_AM824_AVX512_STORE(6);
+            DECODE_AM824_AVX512_STORE(7);
+            DECODE_AM824_AVX512_STORE(8);
+            DECODE_AM824_AVX512_STORE(9);
+            DECODE_AM824_AVX512_STORE(10);
+            DECODE_AM824_AVX512_STORE(11);
+            DECODE_AM824_AVX512_STORE(12);
+            DECODE_AM824_AVX512_STORE(13);
+            DECODE_AM824_AVX512_STORE(14);
+            DECODE_AM824_AVX512_STORE(15);
+        }
+        if (j < nevents) {
+            void *tail[16];
+            for (int k = 0; k < 16; k++) {
+                tail[k] = (void *)((uint32_t *)buffers[i+k] + j);
+            }
+            decodeAM824AVX2<is_float>(source + j * dimension, dimension,
+                                      tail, 16, nevents - j);
+        }
+    }
+    if (i < nb_ports) {
+        decodeAM824AVX2<is_float>(data + i, dimension, buffers + i, nb_ports - i, nevents);
+    }
+}
+
+#pragma GCC diagnostic pop
+
+/*
+ * The packed 24-bit kernels need a byte shuffle, hence there are no SSE2
+ * versions.
+ */
+
+// -- packed 24-bit, AVX2: 4 and 8 ports -- //
+
+/*
+ * The samples of a run of ports are 'step' bytes apart: 3 when they are
+ * packed back to back (MOTU), 4 when each one starts a quadlet of its own
+ * (Digidesign). The fourth byte of such a quadlet is left untouched.
+ */
+
+// per 32-bit lane: zero, then the three sample bytes in reverse order
+#define PACKED24_UNPACK_MASK_EPI8 \
+     9, 10, 11, -128,  6,  7,  8, -128,  3,  4,  5, -128,  0,  1,  2, -128
+// the inverse, packs the low three bytes of each lane at the bottom
+#define PACKED24_PACK_MASK_EPI8 \
+    -128, -128, -128, -128, 12, 13, 14, 8, 9, 10, 4, 5, 6, 0, 1, 2
+// the same for samples at the start of each quadlet
+#define QUADLET_PACKED24_UNPACK_MASK_EPI8 \
+    12, 13, 14, -128,  8,  9, 10, -128,  4,  5,  6, -128,  0,  1,  2, -128
+#define QUADLET_PACKED24_PACK_MASK_EPI8 \
+    -128, 12, 13, 14, -128,  8,  9, 10, -128,  4,  5,  6, -128,  0,  1,  2
+// the bytes of a quadlet that don't belong to the sample
+#define QUADLET_PACKED24_KEEP_MASK 0xFF000000
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 __m128i
+decodePacked24Vector4(__m128i v)
+{
+    if (step == 3) {
+        v = _mm_shuffle_epi8(v, _mm_set_epi8(PACKED24_UNPACK_MASK_EPI8));
+    } else {
+        v = _mm_shuffle_epi8(v, _mm_set_epi8(QUADLET_PACKED24_UNPACK_MASK_EPI8));
+    }
+    v = _mm_srai_epi32(v, 8);
+    if (is_float) {
+        return _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(v),
+                                           _mm_set1_ps(PACKED24_FLOAT_RECIPROCAL)));
+    }
+    return v;
+}
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 __m128i
+encodePacked24Vector4(__m128i v)
+{
+    if (is_float) {
+        __m128 v_float = _mm_castsi128_ps(v);
+#if PACKED24_CLIP_FLOATS
+        v_float = _mm_max_ps(v_float, _mm_set1_ps(-1.0f));
+        v_float = _mm_min_ps(v_float, _mm_set1_ps(1.0f));
+#endif
+        v = _mm_cvtps_epi32(_mm_mul_ps(v_float, _mm_set1_ps(PACKED24_FLOAT_MULTIPLIER)));
+    }
+    if (step == 3) {
+        return _mm_shuffle_epi8(v, _mm_set_epi8(PACKED24_PACK_MASK_EPI8));
+    }
+    return _mm_shuffle_epi8(v, _mm_set_epi8(QUADLET_PACKED24_PACK_MASK_EPI8));
+}
+
+template <unsigned int step>
+static inline FFADO_TARGET_AVX2 void
+storePacked24Vector4(byte_t *target, __m128i v)
+{
+    if (step == 3) {
+        _mm_maskstore_epi32((int *)target, _mm_set_epi32(0, -1, -1, -1), v);
+    } else {
+        __m128i old = _mm_loadu_si128((const __m128i *)target);
+        v = _mm_blendv_epi8(v, old, _mm_set1_epi32(QUADLET_PACKED24_KEEP_MASK));
+        _mm_storeu_si128((__m128i *)target, v);
+    }
+}
+
+template <unsigned int step>
+static inline FFADO_TARGET_AVX2 __m256i
+loadPacked24Vector8(const byte_t *src)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)src);
+    if (step == 3) {
+        // move samples 4..7 to the upper 128-bit lane
+        v = _mm256_permutevar8x32_epi32(v, _mm256_set_epi32(5, 5, 4, 3, 2, 2, 1, 0));
+    }
+    return v;
+}
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 __m256i
+decodePacked24Vector8(__m256i v)
+{
+    if (step == 3) {
+        v = _mm256_shuffle_epi8(v, _mm256_set_epi8(PACKED24_UNPACK_MASK_EPI8,
+                                                   PACKED24_UNPACK_MASK_EPI8));
+    } else {
+        v = _mm256_shuffle_epi8(v, _mm256_set_epi8(QUADLET_PACKED24_UNPACK_MASK_EPI8,
+                                                   QUADLET_PACKED24_UNPACK_MASK_EPI8));
+    }
+    v = _mm256_srai_epi32(v, 8);
+    if (is_float) {
+        return _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                                                 _mm256_set1_ps(PACKED24_FLOAT_RECIPROCAL)));
+    }
+    return v;
+}
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 __m256i
+encodePacked24Vector8(__m256i v)
+{
+    if (is_float) {
+        __m256 v_float = _mm256_castsi256_ps(v);
+#if PACKED24_CLIP_FLOATS
+        v_float = _mm256_max_ps(v_float, _mm256_set1_ps(-1.0f));
+        v_float = _mm256_min_ps(v_float, _mm256_set1_ps(1.0f));
+#endif
+        v = _mm256_cvtps_epi32(_mm256_mul_ps(v_float, _mm256_set1_ps(PACKED24_FLOAT_MULTIPLIER)));
+    }
+    if (step == 3) {
+        v = _mm256_shuffle_epi8(v, _mm256_set_epi8(PACKED24_PACK_MASK_EPI8,
+                                                   PACKED24_PACK_MASK_EPI8));
+        // close the gap between the two 12-byte halves
+        return _mm256_permutevar8x32_epi32(v, _mm256_set_epi32(7, 7, 6, 5, 4, 2, 1, 0));
+    }
+    return _mm256_shuffle_epi8(v, _mm256_set_epi8(QUADLET_PACKED24_PACK_MASK_EPI8,
+                                                  QUADLET_PACKED24_PACK_MASK_EPI8));
+}
+
+template <unsigned int step>
+static inline FFADO_TARGET_AVX2 void
+storePacked24Vector8(byte_t *target, __m256i v)
+{
+    if (step == 3) {
+        _mm256_maskstore_epi32((int *)target, _mm256_set_epi32(0, 0, -1, -1, -1, -1, -1, -1), v);
+    } else {
+        __m256i old = _mm256_loadu_si256((const __m256i *)target);
+        v = _mm256_blendv_epi8(v, old, _mm256_set1_epi32(QUADLET_PACKED24_KEEP_MASK));
+        _mm256_storeu_si256((__m256i *)target, v);
+    }
+}
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 void
+decodePacked24AVX2x4(const byte_t *data, unsigned int event_size, unsigned int pos,
+                     void * const *buffers, unsigned int nevents)
+{
+    uint32_t *dst0 = (uint32_t *)buffers[0];
+    uint32_t *dst1 = (uint32_t *)buffers[1];
+    uint32_t *dst2 = (uint32_t *)buffers[2];
+    uint32_t *dst3 = (uint32_t *)buffers[3];
+    const byte_t *source = data + pos;
+    unsigned int nvec = vectorLoadEvents(pos, 16, event_size, nevents);
+
+    unsigned int j = 0;
+    for (; j + 4 <= nvec; j += 4) {
+        const byte_t *s = source + j * event_size;
+        __m128i r0 = decodePacked24Vector4<is_float, step>(_mm_loadu_si128((const __m128i *)s)); s += event_size;
+        __m128i r1 = decodePacked24Vector4<is_float, step>(_mm_loadu_si128((const __m128i *)s)); s += event_size;
+        __m128i r2 = decodePacked24Vector4<is_float, step>(_mm_loadu_si128((const __m128i *)s)); s += event_size;
+        __m128i r3 = decodePacked24Vector4<is_float, step>(_mm_loadu_si128((const __m128i *)s));
+        TRANSPOSE4X4_SSE2(r0, r1, r2, r3);
+        _mm_storeu_si128((__m128i *)(dst0 + j), r0);
+        _mm_storeu_si128((__m128i *)(dst1 + j), r1);
+        _mm_storeu_si128((__m128i *)(dst2 + j), r2);
+        _mm_storeu_si128((__m128i *)(dst3 + j), r3);
+    }
+    for (; j < nvec; j++) {
+        uint32_t tmp[4];
+        __m128i v = _mm_loadu_si128((const __m128i *)(source + j * event_size));
+        _mm_storeu_si128((__m128i *)tmp, decodePacked24Vector4<is_float, step>(v));
+        dst0[j] = tmp[0];
+        dst1[j] = tmp[1];
+        dst2[j] = tmp[2];
+        dst3[j] = tmp[3];
+    }
+    for (unsigned int k = 0; k < 4; k++) {
+        decodePacked24Port<is_float>(source + step * k, event_size, buffers[k], nvec, nevents);
+    }
+}
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 void
+encodePacked24AVX2x4(byte_t *data, unsigned int event_size, unsigned int pos,
+                     void * const *buffers, unsigned int nevents)
+{
+    const uint32_t *src0 = (const uint32_t *)buffers[0];
+    const uint32_t *src1 = (const uint32_t *)buffers[1];
+    const uint32_t *src2 = (const uint32_t *)buffers[2];
+    const uint32_t *src3 = (const uint32_t *)buffers[3];
+    byte_t *target = data + pos;
+
+    unsigned int j = 0;
+    for (; j + 4 <= nevents; j += 4) {
+        __m128i r0 = _mm_loadu_si128((const __m128i *)(src0 + j));
+        __m128i r1 = _mm_loadu_si128((const __m128i *)(src1 + j));
+        __m128i r2 = _mm_loadu_si128((const __m128i *)(src2 + j));
+        __m128i r3 = _mm_loadu_si128((const __m128i *)(src3 + j));
+        TRANSPOSE4X4_SSE2(r0, r1, r2, r3);
+        byte_t *t = target + j * event_size;
+        storePacked24Vector4<step>(t, encodePacked24Vector4<is_float, step>(r0)); t += event_size;
+        storePacked24Vector4<step>(t, encodePacked24Vector4<is_float, step>(r1)); t += event_size;
+        storePacked24Vector4<step>(t, encodePacked24Vector4<is_float, step>(r2)); t += event_size;
+        storePacked24Vector4<step>(t, encodePacked24Vector4<is_float, step>(r3));
+    }
+    for (; j < nevents; j++) {
+        __m128i v = _mm_set_epi32(src3[j], src2[j], src1[j], src0[j]);
+        storePacked24Vector4<step>(target + j * event_size, encodePacked24Vector4<is_float, step>(v));
+    }
+}
+
+#define DECODE_PACKED24_AVX2_STORE(k) \
+    _mm256_storeu_si256((__m256i *)(dst##k + j), r##k)
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 void
+decodePacked24AVX2x8(const byte_t *data, unsigned int event_size, unsigned int pos,
+                     void * const *buffers, unsigned int nevents)
+{
+    uint32_t *dst0 = (uint32_t *)buffers[0];
+    uint32_t *dst1 = (uint32_t *)buffers[1];
+    uint32_t *dst2 = (uint32_t *)buffers[2];
+    uint32_t *dst3 = (uint32_t *)buffers[3];
+    uint32_t *dst4 = (uint32_t *)buffers[4];
+    uint32_t *dst5 = (uint32_t *)buffers[5];
+    uint32_t *dst6 = (uint32_t *)buffers[6];
+    uint32_t *dst7 = (uint32_t *)buffers[7];
+    const byte_t *source = data + pos;
+    unsigned int nvec = vectorLoadEvents(pos, 32, event_size, nevents);
+
+    unsigned int j = 0;
+    for (; j + 8 <= nvec; j += 8) {
+        const byte_t *s = source + j * event_size;
+        __m256i r0 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r1 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r2 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r3 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r4 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r5 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r6 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s)); s += event_size;
+        __m256i r7 = decodePacked24Vector8<is_float, step>(loadPacked24Vector8<step>(s));
+        TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7);
+        DECODE_PACKED24_AVX2_STORE(0);
+        DECODE_PACKED24_AVX2_STORE(1);
+        DECODE_PACKED24_AVX2_STORE(2);
+        DECODE_PACKED24_AVX2_STORE(3);
+        DECODE_PACKED24_AVX2_STORE(4);
+        DECODE_PACKED24_AVX2_STORE(5);
+        DECODE_PACKED24_AVX2_STORE(6);
+        DECODE_PACKED24_AVX2_STORE(7);
+    }
+    for (; j < nvec; j++) {
+        uint32_t tmp[8];
+        __m256i v = loadPacked24Vector8<step>(source + j * event_size);
+        _mm256_storeu_si256((__m256i *)tmp, decodePacked24Vector8<is_float, step>(v));
+        dst0[j] = tmp[0];
+        dst1[j] = tmp[1];
+        dst2[j] = tmp[2];
+        dst3[j] = tmp[3];
+        dst4[j] = tmp[4];
+        dst5[j] = tmp[5];
+        dst6[j] = tmp[6];
+        dst7[j] = tmp[7];
+    }
+    for (unsigned int k = 0; k < 8; k++) {
+        decodePacked24Port<is_float>(source + step * k, event_size, buffers[k], nvec, nevents);
+    }
+}
+
+#define ENCODE_PACKED24_AVX2_LOAD(k) \
+    _mm256_loadu_si256((const __m256i *)(src##k + j))
+
+template <bool is_float, unsigned int step>
+static inline FFADO_TARGET_AVX2 void
+encodePacked24AVX2x8(byte_t *data, unsigned int event_size, unsigned int pos,
+                     void * const *buffers, unsigned int nevents)
+{
+    const uint32_t *src0 = (const uint32_t *)buffers[0];
+    const uint32_t *src1 = (const uint32_t *)buffers[1];
+    const uint32_t *src2 = (const uint32_t *)buffers[2];
+    const uint32_t *src3 = (const uint32_t *)buffers[3];
+    const uint32_t *src4 = (const uint32_t *)buffers[4];
+    const uint32_t *src5 = (const uint32_t *)buffers[5];
+    const uint32_t *src6 = (const uint32_t *)buffers[6];
+    const uint32_t *src7 = (const uint32_t *)buffers[7];
+    byte_t *target = data + pos;
+
+    unsigned int j = 0;
+    for (; j + 8 <= nevents; j += 8) {
+        __m256i r0 = ENCODE_PACKED24_AVX2_LOAD(0);
+        __m256i r1 = ENCODE_PACKED24_AVX2_LOAD(1);
+        __m256i r2 = ENCODE_PACKED24_AVX2_LOAD(2);
+        __m256i r3 = ENCODE_PACKED24_AVX2_LOAD(3);
+        __m256i r4 = ENCODE_PACKED24_AVX2_LOAD(4);
+        __m256i r5 = ENCODE_PACKED24_AVX2_LOAD(5);
+        __m256i r6 = ENCODE_PACKED24_AVX2_LOAD(6);
+        __m256i r7 = ENCODE_PACKED24_AVX2_LOAD(7);
+        TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7);
+        byte_t *t = target + j * event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r0)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r1)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r2)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r3)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r4)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r5)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r6)); t += event_size;
+        storePacked24Vector8<step>(t, encodePacked24Vector8<is_float, step>(r7));
+    }
+    for (; j < nevents; j++) {
+        __m256i v = _mm256_set_epi32(src7[j], src6[j], src5[j], src4[j],
+                                     src3[j], src2[j], src1[j], src0[j]);
+        storePacked24Vector8<step>(target + j * event_size, encodePacked24Vector8<is_float, step>(v));
+    }
+}
+
+// true if the first 'width' ports are samples 'step' bytes apart whose
+// bytes, including the unused ones of a quadlet, are all in the event
+static inline bool
+isPacked24Run(const unsigned int *positions, unsigned int nb_ports,
+              unsigned int width, unsigned int step, unsigned int event_size)
+{
+    return isPortRun(positions, nb_ports, width, step)
+           && positions[0] + step * width <= event_size;
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX2 void
+decodePacked24AVX2(const byte_t *data, unsigned int event_size,
+                   const unsigned int *positions, void * const *buffers,
+                   unsigned int nb_ports, unsigned int nevents)
+{
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPacked24Run(positions + i, nb_ports - i, 8, 3, event_size)) {
+            decodePacked24AVX2x8<is_float, 3>(data, event_size, positions[i], buffers + i, nevents);
+            i += 8;
+        } else if (isPacked24Run(positions + i, nb_ports - i, 8, 4, event_size)) {
+            decodePacked24AVX2x8<is_float, 4>(data, event_size, positions[i], buffers + i, nevents);
+            i += 8;
+        } else if (isPacked24Run(positions + i, nb_ports - i, 4, 3, event_size)) {
+            decodePacked24AVX2x4<is_float, 3>(data, event_size, positions[i], buffers + i, nevents);
+            i += 4;
+        } else if (isPacked24Run(positions + i, nb_ports - i, 4, 4, event_size)) {
+            decodePacked24AVX2x4<is_float, 4>(data, event_size, positions[i], buffers + i, nevents);
+            i += 4;
+        } else {
+            decodePacked24Port<is_float>(data + positions[i], event_size, buffers[i], 0, nevents);
+            i++;
+        }
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX2 void
+encodePacked24AVX2(byte_t *data, unsigned int event_size,
+                   const unsigned int *positions, void * const *buffers,
+                   unsigned int nb_ports, unsigned int nevents)
+{
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPacked24Run(positions + i, nb_ports - i, 8, 3, event_size)) {
+            encodePacked24AVX2x8<is_float, 3>(data, event_size, positions[i], buffers + i, nevents);
+            i += 8;
+        } else if (isPacked24Run(positions + i, nb_ports - i, 8, 4, event_size)) {
+            encodePacked24AVX2x8<is_float, 4>(data, event_size, positions[i], buffers + i, nevents);
+            i += 8;
+        } else if (isPacked24Run(positions + i, nb_ports - i, 4, 3, event_size)) {
+            encodePacked24AVX2x4<is_float, 3>(data, event_size, positions[i], buffers + i, nevents);
+            i += 4;
+        } else if (isPacked24Run(positions + i, nb_ports - i, 4, 4, event_size)) {
+            encodePacked24AVX2x4<is_float, 4>(data, event_size, positions[i], buffers + i, nevents);
+            i += 4;
+        } else {
+            encodePacked24Port<is_float>(data + positions[i], event_size, buffers[i], 0, nevents);
+            i++;
+        }
+    }
+}
+
+// -- packed 24-bit, AVX-512: 16 ports -- //
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+static inline FFADO_TARGET_AVX512 __m512i
+loadPacked24Vector16(const byte_t *src)
+{
+    __m512i v = _mm512_loadu_si512((const void *)src);
+    // spread the 12-byte groups over the 128-bit lanes
+    return _mm512_permutexvar_epi32(_mm512_set_epi32(11, 11, 10, 9, 8, 8, 7, 6,
+                                                     5, 5, 4, 3, 2, 2, 1, 0), v);
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 __m512i
+decodePacked24Vector16(__m512i v)
+{
+    v = _mm512_shuffle_epi8(v, _mm512_set4_epi32(0x090A0B80, 0x06070880,
+                                                 0x03040580, 0x00010280));
+    v = _mm512_srai_epi32(v, 8);
+    if (is_float) {
+        return _mm512_castps_si512(_mm512_mul_ps(_mm512_cvtepi32_ps(v),
+                                                 _mm512_set1_ps(PACKED24_FLOAT_RECIPROCAL)));
+    }
+    return v;
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 __m512i
+encodePacked24Vector16(__m512i v)
+{
+    if (is_float) {
+        __m512 v_float = _mm512_castsi512_ps(v);
+#if PACKED24_CLIP_FLOATS
+        v_float = _mm512_max_ps(v_float, _mm512_set1_ps(-1.0f));
+        v_float = _mm512_min_ps(v_float, _mm512_set1_ps(1.0f));
+#endif
+        v = _mm512_cvtps_epi32(_mm512_mul_ps(v_float, _mm512_set1_ps(PACKED24_FLOAT_MULTIPLIER)));
+    }
+    v = _mm512_shuffle_epi8(v, _mm512_set4_epi32(0x80808080, 0x0C0D0E08,
+                                                 0x090A0405, 0x06000102));
+    // close the gaps between the 12-byte groups
+    return _mm512_permutexvar_epi32(_mm512_set_epi32(15, 15, 15, 15, 14, 13, 12, 10,
+                                                     9, 8, 6, 5, 4, 2, 1, 0), v);
+}
+
+static inline FFADO_TARGET_AVX512 void
+storePacked24Vector16(byte_t *target, __m512i v)
+{
+    _mm512_mask_storeu_epi32((void *)target, 0x0FFF, v);
+}
+
+#define DECODE_PACKED24_AVX512_LOAD(k) \
+    decodePacked24Vector16<is_float>(loadPacked24Vector16(source + (j + k) * event_size))
+#define DECODE_PACKED24_AVX512_STORE(k) \
+    _mm512_storeu_si512((void *)((uint32_t *)buffers[k] + j), r##k)
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 void
+decodePacked24AVX512x16(const byte_t *data, unsigned int event_size, unsigned int pos,
+                        void * const *buffers, unsigned int nevents)
+{
+    const byte_t *source = data + pos;
+    unsigned int nvec = vectorLoadEvents(pos, 64, event_size, nevents);
+
+    unsigned int j = 0;
+    for (; j + 16 <= nvec; j += 16) {
+        __m512i r0  = DECODE_PACKED24_AVX512_LOAD(0);
+        __m512i r1  = DECODE_PACKED24_AVX512_LOAD(1);
+        __m512i r2  = DECODE_PACKED24_AVX512_LOAD(2);
+        __m512i r3  = DECODE_PACKED24_AVX512_LOAD(3);
+        __m512i r4  = DECODE_PACKED24_AVX512_LOAD(4);
+        __m512i r5  = DECODE_PACKED24_AVX512_LOAD(5);
+        __m512i r6  = DECODE_PACKED24_AVX512_LOAD(6);
+        __m512i r7  = DECODE_PACKED24_AVX512_LOAD(7);
+        __m512i r8  = DECODE_PACKED24_AVX512_LOAD(8);
+        __m512i r9  = DECODE_PACKED24_AVX512_LOAD(9);
+        __m512i r10 = DECODE_PACKED24_AVX512_LOAD(10);
+        __m512i r11 = DECODE_PACKED24_AVX512_LOAD(11);
+        __m512i r12 = DECODE_PACKED24_AVX512_LOAD(12);
+        __m512i r13 = DECODE_PACKED24_AVX512_LOAD(13);
+        __m512i r14 = DECODE_PACKED24_AVX512_LOAD(14);
+        __m512i r15 = DECODE_PACKED24_AVX512_LOAD(15);
+
+        TRANSPOSE16X16_AVX512();
+
+        DECODE_PACKED24_AVX512_STORE(0);
+        DECODE_PACKED24_AVX512_STORE(1);
+        DECODE_PACKED24_AVX512_STORE(2);
+        DECODE_PACKED24_AVX512_STORE(3);
+        DECODE_PACKED24_AVX512_STORE(4);
+        DECODE_PACKED24_AVX512_STORE(5);
+        DECODE_PACKED24_AVX512_STORE(6);
+        DECODE_PACKED24_AVX512_STORE(7);
+        DECODE_PACKED24_AVX512_STORE(8);
+        DECODE_PACKED24_AVX512_STORE(9);
+        DECODE_PACKED24_AVX512_STORE(10);
+        DECODE_PACKED24_AVX512_STORE(11);
+        DECODE_PACKED24_AVX512_STORE(12);
+        DECODE_PACKED24_AVX512_STORE(13);
+        DECODE_PACKED24_AVX512_STORE(14);
+        DECODE_PACKED24_AVX512_STORE(15);
+    }
+    for (; j < nvec; j++) {
+        uint32_t tmp[16];
+        __m512i v = loadPacked24Vector16(source + j * event_size);
+        _mm512_storeu_si512((void *)tmp, decodePacked24Vector16<is_float>(v));
+        for (int k = 0; k < 16; k++) {
+            ((uint32_t *)buffers[k])[j] = tmp[k];
+        }
+    }
+    for (unsigned int k = 0; k < 16; k++) {
+        decodePacked24Port<is_float>(source + 3 * k, event_size, buffers[k], nvec, nevents);
+    }
+}
+
+#define ENCODE_PACKED24_AVX512_LOAD(k) \
+    _mm512_loadu_si512((const void *)((const uint32_t *)buffers[k] + j))
+#define ENCODE_PACKED24_AVX512_STORE(k) \
+    storePacked24Vector16(target + (j + k) * event_size, encodePacked24Vector16<is_float>(r##k))
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 void
+encodePacked24AVX512x16(byte_t *data, unsigned int event_size, unsigned int pos,
+                        void * const *buffers, unsigned int nevents)
+{
+    byte_t *target = data + pos;
+
+    unsigned int j = 0;
+    for (; j + 16 <= nevents; j += 16) {
+        __m512i r0  = ENCODE_PACKED24_AVX512_LOAD(0);
+        __m512i r1  = ENCODE_PACKED24_AVX512_LOAD(1);
+        __m512i r2  = ENCODE_PACKED24_AVX512_LOAD(2);
+        __m512i r3  = ENCODE_PACKED24_AVX512_LOAD(3);
+        __m512i r4  = ENCODE_PACKED24_AVX512_LOAD(4);
+        __m512i r5  = ENCODE_PACKED24_AVX512_LOAD(5);
+        __m512i r6  = ENCODE_PACKED24_AVX512_LOAD(6);
+        __m512i r7  = ENCODE_PACKED24_AVX512_LOAD(7);
+        __m512i r8  = ENCODE_PACKED24_AVX512_LOAD(8);
+        __m512i r9  = ENCODE_PACKED24_AVX512_LOAD(9);
+        __m512i r10 = ENCODE_PACKED24_AVX512_LOAD(10);
+        __m512i r11 = ENCODE_PACKED24_AVX512_LOAD(11);
+        __m512i r12 = ENCODE_PACKED24_AVX512_LOAD(12);
+        __m512i r13 = ENCODE_PACKED24_AVX512_LOAD(13);
+        __m512i r14 = ENCODE_PACKED24_AVX512_LOAD(14);
+        __m512i r15 = ENCODE_PACKED24_AVX512_LOAD(15);
+
+        TRANSPOSE16X16_AVX512();
+
+        ENCODE_PACKED24_AVX512_STORE(0);
+        ENCODE_PACKED24_AVX512_STORE(1);
+        ENCODE_PACKED24_AVX512_STORE(2);
+        ENCODE_PACKED24_AVX512_STORE(3);
+        ENCODE_PACKED24_AVX512_STORE(4);
+        ENCODE_PACKED24_AVX512_STORE(5);
+        ENCODE_PACKED24_AVX512_STORE(6);
+        ENCODE_PACKED24_AVX512_STORE(7);
+        ENCODE_PACKED24_AVX512_STORE(8);
+        ENCODE_PACKED24_AVX512_STORE(9);
+        ENCODE_PACKED24_AVX512_STORE(10);
+        ENCODE_PACKED24_AVX512_STORE(11);
+        ENCODE_PACKED24_AVX512_STORE(12);
+        ENCODE_PACKED24_AVX512_STORE(13);
+        ENCODE_PACKED24_AVX512_STORE(14);
+        ENCODE_PACKED24_AVX512_STORE(15);
+    }
+    if (j < nevents) {
+        // the 8-port kernels are a better fit for the tail
+        void *tail[16];
+        for (int k = 0; k < 16; k++) {
+            tail[k] = (void *)((uint32_t *)buffers[k] + j);
+        }
+        encodePacked24AVX2x8<is_float, 3>(target + j * event_size, event_size, 0,
+                                       tail, nevents - j);
+        encodePacked24AVX2x8<is_float, 3>(target + j * event_size, event_size, 24,
+                                       tail + 8, nevents - j);
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX512 void
+decodePacked24AVX512(const byte_t *data, unsigned int event_size,
+                     const unsigned int *positions, void * const *buffers,
+                     unsigned int nb_ports, unsigned int nevents)
+{
+    if (nevents < 16) {
+        decodePacked24AVX2<is_float>(data, event_size, positions, buffers, nb_ports, nevents);
+        return;
+    }
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 16, 3)) {
+            decodePacked24AVX512x16<is_float>(data, event_size, positions[i], buffers + i, nevents);
+            i += 16;
+        } else {
+            // hand everything up to the next run to the AVX2 kernel
+            unsigned int n = 1;
+            while (i + n < nb_ports
+                   && !isPortRun(positions + i + n, nb_ports - i - n, 16, 3)) {
+                n++;
+            }
+            decodePacked24AVX2<is_float>(data, event_size, positions + i, buffers + i, n, nevents);
+            i += n;
+        }
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX512 void
+encodePacked24AVX512(byte_t *data, unsigned int event_size,
+                     const unsigned int *positions, void * const *buffers,
+                     unsigned int nb_ports, unsigned int nevents)
+{
+    if (nevents < 16) {
+        encodePacked24AVX2<is_float>(data, event_size, positions, buffers, nb_ports, nevents);
+        return;
+    }
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 16, 3)) {
+            encodePacked24AVX512x16<is_float>(data, event_size, positions[i], buffers + i, nevents);
+            i += 16;
+        } else {
+            unsigned int n = 1;
+            while (i + n < nb_ports
+                   && !isPortRun(positions + i + n, nb_ports - i - n, 16, 3)) {
+                n++;
+            }
+            encodePacked24AVX2<is_float>(data, event_size, positions + i, buffers + i, n, nevents);
+            i += n;
+        }
+    }
+}
+
+#pragma GCC diagnostic pop
+
+// -- quadlet 24-bit, SSE2: 4 ports -- //
+
+template <bool is_float>
+static inline FFADO_TARGET_SSE2 __m128i
+decodeQuadlet24Vector4(__m128i v)
+{
+    v = _mm_srai_epi32(v, 8);
+    if (is_float) {
+        return _mm_castps_si128(_mm_mul_ps(_mm_cvtepi32_ps(v),
+                                           _mm_set1_ps(QUADLET24_FLOAT_RECIPROCAL)));
+    }
+    return v;
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_SSE2 __m128i
+encodeQuadlet24Vector4(__m128i v)
+{
+    if (is_float) {
+        __m128 v_float = _mm_castsi128_ps(v);
+#if RME_CLIP_FLOATS
+        v_float = _mm_max_ps(v_float, _mm_set1_ps(-1.0f));
+        v_float = _mm_min_ps(v_float, _mm_set1_ps(1.0f));
+#endif
+        v = _mm_cvtps_epi32(_mm_mul_ps(v_float, _mm_set1_ps(QUADLET24_FLOAT_MULTIPLIER)));
+    }
+    return _mm_slli_epi32(v, 8);
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_SSE2 void
+decodeQuadlet24SSE2x4(const quadlet_t *data, unsigned int dimension, unsigned int pos,
+                      void * const *buffers, unsigned int nevents)
+{
+    uint32_t *dst0 = (uint32_t *)buffers[0];
+    uint32_t *dst1 = (uint32_t *)buffers[1];
+    uint32_t *dst2 = (uint32_t *)buffers[2];
+    uint32_t *dst3 = (uint32_t *)buffers[3];
+    const quadlet_t *source = data + pos;
+    unsigned int nvec = vectorLoadEvents(pos, 4, dimension, nevents);
+
+    unsigned int j = 0;
+    for (; j + 4 <= nvec; j += 4) {
+        const quadlet_t *s = source + j * dimension;
+        __m128i r0 = decodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)s)); s += dimension;
+        __m128i r1 = decodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)s)); s += dimension;
+        __m128i r2 = decodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)s)); s += dimension;
+        __m128i r3 = decodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)s));
+        TRANSPOSE4X4_SSE2(r0, r1, r2, r3);
+        _mm_storeu_si128((__m128i *)(dst0 + j), r0);
+        _mm_storeu_si128((__m128i *)(dst1 + j), r1);
+        _mm_storeu_si128((__m128i *)(dst2 + j), r2);
+        _mm_storeu_si128((__m128i *)(dst3 + j), r3);
+    }
+    for (; j < nvec; j++) {
+        uint32_t tmp[4];
+        __m128i v = _mm_loadu_si128((const __m128i *)(source + j * dimension));
+        _mm_storeu_si128((__m128i *)tmp, decodeQuadlet24Vector4<is_float>(v));
+        dst0[j] = tmp[0];
+        dst1[j] = tmp[1];
+        dst2[j] = tmp[2];
+        dst3[j] = tmp[3];
+    }
+    for (unsigned int k = 0; k < 4; k++) {
+        decodeQuadlet24Port<is_float>(source + k, dimension, buffers[k], nvec, nevents);
+    }
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_SSE2 void
+encodeQuadlet24SSE2x4(quadlet_t *data, unsigned int dimension, unsigned int pos,
+                      void * const *buffers, unsigned int nevents)
+{
+    const uint32_t *src0 = (const uint32_t *)buffers[0];
+    const uint32_t *src1 = (const uint32_t *)buffers[1];
+    const uint32_t *src2 = (const uint32_t *)buffers[2];
+    const uint32_t *src3 = (const uint32_t *)buffers[3];
+    quadlet_t *target = data + pos;
+
+    unsigned int j = 0;
+    for (; j + 4 <= nevents; j += 4) {
+        __m128i r0 = encodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)(src0 + j)));
+        __m128i r1 = encodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)(src1 + j)));
+        __m128i r2 = encodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)(src2 + j)));
+        __m128i r3 = encodeQuadlet24Vector4<is_float>(_mm_loadu_si128((const __m128i *)(src3 + j)));
+        TRANSPOSE4X4_SSE2(r0, r1, r2, r3);
+        quadlet_t *t = target + j * dimension;
+        _mm_storeu_si128((__m128i *)t, r0); t += dimension;
+        _mm_storeu_si128((__m128i *)t, r1); t += dimension;
+        _mm_storeu_si128((__m128i *)t, r2); t += dimension;
+        _mm_storeu_si128((__m128i *)t, r3);
+    }
+    for (; j < nevents; j++) {
+        __m128i v = _mm_set_epi32(src3[j], src2[j], src1[j], src0[j]);
+        _mm_storeu_si128((__m128i *)(target + j * dimension),
+                         encodeQuadlet24Vector4<is_float>(v));
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_SSE2 void
+decodeQuadlet24SSE2(const quadlet_t *data, unsigned int dimension,
+                    const unsigned int *positions, void * const *buffers,
+                    unsigned int nb_ports, unsigned int nevents)
+{
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 4, 1)) {
+            decodeQuadlet24SSE2x4<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 4;
+        } else {
+            decodeQuadlet24Port<is_float>(data + positions[i], dimension, buffers[i], 0, nevents);
+            i++;
+        }
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_SSE2 void
+encodeQuadlet24SSE2(quadlet_t *data, unsigned int dimension,
+                    const unsigned int *positions, void * const *buffers,
+                    unsigned int nb_ports, unsigned int nevents)
+{
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 4, 1)) {
+            encodeQuadlet24SSE2x4<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 4;
+        } else {
+            encodeQuadlet24Port<is_float>(data + positions[i], dimension, buffers[i], 0, nevents);
+            i++;
+        }
+    }
+}
+
+// -- quadlet 24-bit, AVX2: 8 ports -- //
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX2 __m256i
+decodeQuadlet24Vector8(__m256i v)
+{
+    v = _mm256_srai_epi32(v, 8);
+    if (is_float) {
+        return _mm256_castps_si256(_mm256_mul_ps(_mm256_cvtepi32_ps(v),
+                                                 _mm256_set1_ps(QUADLET24_FLOAT_RECIPROCAL)));
+    }
+    return v;
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX2 __m256i
+encodeQuadlet24Vector8(__m256i v)
+{
+    if (is_float) {
+        __m256 v_float = _mm256_castsi256_ps(v);
+#if RME_CLIP_FLOATS
+        v_float = _mm256_max_ps(v_float, _mm256_set1_ps(-1.0f));
+        v_float = _mm256_min_ps(v_float, _mm256_set1_ps(1.0f));
+#endif
+        v = _mm256_cvtps_epi32(_mm256_mul_ps(v_float, _mm256_set1_ps(QUADLET24_FLOAT_MULTIPLIER)));
+    }
+    return _mm256_slli_epi32(v, 8);
+}
+
+#define DECODE_QUADLET24_AVX2_LOAD(k) \
+    decodeQuadlet24Vector8<is_float>(_mm256_loadu_si256((const __m256i *)(source + (j + k) * dimension)))
+#define DECODE_QUADLET24_AVX2_STORE(k) \
+    _mm256_storeu_si256((__m256i *)(dst##k + j), r##k)
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX2 void
+decodeQuadlet24AVX2x8(const quadlet_t *data, unsigned int dimension, unsigned int pos,
+                      void * const *buffers, unsigned int nevents)
+{
+    uint32_t *dst0 = (uint32_t *)buffers[0];
+    uint32_t *dst1 = (uint32_t *)buffers[1];
+    uint32_t *dst2 = (uint32_t *)buffers[2];
+    uint32_t *dst3 = (uint32_t *)buffers[3];
+    uint32_t *dst4 = (uint32_t *)buffers[4];
+    uint32_t *dst5 = (uint32_t *)buffers[5];
+    uint32_t *dst6 = (uint32_t *)buffers[6];
+    uint32_t *dst7 = (uint32_t *)buffers[7];
+    const quadlet_t *source = data + pos;
+    unsigned int nvec = vectorLoadEvents(pos, 8, dimension, nevents);
+
+    unsigned int j = 0;
+    for (; j + 8 <= nvec; j += 8) {
+        __m256i r0 = DECODE_QUADLET24_AVX2_LOAD(0);
+        __m256i r1 = DECODE_QUADLET24_AVX2_LOAD(1);
+        __m256i r2 = DECODE_QUADLET24_AVX2_LOAD(2);
+        __m256i r3 = DECODE_QUADLET24_AVX2_LOAD(3);
+        __m256i r4 = DECODE_QUADLET24_AVX2_LOAD(4);
+        __m256i r5 = DECODE_QUADLET24_AVX2_LOAD(5);
+        __m256i r6 = DECODE_QUADLET24_AVX2_LOAD(6);
+        __m256i r7 = DECODE_QUADLET24_AVX2_LOAD(7);
+        TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7);
+        DECODE_QUADLET24_AVX2_STORE(0);
+        DECODE_QUADLET24_AVX2_STORE(1);
+        DECODE_QUADLET24_AVX2_STORE(2);
+        DECODE_QUADLET24_AVX2_STORE(3);
+        DECODE_QUADLET24_AVX2_STORE(4);
+        DECODE_QUADLET24_AVX2_STORE(5);
+        DECODE_QUADLET24_AVX2_STORE(6);
+        DECODE_QUADLET24_AVX2_STORE(7);
+    }
+    for (; j < nvec; j++) {
+        uint32_t tmp[8];
+        __m256i v = _mm256_loadu_si256((const __m256i *)(source + j * dimension));
+        _mm256_storeu_si256((__m256i *)tmp, decodeQuadlet24Vector8<is_float>(v));
+        dst0[j] = tmp[0];
+        dst1[j] = tmp[1];
+        dst2[j] = tmp[2];
+        dst3[j] = tmp[3];
+        dst4[j] = tmp[4];
+        dst5[j] = tmp[5];
+        dst6[j] = tmp[6];
+        dst7[j] = tmp[7];
+    }
+    for (unsigned int k = 0; k < 8; k++) {
+        decodeQuadlet24Port<is_float>(source + k, dimension, buffers[k], nvec, nevents);
+    }
+}
+
+#define ENCODE_QUADLET24_AVX2_LOAD(k) \
+    encodeQuadlet24Vector8<is_float>(_mm256_loadu_si256((const __m256i *)(src##k + j)))
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX2 void
+encodeQuadlet24AVX2x8(quadlet_t *data, unsigned int dimension, unsigned int pos,
+                      void * const *buffers, unsigned int nevents)
+{
+    const uint32_t *src0 = (const uint32_t *)buffers[0];
+    const uint32_t *src1 = (const uint32_t *)buffers[1];
+    const uint32_t *src2 = (const uint32_t *)buffers[2];
+    const uint32_t *src3 = (const uint32_t *)buffers[3];
+    const uint32_t *src4 = (const uint32_t *)buffers[4];
+    const uint32_t *src5 = (const uint32_t *)buffers[5];
+    const uint32_t *src6 = (const uint32_t *)buffers[6];
+    const uint32_t *src7 = (const uint32_t *)buffers[7];
+    quadlet_t *target = data + pos;
+
+    unsigned int j = 0;
+    for (; j + 8 <= nevents; j += 8) {
+        __m256i r0 = ENCODE_QUADLET24_AVX2_LOAD(0);
+        __m256i r1 = ENCODE_QUADLET24_AVX2_LOAD(1);
+        __m256i r2 = ENCODE_QUADLET24_AVX2_LOAD(2);
+        __m256i r3 = ENCODE_QUADLET24_AVX2_LOAD(3);
+        __m256i r4 = ENCODE_QUADLET24_AVX2_LOAD(4);
+        __m256i r5 = ENCODE_QUADLET24_AVX2_LOAD(5);
+        __m256i r6 = ENCODE_QUADLET24_AVX2_LOAD(6);
+        __m256i r7 = ENCODE_QUADLET24_AVX2_LOAD(7);
+        TRANSPOSE8X8_AVX2(r0, r1, r2, r3, r4, r5, r6, r7);
+        quadlet_t *t = target + j * dimension;
+        _mm256_storeu_si256((__m256i *)t, r0); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r1); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r2); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r3); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r4); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r5); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r6); t += dimension;
+        _mm256_storeu_si256((__m256i *)t, r7);
+    }
+    for (; j < nevents; j++) {
+        __m256i v = _mm256_set_epi32(src7[j], src6[j], src5[j], src4[j],
+                                     src3[j], src2[j], src1[j], src0[j]);
+        _mm256_storeu_si256((__m256i *)(target + j * dimension),
+                            encodeQuadlet24Vector8<is_float>(v));
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX2 void
+decodeQuadlet24AVX2(const quadlet_t *data, unsigned int dimension,
+                    const unsigned int *positions, void * const *buffers,
+                    unsigned int nb_ports, unsigned int nevents)
+{
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 8, 1)) {
+            decodeQuadlet24AVX2x8<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 8;
+        } else if (isPortRun(positions + i, nb_ports - i, 4, 1)) {
+            // legacy SSE code, avoid the AVX-SSE transition penalty
+            _mm256_zeroupper();
+            decodeQuadlet24SSE2x4<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 4;
+        } else {
+            decodeQuadlet24Port<is_float>(data + positions[i], dimension, buffers[i], 0, nevents);
+            i++;
+        }
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX2 void
+encodeQuadlet24AVX2(quadlet_t *data, unsigned int dimension,
+                    const unsigned int *positions, void * const *buffers,
+                    unsigned int nb_ports, unsigned int nevents)
+{
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 8, 1)) {
+            encodeQuadlet24AVX2x8<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 8;
+        } else if (isPortRun(positions + i, nb_ports - i, 4, 1)) {
+            // legacy SSE code, avoid the AVX-SSE transition penalty
+            _mm256_zeroupper();
+            encodeQuadlet24SSE2x4<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 4;
+        } else {
+            encodeQuadlet24Port<is_float>(data + positions[i], dimension, buffers[i], 0, nevents);
+            i++;
+        }
+    }
+}
+
+// -- quadlet 24-bit, AVX-512: 16 ports -- //
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 __m512i
+decodeQuadlet24Vector16(__m512i v)
+{
+    v = _mm512_srai_epi32(v, 8);
+    if (is_float) {
+        return _mm512_castps_si512(_mm512_mul_ps(_mm512_cvtepi32_ps(v),
+                                                 _mm512_set1_ps(QUADLET24_FLOAT_RECIPROCAL)));
+    }
+    return v;
+}
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 __m512i
+encodeQuadlet24Vector16(__m512i v)
+{
+    if (is_float) {
+        __m512 v_float = _mm512_castsi512_ps(v);
+#if RME_CLIP_FLOATS
+        v_float = _mm512_max_ps(v_float, _mm512_set1_ps(-1.0f));
+        v_float = _mm512_min_ps(v_float, _mm512_set1_ps(1.0f));
+#endif
+        v = _mm512_cvtps_epi32(_mm512_mul_ps(v_float, _mm512_set1_ps(QUADLET24_FLOAT_MULTIPLIER)));
+    }
+    return _mm512_slli_epi32(v, 8);
+}
+
+#define DECODE_QUADLET24_AVX512_LOAD(k) \
+    decodeQuadlet24Vector16<is_float>(_mm512_loadu_si512((const void *)(source + (j + k) * dimension)))
+#define DECODE_QUADLET24_AVX512_STORE(k) \
+    _mm512_storeu_si512((void *)((uint32_t *)buffers[k] + j), r##k)
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 void
+decodeQuadlet24AVX512x16(const quadlet_t *data, unsigned int dimension, unsigned int pos,
+                         void * const *buffers, unsigned int nevents)
+{
+    const quadlet_t *source = data + pos;
+    unsigned int nvec = vectorLoadEvents(pos, 16, dimension, nevents);
+
+    unsigned int j = 0;
+    for (; j + 16 <= nvec; j += 16) {
+        __m512i r0  = DECODE_QUADLET24_AVX512_LOAD(0);
+        __m512i r1  = DECODE_QUADLET24_AVX512_LOAD(1);
+        __m512i r2  = DECODE_QUADLET24_AVX512_LOAD(2);
+        __m512i r3  = DECODE_QUADLET24_AVX512_LOAD(3);
+        __m512i r4  = DECODE_QUADLET24_AVX512_LOAD(4);
+        __m512i r5  = DECODE_QUADLET24_AVX512_LOAD(5);
+        __m512i r6  = DECODE_QUADLET24_AVX512_LOAD(6);
+        __m512i r7  = DECODE_QUADLET24_AVX512_LOAD(7);
+        __m512i r8  = DECODE_QUADLET24_AVX512_LOAD(8);
+        __m512i r9  = DECODE_QUADLET24_AVX512_LOAD(9);
+        __m512i r10 = DECODE_QUADLET24_AVX512_LOAD(10);
+        __m512i r11 = DECODE_QUADLET24_AVX512_LOAD(11);
+        __m512i r12 = DECODE_QUADLET24_AVX512_LOAD(12);
+        __m512i r13 = DECODE_QUADLET24_AVX512_LOAD(13);
+        __m512i r14 = DECODE_QUADLET24_AVX512_LOAD(14);
+        __m512i r15 = DECODE_QUADLET24_AVX512_LOAD(15);
+
+        TRANSPOSE16X16_AVX512();
+
+        DECODE_QUADLET24_AVX512_STORE(0);
+        DECODE_QUADLET24_AVX512_STORE(1);
+        DECODE_QUADLET24_AVX512_STORE(2);
+        DECODE_QUADLET24_AVX512_STORE(3);
+        DECODE_QUADLET24_AVX512_STORE(4);
+        DECODE_QUADLET24_AVX512_STORE(5);
+        DECODE_QUADLET24_AVX512_STORE(6);
+        DECODE_QUADLET24_AVX512_STORE(7);
+        DECODE_QUADLET24_AVX512_STORE(8);
+        DECODE_QUADLET24_AVX512_STORE(9);
+        DECODE_QUADLET24_AVX512_STORE(10);
+        DECODE_QUADLET24_AVX512_STORE(11);
+        DECODE_QUADLET24_AVX512_STORE(12);
+        DECODE_QUADLET24_AVX512_STORE(13);
+        DECODE_QUADLET24_AVX512_STORE(14);
+        DECODE_QUADLET24_AVX512_STORE(15);
+    }
+    if (j < nevents) {
+        // the 8-port kernels are a better fit for the tail
+        void *tail[16];
+        for (int k = 0; k < 16; k++) {
+            tail[k] = (void *)((uint32_t *)buffers[k] + j);
+        }
+        decodeQuadlet24AVX2x8<is_float>(data + j * dimension, dimension, pos,
+                                        tail, nevents - j);
+        decodeQuadlet24AVX2x8<is_float>(data + j * dimension, dimension, pos + 8,
+                                        tail + 8, nevents - j);
+    }
+}
+
+#define ENCODE_QUADLET24_AVX512_LOAD(k) \
+    encodeQuadlet24Vector16<is_float>(_mm512_loadu_si512((const void *)((const uint32_t *)buffers[k] + j)))
+#define ENCODE_QUADLET24_AVX512_STORE(k) \
+    _mm512_storeu_si512((void *)(target + (j + k) * dimension), r##k)
+
+template <bool is_float>
+static inline FFADO_TARGET_AVX512 void
+encodeQuadlet24AVX512x16(quadlet_t *data, unsigned int dimension, unsigned int pos,
+                         void * const *buffers, unsigned int nevents)
+{
+    quadlet_t *target = data + pos;
+
+    unsigned int j = 0;
+    for (; j + 16 <= nevents; j += 16) {
+        __m512i r0  = ENCODE_QUADLET24_AVX512_LOAD(0);
+        __m512i r1  = ENCODE_QUADLET24_AVX512_LOAD(1);
+        __m512i r2  = ENCODE_QUADLET24_AVX512_LOAD(2);
+        __m512i r3  = ENCODE_QUADLET24_AVX512_LOAD(3);
+        __m512i r4  = ENCODE_QUADLET24_AVX512_LOAD(4);
+        __m512i r5  = ENCODE_QUADLET24_AVX512_LOAD(5);
+        __m512i r6  = ENCODE_QUADLET24_AVX512_LOAD(6);
+        __m512i r7  = ENCODE_QUADLET24_AVX512_LOAD(7);
+        __m512i r8  = ENCODE_QUADLET24_AVX512_LOAD(8);
+        __m512i r9  = ENCODE_QUADLET24_AVX512_LOAD(9);
+        __m512i r10 = ENCODE_QUADLET24_AVX512_LOAD(10);
+        __m512i r11 = ENCODE_QUADLET24_AVX512_LOAD(11);
+        __m512i r12 = ENCODE_QUADLET24_AVX512_LOAD(12);
+        __m512i r13 = ENCODE_QUADLET24_AVX512_LOAD(13);
+        __m512i r14 = ENCODE_QUADLET24_AVX512_LOAD(14);
+        __m512i r15 = ENCODE_QUADLET24_AVX512_LOAD(15);
+
+        TRANSPOSE16X16_AVX512();
+
+        ENCODE_QUADLET24_AVX512_STORE(0);
+        ENCODE_QUADLET24_AVX512_STORE(1);
+        ENCODE_QUADLET24_AVX512_STORE(2);
+        ENCODE_QUADLET24_AVX512_STORE(3);
+        ENCODE_QUADLET24_AVX512_STORE(4);
+        ENCODE_QUADLET24_AVX512_STORE(5);
+        ENCODE_QUADLET24_AVX512_STORE(6);
+        ENCODE_QUADLET24_AVX512_STORE(7);
+        ENCODE_QUADLET24_AVX512_STORE(8);
+        ENCODE_QUADLET24_AVX512_STORE(9);
+        ENCODE_QUADLET24_AVX512_STORE(10);
+        ENCODE_QUADLET24_AVX512_STORE(11);
+        ENCODE_QUADLET24_AVX512_STORE(12);
+        ENCODE_QUADLET24_AVX512_STORE(13);
+        ENCODE_QUADLET24_AVX512_STORE(14);
+        ENCODE_QUADLET24_AVX512_STORE(15);
+    }
+    if (j < nevents) {
+        // the 8-port kernels are a better fit for the tail
+        void *tail[16];
+        for (int k = 0; k < 16; k++) {
+            tail[k] = (void *)((uint32_t *)buffers[k] + j);
+        }
+        encodeQuadlet24AVX2x8<is_float>(target + j * dimension, dimension, 0,
+                                        tail, nevents - j);
+        encodeQuadlet24AVX2x8<is_float>(target + j * dimension, dimension, 8,
+                                        tail + 8, nevents - j);
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX512 void
+decodeQuadlet24AVX512(const quadlet_t *data, unsigned int dimension,
+                      const unsigned int *positions, void * const *buffers,
+                      unsigned int nb_ports, unsigned int nevents)
+{
+    if (nevents < 16) {
+        decodeQuadlet24AVX2<is_float>(data, dimension, positions, buffers, nb_ports, nevents);
+        return;
+    }
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 16, 1)) {
+            decodeQuadlet24AVX512x16<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 16;
+        } else {
+            // hand everything up to the next run to the AVX2 kernel
+            unsigned int n = 1;
+            while (i + n < nb_ports
+                   && !isPortRun(positions + i + n, nb_ports - i - n, 16, 1)) {
+                n++;
+            }
+            decodeQuadlet24AVX2<is_float>(data, dimension, positions + i, buffers + i, n, nevents);
+            i += n;
+        }
+    }
+}
+
+template <bool is_float>
+static FFADO_TARGET_AVX512 void
+encodeQuadlet24AVX512(quadlet_t *data, unsigned int dimension,
+                      const unsigned int *positions, void * const *buffers,
+                      unsigned int nb_ports, unsigned int nevents)
+{
+    if (nevents < 16) {
+        encodeQuadlet24AVX2<is_float>(data, dimension, positions, buffers, nb_ports, nevents);
+        return;
+    }
+    unsigned int i = 0;
+    while (i < nb_ports) {
+        if (isPortRun(positions + i, nb_ports - i, 16, 1)) {
+            encodeQuadlet24AVX512x16<is_float>(data, dimension, positions[i], buffers + i, nevents);
+            i += 16;
+        } else {
+            unsigned int n = 1;
+            while (i + n < nb_ports
+                   && !isPortRun(positions + i + n, nb_ports - i - n, 16, 1)) {
+                n++;
+            }
+            encodeQuadlet24AVX2<is_float>(data, dimension, positions + i, buffers + i, n, nevents);
+            i += n;
+        }
+    }
+}
+
+#pragma GCC diagnostic pop
+
+#endif // FFADO_HAVE_X86_SIMD_DISPATCH
+
+// ordered by simd level
+static const struct AudioKernels audio_kernels[] = {
+    { Util::CpuFeatures::eSL_Scalar, "scalar",
+        encodeAM824Scalar<true>, encodeAM824Scalar<false>,
+        decodeAM824Scalar<true>, decodeAM824Scalar<false>,
+        encodePacked24Scalar<true>, encodePacked24Scalar<false>,
+        decodePacked24Scalar<true>, decodePacked24Scalar<false>,
+        encodeQuadlet24Scalar<true>, encodeQuadlet24Scalar<false>,
+        decodeQuadlet24Scalar<true>, decodeQuadlet24Scalar<false> },
+#if FFADO_HAVE_X86_SIMD_DISPATCH
+    { Util::CpuFeatures::eSL_SSE2, "sse2",
+        encodeAM824SSE2<true>, encodeAM824SSE2<false>,
+        decodeAM824SSE2<true>, decodeAM824SSE2<false>,
+        encodePacked24Scalar<true>, encodePacked24Scalar<false>,
+        decodePacked24Scalar<true>, decodePacked24Scalar<false>,
+        encodeQuadlet24SSE2<true>, encodeQuadlet24SSE2<false>,
+        decodeQuadlet24SSE2<true>, decodeQuadlet24SSE2<false> },
+    { Util::CpuFeatures::eSL_AVX2, "avx2",
+        encodeAM824AVX2<true>, encodeAM824AVX2<false>,
+        decodeAM824AVX2<true>, decodeAM824AVX2<false>,
+        encodePacked24AVX2<true>, encodePacked24AVX2<false>,
+        decodePacked24AVX2<true>, decodePacked24AVX2<false>,
+        encodeQuadlet24AVX2<true>, encodeQuadlet24AVX2<false>,
+        decodeQuadlet24AVX2<true>, decodeQuadlet24AVX2<false> },
+    { Util::CpuFeatures::eSL_AVX512, "avx512",
+        encodeAM824AVX512<true>, encodeAM824AVX512<false>,
+        decodeAM824AVX512<true>, decodeAM824AVX512<false>,
+        encodePacked24AVX512<true>, encodePacked24AVX512<false>,
+        decodePacked24AVX512<true>, decodePacked24AVX512<false>,
+        encodeQuadlet24AVX512<true>, encodeQuadlet24AVX512<false>,
+        decodeQuadlet24AVX512<true>, decodeQuadlet24AVX512<false> },
+#endif
+};
+
+const struct AudioKernels &
+getAudioKernels(enum Util::CpuFeatures::eSimdLevel level)
+{
+    level = Util::CpuFeatures::selectSimdLevel(level);
+    unsigned int idx = 0;
+    for (unsigned int i = 0; i < sizeof(audio_kernels) / sizeof(audio_kernels[0]); i++) {
+        if (audio_kernels[i].level <= level) {
+            idx = i;
+        }
+    }
+    return audio_kernels[idx];
+}
+
+} // end of namespace Streaming
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2014 by FFADO developers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_AUDIOKERNELS__
+#define __FFADO_AUDIOKERNELS__
+
+#include "ffadotypes.h"
+#include "libutil/CpuFeatures.h"
+
+namespace Streaming {
+
+/**
+ * @brief encodes a number of audio ports into interleaved AM824 events
+ *
+ * The sample for port i of event j is taken from buffers[i][j] and
+ * written as a labeled, bus-ordered MBLA quadlet to data[j*dimension + i].
+ * The buffer pointers have to point to the first sample to encode, i.e.
+ * any offset into the port buffer has to be applied by the caller. Disabled
+ * ports can be encoded as silence by passing a zero-filled buffer.
+ *
+ * @param data pointer to the first event of the packet payload
+ * @param dimension number of quadlets in one event
+ * @param buffers array of nb_ports pointers to the port buffers
+ * @param nb_ports number of (consecutive) audio ports
+ * @param nevents number of events to encode
+ */
+typedef void (*am824_encode_func_t)(quadlet_t *data, unsigned int dimension,
+                                    void * const *buffers, unsigned int nb_ports,
+                                    unsigned int nevents);
+
+/**
+ * @brief decodes interleaved AM824 events into a number of audio ports
+ *
+ * The inverse of am824_encode_func_t: the quadlet data[j*dimension + i]
+ * is decoded and written to buffers[i][j]. Int24 ports receive the 24-bit
+ * sample without sign extension, float ports the sign-extended sample
+ * scaled to [-1.0, 1.0]. Ports that are not of interest can be pointed
+ * at a common scratch buffer.
+ *
+ * @param data pointer to the first event of the packet payload
+ * @param dimension number of quadlets in one event
+ * @param buffers array of nb_ports pointers to the port buffers
+ * @param nb_ports number of (consecutive) audio ports
+ * @param nevents number of events to decode
+ */
+typedef void (*am824_decode_func_t)(const quadlet_t *data, unsigned int dimension,
+                                    void * const *buffers, unsigned int nb_ports,
+                                    unsigned int nevents);
+
+/**
+ * @brief encodes a number of audio ports into packed 24-bit events
+ *
+ * Samples are stored as 3 big-endian bytes at a byte position within the
+ * event, as used by the MOTU and Digidesign devices. The sample for port i of event j is
+ * taken from buffers[i][j] and written to data + j*event_size + positions[i].
+ * Adjacent ports, i.e. positions increasing in steps of 3, are the fast
+ * path. Only the 3 sample bytes of each port are written.
+ *
+ * @param data pointer to the first event
+ * @param event_size size of one event in bytes
+ * @param positions array of nb_ports byte positions
+ * @param buffers array of nb_ports pointers to the port buffers
+ * @param nb_ports number of audio ports
+ * @param nevents number of events to encode
+ */
+typedef void (*packed24_encode_func_t)(byte_t *data, unsigned int event_size,
+                                       const unsigned int *positions, void * const *buffers,
+                                       unsigned int nb_ports, unsigned int nevents);
+
+/**
+ * @brief decodes packed 24-bit events into a number of audio ports
+ *
+ * The inverse of packed24_encode_func_t. Int24 ports receive the
+ * sign-extended sample, float ports the sample scaled to [-1.0, 1.0].
+ */
+typedef void (*packed24_decode_func_t)(const byte_t *data, unsigned int event_size,
+                                       const unsigned int *positions, void * const *buffers,
+                                       unsigned int nb_ports, unsigned int nevents);
+
+/**
+ * @brief encodes a number of audio ports into quadlet 24-bit events
+ *
+ * Samples are stored in the most significant 24 bits of a host-order
+ * quadlet at a quadlet position within the event, as used by the RME
+ * devices. The sample for port i of event j is taken from buffers[i][j]
+ * and written to data[j*dimension + positions[i]]. Adjacent ports are
+ * the fast path.
+ *
+ * @param data pointer to the first event
+ * @param dimension number of quadlets in one event
+ * @param positions array of nb_ports quadlet positions
+ * @param buffers array of nb_ports pointers to the port buffers
+ * @param nb_ports number of audio ports
+ * @param nevents number of events to encode
+ */
+typedef void (*quadlet24_encode_func_t)(quadlet_t *data, unsigned int dimension,
+                                        const unsigned int *positions, void * const *buffers,
+                                        unsigned int nb_ports, unsigned int nevents);
+
+/**
+ * @brief decodes quadlet 24-bit events into a number of audio ports
+ *
+ * The inverse of quadlet24_encode_func_t. Int24 ports receive the
+ * sign-extended sample, float ports the sample scaled to [-1.0, 1.0].
+ */
+typedef void (*quadlet24_decode_func_t)(const quadlet_t *data, unsigned int dimension,
+                                        const unsigned int *positions, void * const *buffers,
+                                        unsigned int nb_ports, unsigned int nevents);
+
+/**
+ * A family of sample conversion kernels, all implemented for the
+ * same instruction set.
+ */
+struct AudioKernels {
+    enum Util::CpuFeatures::eSimdLevel level;
+    const char *name;
+    am824_encode_func_t encodeAM824Float;
+    am824_encode_func_t encodeAM824Int24;
+    am824_decode_func_t decodeAM824Float;
+    am824_decode_func_t decodeAM824Int24;
+    packed24_encode_func_t encodePacked24Float;
+    packed24_encode_func_t encodePacked24Int24;
+    packed24_decode_func_t decodePacked24Float;
+    packed24_decode_func_t decodePacked24Int24;
+    quadlet24_encode_func_t encodeQuadlet24Float;
+    quadlet24_encode_func_t encodeQuadlet24Int24;
+    quadlet24_decode_func_t decodeQuadlet24Float;
+    quadlet24_decode_func_t decodeQuadlet24Int24;
+};
+
+/**
+ * @brief get the kernel family for a simd level
+ *
+ * The level is clamped to what the processor supports, hence the
+ * returned kernels are always safe to call.
+ *
+ * @param level the requested simd level
+ * @return the kernel family
+ */
+const struct AudioKernels &getAudioKernels(enum Util::CpuFeatures::eSimdLevel level);
+
+} // end of namespace Streaming
+
+#endif /* __FFADO_AUDIOKERNELS__ */
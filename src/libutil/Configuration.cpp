@@ -291,6 +291,26 @@ Configuration::getValueForSetting(std::string path, float &ref)
     }
 }
 
+bool
+Configuration::getValueForSetting(std::string path, std::string &ref)
+{
+    libconfig::Setting *s = getSetting( path );
+    if(s) {
+        Setting::Type t = s->getType();
+        if(t == Setting::TypeString) {
+            ref = (const char *)*s;
+            debugOutput(DEBUG_LEVEL_VERY_VERBOSE, "path '%s' has value %s\n", path.c_str(), ref.c_str());
+            return true;
+        } else {
+            debugWarning("path '%s' has wrong type\n", path.c_str());
+            return false;
+        }
+    } else {
+        debugOutput(DEBUG_LEVEL_VERY_VERBOSE, "path '%s' not found\n", path.c_str());
+        return false;
+    }
+}
+
 libconfig::Setting *
 Configuration::getSetting( std::string path )
 {
@@ -133,6 +133,7 @@ public:
     bool getValueForSetting(std::string path, int32_t &ref);
     bool getValueForSetting(std::string path, int64_t &ref);
     bool getValueForSetting(std::string path, float &ref);
+    bool getValueForSetting(std::string path, std::string &ref);
 
     /**
      * @brief retrieves a setting for a given device
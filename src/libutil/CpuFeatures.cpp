@@ -0,0 +1,92 @@
+/*
+ * Copyright (C) 2014 by FFADO developers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "CpuFeatures.h"
+
+namespace Util {
+
+enum CpuFeatures::eSimdLevel
+CpuFeatures::getSupportedSimdLevel()
+{
+#if FFADO_HAVE_X86_SIMD_DISPATCH
+    static enum eSimdLevel level = eSL_Scalar;
+    static bool detected = false;
+    if (!detected) {
+        // __builtin_cpu_supports() also takes care of checking whether
+        // the OS saves the extended register state (XCR0)
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")
+            && __builtin_cpu_supports("avx512bw")) {
+            level = eSL_AVX512;
+        } else if (__builtin_cpu_supports("avx2")) {
+            level = eSL_AVX2;
+        } else if (__builtin_cpu_supports("sse2")) {
+            level = eSL_SSE2;
+        }
+        detected = true;
+    }
+    return level;
+#else
+    return eSL_Scalar;
+#endif
+}
+
+enum CpuFeatures::eSimdLevel
+CpuFeatures::selectSimdLevel(enum eSimdLevel requested)
+{
+    enum eSimdLevel supported = getSupportedSimdLevel();
+    return (requested > supported ? supported : requested);
+}
+
+bool
+CpuFeatures::parseSimdLevel(const std::string &s, enum eSimdLevel &ref)
+{
+    if (s == "auto") {
+        ref = getSupportedSimdLevel();
+    } else if (s == "scalar" || s == "none") {
+        ref = eSL_Scalar;
+    } else if (s == "sse2") {
+        ref = eSL_SSE2;
+    } else if (s == "avx2") {
+        ref = eSL_AVX2;
+    } else if (s == "avx512") {
+        ref = eSL_AVX512;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char *
+CpuFeatures::simdLevelToString(enum eSimdLevel l)
+{
+    switch (l) {
+        case eSL_Scalar: return "scalar";
+        case eSL_SSE2:   return "sse2";
+        case eSL_AVX2:   return "avx2";
+        case eSL_AVX512: return "avx512";
+        default:         return "invalid";
+    }
+}
+
+} // end of namespace Util
@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2014 by FFADO developers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_CPUFEATURES__
+#define __FFADO_CPUFEATURES__
+
+#include <string>
+
+// runtime dispatch needs the GCC target attributes and cpu builtins
+#if defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+    #define FFADO_HAVE_X86_SIMD_DISPATCH 1
+#else
+    #define FFADO_HAVE_X86_SIMD_DISPATCH 0
+#endif
+
+namespace Util {
+
+/**
+ * Runtime detection of the vector instruction sets the processor
+ * supports. The streaming code uses this to pick the widest
+ * encode/decode kernels at prepare time instead of at build time,
+ * such that one binary runs optimally on all machines.
+ */
+class CpuFeatures
+{
+private: // don't allow objects to be created
+    CpuFeatures() {};
+    virtual ~CpuFeatures() {};
+
+public:
+    // ordered from narrow to wide, a level implies all lower ones
+    enum eSimdLevel {
+        eSL_Scalar = 0,
+        eSL_SSE2   = 1,
+        eSL_AVX2   = 2,
+        eSL_AVX512 = 3,
+    };
+
+    /**
+     * @brief get the widest instruction set supported by the CPU and OS
+     * @return the simd level
+     */
+    static enum eSimdLevel getSupportedSimdLevel();
+
+    /**
+     * @brief clamp a requested level to what is supported
+     * @param requested the level asked for
+     * @return the requested level, or the supported one if lower
+     */
+    static enum eSimdLevel selectSimdLevel(enum eSimdLevel requested);
+
+    /**
+     * @brief parse a simd level name ("auto", "scalar", "sse2", "avx2", "avx512")
+     *
+     * "auto" results in the supported level. The ref parameter is not
+     * changed if the function returns false.
+     *
+     * @param s the name
+     * @param ref the parsed level
+     * @return true if successful, false if the name is unknown
+     */
+    static bool parseSimdLevel(const std::string &s, enum eSimdLevel &ref);
+
+    static const char *simdLevelToString(enum eSimdLevel l);
+};
+
+} // end of namespace Util
+
+#endif /* __FFADO_CPUFEATURES__ */
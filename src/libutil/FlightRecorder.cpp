@@ -0,0 +1,418 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "FlightRecorder.h"
+
+#include "PosixThread.h"
+#include "PosixMutex.h"
+
+#include <unistd.h>
+#include <string.h>
+#include <errno.h>
+#include <algorithm>
+
+namespace Util {
+
+IMPL_DEBUG_MODULE( FlightRecorder, FlightRecorder, DEBUG_LEVEL_NORMAL );
+
+FlightRecorder::Channel::Channel(const std::string &name, unsigned int nb_records)
+    : m_name( name )
+    , m_records( NULL )
+    , m_mask( 0 )
+    , m_head( 0 )
+{
+    unsigned int size = roundSize(nb_records);
+    m_records = new struct flight_record[size];
+    memset(m_records, 0, size * sizeof(struct flight_record));
+    m_mask = size - 1;
+}
+
+FlightRecorder::Channel::~Channel()
+{
+    delete[] m_records;
+}
+
+unsigned int
+FlightRecorder::Channel::roundSize(unsigned int nb_records)
+{
+    unsigned int size = 1;
+    while (size < nb_records) {
+        size <<= 1;
+    }
+    return size;
+}
+
+unsigned int
+FlightRecorder::Channel::snapshot(struct flight_record *to)
+{
+    uint64_t head = m_head;
+    SEQLOCK_READ_BARRIER();
+    uint64_t nb_records = (head < getSize() ? head : getSize());
+    unsigned int copied = 0;
+    for (uint64_t i = head - nb_records; i < head; i++) {
+        struct flight_record *r = &m_records[i & m_mask];
+        to[copied] = *r;
+        SEQLOCK_READ_BARRIER();
+        // skip the records that are still being written,
+        // or that were overwritten while copying
+        if (to[copied].sequence == i + 1 && r->sequence == i + 1) {
+            copied++;
+        }
+    }
+    return copied;
+}
+
+// ------------------------------------------------------------------------
+
+FlightRecorder::FlightRecorder()
+    : m_lock( new PosixMutex("FLIGHTREC") )
+    , m_dump_pending( 0 )
+    , m_max_dumps( 0 )
+    , m_nb_dumps( 0 )
+    , m_thread( NULL )
+    , m_stop( false )
+{
+    memset(&m_snapshot_header, 0, sizeof(m_snapshot_header));
+    sem_init(&m_dump_semaphore, 0, 0);
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    stop();
+    for (unsigned int i = 0; i < m_channels.size(); i++) {
+        delete m_channels.at(i);
+    }
+    for (unsigned int i = 0; i < m_retired_channels.size(); i++) {
+        delete m_retired_channels.at(i);
+    }
+    sem_destroy(&m_dump_semaphore);
+    delete m_lock;
+}
+
+bool
+FlightRecorder::start(const std::string &dir, unsigned int max_dumps)
+{
+    if (m_thread) {
+        return true;
+    }
+    if (access(dir.c_str(), W_OK) != 0) {
+        debugWarning("Can't write xrun flight records to %s: %s\n", dir.c_str(), strerror(errno));
+        return false;
+    }
+    m_dir = dir;
+    m_max_dumps = max_dumps;
+    m_stop = false;
+    m_thread = new PosixThread(this, "FLIGHTREC", false, 0, PTHREAD_CANCEL_DEFERRED);
+    if (m_thread->Start() != 0) {
+        debugError("Could not start the flight recorder thread\n");
+        delete m_thread;
+        m_thread = NULL;
+        return false;
+    }
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Writing xrun flight records to %s\n", dir.c_str());
+    return true;
+}
+
+void
+FlightRecorder::stop()
+{
+    if (m_thread == NULL) {
+        return;
+    }
+    m_stop = true;
+    sem_post(&m_dump_semaphore);
+    m_thread->Stop();
+    delete m_thread;
+    m_thread = NULL;
+    m_dump_pending = 0;
+}
+
+FlightRecorder::Channel *
+FlightRecorder::addChannel(const std::string &name, unsigned int nb_records)
+{
+    lockIdleSnapshot();
+    if (m_channels.size() >= FLIGHT_RECORDER_MAX_CHANNELS) {
+        m_lock->Unlock();
+        debugWarning("Too many flight recorder channels, not recording %s\n", name.c_str());
+        return NULL;
+    }
+    Channel *c = NULL;
+    // reuse a removed channel of the same size, the snapshot has room for it
+    unsigned int size = Channel::roundSize(nb_records);
+    for (std::vector<Channel *>::iterator it = m_retired_channels.begin();
+         it != m_retired_channels.end();
+         ++it) {
+        if ((*it)->getSize() == size) {
+            c = *it;
+            c->setName(name);
+            m_retired_channels.erase(it);
+            break;
+        }
+    }
+    if (c == NULL) {
+        c = new Channel(name, nb_records);
+        m_snapshot.resize(m_snapshot.size() + c->getSize());
+    }
+    m_channels.push_back(c);
+    m_snapshot_channels.resize(m_channels.size());
+    m_lock->Unlock();
+    return c;
+}
+
+void
+FlightRecorder::removeChannel(Channel *c)
+{
+    lockIdleSnapshot();
+    for (std::vector<Channel *>::iterator it = m_channels.begin();
+         it != m_channels.end();
+         ++it) {
+        if (*it == c) {
+            m_channels.erase(it);
+            // a stream thread might still be recording to it
+            m_retired_channels.push_back(c);
+            break;
+        }
+    }
+    m_lock->Unlock();
+}
+
+void
+FlightRecorder::lockIdleSnapshot()
+{
+    // the writer thread might still be using the snapshot, don't sleep
+    // with the lock held since trigger() needs it
+    while (true) {
+        m_lock->Lock();
+        if (!m_dump_pending) {
+            return;
+        }
+        m_lock->Unlock();
+        usleep(1000);
+    }
+}
+
+bool
+FlightRecorder::trigger(const char *reason)
+{
+    if (m_thread == NULL) {
+        return false;
+    }
+    if (m_nb_dumps >= m_max_dumps) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Maximum number of flight records written\n");
+        return false;
+    }
+
+    if (!m_lock->TryLock()) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Flight recorder channels being changed\n");
+        return false;
+    }
+    if (!__sync_bool_compare_and_swap(&m_dump_pending, 0, 1)) {
+        m_lock->Unlock();
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Previous flight record still being written\n");
+        return false;
+    }
+    struct flight_file_header *h = &m_snapshot_header;
+    memcpy(h->magic, FLIGHT_RECORDER_FILE_MAGIC, sizeof(h->magic));
+    h->version = FLIGHT_RECORDER_FILE_VERSION;
+    h->record_size = sizeof(struct flight_record);
+    h->nb_channels = m_channels.size();
+    h->trigger_time = SystemTimeSource::getCurrentTimeAsUsecs();
+    memset(h->reason, 0, sizeof(h->reason));
+    strncpy(h->reason, reason, sizeof(h->reason) - 1);
+
+    unsigned int offset = 0;
+    for (unsigned int i = 0; i < m_channels.size(); i++) {
+        Channel *c = m_channels.at(i);
+        struct flight_channel_header *ch = &m_snapshot_channels.at(i);
+        memset(ch, 0, sizeof(*ch));
+        strncpy(ch->name, c->getName().c_str(), sizeof(ch->name) - 1);
+        ch->nb_records = c->snapshot(&m_snapshot.at(offset));
+        offset += ch->nb_records;
+    }
+    m_lock->Unlock();
+    m_nb_dumps++;
+    sem_post(&m_dump_semaphore);
+    return true;
+}
+
+bool
+FlightRecorder::Execute()
+{
+    if (sem_wait(&m_dump_semaphore) < 0) {
+        // interrupted, try again
+        return true;
+    }
+    if (m_stop) {
+        return false;
+    }
+    writeDump();
+    __sync_synchronize();
+    m_dump_pending = 0;
+    return true;
+}
+
+bool
+FlightRecorder::writeDump()
+{
+    char filename[256];
+    snprintf(filename, sizeof(filename), "%s/ffado-xrun-%d-%u.bin",
+             m_dir.c_str(), (int)getpid(), m_nb_dumps);
+    FILE *f = fopen(filename, "w");
+    if (f == NULL) {
+        debugError("Could not open %s: %s\n", filename, strerror(errno));
+        return false;
+    }
+    bool ok = fwrite(&m_snapshot_header, sizeof(m_snapshot_header), 1, f) == 1;
+    unsigned int nb_records = 0;
+    for (unsigned int i = 0; ok && i < m_snapshot_header.nb_channels; i++) {
+        ok = fwrite(&m_snapshot_channels.at(i), sizeof(struct flight_channel_header), 1, f) == 1;
+        nb_records += m_snapshot_channels.at(i).nb_records;
+    }
+    if (ok && nb_records) {
+        ok = fwrite(&m_snapshot.at(0), sizeof(struct flight_record), nb_records, f) == nb_records;
+    }
+    if (fclose(f) != 0) {
+        ok = false;
+    }
+    if (!ok) {
+        debugError("Could not write %s\n", filename);
+        return false;
+    }
+    debugWarning("Xrun flight record written to %s\n", filename);
+    return true;
+}
+
+// ------------------------------------------------------------------------
+
+const char *
+FlightRecorder::eventTypeToString(unsigned int type)
+{
+    switch (type) {
+        case eET_PacketReceived:    return "recv";
+        case eET_PacketTransmitted: return "xmit";
+        case eET_Xrun:              return "XRUN";
+        case eET_PeriodTransfer:    return "transfer";
+        case eET_PeriodWake:        return "wake";
+        case eET_XrunDetected:      return "XRUN-DETECTED";
+        default:                    return "unknown";
+    }
+}
+
+// a record of a dump with the channel it belongs to
+struct FlightRecorderDecodedRecord
+{
+    unsigned int channel;
+    struct flight_record r;
+};
+
+static bool
+compareRecordTime(const FlightRecorderDecodedRecord &a, const FlightRecorderDecodedRecord &b)
+{
+    return a.r.time < b.r.time;
+}
+
+bool
+FlightRecorder::decode(FILE *in, FILE *out)
+{
+    struct flight_file_header h;
+    if (fread(&h, sizeof(h), 1, in) != 1
+        || memcmp(h.magic, FLIGHT_RECORDER_FILE_MAGIC, sizeof(h.magic)) != 0) {
+        fprintf(out, "Not an xrun flight record\n");
+        return false;
+    }
+    if (h.version != FLIGHT_RECORDER_FILE_VERSION
+        || h.record_size != sizeof(struct flight_record)) {
+        fprintf(out, "Unsupported flight record (version %u, record size %u)\n",
+                h.version, h.record_size);
+        return false;
+    }
+    h.reason[sizeof(h.reason) - 1] = 0;
+    if (h.nb_channels > FLIGHT_RECORDER_MAX_CHANNELS) {
+        fprintf(out, "Invalid flight record (%u channels)\n", h.nb_channels);
+        return false;
+    }
+
+    std::vector<struct flight_channel_header> channels(h.nb_channels);
+    for (unsigned int i = 0; i < h.nb_channels; i++) {
+        if (fread(&channels.at(i), sizeof(struct flight_channel_header), 1, in) != 1) {
+            fprintf(out, "Truncated flight record\n");
+            return false;
+        }
+        channels.at(i).name[FLIGHT_RECORDER_NAME_LEN - 1] = 0;
+    }
+    std::vector<FlightRecorderDecodedRecord> records;
+    for (unsigned int i = 0; i < h.nb_channels; i++) {
+        for (unsigned int j = 0; j < channels.at(i).nb_records; j++) {
+            FlightRecorderDecodedRecord d;
+            d.channel = i;
+            if (fread(&d.r, sizeof(struct flight_record), 1, in) != 1) {
+                fprintf(out, "Truncated flight record\n");
+                return false;
+            }
+            records.push_back(d);
+        }
+    }
+    std::stable_sort(records.begin(), records.end(), compareRecordTime);
+
+    fprintf(out, "Xrun flight record: %s\n", h.reason);
+    for (unsigned int i = 0; i < h.nb_channels; i++) {
+        fprintf(out, "  channel %2u: %-48s %6u events\n",
+                i, channels.at(i).name, channels.at(i).nb_records);
+    }
+    fprintf(out, "%12s %4s %-13s %5s %6s %12s  %s\n",
+            "time (us)", "chan", "event", "cycle", "fill", "timestamp", "details");
+    for (unsigned int i = 0; i < records.size(); i++) {
+        struct flight_record *r = &records.at(i).r;
+        // relative to the trigger, the history is negative
+        fprintf(out, "%12"PRId64" %4u %-13s %5d %6d %12"PRIu64"  ",
+                (int64_t)(r->time - h.trigger_time), records.at(i).channel,
+                eventTypeToString(r->type), r->cycle, r->fill, r->timestamp);
+        switch (r->type) {
+            case eET_PacketReceived:
+                fprintf(out, "len %"PRId64", dropped %d", r->arg, r->arg2);
+                break;
+            case eET_PacketTransmitted:
+                fprintf(out, "len %"PRId64", skipped %d", r->arg, r->arg2);
+                break;
+            case eET_PeriodTransfer:
+                fprintf(out, "transfer %"PRId64" ns, DLL %+d ppb", r->arg, r->arg2);
+                break;
+            case eET_PeriodWake:
+                fprintf(out, "period %d, latency %"PRId64" us", r->arg2, r->arg);
+                break;
+            case eET_XrunDetected:
+                fprintf(out, "period %d", r->arg2);
+                break;
+            default:
+                break;
+        }
+        if (r->flags & eEF_Dropped) fprintf(out, " DROPPED");
+        if (r->flags & eEF_Skipped) fprintf(out, " SKIPPED");
+        if (r->flags & eEF_Deferred) fprintf(out, " DEFERRED");
+        if (r->flags & eEF_Invalid) fprintf(out, " INVALID");
+        fprintf(out, "\n");
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,223 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_FLIGHTRECORDER__
+#define __FFADO_FLIGHTRECORDER__
+
+#include "debugmodule/debugmodule.h"
+#include "libutil/Thread.h"
+#include "libutil/Mutex.h"
+#include "libutil/SeqLock.h"
+#include "libutil/SystemTimeSource.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <semaphore.h>
+
+#define FLIGHT_RECORDER_FILE_MAGIC      "FFXR"
+#define FLIGHT_RECORDER_FILE_VERSION    1
+#define FLIGHT_RECORDER_NAME_LEN        48
+#define FLIGHT_RECORDER_REASON_LEN      64
+#define FLIGHT_RECORDER_MAX_CHANNELS    256
+
+/**
+ * One event of a stream, as kept by the flight recorder and
+ * written to the dump file (in host byte order)
+ */
+struct flight_record {
+    uint64_t sequence;      // number of the record in its channel + 1, 0 if unused
+    uint64_t time;          // system time (usecs)
+    uint64_t timestamp;     // the stream timestamp (ticks)
+    int64_t  arg;           // event specific
+    int32_t  cycle;         // -1 if not applicable
+    int32_t  fill;          // the buffer fill of the stream (frames)
+    int32_t  arg2;          // event specific
+    uint16_t type;
+    uint16_t flags;
+};
+
+struct flight_file_header {
+    char     magic[4];
+    uint32_t version;
+    uint32_t record_size;
+    uint32_t nb_channels;
+    uint64_t trigger_time;  // system time (usecs)
+    char     reason[FLIGHT_RECORDER_REASON_LEN];
+};
+
+struct flight_channel_header {
+    char     name[FLIGHT_RECORDER_NAME_LEN];
+    uint32_t nb_records;
+    uint32_t reserved;
+};
+
+namespace Util {
+
+/**
+ * @brief Keeps the last events of the streams for xrun forensics
+ *
+ * Every stream processor records its packets, xruns and period transfers
+ * in a channel of the recorder: a fixed-size ring that is written without
+ * locks or allocation. When an xrun is handled, trigger()
+ * copies all channels into a preallocated snapshot and a (non-RT) writer
+ * thread dumps it to a file, which ffado-xrun-decode renders as a
+ * timeline.
+ */
+class FlightRecorder : public RunnableInterface
+{
+public:
+    enum EEventType {
+        eET_PacketReceived = 1, // arg: length, arg2: dropped cycles
+        eET_PacketTransmitted,  // arg: length, arg2: skipped cycles
+        eET_Xrun,               // the stream detected an xrun
+        eET_PeriodTransfer,     // arg: transfer time (nsecs), arg2: DLL rate error (ppb)
+        eET_PeriodWake,         // arg: wake up latency (usecs), arg2: period number
+        eET_XrunDetected,       // the manager detected an xrun, arg2: period number
+    };
+    enum EEventFlags {
+        eEF_Dropped     = 0x01,
+        eEF_Skipped     = 0x02,
+        eEF_Deferred    = 0x04,
+        eEF_Invalid     = 0x08,
+    };
+
+    /**
+     * @brief A ring of the events of one stream
+     */
+    class Channel
+    {
+    public:
+        Channel(const std::string &name, unsigned int nb_records);
+        ~Channel();
+
+        ///> RT safe, the packet and the period events come from different threads
+        void record(enum EEventType type, unsigned int flags, int32_t cycle,
+                    int32_t fill, uint64_t timestamp, int64_t arg, int32_t arg2 = 0)
+            {uint64_t idx = __sync_fetch_and_add(&m_head, 1);
+             struct flight_record *r = &m_records[idx & m_mask];
+             // invalidate the slot while it is written
+             r->sequence = 0;
+             SEQLOCK_WRITE_BARRIER();
+             r->time = SystemTimeSource::getCurrentTimeAsUsecs();
+             r->timestamp = timestamp;
+             r->arg = arg;
+             r->cycle = cycle;
+             r->fill = fill;
+             r->arg2 = arg2;
+             r->type = type;
+             r->flags = flags;
+             SEQLOCK_WRITE_BARRIER();
+             r->sequence = idx + 1;};
+
+        const std::string &getName() {return m_name;};
+        void setName(const std::string &name) {m_name = name;};
+        unsigned int getSize() {return m_mask + 1;};
+        static unsigned int roundSize(unsigned int nb_records);
+        /**
+         * @brief copy the last records, oldest first
+         * @return the number of records copied
+         */
+        unsigned int snapshot(struct flight_record *to);
+
+    private:
+        std::string m_name;
+        struct flight_record *m_records;
+        unsigned int m_mask;
+        volatile uint64_t m_head; // the number of records claimed
+    };
+
+    FlightRecorder();
+    virtual ~FlightRecorder();
+
+    /**
+     * @brief start dumping to a directory
+     * @param dir the directory the files are written to
+     * @param max_dumps the number of files written at most
+     */
+    bool start(const std::string &dir, unsigned int max_dumps);
+    void stop();
+    bool isStarted() {return m_thread != NULL;};
+
+    /**
+     * @brief add a channel
+     * not RT safe
+     * @param nb_records the size of the ring, rounded up to a power of two
+     * @return the channel, NULL if there are too many
+     */
+    Channel *addChannel(const std::string &name, unsigned int nb_records);
+    /**
+     * @brief remove a channel from the dumps
+     * The channel is kept until the recorder is destroyed (or reused by
+     * addChannel) since a stream thread might still be recording to it.
+     */
+    void removeChannel(Channel *c);
+
+    /**
+     * @brief snapshot all channels and dump them asynchronously
+     * Doesn't allocate, doesn't block and doesn't do I/O. Dropped when
+     * the previous dump is still being written or when the channels
+     * are being changed.
+     * @return true if a dump was scheduled
+     */
+    bool trigger(const char *reason);
+
+    /**
+     * @brief render a dump file as a timeline
+     */
+    static bool decode(FILE *in, FILE *out);
+    static const char *eventTypeToString(unsigned int type);
+
+    // RunnableInterface
+    bool Execute();
+
+    void setVerboseLevel(int l) {setDebugLevel(l);};
+
+private:
+    void lockIdleSnapshot();
+    bool writeDump();
+
+    std::vector<Channel *> m_channels;
+    std::vector<Channel *> m_retired_channels;
+    Mutex *m_lock; // protects the channel lists and the snapshot size
+
+    // the snapshot, written by trigger() and by the writer thread
+    std::vector<struct flight_record> m_snapshot;
+    std::vector<struct flight_channel_header> m_snapshot_channels;
+    struct flight_file_header m_snapshot_header;
+    volatile int m_dump_pending;
+
+    std::string m_dir;
+    unsigned int m_max_dumps;
+    unsigned int m_nb_dumps;
+    sem_t m_dump_semaphore;
+    Thread *m_thread;
+    volatile bool m_stop;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+}
+
+#endif /* __FFADO_FLIGHTRECORDER__ */
@@ -130,7 +130,17 @@ PosixSharedMemory::Create(enum eDirection d)
     // open the shared memory segment
     // always create it readwrite, if not, the other side can't map
     // it correctly, nor can we truncate it to the right length.
-    int fd = shm_open(m_name.c_str(), O_RDWR|O_CREAT, S_IRWXU);
+    // a segment with this name is left over by an owner that didn't
+    // exit cleanly. Unlink it, such that readers that still map it
+    // don't see our data being written into a segment of the wrong size.
+    int fd = shm_open(m_name.c_str(), O_RDWR|O_CREAT|O_EXCL, S_IRWXU);
+    if (fd < 0 && errno == EEXIST) {
+        debugOutput(DEBUG_LEVEL_VERBOSE,
+                    "(%p, %s) removing stale segment\n",
+                    this, m_name.c_str());
+        shm_unlink(m_name.c_str());
+        fd = shm_open(m_name.c_str(), O_RDWR|O_CREAT|O_EXCL, S_IRWXU);
+    }
     if (fd < 0) {
         debugError("(%p, %s) Cannot open shared memory: %s\n",
                     this, m_name.c_str(), strerror (errno));
@@ -64,6 +64,9 @@ void* PosixThread::ThreadHandler(void* arg)
     RunnableInterface* runnable = obj->fRunnable;
     int err;
 
+    // allocate the trace buffer before the thread gets busy
+    DebugModuleManager::instance()->registerThread();
+
     obj->m_lock.Lock();
 
     // Signal that ThreadHandler has acquired its initial lock
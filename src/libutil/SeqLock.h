@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_SEQLOCK__
+#define __FFADO_SEQLOCK__
+
+#include <stdint.h>
+
+// on x86 loads are not reordered with other loads and stores are not
+// reordered with other stores, hence a compiler barrier is sufficient
+// for the read side and for publishing the sequence on the write side.
+#if defined(__i386__) || defined(__x86_64__)
+#define SEQLOCK_READ_BARRIER()  __asm__ __volatile__("" ::: "memory")
+#define SEQLOCK_WRITE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#define SEQLOCK_CPU_RELAX()     __asm__ __volatile__("pause" ::: "memory")
+#else
+#define SEQLOCK_READ_BARRIER()  __sync_synchronize()
+#define SEQLOCK_WRITE_BARRIER() __sync_synchronize()
+#define SEQLOCK_CPU_RELAX()     __asm__ __volatile__("" ::: "memory")
+#endif
+
+namespace Util
+{
+
+/**
+ * @brief A sequence lock
+ *
+ * Protects a small set of variables that is updated by one thread and
+ * read by others. Writers never sleep: they only spin on the (very short)
+ * write section of another writer. Readers never block a writer; they
+ * retry when a write happened while they were reading.
+ *
+ * Reader usage:
+ * \code
+ *   uint32_t seq;
+ *   do {
+ *       seq = lock.readBegin();
+ *       ... copy the protected variables ...
+ *   } while (lock.readRetry(seq));
+ * \endcode
+ *
+ * Writer usage:
+ * \code
+ *   lock.writeLock();
+ *   ... modify the protected variables ...
+ *   lock.writeUnlock();
+ * \endcode
+ *
+ * @note the read section can observe inconsistent values, so it should
+ *       only copy them and not act upon them before readRetry() said so.
+ */
+class SeqLock
+{
+public:
+    SeqLock() : m_sequence(0), m_read_retries(0) {};
+
+    void writeLock() {
+        uint32_t seq;
+        for(;;) {
+            seq = m_sequence;
+            // the CAS implies a full barrier
+            if (!(seq & 1) && __sync_bool_compare_and_swap(&m_sequence, seq, seq + 1)) {
+                return;
+            }
+            SEQLOCK_CPU_RELAX();
+        }
+    };
+    void writeUnlock() {
+        SEQLOCK_WRITE_BARRIER();
+        m_sequence = m_sequence + 1;
+    };
+
+    uint32_t readBegin() const {
+        uint32_t seq;
+        while ((seq = m_sequence) & 1) {
+            SEQLOCK_CPU_RELAX();
+        }
+        SEQLOCK_READ_BARRIER();
+        return seq;
+    };
+    bool readRetry(uint32_t seq) {
+        SEQLOCK_READ_BARRIER();
+        if (m_sequence != seq) {
+            m_read_retries++;
+            return true;
+        }
+        return false;
+    };
+
+    /**
+     * @return the number of read sections that had to be retried
+     *         (statistics only, not updated atomically)
+     */
+    unsigned int getReadRetries() const {return m_read_retries;};
+
+private:
+    volatile uint32_t m_sequence;
+    unsigned int m_read_retries;
+};
+
+} // end of namespace Util
+
+#endif /* __FFADO_SEQLOCK__ */
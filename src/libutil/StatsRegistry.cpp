@@ -0,0 +1,417 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "StatsRegistry.h"
+
+#include "PosixSharedMemory.h"
+#include "PosixMutex.h"
+#include "SeqLock.h"
+#include "SystemTimeSource.h"
+
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <errno.h>
+
+namespace Util {
+
+IMPL_DEBUG_MODULE( StatsRegistry, StatsRegistry, DEBUG_LEVEL_NORMAL );
+IMPL_DEBUG_MODULE( StatsReader, StatsReader, DEBUG_LEVEL_NORMAL );
+
+// the entry of the handles that are not registered, written but never read
+static struct stats_entry g_scratch_entry;
+
+Stat::Stat()
+    : m_entry( &g_scratch_entry )
+{
+}
+
+// ------------------------------------------------------------------------
+
+StatsRegistry* StatsRegistry::m_instance = NULL;
+static pthread_mutex_t g_instance_lock = PTHREAD_MUTEX_INITIALIZER;
+
+StatsRegistry::StatsRegistry()
+    : m_segment( NULL )
+    , m_shm( NULL )
+    , m_lock( new PosixMutex("STATS") )
+{
+}
+
+StatsRegistry::~StatsRegistry()
+{
+    if (m_segment) {
+        // the owner unlinks the segment
+        delete m_segment;
+    }
+    delete m_lock;
+}
+
+StatsRegistry*
+StatsRegistry::instance()
+{
+    // the handles are kept by their users, so this isn't called often
+    pthread_mutex_lock(&g_instance_lock);
+    if (m_instance == NULL) {
+        m_instance = new StatsRegistry();
+    }
+    StatsRegistry *r = m_instance;
+    pthread_mutex_unlock(&g_instance_lock);
+    return r;
+}
+
+void
+StatsRegistry::unlinkSegment()
+{
+    // keep the mapping, the RT threads might still be running
+    if (m_instance && m_instance->m_segment) {
+        shm_unlink(m_instance->m_name.c_str());
+    }
+}
+
+bool
+StatsRegistry::createSegment()
+{
+    if (m_segment) {
+        return true;
+    }
+    char name[64];
+    snprintf(name, sizeof(name), STATS_SHM_NAME_PREFIX "%d", (int)getpid());
+    m_name = std::string("/") + name;
+
+    m_segment = new PosixSharedMemory( name, sizeof(struct stats_segment) );
+    m_segment->setVerboseLevel( getDebugLevel() );
+    if (!m_segment->Create( PosixSharedMemory::eD_ReadWrite )) {
+        debugWarning("Could not create the statistics segment, not publishing statistics\n");
+        delete m_segment;
+        m_segment = NULL;
+        return false;
+    }
+    m_shm = (struct stats_segment *)m_segment->requestBlock( 0, sizeof(struct stats_segment) );
+    if (m_shm == NULL) {
+        debugWarning("Could not access the statistics segment\n");
+        delete m_segment;
+        m_segment = NULL;
+        return false;
+    }
+    memset( m_shm, 0, sizeof(struct stats_segment) );
+    m_shm->version = STATS_SHM_VERSION;
+    m_shm->entry_size = sizeof(struct stats_entry);
+    m_shm->nb_buckets = STATS_HISTOGRAM_BUCKETS;
+    m_shm->pid = getpid();
+    m_shm->start_usecs = SystemTimeSource::getCurrentTimeAsUsecs();
+    SEQLOCK_WRITE_BARRIER();
+    // the magic last, the segment is valid from here on
+    m_shm->magic = STATS_SHM_MAGIC;
+
+    atexit(unlinkSegment);
+    return true;
+}
+
+void
+StatsRegistry::resetEntry(struct stats_entry *entry)
+{
+    entry->count = 0;
+    entry->value = 0;
+    entry->min = INT64_MAX;
+    entry->max = INT64_MIN;
+    memset( (void *)entry->buckets, 0, sizeof(entry->buckets) );
+}
+
+Stat
+StatsRegistry::registerStat(const std::string &name, enum EType type, const char *unit)
+{
+    MutexLockHelper lock(*m_lock);
+    if (!createSegment()) {
+        return Stat();
+    }
+
+    struct stats_entry *entry = NULL;
+    for (unsigned int i = 0; i < m_shm->nb_entries; i++) {
+        struct stats_entry *e = &m_shm->entries[i];
+        if (e->type == 0) {
+            if (entry == NULL) {
+                entry = e;
+            }
+        } else if (strncmp(e->name, name.c_str(), STATS_NAME_LEN - 1) == 0) {
+            // e.g. a stream that is set up again
+            entry = e;
+            break;
+        }
+    }
+    if (entry == NULL) {
+        if (m_shm->nb_entries == STATS_MAX_ENTRIES) {
+            debugWarning("Too many statistics, not publishing %s\n", name.c_str());
+            return Stat();
+        }
+        entry = &m_shm->entries[m_shm->nb_entries];
+    }
+
+    entry->sequence = entry->sequence + 1;
+    SEQLOCK_WRITE_BARRIER();
+    entry->type = type;
+    memset( entry->name, 0, STATS_NAME_LEN );
+    strncpy( entry->name, name.c_str(), STATS_NAME_LEN - 1 );
+    memset( entry->unit, 0, STATS_UNIT_LEN );
+    strncpy( entry->unit, unit, STATS_UNIT_LEN - 1 );
+    resetEntry( entry );
+    SEQLOCK_WRITE_BARRIER();
+    entry->sequence = entry->sequence + 1;
+
+    if (entry == &m_shm->entries[m_shm->nb_entries]) {
+        m_shm->nb_entries = m_shm->nb_entries + 1;
+    }
+    m_shm->generation = m_shm->generation + 1;
+
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Registered %s (%d)\n", name.c_str(), type);
+    return Stat(entry);
+}
+
+void
+StatsRegistry::unregisterStat(Stat &stat)
+{
+    if (!stat.isRegistered()) {
+        return;
+    }
+    MutexLockHelper lock(*m_lock);
+    struct stats_entry *entry = stat.m_entry;
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Unregistering %s\n", entry->name);
+
+    // the owner might still update it, hand it the scratch entry
+    stat.m_entry = &g_scratch_entry;
+
+    entry->sequence = entry->sequence + 1;
+    SEQLOCK_WRITE_BARRIER();
+    entry->type = 0;
+    SEQLOCK_WRITE_BARRIER();
+    entry->sequence = entry->sequence + 1;
+    m_shm->generation = m_shm->generation + 1;
+}
+
+void
+StatsRegistry::reset(Stat &stat)
+{
+    if (!stat.isRegistered()) {
+        return;
+    }
+    resetEntry( stat.m_entry );
+}
+
+void
+StatsRegistry::setVerboseLevel(int l)
+{
+    setDebugLevel( l );
+    if (m_segment) {
+        m_segment->setVerboseLevel( l );
+    }
+}
+
+void
+StatsRegistry::show()
+{
+    MutexLockHelper lock(*m_lock);
+    if (m_shm == NULL) {
+        debugOutput(DEBUG_LEVEL_NORMAL, "Statistics not published\n");
+        return;
+    }
+    debugOutput(DEBUG_LEVEL_NORMAL, "Statistics in %s:\n", m_name.c_str());
+    for (unsigned int i = 0; i < m_shm->nb_entries; i++) {
+        struct stats_entry *e = &m_shm->entries[i];
+        if (e->type == 0) {
+            continue;
+        }
+        debugOutputShort(DEBUG_LEVEL_NORMAL, "  %-48s: %10"PRIu64" %10"PRId64" %s\n",
+                         e->name, e->count, e->value, e->unit);
+    }
+}
+
+// ------------------------------------------------------------------------
+
+uint64_t
+StatsReader::Snapshot::getPercentile(double fraction) const
+{
+    uint64_t total = 0;
+    for (unsigned int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        total += buckets[i];
+    }
+    if (total == 0) {
+        return 0;
+    }
+    uint64_t target = (uint64_t)(fraction * total);
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen > target) {
+            return Stat::getBucketLowerBound(i);
+        }
+    }
+    return Stat::getBucketLowerBound(STATS_HISTOGRAM_BUCKETS - 1);
+}
+
+StatsReader::StatsReader()
+    : m_segment( NULL )
+    , m_shm( NULL )
+    , m_pid( 0 )
+{
+}
+
+StatsReader::~StatsReader()
+{
+    close();
+}
+
+bool
+StatsReader::open(int pid)
+{
+    close();
+
+    if (pid == 0) {
+        // take the first segment of a live process
+        DIR *dir = opendir("/dev/shm");
+        if (dir == NULL) {
+            debugError("Could not list the shared memory segments: %s\n", strerror(errno));
+            return false;
+        }
+        struct dirent *d;
+        size_t prefix_len = strlen(STATS_SHM_NAME_PREFIX);
+        while ((d = readdir(dir)) != NULL) {
+            if (strncmp(d->d_name, STATS_SHM_NAME_PREFIX, prefix_len) == 0) {
+                int p = atoi(d->d_name + prefix_len);
+                if (p > 0 && (kill(p, 0) == 0 || errno == EPERM)) {
+                    pid = p;
+                    break;
+                }
+            }
+        }
+        closedir(dir);
+        if (pid == 0) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "No statistics segment found\n");
+            return false;
+        }
+    }
+
+    char name[64];
+    snprintf(name, sizeof(name), STATS_SHM_NAME_PREFIX "%d", pid);
+    m_segment = new PosixSharedMemory( name, sizeof(struct stats_segment) );
+    if (!m_segment->Open( PosixSharedMemory::eD_ReadOnly )) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Could not open %s\n", name);
+        delete m_segment;
+        m_segment = NULL;
+        return false;
+    }
+    m_shm = (const struct stats_segment *)m_segment->requestBlock( 0, sizeof(struct stats_segment) );
+    if (m_shm == NULL || m_shm->magic != STATS_SHM_MAGIC
+        || m_shm->version != STATS_SHM_VERSION
+        || m_shm->entry_size != sizeof(struct stats_entry)
+        || m_shm->nb_buckets != STATS_HISTOGRAM_BUCKETS) {
+        debugError("Incompatible statistics segment %s\n", name);
+        close();
+        return false;
+    }
+    m_pid = pid;
+    return true;
+}
+
+void
+StatsReader::close()
+{
+    if (m_segment) {
+        delete m_segment;
+        m_segment = NULL;
+    }
+    m_shm = NULL;
+    m_pid = 0;
+}
+
+unsigned int
+StatsReader::getNbEntries()
+{
+    if (m_shm == NULL) {
+        return 0;
+    }
+    unsigned int nb_entries = m_shm->nb_entries;
+    return (nb_entries < STATS_MAX_ENTRIES ? nb_entries : STATS_MAX_ENTRIES);
+}
+
+uint32_t
+StatsReader::getGeneration()
+{
+    if (m_shm == NULL) {
+        return 0;
+    }
+    return m_shm->generation;
+}
+
+bool
+StatsReader::read(unsigned int idx, Snapshot &s)
+{
+    if (m_shm == NULL || idx >= STATS_MAX_ENTRIES) {
+        return false;
+    }
+    const struct stats_entry *e = &m_shm->entries[idx];
+    char name[STATS_NAME_LEN];
+    char unit[STATS_UNIT_LEN];
+    uint32_t seq, type;
+    for (unsigned int tries = 0; ; tries++) {
+        if (tries == STATS_READ_MAX_TRIES) {
+            debugWarning("Entry %u not consistent, is the owner alive?\n", idx);
+            return false;
+        }
+        seq = e->sequence;
+        if (seq & 1) {
+            // being (un)registered
+            SEQLOCK_CPU_RELAX();
+            continue;
+        }
+        SEQLOCK_READ_BARRIER();
+        type = e->type;
+        memcpy( name, e->name, STATS_NAME_LEN );
+        memcpy( unit, e->unit, STATS_UNIT_LEN );
+        s.count = e->count;
+        s.value = e->value;
+        s.min = e->min;
+        s.max = e->max;
+        memcpy( s.buckets, (const void *)e->buckets, sizeof(s.buckets) );
+        SEQLOCK_READ_BARRIER();
+        if (e->sequence == seq) {
+            break;
+        }
+    }
+
+    if (type == 0) {
+        return false;
+    }
+    name[STATS_NAME_LEN - 1] = 0;
+    unit[STATS_UNIT_LEN - 1] = 0;
+    s.name = name;
+    s.unit = unit;
+    s.type = (enum StatsRegistry::EType)type;
+    return true;
+}
+
+} // end of namespace Util
@@ -0,0 +1,284 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_STATSREGISTRY__
+#define __FFADO_STATSREGISTRY__
+
+#include "debugmodule/debugmodule.h"
+
+#include <stdint.h>
+#include <string>
+
+/*
+ * The layout of the statistics segment. Like the meter segment it only
+ * contains fixed size types, a reader checks the magic, the version and
+ * the entry size before using it.
+ *
+ * The values of an entry are updated with relaxed atomic operations by
+ * the RT threads, hence the values of one entry are not necessarily
+ * consistent with each other. The name and the type of an entry are
+ * protected by the sequence counter of the entry: it is odd while the
+ * entry is (un)registered, and changes on every (un)registration.
+ *
+ * The histograms are log-linear on the magnitude of the values: values
+ * below 4 have their own bucket, above that every power of two is split
+ * in 4 buckets (see StatsRegistry::getBucketIndex).
+ */
+#define STATS_SHM_NAME_PREFIX           "ffado-stats-"
+#define STATS_SHM_MAGIC                 0x53544154  // 'STAT'
+#define STATS_SHM_VERSION               1
+
+#define STATS_MAX_ENTRIES               256
+#define STATS_NAME_LEN                  64
+#define STATS_UNIT_LEN                  16
+#define STATS_HISTOGRAM_BUCKETS         128
+// the number of times a reader retries a read that raced with an update
+// before it gives up, e.g. because the owner died while writing the entry
+#define STATS_READ_MAX_TRIES            1000
+
+struct stats_entry {
+    volatile uint32_t   sequence;
+    // one of StatsRegistry::EType, 0 if the entry is free
+    uint32_t            type;
+    char                name[STATS_NAME_LEN];
+    char                unit[STATS_UNIT_LEN];
+    // counter: the count, gauge: the number of updates,
+    // histogram: the number of values
+    volatile uint64_t   count;
+    // gauge: the last value, histogram: the sum of the values
+    volatile int64_t    value;
+    volatile int64_t    min;
+    volatile int64_t    max;
+    volatile uint64_t   buckets[STATS_HISTOGRAM_BUCKETS];
+};
+
+struct stats_segment {
+    uint32_t            magic;
+    uint32_t            version;
+    uint32_t            entry_size;
+    uint32_t            nb_buckets;
+    // incremented on every (un)registration
+    volatile uint32_t   generation;
+    // entries above this index are free
+    volatile uint32_t   nb_entries;
+    uint32_t            pid;
+    uint32_t            reserved;
+    uint64_t            start_usecs;
+    struct stats_entry  entries[STATS_MAX_ENTRIES];
+};
+
+// relaxed atomics where the compiler has them
+#ifdef __ATOMIC_RELAXED
+#define STATS_ATOMIC_ADD(ptr, v)    __atomic_fetch_add((ptr), (v), __ATOMIC_RELAXED)
+#define STATS_ATOMIC_STORE(ptr, v)  __atomic_store_n((ptr), (v), __ATOMIC_RELAXED)
+#define STATS_ATOMIC_LOAD(ptr)      __atomic_load_n((ptr), __ATOMIC_RELAXED)
+#define STATS_ATOMIC_CAS(ptr, o, n) __atomic_compare_exchange_n((ptr), &(o), (n), true, \
+                                                                __ATOMIC_RELAXED, __ATOMIC_RELAXED)
+#else
+#define STATS_ATOMIC_ADD(ptr, v)    __sync_fetch_and_add((ptr), (v))
+#define STATS_ATOMIC_STORE(ptr, v)  (*(ptr) = (v))
+#define STATS_ATOMIC_LOAD(ptr)      (*(ptr))
+#define STATS_ATOMIC_CAS(ptr, o, n) __sync_bool_compare_and_swap((ptr), (o), (n))
+#endif
+
+namespace Util {
+
+class Mutex;
+class PosixSharedMemory;
+
+/**
+ * @brief A handle to one statistic in the StatsRegistry
+ *
+ * The update functions are RT safe and can be called from any thread.
+ * A handle that isn't registered (or that could not be registered)
+ * points to a scratch entry, so the callers don't have to check.
+ */
+class Stat
+{
+public:
+    Stat();
+
+    ///> counters: add to the count
+    void add(uint64_t n = 1)
+        {STATS_ATOMIC_ADD(&m_entry->count, n);};
+    ///> gauges: set the current value
+    void set(int64_t value)
+        {STATS_ATOMIC_STORE(&m_entry->value, value);
+         STATS_ATOMIC_ADD(&m_entry->count, 1);
+         updateMinMax(value);};
+    ///> histograms: add a value
+    void record(int64_t value)
+        {STATS_ATOMIC_ADD(&m_entry->count, 1);
+         STATS_ATOMIC_ADD(&m_entry->value, value);
+         updateMinMax(value);
+         STATS_ATOMIC_ADD(&m_entry->buckets[getBucketIndex(value)], 1);};
+
+    ///> the scratch entry is shared, unregistered handles read as zero
+    uint64_t getCount() const
+        {return (isRegistered() ? STATS_ATOMIC_LOAD(&m_entry->count) : 0);};
+    int64_t getValue() const
+        {return (isRegistered() ? STATS_ATOMIC_LOAD(&m_entry->value) : 0);};
+    bool isRegistered() const {return m_entry->type != 0;};
+
+    /**
+     * @brief the histogram bucket of a value
+     */
+    static unsigned int getBucketIndex(int64_t value)
+        {uint64_t v = (value < 0 ? 0 - (uint64_t)value : (uint64_t)value);
+         if (v < 4) return v;
+         unsigned int e = 63 - __builtin_clzll(v);
+         unsigned int idx = 4 * (e - 1) + ((v >> (e - 2)) & 3);
+         return (idx < STATS_HISTOGRAM_BUCKETS ? idx : STATS_HISTOGRAM_BUCKETS - 1);};
+    /**
+     * @brief the smallest magnitude that goes into a bucket
+     */
+    static uint64_t getBucketLowerBound(unsigned int idx)
+        {if (idx < 4) return idx;
+         return (uint64_t)(4 + (idx & 3)) << (idx / 4 - 1);};
+
+private:
+    friend class StatsRegistry;
+    explicit Stat(struct stats_entry *entry) : m_entry(entry) {};
+
+    void updateMinMax(int64_t value)
+        {int64_t old = STATS_ATOMIC_LOAD(&m_entry->min);
+         while (value < old && !STATS_ATOMIC_CAS(&m_entry->min, old, value)) {
+            old = STATS_ATOMIC_LOAD(&m_entry->min);
+         }
+         old = STATS_ATOMIC_LOAD(&m_entry->max);
+         while (value > old && !STATS_ATOMIC_CAS(&m_entry->max, old, value)) {
+            old = STATS_ATOMIC_LOAD(&m_entry->max);
+         }};
+
+    struct stats_entry *m_entry;
+};
+
+/**
+ * @brief Publishes the statistics of a process in shared memory
+ *
+ * The streaming code registers counters, gauges and histograms when it
+ * sets up, and updates them while streaming. The registry publishes
+ * them in a shared memory segment per process ("ffado-stats-<pid>"),
+ * such that they can be watched live (ffado-stat) without stopping or
+ * slowing down the streams.
+ */
+class StatsRegistry
+{
+public:
+    enum EType {
+        eT_Counter = 1,
+        eT_Gauge,
+        eT_Histogram,
+    };
+
+    static StatsRegistry* instance();
+
+    /**
+     * @brief register a statistic
+     *
+     * Not RT safe. If the name is already registered, that entry is
+     * reset and returned.
+     * @param name the name, a '/' separated path by convention
+     * @param unit the unit of the values
+     */
+    Stat registerStat(const std::string &name, enum EType type, const char *unit = "");
+    void unregisterStat(Stat &stat);
+    ///> reset the values of a statistic
+    void reset(Stat &stat);
+
+    void show();
+    void setVerboseLevel(int l);
+
+private:
+    StatsRegistry();
+    ~StatsRegistry();
+
+    bool createSegment();
+    void resetEntry(struct stats_entry *entry);
+    static void unlinkSegment();
+
+    PosixSharedMemory*      m_segment;
+    struct stats_segment*   m_shm;
+    Mutex*                  m_lock;
+    std::string             m_name;
+
+    static StatsRegistry*   m_instance;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+/**
+ * @brief Reads the statistics published by the StatsRegistry of a process
+ */
+class StatsReader
+{
+public:
+    struct Snapshot {
+        std::string     name;
+        std::string     unit;
+        enum StatsRegistry::EType type;
+        uint64_t        count;
+        int64_t         value;
+        int64_t         min;
+        int64_t         max;
+        uint64_t        buckets[STATS_HISTOGRAM_BUCKETS];
+
+        /**
+         * @brief estimate a percentile of a histogram
+         * @param fraction e.g. 0.99 for the 99th percentile
+         * @return the lower bound of the bucket it falls in (magnitude)
+         */
+        uint64_t getPercentile(double fraction) const;
+    };
+
+    StatsReader();
+    ~StatsReader();
+
+    /**
+     * @brief map the segment of a process
+     * @param pid the process, 0 to take the first one found
+     */
+    bool open(int pid);
+    void close();
+    int getPid() {return m_pid;};
+
+    unsigned int getNbEntries();
+    uint32_t getGeneration();
+    /**
+     * @brief copy an entry
+     * @return false if the entry is not in use, or if it could not be
+     *         read within STATS_READ_MAX_TRIES tries
+     */
+    bool read(unsigned int idx, Snapshot &s);
+
+private:
+    PosixSharedMemory*              m_segment;
+    const struct stats_segment*     m_shm;
+    int                             m_pid;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+} // end of namespace Util
+
+#endif /* __FFADO_STATSREGISTRY__ */
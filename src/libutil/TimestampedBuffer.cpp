@@ -32,6 +32,7 @@
 
 #include <cstdlib>
 #include <cstring>
+#include <math.h>
 
 #define DLL_PI        (3.141592653589793238)
 #define DLL_SQRT2     (1.414213562373095049)
@@ -43,19 +44,39 @@
 #define DLL_COEFF_C   (DLL_OMEGA * DLL_OMEGA)
 
 #define FRAMES_PER_PROCESS_BLOCK 8
-/*
-#define ENTER_CRITICAL_SECTION { \
-    if (pthread_mutex_trylock(&m_framecounter_lock) == EBUSY) { \
-        debugWarning(" (%p) lock clash\n", this); \
-        pthread_mutex_lock(&m_framecounter_lock); \
-    } \
-    }
-*/
+
+// conversions between the API timestamps (ticks) and the internal state
+#if FIXED_POINT_TIMESTAMPS
+#define TS_ONE                  (((ffado_timestamp_state_t)1) << TIMESTAMP_FRACTION_BITS)
+#define TS_FROM_TICKS(x)        ((ffado_timestamp_state_t)(x) * TS_ONE)
+// truncates, like the (uint64_t) casts of the users of the double version
+#define TS_TO_TICKS(x)          ((ffado_timestamp_t)((x) >> TIMESTAMP_FRACTION_BITS))
+#define TS_TO_FLOAT(x)          ((double)(x) / (double)TS_ONE)
+#define TS_WRAP_DEFAULT         (0x7FFFFFFFFFFFFFFFLL)
+#define RATE_FROM_FLOAT(r)      ((ffado_rate_state_t)llrint((double)(r) * (double)TS_ONE))
+#define RATE_TO_FLOAT(r)        ((float)TS_TO_FLOAT(r))
+#define RATE_FROM_DIFF(d, n)    ((d) / (ffado_timestamp_state_t)(n))
+// the loop filter gains are applied in floating point, but the result
+// is accumulated in the integer state
+#define DLL_GAIN(g, err)        ((ffado_timestamp_state_t)llrint((g) * (double)(err)))
+#else
+#define TS_FROM_TICKS(x)        ((ffado_timestamp_state_t)(x))
+#define TS_TO_TICKS(x)          ((ffado_timestamp_t)(x))
+#define TS_TO_FLOAT(x)          ((double)(x))
+#define TS_WRAP_DEFAULT         (0xFFFFFFFFFFFFFFFFLLU)
+#define RATE_FROM_FLOAT(r)      ((ffado_rate_state_t)(r))
+#define RATE_TO_FLOAT(r)        ((float)(r))
+#define RATE_FROM_DIFF(d, n)    (((float)(d))/((float)(n)))
+#define DLL_GAIN(g, err)        ((g) * (double)(err))
+#endif
+
+// the writer side of the timestamp/DLL state. This never sleeps, it can only
+// spin on another writer's (short) write section.
 #define ENTER_CRITICAL_SECTION { \
-    pthread_mutex_lock(&m_framecounter_lock); \
+    m_state_lock.writeLock(); \
     }
 #define EXIT_CRITICAL_SECTION { \
-    pthread_mutex_unlock(&m_framecounter_lock); \
+    m_state_lock.writeUnlock(); \
     }
 
 
@@ -69,21 +90,18 @@ TimestampedBuffer::TimestampedBuffer(TimestampedBufferClient *c)
       m_event_size(0), m_events_per_frame(0), m_buffer_size(0),
       m_bytes_per_frame(0), m_bytes_per_buffer(0),
       m_enabled( false ), m_transparent ( true ),
-      m_wrap_at(0xFFFFFFFFFFFFFFFFLLU),
-      m_Client(c), m_framecounter(0),
-      m_buffer_tail_timestamp(TIMESTAMP_MAX + 1.0),
-      m_buffer_next_tail_timestamp(TIMESTAMP_MAX + 1.0),
+      m_wrap_at(TS_WRAP_DEFAULT),
+      m_Client(c), m_frames_written(0), m_frames_read(0),
+      m_buffer_tail_timestamp(TS_FROM_TICKS(TIMESTAMP_MAX + 1)),
+      m_buffer_next_tail_timestamp(TS_FROM_TICKS(TIMESTAMP_MAX + 1)),
       m_dll_e2(0.0), m_dll_b(DLL_COEFF_B), m_dll_c(DLL_COEFF_C),
       m_nominal_rate(0.0), m_current_rate(0.0), m_update_period(0),
       // half a cycle is what we consider 'normal'
       m_max_abs_diff(3072/2)
 {
-    pthread_mutex_init(&m_framecounter_lock, NULL);
 }
 
 TimestampedBuffer::~TimestampedBuffer() {
-    pthread_mutex_destroy(&m_framecounter_lock);
-
     if(m_event_buffer) ffado_ringbuffer_free(m_event_buffer);
     if(m_process_buffer) free(m_process_buffer);
 }
@@ -176,10 +194,9 @@ unsigned int TimestampedBuffer::getUpdatePeriod() {
  * @return true if successful
  */
 bool TimestampedBuffer::setWrapValue(ffado_timestamp_t w) {
-    m_wrap_at=w;
+    m_wrap_at=TS_FROM_TICKS(w);
     return true;
 }
-#include <math.h>
 
 /**
  * \brief return the effective rate
@@ -189,7 +206,7 @@ bool TimestampedBuffer::setWrapValue(ffado_timestamp_t w) {
  * @return rate (in timeunits/frame)
  */
 float TimestampedBuffer::getRate() {
-    return m_current_rate;
+    return RATE_TO_FLOAT(m_current_rate);
 }
 
 /**
@@ -204,16 +221,16 @@ void TimestampedBuffer::setRate(float rate) {
 
     ENTER_CRITICAL_SECTION;
 
-    m_current_rate = rate;
+    m_current_rate = RATE_FROM_FLOAT(rate);
     m_dll_e2 = m_update_period * m_current_rate;
-    m_buffer_next_tail_timestamp = (ffado_timestamp_t)((double)m_buffer_tail_timestamp + m_dll_e2);
+    m_buffer_next_tail_timestamp = m_buffer_tail_timestamp + m_dll_e2;
 
     EXIT_CRITICAL_SECTION;
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "for (%p) "
                        "NTS="TIMESTAMP_FORMAT_SPEC", DLL2=%f, RATE=%f\n",
-                       this, m_buffer_next_tail_timestamp, m_dll_e2, getRate());
+                       this, TS_TO_TICKS(m_buffer_next_tail_timestamp), TS_TO_FLOAT(m_dll_e2), getRate());
 }
 
 /**
@@ -223,19 +240,19 @@ void TimestampedBuffer::setRate(float rate) {
  * @note should be called with the lock held
  * @return rate (in timeunits/frame)
  */
-float TimestampedBuffer::calculateRate() {
-    ffado_timestamp_t diff;
+ffado_rate_state_t TimestampedBuffer::calculateRate() {
+    ffado_timestamp_state_t diff;
 
     diff=m_buffer_next_tail_timestamp - m_buffer_tail_timestamp;
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "getRate: %f/%f=%f\n",
-                       (float)(diff),
+                       (float)TS_TO_FLOAT(diff),
                        (float)m_update_period,
-                       ((float)(diff))/((float) m_update_period));
+                       ((float)TS_TO_FLOAT(diff))/((float) m_update_period));
 
     // the maximal difference we can allow (64secs)
-    const ffado_timestamp_t max=m_wrap_at/((ffado_timestamp_t)2);
+    const ffado_timestamp_state_t max=m_wrap_at/((ffado_timestamp_state_t)2);
 
     if(diff > max) {
         diff -= m_wrap_at;
@@ -243,14 +260,14 @@ float TimestampedBuffer::calculateRate() {
         diff += m_wrap_at;
     }
 
-    float rate=((float)diff)/((float) m_update_period);
-    if (rate<0.0) debugError("rate < 0! (%f)\n",rate);
-    if (fabsf(m_nominal_rate - rate)>(m_nominal_rate*0.1)) {
+    ffado_rate_state_t rate=RATE_FROM_DIFF(diff, m_update_period);
+    if (rate<0) debugError("rate < 0! (%f)\n",RATE_TO_FLOAT(rate));
+    if (fabsf(m_nominal_rate - RATE_TO_FLOAT(rate))>(m_nominal_rate*0.1)) {
         debugWarning("(%p) rate (%10.5f) more that 10%% off nominal "
                      "(rate=%10.5f, diff="TIMESTAMP_FORMAT_SPEC", update_period=%d)\n",
-                     this, rate,m_nominal_rate,diff, m_update_period);
+                     this, RATE_TO_FLOAT(rate),m_nominal_rate,TS_TO_TICKS(diff), m_update_period);
 
-        return m_nominal_rate;
+        return RATE_FROM_FLOAT(m_nominal_rate);
     } else {
         return rate;
     }
@@ -312,7 +329,7 @@ bool TimestampedBuffer::setBufferSize(unsigned int n) {
  */
 unsigned int TimestampedBuffer::getBufferFill() {
     //return ffado_ringbuffer_read_space(m_event_buffer)/(m_bytes_per_frame);
-    return m_framecounter;
+    return getFrameCounter();
 }
 
 /**
@@ -326,8 +343,9 @@ unsigned int TimestampedBuffer::getBufferFill() {
  */
 unsigned int TimestampedBuffer::getBufferSpace() {
     //return ffado_ringbuffer_write_space(m_event_buffer)/(m_bytes_per_frame);
-    assert(m_buffer_size-m_framecounter >= 0);
-    return m_buffer_size-m_framecounter;
+    signed int fc = getFrameCounter();
+    assert((signed int)m_buffer_size - fc >= 0);
+    return m_buffer_size - fc;
 }
 
 /**
@@ -346,8 +364,10 @@ bool TimestampedBuffer::clearBuffer() {
     ffado_ringbuffer_reset(m_event_buffer);
     resetFrameCounter();
 
-    m_current_rate = m_nominal_rate;
-    m_dll_e2 = m_current_rate * (float)m_update_period;
+    ENTER_CRITICAL_SECTION;
+    m_current_rate = RATE_FROM_FLOAT(m_nominal_rate);
+    m_dll_e2 = m_update_period * m_current_rate;
+    EXIT_CRITICAL_SECTION;
 
     return true;
 }
@@ -373,7 +393,7 @@ bool TimestampedBuffer::prepare() {
     debugOutput(DEBUG_LEVEL_VERBOSE," nominal rate=%f\n",
                                     m_nominal_rate);
 
-    debugOutput(DEBUG_LEVEL_VERBOSE," wrapping at "TIMESTAMP_FORMAT_SPEC"\n",m_wrap_at);
+    debugOutput(DEBUG_LEVEL_VERBOSE," wrapping at "TIMESTAMP_FORMAT_SPEC"\n",TS_TO_TICKS(m_wrap_at));
 
     assert(m_buffer_size);
     assert(m_events_per_frame);
@@ -382,7 +402,7 @@ bool TimestampedBuffer::prepare() {
     assert(m_nominal_rate != 0.0L);
     assert(m_update_period != 0);
 
-    m_current_rate = m_nominal_rate;
+    m_current_rate = RATE_FROM_FLOAT(m_nominal_rate);
 
     if( !resizeBuffer(m_buffer_size) ) {
         debugError("Failed to allocate the event buffer\n");
@@ -404,12 +424,12 @@ bool TimestampedBuffer::prepare() {
     }
 
     // init the DLL
-    m_dll_e2 = m_nominal_rate * (float)m_update_period;
+    m_dll_e2 = m_update_period * m_current_rate;
 
     // init the timestamps to a bogus value, as there is not
     // really something sane to say about them
-    m_buffer_tail_timestamp = TIMESTAMP_MAX + 1.0;
-    m_buffer_next_tail_timestamp = TIMESTAMP_MAX + 1.0;
+    m_buffer_tail_timestamp = TS_FROM_TICKS(TIMESTAMP_MAX + 1);
+    m_buffer_next_tail_timestamp = TS_FROM_TICKS(TIMESTAMP_MAX + 1);
 
     return true;
 }
@@ -438,8 +458,8 @@ TimestampedBuffer::resizeBuffer(unsigned int new_size)
     }
     resetFrameCounter();
 
-    m_current_rate = m_nominal_rate;
-    m_dll_e2 = m_current_rate * (float)m_update_period;
+    m_current_rate = RATE_FROM_FLOAT(m_nominal_rate);
+    m_dll_e2 = m_update_period * m_current_rate;
 
     m_buffer_size = new_size;
 
@@ -475,7 +495,7 @@ bool TimestampedBuffer::writeDummyFrame() {
     
     // increment without updating the DLL
     ENTER_CRITICAL_SECTION;
-    m_framecounter++;
+    m_frames_written = m_frames_written + 1;
     EXIT_CRITICAL_SECTION;
     return true;
 }
@@ -498,7 +518,8 @@ bool TimestampedBuffer::writeFrames(unsigned int nframes, char *data, ffado_time
     if (m_transparent) {
         // while disabled, we don't update the DLL, nor do we write frames
         // we just set the correct timestamp for the frames
-        if (m_buffer_tail_timestamp < TIMESTAMP_MAX && m_buffer_next_tail_timestamp < TIMESTAMP_MAX) {
+        if (m_buffer_tail_timestamp < TS_FROM_TICKS(TIMESTAMP_MAX)
+            && m_buffer_next_tail_timestamp < TS_FROM_TICKS(TIMESTAMP_MAX)) {
             incrementFrameCounter(nframes, ts);
             decrementFrameCounter(nframes);
         }
@@ -551,7 +572,9 @@ bool TimestampedBuffer::preloadFrames(unsigned int nframes, char *data, bool kee
         getBufferTailTimestamp(&ts, &fc);
     }
     // update frame counter
-    m_framecounter += nframes;
+    ENTER_CRITICAL_SECTION;
+    m_frames_written = m_frames_written + nframes;
+    EXIT_CRITICAL_SECTION;
     if (keep_head_ts) {
         setBufferHeadTimestamp(ts);
     } else {
@@ -835,7 +858,7 @@ bool TimestampedBuffer::blockProcessReadFrames(unsigned int nbframes) {
 void TimestampedBuffer::setBufferTailTimestamp(ffado_timestamp_t new_timestamp) {
 
     // add the offsets
-    ffado_timestamp_t ts = new_timestamp;
+    ffado_timestamp_state_t ts = TS_FROM_TICKS(new_timestamp);
 
     if (ts >= m_wrap_at) {
         ts -= m_wrap_at;
@@ -844,11 +867,11 @@ void TimestampedBuffer::setBufferTailTimestamp(ffado_timestamp_t new_timestamp)
     }
 
 #ifdef DEBUG
-    if (new_timestamp >= m_wrap_at) {
+    if (TS_FROM_TICKS(new_timestamp) >= m_wrap_at) {
         debugWarning("timestamp not wrapped: "TIMESTAMP_FORMAT_SPEC"\n",new_timestamp);
     }
     if ((ts >= m_wrap_at) || (ts < 0 )) {
-        debugWarning("ts not wrapped correctly: "TIMESTAMP_FORMAT_SPEC"\n",ts);
+        debugWarning("ts not wrapped correctly: "TIMESTAMP_FORMAT_SPEC"\n",TS_TO_TICKS(ts));
     }
 #endif
 
@@ -856,15 +879,16 @@ void TimestampedBuffer::setBufferTailTimestamp(ffado_timestamp_t new_timestamp)
 
     m_buffer_tail_timestamp = ts;
 
-    m_dll_e2 = m_update_period * (double)m_current_rate;
-    m_buffer_next_tail_timestamp = (ffado_timestamp_t)((double)m_buffer_tail_timestamp + m_dll_e2);
+    m_dll_e2 = (ffado_timestamp_state_t)m_update_period * m_current_rate;
+    m_buffer_next_tail_timestamp = m_buffer_tail_timestamp + m_dll_e2;
 
     EXIT_CRITICAL_SECTION;
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "for (%p) to "TIMESTAMP_FORMAT_SPEC" => "TIMESTAMP_FORMAT_SPEC", "
                        "NTS="TIMESTAMP_FORMAT_SPEC", DLL2=%f, RATE=%f\n",
-                       this, new_timestamp, ts, m_buffer_next_tail_timestamp, m_dll_e2, getRate());
+                       this, new_timestamp, TS_TO_TICKS(ts), TS_TO_TICKS(m_buffer_next_tail_timestamp),
+                       TS_TO_FLOAT(m_dll_e2), getRate());
 }
 
 /**
@@ -882,17 +906,17 @@ void TimestampedBuffer::setBufferTailTimestamp(ffado_timestamp_t new_timestamp)
 void TimestampedBuffer::setBufferHeadTimestamp(ffado_timestamp_t new_timestamp) {
 
 #ifdef DEBUG
-    if (new_timestamp >= m_wrap_at) {
+    if (TS_FROM_TICKS(new_timestamp) >= m_wrap_at) {
         debugWarning("timestamp not wrapped: "TIMESTAMP_FORMAT_SPEC"\n", new_timestamp);
     }
 #endif
 
-    ffado_timestamp_t ts = new_timestamp;
+    ffado_timestamp_state_t ts = TS_FROM_TICKS(new_timestamp);
 
     ENTER_CRITICAL_SECTION;
 
     // add the time
-    ts += (ffado_timestamp_t)(m_current_rate * (float)(m_framecounter));
+    ts += (ffado_timestamp_state_t)(m_current_rate * (ffado_rate_state_t)(getFrameCounter()));
 
     if (ts >= m_wrap_at) {
         ts -= m_wrap_at;
@@ -902,15 +926,16 @@ void TimestampedBuffer::setBufferHeadTimestamp(ffado_timestamp_t new_timestamp)
 
     m_buffer_tail_timestamp = ts;
 
-    m_dll_e2 = m_update_period * (double)m_current_rate;
-    m_buffer_next_tail_timestamp = (ffado_timestamp_t)((double)m_buffer_tail_timestamp + m_dll_e2);
+    m_dll_e2 = (ffado_timestamp_state_t)m_update_period * m_current_rate;
+    m_buffer_next_tail_timestamp = m_buffer_tail_timestamp + m_dll_e2;
 
     EXIT_CRITICAL_SECTION;
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "for (%p) to "TIMESTAMP_FORMAT_SPEC" => "TIMESTAMP_FORMAT_SPEC", "
                        "NTS="TIMESTAMP_FORMAT_SPEC", DLL2=%f, RATE=%f\n",
-                       this, new_timestamp, ts, m_buffer_next_tail_timestamp, m_dll_e2, getRate());
+                       this, new_timestamp, TS_TO_TICKS(ts), TS_TO_TICKS(m_buffer_next_tail_timestamp),
+                       TS_TO_FLOAT(m_dll_e2), getRate());
 }
 
 /**
@@ -924,10 +949,12 @@ void TimestampedBuffer::setBufferHeadTimestamp(ffado_timestamp_t new_timestamp)
  * @param fc address to store the associated framecounter in
  */
 void TimestampedBuffer::getBufferHeadTimestamp(ffado_timestamp_t *ts, signed int *fc) {
-    ENTER_CRITICAL_SECTION;
-    *fc = m_framecounter;
-    *ts = getTimestampFromTail(*fc);
-    EXIT_CRITICAL_SECTION;
+    uint32_t seq;
+    do {
+        seq = m_state_lock.readBegin();
+        *fc = getFrameCounter();
+        *ts = calculateTimestampFromTail(*fc);
+    } while (m_state_lock.readRetry(seq));
 }
 
 /**
@@ -941,10 +968,12 @@ void TimestampedBuffer::getBufferHeadTimestamp(ffado_timestamp_t *ts, signed int
  * @param fc address to store the associated framecounter in
  */
 void TimestampedBuffer::getBufferTailTimestamp(ffado_timestamp_t *ts, signed int *fc) {
-    ENTER_CRITICAL_SECTION;
-    *fc = m_framecounter;
-    *ts = getTimestampFromTail(0);
-    EXIT_CRITICAL_SECTION;
+    uint32_t seq;
+    do {
+        seq = m_state_lock.readBegin();
+        *fc = getFrameCounter();
+        *ts = calculateTimestampFromTail(0);
+    } while (m_state_lock.readRetry(seq));
 }
 
 /**
@@ -957,13 +986,33 @@ void TimestampedBuffer::getBufferTailTimestamp(ffado_timestamp_t *ts, signed int
  * @return timestamp value
  */
 ffado_timestamp_t TimestampedBuffer::getTimestampFromTail(int nframes)
+{
+    ffado_timestamp_t retval;
+    uint32_t seq;
+    do {
+        seq = m_state_lock.readBegin();
+        retval = calculateTimestampFromTail(nframes);
+    } while (m_state_lock.readRetry(seq));
+    return retval;
+}
+
+/**
+ * @brief Calculates the timestamp nframes earlier than the buffer tail
+ *
+ * @note does not take care of the consistency of the state, the caller
+ *       should do that (i.e. call this from a seqlock read section).
+ *
+ * @param nframes number of frames
+ * @return timestamp value
+ */
+ffado_timestamp_t TimestampedBuffer::calculateTimestampFromTail(int nframes)
 {
     // ts(x) = m_buffer_tail_timestamp -
     //         (m_buffer_next_tail_timestamp - m_buffer_tail_timestamp)/(samples_between_updates)*(x)
-    ffado_timestamp_t timestamp;
+    ffado_timestamp_state_t timestamp;
     timestamp = m_buffer_tail_timestamp;
 
-    timestamp -= (ffado_timestamp_t)((nframes) * m_current_rate);
+    timestamp -= (ffado_timestamp_state_t)((nframes) * m_current_rate);
 
     if(timestamp >= m_wrap_at) {
         timestamp -= m_wrap_at;
@@ -971,7 +1020,7 @@ ffado_timestamp_t TimestampedBuffer::getTimestampFromTail(int nframes)
         timestamp += m_wrap_at;
     }
 
-    return timestamp;
+    return TS_TO_TICKS(timestamp);
 }
 
 /**
@@ -986,31 +1035,35 @@ ffado_timestamp_t TimestampedBuffer::getTimestampFromTail(int nframes)
 ffado_timestamp_t TimestampedBuffer::getTimestampFromHead(int nframes)
 {
     ffado_timestamp_t retval;
-    ENTER_CRITICAL_SECTION;
-    retval = getTimestampFromTail(m_framecounter - nframes);
-    EXIT_CRITICAL_SECTION;
+    uint32_t seq;
+    do {
+        seq = m_state_lock.readBegin();
+        retval = calculateTimestampFromTail(getFrameCounter() - nframes);
+    } while (m_state_lock.readRetry(seq));
     return retval;
 }
 
 /**
  * Resets the frame counter, in a atomic way. This
  * is thread safe.
+ *
+ * @note should not race with decrementFrameCounter()
  */
 void TimestampedBuffer::resetFrameCounter() {
     ENTER_CRITICAL_SECTION;
-    m_framecounter = 0;
+    m_frames_written = m_frames_read;
     EXIT_CRITICAL_SECTION;
 }
 
 /**
- * Decrements the frame counter in a thread safe way.
+ * Decrements the frame counter in a thread safe way. This
+ * only advances the read counter atomically, hence never
+ * blocks nor is blocked by the writing side.
  *
  * @param nbframes number of frames to decrement
  */
 void TimestampedBuffer::decrementFrameCounter(unsigned int nbframes) {
-    ENTER_CRITICAL_SECTION;
-    m_framecounter -= nbframes;
-    EXIT_CRITICAL_SECTION;
+    __sync_fetch_and_add(&m_frames_read, nbframes);
 }
 
 /**
@@ -1026,7 +1079,7 @@ void TimestampedBuffer::decrementFrameCounter(unsigned int nbframes) {
 void TimestampedBuffer::incrementFrameCounter(unsigned int nbframes, ffado_timestamp_t new_timestamp) {
 
     // require the timestamps to be in the correct range
-    assert(new_timestamp < m_wrap_at);
+    assert(TS_FROM_TICKS(new_timestamp) < m_wrap_at);
     assert(new_timestamp >= 0);
     // if this is not true the timestamps have to be corrected
     // to account for the non-uniform update period
@@ -1034,7 +1087,7 @@ void TimestampedBuffer::incrementFrameCounter(unsigned int nbframes, ffado_times
 
     // the difference between the given TS and the one predicted for this time instant
     // this is the error for the DLL
-    ffado_timestamp_t diff = new_timestamp - m_buffer_next_tail_timestamp;
+    ffado_timestamp_state_t diff = TS_FROM_TICKS(new_timestamp) - m_buffer_next_tail_timestamp;
 
     // correct for when new_timestamp doesn't wrap at the same time as
     // m_buffer_next_tail_timestamp
@@ -1046,57 +1099,57 @@ void TimestampedBuffer::incrementFrameCounter(unsigned int nbframes, ffado_times
 #ifdef DEBUG
 
     // check whether the update is within the allowed bounds
-    ffado_timestamp_t max_abs_diff = m_max_abs_diff;
+    ffado_timestamp_state_t max_abs_diff = TS_FROM_TICKS(m_max_abs_diff);
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        " nbframes: %d, m_update_period: %d \n",
                        nbframes, m_update_period);
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        " tail TS: "TIMESTAMP_FORMAT_SPEC", next tail TS: "TIMESTAMP_FORMAT_SPEC"\n", 
-                       m_buffer_tail_timestamp, m_buffer_next_tail_timestamp);
+                       TS_TO_TICKS(m_buffer_tail_timestamp), TS_TO_TICKS(m_buffer_next_tail_timestamp));
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        " new TS: "TIMESTAMP_FORMAT_SPEC", diff: "TIMESTAMP_FORMAT_SPEC"\n", 
-                       new_timestamp, diff);
+                       new_timestamp, TS_TO_TICKS(diff));
 
     if (diff > max_abs_diff) {
         //debugShowBackLogLines(100);
         debugWarning("(%p) difference rather large (+): diff="TIMESTAMP_FORMAT_SPEC", max="TIMESTAMP_FORMAT_SPEC", "TIMESTAMP_FORMAT_SPEC", "TIMESTAMP_FORMAT_SPEC"\n",
-            this, diff, max_abs_diff, new_timestamp, m_buffer_next_tail_timestamp);
+            this, TS_TO_TICKS(diff), TS_TO_TICKS(max_abs_diff), new_timestamp, TS_TO_TICKS(m_buffer_next_tail_timestamp));
     } else if (diff < -max_abs_diff) {
         //debugShowBackLogLines(100);
         debugWarning("(%p) difference rather large (-): diff="TIMESTAMP_FORMAT_SPEC", max="TIMESTAMP_FORMAT_SPEC", "TIMESTAMP_FORMAT_SPEC", "TIMESTAMP_FORMAT_SPEC"\n",
-            this, diff, -max_abs_diff, new_timestamp, m_buffer_next_tail_timestamp);
+            this, TS_TO_TICKS(diff), TS_TO_TICKS(-max_abs_diff), new_timestamp, TS_TO_TICKS(m_buffer_next_tail_timestamp));
     }
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "(%p): diff="TIMESTAMP_FORMAT_SPEC" ",
-                       this, diff);
+                       this, TS_TO_TICKS(diff));
 #endif
 
-    double err = diff;
     debugOutputShortExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                             "diff2="TIMESTAMP_FORMAT_SPEC" err=%f\n",
-                            diff, err);
+                            TS_TO_TICKS(diff), TS_TO_FLOAT(diff));
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "B: FC=%10u, TS="TIMESTAMP_FORMAT_SPEC", NTS="TIMESTAMP_FORMAT_SPEC"\n",
-                       m_framecounter, m_buffer_tail_timestamp, m_buffer_next_tail_timestamp);
+                       getFrameCounter(), TS_TO_TICKS(m_buffer_tail_timestamp), TS_TO_TICKS(m_buffer_next_tail_timestamp));
 
     ENTER_CRITICAL_SECTION;
-    m_framecounter += nbframes;
+    m_frames_written = m_frames_written + nbframes;
     m_buffer_tail_timestamp = m_buffer_next_tail_timestamp;
-    m_buffer_next_tail_timestamp = m_buffer_next_tail_timestamp + (ffado_timestamp_t)(m_dll_b * err + m_dll_e2);
-    m_dll_e2 += m_dll_c*err;
+    m_buffer_next_tail_timestamp = m_buffer_next_tail_timestamp
+                                   + (ffado_timestamp_state_t)(DLL_GAIN(m_dll_b, diff) + m_dll_e2);
+    m_dll_e2 += DLL_GAIN(m_dll_c, diff);
 
     if (m_buffer_next_tail_timestamp >= m_wrap_at) {
         debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                            "Unwrapping next tail timestamp: "TIMESTAMP_FORMAT_SPEC"",
-                           m_buffer_next_tail_timestamp);
+                           TS_TO_TICKS(m_buffer_next_tail_timestamp));
 
         m_buffer_next_tail_timestamp -= m_wrap_at;
 
         debugOutputShortExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                                 " => "TIMESTAMP_FORMAT_SPEC"\n",
-                                m_buffer_next_tail_timestamp);
+                                TS_TO_TICKS(m_buffer_next_tail_timestamp));
 
     }
     m_current_rate = calculateRate();
@@ -1104,24 +1157,25 @@ void TimestampedBuffer::incrementFrameCounter(unsigned int nbframes, ffado_times
 
     debugOutputExtreme(DEBUG_LEVEL_VERY_VERBOSE,
                        "A: TS="TIMESTAMP_FORMAT_SPEC", NTS="TIMESTAMP_FORMAT_SPEC", DLLe2=%f, RATE=%f\n",
-                       m_buffer_tail_timestamp, m_buffer_next_tail_timestamp, m_dll_e2, m_current_rate);
+                       TS_TO_TICKS(m_buffer_tail_timestamp), TS_TO_TICKS(m_buffer_next_tail_timestamp),
+                       TS_TO_FLOAT(m_dll_e2), RATE_TO_FLOAT(m_current_rate));
 
 
     if(m_buffer_tail_timestamp>=m_wrap_at) {
-        debugError("Wrapping failed for m_buffer_tail_timestamp! "TIMESTAMP_FORMAT_SPEC"\n",m_buffer_tail_timestamp);
+        debugError("Wrapping failed for m_buffer_tail_timestamp! "TIMESTAMP_FORMAT_SPEC"\n",TS_TO_TICKS(m_buffer_tail_timestamp));
         debugOutput(DEBUG_LEVEL_VERY_VERBOSE, " IN="TIMESTAMP_FORMAT_SPEC", TS="TIMESTAMP_FORMAT_SPEC", NTS="TIMESTAMP_FORMAT_SPEC"\n",
-                    new_timestamp, m_buffer_tail_timestamp, m_buffer_next_tail_timestamp);
+                    new_timestamp, TS_TO_TICKS(m_buffer_tail_timestamp), TS_TO_TICKS(m_buffer_next_tail_timestamp));
 
     }
     if(m_buffer_next_tail_timestamp>=m_wrap_at) {
-        debugError("Wrapping failed for m_buffer_next_tail_timestamp! "TIMESTAMP_FORMAT_SPEC"\n",m_buffer_next_tail_timestamp);
+        debugError("Wrapping failed for m_buffer_next_tail_timestamp! "TIMESTAMP_FORMAT_SPEC"\n",TS_TO_TICKS(m_buffer_next_tail_timestamp));
         debugOutput(DEBUG_LEVEL_VERY_VERBOSE, " IN="TIMESTAMP_FORMAT_SPEC", TS="TIMESTAMP_FORMAT_SPEC", NTS="TIMESTAMP_FORMAT_SPEC"\n",
-                    new_timestamp, m_buffer_tail_timestamp, m_buffer_next_tail_timestamp);
+                    new_timestamp, TS_TO_TICKS(m_buffer_tail_timestamp), TS_TO_TICKS(m_buffer_next_tail_timestamp));
     }
     
     if(m_buffer_tail_timestamp==m_buffer_next_tail_timestamp) {
         debugError("Current and next timestamps are equal: "TIMESTAMP_FORMAT_SPEC" "TIMESTAMP_FORMAT_SPEC"\n",
-                   m_buffer_tail_timestamp,m_buffer_next_tail_timestamp);
+                   TS_TO_TICKS(m_buffer_tail_timestamp),TS_TO_TICKS(m_buffer_next_tail_timestamp));
     }
 
     // this DLL allows the calculation of any sample timestamp relative to the buffer tail,
@@ -1141,18 +1195,19 @@ void TimestampedBuffer::dumpInfo() {
     getBufferHeadTimestamp(&ts_head,&fc);
 
 #ifdef DEBUG
-    ffado_timestamp_t diff=(ffado_timestamp_t)ts_head - (ffado_timestamp_t)m_buffer_tail_timestamp;
+    ffado_timestamp_t diff=(ffado_timestamp_t)ts_head - TS_TO_TICKS(m_buffer_tail_timestamp);
 #endif
 
     debugOutputShort( DEBUG_LEVEL_NORMAL, "  TimestampedBuffer (%p): %04d frames, %04d events\n",
-                                          this, m_framecounter, getBufferFill());
+                                          this, getFrameCounter(), getBufferFill());
     debugOutputShort( DEBUG_LEVEL_NORMAL, "   Timestamps           : head: "TIMESTAMP_FORMAT_SPEC", Tail: "TIMESTAMP_FORMAT_SPEC", Next tail: "TIMESTAMP_FORMAT_SPEC"\n",
-                                          ts_head, m_buffer_tail_timestamp, m_buffer_next_tail_timestamp);
+                                          ts_head, TS_TO_TICKS(m_buffer_tail_timestamp), TS_TO_TICKS(m_buffer_next_tail_timestamp));
 #ifdef DEBUG
-    debugOutputShort( DEBUG_LEVEL_NORMAL, "    Head - Tail         : "TIMESTAMP_FORMAT_SPEC" (%f frames)\n", diff, diff/m_dll_e2*m_update_period);
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "    Head - Tail         : "TIMESTAMP_FORMAT_SPEC" (%f frames)\n", diff, diff/TS_TO_FLOAT(m_dll_e2)*m_update_period);
 #endif
-    debugOutputShort( DEBUG_LEVEL_NORMAL, "   DLL Rate             : %f (%f)\n", m_dll_e2, m_dll_e2/m_update_period);
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "   DLL Rate             : %f (%f)\n", TS_TO_FLOAT(m_dll_e2), TS_TO_FLOAT(m_dll_e2)/m_update_period);
     debugOutputShort( DEBUG_LEVEL_NORMAL, "   DLL Bandwidth        : %10e 1/ticks (%f Hz)\n", getBandwidth(), getBandwidth() * TICKS_PER_SECOND);
+    debugOutputShort( DEBUG_LEVEL_NORMAL, "   State read retries   : %u\n", m_state_lock.getReadRetries());
 }
 
 } // end of namespace Util
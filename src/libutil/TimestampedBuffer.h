@@ -24,19 +24,42 @@
 #ifndef __FFADO_TIMESTAMPEDBUFFER__
 #define __FFADO_TIMESTAMPEDBUFFER__
 
+#include "config.h"
+
 #include "debugmodule/debugmodule.h"
 #include "libutil/ringbuffer.h"
+#include "libutil/SeqLock.h"
 #include <pthread.h>
 
 //typedef float ffado_timestamp_t;
 //#define TIMESTAMP_FORMAT_SPEC "%14.3f"
 
+#if FIXED_POINT_TIMESTAMPS
+
+#include <inttypes.h>
+
+// timestamps are passed around as integer ticks
+typedef int64_t ffado_timestamp_t;
+#define TIMESTAMP_FORMAT_SPEC "%14"PRId64
+#define TIMESTAMP_MAX 3145728000LL
+
+// the buffer state (timestamps and DLL) is kept as ticks with
+// TIMESTAMP_FRACTION_BITS bits of sub-tick precision, such that
+// no error accumulates when running for a long time.
+#define TIMESTAMP_FRACTION_BITS 24
+typedef int64_t ffado_timestamp_state_t;
+typedef int64_t ffado_rate_state_t;
+
+#else
+
 typedef double ffado_timestamp_t;
 #define TIMESTAMP_FORMAT_SPEC "%14.3f"
 #define TIMESTAMP_MAX 3145728000.0
 
-// typedef int64_t ffado_timestamp_t;
-// #define TIMESTAMP_FORMAT_SPEC "%012lld"
+typedef double ffado_timestamp_state_t;
+typedef float ffado_rate_state_t;
+
+#endif
 
 namespace Util
 {
@@ -128,7 +151,7 @@ class TimestampedBuffer
         unsigned int getBufferSpace();
 
         // timestamp stuff
-        int getFrameCounter() {return m_framecounter;};
+        int getFrameCounter() {return (signed int)(m_frames_written - m_frames_read);};
 
         void getBufferHeadTimestamp ( ffado_timestamp_t *ts, signed int *fc );
         void getBufferTailTimestamp ( ffado_timestamp_t *ts, signed int *fc );
@@ -156,10 +179,13 @@ class TimestampedBuffer
 
         bool resizeBuffer(unsigned int size);
 
+        unsigned int getStateReadRetries() {return m_state_lock.getReadRetries();};
+
     private:
         void decrementFrameCounter(unsigned int nbframes);
         void incrementFrameCounter(unsigned int nbframes, ffado_timestamp_t new_timestamp);
         void resetFrameCounter();
+        ffado_timestamp_t calculateTimestampFromTail(int nframes);
 
     protected:
 
@@ -176,35 +202,40 @@ class TimestampedBuffer
         bool m_enabled; // you can get frames FIXME: rename!!
         bool m_transparent; // the buffer should hold the frames put in it. if true, discards all frames
 
-        ffado_timestamp_t m_wrap_at; // value to wrap at
+        ffado_timestamp_state_t m_wrap_at; // value to wrap at
 
         TimestampedBufferClient *m_Client;
 
         DECLARE_DEBUG_MODULE;
 
     private:
-        // the framecounter gives the number of frames in the buffer
-        signed int m_framecounter;
+        // the framecounter gives the number of frames in the buffer. It is
+        // kept as two free running counters such that the writing side
+        // (seqlock protected, together with the timestamps) and the reading
+        // side (atomic add) never have to wait for each other.
+        // framecounter = m_frames_written - m_frames_read (modulo 2^32)
+        volatile uint32_t m_frames_written;
+        volatile uint32_t m_frames_read;
 
         // the buffer tail timestamp gives the timestamp of the last frame
         // that was put into the buffer
-        ffado_timestamp_t   m_buffer_tail_timestamp;
-        ffado_timestamp_t   m_buffer_next_tail_timestamp;
+        ffado_timestamp_state_t m_buffer_tail_timestamp;
+        ffado_timestamp_state_t m_buffer_next_tail_timestamp;
 
-        // this mutex protects the access to the framecounter
-        // and the buffer head timestamp.
-        pthread_mutex_t m_framecounter_lock;
+        // this seqlock protects the consistency of the written framecounter,
+        // the tail timestamps and the DLL state.
+        SeqLock m_state_lock;
 
         // tracking DLL variables
 // JMW: try double for this too
 //    float m_dll_e2;
-        double m_dll_e2;
+        ffado_timestamp_state_t m_dll_e2;
         float m_dll_b;
         float m_dll_c;
 
         float m_nominal_rate;
-        float calculateRate();
-        float m_current_rate;
+        ffado_rate_state_t calculateRate();
+        ffado_rate_state_t m_current_rate;
         unsigned int m_update_period;
 
         unsigned int m_max_abs_diff;
@@ -0,0 +1,234 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "WorkerPool.h"
+#include "PosixThread.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <string.h>
+
+namespace Util {
+
+IMPL_DEBUG_MODULE( WorkerPool, WorkerPool, DEBUG_LEVEL_NORMAL );
+
+WorkerPool::Worker::Worker(WorkerPool &parent, int cpu)
+    : m_parent( parent )
+    , m_cpu( cpu )
+    , m_debugModule( parent.m_debugModule )
+{
+}
+
+bool
+WorkerPool::Worker::Init()
+{
+    if (m_cpu < 0) return true;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(m_cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err) {
+        // not fatal, the worker just runs unpinned
+        debugWarning("(%s) Could not pin worker to CPU %d: %s\n",
+                     m_parent.m_id.c_str(), m_cpu, strerror(err));
+    } else {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "(%s) worker pinned to CPU %d\n",
+                    m_parent.m_id.c_str(), m_cpu);
+    }
+    return true;
+}
+
+bool
+WorkerPool::Worker::Execute()
+{
+    if (sem_wait(&m_parent.m_start_semaphore) < 0) {
+        // interrupted, try again
+        return true;
+    }
+    if (m_parent.m_stop) {
+        return false;
+    }
+    m_parent.runJobs();
+    // the implied full barrier makes the results of the jobs
+    // visible to the caller of execute()
+    if (__sync_sub_and_fetch(&m_parent.m_participants, 1) == 0) {
+        sem_post(&m_parent.m_done_semaphore);
+    }
+    return true;
+}
+
+WorkerPool::WorkerPool(std::string id, unsigned int nb_workers,
+                       bool realtime, int priority)
+    : m_id( id )
+    , m_nb_workers( nb_workers )
+    , m_realtime( realtime )
+    , m_priority( priority )
+    , m_jobs( NULL )
+    , m_nb_jobs( 0 )
+    , m_next_job( 0 )
+    , m_participants( 0 )
+    , m_stop( false )
+{
+    sem_init(&m_start_semaphore, 0, 0);
+    sem_init(&m_done_semaphore, 0, 0);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stop();
+    sem_destroy(&m_start_semaphore);
+    sem_destroy(&m_done_semaphore);
+}
+
+bool
+WorkerPool::start()
+{
+    if (m_threads.size()) {
+        debugError("(%s) Already started\n", m_id.c_str());
+        return false;
+    }
+    m_stop = false;
+    for (unsigned int i = 0; i < m_nb_workers; i++) {
+        int cpu = (m_cpus.size() ? m_cpus.at(i % m_cpus.size()) : -1);
+        Worker *w = new Worker(*this, cpu);
+        char name[16];
+        snprintf(name, sizeof(name), "%s%u", m_id.c_str(), i);
+        Thread *t = new PosixThread(w, name, m_realtime, m_priority,
+                                    PTHREAD_CANCEL_DEFERRED);
+        if (t->Start() != 0) {
+            debugError("(%s) Could not start worker %u\n", m_id.c_str(), i);
+            delete t;
+            delete w;
+            stop();
+            return false;
+        }
+        m_workers.push_back(w);
+        m_threads.push_back(t);
+    }
+    debugOutput(DEBUG_LEVEL_VERBOSE, "(%s) started %u workers (%s, prio %d)\n",
+                m_id.c_str(), m_nb_workers, (m_realtime ? "RT" : "non-RT"), m_priority);
+    return true;
+}
+
+void
+WorkerPool::stop()
+{
+    if (m_threads.size() == 0) return;
+
+    m_stop = true;
+    for (unsigned int i = 0; i < m_threads.size(); i++) {
+        sem_post(&m_start_semaphore);
+    }
+    for (unsigned int i = 0; i < m_threads.size(); i++) {
+        m_threads.at(i)->Stop();
+        delete m_threads.at(i);
+        delete m_workers.at(i);
+    }
+    m_threads.clear();
+    m_workers.clear();
+
+    // drop any wakeup that wasn't consumed
+    while (sem_trywait(&m_start_semaphore) == 0) {};
+}
+
+void
+WorkerPool::runJobs()
+{
+    int32_t idx;
+    while ((idx = __sync_fetch_and_add(&m_next_job, 1)) < (int32_t)m_nb_jobs) {
+        m_jobs[idx]->run();
+    }
+}
+
+void
+WorkerPool::execute(Job **jobs, unsigned int nb_jobs)
+{
+    if (nb_jobs == 0) return;
+
+    // no point in waking more workers than there are jobs left
+    // for them after we took one ourselves
+    unsigned int helpers = nb_jobs - 1;
+    if (helpers > m_threads.size()) helpers = m_threads.size();
+
+    m_jobs = jobs;
+    m_nb_jobs = nb_jobs;
+    m_next_job = 0;
+    m_participants = helpers + 1;
+    __sync_synchronize();
+
+    for (unsigned int i = 0; i < helpers; i++) {
+        sem_post(&m_start_semaphore);
+    }
+
+    runJobs();
+
+    // whoever finishes last signals the caller, when that
+    // is the caller itself there is nothing to wait for
+    if (__sync_sub_and_fetch(&m_participants, 1) != 0) {
+        while (sem_wait(&m_done_semaphore) < 0 && errno == EINTR) {};
+    }
+}
+
+bool
+WorkerPool::parseCpuList(const std::string &str, std::vector<int> &cpus)
+{
+    cpus.clear();
+    const char *p = str.c_str();
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        if (end == p || first < 0 || first >= CPU_SETSIZE) return false;
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first || last >= CPU_SETSIZE) return false;
+            p = end;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void
+WorkerPool::setVerboseLevel(int l)
+{
+    setDebugLevel(l);
+    for (unsigned int i = 0; i < m_threads.size(); i++) {
+        m_threads.at(i)->setVerboseLevel(l);
+    }
+}
+
+} // end of namespace Util
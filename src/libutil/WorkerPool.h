@@ -0,0 +1,133 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_WORKERPOOL__
+#define __FFADO_WORKERPOOL__
+
+#include "debugmodule/debugmodule.h"
+#include "libutil/Thread.h"
+
+#include <vector>
+#include <string>
+#include <semaphore.h>
+
+namespace Util {
+
+/**
+ * @brief A small pool of threads that executes batches of jobs
+ *
+ * The pool is meant for work that has to be done in a bounded time, e.g.
+ * once per period. execute() hands a batch of jobs to the workers, runs
+ * jobs itself as well, and returns when all jobs of the batch are done.
+ * The jobs are claimed one by one, so a batch with more jobs than threads
+ * is balanced automatically.
+ *
+ * The worker threads can be pinned to a set of CPU's. Worker i runs on
+ * cpus[i % cpus.size()].
+ */
+class WorkerPool
+{
+public:
+    class Job
+    {
+    public:
+        virtual ~Job() {};
+        virtual void run() = 0;
+    };
+
+    WorkerPool(std::string id, unsigned int nb_workers,
+               bool realtime, int priority);
+    virtual ~WorkerPool();
+
+    /**
+     * @brief set the CPU's the workers are pinned to
+     * should be called before start()
+     * @param cpus the CPU numbers, empty to not pin the workers
+     */
+    void setCpuAffinity(const std::vector<int> &cpus) {m_cpus = cpus;};
+
+    bool start();
+    void stop();
+
+    /**
+     * @brief execute a batch of jobs
+     * executes the jobs on the workers and on the calling thread,
+     * returns when all jobs are finished. Only one thread may call this
+     * at a time.
+     */
+    void execute(Job **jobs, unsigned int nb_jobs);
+
+    unsigned int getNbWorkers() {return m_workers.size();};
+
+    /**
+     * @brief parse a list of CPU numbers, e.g. "2,3" or "1-3,6"
+     * @return false if the string can't be parsed
+     */
+    static bool parseCpuList(const std::string &str, std::vector<int> &cpus);
+
+    void setVerboseLevel(int l);
+
+private:
+    class Worker : public RunnableInterface
+    {
+    public:
+        Worker(WorkerPool &parent, int cpu);
+        virtual ~Worker() {};
+
+        bool Init();
+        bool Execute();
+    private:
+        WorkerPool& m_parent;
+        int m_cpu;
+        DECLARE_DEBUG_MODULE_REFERENCE;
+    };
+
+    void runJobs();
+
+    std::string m_id;
+    unsigned int m_nb_workers;
+    bool m_realtime;
+    int m_priority;
+    std::vector<int> m_cpus;
+
+    std::vector<Worker *> m_workers;
+    std::vector<Thread *> m_threads;
+
+    // the current batch
+    Job ** volatile m_jobs;
+    volatile unsigned int m_nb_jobs;
+    volatile int32_t m_next_job;
+    // the threads that still have to finish the batch,
+    // including the one that called execute()
+    volatile int32_t m_participants;
+    volatile bool m_stop;
+
+    sem_t m_start_semaphore;
+    sem_t m_done_semaphore;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+} // end of namespace Util
+
+#endif /* __FFADO_WORKERPOOL__ */
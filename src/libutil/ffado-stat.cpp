@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Prints the live statistics that an FFADO process (e.g. jackd)
+ * publishes in shared memory, see libutil/StatsRegistry.h
+ */
+
+#include "debugmodule/debugmodule.h"
+#include "libutil/StatsRegistry.h"
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+
+#include <map>
+
+using namespace Util;
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+// Program documentation.
+static char doc[] = "ffado-stat -- print the live streaming statistics of an FFADO process\n\n"
+                    "Without a PID, the first process that publishes statistics is used.\n"
+                    "Counters are shown with their rate over the interval, gauges with\n"
+                    "their last value and range, histograms with their percentiles.\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "[PID]";
+
+struct arguments
+{
+    short verbose;
+    int pid;
+    unsigned int interval;
+    unsigned int count;
+    bool buckets;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"interval",    'i',    "ms",   0,  "Refresh interval (1000)" },
+    {"count",       'n',    "n",    0,  "Number of refreshes, 0 is forever (1)" },
+    {"buckets",     'b',    0,      0,  "Print the histogram buckets" },
+    { 0 }
+};
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+    case 'v':
+        arguments->verbose = strtol( arg, &tail, 0 );
+        break;
+    case 'i':
+        arguments->interval = strtol( arg, &tail, 0 );
+        break;
+    case 'n':
+        arguments->count = strtol( arg, &tail, 0 );
+        break;
+    case 'b':
+        arguments->buckets = true;
+        break;
+    case ARGP_KEY_ARG:
+        if (state->arg_num >= 1) {
+            // Too many arguments.
+            argp_usage( state );
+        }
+        arguments->pid = strtol( arg, &tail, 0 );
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static volatile int run;
+
+static void sighandler (int sig)
+{
+    run = 0;
+}
+
+static void
+printEntry( const StatsReader::Snapshot &s, uint64_t last_count,
+            double seconds, bool buckets )
+{
+    const char *unit = s.unit.c_str();
+    switch ( s.type ) {
+    case StatsRegistry::eT_Counter:
+        printf( "  %-48s %12"PRIu64" %s", s.name.c_str(), s.count, unit );
+        if ( seconds > 0 ) {
+            printf( " (%.1f/s)", ( s.count - last_count ) / seconds );
+        }
+        printf( "\n" );
+        break;
+    case StatsRegistry::eT_Gauge:
+        if ( s.count == 0 ) {
+            printf( "  %-48s %12s\n", s.name.c_str(), "-" );
+            break;
+        }
+        printf( "  %-48s %12"PRId64" %s (min %"PRId64", max %"PRId64")\n",
+                s.name.c_str(), s.value, unit, s.min, s.max );
+        break;
+    case StatsRegistry::eT_Histogram:
+        if ( s.count == 0 ) {
+            printf( "  %-48s %12s\n", s.name.c_str(), "-" );
+            break;
+        }
+        printf( "  %-48s %12"PRIu64" x, avg %.1f, min %"PRId64", p50 %"PRIu64", p99 %"PRIu64", p99.9 %"PRIu64", max %"PRId64" %s\n",
+                s.name.c_str(), s.count, (double)s.value / s.count, s.min,
+                s.getPercentile( 0.5 ), s.getPercentile( 0.99 ), s.getPercentile( 0.999 ),
+                s.max, unit );
+        if ( buckets ) {
+            for ( unsigned int i = 0; i < STATS_HISTOGRAM_BUCKETS; i++ ) {
+                if ( s.buckets[i] ) {
+                    printf( "  %48s >= %-12"PRIu64" %12"PRIu64"\n", "",
+                            Stat::getBucketLowerBound( i ), s.buckets[i] );
+                }
+            }
+        }
+        break;
+    }
+}
+
+int
+main( int argc, char **argv )
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.verbose  = 0;
+    arguments.pid      = 0;
+    arguments.interval = 1000;
+    arguments.count    = 1;
+    arguments.buckets  = false;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        return EXIT_FAILURE;
+    }
+
+    setDebugLevel( arguments.verbose );
+
+    StatsReader reader;
+    if ( !reader.open( arguments.pid ) ) {
+        if ( arguments.pid ) {
+            fprintf( stderr, "Process %d doesn't publish statistics\n", arguments.pid );
+        } else {
+            fprintf( stderr, "No process publishes statistics\n" );
+        }
+        return EXIT_FAILURE;
+    }
+
+    run = 1;
+    signal( SIGINT, sighandler );
+    signal( SIGPIPE, sighandler );
+
+    // the counts of the previous refresh, for the rates
+    std::map<std::string, uint64_t> last_counts;
+    StatsReader::Snapshot s;
+    for ( unsigned int n = 0; run && ( arguments.count == 0 || n < arguments.count ); n++ ) {
+        if ( n > 0 ) {
+            usleep( arguments.interval * 1000 );
+            if ( !run ) {
+                break;
+            }
+            printf( "\n" );
+        }
+        double seconds = ( n > 0 ? arguments.interval / 1000.0 : 0.0 );
+        printf( "FFADO statistics of process %d:\n", reader.getPid() );
+        unsigned int nb_entries = reader.getNbEntries();
+        for ( unsigned int i = 0; i < nb_entries; i++ ) {
+            if ( !reader.read( i, s ) ) {
+                continue;
+            }
+            uint64_t &last_count = last_counts[s.name];
+            printEntry( s, last_count, seconds, arguments.buckets );
+            last_count = s.count;
+        }
+        fflush( stdout );
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Renders the xrun flight records that are written when the
+ * streaming.spm.flight_recorder_dir setting is set, see
+ * libutil/FlightRecorder.h
+ */
+
+#include "libutil/FlightRecorder.h"
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+// Program documentation.
+static char doc[] = "ffado-xrun-decode -- print an FFADO xrun flight record as a timeline\n\n"
+                    "The flight record holds the last events of every stream before\n"
+                    "an xrun. The times are in microseconds relative to the moment\n"
+                    "the xrun was handled. It has to be decoded on the machine\n"
+                    "(architecture) that wrote it.\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "RECORDFILE";
+
+struct arguments
+{
+    const char* output;
+    const char* args[1];
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"output",  'o',    "file",  0,  "Write the timeline to this file instead of stdout" },
+    { 0 }
+};
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+
+    switch (key) {
+    case 'o':
+        arguments->output = arg;
+        break;
+    case ARGP_KEY_ARG:
+        if (state->arg_num >= 1) {
+            // Too many arguments.
+            argp_usage( state );
+        }
+        arguments->args[state->arg_num] = arg;
+        break;
+    case ARGP_KEY_END:
+        if (state->arg_num < 1) {
+            // Not enough arguments.
+            argp_usage( state );
+        }
+        break;
+    default:
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+int
+main( int argc, char **argv )
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.output  = NULL;
+    arguments.args[0] = "";
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        return EXIT_FAILURE;
+    }
+
+    FILE *in = fopen( arguments.args[0], "r" );
+    if ( in == NULL ) {
+        fprintf( stderr, "Could not open %s: %s\n", arguments.args[0], strerror( errno ) );
+        return EXIT_FAILURE;
+    }
+    FILE *out = stdout;
+    if ( arguments.output ) {
+        out = fopen( arguments.output, "w" );
+        if ( out == NULL ) {
+            fprintf( stderr, "Could not open %s: %s\n", arguments.output, strerror( errno ) );
+            fclose( in );
+            return EXIT_FAILURE;
+        }
+    }
+
+    bool ok = Util::FlightRecorder::decode( in, out );
+
+    fclose( in );
+    if ( out != stdout ) {
+        fclose( out );
+    }
+    return ( ok ? EXIT_SUCCESS : EXIT_FAILURE );
+}
@@ -0,0 +1,355 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "version.h" // FOR CACHE_VERSION
+
+#include "serialize_binary.h"
+
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+#define BINARY_SERIALIZE_TYPE_INTEGER   0
+#define BINARY_SERIALIZE_TYPE_STRING    1
+
+IMPL_DEBUG_MODULE( Util::BinarySerialize,   BinarySerialize,   DEBUG_LEVEL_NORMAL );
+IMPL_DEBUG_MODULE( Util::BinaryDeserialize, BinaryDeserialize, DEBUG_LEVEL_NORMAL );
+
+// the XML (de)serializers tokenize the member names on '/', so
+// "a//b/" and "a/b" refer to the same member. Keep that behavior.
+static string
+normalizeName( const string& name )
+{
+    vector<string> tokens;
+    tokenize( name, tokens, "/" );
+    string result;
+    for ( vector<string>::const_iterator it = tokens.begin();
+          it != tokens.end();
+          ++it )
+    {
+        if ( result.size() ) result += "/";
+        result += *it;
+    }
+    return result;
+}
+
+Util::BinarySerialize::BinarySerialize( std::string fileName, uint64_t key )
+    : IOSerialize()
+    , m_filepath( fileName )
+    , m_key( key )
+{
+}
+
+Util::BinarySerialize::~BinarySerialize()
+{
+}
+
+bool
+Util::BinarySerialize::write( std::string strMemberName,
+                              long long value )
+{
+    debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "write %s = %lld\n",
+                 strMemberName.c_str(), value );
+    Value &v = m_values[normalizeName( strMemberName )];
+    v.is_string = false;
+    v.value = value;
+    v.str.clear();
+    return true;
+}
+
+bool
+Util::BinarySerialize::write( std::string strMemberName,
+                              std::string str )
+{
+    debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "write %s = %s\n",
+                 strMemberName.c_str(), str.c_str() );
+    Value &v = m_values[normalizeName( strMemberName )];
+    v.is_string = true;
+    v.value = 0;
+    v.str = str;
+    return true;
+}
+
+bool
+Util::BinarySerialize::commit()
+{
+    struct binary_serialize_header header;
+    memset( &header, 0, sizeof( header ) );
+    strncpy( header.magic, BINARY_SERIALIZE_MAGIC, sizeof( header.magic ) );
+    header.format_version = BINARY_SERIALIZE_FORMAT_VERSION;
+    header.byte_order = BINARY_SERIALIZE_BYTE_ORDER;
+    strncpy( header.cache_version, CACHE_VERSION, sizeof( header.cache_version ) - 1 );
+    header.key = m_key;
+    header.nb_entries = m_values.size();
+
+    // the map is sorted, so are the entries
+    vector<struct binary_serialize_entry> entries;
+    string pool;
+    for ( ValueMap::const_iterator it = m_values.begin();
+          it != m_values.end();
+          ++it )
+    {
+        struct binary_serialize_entry e;
+        e.name_offset = pool.size();
+        e.name_length = it->first.size();
+        pool += it->first;
+        if ( it->second.is_string ) {
+            e.type = BINARY_SERIALIZE_TYPE_STRING;
+            e.length = it->second.str.size();
+            e.value = pool.size();
+            pool += it->second.str;
+        } else {
+            e.type = BINARY_SERIALIZE_TYPE_INTEGER;
+            e.length = 0;
+            e.value = it->second.value;
+        }
+        entries.push_back( e );
+    }
+    header.pool_size = pool.size();
+
+    // write to a temporary file and rename it, such that a reader
+    // never sees a partially written file. The name is unique, several
+    // discovery threads can write caches at the same time.
+    string tmp_path = m_filepath + ".XXXXXX";
+    vector<char> tmp_name( tmp_path.begin(), tmp_path.end() );
+    tmp_name.push_back( '\0' );
+    int fd = mkstemp( &tmp_name[0] );
+    if ( fd < 0 ) {
+        debugError( "Could not create %s: %s\n", tmp_path.c_str(), strerror( errno ) );
+        return false;
+    }
+    tmp_path = &tmp_name[0];
+    // mkstemp creates the file for the owner only
+    fchmod( fd, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP );
+    FILE *f = fdopen( fd, "wb" );
+    if ( f == NULL ) {
+        debugError( "Could not open %s: %s\n", tmp_path.c_str(), strerror( errno ) );
+        close( fd );
+        unlink( tmp_path.c_str() );
+        return false;
+    }
+    bool result = true;
+    result &= fwrite( &header, sizeof( header ), 1, f ) == 1;
+    if ( entries.size() ) {
+        result &= fwrite( &entries[0], sizeof( entries[0] ), entries.size(), f ) == entries.size();
+    }
+    if ( pool.size() ) {
+        result &= fwrite( pool.data(), pool.size(), 1, f ) == 1;
+    }
+    result &= fclose( f ) == 0;
+
+    if ( !result || rename( tmp_path.c_str(), m_filepath.c_str() ) != 0 ) {
+        debugError( "Could not write %s: %s\n", m_filepath.c_str(), strerror( errno ) );
+        unlink( tmp_path.c_str() );
+        return false;
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "wrote %zd entries (%zd bytes) to %s\n",
+                 entries.size(),
+                 sizeof( header ) + entries.size() * sizeof( entries[0] ) + pool.size(),
+                 m_filepath.c_str() );
+    return true;
+}
+
+/////////////////////////////////////
+
+Util::BinaryDeserialize::BinaryDeserialize( std::string fileName, uint64_t key )
+    : IODeserialize()
+    , m_filepath( fileName )
+    , m_key( key )
+    , m_map( NULL )
+    , m_map_size( 0 )
+    , m_entries( NULL )
+    , m_nb_entries( 0 )
+    , m_pool( NULL )
+{
+    open();
+}
+
+Util::BinaryDeserialize::BinaryDeserialize( std::string fileName, uint64_t key, int verboseLevel )
+    : IODeserialize()
+    , m_filepath( fileName )
+    , m_key( key )
+    , m_map( NULL )
+    , m_map_size( 0 )
+    , m_entries( NULL )
+    , m_nb_entries( 0 )
+    , m_pool( NULL )
+{
+    setDebugLevel( verboseLevel );
+    open();
+}
+
+Util::BinaryDeserialize::~BinaryDeserialize()
+{
+    if ( m_map ) {
+        munmap( m_map, m_map_size );
+    }
+}
+
+void
+Util::BinaryDeserialize::open()
+{
+    int fd = ::open( m_filepath.c_str(), O_RDONLY );
+    if ( fd < 0 ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "Could not open %s: %s\n",
+                     m_filepath.c_str(), strerror( errno ) );
+        return;
+    }
+    struct stat st;
+    if ( fstat( fd, &st ) != 0 || !S_ISREG( st.st_mode )
+         || st.st_size < (off_t)sizeof( struct binary_serialize_header ) ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "%s is not a valid cache file\n",
+                     m_filepath.c_str() );
+        close( fd );
+        return;
+    }
+    m_map_size = st.st_size;
+    m_map = mmap( NULL, m_map_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+    close( fd );
+    if ( m_map == MAP_FAILED ) {
+        debugError( "Could not map %s: %s\n", m_filepath.c_str(), strerror( errno ) );
+        m_map = NULL;
+        return;
+    }
+    if ( !checkHeader() ) {
+        munmap( m_map, m_map_size );
+        m_map = NULL;
+    }
+}
+
+bool
+Util::BinaryDeserialize::checkHeader()
+{
+    const struct binary_serialize_header *header
+        = (const struct binary_serialize_header *)m_map;
+
+    if ( strncmp( header->magic, BINARY_SERIALIZE_MAGIC, sizeof( header->magic ) ) != 0
+         || header->format_version != BINARY_SERIALIZE_FORMAT_VERSION
+         || header->byte_order != BINARY_SERIALIZE_BYTE_ORDER ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "%s: unsupported file format\n", m_filepath.c_str() );
+        return false;
+    }
+    if ( strncmp( header->cache_version, CACHE_VERSION, sizeof( header->cache_version ) ) != 0 ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "%s: cache version %.32s, expected %s\n",
+                     m_filepath.c_str(), header->cache_version, CACHE_VERSION );
+        return false;
+    }
+    if ( header->key != m_key ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "%s: key mismatch\n", m_filepath.c_str() );
+        return false;
+    }
+    size_t expected = sizeof( *header )
+                      + (size_t)header->nb_entries * sizeof( struct binary_serialize_entry )
+                      + header->pool_size;
+    if ( expected != m_map_size ) {
+        debugWarning( "%s: size mismatch (%zd != %zd), ignoring\n",
+                      m_filepath.c_str(), m_map_size, expected );
+        return false;
+    }
+
+    const struct binary_serialize_entry *entries
+        = (const struct binary_serialize_entry *)( header + 1 );
+    // check the bounds once, such that lookups don't have to
+    for ( uint32_t i = 0; i < header->nb_entries; i++ ) {
+        const struct binary_serialize_entry *e = &entries[i];
+        if ( (uint64_t)e->name_offset + e->name_length > header->pool_size
+             || ( e->type == BINARY_SERIALIZE_TYPE_STRING
+                  && ( e->value < 0 || (uint64_t)e->value + e->length > header->pool_size ) ) ) {
+            debugWarning( "%s: entry %u out of bounds, ignoring\n", m_filepath.c_str(), i );
+            return false;
+        }
+    }
+
+    m_entries = entries;
+    m_nb_entries = header->nb_entries;
+    m_pool = (const char *)( entries + m_nb_entries );
+    return true;
+}
+
+const struct Util::binary_serialize_entry *
+Util::BinaryDeserialize::find( const std::string &member_name )
+{
+    if ( !m_entries ) return NULL;
+    string name = normalizeName( member_name );
+
+    // the entries are sorted as std::string sorts them
+    uint32_t lo = 0, hi = m_nb_entries;
+    while ( lo < hi ) {
+        uint32_t mid = lo + ( hi - lo ) / 2;
+        const struct binary_serialize_entry *e = &m_entries[mid];
+        int cmp = name.compare( 0, string::npos, m_pool + e->name_offset, e->name_length );
+        if ( cmp == 0 ) {
+            return e;
+        } else if ( cmp < 0 ) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+bool
+Util::BinaryDeserialize::read( std::string strMemberName,
+                               long long& value )
+{
+    const struct binary_serialize_entry *e = find( strMemberName );
+    if ( !e || e->type != BINARY_SERIALIZE_TYPE_INTEGER ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "no integer %s\n", strMemberName.c_str() );
+        return false;
+    }
+    value = e->value;
+    debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "read %s = %lld\n",
+                 strMemberName.c_str(), value );
+    return true;
+}
+
+bool
+Util::BinaryDeserialize::read( std::string strMemberName,
+                               std::string& str )
+{
+    const struct binary_serialize_entry *e = find( strMemberName );
+    if ( !e || e->type != BINARY_SERIALIZE_TYPE_STRING ) {
+        debugOutput( DEBUG_LEVEL_VERBOSE, "no string %s\n", strMemberName.c_str() );
+        return false;
+    }
+    str.assign( m_pool + e->value, e->length );
+    debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "read %s = %s\n",
+                 strMemberName.c_str(), str.c_str() );
+    return true;
+}
+
+bool
+Util::BinaryDeserialize::isExisting( std::string strMemberName )
+{
+    return find( strMemberName ) != NULL;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef __FFADO_UTIL_SERIALIZE_BINARY_H__
+#define __FFADO_UTIL_SERIALIZE_BINARY_H__
+
+#include "debugmodule/debugmodule.h"
+#include "serialize.h"
+
+#include <map>
+#include <string>
+#include <stdint.h>
+
+namespace Util {
+
+/*
+ * The binary cache file format. All values are in host byte order, the
+ * cache is not meant to be moved between machines.
+ *
+ *   header
+ *   entries[nb_entries], sorted by name
+ *   string pool (names and string values, not terminated)
+ *
+ * The file is mapped as is, a lookup is a binary search over the entries.
+ */
+#define BINARY_SERIALIZE_MAGIC          "FFADOBC"
+#define BINARY_SERIALIZE_FORMAT_VERSION 1
+#define BINARY_SERIALIZE_BYTE_ORDER     0x01020304
+
+struct binary_serialize_header {
+    char     magic[8];
+    uint32_t format_version;
+    uint32_t byte_order;
+    char     cache_version[32];
+    // chosen by the user of the file, a file with another key is ignored
+    uint64_t key;
+    uint32_t nb_entries;
+    uint32_t pool_size;
+};
+
+struct binary_serialize_entry {
+    uint32_t name_offset;
+    uint32_t name_length;
+    uint32_t type;
+    // the length of a string value
+    uint32_t length;
+    // the integer value, or the pool offset of a string value
+    int64_t  value;
+};
+
+class BinarySerialize: public IOSerialize {
+public:
+    BinarySerialize( std::string fileName, uint64_t key );
+    virtual ~BinarySerialize();
+
+    virtual bool write( std::string strMemberName,
+                        long long value );
+    virtual bool write( std::string strMemberName,
+                        std::string str);
+
+    /**
+     * @brief write the file
+     * nothing is written to disk before this is called. The file is
+     * replaced atomically, so readers never see a partial file.
+     */
+    bool commit();
+
+    void setVerboseLevel( int l ) {setDebugLevel( l );};
+
+private:
+    struct Value {
+        bool        is_string;
+        long long   value;
+        std::string str;
+    };
+    typedef std::map< std::string, Value > ValueMap;
+
+    std::string  m_filepath;
+    uint64_t     m_key;
+    ValueMap     m_values;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+class BinaryDeserialize: public IODeserialize {
+public:
+    BinaryDeserialize( std::string fileName, uint64_t key );
+    BinaryDeserialize( std::string fileName, uint64_t key, int verboseLevel );
+    virtual ~BinaryDeserialize();
+
+    virtual bool read( std::string strMemberName,
+                       long long& value );
+    virtual bool read( std::string strMemberName,
+                       std::string& str );
+
+    virtual bool isExisting( std::string strMemberName );
+    bool isValid() {return m_entries != NULL;};
+
+private:
+    void open();
+    bool checkHeader();
+    const struct binary_serialize_entry *find( const std::string &name );
+
+    std::string  m_filepath;
+    uint64_t     m_key;
+
+    // the mapped file
+    void *       m_map;
+    size_t       m_map_size;
+    const struct binary_serialize_entry *m_entries;
+    uint32_t     m_nb_entries;
+    const char * m_pool;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+}
+
+#endif
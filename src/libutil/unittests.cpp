@@ -23,11 +23,18 @@
 
 #include "serialize.h"
 #include "OptionContainer.h"
+#include "WorkerPool.h"
+#include "serialize_binary.h"
+#include "StatsRegistry.h"
+#include "libcontrol/Element.h"
+#include "libcontrol/ValueCache.h"
 
 #include <libraw1394/raw1394.h>
 
 #include <stdio.h>
 #include <cstring>
+#include <unistd.h>
+#include <stdexcept>
 
 using namespace Util;
 
@@ -514,6 +521,240 @@ testU4()
     return result;
 }
 
+/////////////////////////////////////
+
+class U5_CountJob : public WorkerPool::Job {
+public:
+    U5_CountJob() : m_count( 0 ) {};
+    void run() { m_count++; };
+    unsigned int m_count;
+};
+
+static bool
+testU5()
+{
+    bool result=true;
+    std::vector<int> cpus;
+    result &= TEST_SHOULD_RETURN_TRUE(WorkerPool::parseCpuList("1-3,6", cpus));
+    result &= TEST_SHOULD_RETURN_TRUE(cpus.size() == 4 && cpus.at(0) == 1 && cpus.at(3) == 6);
+    result &= TEST_SHOULD_RETURN_TRUE(WorkerPool::parseCpuList("", cpus));
+    result &= TEST_SHOULD_RETURN_TRUE(cpus.size() == 0);
+    result &= TEST_SHOULD_RETURN_FALSE(WorkerPool::parseCpuList("2-1", cpus));
+    result &= TEST_SHOULD_RETURN_FALSE(WorkerPool::parseCpuList("a", cpus));
+
+    const unsigned int nb_jobs = 7;
+    const unsigned int nb_batches = 10000;
+    U5_CountJob jobs[nb_jobs];
+    WorkerPool::Job *job_ptrs[nb_jobs];
+    for (unsigned int i = 0; i < nb_jobs; i++) {
+        job_ptrs[i] = &jobs[i];
+    }
+
+    WorkerPool pool("TEST", 3, false, 0);
+    result &= TEST_SHOULD_RETURN_TRUE(pool.start());
+    for (unsigned int b = 0; b < nb_batches; b++) {
+        // vary the batch size to exercise the helper count
+        unsigned int n = 1 + (b % nb_jobs);
+        pool.execute(job_ptrs, n);
+    }
+    pool.stop();
+
+    // job i runs in every batch of size > i
+    for (unsigned int i = 0; i < nb_jobs; i++) {
+        unsigned int expected = 0;
+        for (unsigned int b = 0; b < nb_batches; b++) {
+            if (1 + (b % nb_jobs) > i) expected++;
+        }
+        result &= TEST_SHOULD_RETURN_TRUE(jobs[i].m_count == expected);
+    }
+    return result;
+}
+
+///////////////////////////////////////
+
+static bool
+testU6()
+{
+    U0_SerializeMe sme1;
+
+    sme1.m_byte = 0x12;
+    sme1.m_quadlet = 0x12345678;
+
+    {
+        BinarySerialize binSerialize( "unittest_u6.bin", 0x1234 );
+        if ( !sme1.serialize( binSerialize )
+             || !binSerialize.write( "SerializeMe/m_string", std::string( "test" ) )
+             || !binSerialize.commit() )
+        {
+            printf( "(serializing failed)" );
+            return false;
+        }
+    }
+
+    U0_SerializeMe sme2;
+    std::string str;
+    bool result = true;
+    {
+        BinaryDeserialize binDeserialize( "unittest_u6.bin", 0x1234 );
+        result &= TEST_SHOULD_RETURN_TRUE( binDeserialize.isValid() );
+        result &= TEST_SHOULD_RETURN_TRUE( sme2.deserialize( binDeserialize ) );
+        result &= TEST_SHOULD_RETURN_TRUE( binDeserialize.read( "SerializeMe//m_string", str ) );
+        result &= TEST_SHOULD_RETURN_FALSE( binDeserialize.isExisting( "SerializeMe/m_none" ) );
+    }
+    result &= TEST_SHOULD_RETURN_TRUE( sme1 == sme2 );
+    result &= TEST_SHOULD_RETURN_TRUE( str == "test" );
+
+    {
+        // a cache written for another key is ignored
+        BinaryDeserialize binDeserialize( "unittest_u6.bin", 0x4321 );
+        result &= TEST_SHOULD_RETURN_FALSE( binDeserialize.isValid() );
+    }
+    return result;
+}
+
+///////////////////////////////////////
+
+static bool
+testU7()
+{
+    bool result = true;
+
+    // the histogram buckets are log-linear and cover each value once
+    for (int64_t v = 0; v < 100000; v++) {
+        unsigned int idx = Util::Stat::getBucketIndex(v);
+        if (Util::Stat::getBucketLowerBound(idx) > (uint64_t)v
+            || (idx + 1 < STATS_HISTOGRAM_BUCKETS
+                && Util::Stat::getBucketLowerBound(idx + 1) <= (uint64_t)v)) {
+            printf( "(value %"PRId64" in bucket %u)", v, idx );
+            return false;
+        }
+    }
+    result &= TEST_SHOULD_RETURN_TRUE( Util::Stat::getBucketIndex(-1000) == Util::Stat::getBucketIndex(1000) );
+
+    Util::StatsRegistry *r = Util::StatsRegistry::instance();
+    Util::Stat c = r->registerStat("unittest/counter", Util::StatsRegistry::eT_Counter);
+    Util::Stat h = r->registerStat("unittest/histogram", Util::StatsRegistry::eT_Histogram, "usec");
+    result &= TEST_SHOULD_RETURN_TRUE( c.isRegistered() );
+    c.add(3);
+    c.add();
+    for (int i = 1; i <= 100; i++) {
+        h.record(i);
+    }
+
+    // read them back like ffado-stat does
+    Util::StatsReader reader;
+    result &= TEST_SHOULD_RETURN_TRUE( reader.open(getpid()) );
+    Util::StatsReader::Snapshot s;
+    bool found_counter = false, found_histogram = false;
+    for (unsigned int i = 0; i < reader.getNbEntries(); i++) {
+        if (!reader.read(i, s)) continue;
+        if (s.name == "unittest/counter") {
+            found_counter = true;
+            result &= TEST_SHOULD_RETURN_TRUE( s.count == 4 );
+        } else if (s.name == "unittest/histogram") {
+            found_histogram = true;
+            result &= TEST_SHOULD_RETURN_TRUE( s.count == 100 && s.value == 5050 );
+            result &= TEST_SHOULD_RETURN_TRUE( s.min == 1 && s.max == 100 && s.unit == "usec" );
+            uint64_t p50 = s.getPercentile(0.5);
+            result &= TEST_SHOULD_RETURN_TRUE( p50 >= 40 && p50 <= 50 );
+        }
+    }
+    result &= TEST_SHOULD_RETURN_TRUE( found_counter && found_histogram );
+
+    // an unregistered handle can still be updated
+    r->unregisterStat(c);
+    result &= TEST_SHOULD_RETURN_FALSE( c.isRegistered() );
+    c.add();
+    result &= TEST_SHOULD_RETURN_TRUE( c.getCount() == 0 );
+    r->unregisterStat(h);
+    return result;
+}
+
+/////////////////////////////////////
+
+#define U8_NB_VALUES 8
+
+// a cache on an array of values, counts the element accesses
+class U8_ValueCache : public Control::ValueCache {
+public:
+    U8_ValueCache( Control::ValueCacheFlusher &f, Control::Element &e )
+    : Control::ValueCache( f, e )
+    , m_reads( 0 )
+    , m_writes( 0 )
+    , m_fail( false )
+    {
+        for (int i = 0; i < U8_NB_VALUES; i++) {
+            m_values[i] = i;
+        }
+    };
+
+    double m_values[U8_NB_VALUES];
+    int m_reads;
+    int m_writes;
+    bool m_fail;
+
+protected:
+    bool readValue( uint64_t key, double &value ) {
+        if (m_fail) throw std::runtime_error( "read failed" );
+        m_reads++;
+        value = m_values[key];
+        return true;
+    };
+    bool writeValues( const std::vector<uint64_t> &keys,
+                      const std::vector<double> &values ) {
+        if (m_fail) throw std::runtime_error( "write failed" );
+        m_writes++;
+        for (unsigned int i = 0; i < keys.size(); i++) {
+            m_values[keys.at(i)] = values.at(i);
+        }
+        return true;
+    };
+};
+
+static bool
+testU8()
+{
+    bool result = true;
+    double v;
+
+    // no maximum age, no flusher thread, at most 4 values per cache
+    Control::ValueCacheFlusher flusher( 0, 0, 4 );
+    Control::Element element( NULL, "unittest" );
+    U8_ValueCache cache( flusher, element );
+
+    // a value is read from the element once, until it is invalidated
+    result &= TEST_SHOULD_RETURN_TRUE( cache.get(1, v) && v == 1.0 );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.get(1, v) && cache.m_reads == 1 );
+    element.invalidateValues();
+    result &= TEST_SHOULD_RETURN_TRUE( cache.get(1, v) && cache.m_reads == 2 );
+
+    // a value set twice is served from the cache and written once
+    result &= TEST_SHOULD_RETURN_TRUE( cache.set(2, 20.0) );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.set(2, 21.0) );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.get(2, v) && v == 21.0 );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.m_values[2] == 2.0 );
+    result &= TEST_SHOULD_RETURN_TRUE( flusher.flushAll() );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.m_values[2] == 21.0 && cache.m_writes == 1 );
+
+    // a full cache drops the clean values first, then flushes
+    for (int i = 0; i < U8_NB_VALUES; i++) {
+        result &= TEST_SHOULD_RETURN_TRUE( cache.set(i, 100.0 + i) );
+    }
+    result &= TEST_SHOULD_RETURN_TRUE( cache.m_writes == 2 && cache.m_values[3] == 103.0 );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.m_values[4] == 4.0 );
+    result &= TEST_SHOULD_RETURN_TRUE( flusher.flushAll() );
+    result &= TEST_SHOULD_RETURN_TRUE( cache.m_values[7] == 107.0 );
+
+    // a failed write is reported, the value is read from the element again
+    result &= TEST_SHOULD_RETURN_TRUE( cache.set(5, 55.0) );
+    cache.m_fail = true;
+    result &= TEST_SHOULD_RETURN_FALSE( flusher.flushAll() );
+    result &= TEST_SHOULD_RETURN_FALSE( cache.get(5, v) );
+    cache.m_fail = false;
+    result &= TEST_SHOULD_RETURN_TRUE( cache.get(5, v) && v == 105.0 );
+    return result;
+}
+
 /////////////////////////////////////
 /////////////////////////////////////
 /////////////////////////////////////
@@ -531,6 +772,10 @@ TestEntry TestTable[] = {
     { "serialize 2",  testU2 },
     { "serialize 3",  testU3 },
     { "OptionContainer 1",  testU4 },
+    { "WorkerPool 1",  testU5 },
+    { "serialize binary",  testU6 },
+    { "StatsRegistry 1",  testU7 },
+    { "ValueCache 1",  testU8 },
 };
 
 int
@@ -0,0 +1,448 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include "config.h"
+
+#include "meterservice.h"
+#include "ffadodevice.h"
+
+#include "libieee1394/configrom.h"
+
+#include "libutil/PosixSharedMemory.h"
+#include "libutil/PosixThread.h"
+#include "libutil/SeqLock.h"
+
+#include <string.h>
+#include <stdio.h>
+
+IMPL_DEBUG_MODULE( MeterService, MeterService, DEBUG_LEVEL_NORMAL );
+IMPL_DEBUG_MODULE( MeterReader, MeterReader, DEBUG_LEVEL_NORMAL );
+
+// single writer, hence no atomic operations are needed to update the
+// sequence counters
+static inline void
+writeBegin( volatile uint32_t *sequence )
+{
+    *sequence = *sequence + 1;
+    SEQLOCK_WRITE_BARRIER();
+}
+
+static inline void
+writeEnd( volatile uint32_t *sequence )
+{
+    SEQLOCK_WRITE_BARRIER();
+    *sequence = *sequence + 1;
+}
+
+// the reader can't trust the writer to be alive, hence it gives up after
+// METERSERVICE_READ_MAX_TRIES. tries counts both the waits for a write
+// to finish and the retries of the read.
+static inline bool
+readBegin( const volatile uint32_t *sequence, uint32_t *seq, unsigned int *tries )
+{
+    while ((*seq = *sequence) & 1) {
+        if (++(*tries) >= METERSERVICE_READ_MAX_TRIES) {
+            return false;
+        }
+        SEQLOCK_CPU_RELAX();
+    }
+    if (++(*tries) >= METERSERVICE_READ_MAX_TRIES) {
+        return false;
+    }
+    SEQLOCK_READ_BARRIER();
+    return true;
+}
+
+static inline bool
+readRetry( const volatile uint32_t *sequence, uint32_t seq )
+{
+    SEQLOCK_READ_BARRIER();
+    return *sequence != seq;
+}
+
+MeterService::MeterService()
+    : m_segment( NULL )
+    , m_shm( NULL )
+    , m_thread( NULL )
+    , m_rate_hz( 0 )
+    , m_next_update( 0 )
+{
+}
+
+MeterService::~MeterService()
+{
+    stop();
+    if (m_segment) {
+        // the owner unlinks the segment
+        delete m_segment;
+    }
+}
+
+bool
+MeterService::createSegment()
+{
+    if (m_segment) {
+        return true;
+    }
+    m_segment = new Util::PosixSharedMemory( METERSERVICE_SHM_NAME,
+                                             sizeof(struct meterservice_segment) );
+    m_segment->setVerboseLevel( getDebugLevel() );
+    if (!m_segment->Create( Util::PosixSharedMemory::eD_ReadWrite )) {
+        debugError("Could not create the meter segment\n");
+        delete m_segment;
+        m_segment = NULL;
+        return false;
+    }
+    m_shm = (struct meterservice_segment *)m_segment->requestBlock( 0, sizeof(struct meterservice_segment) );
+    if (m_shm == NULL) {
+        debugError("Could not access the meter segment\n");
+        delete m_segment;
+        m_segment = NULL;
+        return false;
+    }
+    memset( m_shm, 0, sizeof(struct meterservice_segment) );
+    m_shm->magic = METERSERVICE_SHM_MAGIC;
+    m_shm->version = METERSERVICE_SHM_VERSION;
+    return true;
+}
+
+void
+MeterService::publishLayout()
+{
+    writeBegin( &m_shm->sequence );
+    m_shm->nb_devices = m_devices.size();
+    m_shm->rate_hz = m_rate_hz;
+    for (unsigned int i = 0; i < m_devices.size(); i++) {
+        PolledDevice &d = m_devices.at(i);
+        struct meterservice_device *shm = d.shm;
+        writeBegin( &shm->sequence );
+        shm->nb_meters = d.nb_published;
+        shm->guid = d.device->getConfigRom().getGuid();
+        shm->timestamp_usecs = 0;
+        shm->nb_updates = 0;
+        shm->nb_failures = 0;
+        memset( shm->names, 0, sizeof(shm->names) );
+        memset( shm->values, 0, sizeof(shm->values) );
+        for (unsigned int m = 0; m < d.nb_published; m++) {
+            strncpy( shm->names[m], d.device->getMeterName(m).c_str(), METERSERVICE_NAME_LEN - 1 );
+        }
+        writeEnd( &shm->sequence );
+    }
+    writeEnd( &m_shm->sequence );
+}
+
+bool
+MeterService::start( const DeviceVector& devices, unsigned int rate_hz )
+{
+    if (m_thread) {
+        debugError("Meter service already running\n");
+        return false;
+    }
+    if (rate_hz == 0) {
+        debugError("Invalid meter rate\n");
+        return false;
+    }
+    if (!createSegment()) {
+        return false;
+    }
+
+    m_devices.clear();
+    for ( DeviceVector::const_iterator it = devices.begin();
+          it != devices.end();
+          ++it )
+    {
+        unsigned int nb_meters = (*it)->getMeterCount();
+        if (nb_meters == 0) {
+            continue;
+        }
+        if (m_devices.size() == METERSERVICE_MAX_DEVICES) {
+            debugWarning("Too many devices with meters, skipping %s\n",
+                         (*it)->getConfigRom().getGuidString().c_str());
+            continue;
+        }
+        PolledDevice d;
+        d.device = *it;
+        d.shm = &m_shm->devices[m_devices.size()];
+        d.values.resize( nb_meters );
+        d.nb_published = nb_meters;
+        if (nb_meters > METERSERVICE_MAX_METERS) {
+            debugWarning("Device %s has %u meters, only publishing %u\n",
+                         (*it)->getConfigRom().getGuidString().c_str(),
+                         nb_meters, METERSERVICE_MAX_METERS);
+            d.nb_published = METERSERVICE_MAX_METERS;
+        }
+        m_devices.push_back( d );
+    }
+    m_rate_hz = rate_hz;
+    publishLayout();
+
+    debugOutput(DEBUG_LEVEL_VERBOSE, "Publishing the meters of %zd device(s) at %u Hz\n",
+                m_devices.size(), m_rate_hz);
+
+    m_next_update = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    m_thread = new Util::PosixThread(this, "METERS", false, 0, PTHREAD_CANCEL_DEFERRED);
+    if (m_thread->Start() != 0) {
+        debugError("Could not start the meter service thread\n");
+        delete m_thread;
+        m_thread = NULL;
+        return false;
+    }
+    return true;
+}
+
+void
+MeterService::stop()
+{
+    if (m_thread == NULL) {
+        return;
+    }
+    m_thread->Stop();
+    delete m_thread;
+    m_thread = NULL;
+
+    // the devices might go away, don't publish them anymore
+    m_devices.clear();
+    publishLayout();
+}
+
+bool
+MeterService::Init()
+{
+    return true;
+}
+
+bool
+MeterService::Execute()
+{
+    for ( std::vector< PolledDevice >::iterator it = m_devices.begin();
+          it != m_devices.end();
+          ++it )
+    {
+        PolledDevice &d = *it;
+        // the bus transactions happen outside of the write section
+        if (!d.device->readMeters( &d.values[0] )) {
+            debugOutput(DEBUG_LEVEL_VERBOSE, "Could not read the meters of %s\n",
+                        d.device->getConfigRom().getGuidString().c_str());
+            d.shm->nb_failures++;
+            continue;
+        }
+        writeBegin( &d.shm->sequence );
+        memcpy( d.shm->values, &d.values[0], d.nb_published * sizeof(float) );
+        d.shm->timestamp_usecs = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+        d.shm->nb_updates++;
+        writeEnd( &d.shm->sequence );
+    }
+
+    // keep the rate, unless we're too late already
+    ffado_microsecs_t now = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+    m_next_update += 1000000 / m_rate_hz;
+    if (m_next_update < now) {
+        m_next_update = now;
+    } else {
+        Util::SystemTimeSource::SleepUsecAbsolute( m_next_update );
+    }
+    return true;
+}
+
+void
+MeterService::setVerboseLevel( int l )
+{
+    setDebugLevel( l );
+    if (m_segment) {
+        m_segment->setVerboseLevel( l );
+    }
+}
+
+void
+MeterService::show()
+{
+    debugOutput(DEBUG_LEVEL_NORMAL, "Meter service: %s, %u Hz, %zd device(s)\n",
+                (m_thread ? "running" : "stopped"), m_rate_hz, m_devices.size());
+    for ( std::vector< PolledDevice >::iterator it = m_devices.begin();
+          it != m_devices.end();
+          ++it )
+    {
+        debugOutput(DEBUG_LEVEL_NORMAL, " %s: %zd meters, %u updates, %u failures\n",
+                    it->device->getConfigRom().getGuidString().c_str(),
+                    it->values.size(), it->shm->nb_updates, it->shm->nb_failures);
+    }
+}
+
+// ------------------------------------------------------------------------
+
+MeterReader::MeterReader()
+    : m_segment( NULL )
+    , m_shm( NULL )
+{
+}
+
+MeterReader::~MeterReader()
+{
+    close();
+}
+
+bool
+MeterReader::open()
+{
+    if (m_segment) {
+        return true;
+    }
+    m_segment = new Util::PosixSharedMemory( METERSERVICE_SHM_NAME,
+                                             sizeof(struct meterservice_segment) );
+    if (!m_segment->Open( Util::PosixSharedMemory::eD_ReadOnly )) {
+        debugOutput(DEBUG_LEVEL_VERBOSE, "Could not open the meter segment\n");
+        delete m_segment;
+        m_segment = NULL;
+        return false;
+    }
+    m_shm = (const struct meterservice_segment *)m_segment->requestBlock( 0, sizeof(struct meterservice_segment) );
+    if (m_shm == NULL || m_shm->magic != METERSERVICE_SHM_MAGIC
+        || m_shm->version != METERSERVICE_SHM_VERSION) {
+        debugError("Incompatible meter segment\n");
+        close();
+        return false;
+    }
+    return true;
+}
+
+void
+MeterReader::close()
+{
+    if (m_segment) {
+        delete m_segment;
+        m_segment = NULL;
+    }
+    m_shm = NULL;
+}
+
+unsigned int
+MeterReader::getNbDevices()
+{
+    if (m_shm == NULL) {
+        return 0;
+    }
+    uint32_t seq, nb_devices;
+    unsigned int tries = 0;
+    do {
+        if (!readBegin( &m_shm->sequence, &seq, &tries )) {
+            debugWarning("Meter segment not consistent, is the service alive?\n");
+            return 0;
+        }
+        nb_devices = m_shm->nb_devices;
+    } while (readRetry( &m_shm->sequence, seq ));
+    return nb_devices;
+}
+
+uint64_t
+MeterReader::getDeviceGuid( unsigned int dev )
+{
+    if (m_shm == NULL || dev >= METERSERVICE_MAX_DEVICES) {
+        return 0;
+    }
+    const struct meterservice_device *shm = &m_shm->devices[dev];
+    uint32_t seq;
+    uint64_t guid;
+    unsigned int tries = 0;
+    do {
+        if (!readBegin( &shm->sequence, &seq, &tries )) {
+            debugWarning("Meter segment not consistent, is the service alive?\n");
+            return 0;
+        }
+        guid = shm->guid;
+    } while (readRetry( &shm->sequence, seq ));
+    return guid;
+}
+
+unsigned int
+MeterReader::getNbMeters( unsigned int dev )
+{
+    if (m_shm == NULL || dev >= METERSERVICE_MAX_DEVICES) {
+        return 0;
+    }
+    const struct meterservice_device *shm = &m_shm->devices[dev];
+    uint32_t seq, nb_meters;
+    unsigned int tries = 0;
+    do {
+        if (!readBegin( &shm->sequence, &seq, &tries )) {
+            debugWarning("Meter segment not consistent, is the service alive?\n");
+            return 0;
+        }
+        nb_meters = shm->nb_meters;
+    } while (readRetry( &shm->sequence, seq ));
+    return nb_meters;
+}
+
+std::string
+MeterReader::getMeterName( unsigned int dev, unsigned int meter )
+{
+    if (m_shm == NULL || dev >= METERSERVICE_MAX_DEVICES
+        || meter >= METERSERVICE_MAX_METERS) {
+        return "";
+    }
+    const struct meterservice_device *shm = &m_shm->devices[dev];
+    uint32_t seq;
+    char name[METERSERVICE_NAME_LEN];
+    unsigned int tries = 0;
+    do {
+        if (!readBegin( &shm->sequence, &seq, &tries )) {
+            debugWarning("Meter segment not consistent, is the service alive?\n");
+            return "";
+        }
+        memcpy( name, shm->names[meter], METERSERVICE_NAME_LEN );
+    } while (readRetry( &shm->sequence, seq ));
+    name[METERSERVICE_NAME_LEN - 1] = 0;
+    return name;
+}
+
+unsigned int
+MeterReader::readValues( unsigned int dev, float *values, unsigned int max_values,
+                         uint64_t *timestamp_usecs )
+{
+    if (m_shm == NULL || dev >= METERSERVICE_MAX_DEVICES) {
+        return 0;
+    }
+    const struct meterservice_device *shm = &m_shm->devices[dev];
+    uint32_t seq, nb_meters;
+    uint64_t timestamp;
+    unsigned int tries = 0;
+    do {
+        if (!readBegin( &shm->sequence, &seq, &tries )) {
+            debugWarning("Meter segment not consistent, is the service alive?\n");
+            return 0;
+        }
+        nb_meters = shm->nb_meters;
+        if (nb_meters > max_values) {
+            nb_meters = max_values;
+        }
+        if (nb_meters > METERSERVICE_MAX_METERS) {
+            // torn read, the retry catches it
+            nb_meters = 0;
+        }
+        memcpy( values, shm->values, nb_meters * sizeof(float) );
+        timestamp = shm->timestamp_usecs;
+    } while (readRetry( &shm->sequence, seq ));
+    if (timestamp_usecs) {
+        *timestamp_usecs = timestamp;
+    }
+    return nb_meters;
+}
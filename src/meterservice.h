@@ -0,0 +1,181 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef FFADO_METERSERVICE_H
+#define FFADO_METERSERVICE_H
+
+#include "debugmodule/debugmodule.h"
+
+#include "libutil/Thread.h"
+#include "libutil/SystemTimeSource.h"
+
+#include <stdint.h>
+#include <vector>
+
+class FFADODevice;
+
+namespace Util {
+    class PosixSharedMemory;
+}
+
+/*
+ * The layout of the meter segment. It only contains fixed size types such
+ * that any process can map it, independent of the FFADO version it was
+ * built against (check the magic and the version).
+ *
+ * There is one writer, the meter service. The values of each device are
+ * protected by a sequence counter: it is odd while the writer updates
+ * the device, and incremented on every update. A reader copies what it
+ * needs and retries when the counter was odd or changed meanwhile, up to
+ * METERSERVICE_READ_MAX_TRIES times. The readers never write to the
+ * segment and never block the writer.
+ */
+#define METERSERVICE_SHM_NAME           "ffado-meters"
+#define METERSERVICE_SHM_MAGIC          0x4D455452  // 'METR'
+#define METERSERVICE_SHM_VERSION        1
+
+#define METERSERVICE_MAX_DEVICES        16
+#define METERSERVICE_MAX_METERS         128
+#define METERSERVICE_NAME_LEN           32
+
+struct meterservice_device {
+    volatile uint32_t   sequence;
+    uint32_t            nb_meters;
+    uint64_t            guid;
+    // time of the last update
+    uint64_t            timestamp_usecs;
+    uint32_t            nb_updates;
+    uint32_t            nb_failures;
+    char                names[METERSERVICE_MAX_METERS][METERSERVICE_NAME_LEN];
+    // fraction of full scale, 0.0 to 1.0
+    float               values[METERSERVICE_MAX_METERS];
+};
+
+struct meterservice_segment {
+    uint32_t            magic;
+    uint32_t            version;
+    // the layout (nb_devices and the device names) changes when the
+    // service is restarted, e.g. after a bus reset
+    volatile uint32_t   sequence;
+    uint32_t            nb_devices;
+    uint32_t            rate_hz;
+    uint32_t            reserved;
+    struct meterservice_device devices[METERSERVICE_MAX_DEVICES];
+};
+
+/**
+ * @brief Publishes the meters of the devices in shared memory
+ *
+ * Polls the meters of all devices (FFADODevice::readMeters()) at a fixed
+ * rate from one thread, and publishes them in a shared memory segment
+ * that any number of processes can map read-only (see MeterReader).
+ * That avoids a bus transaction and a D-Bus round trip per reader.
+ */
+class MeterService : public Util::RunnableInterface
+{
+public:
+    typedef std::vector< FFADODevice* > DeviceVector;
+
+    MeterService();
+    virtual ~MeterService();
+
+    /**
+     * @brief start polling the meters of the devices
+     *
+     * The devices should not be deleted before stop() returns.
+     * @param devices the devices to poll, those without meters are skipped
+     * @param rate_hz the number of updates per second
+     */
+    bool start( const DeviceVector& devices, unsigned int rate_hz );
+    void stop();
+    bool isRunning() {return m_thread != NULL;};
+
+    // the RunnableInterface
+    virtual bool Init();
+    virtual bool Execute();
+
+    void setVerboseLevel( int l );
+    void show();
+
+private:
+    bool createSegment();
+    void publishLayout();
+
+    struct PolledDevice {
+        FFADODevice*            device;
+        struct meterservice_device* shm;
+        // readMeters() fills all of them, the first nb_published are
+        // published
+        std::vector< float >    values;
+        unsigned int            nb_published;
+    };
+
+    Util::PosixSharedMemory*    m_segment;
+    struct meterservice_segment* m_shm;
+    Util::Thread*               m_thread;
+    std::vector< PolledDevice > m_devices;
+    unsigned int                m_rate_hz;
+    ffado_microsecs_t           m_next_update;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+/**
+ * @brief Reads the meters published by a MeterService
+ *
+ * Can be used from any process.
+ */
+class MeterReader
+{
+public:
+    MeterReader();
+    ~MeterReader();
+
+    /**
+     * @brief map the segment
+     * @return false if there is no meter service
+     */
+    bool open();
+    void close();
+
+    unsigned int getNbDevices();
+    uint64_t getDeviceGuid( unsigned int dev );
+    unsigned int getNbMeters( unsigned int dev );
+    std::string getMeterName( unsigned int dev, unsigned int meter );
+    /**
+     * @brief copy a consistent snapshot of the meter values of a device
+     * @param values receives up to max_values values
+     * @param timestamp_usecs receives the time of the update (optional)
+     * @return the number of values copied
+     */
+    unsigned int readValues( unsigned int dev, float *values, unsigned int max_values,
+                             uint64_t *timestamp_usecs = NULL );
+
+private:
+    Util::PosixSharedMemory*    m_segment;
+    const struct meterservice_segment* m_shm;
+
+    DECLARE_DEBUG_MODULE;
+};
+
+#endif
@@ -953,21 +953,32 @@ Device::set_hardware_ampgain(unsigned int index, signed int val) {
 signed int
 Device::set_hardware_mixergain(unsigned int ctype, unsigned int src_channel, 
   unsigned int dest_channel, signed int val) {
-// Set the value of a matrix mixer control.  ctype is one of the RME_FF_MM_*
-// defines:
+    return set_hardware_mixergains(ctype, src_channel, dest_channel, 1, &val);
+}
+
+signed int
+Device::set_hardware_mixergains(unsigned int ctype, unsigned int src_channel,
+  unsigned int dest_channel, unsigned int n_vals, const signed int *vals) {
+// Set the values of n_vals matrix mixer controls, starting at src_channel.
+// ctype is one of the RME_FF_MM_* defines:
 //   RME_FF_MM_INPUT: source is a physical input
 //   RME_FF_MM_PLAYBACK: source is playback from PC
 //   RME_FF_MM_OUTPUT: source is the physical output whose gain is to be 
 //     changed, destination is ignored
-// Val is the integer value sent to the device.  The amount of gain (in dB)
-// applied can be calculated using
+// The values are the integers sent to the device.  The amount of gain (in
+// dB) applied can be calculated using
 //   dB = 20.log10(val/32768)
 // The maximum value of val is 0x10000, corresponding to +6dB of gain.
 // The minimum is 0x00000 corresponding to mute.
+//
+// The controls of consecutive sources are adjacent in the mixer RAM, so
+// they are sent to the device in a single block write.
 
     unsigned int n_channels;
     signed int ram_output_block_size;
     unsigned int ram_addr;
+    quadlet_t buf[RME_FF800_MAX_CHANNELS];
+    unsigned int i;
 
     if (m_rme_model == RME_MODEL_FIREFACE400) {
         n_channels = RME_FF400_MAX_CHANNELS;
@@ -981,10 +992,13 @@ Device::set_hardware_mixergain(unsigned int ctype, unsigned int src_channel,
         return -1;
     }
 
-    if (src_channel>n_channels || dest_channel>n_channels)
-        return -1;
-    if (abs(val)>0x10000)
+    if (n_vals==0 || src_channel+n_vals>n_channels || dest_channel>n_channels)
         return -1;
+    for (i=0; i<n_vals; i++) {
+        if (abs(vals[i])>0x10000)
+            return -1;
+        buf[i] = vals[i];
+    }
 
     ram_addr = RME_FF_MIXER_RAM;
     switch (ctype) {
@@ -1003,21 +1017,27 @@ Device::set_hardware_mixergain(unsigned int ctype, unsigned int src_channel,
             break;
     }
 
-    if (writeRegister(ram_addr, val) != 0) {
-        debugOutput(DEBUG_LEVEL_ERROR, "failed to write mixer gain element\n");
+    if (n_vals == 1) {
+        if (writeRegister(ram_addr, buf[0]) != 0) {
+            debugOutput(DEBUG_LEVEL_ERROR, "failed to write mixer gain element\n");
+        }
+    } else
+    if (writeBlock(ram_addr, buf, n_vals) != 0) {
+        debugOutput(DEBUG_LEVEL_ERROR, "failed to write %d mixer gain elements\n", n_vals);
     }
 
     // If setting the output volume and the device is the FF400, keep
     // the separate gain register in sync.
     if (ctype==RME_FF_MM_OUTPUT && m_rme_model==RME_MODEL_FIREFACE400) {
-        signed int dB;
-        if (val < 0)
-          val = -val;
-        if (val==0)
-            dB = -90;
-        else
-            dB = roundl(20.0*log10(val/32768.0));
-        set_hardware_ampgain(FF400_AMPGAIN_OUTPUT1+src_channel, dB);
+        for (i=0; i<n_vals; i++) {
+            signed int dB;
+            signed int val = abs(vals[i]);
+            if (val==0)
+                dB = -90;
+            else
+                dB = roundl(20.0*log10(val/32768.0));
+            set_hardware_ampgain(FF400_AMPGAIN_OUTPUT1+src_channel+i, dB);
+        }
     }
 
     return 0;
@@ -625,6 +625,47 @@ double RmeSettingsMatrixCtrl::setValue(const int row, const int col, const doubl
     return ret;
 }
 
+bool RmeSettingsMatrixCtrl::setValues(const int row, const int col,
+    const int nb_rows, const int nb_cols, const std::vector<double> &values)
+{
+    unsigned int ctype;
+
+    switch (m_type) {
+        case RME_MATRIXCTRL_INPUT_FADER:
+            ctype = RME_FF_MM_INPUT;
+            break;
+        case RME_MATRIXCTRL_PLAYBACK_FADER:
+            ctype = RME_FF_MM_PLAYBACK;
+            break;
+        case RME_MATRIXCTRL_OUTPUT_FADER:
+            ctype = RME_FF_MM_OUTPUT;
+            break;
+        default:
+            return Control::MatrixMixer::setValues(row, col, nb_rows, nb_cols, values);
+    }
+
+    if (row < 0 || col < 0 || nb_rows < 0 || nb_cols < 0 ||
+        col+nb_cols > RME_FF800_MAX_CHANNELS ||
+        values.size() != (size_t)(nb_rows*nb_cols)) {
+        debugOutput(DEBUG_LEVEL_ERROR, "invalid block of %d x %d faders at (%d, %d)\n",
+            nb_rows, nb_cols, row, col);
+        return false;
+    }
+
+    // The columns are the sources, which are adjacent in the mixer RAM.
+    // See setValue() for the scaling.
+    bool ret = true;
+    signed int vals[RME_FF800_MAX_CHANNELS];
+    for (int r=0; r<nb_rows; r++) {
+        for (int c=0; c<nb_cols; c++) {
+            vals[c] = values.at(r*nb_cols+c)*2;
+        }
+        if (m_parent.setMixerGains(ctype, col, row+r, nb_cols, vals) != 0)
+            ret = false;
+    }
+    return ret;
+}
+
 double RmeSettingsMatrixCtrl::getValue(const int row, const int col) 
 {
     double val = 0.0;
@@ -126,6 +126,11 @@ public:
     virtual double setValue(const int row, const int col, const double val);
     virtual double getValue(const int row, const int col);
 
+    // the faders of a row are written to the device in one go
+    virtual bool setValues(const int row, const int col,
+        const int nb_rows, const int nb_cols, const std::vector<double> &values);
+    using Control::MatrixMixer::setValues;
+
     // functions to access the entire coefficient map at once
     virtual bool getCoefficientMap(int &) {return false;};
     virtual bool storeCoefficientMap(int &) {return false;};
@@ -138,6 +138,9 @@ public:
         unsigned int src_channel, unsigned int dest_channel);
     signed int setMixerGain(unsigned int ctype, 
         unsigned int src_channel, unsigned int dest_channel, signed int val);
+    signed int setMixerGains(unsigned int ctype,
+        unsigned int src_channel, unsigned int dest_channel,
+        unsigned int n_vals, const signed int *vals);
     signed int getMixerFlags(unsigned int ctype,
         unsigned int src_channel, unsigned int dest_channel, unsigned int flagmask);
     signed int setMixerFlags(unsigned int ctype,
@@ -224,6 +227,9 @@ private:
     signed int set_hardware_ampgain(unsigned int index, signed int val);
     signed int set_hardware_mixergain(unsigned int ctype, 
         unsigned int src_channel, unsigned int dest_channel, signed int val);
+    signed int set_hardware_mixergains(unsigned int ctype,
+        unsigned int src_channel, unsigned int dest_channel,
+        unsigned int n_vals, const signed int *vals);
 
     signed int set_hardware_channel_mute(signed int chan, signed int mute);
     signed int set_hardware_output_rec(signed int rec);
@@ -347,48 +347,68 @@ Device::getMixerGain(unsigned int ctype,
 signed int
 Device::setMixerGain(unsigned int ctype, 
     unsigned int src_channel, unsigned int dest_channel, signed int val) {
+    return setMixerGains(ctype, src_channel, dest_channel, 1, &val);
+}
 
-    unsigned char *mixerflags = NULL;
-    signed int idx = getMixerGainIndex(src_channel, dest_channel);
+signed int
+Device::setMixerGains(unsigned int ctype,
+    unsigned int src_channel, unsigned int dest_channel,
+    unsigned int n_vals, const signed int *vals) {
 
-    switch (ctype) {
-        case RME_FF_MM_INPUT:
-            settings->input_faders[idx] = val;
-            mixerflags = settings->input_mixerflags;
-            break;
-        case RME_FF_MM_PLAYBACK:
-            settings->playback_faders[idx] = val;
-            mixerflags = settings->playback_mixerflags;
-            break;
-        case RME_FF_MM_OUTPUT:
-            settings->output_faders[src_channel] = val;
-            mixerflags = settings->output_mixerflags;
-            break;
-    }
+// Set the gains of n_vals consecutive sources of a destination.  The
+// hardware values are written to the device in one go.
 
-    // If the matrix channel is muted, override the fader value and 
-    // set it to zero.  Note that this is different to the hardware
-    // mute control dealt with by set_hardware_channel_mute(); the
-    // latter deals with a muting separate from the mixer.
-    if (mixerflags!=NULL && (mixerflags[idx] & FF_SWPARAM_MF_MUTED)!=0) {
-        val = 0;
-    }
+    unsigned char *mixerflags = NULL;
+    signed int hw_vals[RME_FF800_MAX_CHANNELS];
+    unsigned int i;
+
+    if (src_channel+n_vals > RME_FF800_MAX_CHANNELS)
+        return -1;
 
-    // Phase inversion is effected by sending a negative volume to the
-    // hardware.  However, when transitioning from 0 (-inf dB) to -1 (-90
-    // dB), the hardware seems to first send the volume up to a much higher
-    // level before it drops down to the set point after about a tenth of a
-    // second (this also seems to be the case when switching between
-    // inversion modes).  To work around this for the moment (at least until
-    // it's understood, silently map a value of 0 to -1 when phase inversion
-    // is active.
-    if (mixerflags!=NULL && (mixerflags[idx] & FF_SWPARAM_MF_INVERTED)!=0) {
-        if (val == 0)
-            val = 1;
-        val = -val;
+    for (i=0; i<n_vals; i++) {
+        signed int val = vals[i];
+        signed int idx = getMixerGainIndex(src_channel+i, dest_channel);
+
+        switch (ctype) {
+            case RME_FF_MM_INPUT:
+                settings->input_faders[idx] = val;
+                mixerflags = settings->input_mixerflags;
+                break;
+            case RME_FF_MM_PLAYBACK:
+                settings->playback_faders[idx] = val;
+                mixerflags = settings->playback_mixerflags;
+                break;
+            case RME_FF_MM_OUTPUT:
+                settings->output_faders[src_channel+i] = val;
+                mixerflags = settings->output_mixerflags;
+                break;
+        }
+
+        // If the matrix channel is muted, override the fader value and 
+        // set it to zero.  Note that this is different to the hardware
+        // mute control dealt with by set_hardware_channel_mute(); the
+        // latter deals with a muting separate from the mixer.
+        if (mixerflags!=NULL && (mixerflags[idx] & FF_SWPARAM_MF_MUTED)!=0) {
+            val = 0;
+        }
+
+        // Phase inversion is effected by sending a negative volume to the
+        // hardware.  However, when transitioning from 0 (-inf dB) to -1 (-90
+        // dB), the hardware seems to first send the volume up to a much higher
+        // level before it drops down to the set point after about a tenth of a
+        // second (this also seems to be the case when switching between
+        // inversion modes).  To work around this for the moment (at least until
+        // it's understood, silently map a value of 0 to -1 when phase inversion
+        // is active.
+        if (mixerflags!=NULL && (mixerflags[idx] & FF_SWPARAM_MF_INVERTED)!=0) {
+            if (val == 0)
+                val = 1;
+            val = -val;
+        }
+        hw_vals[i] = val;
     }
 
-    return set_hardware_mixergain(ctype, src_channel, dest_channel, val);
+    return set_hardware_mixergains(ctype, src_channel, dest_channel, n_vals, hw_vals);
 }
 
 signed int
@@ -21,11 +21,14 @@
  *
  */
 
+#include "config.h"
+
 #include "controlserver.h"
 #include "libcontrol/Element.h"
 #include "libcontrol/BasicElements.h"
 #include "libcontrol/MatrixMixer.h"
 #include "libcontrol/CrossbarRouter.h"
+#include "libcontrol/ValueCache.h"
 #include "libutil/Time.h"
 #include "libutil/PosixMutex.h"
 
@@ -33,11 +36,29 @@ namespace DBusControl {
 
 IMPL_DEBUG_MODULE( Element, Element, DEBUG_LEVEL_NORMAL );
 
+/*!
+ @brief Holds the access lock of the value caches while a slave is accessed
+
+ Nothing is locked if the values aren't cached.
+ */
+class SlaveAccessLock
+{
+public:
+    SlaveAccessLock( Util::Mutex *m )
+    : m_mutex( m )
+        { if ( m_mutex ) m_mutex->Lock(); };
+    ~SlaveAccessLock()
+        { if ( m_mutex ) m_mutex->Unlock(); };
+private:
+    Util::Mutex *m_mutex;
+};
+
 // --- Element
 Element::Element( DBus::Connection& connection, std::string p, Element* parent, Control::Element &slave)
 : DBus::ObjectAdaptor(connection, p)
 , m_Parent(parent)
 , m_Slave(slave)
+, m_CacheFlusher( NULL )
 , m_UpdateLock( NULL )
 {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Created Element on '%s'\n",
@@ -110,6 +131,78 @@ Element::getLock()
     }
 }
 
+Control::ValueCacheFlusher*
+Element::getValueCacheFlusher()
+{
+    if(m_Parent) {
+        return m_Parent->getValueCacheFlusher();
+    } else {
+        return m_CacheFlusher;
+    }
+}
+
+Util::Mutex*
+Element::getAccessLock()
+{
+    Control::ValueCacheFlusher *flusher = getValueCacheFlusher();
+    if(flusher) {
+        return &flusher->getAccessLock();
+    } else {
+        return NULL;
+    }
+}
+
+bool
+Element::isValidIndexRange( int64_t first, int64_t count )
+{
+    // a negative index would end up as the key of the value without index
+    if ( first < 0 || count < 0 || first + count > (int64_t)0x7FFFFFFF + 1 ) {
+        debugWarning( "Invalid index range: %"PRId64" values at %"PRId64"\n", count, first );
+        return false;
+    }
+    return true;
+}
+
+bool
+Element::isValidValueCount( int64_t count )
+{
+    if ( count < 0 || count > CONTROL_MAX_VALUES_PER_CALL ) {
+        debugWarning( "Invalid value count: %"PRId64"\n", count );
+        return false;
+    }
+    return true;
+}
+
+bool
+Element::isValidIndexes( const std::vector< int32_t > &idx )
+{
+    for ( unsigned int i = 0; i < idx.size(); i++ ) {
+        if ( idx.at(i) < 0 ) {
+            debugWarning( "Invalid index: %d\n", idx.at(i) );
+            return false;
+        }
+    }
+    return true;
+}
+
+double
+Element::getCachedValue( Control::ValueCache &cache, uint64_t key )
+{
+    double val;
+    if ( !cache.get( key, val ) ) {
+        throw DBus::ErrorFailed( "Could not read the value" );
+    }
+    return val;
+}
+
+void
+Element::setCachedValue( Control::ValueCache &cache, uint64_t key, double value )
+{
+    if ( !cache.set( key, value ) ) {
+        throw DBus::ErrorFailed( "Could not set the value" );
+    }
+}
+
 uint64_t
 Element::getId( )
 {
@@ -135,13 +228,17 @@ Element::getDescription( )
 }
 
 // --- Container
-Container::Container( DBus::Connection& connection, std::string p, Element* parent, Control::Container &slave)
+Container::Container( DBus::Connection& connection, std::string p, Element* parent,
+                      Control::Container &slave, Control::ValueCacheFlusher *flusher)
 : Element(connection, p, parent, slave)
 , m_Slave(slave)
 {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Created Container on '%s'\n",
                  path().c_str() );
 
+    // the children pick this up from the root
+    m_CacheFlusher = flusher;
+
     setDebugLevel(slave.getVerboseLevel());
 
     // register an update signal handler
@@ -451,19 +548,125 @@ Container::createHandler(Element *parent, Control::Element& e) {
     };
 }
 
+// --- value caches
+
+// the cache key of the value without index
+#define CONTROLSERVER_CACHE_KEY_NO_INDEX    0xFFFFFFFFFFFFFFFFULL
+
+/*!
+ @brief Cache for the values of a Continuous or a Discrete element
+
+ The key is the index of the value.
+ */
+template< typename ElementType, typename ValueType >
+class IndexedValueCache
+: public Control::ValueCache
+{
+public:
+    IndexedValueCache( Control::ValueCacheFlusher &flusher, ElementType &slave )
+    : Control::ValueCache( flusher, slave )
+    , m_Slave( slave )
+    {}
+
+protected:
+    bool readValue( uint64_t key, double &value )
+    {
+        if ( key == CONTROLSERVER_CACHE_KEY_NO_INDEX ) {
+            value = m_Slave.getValue();
+        } else {
+            value = m_Slave.getValue( (int)key );
+        }
+        return true;
+    }
+    bool writeValues( const std::vector<uint64_t> &keys,
+                      const std::vector<double> &values )
+    {
+        bool retval = true;
+        std::vector< int > idx;
+        std::vector< ValueType > vals;
+        for ( unsigned int i = 0; i < keys.size(); i++ ) {
+            if ( keys.at(i) == CONTROLSERVER_CACHE_KEY_NO_INDEX ) {
+                retval &= m_Slave.setValue( (ValueType)values.at(i) );
+            } else {
+                idx.push_back( (int)keys.at(i) );
+                vals.push_back( (ValueType)values.at(i) );
+            }
+        }
+        if ( !idx.empty() ) {
+            retval &= m_Slave.setValues( idx, vals );
+        }
+        return retval;
+    }
+
+private:
+    ElementType &m_Slave;
+};
+
+/*!
+ @brief Cache for the coefficients of a MatrixMixer element
+
+ The key is the row in the high and the column in the low 32 bits.
+ */
+class MatrixMixerValueCache
+: public Control::ValueCache
+{
+public:
+    MatrixMixerValueCache( Control::ValueCacheFlusher &flusher, Control::MatrixMixer &slave )
+    : Control::ValueCache( flusher, slave )
+    , m_Slave( slave )
+    {}
+
+    static uint64_t makeKey( int row, int col )
+        { return ((uint64_t)(uint32_t)row << 32) | (uint32_t)col; }
+
+protected:
+    bool readValue( uint64_t key, double &value )
+    {
+        value = m_Slave.getValue( (int)(key >> 32), (int)(key & 0xFFFFFFFF) );
+        return true;
+    }
+    bool writeValues( const std::vector<uint64_t> &keys,
+                      const std::vector<double> &values )
+    {
+        std::vector< int > rows, cols;
+        for ( unsigned int i = 0; i < keys.size(); i++ ) {
+            rows.push_back( (int)(keys.at(i) >> 32) );
+            cols.push_back( (int)(keys.at(i) & 0xFFFFFFFF) );
+        }
+        return m_Slave.setValues( rows, cols, values );
+    }
+
+private:
+    Control::MatrixMixer &m_Slave;
+};
+
 // --- Continuous
 
 Continuous::Continuous( DBus::Connection& connection, std::string p, Element* parent, Control::Continuous &slave)
 : Element(connection, p, parent, slave)
 , m_Slave(slave)
+, m_Cache(NULL)
 {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Created Continuous on '%s'\n",
                  path().c_str() );
+    if ( getValueCacheFlusher() ) {
+        m_Cache = new IndexedValueCache< Control::Continuous, double >
+                        ( *getValueCacheFlusher(), slave );
+    }
+}
+
+Continuous::~Continuous()
+{
+    delete m_Cache;
 }
 
 double
 Continuous::setValue( const double& value )
 {
+    if ( m_Cache ) {
+        setCachedValue( *m_Cache, CONTROLSERVER_CACHE_KEY_NO_INDEX, value );
+        return value;
+    }
     m_Slave.setValue(value);
 /*    
     SleepRelativeUsec(1000*500);
@@ -477,7 +680,12 @@ Continuous::setValue( const double& value )
 double
 Continuous::getValue(  )
 {
-    double val = m_Slave.getValue();
+    double val;
+    if ( m_Cache ) {
+        val = getCachedValue( *m_Cache, CONTROLSERVER_CACHE_KEY_NO_INDEX );
+    } else {
+        val = m_Slave.getValue();
+    }
     debugOutput( DEBUG_LEVEL_VERBOSE, "getValue() => %lf\n", val );
     return val;
 }
@@ -485,6 +693,13 @@ Continuous::getValue(  )
 double
 Continuous::setValueIdx( const int32_t & idx, const double& value )
 {
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( idx, 1 ) ) {
+            throw DBus::ErrorInvalidArgs( "Invalid index" );
+        }
+        setCachedValue( *m_Cache, idx, value );
+        return value;
+    }
     m_Slave.setValue(idx, value);
 /*    
     SleepRelativeUsec(1000*500);
@@ -498,11 +713,96 @@ Continuous::setValueIdx( const int32_t & idx, const double& value )
 double
 Continuous::getValueIdx( const int32_t & idx )
 {
-    double val = m_Slave.getValue(idx);
+    double val;
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( idx, 1 ) ) {
+            throw DBus::ErrorInvalidArgs( "Invalid index" );
+        }
+        val = getCachedValue( *m_Cache, idx );
+    } else {
+        val = m_Slave.getValue(idx);
+    }
     debugOutput( DEBUG_LEVEL_VERBOSE, "getValue(%d) => %lf\n", idx, val );
     return val;
 }
 
+bool
+Continuous::setValues( const int32_t & first, const std::vector< double > & values )
+{
+    debugOutput( DEBUG_LEVEL_VERBOSE, "setValues(%d, %zd values)\n", first, values.size() );
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( first, values.size() ) ) {
+            return false;
+        }
+        for ( unsigned int i = 0; i < values.size(); i++ ) {
+            if ( !m_Cache->set( first + i, values.at(i) ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return m_Slave.setValues(first, values);
+}
+
+std::vector< double >
+Continuous::getValues( const int32_t & first, const int32_t & count )
+{
+    std::vector< double > values;
+    if ( !isValidValueCount( count ) ) {
+        throw DBus::ErrorInvalidArgs( "Invalid value count" );
+    }
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( first, count ) ) {
+            return values;
+        }
+        values.resize( count );
+        for ( int32_t i = 0; i < count; i++ ) {
+            values[i] = getCachedValue( *m_Cache, first + i );
+        }
+    } else if ( !m_Slave.getValues(first, count, values) ) {
+        throw DBus::ErrorFailed( "Could not read the values" );
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "getValues(%d, %d)\n", first, count );
+    return values;
+}
+
+bool
+Continuous::setValuesSparse( const std::vector< int32_t > & idx, const std::vector< double > & values )
+{
+    debugOutput( DEBUG_LEVEL_VERBOSE, "setValuesSparse(%zd values)\n", values.size() );
+    if ( m_Cache ) {
+        if ( idx.size() != values.size() || !isValidIndexes( idx ) ) {
+            return false;
+        }
+        for ( unsigned int i = 0; i < values.size(); i++ ) {
+            if ( !m_Cache->set( idx.at(i), values.at(i) ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return m_Slave.setValues(idx, values);
+}
+
+std::vector< double >
+Continuous::getValuesSparse( const std::vector< int32_t > & idx )
+{
+    std::vector< double > values;
+    if ( m_Cache ) {
+        if ( !isValidIndexes( idx ) ) {
+            return values;
+        }
+        values.resize( idx.size() );
+        for ( unsigned int i = 0; i < idx.size(); i++ ) {
+            values[i] = getCachedValue( *m_Cache, idx.at(i) );
+        }
+    } else {
+        m_Slave.getValues(idx, values);
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "getValuesSparse(%zd values)\n", idx.size() );
+    return values;
+}
+
 double
 Continuous::getMinimum()
 {
@@ -524,14 +824,28 @@ Continuous::getMaximum()
 Discrete::Discrete( DBus::Connection& connection, std::string p, Element* parent, Control::Discrete &slave)
 : Element(connection, p, parent, slave)
 , m_Slave(slave)
+, m_Cache(NULL)
 {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Created Discrete on '%s'\n",
                  path().c_str() );
+    if ( getValueCacheFlusher() ) {
+        m_Cache = new IndexedValueCache< Control::Discrete, int >
+                        ( *getValueCacheFlusher(), slave );
+    }
+}
+
+Discrete::~Discrete()
+{
+    delete m_Cache;
 }
 
 int32_t
 Discrete::setValue( const int32_t& value )
 {
+    if ( m_Cache ) {
+        setCachedValue( *m_Cache, CONTROLSERVER_CACHE_KEY_NO_INDEX, value );
+        return value;
+    }
     m_Slave.setValue(value);
     
 /*    SleepRelativeUsec(1000*500);
@@ -544,7 +858,12 @@ Discrete::setValue( const int32_t& value )
 int32_t
 Discrete::getValue()
 {
-    int32_t val = m_Slave.getValue();
+    int32_t val;
+    if ( m_Cache ) {
+        val = (int32_t)getCachedValue( *m_Cache, CONTROLSERVER_CACHE_KEY_NO_INDEX );
+    } else {
+        val = m_Slave.getValue();
+    }
     debugOutput( DEBUG_LEVEL_VERBOSE, "getValue() => %d\n", val );
     return val;
 }
@@ -552,6 +871,13 @@ Discrete::getValue()
 int32_t
 Discrete::setValueIdx( const int32_t& idx, const int32_t& value )
 {
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( idx, 1 ) ) {
+            throw DBus::ErrorInvalidArgs( "Invalid index" );
+        }
+        setCachedValue( *m_Cache, idx, value );
+        return value;
+    }
     m_Slave.setValue(idx, value);
     
 /*    SleepRelativeUsec(1000*500);
@@ -564,11 +890,94 @@ Discrete::setValueIdx( const int32_t& idx, const int32_t& value )
 int32_t
 Discrete::getValueIdx( const int32_t& idx )
 {
-    int32_t val = m_Slave.getValue(idx);
+    int32_t val;
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( idx, 1 ) ) {
+            throw DBus::ErrorInvalidArgs( "Invalid index" );
+        }
+        val = (int32_t)getCachedValue( *m_Cache, idx );
+    } else {
+        val = m_Slave.getValue(idx);
+    }
     debugOutput( DEBUG_LEVEL_VERBOSE, "getValue(%d) => %d\n", idx, val );
     return val;
 }
 
+bool
+Discrete::setValues( const int32_t & first, const std::vector< int32_t > & values )
+{
+    debugOutput( DEBUG_LEVEL_VERBOSE, "setValues(%d, %zd values)\n", first, values.size() );
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( first, values.size() ) ) {
+            return false;
+        }
+        for ( unsigned int i = 0; i < values.size(); i++ ) {
+            if ( !m_Cache->set( first + i, values.at(i) ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return m_Slave.setValues(first, values);
+}
+
+std::vector< int32_t >
+Discrete::getValues( const int32_t & first, const int32_t & count )
+{
+    std::vector< int32_t > values;
+    if ( !isValidValueCount( count ) ) {
+        throw DBus::ErrorInvalidArgs( "Invalid value count" );
+    }
+    if ( m_Cache ) {
+        if ( !isValidIndexRange( first, count ) ) {
+            return values;
+        }
+        for ( int32_t i = 0; i < count; i++ ) {
+            values.push_back( (int32_t)getCachedValue( *m_Cache, first + i ) );
+        }
+    } else if ( !m_Slave.getValues(first, count, values) ) {
+        throw DBus::ErrorFailed( "Could not read the values" );
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "getValues(%d, %d)\n", first, count );
+    return values;
+}
+
+bool
+Discrete::setValuesSparse( const std::vector< int32_t > & idx, const std::vector< int32_t > & values )
+{
+    debugOutput( DEBUG_LEVEL_VERBOSE, "setValuesSparse(%zd values)\n", values.size() );
+    if ( m_Cache ) {
+        if ( idx.size() != values.size() || !isValidIndexes( idx ) ) {
+            return false;
+        }
+        for ( unsigned int i = 0; i < values.size(); i++ ) {
+            if ( !m_Cache->set( idx.at(i), values.at(i) ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return m_Slave.setValues(idx, values);
+}
+
+std::vector< int32_t >
+Discrete::getValuesSparse( const std::vector< int32_t > & idx )
+{
+    std::vector< int32_t > values;
+    if ( m_Cache ) {
+        if ( !isValidIndexes( idx ) ) {
+            return values;
+        }
+        for ( unsigned int i = 0; i < idx.size(); i++ ) {
+            values.push_back( (int32_t)getCachedValue( *m_Cache, idx.at(i) ) );
+        }
+    } else {
+        m_Slave.getValues(idx, values);
+    }
+    debugOutput( DEBUG_LEVEL_VERBOSE, "getValuesSparse(%zd values)\n", idx.size() );
+    return values;
+}
+
 // --- Text
 
 Text::Text( DBus::Connection& connection, std::string p, Element* parent, Control::Text &slave)
@@ -582,6 +991,7 @@ Text::Text( DBus::Connection& connection, std::string p, Element* parent, Contro
 std::string
 Text::setValue( const std::string& value )
 {
+    SlaveAccessLock access( getAccessLock() );
     m_Slave.setValue(value);
     
 /*    SleepRelativeUsec(1000*500);
@@ -594,6 +1004,7 @@ Text::setValue( const std::string& value )
 std::string
 Text::getValue()
 {
+    SlaveAccessLock access( getAccessLock() );
     std::string val = m_Slave.getValue();
     debugOutput( DEBUG_LEVEL_VERBOSE, "getValue() => %s\n", val.c_str() );
     return val;
@@ -612,6 +1023,7 @@ Register::Register( DBus::Connection& connection, std::string p, Element* parent
 uint64_t
 Register::setValue( const uint64_t& addr, const uint64_t& value )
 {
+    SlaveAccessLock access( getAccessLock() );
     m_Slave.setValue(addr, value);
     
 /*    SleepRelativeUsec(1000*500);
@@ -624,6 +1036,7 @@ Register::setValue( const uint64_t& addr, const uint64_t& value )
 uint64_t
 Register::getValue( const uint64_t& addr )
 {
+    SlaveAccessLock access( getAccessLock() );
     uint64_t val = m_Slave.getValue(addr);
     debugOutput( DEBUG_LEVEL_VERBOSE, "getValue(%"PRId64") => %"PRId64"\n", addr, val );
     return val;
@@ -642,6 +1055,7 @@ Enum::Enum( DBus::Connection& connection, std::string p, Element* parent, Contro
 int32_t
 Enum::select( const int32_t& idx )
 {
+    SlaveAccessLock access( getAccessLock() );
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "select(%d)\n", idx );
     return  m_Slave.select(idx);
 }
@@ -649,6 +1063,7 @@ Enum::select( const int32_t& idx )
 int32_t
 Enum::selected()
 {
+    SlaveAccessLock access( getAccessLock() );
     int retval = m_Slave.selected();
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "selected() => %d\n", retval );
     return retval;
@@ -657,6 +1072,7 @@ Enum::selected()
 int32_t
 Enum::count()
 {
+    SlaveAccessLock access( getAccessLock() );
     int retval = m_Slave.count();
     debugOutput( DEBUG_LEVEL_VERBOSE, "count() => %d\n", retval );
     return retval;
@@ -665,6 +1081,7 @@ Enum::count()
 std::string
 Enum::getEnumLabel( const int32_t & idx )
 {
+    SlaveAccessLock access( getAccessLock() );
     std::string retval = m_Slave.getEnumLabel(idx);
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "getEnumLabel(%d) => %s\n", idx, retval.c_str() );
     return retval;
@@ -673,6 +1090,7 @@ Enum::getEnumLabel( const int32_t & idx )
 bool
 Enum::devConfigChanged(const int32_t& idx)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.devConfigChanged( idx );
 }
 
@@ -688,6 +1106,7 @@ AttributeEnum::AttributeEnum( DBus::Connection& connection, std::string p, Eleme
 int32_t
 AttributeEnum::select( const int32_t& idx )
 {
+    SlaveAccessLock access( getAccessLock() );
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "select(%d)\n", idx );
     return  m_Slave.select(idx);
 }
@@ -695,6 +1114,7 @@ AttributeEnum::select( const int32_t& idx )
 int32_t
 AttributeEnum::selected()
 {
+    SlaveAccessLock access( getAccessLock() );
     int retval = m_Slave.selected();
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "selected() => %d\n", retval );
     return retval;
@@ -703,6 +1123,7 @@ AttributeEnum::selected()
 int32_t
 AttributeEnum::count()
 {
+    SlaveAccessLock access( getAccessLock() );
     int retval = m_Slave.count();
     debugOutput( DEBUG_LEVEL_VERBOSE, "count() => %d\n", retval );
     return retval;
@@ -711,6 +1132,7 @@ AttributeEnum::count()
 int32_t
 AttributeEnum::attributeCount()
 {
+    SlaveAccessLock access( getAccessLock() );
     int retval = m_Slave.attributeCount();
     debugOutput( DEBUG_LEVEL_VERBOSE, "attributeCount() => %d\n", retval );
     return retval;
@@ -719,6 +1141,7 @@ AttributeEnum::attributeCount()
 std::string
 AttributeEnum::getEnumLabel( const int32_t & idx )
 {
+    SlaveAccessLock access( getAccessLock() );
     std::string retval = m_Slave.getEnumLabel(idx);
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "getEnumLabel(%d) => %s\n", idx, retval.c_str() );
     return retval;
@@ -727,6 +1150,7 @@ AttributeEnum::getEnumLabel( const int32_t & idx )
 std::string
 AttributeEnum::getAttributeValue( const int32_t & idx )
 {
+    SlaveAccessLock access( getAccessLock() );
     std::string retval = m_Slave.getAttributeValue(idx);
     debugOutput( DEBUG_LEVEL_VERBOSE, "getAttributeValue(%d) => %s\n", idx, retval.c_str() );
     return retval;
@@ -735,6 +1159,7 @@ AttributeEnum::getAttributeValue( const int32_t & idx )
 std::string
 AttributeEnum::getAttributeName( const int32_t & idx )
 {
+    SlaveAccessLock access( getAccessLock() );
     std::string retval = m_Slave.getAttributeName(idx);
     debugOutput( DEBUG_LEVEL_VERBOSE, "getAttributeName(%d) => %s\n", idx, retval.c_str() );
     return retval;
@@ -791,75 +1216,219 @@ ConfigRomX::getUnitVersion( )
 MatrixMixer::MatrixMixer( DBus::Connection& connection, std::string p, Element* parent, Control::MatrixMixer &slave)
 : Element(connection, p, parent, slave)
 , m_Slave(slave)
+, m_Cache(NULL)
 {
     debugOutput( DEBUG_LEVEL_VERBOSE, "Created MatrixMixer on '%s'\n",
                  path().c_str() );
+    if ( getValueCacheFlusher() ) {
+        m_Cache = new MatrixMixerValueCache( *getValueCacheFlusher(), slave );
+    }
+}
+
+MatrixMixer::~MatrixMixer()
+{
+    delete m_Cache;
 }
 
 int32_t
 MatrixMixer::getRowCount( ) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getRowCount();
 }
 
 int32_t
 MatrixMixer::getColCount( ) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getColCount();
 }
 
 int32_t
 MatrixMixer::canWrite( const int32_t& row, const int32_t& col) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.canWrite(row,col);
 }
 
 double
 MatrixMixer::setValue( const int32_t& row, const int32_t& col, const double& val ) {
+    if ( m_Cache ) {
+        if ( !isValidBlock( row, col, 1, 1 ) ) {
+            throw DBus::ErrorInvalidArgs( "Invalid row or column" );
+        }
+        setCachedValue( *m_Cache, MatrixMixerValueCache::makeKey(row, col), val );
+        return val;
+    }
     return m_Slave.setValue(row,col,val);
 }
 
 double
 MatrixMixer::getValue( const int32_t& row, const int32_t& col) {
+    if ( m_Cache ) {
+        if ( !isValidBlock( row, col, 1, 1 ) ) {
+            throw DBus::ErrorInvalidArgs( "Invalid row or column" );
+        }
+        return getCachedValue( *m_Cache, MatrixMixerValueCache::makeKey(row, col) );
+    }
     return m_Slave.getValue(row,col);
 }
 
+bool
+MatrixMixer::isValidBlock( int32_t row, int32_t col, int32_t nb_rows, int32_t nb_cols ) {
+    SlaveAccessLock access( getAccessLock() );
+    // compare against the remaining rows and columns, such that the
+    // sums can't overflow
+    if ( row < 0 || col < 0 || nb_rows < 0 || nb_cols < 0
+         || row > m_Slave.getRowCount() || nb_rows > m_Slave.getRowCount() - row
+         || col > m_Slave.getColCount() || nb_cols > m_Slave.getColCount() - col ) {
+        debugWarning( "Invalid block: %dx%d at (%d, %d) of a %dx%d mixer\n",
+                      nb_rows, nb_cols, row, col,
+                      m_Slave.getRowCount(), m_Slave.getColCount() );
+        return false;
+    }
+    return true;
+}
+
+bool
+MatrixMixer::isValidEntries( const std::vector< int32_t >& rows, const std::vector< int32_t >& cols ) {
+    if ( rows.size() != cols.size() ) {
+        debugWarning( "%zd rows for %zd columns\n", rows.size(), cols.size() );
+        return false;
+    }
+    for ( unsigned int i = 0; i < rows.size(); i++ ) {
+        if ( !isValidBlock( rows.at(i), cols.at(i), 1, 1 ) ) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool
+MatrixMixer::setValues( const int32_t& row, const int32_t& col,
+                        const int32_t& nb_rows, const int32_t& nb_cols,
+                        const std::vector< double >& values ) {
+    if ( !isValidBlock( row, col, nb_rows, nb_cols ) ) {
+        return false;
+    }
+    if ( m_Cache ) {
+        if ( values.size() != (size_t)(nb_rows * nb_cols) ) {
+            return false;
+        }
+        for ( int32_t r = 0; r < nb_rows; r++ ) {
+            for ( int32_t c = 0; c < nb_cols; c++ ) {
+                if ( !m_Cache->set( MatrixMixerValueCache::makeKey(row + r, col + c),
+                                    values.at(r * nb_cols + c) ) ) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    return m_Slave.setValues(row, col, nb_rows, nb_cols, values);
+}
+
+std::vector< double >
+MatrixMixer::getValues( const int32_t& row, const int32_t& col,
+                        const int32_t& nb_rows, const int32_t& nb_cols ) {
+    std::vector< double > values;
+    if ( !isValidBlock( row, col, nb_rows, nb_cols ) ) {
+        return values;
+    }
+    if ( m_Cache ) {
+        values.resize( nb_rows * nb_cols );
+        for ( int32_t r = 0; r < nb_rows; r++ ) {
+            for ( int32_t c = 0; c < nb_cols; c++ ) {
+                values[r * nb_cols + c] =
+                    getCachedValue( *m_Cache, MatrixMixerValueCache::makeKey(row + r, col + c) );
+            }
+        }
+        return values;
+    }
+    m_Slave.getValues(row, col, nb_rows, nb_cols, values);
+    return values;
+}
+
+bool
+MatrixMixer::setValuesSparse( const std::vector< int32_t >& rows, const std::vector< int32_t >& cols,
+                              const std::vector< double >& values ) {
+    if ( m_Cache ) {
+        if ( rows.size() != values.size() || !isValidEntries( rows, cols ) ) {
+            return false;
+        }
+        for ( unsigned int i = 0; i < values.size(); i++ ) {
+            if ( !m_Cache->set( MatrixMixerValueCache::makeKey(rows.at(i), cols.at(i)), values.at(i) ) ) {
+                return false;
+            }
+        }
+        return true;
+    }
+    return m_Slave.setValues(rows, cols, values);
+}
+
+std::vector< double >
+MatrixMixer::getValuesSparse( const std::vector< int32_t >& rows, const std::vector< int32_t >& cols ) {
+    std::vector< double > values;
+    if ( m_Cache ) {
+        if ( !isValidEntries( rows, cols ) ) {
+            return values;
+        }
+        values.resize( rows.size() );
+        for ( unsigned int i = 0; i < rows.size(); i++ ) {
+            values[i] = getCachedValue( *m_Cache, MatrixMixerValueCache::makeKey(rows.at(i), cols.at(i)) );
+        }
+        return values;
+    }
+    m_Slave.getValues(rows, cols, values);
+    return values;
+}
+
 bool
 MatrixMixer::hasNames() {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.hasNames();
 }
 std::string
 MatrixMixer::getRowName( const int32_t& row) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getRowName(row);
 }
 std::string
 MatrixMixer::getColName( const int32_t& col) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getColName(col);
 }
 bool
 MatrixMixer::setRowName( const int32_t& row, const std::string& name) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.setRowName(row, name);
 }
 bool
 MatrixMixer::setColName( const int32_t& col, const std::string& name) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.setColName(col, name);
 }
 
 bool
 MatrixMixer::canConnect() {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.canConnect();
 }
 std::vector<std::string>
 MatrixMixer::availableConnectionsForRow( const int32_t& row) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.availableConnectionsForRow(row);
 }
 std::vector<std::string>
 MatrixMixer::availableConnectionsForCol( const int32_t& col) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.availableConnectionsForCol(col);
 }
 bool
 MatrixMixer::connectRowTo( const int32_t& row, const std::string& target) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.connectRowTo(row, target);
 }
 bool
 MatrixMixer::connectColTo( const int32_t& col, const std::string& target) {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.connectColTo(col, target);
 }
 
@@ -888,65 +1457,76 @@ CrossbarRouter::getDestinationIndex(const std::string &name)
 std::vector< std::string >
 CrossbarRouter::getSourceNames()
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getSourceNames();
 }
 
 std::vector< std::string >
 CrossbarRouter::getDestinationNames()
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getDestinationNames();
 }
 
 std::vector< std::string >
 CrossbarRouter::getDestinationsForSource(const std::string &idx)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getDestinationsForSource(idx);
 }
 
 std::string
 CrossbarRouter::getSourceForDestination(const std::string &idx)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getSourceForDestination(idx);
 }
 
 bool
 CrossbarRouter::canConnect(const std::string &source, const std::string &dest)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.canConnect(source, dest);
 }
 
 bool
 CrossbarRouter::setConnectionState(const std::string &source, const std::string &dest, const bool &enable)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.setConnectionState(source, dest, enable);
 }
 
 bool
 CrossbarRouter::getConnectionState(const std::string &source, const std::string &dest)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getConnectionState(source, dest);
 }
 
 bool
 CrossbarRouter::clearAllConnections()
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.clearAllConnections();
 }
 
 bool
 CrossbarRouter::hasPeakMetering()
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.hasPeakMetering();
 }
 
 double
 CrossbarRouter::getPeakValue(const std::string &dest)
 {
+    SlaveAccessLock access( getAccessLock() );
     return m_Slave.getPeakValue(dest);
 }
 std::vector< DBus::Struct<std::string, double> >
 CrossbarRouter::getPeakValues()
 {
+    SlaveAccessLock access( getAccessLock() );
     std::map<std::string, double> peakvalues = m_Slave.getPeakValues();
     std::vector< DBus::Struct<std::string, double> > ret;
     for (std::map<std::string, double>::iterator it=peakvalues.begin(); it!=peakvalues.end(); ++it) {
@@ -980,6 +1560,7 @@ Boolean::Boolean( DBus::Connection& connection, std::string p, Element* parent,
 bool
 Boolean::select( const bool& value )
 {
+    SlaveAccessLock access( getAccessLock() );
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "select(%d)\n", value );
     return  m_Slave.select(value);
 }
@@ -987,6 +1568,7 @@ Boolean::select( const bool& value )
 bool
 Boolean::selected()
 {
+    SlaveAccessLock access( getAccessLock() );
     bool retval = m_Slave.selected();
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "selected() => %d\n", retval );
     return retval;
@@ -995,6 +1577,7 @@ Boolean::selected()
 std::string
 Boolean::getBooleanLabel( const bool& value )
 {
+    SlaveAccessLock access( getAccessLock() );
     std::string retval = m_Slave.getBooleanLabel(value);
     debugOutput( DEBUG_LEVEL_VERY_VERBOSE, "getBooleanLabel(%d) => %s\n", value, retval.c_str() );
     return retval;
@@ -37,6 +37,8 @@
 namespace Control {
     class MatrixMixer;
     class CrossbarRouter;
+    class ValueCache;
+    class ValueCacheFlusher;
 };
 
 namespace DBusControl {
@@ -124,9 +126,25 @@ protected:
     void Unlock();
     bool isLocked();
     Util::Mutex* getLock();
+    ///> the flusher of the value caches, NULL if the values aren't cached
+    Control::ValueCacheFlusher* getValueCacheFlusher();
+    /**
+     * @brief the lock that serializes the slave accesses with the cache flushes
+     * @return the access lock of the flusher, NULL if the values aren't cached
+     */
+    Util::Mutex* getAccessLock();
+
+    // checks the indexes a client asked for
+    static bool isValidIndexRange( int64_t first, int64_t count );
+    static bool isValidIndexes( const std::vector< int32_t > &idx );
+    static bool isValidValueCount( int64_t count );
+    // access a value through a cache, a failure is an error for the client
+    static double getCachedValue( Control::ValueCache &, uint64_t key );
+    static void setCachedValue( Control::ValueCache &, uint64_t key, double value );
 
     Element *           m_Parent;
     Control::Element &  m_Slave;
+    Control::ValueCacheFlusher* m_CacheFlusher;
 private:
     Util::Mutex*        m_UpdateLock;
 protected:
@@ -143,7 +161,8 @@ class Container
 public:
     Container( DBus::Connection& connection,
                   std::string p, Element *,
-                  Control::Container &slave );
+                  Control::Container &slave,
+                  Control::ValueCacheFlusher *flusher = NULL );
     virtual ~Container();
 
     int32_t getNbElements( );
@@ -172,6 +191,7 @@ public:
     Continuous( DBus::Connection& connection,
                   std::string p, Element *,
                   Control::Continuous &slave );
+    virtual ~Continuous();
     
     double setValue( const double & value );
     double getValue( );
@@ -180,9 +200,17 @@ public:
     double setValueIdx( const int32_t & idx,
                               const double & value );
     double getValueIdx( const int32_t & idx );
+    bool setValues( const int32_t & first,
+                    const std::vector< double > & values );
+    std::vector< double > getValues( const int32_t & first,
+                                     const int32_t & count );
+    bool setValuesSparse( const std::vector< int32_t > & idx,
+                          const std::vector< double > & values );
+    std::vector< double > getValuesSparse( const std::vector< int32_t > & idx );
 
 private:
     Control::Continuous &m_Slave;
+    Control::ValueCache *m_Cache;
 };
 
 class Discrete
@@ -193,15 +221,24 @@ public:
     Discrete( DBus::Connection& connection,
               std::string p, Element *,
               Control::Discrete &slave );
+    virtual ~Discrete();
     
     int32_t setValue( const int32_t & value );
     int32_t getValue( );
     int32_t setValueIdx( const int32_t & idx,
                              const int32_t & value );
     int32_t getValueIdx( const int32_t & idx );
+    bool setValues( const int32_t & first,
+                    const std::vector< int32_t > & values );
+    std::vector< int32_t > getValues( const int32_t & first,
+                                      const int32_t & count );
+    bool setValuesSparse( const std::vector< int32_t > & idx,
+                          const std::vector< int32_t > & values );
+    std::vector< int32_t > getValuesSparse( const std::vector< int32_t > & idx );
 
 private:
     Control::Discrete &m_Slave;
+    Control::ValueCache *m_Cache;
 };
 
 class Text
@@ -306,6 +343,7 @@ public:
     MatrixMixer(  DBus::Connection& connection,
                   std::string p, Element *,
                   Control::MatrixMixer &slave );
+    virtual ~MatrixMixer();
 
     int32_t getRowCount( );
     int32_t getColCount( );
@@ -313,6 +351,14 @@ public:
     int32_t canWrite( const int32_t&, const int32_t& );
     double setValue( const int32_t&, const int32_t&, const double& );
     double getValue( const int32_t&, const int32_t& );
+    bool setValues( const int32_t&, const int32_t&, const int32_t&, const int32_t&,
+                    const std::vector< double >& );
+    std::vector< double > getValues( const int32_t&, const int32_t&,
+                                     const int32_t&, const int32_t& );
+    bool setValuesSparse( const std::vector< int32_t >&, const std::vector< int32_t >&,
+                          const std::vector< double >& );
+    std::vector< double > getValuesSparse( const std::vector< int32_t >&,
+                                           const std::vector< int32_t >& );
 
     bool hasNames();
     std::string getRowName( const int32_t& );
@@ -327,7 +373,12 @@ public:
     bool connectColTo( const int32_t&, const std::string& );
 
 private:
+    // checks a block a client asked for against the size of the mixer
+    bool isValidBlock( int32_t row, int32_t col, int32_t nb_rows, int32_t nb_cols );
+    bool isValidEntries( const std::vector< int32_t >& rows, const std::vector< int32_t >& cols );
+
     Control::MatrixMixer &m_Slave;
+    Control::ValueCache *m_Cache;
 };
 
 class CrossbarRouter
@@ -40,6 +40,7 @@
 #include <dbus-c++/dbus.h>
 #include "controlserver.h"
 #include "libcontrol/BasicElements.h"
+#include "libcontrol/ValueCache.h"
 
 #include "libutil/Functors.h"
 
@@ -64,6 +65,7 @@ DBus::BusDispatcher dispatcher;
 DBusControl::Container *container = NULL;
 DBus::Connection * global_conn;
 DeviceManager *m_deviceManager = NULL;
+Control::ValueCacheFlusher *cache_flusher = NULL;
 
 // signal handler
 int run=1;
@@ -95,6 +97,8 @@ struct arguments
     int   port;
     int   node_id;
     int   node_id_set;
+    int   meter_rate;
+    int   control_cache;
     const char* args[2];
 };
 
@@ -110,6 +114,8 @@ static struct argp_option options[] = {
 
     {"node",     'n',    "id",    0,  "Only expose mixer of a device on a specific node" },
     {"port",     'p',    "nr",    0,  "IEEE1394 Port to use" },
+    {"meters",   'm',  "rate",    OPTION_ARG_OPTIONAL,  "Publish the meters in shared memory (rate in updates/s)" },
+    {"control-cache", 'C', "msec",  0,  "Max age of the cached control values (0 = no limit, -1 = don't cache)" },
     { 0 }
 };
 
@@ -176,6 +182,24 @@ parse_opt( int key, char* arg, struct argp_state* state )
             }
         }
         break;
+    case 'm':
+        // no rate means the configured rate
+        arguments->meter_rate = 0;
+        if (arg) {
+            arguments->meter_rate = strtol( arg, &tail, 0 );
+            if ( errno || arguments->meter_rate < 0 ) {
+                debugError( "Could not parse 'meters' argument\n" );
+                return ARGP_ERR_UNKNOWN;
+            }
+        }
+        break;
+    case 'C':
+        arguments->control_cache = strtol( arg, &tail, 0 );
+        if ( errno || arguments->control_cache < -1 ) {
+            debugError( "Could not parse 'control-cache' argument\n" );
+            return ARGP_ERR_UNKNOWN;
+        }
+        break;
     case ARGP_KEY_ARG:
         if (state->arg_num >= 1) {
             // Too many arguments.
@@ -211,6 +235,11 @@ preUpdateHandler()
     // stop receiving dbus events since the control structure is going to
     // be changed
     dispatcher.leave();
+    // write back the pending values and keep the cache off the
+    // elements while they are replaced
+    if ( cache_flusher ) {
+        cache_flusher->suspend();
+    }
 }
 
 void
@@ -220,6 +249,10 @@ postUpdateHandler()
     // the signal handlers registered by the elements should have taken
     // care of updating the control tree
 
+    if ( cache_flusher ) {
+        cache_flusher->resume();
+    }
+
     // signal that we can start receiving dbus events again
     sem_post(&run_sem);
 }
@@ -255,6 +288,8 @@ main( int argc, char **argv )
     arguments.port        = 0;
     arguments.node_id     = 0;
     arguments.node_id_set = 0; // if we don't specify a node, discover all
+    arguments.meter_rate  = -1; // no metering unless requested
+    arguments.control_cache = CONTROL_CACHE_MAX_AGE_MSEC;
     arguments.args[0]     = "";
     arguments.args[1]     = "";
 
@@ -286,6 +321,10 @@ main( int argc, char **argv )
         delete m_deviceManager;
         return exitfunction(-1);
     }
+    if ( arguments.meter_rate >= 0
+         && !m_deviceManager->startMetering(arguments.meter_rate) ) {
+        debugWarning("Could not start the meter service\n");
+    }
 
     // add pre-update handler
     Util::Functor* preupdate_functor = new Util::CallbackFunctor0< void (*)() >
@@ -319,10 +358,21 @@ main( int argc, char **argv )
     global_conn = &conn;
     conn.request_name("org.ffado.Control");
 
+    if ( arguments.control_cache >= 0 ) {
+        cache_flusher = new Control::ValueCacheFlusher( arguments.control_cache * 1000,
+                                                        CONTROL_CACHE_FLUSH_DELAY_MSEC * 1000,
+                                                        CONTROL_CACHE_MAX_ENTRIES );
+        if ( !cache_flusher->start() ) {
+            debugWarning( "Could not start the control cache flusher, not caching\n" );
+            delete cache_flusher;
+            cache_flusher = NULL;
+        }
+    }
+
     // lock the control tree such that it does not get modified while we build our view
     m_deviceManager->lockControl();
     container = new DBusControl::Container(conn, "/org/ffado/Control/DeviceManager", 
-                                            NULL, *m_deviceManager);
+                                            NULL, *m_deviceManager, cache_flusher);
     // unlock the control tree since the tree is built
     m_deviceManager->unlockControl();
 
@@ -345,7 +395,17 @@ main( int argc, char **argv )
         debugError("could not unregister post update notifier");
     }
     delete postupdate_functor;
+    // write back the pending values before the caches go away
+    if ( cache_flusher ) {
+        if ( !cache_flusher->flushAll() ) {
+            debugWarning( "Not all control values could be written\n" );
+        }
+    }
     delete container;
+    if ( cache_flusher ) {
+        cache_flusher->stop();
+        delete cache_flusher;
+    }
 
     signal (SIGINT, SIG_DFL);
     signal (SIGTERM, SIG_DFL);
@@ -0,0 +1,766 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/*
+ * Microbenchmarks for the streaming hot paths.
+ *
+ * Every benchmark runs a fixed number of iterations a few times and
+ * reports the minimum and the median time per unit of work (a sample of
+ * one channel, a frame, a byte, a call or a packet). The output is CSV,
+ * preceded by '#' comment lines that describe the build and the machine,
+ * such that the results of different releases can be compared by a
+ * script. The sample conversion kernels are run for every SIMD level the
+ * CPU supports.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include "version.h"
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+#include <algorithm>
+#include <string>
+
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/libstreaming/util/AudioKernels.h"
+#include "src/libstreaming/util/cip.h"
+#include "src/libutil/CpuFeatures.h"
+#include "src/libutil/ringbuffer.h"
+#include "src/libutil/TimestampedBuffer.h"
+#include "src/libutil/SystemTimeSource.h"
+#include "src/libieee1394/ieee1394service.h"
+#include "src/libieee1394/cycletimer.h"
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+using namespace Streaming;
+
+// the number of packets of sample data a kernel benchmark cycles
+// through, small enough to stay in the cache
+#define NB_DATA_PACKETS         32
+// the events in a packet at 48kHz
+#define EVENTS_PER_PACKET       8
+
+// Program documentation.
+static char doc[] = "FFADO -- streaming microbenchmarks\n\n"
+                    "Prints the results as CSV on stdout.\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int repeats;
+    float scale;
+    const char *filter;
+    bool list;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",        0,  "Verbose level" },
+    {"repeats",     'r',    "n",        0,  "Number of timed runs per benchmark (5)" },
+    {"scale",       's',    "factor",   0,  "Scale the number of iterations (1.0)" },
+    {"filter",      'f',    "text",     0,  "Only run the benchmarks whose name contains text" },
+    {"list",        'l',    0,          0,  "List the benchmarks instead of running them" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 'r':
+            arguments->repeats = strtol( arg, &tail, 0 );
+            break;
+        case 's':
+            arguments->scale = strtof( arg, &tail );
+            break;
+        case 'f':
+            arguments->filter = arg;
+            break;
+        case 'l':
+            arguments->list = true;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static inline uint64_t
+getNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+// pseudo random test data
+static inline uint32_t
+testValue(unsigned int i)
+{
+    return i * 2654435761U;
+}
+
+static void
+fillTestSamples(quadlet_t *buffer, unsigned int n, unsigned int seed, bool is_float)
+{
+    for (unsigned int i = 0; i < n; i++) {
+        uint32_t r = testValue(seed + i);
+        if (is_float) {
+            float v = ((float)(r >> 8) / (float)0x7FFFFF) - 1.0f;
+            memcpy(&buffer[i], &v, sizeof(float));
+        } else {
+            buffer[i] = r & 0x00FFFFFF;
+        }
+    }
+}
+
+/**
+ * A benchmark: run() does the work of a number of iterations, each of
+ * which is worth units_per_iteration units.
+ */
+class Benchmark
+{
+public:
+    Benchmark(std::string name, std::string variant, unsigned int ports,
+              const char *unit, unsigned int units_per_iteration,
+              unsigned int iterations)
+        : m_name( name )
+        , m_variant( variant )
+        , m_ports( ports )
+        , m_unit( unit )
+        , m_units_per_iteration( units_per_iteration )
+        , m_iterations( iterations )
+    {};
+    virtual ~Benchmark() {};
+
+    ///> false if the setup failed, the benchmark is not run then
+    virtual bool isReady() {return true;};
+    virtual void run(unsigned int iterations) = 0;
+
+    std::string m_name;
+    std::string m_variant;
+    unsigned int m_ports;
+    const char *m_unit;
+    unsigned int m_units_per_iteration;
+    unsigned int m_iterations;
+};
+
+static struct arguments arguments;
+static unsigned int nb_failed = 0;
+
+static void
+printHeader()
+{
+    printf("# ffado-bench %s\n", PACKAGE_VERSION);
+    printf("# simd_supported=%s\n",
+           Util::CpuFeatures::simdLevelToString(Util::CpuFeatures::getSupportedSimdLevel()));
+    printf("# timestamps=%s\n", (FIXED_POINT_TIMESTAMPS ? "fixed-point" : "double"));
+    printf("# repeats=%u\n", arguments.repeats);
+    printf("# scale=%g\n", arguments.scale);
+    printf("name,variant,ports,unit,iterations,ns_per_unit_min,ns_per_unit_median,units_per_sec\n");
+}
+
+static bool
+isSelected(const std::string &id)
+{
+    return (arguments.filter == NULL || id.find(arguments.filter) != std::string::npos);
+}
+
+/**
+ * runs a benchmark (if selected) and prints its result line, takes
+ * ownership of the benchmark
+ */
+static void
+measure(Benchmark *b)
+{
+    std::string id = b->m_name + "/" + b->m_variant;
+    if (b->m_ports) {
+        char ports[16];
+        snprintf(ports, sizeof(ports), "/%u", b->m_ports);
+        id += ports;
+    }
+    if (!isSelected(id)) {
+        delete b;
+        return;
+    }
+    if (arguments.list) {
+        printf("%s\n", id.c_str());
+        delete b;
+        return;
+    }
+    if (!b->isReady()) {
+        printf("# %s: could not set up the benchmark\n", id.c_str());
+        nb_failed++;
+        delete b;
+        return;
+    }
+
+    unsigned int iterations = (unsigned int)(b->m_iterations * arguments.scale);
+    if (iterations == 0) iterations = 1;
+    double units = (double)iterations * b->m_units_per_iteration;
+
+    // warm up the caches and the branch predictors
+    b->run(iterations / 10 + 1);
+
+    std::vector<double> results;
+    for (unsigned int r = 0; r < arguments.repeats; r++) {
+        uint64_t start = getNsecs();
+        b->run(iterations);
+        results.push_back((getNsecs() - start) / units);
+    }
+    std::sort(results.begin(), results.end());
+    double median = results[results.size() / 2];
+
+    printf("%s,%s,%u,%s,%u,%.4f,%.4f,%.0f\n",
+           b->m_name.c_str(), b->m_variant.c_str(), b->m_ports, b->m_unit,
+           iterations, results[0], median, (median > 0 ? 1e9 / median : 0.0));
+    fflush(stdout);
+    delete b;
+}
+
+static std::string
+kernelVariant(const struct AudioKernels &kernels, bool is_float)
+{
+    return std::string(is_float ? "float" : "int24") + "-" + kernels.name;
+}
+
+//-------------------------------------------------------------
+// sample conversion
+
+/**
+ * The sample buffers of a number of ports, NB_DATA_PACKETS packets long
+ */
+class PortBuffers
+{
+public:
+    PortBuffers(unsigned int nb_ports, bool is_float)
+        : m_nb_ports( nb_ports )
+    {
+        m_buffers = new quadlet_t *[nb_ports];
+        m_pointers = new void *[nb_ports];
+        for (unsigned int p = 0; p < nb_ports; p++) {
+            m_buffers[p] = new quadlet_t[EVENTS_PER_PACKET * NB_DATA_PACKETS];
+            fillTestSamples(m_buffers[p], EVENTS_PER_PACKET * NB_DATA_PACKETS,
+                            p * EVENTS_PER_PACKET * NB_DATA_PACKETS, is_float);
+        }
+    };
+    ~PortBuffers() {
+        for (unsigned int p = 0; p < m_nb_ports; p++) {
+            delete[] m_buffers[p];
+        }
+        delete[] m_buffers;
+        delete[] m_pointers;
+    };
+
+    ///> the buffer pointers for a packet
+    void * const *forPacket(unsigned int packet) {
+        unsigned int offset = (packet % NB_DATA_PACKETS) * EVENTS_PER_PACKET;
+        for (unsigned int p = 0; p < m_nb_ports; p++) {
+            m_pointers[p] = m_buffers[p] + offset;
+        }
+        return m_pointers;
+    };
+
+private:
+    unsigned int m_nb_ports;
+    quadlet_t **m_buffers;
+    void **m_pointers;
+};
+
+// AMDTP: one AM824 quadlet per channel, plus one MIDI slot
+class AM824Benchmark : public Benchmark
+{
+public:
+    AM824Benchmark(const struct AudioKernels &kernels, bool encode, bool is_float,
+                   unsigned int nb_ports)
+        : Benchmark(std::string("amdtp.") + (encode ? "encode" : "decode"),
+                    kernelVariant(kernels, is_float), nb_ports,
+                    "sample", nb_ports * EVENTS_PER_PACKET, 200000 / nb_ports)
+        , m_dimension( nb_ports + 1 )
+        , m_encode( encode ? (is_float ? kernels.encodeAM824Float : kernels.encodeAM824Int24) : NULL )
+        , m_decode( encode ? NULL : (is_float ? kernels.decodeAM824Float : kernels.decodeAM824Int24) )
+        , m_buffers( nb_ports, is_float )
+    {
+        unsigned int n = m_dimension * EVENTS_PER_PACKET * NB_DATA_PACKETS;
+        m_packets = new quadlet_t[n];
+        for (unsigned int i = 0; i < n; i++) {
+            // MBLA labeled samples
+            m_packets[i] = 0x40000000 | (testValue(i) >> 8);
+        }
+    };
+    ~AM824Benchmark() {
+        delete[] m_packets;
+    };
+
+    void run(unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            quadlet_t *packet = m_packets
+                + (i % NB_DATA_PACKETS) * m_dimension * EVENTS_PER_PACKET;
+            if (m_encode) {
+                m_encode(packet, m_dimension, m_buffers.forPacket(i),
+                         m_ports, EVENTS_PER_PACKET);
+            } else {
+                m_decode(packet, m_dimension, m_buffers.forPacket(i),
+                         m_ports, EVENTS_PER_PACKET);
+            }
+        }
+    };
+
+private:
+    unsigned int m_dimension;
+    am824_encode_func_t m_encode;
+    am824_decode_func_t m_decode;
+    PortBuffers m_buffers;
+    quadlet_t *m_packets;
+};
+
+// MOTU and Digidesign: packed 24-bit samples at byte positions, the
+// channels are sample_bytes apart
+class Packed24Benchmark : public Benchmark
+{
+public:
+    Packed24Benchmark(const char *device, unsigned int header_bytes, unsigned int sample_bytes,
+                      unsigned int event_size,
+                      const struct AudioKernels &kernels, bool encode, bool is_float,
+                      unsigned int nb_ports)
+        : Benchmark(std::string(device) + (encode ? ".encode" : ".decode"),
+                    kernelVariant(kernels, is_float), nb_ports,
+                    "sample", nb_ports * EVENTS_PER_PACKET, 200000 / nb_ports)
+        , m_event_size( event_size )
+        , m_encode( encode ? (is_float ? kernels.encodePacked24Float : kernels.encodePacked24Int24) : NULL )
+        , m_decode( encode ? NULL : (is_float ? kernels.decodePacked24Float : kernels.decodePacked24Int24) )
+        , m_buffers( nb_ports, is_float )
+    {
+        m_positions = new unsigned int[nb_ports];
+        for (unsigned int p = 0; p < nb_ports; p++) {
+            m_positions[p] = header_bytes + sample_bytes * p;
+        }
+        unsigned int n = m_event_size * EVENTS_PER_PACKET * NB_DATA_PACKETS;
+        m_packets = new byte_t[n];
+        for (unsigned int i = 0; i < n; i++) {
+            m_packets[i] = testValue(i) >> 24;
+        }
+    };
+    ~Packed24Benchmark() {
+        delete[] m_positions;
+        delete[] m_packets;
+    };
+
+    void run(unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            byte_t *packet = m_packets
+                + (i % NB_DATA_PACKETS) * m_event_size * EVENTS_PER_PACKET;
+            if (m_encode) {
+                m_encode(packet, m_event_size, m_positions, m_buffers.forPacket(i),
+                         m_ports, EVENTS_PER_PACKET);
+            } else {
+                m_decode(packet, m_event_size, m_positions, m_buffers.forPacket(i),
+                         m_ports, EVENTS_PER_PACKET);
+            }
+        }
+    };
+
+private:
+    unsigned int m_event_size;
+    packed24_encode_func_t m_encode;
+    packed24_decode_func_t m_decode;
+    PortBuffers m_buffers;
+    unsigned int *m_positions;
+    byte_t *m_packets;
+};
+
+// the MOTU event: a 10 byte header, the samples, padded to a quadlet
+#define MOTU_EVENT_HEADER_BYTES 10
+
+static Benchmark *
+createMotuBenchmark(const struct AudioKernels &kernels, bool encode, bool is_float,
+                    unsigned int nb_ports)
+{
+    return new Packed24Benchmark("motu", MOTU_EVENT_HEADER_BYTES, 3,
+                                 (MOTU_EVENT_HEADER_BYTES + 3 * nb_ports + 3) & ~3,
+                                 kernels, encode, is_float, nb_ports);
+}
+
+// the Digidesign event: a quadlet per channel
+static Benchmark *
+createDigidesignBenchmark(const struct AudioKernels &kernels, bool encode, bool is_float,
+                          unsigned int nb_ports)
+{
+    return new Packed24Benchmark("digidesign", 0, 4, 4 * nb_ports,
+                                 kernels, encode, is_float, nb_ports);
+}
+
+// RME: 24-bit samples in the top of a host-order quadlet per channel
+class RmeBenchmark : public Benchmark
+{
+public:
+    RmeBenchmark(const struct AudioKernels &kernels, bool encode, bool is_float,
+                 unsigned int nb_ports)
+        : Benchmark(std::string("rme.") + (encode ? "encode" : "decode"),
+                    kernelVariant(kernels, is_float), nb_ports,
+                    "sample", nb_ports * EVENTS_PER_PACKET, 200000 / nb_ports)
+        , m_encode( encode ? (is_float ? kernels.encodeQuadlet24Float : kernels.encodeQuadlet24Int24) : NULL )
+        , m_decode( encode ? NULL : (is_float ? kernels.decodeQuadlet24Float : kernels.decodeQuadlet24Int24) )
+        , m_buffers( nb_ports, is_float )
+    {
+        m_positions = new unsigned int[nb_ports];
+        for (unsigned int p = 0; p < nb_ports; p++) {
+            m_positions[p] = p;
+        }
+        unsigned int n = nb_ports * EVENTS_PER_PACKET * NB_DATA_PACKETS;
+        m_packets = new quadlet_t[n];
+        for (unsigned int i = 0; i < n; i++) {
+            m_packets[i] = testValue(i) & 0xFFFFFF00;
+        }
+    };
+    ~RmeBenchmark() {
+        delete[] m_positions;
+        delete[] m_packets;
+    };
+
+    void run(unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            quadlet_t *packet = m_packets
+                + (i % NB_DATA_PACKETS) * m_ports * EVENTS_PER_PACKET;
+            if (m_encode) {
+                m_encode(packet, m_ports, m_positions, m_buffers.forPacket(i),
+                         m_ports, EVENTS_PER_PACKET);
+            } else {
+                m_decode(packet, m_ports, m_positions, m_buffers.forPacket(i),
+                         m_ports, EVENTS_PER_PACKET);
+            }
+        }
+    };
+
+private:
+    quadlet24_encode_func_t m_encode;
+    quadlet24_decode_func_t m_decode;
+    PortBuffers m_buffers;
+    unsigned int *m_positions;
+    quadlet_t *m_packets;
+};
+
+static void
+runKernelBenchmarks()
+{
+    static const unsigned int port_counts[] = {2, 8, 16, 32};
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        for (int encode = 1; encode >= 0; encode--) {
+            for (int is_float = 1; is_float >= 0; is_float--) {
+                for (unsigned int i = 0; i < sizeof(port_counts) / sizeof(port_counts[0]); i++) {
+                    unsigned int n = port_counts[i];
+                    measure(new AM824Benchmark(kernels, encode, is_float, n));
+                    measure(createMotuBenchmark(kernels, encode, is_float, n));
+                    measure(createDigidesignBenchmark(kernels, encode, is_float, n));
+                    measure(new RmeBenchmark(kernels, encode, is_float, n));
+                }
+            }
+        }
+    }
+}
+
+//-------------------------------------------------------------
+// buffers
+
+// a write and a read of the same chunk
+class RingbufferBenchmark : public Benchmark
+{
+public:
+    RingbufferBenchmark(unsigned int chunk)
+        : Benchmark("ringbuffer.write_read", "", 0, "byte", chunk, 100000000 / (chunk + 64))
+        , m_chunk( chunk )
+    {
+        char variant[32];
+        snprintf(variant, sizeof(variant), "chunk-%u", chunk);
+        m_variant = variant;
+        m_rb = ffado_ringbuffer_create(64 * 1024);
+        m_data = new char[chunk];
+        memset(m_data, 0x5A, chunk);
+    };
+    ~RingbufferBenchmark() {
+        ffado_ringbuffer_free(m_rb);
+        delete[] m_data;
+    };
+
+    void run(unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            ffado_ringbuffer_write(m_rb, m_data, m_chunk);
+            ffado_ringbuffer_read(m_rb, m_data, m_chunk);
+        }
+    };
+
+private:
+    unsigned int m_chunk;
+    ffado_ringbuffer_t *m_rb;
+    char *m_data;
+};
+
+class NullTimestampedBufferClient
+    : public Util::TimestampedBufferClient {
+public:
+    bool processReadBlock(char *data, unsigned int nevents, unsigned int offset) {return true;};
+    bool processWriteBlock(char *data, unsigned int nevents, unsigned int offset) {return true;};
+};
+
+// the cycle timer wraps at 128 seconds
+#define TIMESTAMP_WRAP_AT       ((int64_t)(128LL * TICKS_PER_SECOND))
+
+/**
+ * A packet worth of frames goes into a buffer that is set up like the
+ * one of a receive stream processor at 48kHz.
+ *
+ * With read, the frames are read out again (the ringbuffer copy and the
+ * frame counter). Without, they are dropped, which leaves the frame
+ * counter update and the timestamp DLL update of
+ * TimestampedBuffer::incrementFrameCounter() as the main cost.
+ */
+class TimestampedBufferBenchmark : public Benchmark
+{
+public:
+    TimestampedBufferBenchmark(bool read, unsigned int nb_ports)
+        : Benchmark(read ? "tsbuffer.write_read" : "tsbuffer.dll_update", "48000Hz",
+                    nb_ports, (read ? "frame" : "call"),
+                    (read ? EVENTS_PER_PACKET : 1), 2000000)
+        , m_read( read )
+        , m_buffer( &m_client )
+        , m_ticks_per_packet( EVENTS_PER_PACKET * (TICKS_PER_SECOND / 48000) )
+        , m_ticks( 0 )
+    {
+        m_buffer.setVerboseLevel(arguments.verbose);
+        m_buffer.setBufferSize(1024);
+        m_buffer.setEventSize(sizeof(quadlet_t));
+        m_buffer.setEventsPerFrame(nb_ports);
+        m_buffer.setUpdatePeriod(EVENTS_PER_PACKET);
+        m_buffer.setNominalRate((float)TICKS_PER_SECOND / 48000);
+        m_buffer.setWrapValue(TIMESTAMP_WRAP_AT);
+        m_buffer.setBandwidth(STREAMPROCESSOR_DLL_BW_HZ / (double)TICKS_PER_SECOND);
+        m_ok = m_buffer.prepare();
+        m_buffer.setTransparent(false);
+        m_buffer.setBufferTailTimestamp(0);
+        m_data = new char[EVENTS_PER_PACKET * nb_ports * sizeof(quadlet_t)];
+        memset(m_data, 0, EVENTS_PER_PACKET * nb_ports * sizeof(quadlet_t));
+    };
+    ~TimestampedBufferBenchmark() {
+        delete[] m_data;
+    };
+
+    bool isReady() {return m_ok;};
+    void run(unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            m_ticks += m_ticks_per_packet;
+            if (m_ticks >= TIMESTAMP_WRAP_AT) m_ticks -= TIMESTAMP_WRAP_AT;
+            m_buffer.writeFrames(EVENTS_PER_PACKET, m_data, (ffado_timestamp_t)m_ticks);
+            if (m_read) {
+                m_buffer.readFrames(EVENTS_PER_PACKET, m_data);
+            } else {
+                m_buffer.dropFrames(EVENTS_PER_PACKET);
+            }
+        }
+    };
+
+private:
+    bool m_ok;
+    bool m_read;
+    NullTimestampedBufferClient m_client;
+    Util::TimestampedBuffer m_buffer;
+    int64_t m_ticks_per_packet;
+    int64_t m_ticks;
+    char *m_data;
+};
+
+static void
+runBufferBenchmarks()
+{
+    static const unsigned int chunks[] = {32, 256, 4096};
+    for (unsigned int i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++) {
+        measure(new RingbufferBenchmark(chunks[i]));
+    }
+
+    static const unsigned int port_counts[] = {2, 8, 32};
+    for (unsigned int i = 0; i < sizeof(port_counts) / sizeof(port_counts[0]); i++) {
+        measure(new TimestampedBufferBenchmark(true, port_counts[i]));
+    }
+    measure(new TimestampedBufferBenchmark(false, 1));
+}
+
+//-------------------------------------------------------------
+// timing
+
+// the cycle timer as seen by the stream processors
+class CycleTimerBenchmark : public Benchmark
+{
+public:
+    CycleTimerBenchmark(Ieee1394Service &service, bool now)
+        : Benchmark("cycletimer.get_ticks", (now ? "now" : "at"), 0, "call", 1, 2000000)
+        , m_service( service )
+        , m_now( now )
+        , m_sum( 0 )
+    {};
+
+    void run(unsigned int iterations) {
+        if (m_now) {
+            for (unsigned int i = 0; i < iterations; i++) {
+                m_sum += m_service.getCycleTimerTicks();
+            }
+        } else {
+            uint64_t t = Util::SystemTimeSource::getCurrentTimeAsUsecs();
+            for (unsigned int i = 0; i < iterations; i++) {
+                m_sum += m_service.getCycleTimerTicks(t + (i & 0xFF));
+            }
+        }
+    };
+
+private:
+    Ieee1394Service &m_service;
+    bool m_now;
+    volatile uint32_t m_sum;
+};
+
+// the CIP header of an AMDTP transmit stream (blocking mode, the default)
+class CipBenchmark : public Benchmark
+{
+public:
+    CipBenchmark(unsigned int rate, unsigned int syt_interval)
+        : Benchmark("cip.fill_header", "", 0, "packet", 1, 5000000)
+    {
+        char variant[32];
+        snprintf(variant, sizeof(variant), "%uHz", rate);
+        m_variant = variant;
+        iec61883_cip_init(&m_cip, IEC61883_FMT_AMDTP, IEC61883_FDF_AM824,
+                          rate, 9, syt_interval);
+    };
+
+    void run(unsigned int iterations) {
+        for (unsigned int i = 0; i < iterations; i++) {
+            iec61883_cip_fill_header(0x3F, &m_cip, (struct iec61883_packet *)m_packet);
+        }
+    };
+
+private:
+    struct iec61883_cip m_cip;
+    quadlet_t m_packet[2];
+};
+
+static void
+runTimingBenchmarks()
+{
+    measure(new CipBenchmark(48000, 8));
+    measure(new CipBenchmark(96000, 16));
+    measure(new CipBenchmark(192000, 32));
+
+    // don't start a service for nothing
+    bool now = isSelected("cycletimer.get_ticks/now");
+    bool at = isSelected("cycletimer.get_ticks/at");
+    if (arguments.list) {
+        if (now) printf("cycletimer.get_ticks/now\n");
+        if (at) printf("cycletimer.get_ticks/at\n");
+        return;
+    }
+    if (!now && !at) {
+        return;
+    }
+    // the simulated bus provides the cycle timer without hardware
+    Ieee1394Service *service = new Ieee1394Service();
+    service->setVerboseLevel(arguments.verbose);
+    if (!service->initializeSimulated(0)) {
+        printf("# cycletimer.get_ticks: could not initialize the simulated bus\n");
+        nb_failed++;
+        delete service;
+        return;
+    }
+    // let the cycle timer DLL settle
+    Util::SystemTimeSource::SleepUsecRelative(200000);
+    measure(new CycleTimerBenchmark(*service, true));
+    measure(new CycleTimerBenchmark(*service, false));
+    delete service;
+}
+
+int main(int argc, char *argv[])
+{
+    // Default values.
+    arguments.verbose           = 0;
+    arguments.repeats           = 5;
+    arguments.scale             = 1.0;
+    arguments.filter            = NULL;
+    arguments.list              = false;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+    if (arguments.repeats == 0 || arguments.scale <= 0.0) {
+        fprintf( stderr, "The repeats and the scale should be positive\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    if (!arguments.list) {
+        printHeader();
+    }
+    runKernelBenchmarks();
+    runBufferBenchmarks();
+    runTimingBenchmarks();
+
+    return (nb_failed ? EXIT_FAILURE : EXIT_SUCCESS);
+}
@@ -27,16 +27,36 @@ DECLARE_GLOBAL_DEBUG_MODULE;
 
 #include "libutil/ByteSwap.h"
 #include "libstreaming/amdtp/AmdtpBufferOps.h"
+#include "libstreaming/util/AudioKernels.h"
+#include "libutil/CpuFeatures.h"
 
 #include "libutil/SystemTimeSource.h"
 #include "libutil/Time.h"
 
 #include <inttypes.h>
+#include <string.h>
 
 // 32M of test data
 #define NB_QUADLETS (1024 * 1024 * 32)
 #define NB_TESTS 10
 
+// packets to convert per kernel benchmark run, the data for them
+// is recycled such that it stays in the cache
+#define NB_KERNEL_PACKETS (1024 * 16)
+#define NB_KERNEL_PACKETS_DATA 32
+
+using namespace Streaming;
+
+static inline uint64_t
+getCycleCount() {
+#ifdef FFADO_HAVE_X86_SIMD_DISPATCH
+    return __builtin_ia32_rdtsc();
+#else
+    // no cycle counter available, count nanoseconds instead
+    return Util::SystemTimeSource::getCurrentTimeAsUsecs() * 1000ULL;
+#endif
+}
+
 bool
 testByteSwap(int nb_quadlets, int nb_tests) {
     quadlet_t *buffer_1;
@@ -261,12 +281,583 @@ testFloatLabel(int nb_quadlets, int nb_tests) {
     return all_ok;
 }
 
+bool
+testAM824EncodeKernels(unsigned int nb_ports, unsigned int nevents, bool is_float) {
+    unsigned int dimension = nb_ports + 1; // leave one slot for MIDI
+    unsigned int nb_frames = nevents * NB_KERNEL_PACKETS_DATA;
+    int i;
+    unsigned int p;
+
+    setDebugLevel(DEBUG_LEVEL_MESSAGE);
+
+    quadlet_t *packet_ref = new quadlet_t[nevents * dimension];
+    quadlet_t *packet = new quadlet_t[nevents * dimension];
+    quadlet_t **port_buffers = new quadlet_t *[nb_ports];
+    void **buffers = new void *[nb_ports];
+
+    printMessage( "Generating test data (%s, %u ports, %u events/packet)...\n",
+                  (is_float ? "float" : "int24"), nb_ports, nevents);
+    for (p=0; p<nb_ports; p++) {
+        port_buffers[p] = new quadlet_t[nb_frames];
+        for (i=0; i<(int)nb_frames; i++) {
+            uint32_t v = ((i * 2654435761U) ^ (p << 20)) & 0x00FFFFFF;
+            if (is_float) {
+                // include some values that are out of range to test clipping
+                float f = ((float)v / (float)(0x007FFFFF)) - 1.0;
+                f *= ((i & 0x3F) == 0 ? 1.5 : 1.0);
+                memcpy(&port_buffers[p][i], &f, sizeof(f));
+            } else {
+                port_buffers[p][i] = v;
+            }
+        }
+    }
+
+    const struct AudioKernels &ref_kernels = getAudioKernels(Util::CpuFeatures::eSL_Scalar);
+    bool all_ok = true;
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        am824_encode_func_t encode = (is_float ? kernels.encodeAM824Float : kernels.encodeAM824Int24);
+        am824_encode_func_t encode_ref = (is_float ? ref_kernels.encodeAM824Float : ref_kernels.encodeAM824Int24);
+
+        // timing run
+        uint64_t start = getCycleCount();
+        for (i=0; i<NB_KERNEL_PACKETS; i++) {
+            for (p=0; p<nb_ports; p++) {
+                buffers[p] = port_buffers[p] + (i % NB_KERNEL_PACKETS_DATA) * nevents;
+            }
+            encode(packet, dimension, buffers, nb_ports, nevents);
+        }
+        uint64_t cycles = getCycleCount() - start;
+
+        // check against the scalar kernels
+        unsigned int mismatches = 0;
+        for (i=0; i<NB_KERNEL_PACKETS_DATA; i++) {
+            for (p=0; p<nb_ports; p++) {
+                buffers[p] = port_buffers[p] + i * nevents;
+            }
+            encode(packet, dimension, buffers, nb_ports, nevents);
+            encode_ref(packet_ref, dimension, buffers, nb_ports, nevents);
+            unsigned int e;
+            for (e=0; e<nevents; e++) {
+                if (memcmp(packet + e * dimension, packet_ref + e * dimension,
+                           nb_ports * sizeof(quadlet_t)) != 0) {
+                    mismatches++;
+                }
+            }
+        }
+        printMessage( " %-7s: %6.3f cycles/frame/channel, %u mismatches\n",
+                      kernels.name,
+                      (double)cycles / ((double)nevents * NB_KERNEL_PACKETS * nb_ports),
+                      mismatches);
+        if (mismatches) all_ok = false;
+    }
+
+    for (p=0; p<nb_ports; p++) {
+        delete[] port_buffers[p];
+    }
+    delete[] port_buffers;
+    delete[] buffers;
+    delete[] packet;
+    delete[] packet_ref;
+    return all_ok;
+}
+
+bool
+testAM824DecodeKernels(unsigned int nb_ports, unsigned int nevents, bool is_float) {
+    unsigned int dimension = nb_ports + 1; // leave one slot for MIDI
+    unsigned int nb_quadlets = nevents * dimension * NB_KERNEL_PACKETS_DATA;
+    unsigned int i;
+    unsigned int p;
+
+    setDebugLevel(DEBUG_LEVEL_MESSAGE);
+
+    quadlet_t *packets = new quadlet_t[nb_quadlets];
+    quadlet_t **port_buffers = new quadlet_t *[nb_ports];
+    quadlet_t **port_buffers_ref = new quadlet_t *[nb_ports];
+    void **buffers = new void *[nb_ports];
+    void **buffers_ref = new void *[nb_ports];
+
+    printMessage( "Generating test data (%s, %u ports, %u events/packet)...\n",
+                  (is_float ? "float" : "int24"), nb_ports, nevents);
+    // random labels and samples, covering the full 24-bit range
+    for (i=0; i<nb_quadlets; i++) {
+        packets[i] = i * 2654435761U;
+    }
+    for (p=0; p<nb_ports; p++) {
+        port_buffers[p] = new quadlet_t[nevents];
+        port_buffers_ref[p] = new quadlet_t[nevents];
+    }
+
+    const struct AudioKernels &ref_kernels = getAudioKernels(Util::CpuFeatures::eSL_Scalar);
+    bool all_ok = true;
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        am824_decode_func_t decode = (is_float ? kernels.decodeAM824Float : kernels.decodeAM824Int24);
+        am824_decode_func_t decode_ref = (is_float ? ref_kernels.decodeAM824Float : ref_kernels.decodeAM824Int24);
+
+        for (p=0; p<nb_ports; p++) {
+            buffers[p] = port_buffers[p];
+            buffers_ref[p] = port_buffers_ref[p];
+        }
+
+        // timing run
+        uint64_t start = getCycleCount();
+        for (i=0; i<NB_KERNEL_PACKETS; i++) {
+            decode(packets + (i % NB_KERNEL_PACKETS_DATA) * nevents * dimension,
+                   dimension, buffers, nb_ports, nevents);
+        }
+        uint64_t cycles = getCycleCount() - start;
+
+        // check against the scalar kernels
+        unsigned int mismatches = 0;
+        for (i=0; i<NB_KERNEL_PACKETS_DATA; i++) {
+            quadlet_t *packet = packets + i * nevents * dimension;
+            decode(packet, dimension, buffers, nb_ports, nevents);
+            decode_ref(packet, dimension, buffers_ref, nb_ports, nevents);
+            for (p=0; p<nb_ports; p++) {
+                if (memcmp(port_buffers[p], port_buffers_ref[p],
+                           nevents * sizeof(quadlet_t)) != 0) {
+                    mismatches++;
+                }
+            }
+        }
+        printMessage( " %-7s: %6.3f cycles/frame/channel, %u mismatches\n",
+                      kernels.name,
+                      (double)cycles / ((double)nevents * NB_KERNEL_PACKETS * nb_ports),
+                      mismatches);
+        if (mismatches) all_ok = false;
+    }
+
+    for (p=0; p<nb_ports; p++) {
+        delete[] port_buffers[p];
+        delete[] port_buffers_ref[p];
+    }
+    delete[] port_buffers;
+    delete[] port_buffers_ref;
+    delete[] buffers;
+    delete[] buffers_ref;
+    delete[] packets;
+    return all_ok;
+}
+
+/*
+ * The MOTU event layout: a 10 byte header, followed by the packed 24-bit
+ * samples of all channels, padded to a quadlet boundary.
+ */
+#define MOTU_EVENT_HEADER_BYTES 10
+
+static unsigned int
+motuEventSize(unsigned int nb_ports) {
+    return (MOTU_EVENT_HEADER_BYTES + 3 * nb_ports + 3) & ~3;
+}
+
+/*
+ * The Digidesign event layout: one quadlet per channel, the sample in
+ * its first 3 bytes. The kernels vectorize these runs of quadlet-spaced
+ * ports too, and must leave the fourth byte of each quadlet alone.
+ */
+static unsigned int
+packed24EventSize(unsigned int nb_ports, bool digidesign) {
+    return (digidesign ? 4 * nb_ports : motuEventSize(nb_ports));
+}
+
+static unsigned int
+packed24Position(unsigned int port, bool digidesign) {
+    return (digidesign ? 4 * port : MOTU_EVENT_HEADER_BYTES + 3 * port);
+}
+
+bool
+testPacked24EncodeKernels(unsigned int nb_ports, unsigned int nevents, bool is_float, bool digidesign) {
+    unsigned int event_size = packed24EventSize(nb_ports, digidesign);
+    unsigned int nb_bytes = nevents * event_size * NB_KERNEL_PACKETS_DATA;
+    unsigned int i;
+    unsigned int p;
+
+    setDebugLevel(DEBUG_LEVEL_MESSAGE);
+
+    byte_t *packets = new byte_t[nb_bytes];
+    byte_t *packets_ref = new byte_t[nb_bytes];
+    unsigned int *positions = new unsigned int[nb_ports];
+    quadlet_t **port_buffers = new quadlet_t *[nb_ports];
+    void **buffers = new void *[nb_ports];
+
+    printMessage( "Generating %s test data (%s, %u ports, %u events/packet)...\n",
+                  (digidesign ? "Digidesign" : "MOTU"),
+                  (is_float ? "float" : "int24"), nb_ports, nevents);
+    for (p=0; p<nb_ports; p++) {
+        positions[p] = packed24Position(p, digidesign);
+        port_buffers[p] = new quadlet_t[nevents * NB_KERNEL_PACKETS_DATA];
+        for (i=0; i<nevents * NB_KERNEL_PACKETS_DATA; i++) {
+            uint32_t r = (p * nevents * NB_KERNEL_PACKETS_DATA + i) * 2654435761U;
+            if (is_float) {
+                // including some out-of-range values
+                float v = ((float)(r >> 8) / (float)0x7FFFFF) * 1.2f - 1.2f;
+                memcpy(&port_buffers[p][i], &v, sizeof(float));
+            } else {
+                port_buffers[p][i] = r;
+            }
+        }
+    }
+
+    const struct AudioKernels &ref_kernels = getAudioKernels(Util::CpuFeatures::eSL_Scalar);
+    bool all_ok = true;
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        packed24_encode_func_t encode = (is_float ? kernels.encodePacked24Float : kernels.encodePacked24Int24);
+        packed24_encode_func_t encode_ref = (is_float ? ref_kernels.encodePacked24Float : ref_kernels.encodePacked24Int24);
+
+        // timing run
+        uint64_t start = getCycleCount();
+        for (i=0; i<NB_KERNEL_PACKETS; i++) {
+            unsigned int k = i % NB_KERNEL_PACKETS_DATA;
+            for (p=0; p<nb_ports; p++) {
+                buffers[p] = port_buffers[p] + k * nevents;
+            }
+            encode(packets + k * nevents * event_size,
+                   event_size, positions, buffers, nb_ports, nevents);
+        }
+        uint64_t cycles = getCycleCount() - start;
+
+        // check against the scalar kernels, on packets that already hold
+        // data so that bytes the kernels must not touch are checked too
+        for (i=0; i<nb_bytes; i++) {
+            packets[i] = packets_ref[i] = (byte_t)(i * 37 + 11);
+        }
+        for (i=0; i<NB_KERNEL_PACKETS_DATA; i++) {
+            for (p=0; p<nb_ports; p++) {
+                buffers[p] = port_buffers[p] + i * nevents;
+            }
+            encode(packets + i * nevents * event_size,
+                   event_size, positions, buffers, nb_ports, nevents);
+            encode_ref(packets_ref + i * nevents * event_size,
+                       event_size, positions, buffers, nb_ports, nevents);
+        }
+        unsigned int mismatches = 0;
+        for (i=0; i<nb_bytes; i++) {
+            if (packets[i] != packets_ref[i]) mismatches++;
+        }
+        printMessage( " %-7s: %6.3f cycles/frame/channel, %u mismatches\n",
+                      kernels.name,
+                      (double)cycles / ((double)nevents * NB_KERNEL_PACKETS * nb_ports),
+                      mismatches);
+        if (mismatches) all_ok = false;
+    }
+
+    for (p=0; p<nb_ports; p++) {
+        delete[] port_buffers[p];
+    }
+    delete[] port_buffers;
+    delete[] buffers;
+    delete[] positions;
+    delete[] packets;
+    delete[] packets_ref;
+    return all_ok;
+}
+
+bool
+testPacked24DecodeKernels(unsigned int nb_ports, unsigned int nevents, bool is_float, bool digidesign) {
+    unsigned int event_size = packed24EventSize(nb_ports, digidesign);
+    unsigned int nb_bytes = nevents * event_size * NB_KERNEL_PACKETS_DATA;
+    unsigned int i;
+    unsigned int p;
+
+    setDebugLevel(DEBUG_LEVEL_MESSAGE);
+
+    byte_t *packets = new byte_t[nb_bytes];
+    unsigned int *positions = new unsigned int[nb_ports];
+    quadlet_t **port_buffers = new quadlet_t *[nb_ports];
+    quadlet_t **port_buffers_ref = new quadlet_t *[nb_ports];
+    void **buffers = new void *[nb_ports];
+    void **buffers_ref = new void *[nb_ports];
+
+    printMessage( "Generating %s test data (%s, %u ports, %u events/packet)...\n",
+                  (digidesign ? "Digidesign" : "MOTU"),
+                  (is_float ? "float" : "int24"), nb_ports, nevents);
+    for (i=0; i<nb_bytes; i++) {
+        packets[i] = (i * 2654435761U) >> 24;
+    }
+    for (p=0; p<nb_ports; p++) {
+        positions[p] = packed24Position(p, digidesign);
+        port_buffers[p] = new quadlet_t[nevents];
+        port_buffers_ref[p] = new quadlet_t[nevents];
+        buffers[p] = port_buffers[p];
+        buffers_ref[p] = port_buffers_ref[p];
+    }
+
+    const struct AudioKernels &ref_kernels = getAudioKernels(Util::CpuFeatures::eSL_Scalar);
+    bool all_ok = true;
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        packed24_decode_func_t decode = (is_float ? kernels.decodePacked24Float : kernels.decodePacked24Int24);
+        packed24_decode_func_t decode_ref = (is_float ? ref_kernels.decodePacked24Float : ref_kernels.decodePacked24Int24);
+
+        // timing run
+        uint64_t start = getCycleCount();
+        for (i=0; i<NB_KERNEL_PACKETS; i++) {
+            decode(packets + (i % NB_KERNEL_PACKETS_DATA) * nevents * event_size,
+                   event_size, positions, buffers, nb_ports, nevents);
+        }
+        uint64_t cycles = getCycleCount() - start;
+
+        // check against the scalar kernels
+        unsigned int mismatches = 0;
+        for (i=0; i<NB_KERNEL_PACKETS_DATA; i++) {
+            byte_t *packet = packets + i * nevents * event_size;
+            decode(packet, event_size, positions, buffers, nb_ports, nevents);
+            decode_ref(packet, event_size, positions, buffers_ref, nb_ports, nevents);
+            for (p=0; p<nb_ports; p++) {
+                if (memcmp(port_buffers[p], port_buffers_ref[p],
+                           nevents * sizeof(quadlet_t)) != 0) {
+                    mismatches++;
+                }
+            }
+        }
+        printMessage( " %-7s: %6.3f cycles/frame/channel, %u mismatches\n",
+                      kernels.name,
+                      (double)cycles / ((double)nevents * NB_KERNEL_PACKETS * nb_ports),
+                      mismatches);
+        if (mismatches) all_ok = false;
+    }
+
+    for (p=0; p<nb_ports; p++) {
+        delete[] port_buffers[p];
+        delete[] port_buffers_ref[p];
+    }
+    delete[] port_buffers;
+    delete[] port_buffers_ref;
+    delete[] buffers;
+    delete[] buffers_ref;
+    delete[] positions;
+    delete[] packets;
+    return all_ok;
+}
+
+bool
+testQuadlet24EncodeKernels(unsigned int nb_ports, unsigned int nevents, bool is_float) {
+    unsigned int dimension = nb_ports + 1; // leave one slot for MIDI
+    unsigned int nb_quadlets = nevents * dimension * NB_KERNEL_PACKETS_DATA;
+    unsigned int i;
+    unsigned int p;
+
+    setDebugLevel(DEBUG_LEVEL_MESSAGE);
+
+    quadlet_t *packets = new quadlet_t[nb_quadlets];
+    quadlet_t *packets_ref = new quadlet_t[nb_quadlets];
+    unsigned int *positions = new unsigned int[nb_ports];
+    quadlet_t **port_buffers = new quadlet_t *[nb_ports];
+    void **buffers = new void *[nb_ports];
+
+    printMessage( "Generating RME test data (%s, %u ports, %u events/packet)...\n",
+                  (is_float ? "float" : "int24"), nb_ports, nevents);
+    for (p=0; p<nb_ports; p++) {
+        positions[p] = p;
+        port_buffers[p] = new quadlet_t[nevents * NB_KERNEL_PACKETS_DATA];
+        for (i=0; i<nevents * NB_KERNEL_PACKETS_DATA; i++) {
+            uint32_t r = (p * nevents * NB_KERNEL_PACKETS_DATA + i) * 2654435761U;
+            if (is_float) {
+                // including some out-of-range values
+                float v = ((float)(r >> 8) / (float)0x7FFFFF) * 1.2f - 1.2f;
+                memcpy(&port_buffers[p][i], &v, sizeof(float));
+            } else {
+                port_buffers[p][i] = r;
+            }
+        }
+    }
+
+    const struct AudioKernels &ref_kernels = getAudioKernels(Util::CpuFeatures::eSL_Scalar);
+    bool all_ok = true;
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        quadlet24_encode_func_t encode = (is_float ? kernels.encodeQuadlet24Float : kernels.encodeQuadlet24Int24);
+        quadlet24_encode_func_t encode_ref = (is_float ? ref_kernels.encodeQuadlet24Float : ref_kernels.encodeQuadlet24Int24);
+
+        // timing run
+        uint64_t start = getCycleCount();
+        for (i=0; i<NB_KERNEL_PACKETS; i++) {
+            unsigned int k = i % NB_KERNEL_PACKETS_DATA;
+            for (p=0; p<nb_ports; p++) {
+                buffers[p] = port_buffers[p] + k * nevents;
+            }
+            encode(packets + k * nevents * dimension,
+                   dimension, positions, buffers, nb_ports, nevents);
+        }
+        uint64_t cycles = getCycleCount() - start;
+
+        // check against the scalar kernels
+        memset(packets, 0, nb_quadlets * sizeof(quadlet_t));
+        memset(packets_ref, 0, nb_quadlets * sizeof(quadlet_t));
+        for (i=0; i<NB_KERNEL_PACKETS_DATA; i++) {
+            for (p=0; p<nb_ports; p++) {
+                buffers[p] = port_buffers[p] + i * nevents;
+            }
+            encode(packets + i * nevents * dimension,
+                   dimension, positions, buffers, nb_ports, nevents);
+            encode_ref(packets_ref + i * nevents * dimension,
+                       dimension, positions, buffers, nb_ports, nevents);
+        }
+        unsigned int mismatches = 0;
+        for (i=0; i<nb_quadlets; i++) {
+            if (packets[i] != packets_ref[i]) mismatches++;
+        }
+        printMessage( " %-7s: %6.3f cycles/frame/channel, %u mismatches\n",
+                      kernels.name,
+                      (double)cycles / ((double)nevents * NB_KERNEL_PACKETS * nb_ports),
+                      mismatches);
+        if (mismatches) all_ok = false;
+    }
+
+    for (p=0; p<nb_ports; p++) {
+        delete[] port_buffers[p];
+    }
+    delete[] port_buffers;
+    delete[] buffers;
+    delete[] positions;
+    delete[] packets;
+    delete[] packets_ref;
+    return all_ok;
+}
+
+bool
+testQuadlet24DecodeKernels(unsigned int nb_ports, unsigned int nevents, bool is_float) {
+    unsigned int dimension = nb_ports + 1; // leave one slot for MIDI
+    unsigned int nb_quadlets = nevents * dimension * NB_KERNEL_PACKETS_DATA;
+    unsigned int i;
+    unsigned int p;
+
+    setDebugLevel(DEBUG_LEVEL_MESSAGE);
+
+    quadlet_t *packets = new quadlet_t[nb_quadlets];
+    unsigned int *positions = new unsigned int[nb_ports];
+    quadlet_t **port_buffers = new quadlet_t *[nb_ports];
+    quadlet_t **port_buffers_ref = new quadlet_t *[nb_ports];
+    void **buffers = new void *[nb_ports];
+    void **buffers_ref = new void *[nb_ports];
+
+    printMessage( "Generating RME test data (%s, %u ports, %u events/packet)...\n",
+                  (is_float ? "float" : "int24"), nb_ports, nevents);
+    for (i=0; i<nb_quadlets; i++) {
+        packets[i] = i * 2654435761U;
+    }
+    for (p=0; p<nb_ports; p++) {
+        positions[p] = p;
+        port_buffers[p] = new quadlet_t[nevents];
+        port_buffers_ref[p] = new quadlet_t[nevents];
+        buffers[p] = port_buffers[p];
+        buffers_ref[p] = port_buffers_ref[p];
+    }
+
+    const struct AudioKernels &ref_kernels = getAudioKernels(Util::CpuFeatures::eSL_Scalar);
+    bool all_ok = true;
+    int level;
+    for (level = Util::CpuFeatures::eSL_Scalar;
+         level <= Util::CpuFeatures::getSupportedSimdLevel();
+         level++) {
+        const struct AudioKernels &kernels = getAudioKernels((enum Util::CpuFeatures::eSimdLevel)level);
+        if (kernels.level != level) continue; // no kernels for this level
+        quadlet24_decode_func_t decode = (is_float ? kernels.decodeQuadlet24Float : kernels.decodeQuadlet24Int24);
+        quadlet24_decode_func_t decode_ref = (is_float ? ref_kernels.decodeQuadlet24Float : ref_kernels.decodeQuadlet24Int24);
+
+        // timing run
+        uint64_t start = getCycleCount();
+        for (i=0; i<NB_KERNEL_PACKETS; i++) {
+            decode(packets + (i % NB_KERNEL_PACKETS_DATA) * nevents * dimension,
+                   dimension, positions, buffers, nb_ports, nevents);
+        }
+        uint64_t cycles = getCycleCount() - start;
+
+        // check against the scalar kernels
+        unsigned int mismatches = 0;
+        for (i=0; i<NB_KERNEL_PACKETS_DATA; i++) {
+            quadlet_t *packet = packets + i * nevents * dimension;
+            decode(packet, dimension, positions, buffers, nb_ports, nevents);
+            decode_ref(packet, dimension, positions, buffers_ref, nb_ports, nevents);
+            for (p=0; p<nb_ports; p++) {
+                if (memcmp(port_buffers[p], port_buffers_ref[p],
+                           nevents * sizeof(quadlet_t)) != 0) {
+                    mismatches++;
+                }
+            }
+        }
+        printMessage( " %-7s: %6.3f cycles/frame/channel, %u mismatches\n",
+                      kernels.name,
+                      (double)cycles / ((double)nevents * NB_KERNEL_PACKETS * nb_ports),
+                      mismatches);
+        if (mismatches) all_ok = false;
+    }
+
+    for (p=0; p<nb_ports; p++) {
+        delete[] port_buffers[p];
+        delete[] port_buffers_ref[p];
+    }
+    delete[] port_buffers;
+    delete[] port_buffers_ref;
+    delete[] buffers;
+    delete[] buffers_ref;
+    delete[] positions;
+    delete[] packets;
+    return all_ok;
+}
+
 int
 main(int argc, char **argv) {
 
     testByteSwap(NB_QUADLETS, NB_TESTS);
     testInt24Label(NB_QUADLETS, NB_TESTS);
     testFloatLabel(NB_QUADLETS, NB_TESTS);
-    
-    return 0;
+
+    // 48kHz, 96kHz and 192kHz blocking mode packet sizes
+    bool kernels_ok = true;
+    unsigned int nevents;
+    for (nevents = 8; nevents <= 32; nevents *= 2) {
+        kernels_ok &= testAM824EncodeKernels(18, nevents, false);
+        kernels_ok &= testAM824EncodeKernels(18, nevents, true);
+    }
+    // decoding, with enough channels to use all kernel widths
+    for (nevents = 8; nevents <= 32; nevents *= 2) {
+        kernels_ok &= testAM824DecodeKernels(66, nevents, false);
+        kernels_ok &= testAM824DecodeKernels(66, nevents, true);
+    }
+    // MOTU packed 24-bit samples, e.g. a Traveler at 1x rates
+    for (nevents = 8; nevents <= 32; nevents *= 2) {
+        kernels_ok &= testPacked24EncodeKernels(22, nevents, false, false);
+        kernels_ok &= testPacked24EncodeKernels(22, nevents, true, false);
+        kernels_ok &= testPacked24DecodeKernels(22, nevents, false, false);
+        kernels_ok &= testPacked24DecodeKernels(22, nevents, true, false);
+    }
+    // Digidesign packed 24-bit samples, e.g. a 003 Rack at 1x rates
+    for (nevents = 8; nevents <= 32; nevents *= 2) {
+        kernels_ok &= testPacked24EncodeKernels(18, nevents, false, true);
+        kernels_ok &= testPacked24EncodeKernels(18, nevents, true, true);
+        kernels_ok &= testPacked24DecodeKernels(18, nevents, false, true);
+        kernels_ok &= testPacked24DecodeKernels(18, nevents, true, true);
+    }
+    // RME quadlet 24-bit samples, e.g. a Fireface 800 at 1x rates
+    for (nevents = 8; nevents <= 32; nevents *= 2) {
+        kernels_ok &= testQuadlet24EncodeKernels(28, nevents, false);
+        kernels_ok &= testQuadlet24EncodeKernels(28, nevents, true);
+        kernels_ok &= testQuadlet24DecodeKernels(28, nevents, false);
+        kernels_ok &= testQuadlet24DecodeKernels(28, nevents, true);
+    }
+
+    return (kernels_ok ? 0 : -1);
 }
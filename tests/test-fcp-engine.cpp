@@ -0,0 +1,438 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Benchmark for the FCP engine, against a local fake responder.
+ *
+ * The fake transport answers every request after a fixed latency, like
+ * an AV/C device would. The benchmark reports the commands per second
+ * and the average latency for:
+ *  - serial:   one thread issuing the commands one after the other,
+ *              round robin over the nodes (the old behavior)
+ *  - threads:  one thread per node, each issuing blocking transactions
+ *  - async:    completion callbacks that resubmit the transaction of
+ *              their node, without any client thread
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include <signal.h>
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/libieee1394/FcpEngine.h"
+#include "src/libutil/Functors.h"
+#include "src/libutil/SystemTimeSource.h"
+
+#include <map>
+#include <vector>
+#include <pthread.h>
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+#define TEST_MAX_NODES      63
+
+volatile int run;
+// Program documentation.
+static char doc[] = "FFADO -- FCP engine benchmark\n\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int nodes;
+    unsigned int latency;
+    unsigned int seconds;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"nodes",       'n',    "n",    0,  "Number of responding nodes (4)" },
+    {"latency",     'l',    "n",    0,  "Response latency of a node (in usecs) (500)" },
+    {"time",        't',    "n",    0,  "Run time per mode (in seconds) (3)" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 'n':
+            arguments->nodes = strtol( arg, &tail, 0 );
+            break;
+        case 'l':
+            arguments->latency = strtol( arg, &tail, 0 );
+            break;
+        case 't':
+            arguments->seconds = strtol( arg, &tail, 0 );
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static void sighandler (int sig)
+{
+        run = 0;
+}
+
+/**
+ * Answers every request with an IMPLEMENTED/STABLE response carrying
+ * the request's subunit, opcode and operands, after a fixed latency.
+ */
+class FakeResponder : public FcpEngine::Transport
+{
+public:
+    FakeResponder( unsigned int latency )
+        : m_latency( latency )
+        , m_timer_fd( -1 )
+        , m_engine( NULL )
+        , m_nb_requests( 0 )
+    {};
+    virtual ~FakeResponder() {close();};
+
+    virtual bool open( FcpEngine& engine ) {
+        m_engine = &engine;
+        m_timer_fd = timerfd_create( CLOCK_MONOTONIC, TFD_NONBLOCK );
+        return m_timer_fd >= 0;
+    };
+    virtual void close() {
+        if (m_timer_fd >= 0) {
+            ::close( m_timer_fd );
+            m_timer_fd = -1;
+        }
+    };
+
+    virtual bool sendRequest( fb_nodeid_t nodeId, fb_quadlet_t* data,
+                              unsigned int length ) {
+        Response r;
+        r.nodeId = 0xffc0 | nodeId;
+        r.length = length * 4;
+        memcpy( r.data, data, r.length );
+        r.data[0] = 0x0C;
+        m_pending.insert( std::make_pair( getNsecs() + m_latency * 1000LL, r ) );
+        m_nb_requests++;
+        armTimer();
+        return true;
+    };
+    virtual int getFileDescriptor() {return m_timer_fd;};
+    virtual bool iterate() {
+        uint64_t expirations;
+        if (read( m_timer_fd, &expirations, sizeof(expirations) ) < 0 && errno != EAGAIN) {
+            return false;
+        }
+        uint64_t now = getNsecs();
+        while (!m_pending.empty() && m_pending.begin()->first <= now) {
+            Response r = m_pending.begin()->second;
+            m_pending.erase( m_pending.begin() );
+            m_engine->handleResponse( r.nodeId, r.data, r.length );
+        }
+        armTimer();
+        return true;
+    };
+
+    unsigned int getNbRequests() {return m_nb_requests;};
+
+private:
+    struct Response {
+        fb_nodeid_t nodeId;
+        size_t length;
+        unsigned char data[MAX_FCP_BLOCK_SIZE_BYTES];
+    };
+
+    static uint64_t getNsecs() {
+        struct timespec ts;
+        clock_gettime( CLOCK_MONOTONIC, &ts );
+        return (uint64_t)ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+    };
+    void armTimer() {
+        struct itimerspec its;
+        memset( &its, 0, sizeof(its) );
+        if (!m_pending.empty()) {
+            uint64_t due = m_pending.begin()->first;
+            its.it_value.tv_sec = due / 1000000000LLU;
+            its.it_value.tv_nsec = due % 1000000000LLU;
+        }
+        timerfd_settime( m_timer_fd, TFD_TIMER_ABSTIME, &its, NULL );
+    };
+
+    unsigned int m_latency;
+    int m_timer_fd;
+    FcpEngine* m_engine;
+    std::multimap< uint64_t, Response > m_pending;
+    unsigned int m_nb_requests;
+};
+
+struct mode_stats
+{
+    unsigned int commands;
+    unsigned int failures;
+    uint64_t total_latency;
+
+    void reset() {commands = 0; failures = 0; total_latency = 0;};
+    void add(FcpTransaction &t) {
+        if (t.getStatus() == FcpTransaction::eFS_Responded) {
+            commands++;
+            total_latency += t.getLatencyUsecs();
+        } else {
+            failures++;
+        }
+    };
+    void print(const char *name, double seconds) {
+        printf("  %-8s: %8u commands, %10.0f commands/s, avg latency %7.1f us, %u failures\n",
+               name, commands, commands / seconds,
+               commands ? (double)total_latency / commands : 0.0, failures);
+    };
+};
+
+static FcpEngine *engine;
+static struct arguments arguments;
+static volatile bool mode_running;
+
+static void
+setRequest(FcpTransaction &t, fb_nodeid_t node)
+{
+    // a STATUS command to the unit, opcode 0x02 (PLUG INFO)
+    unsigned char frame[8] = {0x01, 0xff, 0x02, 0x00, 0xff, 0xff, 0xff, 0xff};
+    t.setRequest( node, (fb_quadlet_t *)frame, 2 );
+}
+
+// --- serial
+
+static void
+runSerial(struct mode_stats &stats)
+{
+    FcpTransaction t;
+    unsigned int node = 0;
+    while (mode_running) {
+        setRequest( t, node );
+        engine->transact( t );
+        stats.add( t );
+        node = (node + 1) % arguments.nodes;
+    }
+}
+
+// --- threads
+
+struct thread_args
+{
+    fb_nodeid_t node;
+    struct mode_stats stats;
+};
+
+static void *
+node_thread(void *arg)
+{
+    struct thread_args *a = (struct thread_args *)arg;
+    FcpTransaction t;
+    while (mode_running) {
+        setRequest( t, a->node );
+        engine->transact( t );
+        a->stats.add( t );
+    }
+    return NULL;
+}
+
+static void
+runThreads(struct mode_stats &stats)
+{
+    std::vector<pthread_t> threads( arguments.nodes );
+    std::vector<struct thread_args> args( arguments.nodes );
+    for (unsigned int i = 0; i < arguments.nodes; i++) {
+        args[i].node = i;
+        args[i].stats.reset();
+        pthread_create( &threads[i], NULL, node_thread, &args[i] );
+    }
+    while (mode_running) {
+        Util::SystemTimeSource::SleepUsecRelative( 10000 );
+    }
+    for (unsigned int i = 0; i < arguments.nodes; i++) {
+        pthread_join( threads[i], NULL );
+        stats.commands += args[i].stats.commands;
+        stats.failures += args[i].stats.failures;
+        stats.total_latency += args[i].stats.total_latency;
+    }
+}
+
+// --- async
+
+class Resubmitter : public Util::Functor
+{
+public:
+    Resubmitter( fb_nodeid_t node, struct mode_stats &stats )
+        : m_node( node ), m_stats( stats ), m_done( false )
+    {
+        m_transaction.setCallback( this );
+    };
+    void start() {
+        setRequest( m_transaction, m_node );
+        engine->submit( m_transaction );
+    };
+    // called from the engine thread
+    virtual void operator() () {
+        m_stats.add( m_transaction );
+        if (mode_running) {
+            start();
+        } else {
+            m_done = true;
+        }
+    };
+    virtual bool matchCallee(void *) {return false;};
+
+    FcpTransaction m_transaction;
+    fb_nodeid_t m_node;
+    struct mode_stats &m_stats;
+    volatile bool m_done;
+};
+
+static void
+runAsync(struct mode_stats &stats)
+{
+    std::vector<Resubmitter *> r;
+    for (unsigned int i = 0; i < arguments.nodes; i++) {
+        r.push_back( new Resubmitter( i, stats ) );
+    }
+    for (unsigned int i = 0; i < arguments.nodes; i++) {
+        r[i]->start();
+    }
+    while (mode_running) {
+        Util::SystemTimeSource::SleepUsecRelative( 10000 );
+    }
+    // the callbacks only touch the stats from the engine thread
+    for (unsigned int i = 0; i < arguments.nodes; i++) {
+        while (!r[i]->m_done) {
+            Util::SystemTimeSource::SleepUsecRelative( 1000 );
+        }
+        delete r[i];
+    }
+}
+
+static void *
+mode_timer(void *arg)
+{
+    for (unsigned int i = 0; run && i < arguments.seconds * 100; i++) {
+        Util::SystemTimeSource::SleepUsecRelative( 10000 );
+    }
+    mode_running = false;
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    // Default values.
+    arguments.verbose = 0;
+    arguments.nodes   = 4;
+    arguments.latency = 500;
+    arguments.seconds = 3;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+    if (arguments.nodes < 1 || arguments.nodes > TEST_MAX_NODES) {
+        fprintf( stderr, "Invalid number of nodes\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    run=1;
+
+    signal (SIGINT, sighandler);
+    signal (SIGPIPE, sighandler);
+
+    FakeResponder *responder = new FakeResponder( arguments.latency );
+    engine = new FcpEngine( responder );
+    engine->setVerboseLevel( arguments.verbose );
+    if (!engine->start()) {
+        fprintf( stderr, "Could not start the FCP engine\n" );
+        exit(1);
+    }
+
+    printf("FCP engine: %u nodes, %u us response latency, %us per mode\n",
+           arguments.nodes, arguments.latency, arguments.seconds);
+
+    const char *names[] = {"serial", "threads", "async"};
+    for (int mode = 0; run && mode < 3; mode++) {
+        struct mode_stats stats;
+        stats.reset();
+        mode_running = true;
+
+        // the modes run until the timer thread clears mode_running
+        struct timespec start, end;
+        clock_gettime( CLOCK_MONOTONIC, &start );
+        pthread_t timer;
+        pthread_create( &timer, NULL, mode_timer, NULL );
+        switch (mode) {
+            case 0: runSerial( stats ); break;
+            case 1: runThreads( stats ); break;
+            case 2: runAsync( stats ); break;
+        }
+        pthread_join( timer, NULL );
+        clock_gettime( CLOCK_MONOTONIC, &end );
+        double seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+        stats.print( names[mode], seconds );
+    }
+
+    printf("  %-8s: %u transactions, %u retries, %u failures\n", "engine",
+           engine->getNbTransactions(), engine->getNbRetries(), engine->getNbFailures());
+
+    engine->stop();
+    delete engine;
+
+    return EXIT_SUCCESS;
+}
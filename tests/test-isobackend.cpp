@@ -0,0 +1,378 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/*
+ * Test/benchmark for the ISO backends, using the fake backend.
+ *
+ * A receive context produces packets that carry their cycle number, the
+ * client checks that every packet arrives, in order, with the right
+ * payload. A transmit context does the same in the other direction. The
+ * client defers now and then to exercise the retry path. Reports the
+ * number of packets per second the backend interface can move.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <signal.h>
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/libieee1394/FakeIsoBackend.h"
+#include "src/libieee1394/cycletimer.h"
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+#define TEST_CHANNEL            3
+
+volatile int run;
+// Program documentation.
+static char doc[] = "FFADO -- ISO backend test/benchmark\n\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int packets;
+    unsigned int buf_packets;
+    unsigned int max_packet_size;
+    unsigned int irq_interval;
+    unsigned int defer_every;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"packets",     'n',    "n",    0,  "Number of packets per direction (8000000)" },
+    {"buffer",      'b',    "n",    0,  "Buffer size (in packets) (400)" },
+    {"packetsize",  's',    "n",    0,  "Max packet size (in bytes) (1024)" },
+    {"irq",         'i',    "n",    0,  "IRQ interval (in packets) (16)" },
+    {"defer",       'd',    "n",    0,  "Defer once every n packets, 0 = never (1000)" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 'n':
+            arguments->packets = strtol( arg, &tail, 0 );
+            break;
+        case 'b':
+            arguments->buf_packets = strtol( arg, &tail, 0 );
+            break;
+        case 's':
+            arguments->max_packet_size = strtol( arg, &tail, 0 );
+            break;
+        case 'i':
+            arguments->irq_interval = strtol( arg, &tail, 0 );
+            break;
+        case 'd':
+            arguments->defer_every = strtol( arg, &tail, 0 );
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static void sighandler (int sig)
+{
+        run = 0;
+}
+
+static inline uint64_t
+getNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+// the payload of a packet: its cycle number, followed by a pattern
+static unsigned int
+packetLength(unsigned int cycle, unsigned int max_length)
+{
+    // a mix of empty, small and max size packets
+    switch (cycle % 4) {
+        case 0: return 0;
+        case 1: return 8;
+        default: return max_length & ~3;
+    }
+}
+
+static void
+fillPacket(unsigned char *data, unsigned int length, unsigned int cycle)
+{
+    for (unsigned int i = 0; i < length / 4; i++) {
+        ((uint32_t *)data)[i] = cycle + i;
+    }
+}
+
+static bool
+checkPacket(unsigned char *data, unsigned int length, unsigned int cycle)
+{
+    for (unsigned int i = 0; i < length / 4; i++) {
+        if (((uint32_t *)data)[i] != cycle + i) return false;
+    }
+    return true;
+}
+
+class TestFakeIsoBackend : public FakeIsoBackend
+{
+public:
+    TestFakeIsoBackend(Client &client)
+        : FakeIsoBackend(client, 0)
+        , m_max_length( 0 )
+        , m_errors( 0 )
+        , m_next_cycle( -1 )
+    {};
+
+    unsigned int m_max_length;
+    unsigned int m_errors;
+    int m_next_cycle;
+
+protected:
+    unsigned int generatePacket(unsigned char *data, unsigned int max_length,
+                                unsigned int cycle,
+                                unsigned char *tag, unsigned char *sy)
+    {
+        unsigned int length = packetLength(cycle, m_max_length);
+        fillPacket(data, length, cycle);
+        *tag = 1;
+        *sy = 0;
+        return length;
+    };
+    void consumePacket(unsigned char *data, unsigned int length,
+                       unsigned char tag, unsigned char sy,
+                       unsigned int cycle)
+    {
+        if (m_next_cycle >= 0 && (int)cycle != m_next_cycle) {
+            debugError("transmit: got cycle %u, expected %d\n", cycle, m_next_cycle);
+            m_errors++;
+        }
+        m_next_cycle = (cycle + 1) % CYCLES_PER_SECOND;
+        if (length != packetLength(cycle, m_max_length)
+            || !checkPacket(data, length, cycle)) {
+            debugError("transmit: bad packet on cycle %u (length %u)\n", cycle, length);
+            m_errors++;
+        }
+    };
+};
+
+class TestClient : public IsoBackend::Client
+{
+public:
+    TestClient(unsigned int max_length, unsigned int defer_every)
+        : m_max_length( max_length )
+        , m_defer_every( defer_every )
+        , m_calls( 0 )
+        , m_packets( 0 )
+        , m_errors( 0 )
+        , m_next_cycle( -1 )
+    {};
+
+    enum raw1394_iso_disposition
+    putPacket(unsigned char *data, unsigned int length,
+              unsigned char channel, unsigned char tag, unsigned char sy,
+              unsigned int cycle, unsigned int dropped)
+    {
+        if (defer()) return RAW1394_ISO_DEFER;
+        if (m_next_cycle >= 0 && (int)cycle != m_next_cycle) {
+            debugError("receive: got cycle %u, expected %d\n", cycle, m_next_cycle);
+            m_errors++;
+        }
+        m_next_cycle = (cycle + 1) % CYCLES_PER_SECOND;
+        if (channel != TEST_CHANNEL || tag != 1 || dropped
+            || length != packetLength(cycle, m_max_length)
+            || !checkPacket(data, length, cycle)) {
+            debugError("receive: bad packet on cycle %u (length %u)\n", cycle, length);
+            m_errors++;
+        }
+        m_packets++;
+        return RAW1394_ISO_OK;
+    };
+
+    enum raw1394_iso_disposition
+    getPacket(unsigned char *data, unsigned int *length,
+              unsigned char *tag, unsigned char *sy,
+              int cycle, unsigned int dropped, unsigned int skipped)
+    {
+        if (defer()) return RAW1394_ISO_DEFER;
+        if (cycle < 0 || dropped || skipped) {
+            debugError("transmit: unexpected cycle %d, dropped %u, skipped %u\n",
+                       cycle, dropped, skipped);
+            m_errors++;
+            cycle = 0;
+        }
+        *length = packetLength(cycle, m_max_length);
+        fillPacket(data, *length, cycle);
+        *tag = 1;
+        *sy = 0;
+        m_packets++;
+        return RAW1394_ISO_OK;
+    };
+
+    unsigned int m_max_length;
+    unsigned int m_defer_every;
+    uint64_t m_calls;
+    uint64_t m_packets;
+    unsigned int m_errors;
+    int m_next_cycle;
+
+private:
+    bool defer() {
+        return m_defer_every && (++m_calls % m_defer_every) == 0;
+    };
+};
+
+static bool
+runTest(bool receive, struct arguments *arguments)
+{
+    TestClient client(arguments->max_packet_size, arguments->defer_every);
+    TestFakeIsoBackend backend(client);
+    backend.setVerboseLevel(arguments->verbose);
+    backend.m_max_length = arguments->max_packet_size;
+    backend.setFreeRunning(false);
+
+    if (!backend.open()) {
+        fprintf( stderr, "Could not open backend\n" );
+        return false;
+    }
+    bool ok;
+    if (receive) {
+        ok = backend.initReceive(arguments->buf_packets, arguments->max_packet_size,
+                                 TEST_CHANNEL, RAW1394_DMA_PACKET_PER_BUFFER,
+                                 arguments->irq_interval);
+    } else {
+        ok = backend.initTransmit(arguments->buf_packets, arguments->max_packet_size,
+                                  TEST_CHANNEL, RAW1394_ISO_SPEED_400,
+                                  arguments->irq_interval);
+    }
+    if (!ok || !backend.start(7990)) {
+        fprintf( stderr, "Could not start backend\n" );
+        return false;
+    }
+
+    uint64_t start = getNsecs();
+    uint64_t iterations = 0;
+    while (run && backend.getPacketCount() < arguments->packets) {
+        // one interrupt worth of packets per iterate, like the kernel does
+        backend.addCycles(arguments->irq_interval);
+        if (!backend.iterate()) {
+            fprintf( stderr, "Iterate failed\n" );
+            return false;
+        }
+        iterations++;
+    }
+    uint64_t elapsed = getNsecs() - start;
+    backend.close();
+
+    unsigned int errors = client.m_errors + backend.m_errors;
+    if (backend.getPacketCount() != client.m_packets) {
+        fprintf( stderr, "Backend saw %"PRIu64" packets, client %"PRIu64"\n",
+                 backend.getPacketCount(), client.m_packets);
+        errors++;
+    }
+    if (backend.getDroppedCount()) {
+        fprintf( stderr, "%"PRIu64" packets dropped\n", backend.getDroppedCount());
+        errors++;
+    }
+
+    printf("  %-10s: %10"PRIu64" packets, %6.1f MB, %u defers, %10.0f packets/s, %6.1f ns/packet: %s\n",
+           (receive ? "receive" : "transmit"),
+           backend.getPacketCount(), backend.getByteCount() / 1e6,
+           backend.getDeferCount(),
+           backend.getPacketCount() / (elapsed / 1e9),
+           (double)elapsed / backend.getPacketCount(),
+           (errors ? "FAILED" : "OK"));
+    return errors == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.verbose           = 0;
+    arguments.packets           = 8000000;
+    arguments.buf_packets       = 400;
+    arguments.max_packet_size   = 1024;
+    arguments.irq_interval      = 16;
+    arguments.defer_every       = 1000;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+    if (arguments.irq_interval == 0 || arguments.irq_interval > arguments.buf_packets) {
+        fprintf( stderr, "The IRQ interval should be between 1 and the buffer size\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    run=1;
+
+    signal (SIGINT, sighandler);
+    signal (SIGPIPE, sighandler);
+
+    printf("ISO backend test: %u packets, buffer %u, max packet size %u, irq %u\n",
+           arguments.packets, arguments.buf_packets,
+           arguments.max_packet_size, arguments.irq_interval);
+
+    bool ok = runTest(true, &arguments);
+    ok &= runTest(false, &arguments);
+
+    return (ok ? EXIT_SUCCESS : EXIT_FAILURE);
+}
@@ -0,0 +1,594 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+/*
+ * Test for the simulated bus, using the loopback ISO backend.
+ *
+ * A transmit context sends packets that carry their cycle number, a
+ * receive context on the same channel checks that every packet arrives on
+ * the cycle it was sent on, with the right payload. Runs in real time on
+ * the cycle timer of the simulated bus, which wraps during the test.
+ * Reports the packets that were lost on the bus and the ones that went
+ * missing otherwise.
+ *
+ * Then runs an ffado_streaming session end-to-end on the simulated bus,
+ * with the simulated bounce device that echoes the playback streams on
+ * the capture streams, and checks that the playback levels come back on
+ * the capture channels.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <poll.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <signal.h>
+#include "libffado/ffado.h"
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/libieee1394/LoopbackIsoBackend.h"
+#include "src/libieee1394/SimulatedBus.h"
+#include "src/libieee1394/cycletimer.h"
+#include "src/libutil/SystemTimeSource.h"
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+#define TEST_CHANNEL            5
+
+#define STREAMING_SAMPLE_RATE   44100
+#define STREAMING_PERIOD        512
+#define STREAMING_NB_BUFFERS    3
+
+volatile int run;
+// Program documentation.
+static char doc[] = "FFADO -- simulated bus loopback test\n\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int seconds;
+    unsigned int buf_packets;
+    unsigned int max_packet_size;
+    unsigned int irq_interval;
+    float drift_ppm;
+    unsigned int jitter_usecs;
+    unsigned int loss_ppm;
+    unsigned int streaming_seconds;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"time",        't',    "n",    0,  "Test duration (in seconds) (8)" },
+    {"buffer",      'b',    "n",    0,  "Buffer size (in packets) (128)" },
+    {"packetsize",  's',    "n",    0,  "Max packet size (in bytes) (512)" },
+    {"irq",         'i',    "n",    0,  "IRQ interval (in packets) (16)" },
+    {"drift",       'd',    "ppm",  0,  "Drift of the bus cycle timer (in ppm) (0)" },
+    {"jitter",      'j',    "usecs",0,  "Receive jitter (in usecs) (0)" },
+    {"loss",        'l',    "ppm",  0,  "Packet loss probability (in ppm) (0)" },
+    {"streaming",   'S',    "n",    0,  "ffado_streaming session duration (in seconds), 0 to skip (4)" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 't':
+            arguments->seconds = strtol( arg, &tail, 0 );
+            break;
+        case 'b':
+            arguments->buf_packets = strtol( arg, &tail, 0 );
+            break;
+        case 's':
+            arguments->max_packet_size = strtol( arg, &tail, 0 );
+            break;
+        case 'i':
+            arguments->irq_interval = strtol( arg, &tail, 0 );
+            break;
+        case 'd':
+            arguments->drift_ppm = strtof( arg, &tail );
+            break;
+        case 'j':
+            arguments->jitter_usecs = strtol( arg, &tail, 0 );
+            break;
+        case 'l':
+            arguments->loss_ppm = strtol( arg, &tail, 0 );
+            break;
+        case 'S':
+            arguments->streaming_seconds = strtol( arg, &tail, 0 );
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static void sighandler (int sig)
+{
+        run = 0;
+}
+
+// the payload of a packet: its cycle number, followed by a pattern
+static unsigned int
+packetLength(unsigned int cycle, unsigned int max_length)
+{
+    // a mix of empty, small and max size packets
+    switch (cycle % 4) {
+        case 0: return 0;
+        case 1: return 8;
+        default: return max_length & ~3;
+    }
+}
+
+class TestClient : public IsoBackend::Client
+{
+public:
+    TestClient(unsigned int max_length)
+        : m_max_length( max_length )
+        , m_packets( 0 )
+        , m_cycle_errors( 0 )
+        , m_data_errors( 0 )
+        , m_dropped( 0 )
+    {};
+
+    enum raw1394_iso_disposition
+    putPacket(unsigned char *data, unsigned int length,
+              unsigned char channel, unsigned char tag, unsigned char sy,
+              unsigned int cycle, unsigned int dropped)
+    {
+        m_dropped += dropped;
+        if (length < 4) {
+            // empty packets carry no cycle, check the length only
+            if (length != packetLength(cycle, m_max_length)) {
+                debugError("receive: bad empty packet on cycle %u\n", cycle);
+                m_data_errors++;
+            }
+            m_packets++;
+            return RAW1394_ISO_OK;
+        }
+        uint32_t *quadlets = (uint32_t *)data;
+        unsigned int sent_cycle = quadlets[0];
+        if (sent_cycle != cycle) {
+            debugError("receive: packet of cycle %u received on cycle %u\n",
+                       sent_cycle, cycle);
+            m_cycle_errors++;
+        }
+        bool ok = (channel == TEST_CHANNEL && tag == 1 && sy == (sent_cycle & 0xF)
+                   && length == packetLength(sent_cycle, m_max_length));
+        for (unsigned int i = 1; ok && i < length / 4; i++) {
+            ok = (quadlets[i] == sent_cycle + i);
+        }
+        if (!ok) {
+            debugError("receive: bad packet on cycle %u (length %u)\n", cycle, length);
+            m_data_errors++;
+        }
+        m_packets++;
+        return RAW1394_ISO_OK;
+    };
+
+    enum raw1394_iso_disposition
+    getPacket(unsigned char *data, unsigned int *length,
+              unsigned char *tag, unsigned char *sy,
+              int cycle, unsigned int dropped, unsigned int skipped)
+    {
+        m_dropped += dropped;
+        if (cycle < 0) {
+            debugError("transmit: unknown cycle\n");
+            m_cycle_errors++;
+            cycle = 0;
+        }
+        *length = packetLength(cycle, m_max_length);
+        uint32_t *quadlets = (uint32_t *)data;
+        for (unsigned int i = 0; i < *length / 4; i++) {
+            quadlets[i] = cycle + i;
+        }
+        *tag = 1;
+        *sy = cycle & 0xF;
+        m_packets++;
+        return RAW1394_ISO_OK;
+    };
+
+    unsigned int m_max_length;
+    uint64_t m_packets;
+    unsigned int m_cycle_errors;
+    unsigned int m_data_errors;
+    uint64_t m_dropped;
+};
+
+// the level that is played back on an audio channel
+static float
+channelLevel(int channel)
+{
+    return 0.1 * ((channel % 8) + 1);
+}
+
+/**
+ * Makes $HOME/.ffado/configuration run the device manager on one
+ * simulated port, with the bus settings of the test. The device
+ * definition of the bounce device is repeated, the system wide
+ * configuration might not be installed.
+ */
+static bool
+writeConfiguration(const char *home, struct arguments &arguments)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/.ffado", home);
+    if (mkdir(path, 0700) < 0) {
+        fprintf( stderr, "Could not create %s: %s\n", path, strerror(errno) );
+        return false;
+    }
+    snprintf(path, sizeof(path), "%s/.ffado/configuration", home);
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        fprintf( stderr, "Could not create %s: %s\n", path, strerror(errno) );
+        return false;
+    }
+    fprintf(f, "ieee1394 = {\n"
+               "    simulated_bus = 1;\n"
+               "    simulated_bus_bounce_devices = 1;\n"
+               "    simulated_bus_drift_ppm = %f;\n"
+               "    simulated_bus_jitter_usecs = %u;\n"
+               "    simulated_bus_loss_ppm = %u;\n"
+               "};\n"
+               "device_definitions = (\n"
+               "{\n"
+               "    vendorid    = 0x000B0001;\n"
+               "    modelid     = 0x000B0001;\n"
+               "    vendorname  = \"FFADO Server\";\n"
+               "    modelname   = \"ffado-server\";\n"
+               "    driver      = \"BOUNCE\";\n"
+               "}\n"
+               ");\n",
+            arguments.drift_ppm, arguments.jitter_usecs, arguments.loss_ppm);
+    return (fclose(f) == 0);
+}
+
+static void
+removeConfiguration(const char *home)
+{
+    char path[256];
+    snprintf(path, sizeof(path), "%s/.ffado/configuration", home);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/.ffado", home);
+    rmdir(path);
+    rmdir(home);
+}
+
+/**
+ * Runs an ffado_streaming session on the simulated bus
+ * @return the number of errors
+ */
+static unsigned int
+runStreaming(struct arguments &arguments)
+{
+    char home[] = "/tmp/test-loopback-XXXXXX";
+    if (mkdtemp(home) == NULL) {
+        fprintf( stderr, "Could not create a temporary directory: %s\n", strerror(errno) );
+        return 1;
+    }
+    if (!writeConfiguration(home, arguments)) {
+        removeConfiguration(home);
+        return 1;
+    }
+    char *old_home = getenv("HOME");
+    if (old_home) {
+        old_home = strdup(old_home);
+    }
+    setenv("HOME", home, 1);
+
+    printf("Streaming test: %u s, %d Hz, period %d, %d buffers\n",
+           arguments.streaming_seconds, STREAMING_SAMPLE_RATE,
+           STREAMING_PERIOD, STREAMING_NB_BUFFERS);
+
+    ffado_device_info_t device_info;
+    memset(&device_info, 0, sizeof(ffado_device_info_t));
+    ffado_options_t dev_options;
+    memset(&dev_options, 0, sizeof(ffado_options_t));
+    dev_options.sample_rate = STREAMING_SAMPLE_RATE;
+    dev_options.period_size = STREAMING_PERIOD;
+    dev_options.nb_buffers = STREAMING_NB_BUFFERS;
+    dev_options.verbose = arguments.verbose;
+
+    unsigned int errors = 0;
+    ffado_device_t *dev = ffado_streaming_init(device_info, dev_options);
+    if (dev == NULL) {
+        fprintf( stderr, "Could not init the streaming on the simulated bus\n" );
+        errors++;
+    }
+
+    int nb_in_channels = 0, nb_out_channels = 0;
+    float **in_buffers = NULL, **out_buffers = NULL;
+    if (dev) {
+        ffado_streaming_set_audio_datatype(dev, ffado_audio_datatype_float);
+        nb_in_channels = ffado_streaming_get_nb_capture_streams(dev);
+        nb_out_channels = ffado_streaming_get_nb_playback_streams(dev);
+        in_buffers = (float **)calloc(nb_in_channels, sizeof(float *));
+        out_buffers = (float **)calloc(nb_out_channels, sizeof(float *));
+        // all buffers are assigned, the midi streams need one too
+        for (int i = 0; i < nb_in_channels; i++) {
+            in_buffers[i] = (float *)calloc(STREAMING_PERIOD, sizeof(float));
+            ffado_streaming_set_capture_stream_buffer(dev, i, (char *)in_buffers[i]);
+            ffado_streaming_capture_stream_onoff(dev, i, 1);
+        }
+        for (int i = 0; i < nb_out_channels; i++) {
+            out_buffers[i] = (float *)calloc(STREAMING_PERIOD, sizeof(float));
+            ffado_streaming_set_playback_stream_buffer(dev, i, (char *)out_buffers[i]);
+            ffado_streaming_playback_stream_onoff(dev, i, 1);
+        }
+        if (nb_in_channels == 0 || nb_out_channels == 0) {
+            fprintf( stderr, "No streams on the simulated bus (%d capture, %d playback)\n",
+                     nb_in_channels, nb_out_channels );
+            errors++;
+        } else if (ffado_streaming_prepare(dev)) {
+            fprintf( stderr, "Could not prepare the streaming\n" );
+            errors++;
+        }
+    }
+
+    unsigned int nb_periods = 0, nb_xruns = 0, nb_echoed = 0;
+    if (dev && errors == 0 && ffado_streaming_start(dev)) {
+        fprintf( stderr, "Could not start the streaming\n" );
+        errors++;
+    } else if (dev && errors == 0) {
+        unsigned int max_periods = (uint64_t)arguments.streaming_seconds
+                                   * STREAMING_SAMPLE_RATE / STREAMING_PERIOD;
+        while (run && nb_periods < max_periods) {
+            ffado_wait_response response = ffado_streaming_wait(dev);
+            if (response == ffado_wait_xrun) {
+                nb_xruns++;
+                ffado_streaming_reset(dev);
+                continue;
+            } else if (response != ffado_wait_ok) {
+                fprintf( stderr, "Streaming failed\n" );
+                errors++;
+                break;
+            }
+            ffado_streaming_transfer_capture_buffers(dev);
+            // the period is echoed when the capture channels carry the
+            // levels of their playback channels
+            bool echoed = false;
+            for (int i = 0; i < nb_in_channels && i < nb_out_channels; i++) {
+                if (ffado_streaming_get_capture_stream_type(dev, i) != ffado_stream_type_audio
+                    || ffado_streaming_get_playback_stream_type(dev, i) != ffado_stream_type_audio) {
+                    continue;
+                }
+                echoed = (fabs(in_buffers[i][STREAMING_PERIOD - 1] - channelLevel(i)) < 0.001);
+                if (!echoed) {
+                    break;
+                }
+            }
+            if (echoed) {
+                nb_echoed++;
+            }
+            for (int i = 0; i < nb_out_channels; i++) {
+                if (ffado_streaming_get_playback_stream_type(dev, i) == ffado_stream_type_audio) {
+                    for (int j = 0; j < STREAMING_PERIOD; j++) {
+                        out_buffers[i][j] = channelLevel(i);
+                    }
+                } else {
+                    memset(out_buffers[i], 0, STREAMING_PERIOD * sizeof(float));
+                }
+            }
+            ffado_streaming_transfer_playback_buffers(dev);
+            nb_periods++;
+        }
+        ffado_streaming_stop(dev);
+        // the echo takes a few periods to come back and is lost on xruns,
+        // but most periods should have it
+        if (errors == 0 && nb_echoed < nb_periods / 2) {
+            fprintf( stderr, "The playback was not echoed on the capture streams\n" );
+            errors++;
+        }
+    }
+    if (dev) {
+        ffado_streaming_finish(dev);
+    }
+    for (int i = 0; i < nb_in_channels; i++) {
+        free(in_buffers[i]);
+    }
+    for (int i = 0; i < nb_out_channels; i++) {
+        free(out_buffers[i]);
+    }
+    free(in_buffers);
+    free(out_buffers);
+
+    if (old_home) {
+        setenv("HOME", old_home, 1);
+        free(old_home);
+    } else {
+        unsetenv("HOME");
+    }
+    removeConfiguration(home);
+
+    printf("  streams      : %10d capture, %d playback\n", nb_in_channels, nb_out_channels);
+    printf("  periods      : %10u\n", nb_periods);
+    printf("  echoed       : %10u periods\n", nb_echoed);
+    printf("  xruns        : %10u\n", nb_xruns);
+    printf("%s\n", (errors ? "FAILED" : "OK"));
+    return errors;
+}
+
+int main(int argc, char *argv[])
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.verbose           = 0;
+    arguments.seconds           = 8;
+    arguments.buf_packets       = 128;
+    arguments.max_packet_size   = 512;
+    arguments.irq_interval      = 16;
+    arguments.drift_ppm         = 0.0;
+    arguments.jitter_usecs      = 0;
+    arguments.loss_ppm          = 0;
+    arguments.streaming_seconds = 4;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+    if (arguments.irq_interval == 0 || arguments.irq_interval > arguments.buf_packets) {
+        fprintf( stderr, "The IRQ interval should be between 1 and the buffer size\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    run=1;
+
+    signal (SIGINT, sighandler);
+    signal (SIGPIPE, sighandler);
+
+    printf("Loopback test: %u s, buffer %u, max packet size %u, irq %u, "
+           "drift %.1f ppm, jitter %u us, loss %u ppm\n",
+           arguments.seconds, arguments.buf_packets, arguments.max_packet_size,
+           arguments.irq_interval, arguments.drift_ppm,
+           arguments.jitter_usecs, arguments.loss_ppm);
+
+    SimulatedBus &bus = SimulatedBus::get(0);
+    bus.setVerboseLevel(arguments.verbose);
+    bus.setDriftPpm(arguments.drift_ppm);
+    bus.setJitterUsecs(arguments.jitter_usecs);
+    bus.setLossPpm(arguments.loss_ppm);
+
+    TestClient rx_client(arguments.max_packet_size);
+    TestClient tx_client(arguments.max_packet_size);
+    LoopbackIsoBackend rx(rx_client, 0);
+    LoopbackIsoBackend tx(tx_client, 0);
+    rx.setVerboseLevel(arguments.verbose);
+    tx.setVerboseLevel(arguments.verbose);
+
+    if (!rx.open() || !tx.open()
+        || !rx.initReceive(arguments.buf_packets, arguments.max_packet_size,
+                           TEST_CHANNEL, RAW1394_DMA_PACKET_PER_BUFFER,
+                           arguments.irq_interval)
+        || !tx.initTransmit(arguments.buf_packets, arguments.max_packet_size,
+                            TEST_CHANNEL, RAW1394_ISO_SPEED_400,
+                            arguments.irq_interval)) {
+        fprintf( stderr, "Could not initialize the backends\n" );
+        exit(1);
+    }
+    // the receiver should see the first transmitted packet
+    unsigned int start_cycle = (bus.getCurrentCycleCount() + 100) % CYCLES_PER_SECOND;
+    if (!tx.start(start_cycle) || !rx.start(start_cycle)) {
+        fprintf( stderr, "Could not start the backends\n" );
+        exit(1);
+    }
+
+    struct pollfd fds[2];
+    fds[0].fd = rx.getFileDescriptor();
+    fds[1].fd = tx.getFileDescriptor();
+    fds[0].events = fds[1].events = POLLIN;
+
+    uint64_t end_cycle = bus.getCurrentCycleCount()
+                         + (uint64_t)arguments.seconds * CYCLES_PER_SECOND;
+    uint32_t first_ctr = bus.getCycleTimer(Util::SystemTimeSource::getCurrentTimeAsUsecs());
+    bool wrapped = false;
+    while (run && bus.getCurrentCycleCount() < end_cycle) {
+        if (poll(fds, 2, 100) < 0) {
+            if (errno == EINTR) continue;
+            fprintf( stderr, "poll failed: %s\n", strerror(errno) );
+            break;
+        }
+        // transmit first, such that the receiver sees the packets right away
+        if (!tx.iterate() || !rx.iterate()) {
+            fprintf( stderr, "Iterate failed\n" );
+            break;
+        }
+        uint32_t ctr = bus.getCycleTimer(Util::SystemTimeSource::getCurrentTimeAsUsecs());
+        if (CYCLE_TIMER_GET_SECS(ctr) < CYCLE_TIMER_GET_SECS(first_ctr)) {
+            wrapped = true;
+        }
+    }
+    tx.stop();
+    rx.stop();
+
+    // the packets that are still in flight are neither received nor lost
+    uint64_t in_flight = tx_client.m_packets - rx_client.m_packets - bus.getLostCount();
+    unsigned int errors = rx_client.m_cycle_errors + rx_client.m_data_errors
+                          + tx_client.m_cycle_errors;
+    // the receiver lags behind by at most a buffer plus the jitter. The
+    // cycles it dropped because it was not scheduled in time (an xrun) can
+    // have carried packets too.
+    uint64_t max_in_flight = 2 * arguments.buf_packets
+                             + arguments.jitter_usecs / USECS_PER_CYCLE + 2
+                             + rx_client.m_dropped;
+    if (tx_client.m_packets < rx_client.m_packets + bus.getLostCount()
+        || in_flight > max_in_flight) {
+        fprintf( stderr, "%"PRIu64" packets missing\n", in_flight);
+        errors++;
+    }
+
+    printf("  transmitted  : %10"PRIu64" packets\n", tx_client.m_packets);
+    printf("  received     : %10"PRIu64" packets\n", rx_client.m_packets);
+    printf("  lost         : %10"PRIu64" packets (%.1f ppm)\n", bus.getLostCount(),
+           (tx_client.m_packets ? 1e6 * bus.getLostCount() / tx_client.m_packets : 0.0));
+    printf("  in flight    : %10"PRIu64" packets\n", in_flight);
+    printf("  xrun drops   : %10"PRIu64" cycles\n", rx_client.m_dropped + tx_client.m_dropped);
+    printf("  cycle errors : %10u\n", rx_client.m_cycle_errors + tx_client.m_cycle_errors);
+    printf("  data errors  : %10u\n", rx_client.m_data_errors);
+    printf("  timer wrapped: %10s\n", (wrapped ? "yes" : "no"));
+    printf("%s\n", (errors ? "FAILED" : "OK"));
+
+    rx.close();
+    tx.close();
+
+    if (run && arguments.streaming_seconds) {
+        errors += runStreaming(arguments);
+    }
+    return (errors ? EXIT_FAILURE : EXIT_SUCCESS);
+}
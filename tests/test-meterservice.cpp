@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Meter bridge client of the meter service.
+ *
+ * Maps the meter segment published by a process that runs the meter
+ * service (e.g. ffado-dbus-server --meters) and prints the meters of
+ * all devices periodically. Does not touch the bus.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+
+#include <signal.h>
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/meterservice.h"
+#include "libutil/SystemTimeSource.h"
+
+using namespace Util;
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+volatile int run;
+// Program documentation.
+static char doc[] = "FFADO -- Meter service client\n\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int interval;
+    unsigned int count;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"interval",    'i',    "n",    0,  "Print interval (in ms) (200)" },
+    {"count",       'c',    "n",    0,  "Number of updates to print, 0 is forever (0)" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 'i':
+            arguments->interval = strtol( arg, &tail, 0 );
+            break;
+        case 'c':
+            arguments->count = strtol( arg, &tail, 0 );
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static void sighandler (int sig)
+{
+        run = 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.verbose  = 0;
+    arguments.interval = 200;
+    arguments.count    = 0;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    run=1;
+
+    signal (SIGINT, sighandler);
+    signal (SIGPIPE, sighandler);
+
+    MeterReader reader;
+    if (!reader.open()) {
+        fprintf( stderr, "No meter service running\n" );
+        exit(1);
+    }
+
+    float values[METERSERVICE_MAX_METERS];
+    uint64_t last_ts[METERSERVICE_MAX_DEVICES];
+    memset(last_ts, 0, sizeof(last_ts));
+
+    for (unsigned int n = 0; run && (arguments.count == 0 || n < arguments.count); n++) {
+        for (unsigned int dev = 0; dev < reader.getNbDevices(); dev++) {
+            uint64_t ts;
+            unsigned int nb = reader.readValues(dev, values, METERSERVICE_MAX_METERS, &ts);
+            if (nb == 0 || ts == last_ts[dev]) {
+                // no (new) values
+                continue;
+            }
+            last_ts[dev] = ts;
+            printf("%016"PRIX64" @ %"PRIu64":\n", reader.getDeviceGuid(dev), ts);
+            for (unsigned int i = 0; i < nb; i++) {
+                float db = (values[i] > 0.0 ? 20.0 * log10(values[i]) : -INFINITY);
+                printf("  %-20s %6.1f dB\n", reader.getMeterName(dev, i).c_str(), db);
+            }
+        }
+        SystemTimeSource::SleepUsecRelative(arguments.interval * 1000);
+    }
+
+    reader.close();
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,320 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Accuracy/throughput benchmark for the TimestampedBuffer timestamp state.
+ *
+ * Simulates a receive stream of a device whose sample clock deviates from
+ * the nominal rate by a given number of ppm, for a given number of hours,
+ * as fast as possible. The exact time of every frame is tracked with integer
+ * (rational) arithmetic, and the head timestamp the buffer reports for each
+ * period is compared against it.
+ *
+ * The timestamp representation is selected at build time (the
+ * FIXED_POINT_TIMESTAMPS option), run this from both builds to compare.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <math.h>
+
+#include <signal.h>
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/libieee1394/cycletimer.h"
+#include "src/libutil/TimestampedBuffer.h"
+
+using namespace Util;
+
+class TimestampedBufferTestClient
+    : public TimestampedBufferClient {
+public:
+    bool processReadBlock(char *data, unsigned int nevents, unsigned int offset) {return true;};
+    bool processWriteBlock(char *data, unsigned int nevents, unsigned int offset) {return true;};
+
+    void setVerboseLevel(int l) {setDebugLevel(l);};
+private:
+    DECLARE_DEBUG_MODULE;
+};
+
+IMPL_DEBUG_MODULE( TimestampedBufferTestClient, TimestampedBufferTestClient, DEBUG_LEVEL_VERBOSE );
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+// the cycle timer wraps at 128 seconds
+#define TEST_WRAP_AT         (128LL * TICKS_PER_SECOND)
+
+volatile int run;
+// Program documentation.
+static char doc[] = "FFADO -- Timestamped buffer accuracy benchmark\n\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int hours;
+    int ppm;
+    unsigned int samplerate;
+    unsigned int frames_per_packet;
+    unsigned int period;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"hours",       'H',    "n",    0,  "Simulated run time (in hours) (72)" },
+    {"ppm",         'p',    "n",    0,  "Device clock deviation (in ppm) (30)" },
+    {"samplerate",  'r',    "n",    0,  "Nominal sample rate (48000)" },
+    {"fpp",         'f',    "n",    0,  "Frames per packet (8)" },
+    {"period",      'P',    "n",    0,  "Client period (in frames) (256)" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 'H':
+            arguments->hours = strtol( arg, &tail, 0 );
+            break;
+        case 'p':
+            arguments->ppm = strtol( arg, &tail, 0 );
+            break;
+        case 'r':
+            arguments->samplerate = strtol( arg, &tail, 0 );
+            break;
+        case 'f':
+            arguments->frames_per_packet = strtol( arg, &tail, 0 );
+            break;
+        case 'P':
+            arguments->period = strtol( arg, &tail, 0 );
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static void sighandler (int sig)
+{
+        run = 0;
+}
+
+static inline uint64_t
+getNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+/**
+ * Exact time of a frame position, as an integer number of ticks
+ * plus a remainder (in 1/den ticks).
+ */
+struct exact_time
+{
+    uint64_t ticks;
+    uint64_t rem;
+    uint64_t den;
+
+    void advance(uint64_t num) {
+        rem += num;
+        ticks += rem / den;
+        rem %= den;
+    };
+    double fraction() {return (double)rem / (double)den;};
+};
+
+struct error_stats
+{
+    double max_abs;
+    double sum_sq;
+    uint64_t count;
+
+    void reset() {max_abs = 0.0; sum_sq = 0.0; count = 0;};
+    void add(double err) {
+        if (fabs(err) > max_abs) max_abs = fabs(err);
+        sum_sq += err * err;
+        count++;
+    };
+    double rms() {return count ? sqrt(sum_sq / count) : 0.0;};
+};
+
+int main(int argc, char *argv[])
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.verbose           = 0;
+    arguments.hours             = 72;
+    arguments.ppm               = 30;
+    arguments.samplerate        = 48000;
+    arguments.frames_per_packet = 8;
+    arguments.period            = 256;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    run=1;
+
+    signal (SIGINT, sighandler);
+    signal (SIGPIPE, sighandler);
+
+    unsigned int fpp = arguments.frames_per_packet;
+    unsigned int period = arguments.period;
+    float nominal_rate = (float)TICKS_PER_SECOND / arguments.samplerate;
+
+    TimestampedBufferTestClient *c = new TimestampedBufferTestClient();
+    c->setVerboseLevel(arguments.verbose);
+
+    TimestampedBuffer *t = new TimestampedBuffer(c);
+    t->setVerboseLevel(arguments.verbose);
+
+    // Setup the buffer like a receive stream processor does
+    t->setBufferSize(4 * period);
+    t->setEventSize(sizeof(int));
+    t->setEventsPerFrame(1);
+    t->setUpdatePeriod(fpp);
+    t->setNominalRate(nominal_rate);
+    t->setWrapValue(TEST_WRAP_AT);
+    t->setBandwidth(STREAMPROCESSOR_DLL_BW_HZ / (double)TICKS_PER_SECOND);
+    if (!t->prepare()) {
+        fprintf( stderr, "Could not prepare buffer\n" );
+        exit(1);
+    }
+    t->setTransparent(false);
+
+    // ticks per frame = TICKS_PER_SECOND / (samplerate * (1 + ppm/1e6))
+    //                 = (TICKS_PER_SECOND * 1e6) / (samplerate * (1e6 + ppm))
+    uint64_t num = (uint64_t)TICKS_PER_SECOND * 1000000LLU;
+    uint64_t den = (uint64_t)arguments.samplerate * (1000000LL + arguments.ppm);
+
+    struct exact_time tail_time = {0, 0, den};
+    struct exact_time head_time = {0, 0, den};
+
+    uint64_t packets_per_hour = 3600LLU * arguments.samplerate / fpp;
+    uint64_t total_packets = arguments.hours * packets_per_hour;
+
+    const double wrap_at = (double)TEST_WRAP_AT;
+    char packet[fpp * sizeof(int)];
+    memset(packet, 0, sizeof(packet));
+
+    printf("TimestampedBuffer accuracy: %s timestamps, %u Hz %+d ppm, %u hours (%"PRIu64" packets)\n",
+           (FIXED_POINT_TIMESTAMPS ? "fixed-point" : "double"),
+           arguments.samplerate, arguments.ppm, arguments.hours, total_packets);
+
+    t->setBufferTailTimestamp(0);
+
+    struct error_stats hour_stats, total_stats;
+    hour_stats.reset();
+    total_stats.reset();
+    double first_hour_rms = 0.0, last_hour_rms = 0.0;
+
+    uint64_t start = getNsecs();
+    uint64_t p;
+    for (p = 1; run && p <= total_packets; p++) {
+        tail_time.advance(fpp * num);
+        t->writeFrames(fpp, packet, (ffado_timestamp_t)(tail_time.ticks % TEST_WRAP_AT));
+
+        if (t->getFrameCounter() >= (signed int)(2 * period)) {
+            ffado_timestamp_t ts;
+            signed int fc;
+            t->getBufferHeadTimestamp(&ts, &fc);
+
+            double expected = (double)(head_time.ticks % TEST_WRAP_AT) + head_time.fraction();
+            double err = (double)ts - expected;
+            if (err > wrap_at / 2) {
+                err -= wrap_at;
+            } else if (err < -wrap_at / 2) {
+                err += wrap_at;
+            }
+            hour_stats.add(err);
+            total_stats.add(err);
+
+            t->dropFrames(period);
+            head_time.advance(period * num);
+        }
+
+        if (p % packets_per_hour == 0) {
+            unsigned int hour = p / packets_per_hour;
+            if (hour == 1) {
+                first_hour_rms = hour_stats.rms();
+            }
+            last_hour_rms = hour_stats.rms();
+            if (arguments.verbose || hour % 24 == 0) {
+                printf("  hour %4u: max |err| %8.3f ticks, rms %8.3f ticks, rate %12.6f ticks/frame\n",
+                       hour, hour_stats.max_abs, hour_stats.rms(), t->getRate());
+            }
+            hour_stats.reset();
+        }
+    }
+    uint64_t elapsed = getNsecs() - start;
+
+    printf("  %-28s: %"PRIu64"\n", "packets", p - 1);
+    printf("  %-28s: %.1f\n", "ns/packet", (double)elapsed / (p - 1));
+    printf("  %-28s: %.3f ticks\n", "max |err|", total_stats.max_abs);
+    printf("  %-28s: %.3f ticks\n", "rms err", total_stats.rms());
+    printf("  %-28s: %.3f ticks\n", "rms err first hour", first_hour_rms);
+    printf("  %-28s: %.3f ticks\n", "rms err last hour", last_hour_rms);
+    printf("  %-28s: %.6f (exact %.6f)\n", "rate", t->getRate(), (double)num / den);
+
+    delete t;
+    delete c;
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2005-2008 by Pieter Palmers
+ *
+ * This file is part of FFADO
+ * FFADO = Free Firewire (pro-)audio drivers for linux
+ *
+ * FFADO is based upon FreeBoB.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 2 of the License, or
+ * (at your option) version 3 of the License.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+/*
+ * Contention benchmark for the TimestampedBuffer state.
+ *
+ * Simulates a receive stream: an 'iso' thread writes one packet worth of
+ * frames every 125us (or as fast as possible when unpaced), while a 'client'
+ * thread polls the head timestamp and consumes the buffer one period at a
+ * time. Reports the cost of the writer side operations, the reader side
+ * operations and the number of reader retries.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <argp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sched.h>
+
+#include <signal.h>
+#include "src/debugmodule/debugmodule.h"
+
+#include "src/libutil/TimestampedBuffer.h"
+#include "libutil/SystemTimeSource.h"
+
+#include <pthread.h>
+
+using namespace Util;
+
+class TimestampedBufferTestClient
+    : public TimestampedBufferClient {
+public:
+    bool processReadBlock(char *data, unsigned int nevents, unsigned int offset) {return true;};
+    bool processWriteBlock(char *data, unsigned int nevents, unsigned int offset) {return true;};
+
+    void setVerboseLevel(int l) {setDebugLevel(l);};
+private:
+    DECLARE_DEBUG_MODULE;
+};
+
+IMPL_DEBUG_MODULE( TimestampedBufferTestClient, TimestampedBufferTestClient, DEBUG_LEVEL_VERBOSE );
+
+DECLARE_GLOBAL_DEBUG_MODULE;
+
+// the cycle timer wraps at 128 seconds
+#define TEST_WRAP_AT         (128LLU * 8000LLU * 3072LLU)
+#define TEST_PACKET_USECS    125
+
+volatile int run;
+// Program documentation.
+static char doc[] = "FFADO -- Timestamped buffer contention benchmark\n\n";
+
+// A description of the arguments we accept.
+static char args_doc[] = "";
+
+struct arguments
+{
+    short verbose;
+    unsigned int frames_per_packet;
+    unsigned int events_per_frame;
+    unsigned int period;
+    unsigned int buffersize;
+    unsigned int seconds;
+    bool unpaced;
+};
+
+// The options we understand.
+static struct argp_option options[] = {
+    {"verbose",     'v',    "n",    0,  "Verbose level" },
+    {"fpp",         'f',    "n",    0,  "Frames per packet (8)" },
+    {"epf",         'e',    "n",    0,  "Events per frame (10)" },
+    {"period",      'p',    "n",    0,  "Client period (in frames) (256)" },
+    {"buffersize",  'b',    "n",    0,  "Buffer size (in frames) (1024)" },
+    {"time",        't',    "n",    0,  "Run time (in seconds) (5)" },
+    {"unpaced",     'u',    0,      0,  "Don't pace the writer, run as fast as possible" },
+    { 0 }
+};
+
+//-------------------------------------------------------------
+
+// Parse a single option.
+static error_t
+parse_opt( int key, char* arg, struct argp_state* state )
+{
+    // Get the input argument from `argp_parse', which we
+    // know is a pointer to our arguments structure.
+    struct arguments* arguments = ( struct arguments* ) state->input;
+    char* tail;
+
+    errno = 0;
+    switch (key) {
+        case 'v':
+            arguments->verbose = strtol( arg, &tail, 0 );
+            break;
+        case 'f':
+            arguments->frames_per_packet = strtol( arg, &tail, 0 );
+            break;
+        case 'e':
+            arguments->events_per_frame = strtol( arg, &tail, 0 );
+            break;
+        case 'p':
+            arguments->period = strtol( arg, &tail, 0 );
+            break;
+        case 'b':
+            arguments->buffersize = strtol( arg, &tail, 0 );
+            break;
+        case 't':
+            arguments->seconds = strtol( arg, &tail, 0 );
+            break;
+        case 'u':
+            arguments->unpaced = true;
+            break;
+        default:
+            return ARGP_ERR_UNKNOWN;
+    }
+    if ( errno ) {
+        fprintf( stderr, "Could not parse argument for option '%c'\n", key );
+        return ARGP_ERR_UNKNOWN;
+    }
+    return 0;
+}
+
+// Our argp parser.
+static struct argp argp = { options, parse_opt, args_doc, doc };
+
+static void sighandler (int sig)
+{
+        run = 0;
+}
+
+static inline uint64_t
+getNsecs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000LLU + ts.tv_nsec;
+}
+
+struct op_stats
+{
+    uint64_t count;
+    uint64_t total_nsecs;
+    uint64_t max_nsecs;
+
+    void add(uint64_t nsecs) {
+        count++;
+        total_nsecs += nsecs;
+        if (nsecs > max_nsecs) max_nsecs = nsecs;
+    };
+    void print(const char *name, double seconds) {
+        printf("  %-24s: %10"PRIu64" ops, %10.0f ops/s, avg %7.1f ns, max %8"PRIu64" ns\n",
+               name, count, count / seconds,
+               count ? (double)total_nsecs / count : 0.0, max_nsecs);
+    };
+};
+
+struct thread_args
+{
+    TimestampedBuffer *t;
+    struct arguments *arguments;
+    struct op_stats write_ops;
+    struct op_stats read_ops;
+    struct op_stats query_ops;
+    uint64_t overruns;
+};
+
+static void *
+iso_thread(void *arg)
+{
+    struct thread_args *a = (struct thread_args *)arg;
+    TimestampedBuffer *t = a->t;
+    unsigned int fpp = a->arguments->frames_per_packet;
+    char packet[fpp * a->arguments->events_per_frame * sizeof(int)];
+    memset(packet, 0, sizeof(packet));
+
+    uint64_t ticks_per_packet = fpp * 512; // 48kHz
+    uint64_t timestamp = ticks_per_packet;
+    ffado_microsecs_t next_wake = SystemTimeSource::getCurrentTimeAsUsecs();
+
+    while (run) {
+        if (!a->arguments->unpaced) {
+            next_wake += TEST_PACKET_USECS;
+            SystemTimeSource::SleepUsecAbsolute(next_wake);
+        }
+        if (t->getBufferSpace() < fpp) {
+            // the client is too slow, a real SP would report an xrun
+            a->overruns++;
+            sched_yield();
+            continue;
+        }
+        uint64_t start = getNsecs();
+        t->writeFrames(fpp, packet, timestamp);
+        a->write_ops.add(getNsecs() - start);
+
+        timestamp += ticks_per_packet;
+        if (timestamp >= TEST_WRAP_AT) {
+            timestamp -= TEST_WRAP_AT;
+        }
+    }
+    return NULL;
+}
+
+static void *
+client_thread(void *arg)
+{
+    struct thread_args *a = (struct thread_args *)arg;
+    TimestampedBuffer *t = a->t;
+    unsigned int period = a->arguments->period;
+    char *data = (char *)calloc(period, t->getBytesPerFrame());
+
+    while (run) {
+        ffado_timestamp_t ts;
+        signed int fc;
+        uint64_t start = getNsecs();
+        t->getBufferHeadTimestamp(&ts, &fc);
+        a->query_ops.add(getNsecs() - start);
+
+        if (fc >= (signed int)period) {
+            start = getNsecs();
+            t->readFrames(period, data);
+            a->read_ops.add(getNsecs() - start);
+        } else if (!a->arguments->unpaced) {
+            // poll a few times per packet, like the SP manager
+            // does while waiting for a period
+            SystemTimeSource::SleepUsecRelative(TEST_PACKET_USECS / 4);
+        } else {
+            sched_yield();
+        }
+    }
+    free(data);
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    struct arguments arguments;
+
+    // Default values.
+    arguments.verbose           = 0;
+    arguments.frames_per_packet = 8;
+    arguments.events_per_frame  = 10;
+    arguments.period            = 256;
+    arguments.buffersize        = 1024;
+    arguments.seconds           = 5;
+    arguments.unpaced           = false;
+
+    // Parse our arguments; every option seen by `parse_opt' will
+    // be reflected in `arguments'.
+    if ( argp_parse ( &argp, argc, argv, 0, 0, &arguments ) ) {
+        fprintf( stderr, "Could not parse command line\n" );
+        exit(1);
+    }
+
+    setDebugLevel(arguments.verbose);
+
+    run=1;
+
+    signal (SIGINT, sighandler);
+    signal (SIGPIPE, sighandler);
+
+    TimestampedBufferTestClient *c = new TimestampedBufferTestClient();
+    c->setVerboseLevel(arguments.verbose);
+
+    TimestampedBuffer *t = new TimestampedBuffer(c);
+    t->setVerboseLevel(arguments.verbose);
+
+    // Setup the buffer like a receive stream processor does
+    t->setBufferSize(arguments.buffersize);
+    t->setEventSize(sizeof(int));
+    t->setEventsPerFrame(arguments.events_per_frame);
+    t->setUpdatePeriod(arguments.frames_per_packet);
+    t->setNominalRate(512.0);
+    t->setWrapValue(TEST_WRAP_AT);
+    if (!t->prepare()) {
+        fprintf( stderr, "Could not prepare buffer\n" );
+        exit(1);
+    }
+    t->setBufferTailTimestamp(0);
+    t->setTransparent(false);
+
+    struct thread_args a;
+    memset(&a, 0, sizeof(a));
+    a.t = t;
+    a.arguments = &arguments;
+
+    printf("TimestampedBuffer contention: %u frames/packet, period %u, %s, %us\n",
+           arguments.frames_per_packet, arguments.period,
+           (arguments.unpaced ? "unpaced" : "paced at 8000 packets/s"),
+           arguments.seconds);
+
+    pthread_t iso, client;
+    uint64_t start = getNsecs();
+    pthread_create(&iso, NULL, iso_thread, &a);
+    pthread_create(&client, NULL, client_thread, &a);
+
+    for (unsigned int i = 0; run && i < arguments.seconds * 10; i++) {
+        SystemTimeSource::SleepUsecRelative(100000);
+    }
+    run = 0;
+
+    pthread_join(iso, NULL);
+    pthread_join(client, NULL);
+    double seconds = (getNsecs() - start) / 1e9;
+
+    a.write_ops.print("writeFrames (iso)", seconds);
+    a.read_ops.print("readFrames (client)", seconds);
+    a.query_ops.print("getBufferHeadTimestamp", seconds);
+    printf("  %-24s: %10"PRIu64"\n", "writer overruns", a.overruns);
+    printf("  %-24s: %10u\n", "reader retries", t->getStateReadRetries());
+
+    delete t;
+    delete c;
+
+    return EXIT_SUCCESS;
+}